@@ -10,6 +10,10 @@
  * @note In the log-file, array size and array of the number of previously reflected lines are stored.
  * @note The data structure within the log-file is devised to avoid unreasonable increases in file size.
  * @note The contents:  [  < size_t >  < unsigned char > ...  ( < int > ... )  ]
+ * @note In the substitution record, the line number and the line before and after editing are stored in turn.
+ * @note In the line map of each target file, the lines of the other file reflected by the same command line are
+ *       stored for each line, as the first and last line numbers, so that each prompt only appends to it.
+ * @note The contents:  [  ( < uint32_t > * 2 ) ...  ]
  */
 
 #include "main.h"
@@ -17,9 +21,19 @@
 #define ERASE_FILE_D "/dit/var/erase.log.dock"
 #define ERASE_FILE_H "/dit/var/erase.log.hist"
 
+#define ERASE_SUBST_FILE_D "/dit/var/erase.subst.dock"
+#define ERASE_SUBST_FILE_H "/dit/var/erase.subst.hist"
+
+#define LINE_MAP_FILE_D "/dit/var/line.map.dock"
+#define LINE_MAP_FILE_H "/dit/var/line.map.hist"
+
 #define ERASE_OPTID_NUMBERS 1
-#define ERASE_OPTID_UNDOES 2
-#define ERASE_OPTID_MAX_COUNT 5
+#define ERASE_OPTID_SUBSTITUTE 2
+#define ERASE_OPTID_UNDOES 3
+#define ERASE_OPTID_MAX_COUNT 7
+
+#define ERASE_SUBST_GROUPS 10
+#define ERASE_SUBST_INITIAL_MAX 1023
 
 #define ERASE_HIST_FMT  "\n[ %zu ]\n"
 
@@ -43,10 +57,12 @@
 /** Data type for storing the results of option parse */
 typedef struct {
     bool has_delopt;     /** whether to have the options for deletion */
+    int subst_c;         /** whether to substitute ('S'), revert the last substitution ('R') or neither ('\0') */
     int undoes;          /** how many times to undo the editing of the target files */
     int target_c;        /** character representing the files to be edited ('d', 'h' or 'b') */
     bool history;        /** whether to show the reflection history in the target files */
     int ignore_case;     /** whether to ignore case in regex pattern matching (0 or REG_ICASE) */
+    bool linked;         /** whether to also delete the history lines that reflected the deleted Dockerfile lines */
     int max_count;       /** the maximum number of lines to delete, counting from the most recently added */
     bool reset_flag;     /** whether to reset the log-file (specified by optional arguments) */
     int blank_c;         /** how to handle the empty lines ('p', 's' or 't') */
@@ -76,6 +92,14 @@ typedef struct {
     unsigned int *check_list;    /** array of bits representing whether to delete the corresponding lines */
     bool first_mark;             /** whether to mark lines for deletion for the first time */
     erase_logs *logs;            /** variable to store the log-data recorded in the log-file */
+    size_t *subst_offsets;       /** array of offsets of the edited lines in 'substs', or NULL unless substituting */
+    inf_str substs;              /** sequence of the lines after editing */
+    size_t substs_len;           /** the total length of the lines after editing */
+    size_t *links;               /** array of the first and last numbers of the history lines to be deleted along */
+    size_t links_num;            /** the number of the pairs in the array above */
+    int links_total;             /** the number of lines in the history log-file when the pairs were collected */
+    int reported[2];             /** the provisional numbers of reflected lines read along with the target file */
+    bool changed;                /** whether another process edited the files while the user answered */
 } erase_data;
 
 
@@ -94,17 +118,31 @@ static int construct_erase_data(erase_data *data, int target_id, int provlogs[2]
 static int marklines_in_dockerfile(int size, char **patterns, erase_opts *opt, erase_data *data);
 static int marklines_containing_pattern(erase_data *data, const char *pattern, int ignore_case);
 
+static int marklines_to_substitute(erase_data *data, const char *expr, int ignore_case);
+static int marklines_to_revert(erase_data *data, int target_id);
+static int substitute_line(erase_data *data, const regex_t *preg, const char *line, const char *repl, bool global);
+static bool append_substs(erase_data *data, const char *src, size_t len);
+
 static int marklines_with_numbers(erase_data *data, const char *range);
 static void marklines_to_undo(erase_data *data, int undoes);
+static void marklines_linked(erase_data *data);
+static void collect_linked_lines(erase_data *data);
 
 static int delete_marked_lines(erase_data *data, const erase_opts *opt, int target_id);
 static int confirm_deleted_lines(erase_data *data, const erase_opts *opt, const char *target_file);
 static int handle_empty_lines(erase_data *data, int blank_c);
+static bool check_if_unchanged(erase_data *data, const char *target_file);
 
 static bool receive_range_specification(char *range, int stop, unsigned int *check_list);
+static bool receive_substitute_expr(const char *expr, char *buf, const char **p_repl, bool *p_global);
 static int popcount_check_list(unsigned int *check_list, size_t size);
+static void xperror_regex(int errcode, const regex_t *preg, const char *pattern);
 
 static int manage_erase_logs(const char *file_name, int mode_c, erase_logs *logs, int concat_flag);
+static int build_line_map(const char * const src_files[2], const char * const dest_files[2]);
+static int extend_line_map(const char * const dest_files[2], const int totals[2], const int counts[2]);
+static int verify_line_map(const char * const src_files[2], const char * const dest_files[2], int totals[2]);
+static int search_line_map(int fd, int total, size_t lineno, size_t range[2]);
 
 
 extern const char * const target_files[2];
@@ -121,6 +159,18 @@ static const char * const log_files[2] = {
     ERASE_FILE_D
 };
 
+/** array of the names of the line maps that link the lines of each target file to those of the other */
+static const char * const map_files[2] = {
+    LINE_MAP_FILE_H,
+    LINE_MAP_FILE_D
+};
+
+/** array of the names of files for storing the lines edited by the last substitution in the target files */
+static const char * const subst_files[2] = {
+    ERASE_SUBST_FILE_H,
+    ERASE_SUBST_FILE_D
+};
+
 
 
 
@@ -181,16 +231,18 @@ int erase(int argc, char **argv){
 static int parse_opts(int argc, char **argv, erase_opts *opt, erase_data *data){
     assert(opt);
 
-    const char *short_opts = "E:N:Z::dhHim:rstvy";
+    const char *short_opts = "E:N:S::Z::dhHiLm:rstvy";
 
     int flag;
     const struct option long_opts[] = {
         { "extended-regexp", required_argument,  NULL, 'E' },
         { "numbers",         required_argument,  NULL, 'N' },  // ERASE_OPTID_NUMBERS = 1
-        { "undoes",          optional_argument,  NULL, 'Z' },  // ERASE_OPTID_UNDOES = 2
+        { "substitute",      optional_argument,  NULL, 'S' },  // ERASE_OPTID_SUBSTITUTE = 2
+        { "undoes",          optional_argument,  NULL, 'Z' },  // ERASE_OPTID_UNDOES = 3
         { "history",         no_argument,        NULL, 'H' },
         { "ignore-case",     no_argument,        NULL, 'i' },
-        { "max-count",       required_argument,  NULL, 'm' },  // ERASE_OPTID_MAX_COUNT = 5
+        { "linked",          no_argument,        NULL, 'L' },
+        { "max-count",       required_argument,  NULL, 'm' },  // ERASE_OPTID_MAX_COUNT = 7
         { "reset",           no_argument,        NULL, 'r' },
         { "verbose",         no_argument,        NULL, 'v' },
         { "help",            no_argument,        NULL,  1  },
@@ -201,6 +253,7 @@ static int parse_opts(int argc, char **argv, erase_opts *opt, erase_data *data){
     };
 
     assert(! strcmp(long_opts[ERASE_OPTID_NUMBERS].name, "numbers"));
+    assert(! strcmp(long_opts[ERASE_OPTID_SUBSTITUTE].name, "substitute"));
     assert(! strcmp(long_opts[ERASE_OPTID_UNDOES].name, "undoes"));
     assert(! strcmp(long_opts[ERASE_OPTID_MAX_COUNT].name, "max-count"));
 
@@ -212,10 +265,12 @@ static int parse_opts(int argc, char **argv, erase_opts *opt, erase_data *data){
         int mode;
 
         opt->has_delopt = false;
+        opt->subst_c = '\0';
         opt->undoes = 0;
         opt->target_c = '\0';
         opt->history = false;
         opt->ignore_case = 0;
+        opt->linked = false;
         opt->max_count = -1;
         opt->reset_flag = false;
         opt->blank_c = 'p';
@@ -230,6 +285,26 @@ static int parse_opts(int argc, char **argv, erase_opts *opt, erase_data *data){
                 case 'N':
                     opt->has_delopt = true;
                     break;
+                case 'S':
+                    if (opt->subst_c){
+                        xperror_individually("only one substitution can be given at a time");
+                        goto errexit;
+                    }
+                    opt->subst_c = 'R';
+
+                    if (optarg){
+                        char buf[strlen(optarg) + 1];
+
+                        if (! receive_substitute_expr(optarg, buf, NULL, NULL)){
+                            errcode = 'O';
+                            c = 1;
+                            i = ERASE_OPTID_SUBSTITUTE;
+                            goto errexit;
+                        }
+                        opt->subst_c = 'S';
+                        opt->has_delopt = true;
+                    }
+                    break;
                 case 'Z':
                     if (! optarg){
                         opt->undoes = 1;
@@ -262,6 +337,9 @@ static int parse_opts(int argc, char **argv, erase_opts *opt, erase_data *data){
                 case 'i':
                     opt->ignore_case = REG_ICASE;
                     break;
+                case 'L':
+                    opt->linked = true;
+                    break;
                 case 'r':
                     opt->reset_flag = true;
                     break;
@@ -312,7 +390,27 @@ static int parse_opts(int argc, char **argv, erase_opts *opt, erase_data *data){
             goto errexit;
         }
 
-        if (! (opt->history || opt->has_delopt || opt->undoes || (opt->blank_c != 'p'))){
+        if (opt->subst_c && (! opt->history)){
+            if (opt->blank_c != 'p'){
+                xperror_individually("cannot delete the empty lines while substituting");
+                goto errexit;
+            }
+            if ((opt->subst_c == 'R') && (opt->has_delopt || opt->undoes)){
+                xperror_individually("cannot revert the substitution with any other conditions");
+                goto errexit;
+            }
+            if (opt->linked){
+                xperror_individually("cannot delete the linked lines while substituting");
+                goto errexit;
+            }
+        }
+
+        if (opt->linked && (opt->target_c == 'h')){
+            xperror_individually("the linked lines are found only from Dockerfile");
+            goto errexit;
+        }
+
+        if (! (opt->history || opt->has_delopt || opt->subst_c || opt->undoes || (opt->blank_c != 'p'))){
             if (opt->verbose){
                 display_prev_verbose(opt->target_c);
                 return NORMALLY_EXIT;
@@ -322,14 +420,14 @@ static int parse_opts(int argc, char **argv, erase_opts *opt, erase_data *data){
         }
     }
     else {
-        char short_delopts[5] = {0};
-        struct option long_delopts[3] = {0};
+        char short_delopts[8] = {0};
+        struct option long_delopts[4] = {0};
 
-        assert(strlen(short_opts) >= 4);
-        assert(numof(long_opts) > 2);
+        assert(strlen(short_opts) >= 7);
+        assert(numof(long_opts) > 3);
 
-        memcpy(short_delopts, short_opts, (sizeof(char) * 4));
-        memcpy(long_delopts, long_opts, (sizeof(struct option) * 2));
+        memcpy(short_delopts, short_opts, (sizeof(char) * 7));
+        memcpy(long_delopts, long_opts, (sizeof(struct option) * 3));
 
         optind = 1;
         opterr = 0;
@@ -340,6 +438,10 @@ static int parse_opts(int argc, char **argv, erase_opts *opt, erase_data *data){
                     if (! marklines_containing_pattern(data, optarg, opt->ignore_case))
                         break;
                     goto errexit;
+                case 'S':
+                    if ((! optarg) || (! marklines_to_substitute(data, optarg, opt->ignore_case)))
+                        break;
+                    goto errexit;
                 case 'N':
                     switch (marklines_with_numbers(data, optarg)){
                         case SUCCESS:
@@ -400,6 +502,7 @@ static int display_history(const erase_opts *opt){
     int *extras[2];
     char modes[2] = {0};
 
+    lock_provisional_report();
     read_provisional_report(reflecteds);
 
     do
@@ -531,9 +634,15 @@ exit:
         }
     while (offset);
 
+    if (modes[1] || modes[0]){
+        if (build_line_map(log_files, map_files))
+            exit_status = UNEXPECTED_ERROR;
+    }
+
     if (write_provisional_report(reflecteds))
         exit_status = UNEXPECTED_ERROR;
 
+    unlock_provisional_report();
     return exit_status;
 }
 
@@ -594,55 +703,91 @@ static void display_prev_verbose(int target_c){
  * @return int  0 (success), 1 (possible error), -1 (unexpected error) -2 (unexpected error & error exit)
  *
  * @note if the return value is -1, an internal file error has occurred, but the deletion was successful.
+ * @note each target file is edited under its own lock, which is released while the user answers the confirmation.
+ * @note history-file is also edited when the lines linked to those deleted from Dockerfile have been collected.
  */
 static int do_erase(int argc, char **argv, erase_opts *opt, delopt_func marklines_func){
     assert(argc >= 0);
     assert(opt);
     assert(marklines_func);
 
-    int reflecteds[2] = {0}, offset = 2, exit_status = SUCCESS, tmp;
+    int reflecteds[2], offset = 2, exit_status = SUCCESS, tmp;
     bool delopt_noerr = true;
 
     erase_logs logs = {0};
     erase_data data = { .logs = &logs };
 
-    read_provisional_report(reflecteds);
-
     do
-        if (opt->target_c != "dh"[--offset]){
+        if ((opt->target_c != "dh"[--offset]) || data.links_num){
             assert(offset == ((bool) offset));
 
+            reflecteds[0] = 0;
+            reflecteds[1] = 0;
+
+            lock_provisional_report();
+            read_provisional_report(reflecteds);
+
+            memcpy(data.reported, reflecteds, sizeof(reflecteds));
+            data.changed = false;
+
             logs.reset_flag = opt->reset_flag;
             monitor_unexpected_error(construct_erase_data(&data, offset, reflecteds, 'D'), exit_status);
 
+            if (data.links_num && (logs.reset_flag || (logs.total != data.links_total))){
+                free(data.links);
+                data.links = NULL;
+                data.links_num = 0;
+            }
+
             if (data.lines){
                 tmp = POSSIBLE_ERROR;
 
                 if (data.check_list){
-                    if (delopt_noerr){
+                    if (delopt_noerr && (opt->target_c != "dh"[offset])){
                         data.first_mark = true;
 
                         if (opt->undoes > 0){
                             data.first_mark = false;
                             marklines_to_undo(&data, opt->undoes);
                         }
+                        if ((opt->subst_c == 'R') && marklines_to_revert(&data, offset))
+                            delopt_noerr = false;
                         if (opt->has_delopt && marklines_func(argc, argv, opt, &data))
                             delopt_noerr = false;
                     }
+                    if (data.links_num)
+                        marklines_linked(&data);
 
                     tmp = delete_marked_lines(&data, (delopt_noerr ? opt : NULL), offset);
 
                     free(data.check_list);
+
+                    if (data.subst_offsets){
+                        free(data.subst_offsets);
+                        free(data.substs.ptr);
+                    }
                 }
 
                 free(data.lines);
 
                 if_necessary_assign_exit_status(tmp, exit_status);
             }
+
+            if (data.changed)
+                memcpy(reflecteds, data.reported, sizeof(reflecteds));
+
+            monitor_unexpected_error(write_provisional_report(reflecteds), exit_status);
+            unlock_provisional_report();
         }
     while (offset);
 
-    monitor_unexpected_error(write_provisional_report(reflecteds), exit_status);
+    if (data.links)
+        free(data.links);
+
+    lock_provisional_report();
+    monitor_unexpected_error(build_line_map(log_files, map_files), exit_status);
+    unlock_provisional_report();
+
     return exit_status;
 }
 
@@ -668,6 +813,7 @@ int delete_from_dockerfile(char **patterns, size_t count, bool verbose, int assu
 
     erase_opts opt = {
         .has_delopt = true,
+        .subst_c = '\0',
         .undoes = 0,
         .target_c = 'd',
         .ignore_case = REG_ICASE,
@@ -722,6 +868,7 @@ static int construct_erase_data(erase_data *data, int target_id, int provlogs[2]
     char **p_start = NULL, *line;
     bool concat_flag = true;
     int errid = 0, mode_c = 'w', exit_status = SUCCESS;
+    trace_scope scope;
 
     logs = data->logs;
 
@@ -730,6 +877,10 @@ static int construct_erase_data(erase_data *data, int target_id, int provlogs[2]
     data->lines = NULL;
     data->list_size = 0;
     data->check_list = NULL;
+    data->subst_offsets = NULL;
+    data->substs.ptr = NULL;
+    data->substs.max = 0;
+    data->substs_len = 0;
 
     logs->total = 0;
     logs->array_size = 0;
@@ -741,6 +892,8 @@ static int construct_erase_data(erase_data *data, int target_id, int provlogs[2]
     target_file = target_files[target_id];
     log_file = log_files[target_id];
 
+    trace_begin(&scope, TRACE_CONSTRUCT_ERASE_DATA, target_file);
+
     if (purpose_c != 'L'){
         p_start = &(data->lines);
         concat_flag = false;
@@ -784,6 +937,7 @@ static int construct_erase_data(erase_data *data, int target_id, int provlogs[2]
         xperror_standards(target_file, errid);
     }
 
+    trace_end(&scope);
     return exit_status;
 }
 
@@ -802,7 +956,8 @@ int update_erase_logs(int reflecteds[2]){
     assert(reflecteds[1] >= 0);
     assert(reflecteds[0] >= 0);
 
-    int offset = 2, exit_status = SUCCESS;
+    int offset = 2, totals[2], exit_status = SUCCESS;
+    bool reset_flag = false;
 
     erase_logs logs = {0};
     erase_data data = { .logs = &logs };
@@ -812,8 +967,15 @@ int update_erase_logs(int reflecteds[2]){
 
         if (construct_erase_data(&data, (--offset), reflecteds, 'L'))
             exit_status = UNEXPECTED_ERROR;
+
+        totals[offset] = logs.total;
+        reset_flag |= logs.reset_flag;
     } while (offset);
 
+    if ((exit_status || reset_flag || extend_line_map(map_files, totals, reflecteds)) &&
+        build_line_map(log_files, map_files))
+        exit_status = UNEXPECTED_ERROR;
+
     return exit_status;
 }
 
@@ -868,6 +1030,7 @@ static int marklines_in_dockerfile(int size, char **patterns, erase_opts *opt, e
  *
  * @note combine the conditions with a logical OR within this function.
  * @note combine the conditions with a logical AND between multiple calls to the 'marklines' functions.
+ * @note the compiled pattern is shared with later calls through the regex cache.
  *
  * @attention 'data' must be reliably constructed before calling this function.
  * @attention must not call this function if the target file does not contain any lines that can be deleted.
@@ -883,9 +1046,12 @@ static int marklines_containing_pattern(erase_data *data, const char *pattern, i
 
     if (pattern){
         int errcode;
-        regex_t preg;
+        cached_regex creg;
+        trace_scope scope;
+
+        trace_begin(&scope, TRACE_MARKLINES_CONTAINING, pattern);
 
-        if (! (errcode = regcomp(&preg, pattern, (REG_EXTENDED | REG_NOSUB | ignore_case)))){
+        if (! (errcode = regcomp_cached(&creg, pattern, (REG_EXTENDED | REG_NOSUB | ignore_case)))){
             const char *line;
             unsigned int i = 0, idx, mask;
 
@@ -897,7 +1063,7 @@ static int marklines_containing_pattern(erase_data *data, const char *pattern, i
                 mask = getmask_check_list(i);
 
                 if (data->first_mark || (data->check_list[idx] & mask)){
-                    if (! (errcode = regexec(&preg, line, 0, NULL, 0))){
+                    if (! (errcode = regexec_cached(&creg, line))){
                         if (data->first_mark)
                             data->check_list[idx] |= mask;
                     }
@@ -916,36 +1082,361 @@ static int marklines_containing_pattern(erase_data *data, const char *pattern, i
                 line += strlen(line) + 1;
             } while (true);
 
-            regfree(&preg);
+            regfree_cached(&creg);
         }
-        else {
-            size_t size;
-            size = regerror(errcode, &preg, NULL, 0);
+        else
+            xperror_regex(errcode, &(creg.preg), pattern);
+
+        data->first_mark = false;
+        trace_end(&scope);
+    }
+
+    return exit_status;
+}
+
+
+
+
+/******************************************************************************
+    * Determine by Regular Expression Substitution
+******************************************************************************/
 
-            char msg[size];
-            regerror(errcode, &preg, msg, size);
 
-            size = (strlen(pattern) * 4 + 1) + 2;
+/**
+ * @brief mark for editing the lines matching regex pattern string, and prepare the lines after substitution.
+ *
+ * @param[out] data  variable to store the data commonly used in this command
+ * @param[in]  expr  string of the form '/PATTERN/REPLACEMENT/[g]' specifying the substitution
+ * @param[in]  ignore_case  whether to ignore case in regex pattern matching (0 or REG_ICASE)
+ * @return int  0 (success), 1 (argument recognition error) or -1 (unexpected error)
+ *
+ * @note the matching and the substitution are done in one pass, and the lines left unchanged are not marked.
+ * @note combine the conditions with a logical AND between multiple calls to the 'marklines' functions.
+ *
+ * @attention 'data' must be reliably constructed before calling this function.
+ * @attention must not call this function if the target file does not contain any lines that can be deleted.
+ */
+static int marklines_to_substitute(erase_data *data, const char *expr, int ignore_case){
+    assert(data);
+    assert(data->lines_num);
+    assert(data->lines);
+    assert(data->check_list);
+    assert(expr);
+    assert((! ignore_case) || (ignore_case == REG_ICASE));
 
-            char buf[size];
-            size = get_sanitized_string((buf + 1), pattern, true);
+    char buf[strlen(expr) + 1];
+    const char *repl;
+    bool global;
+    int errcode, exit_status = POSSIBLE_ERROR;
+    regex_t preg;
+    trace_scope scope;
 
-            buf[0] = '\'';
-            buf[++size] = '\'';
-            buf[++size] = '\0';
+    if (! receive_substitute_expr(expr, buf, &repl, &global))
+        return exit_status;
 
-            xperror_message(msg, buf);
+    trace_begin(&scope, TRACE_MARKLINES_CONTAINING, buf);
+
+    if (! (errcode = regcomp(&preg, buf, (REG_EXTENDED | ignore_case)))){
+        const char *line;
+        unsigned int i = 0, idx, mask;
+        int offset;
+
+        exit_status = UNEXPECTED_ERROR;
+
+        if (! data->subst_offsets){
+            if ((data->subst_offsets = (size_t *) calloc(data->lines_num, sizeof(size_t)))){
+                // offset 0 is reserved for the lines that are not edited
+                if (! append_substs(data, "", 1)){
+                    free(data->subst_offsets);
+                    data->subst_offsets = NULL;
+                }
+            }
         }
 
-        data->first_mark = false;
+        if (data->subst_offsets){
+            exit_status = SUCCESS;
+            line = data->lines;
+
+            do {
+                idx = getidx_check_list(i);
+                mask = getmask_check_list(i);
+
+                if (data->first_mark || (data->check_list[idx] & mask)){
+                    if ((offset = substitute_line(data, &preg, line, repl, global)) > 0){
+                        data->subst_offsets[i] = offset;
+
+                        if (data->first_mark)
+                            data->check_list[idx] |= mask;
+                    }
+                    else if (! offset){
+                        if (! data->first_mark)
+                            data->check_list[idx] ^= mask;
+                    }
+                    else {
+                        exit_status = UNEXPECTED_ERROR;
+                        break;
+                    }
+                }
+
+                if (++i >= data->lines_num)
+                    break;
+                line += strlen(line) + 1;
+            } while (true);
+        }
+
+        regfree(&preg);
+    }
+    else
+        xperror_regex(errcode, &preg, buf);
+
+    data->first_mark = false;
+    trace_end(&scope);
+
+    return exit_status;
+}
+
+
+/**
+ * @brief mark for editing the lines edited by the last substitution, so as to restore them.
+ *
+ * @param[out] data  variable to store the data commonly used in this command
+ * @param[in]  target_id  1 (targets Dockerfile), 0 (targets history-file)
+ * @return int  0 (success), 1 (possible error) or -1 (unexpected error)
+ *
+ * @note the substitution record may not exist because no substitution has been done yet.
+ * @note if any of the recorded lines has been changed since then, none of the lines are marked.
+ *
+ * @attention 'data' must be reliably constructed before calling this function.
+ * @attention internally, it uses 'xfgets_for_loop' with a depth of 1.
+ */
+static int marklines_to_revert(erase_data *data, int target_id){
+    assert(data);
+    assert(data->lines_num);
+    assert(data->lines);
+    assert(data->check_list);
+    assert(! data->subst_offsets);
+    assert(target_id == ((bool) target_id));
+
+    char *records = NULL, *record, *prev_line, *next_line;
+    const char *line;
+    size_t records_num = 0;
+    unsigned int i = 0;
+    int errid = 0, num, last = 0, offset, exit_status = SUCCESS;
+
+    data->first_mark = false;
+
+    while (xfgets_for_loop(subst_files[target_id], &records, NULL, &errid))
+        records_num++;
+
+    if (errid){
+        if (errid != ENOENT){
+            exit_status = UNEXPECTED_ERROR;
+            xperror_standards(subst_files[target_id], errid);
+        }
+    }
+    else if (records_num){
+        exit_status = POSSIBLE_ERROR;
+
+        if ((! (records_num % 3)) && (data->subst_offsets = (size_t *) calloc(data->lines_num, sizeof(size_t)))){
+            exit_status = append_substs(data, "", 1) ? SUCCESS : UNEXPECTED_ERROR;
+
+            record = records;
+            line = data->lines;
+
+            for (; (! exit_status) && records_num; records_num -= 3){
+                prev_line = record + strlen(record) + 1;
+                next_line = prev_line + strlen(prev_line) + 1;
+
+                num = receive_positive_integer(record, NULL);
+
+                // the line numbers must be recorded in ascending order
+                if ((num <= last) || (num > data->lines_num)){
+                    exit_status = POSSIBLE_ERROR;
+                    break;
+                }
+                last = num;
+
+                for (; i < ((unsigned int) (num - 1)); i++)
+                    line += strlen(line) + 1;
+
+                offset = data->substs_len;
+
+                if (strcmp(line, next_line))
+                    exit_status = POSSIBLE_ERROR;
+                else if (append_substs(data, prev_line, (strlen(prev_line) + 1))){
+                    data->subst_offsets[i] = offset;
+                    setbit_check_list(data->check_list, i);
+                }
+                else
+                    exit_status = UNEXPECTED_ERROR;
+
+                record = next_line + strlen(next_line) + 1;
+            }
+        }
+
+        if (exit_status){
+            memset(data->check_list, 0, (sizeof(unsigned int) * data->list_size));
+
+            if (exit_status > 0)
+                xperror_message("changed since the last substitution", target_files[target_id]);
+        }
     }
 
+    if (records)
+        free(records);
+
     return exit_status;
 }
 
 
 
 
+/**
+ * @brief substitute the replacement string for the part of the line matching regex pattern.
+ *
+ * @param[out] data  variable to store the data commonly used in this command
+ * @param[in]  preg  compiled regex pattern
+ * @param[in]  line  target line
+ * @param[in]  repl  replacement string, where '&' and '\1' to '\9' refer to the matched part
+ * @param[in]  global  whether to substitute for all the matched parts or only the first one
+ * @return int  the offset of the line after substitution, 0 (not edited) or -1 (unexpected error)
+ *
+ * @note if the line has been edited, the resulting line is appended to 'data->substs'.
+ * @note a resulting line containing newlines is rejected as an unexpected error.
+ */
+static int substitute_line(erase_data *data, const regex_t *preg, const char *line, const char *repl, bool global){
+    assert(data);
+    assert(data->substs_len && (data->substs_len < INT_MAX));
+    assert(preg);
+    assert(line);
+    assert(repl);
+
+    regmatch_t pmatch[ERASE_SUBST_GROUPS];
+    const char *src, *ref;
+    size_t start;
+    int n, errcode, eflags = 0;
+    bool matched = false, adjacent = false;
+
+    src = line;
+    start = data->substs_len;
+
+    while (! (errcode = regexec(preg, src, ERASE_SUBST_GROUPS, pmatch, eflags))){
+        // like sed, an empty match just after the previous match is not replaced
+        if (adjacent && (! pmatch[0].rm_eo)){
+            if (! *src)
+                break;
+            if (! append_substs(data, (src++), 1))
+                return UNEXPECTED_ERROR;
+
+            adjacent = false;
+            continue;
+        }
+        matched = true;
+
+        if (! append_substs(data, src, pmatch[0].rm_so))
+            return UNEXPECTED_ERROR;
+
+        for (ref = repl; *ref; ref++){
+            n = -1;
+
+            if (*ref == '&')
+                n = 0;
+            else if ((*ref == '\\') && ref[1] && isdigit((unsigned char) *(++ref)))
+                n = *ref - '0';
+
+            if (n < 0){
+                if (! append_substs(data, ref, 1))
+                    return UNEXPECTED_ERROR;
+            }
+            else if (pmatch[n].rm_so >= 0){
+                if (! append_substs(data, (src + pmatch[n].rm_so), (pmatch[n].rm_eo - pmatch[n].rm_so)))
+                    return UNEXPECTED_ERROR;
+            }
+        }
+
+        src += pmatch[0].rm_eo;
+        adjacent = true;
+
+        // an empty match must advance by one character, so as not to match at the same position again
+        if (pmatch[0].rm_so == pmatch[0].rm_eo){
+            if (! *src)
+                break;
+            if (! append_substs(data, (src++), 1))
+                return UNEXPECTED_ERROR;
+            adjacent = false;
+        }
+
+        if (! global)
+            break;
+        eflags = REG_NOTBOL;
+    }
+
+    if (errcode && (errcode != REG_NOMATCH))
+        return UNEXPECTED_ERROR;
+
+    if (matched){
+        if (! append_substs(data, src, (strlen(src) + 1)))
+            return UNEXPECTED_ERROR;
+
+        if (data->substs_len > INT_MAX)
+            return UNEXPECTED_ERROR;
+
+        // a line must not be split into two or more, so as to keep the line numbers and the log-files valid
+        if (strchr((data->substs.ptr + start), '\n')){
+            data->substs_len = start;
+            return UNEXPECTED_ERROR;
+        }
+        if (strcmp((data->substs.ptr + start), line))
+            return start;
+
+        data->substs_len = start;
+    }
+
+    return 0;
+}
+
+
+/**
+ * @brief append the part of a line after substitution to the end of the lines after editing.
+ *
+ * @param[out] data  variable to store the data commonly used in this command
+ * @param[in]  src  the part of the line
+ * @param[in]  len  the length of the part
+ * @return bool  successful or not
+ *
+ * @note unlike 'xstrcat_inf_len', the part does not need to be null-terminated.
+ */
+static bool append_substs(erase_data *data, const char *src, size_t len){
+    assert(data);
+    assert(src);
+
+    size_t curr_max;
+    char *ptr;
+
+    if ((curr_max = data->substs.max) < (data->substs_len + len)){
+        if (! curr_max)
+            curr_max = ERASE_SUBST_INITIAL_MAX;
+
+        while (curr_max < (data->substs_len + len))
+            if ((curr_max = (curr_max << 1) + 1) < data->substs.max)
+                return false;
+
+        if (! (ptr = (char *) realloc(data->substs.ptr, (sizeof(char) * curr_max))))
+            return false;
+
+        data->substs.ptr = ptr;
+        data->substs.max = curr_max;
+    }
+
+    memcpy((data->substs.ptr + data->substs_len), src, (sizeof(char) * len));
+    data->substs_len += len;
+
+    return true;
+}
+
+
+
+
 /******************************************************************************
     * Determine by Range Specification
 ******************************************************************************/
@@ -1063,65 +1554,170 @@ static void marklines_to_undo(erase_data *data, int undoes){
 }
 
 
+/**
+ * @brief mark for deletion the history lines that reflected the Dockerfile lines deleted just before.
+ *
+ * @param[out] data  variable to store the data commonly used in this command
+ *
+ * @note combine the conditions with a logical OR, unlike the other 'marklines' functions.
+ * @attention 'data' must be reliably constructed before calling this function.
+ */
+static void marklines_linked(erase_data *data){
+    assert(data);
+    assert(data->check_list);
+    assert(data->links);
+    assert(data->links_num);
 
+    size_t i, j;
 
-/******************************************************************************
-    * Delete Phase
-******************************************************************************/
+    for (i = 0; i < data->links_num; i++)
+        for (j = data->links[i * 2]; j <= data->links[i * 2 + 1]; j++){
+            assert(j);
+
+            if (j > data->lines_num)
+                break;
+            setbit_check_list(data->check_list, (j - 1));
+        }
+}
 
 
 /**
- * @brief delete the lines recorded on checklist from the target file, and record this in the log-file.
+ * @brief collect the ranges of history lines linked to the Dockerfile lines marked for deletion.
  *
  * @param[out] data  variable to store the data commonly used in this command
- * @param[in]  opt  variable to store the results of option parse or NULL
- * @param[in]  target_id  1 (targets Dockerfile), 0 (targets history-file)
- * @return int  0 (success), 1 (possible error), -1 (unexpected error) -2 (unexpected error & error exit)
  *
- * @note modify the contents of the log-data as lines are deleted to properly update the log-file.
- * @note if no changes to the log-file are necessary, just releases the log-data at 'manage_erase_logs'.
- * @note if the return value is -1, an internal file error has occurred, but the deletion was successful.
+ * @note collects nothing unless the line maps are consistent with both log-files.
+ * @note the ranges are kept in 'data' so that the deletion from history-file can use them afterward.
  *
  * @attention 'data' must be reliably constructed before calling this function.
- * @attention must not call this function if the target file does not contain any lines that can be deleted.
  */
-static int delete_marked_lines(erase_data *data, const erase_opts *opt, int target_id){
+static void collect_linked_lines(erase_data *data){
     assert(data);
-    assert(data->lines_num);
-    assert(data->lines);
     assert(data->check_list);
     assert(data->logs);
-    assert(data->logs->total >= 0);
-    assert(data->logs->p_provlog);
-    assert(target_id == ((bool) target_id));
+    assert(! data->links);
 
-    erase_logs *logs;
-    int exit_status = POSSIBLE_ERROR, mode_c = '\0';
+    int totals[2], fd;
+    size_t range[2], i, size = 0;
+    void *ptr;
 
-    logs = data->logs;
+    if ((! verify_line_map(log_files, map_files, totals)) && (totals[1] == data->logs->total)){
+        if ((fd = open(LINE_MAP_FILE_D, (O_RDONLY | O_CLOEXEC))) != -1){
+            for (i = 0; i < totals[1]; i++)
+                if (getbit_check_list(data->check_list, i) && (! search_line_map(fd, totals[1], (i + 1), range)) &&
+                    (range[0] <= range[1])){
+                    if (data->links_num >= size){
+                        size = size ? (size * 2) : 8;
 
-    if (opt){
+                        if (! (ptr = realloc(data->links, (sizeof(size_t) * size * 2))))
+                            break;
+                        data->links = (size_t *) ptr;
+                    }
+                    memcpy((data->links + data->links_num++ * 2), range, sizeof(range));
+                }
+
+            close(fd);
+
+            if (i < totals[1]){
+                free(data->links);
+                data->links = NULL;
+                data->links_num = 0;
+            }
+            else
+                data->links_total = totals[0];
+        }
+    }
+}
+
+
+
+
+/******************************************************************************
+    * Delete Phase
+******************************************************************************/
+
+
+/**
+ * @brief delete the lines recorded on checklist from the target file, and record this in the log-file.
+ *
+ * @param[out] data  variable to store the data commonly used in this command
+ * @param[in]  opt  variable to store the results of option parse or NULL
+ * @param[in]  target_id  1 (targets Dockerfile), 0 (targets history-file)
+ * @return int  0 (success), 1 (possible error), -1 (unexpected error) -2 (unexpected error & error exit)
+ *
+ * @note modify the contents of the log-data as lines are deleted to properly update the log-file.
+ * @note if no changes to the log-file are necessary, just releases the log-data at 'manage_erase_logs'.
+ * @note when substituting, rewrites the marked lines instead of deleting them, and records them for reverting.
+ * @note if the return value is -1, an internal file error has occurred, but the deletion was successful.
+ * @note while the user answers the confirmation, the lock is released and nothing is left to be written.
+ *
+ * @attention 'data' must be reliably constructed before calling this function.
+ * @attention must not call this function if the target file does not contain any lines that can be deleted.
+ */
+static int delete_marked_lines(erase_data *data, const erase_opts *opt, int target_id){
+    assert(data);
+    assert(data->lines_num);
+    assert(data->lines);
+    assert(data->check_list);
+    assert(data->logs);
+    assert(data->logs->total >= 0);
+    assert(data->logs->p_provlog);
+    assert(target_id == ((bool) target_id));
+
+    erase_logs *logs;
+    int exit_status = POSSIBLE_ERROR, mode_c = '\0', deletes_num;
+    bool prompted;
+
+    logs = data->logs;
+
+    if (opt){
         exit_status = SUCCESS;
 
-        if (opt->verbose && (opt->target_c == 'b'))
+        if (opt->verbose && ((opt->target_c == 'b') || opt->linked))
             print_target_repr(target_id);
 
-        if (confirm_deleted_lines(data, opt, target_files[target_id])){
-            FILE *result_fp, *target_fp;
+        if ((prompted = ((opt->assume_c != 'Y') && (opt->assume_c != 'Q'))))
+            unlock_provisional_report();
 
+        deletes_num = confirm_deleted_lines(data, opt, target_files[target_id]);
+
+        if (prompted){
+            lock_provisional_report();
+
+            if (deletes_num && (! check_if_unchanged(data, target_files[target_id]))){
+                xperror_message("edited by another process during the confirmation, so left as it is", target_files[target_id]);
+                deletes_num = 0;
+                exit_status = POSSIBLE_ERROR;
+            }
+        }
+
+        if (deletes_num){
+            FILE *result_fp, *target_fp = NULL, *subst_fp = NULL;
+            trace_scope scope;
+
+            trace_begin(&scope, TRACE_DELETE_MARKED_LINES, target_files[target_id]);
             exit_status = FATAL_ERROR;
 
             if ((result_fp = fopen(erase_results[target_id], "w"))){
-                if ((target_fp = fopen(target_files[target_id], "w"))){
+                if ((! data->subst_offsets) || (subst_fp = fopen(subst_files[target_id], "w")))
+                    target_fp = fopen(target_files[target_id], "w");
+
+                if (target_fp){
                     int total, accum = 0, num, offset = 0;
                     unsigned char *array;
                     int *extra;
-                    const char *line;
+                    const char *line, *subst;
                     unsigned int i = 0;
                     FILE *fps[2] = {0};
 
                     exit_status = SUCCESS;
-                    mode_c = 'w';
+
+                    if (! subst_fp){
+                        mode_c = 'w';
+
+                        if (opt->linked && target_id && (! logs->reset_flag))
+                            collect_linked_lines(data);
+                    }
 
                     total = logs->total;
                     array = logs->array - 1;
@@ -1130,7 +1726,15 @@ static int delete_marked_lines(erase_data *data, const erase_opts *opt, int targ
 
                     do {
                         if (getbit_check_list(data->check_list, i)){
-                            if (i < total){
+                            if (subst_fp){
+                                assert(data->subst_offsets[i]);
+                                subst = data->substs.ptr + data->subst_offsets[i];
+
+                                fprintf(subst_fp, "%u\n%s\n%s\n", (i + 1), line, subst);
+                                fputs(subst, target_fp);
+                                fputc('\n', target_fp);
+                            }
+                            else if (i < total){
                                 logs->total--;
                                 assert(logs->total >= 0);
 
@@ -1199,12 +1803,17 @@ static int delete_marked_lines(erase_data *data, const erase_opts *opt, int targ
                     fclose(target_fp);
                 }
 
+                if (subst_fp)
+                    fclose(subst_fp);
+
                 fclose(result_fp);
             }
+
+            trace_end(&scope);
         }
     }
 
-    if (logs->reset_flag)
+    if (logs->reset_flag && (! data->changed))
         mode_c = 'w';
 
     monitor_unexpected_error(manage_erase_logs(log_files[target_id], mode_c, logs, false), exit_status);
@@ -1241,7 +1850,7 @@ static int confirm_deleted_lines(erase_data *data, const erase_opts *opt, const
         deletes_num = popcount_check_list(data->check_list, data->list_size);
         assert(deletes_num >= 0);
 
-        if (data->blanks_num){
+        if (data->blanks_num && (! data->subst_offsets)){
             deletes_num -= handle_empty_lines(data, '\0');
             assert(deletes_num >= 0);
         }
@@ -1279,6 +1888,9 @@ static int confirm_deleted_lines(erase_data *data, const erase_opts *opt, const
                         select_array[selects_num++] = i;
                         fprintf(stderr, "%3d  %s\n", selects_num, line);
 
+                        if (data->subst_offsets)
+                            fprintf(stderr, "%3s  %s\n", "=>", (data->substs.ptr + data->subst_offsets[i]));
+
                         if (++count == stop){
                             if (! (c = opt->assume_c)){
                                 fputc('\n', stderr);
@@ -1286,8 +1898,10 @@ static int confirm_deleted_lines(erase_data *data, const erase_opts *opt, const
                                 do {
                                     *answer = '\0';
                                     get_response(
-                                        "Do you want to delete all of them? [Y/n]  ",
-                                            "%4[^\n]", answer
+                                        (data->subst_offsets ?
+                                            "Do you want to substitute all of them? [Y/n]  " :
+                                            "Do you want to delete all of them? [Y/n]  "),
+                                        "%4[^\n]", answer
                                     );
                                 } while ((c = receive_expected_string(answer, assume_args, ARGS_NUM, 3)) < 0);
 
@@ -1297,9 +1911,12 @@ static int confirm_deleted_lines(erase_data *data, const erase_opts *opt, const
                                 case 'N':
                                     *range = '\0';
                                     get_response(
-                                        "\nSelect lines to delete by displayed number.\n"
-                                        " (separated by commas, length less than 64)  ",
-                                            "%63[^\n]", range
+                                        (data->subst_offsets ?
+                                            "\nSelect lines to substitute by displayed number.\n"
+                                            " (separated by commas, length less than 64)  " :
+                                            "\nSelect lines to delete by displayed number.\n"
+                                            " (separated by commas, length less than 64)  "),
+                                        "%63[^\n]", range
                                     );
                                     assert(selects_num > 0);
                                     *select_list = 0;
@@ -1435,6 +2052,47 @@ static int handle_empty_lines(erase_data *data, int blank_c){
 
 
 
+/**
+ * @brief check if the target file and the provisional report are left as they were when they were read.
+ *
+ * @param[out] data  variable to store the data commonly used in this command
+ * @param[in]  target_file  target file name
+ * @return bool  whether they are left as they were
+ *
+ * @note if not, the current provisional numbers are stored in 'data->reported' so as to be written back as they are.
+ * @attention internally, it uses 'xfgets_for_loop' with a depth of 1.
+ */
+static bool check_if_unchanged(erase_data *data, const char *target_file){
+    assert(data);
+    assert(data->lines);
+    assert(target_file);
+
+    int reflecteds[2] = {0}, errid = 0;
+    const char *line, *expected;
+    size_t lines_num = 0;
+
+    peek_provisional_report(reflecteds);
+    data->changed = ((reflecteds[0] != data->reported[0]) || (reflecteds[1] != data->reported[1]));
+
+    for (expected = data->lines; (line = xfgets_for_loop(target_file, NULL, NULL, &errid)); lines_num++){
+        if (data->changed || (lines_num >= data->lines_num) || strcmp(line, expected))
+            data->changed = true;
+        else
+            expected += strlen(expected) + 1;
+    }
+
+    if (errid || (lines_num != data->lines_num))
+        data->changed = true;
+
+    if (data->changed)
+        memcpy(data->reported, reflecteds, sizeof(reflecteds));
+
+    return ! data->changed;
+}
+
+
+
+
 /******************************************************************************
     * Utilities
 ******************************************************************************/
@@ -1509,6 +2167,72 @@ static bool receive_range_specification(char *range, int stop, unsigned int *che
 }
 
 
+/**
+ * @brief parse a string specifying a substitution.
+ *
+ * @param[in]  expr  string of the form '/PATTERN/REPLACEMENT/[g]'
+ * @param[out] buf  buffer of the same size as 'expr', to store the pattern and replacement strings
+ * @param[out] p_repl  variable to store the replacement string or NULL
+ * @param[out] p_global  variable to store whether 'g' is given or NULL
+ * @return bool  successful or not
+ *
+ * @note any character other than a backslash can be used as the delimiter instead of '/'.
+ * @note the delimiter escaped with a backslash in PATTERN and REPLACEMENT stands for itself.
+ * @note PATTERN must not be empty, and REPLACEMENT must not contain newlines to keep the number of lines.
+ */
+static bool receive_substitute_expr(const char *expr, char *buf, const char **p_repl, bool *p_global){
+    assert(expr);
+    assert(buf);
+
+    int delim, parts = 0;
+    const char *repl = NULL;
+    bool global = false;
+
+    if ((! (delim = *(expr++))) || (delim == '\\') || (*expr == delim))
+        return false;
+
+    do {
+        if (! *expr)
+            return false;
+
+        if (*expr == delim){
+            *(buf++) = '\0';
+
+            if (parts++){
+                expr++;
+                break;
+            }
+            repl = buf;
+        }
+        else {
+            if ((*expr == '\\') && expr[1]){
+                if (expr[1] != delim)
+                    *(buf++) = *expr;
+                expr++;
+            }
+            if (parts && (*expr == '\n'))
+                return false;
+            *(buf++) = *expr;
+        }
+        expr++;
+    } while (true);
+
+    if (*expr == 'g'){
+        global = true;
+        expr++;
+    }
+    if (*expr)
+        return false;
+
+    if (p_repl)
+        *p_repl = repl;
+    if (p_global)
+        *p_global = global;
+
+    return true;
+}
+
+
 /**
  * @brief calculate the number of lines to be deleted.
  *
@@ -1544,6 +2268,39 @@ static int popcount_check_list(unsigned int *check_list, size_t size){
 
 
 
+/**
+ * @brief print an error message to stderr that the regex pattern string cannot be compiled.
+ *
+ * @param[in]  errcode  the error code returned by 'regcomp'
+ * @param[in]  preg  regex pattern buffer passed to 'regcomp'
+ * @param[in]  pattern  the regex pattern string
+ */
+static void xperror_regex(int errcode, const regex_t *preg, const char *pattern){
+    assert(errcode);
+    assert(preg);
+    assert(pattern);
+
+    size_t size;
+    size = regerror(errcode, preg, NULL, 0);
+
+    char msg[size];
+    regerror(errcode, preg, msg, size);
+
+    size = (strlen(pattern) * 4 + 1) + 2;
+
+    char buf[size];
+    size = get_sanitized_string((buf + 1), pattern, true);
+
+    buf[0] = '\'';
+    buf[++size] = '\'';
+    buf[++size] = '\0';
+
+    xperror_message(msg, buf);
+}
+
+
+
+
 /******************************************************************************
     * Record Part
 ******************************************************************************/
@@ -1562,6 +2319,7 @@ static int popcount_check_list(unsigned int *check_list, size_t size){
  * @note when 'logs->reset_flag' is set to false, array of the log-data and its size are correctly recorded.
  * @note if 'concat_flag' is set to true, allocates the extra memory for one element of the array.
  * @note except when reading the log-data, releases the dynamic memory that is no longer needed.
+ * @note the log-file itself is read and written by libdit, so that its format is implemented only there.
  *
  * @attention 'logs' is not initialized in this function so that you can do write operations without reading.
  * @attention must not exit after only reading the log-data, as dynamic memory cannot be released.
@@ -1573,121 +2331,103 @@ static int manage_erase_logs(const char *file_name, int mode_c, erase_logs *logs
     assert(logs->total >= 0);
     assert(logs->p_provlog && (*(logs->p_provlog) >= 0));
 
-    char fm[] = "rb";
-    FILE *fp = NULL;
     int exit_status = SUCCESS;
 
-    size_t size, addition = 0;
+    size_t size, addition = 0, i;
     unsigned char *array, val;
-    int total = 0, *extra, num;
+    int total, *extra, num, *counts;
+    trace_scope scope;
 
-    if (mode_c){
-        fm[0] = mode_c;
-        fp = fopen(file_name, fm);
-        exit_status = UNEXPECTED_ERROR;
-    }
+    trace_begin(&scope, TRACE_MANAGE_ERASE_LOGS, file_name);
 
     switch (mode_c){
         case 'r':
             logs->reset_flag = true;
+            exit_status = UNEXPECTED_ERROR;
 
-            if (fp && (fread(&size, sizeof(size), 1, fp) == 1) && size){
+            if ((total = dit_read_erase_log(file_name, &counts, &size)) >= 0){
                 assert(concat_flag == ((bool) concat_flag));
 
+                for (i = 0; i < size; i++)
+                    if (counts[i] >= UCHAR_MAX)
+                        addition++;
+
                 if ((array = (unsigned char *) malloc(sizeof(unsigned char) * (size + concat_flag)))){
                     logs->array_size = size;
                     logs->array = array;
+                    extra = NULL;
 
-                    if (fread(array, sizeof(unsigned char), size, fp) == size){
-                        do
-                            if ((val = *(array++)) < UCHAR_MAX){
-                                total += val;
-                                if (total < val)
-                                    goto exit;
-                            }
-                            else
-                                addition++;
-                        while (--size);
-
-                        if (addition){
-                            if ((extra = (int *) malloc(sizeof(int) * (addition + concat_flag)))){
-                                logs->extra_size = addition;
-                                logs->extra = extra;
-
-                                if (fread(extra, sizeof(int), addition, fp) == addition){
-                                    do {
-                                        num = *(extra++);
-                                        total += num;
-                                        if (total < num)
-                                            goto exit;
-                                    } while (--addition);
-
-                                    exit_status = SUCCESS;
-                                }
-                            }
-                        }
-                        else
-                            exit_status = SUCCESS;
+                    if ((! addition) || (extra = (int *) malloc(sizeof(int) * (addition + concat_flag)))){
+                        logs->extra_size = addition;
+                        logs->extra = extra;
+
+                        for (i = 0; i < size; i++)
+                            if ((array[i] = (counts[i] < UCHAR_MAX) ? counts[i] : UCHAR_MAX) == UCHAR_MAX)
+                                *(extra++) = counts[i];
 
-                        if ((! exit_status) && (total < INT_MAX) && (total == logs->total))
+                        exit_status = SUCCESS;
+
+                        if (total == logs->total)
                             logs->reset_flag = false;
                     }
                 }
+                free(counts);
             }
             break;
         case 'w':
-            if (fp){
-                exit_status = SUCCESS;
-                size = logs->array_size;
-                array = logs->array;
-                addition = logs->extra_size;
-                extra = logs->extra;
-
-                if (logs->reset_flag || concat_flag){
-                    if (logs->reset_flag){
-                        total = logs->total;
-                        size = 0;
-                        addition = 0;
-                    }
-                    if (concat_flag){
-                        total += *(logs->p_provlog);
-                        assert(total >= *(logs->p_provlog));
-                    }
+            size = logs->array_size;
+            array = logs->array;
+            addition = logs->extra_size;
+            extra = logs->extra;
 
-                    if (total >= UCHAR_MAX){
-                        val = UCHAR_MAX;
-                        num = total;
+            if (logs->reset_flag || concat_flag){
+                total = 0;
 
-                        if (! extra){
-                            assert(! addition);
-                            extra = &num;
-                            addition = 1;
-                        }
-                        else
-                            extra[addition++] = num;
-                    }
-                    else
-                        val = total;
+                if (logs->reset_flag){
+                    total = logs->total;
+                    size = 0;
+                    addition = 0;
+                }
+                if (concat_flag){
+                    total += *(logs->p_provlog);
+                    assert(total >= *(logs->p_provlog));
+                }
 
-                    if (! array){
-                        assert(! size);
-                        array = &val;
-                        size = 1;
+                if (total >= UCHAR_MAX){
+                    val = UCHAR_MAX;
+                    num = total;
+
+                    if (! extra){
+                        assert(! addition);
+                        extra = &num;
+                        addition = 1;
                     }
                     else
-                        array[size++] = val;
+                        extra[addition++] = num;
                 }
+                else
+                    val = total;
 
-                assert(size);
-                fwrite(&size, sizeof(size), 1, fp);
+                if (! array){
+                    assert(! size);
+                    array = &val;
+                    size = 1;
+                }
+                else
+                    array[size++] = val;
+            }
 
-                assert(array);
-                fwrite(array, sizeof(unsigned char), size, fp);
+            assert(size);
+            assert(array);
+            exit_status = UNEXPECTED_ERROR;
 
-                if (addition){
-                    assert(extra);
-                    fwrite(extra, sizeof(int), addition, fp);
-                }
+            if ((counts = (int *) malloc(sizeof(int) * size))){
+                for (addition = 0, i = 0; i < size; i++)
+                    counts[i] = (array[i] < UCHAR_MAX) ? array[i] : extra[addition++];
+
+                if (! dit_write_erase_log(file_name, counts, size))
+                    exit_status = SUCCESS;
+                free(counts);
             }
         default:
             if (logs->array)
@@ -1696,14 +2436,207 @@ static int manage_erase_logs(const char *file_name, int mode_c, erase_logs *logs
                 free(logs->extra);
     }
 
+    trace_end(&scope);
+    return exit_status;
+}
+
+
+
+
+/**
+ * @brief rebuild the line map of each target file from the log-files, replacing them with 'rename'.
+ *
+ * @param[in]  src_files  array of the names of the log-files, in the order of the targets
+ * @param[in]  dest_files  array of the names of the line maps, in the order of the targets
+ * @return int  0 (success) or -1 (unexpected error)
+ *
+ * @note the k-th elements of both log-files count the lines that the k-th command line reflected in each file.
+ * @note if the log-files are missing or out of step with each other, the line maps are left, as no lookup trusts them.
+ */
+static int build_line_map(const char * const src_files[2], const char * const dest_files[2]){
+    assert(src_files);
+    assert(dest_files);
+
+    int *counts[2] = {0}, totals[2], offset, fd, j, exit_status = UNEXPECTED_ERROR;
+    size_t sizes[2], i;
+    uint32_t pair[2];
+    char tmp_path[PATH_MAX];
+    FILE *fp;
+    trace_scope scope;
+
+    trace_begin(&scope, TRACE_BUILD_LINE_MAP, dest_files[1]);
+
+    for (offset = 0; offset < 2; offset++)
+        if ((totals[offset] = dit_read_erase_log(src_files[offset], (counts + offset), (sizes + offset))) < 0)
+            break;
+
+    if ((offset < 2) || (sizes[1] != sizes[0])){
+        exit_status = SUCCESS;
+        goto exit;
+    }
+
+    for (offset = 0; offset < 2; offset++){
+        if (snprintf(tmp_path, sizeof(tmp_path), "%s.%d", dest_files[offset], ((int) getpid())) >= sizeof(tmp_path))
+            goto exit;
+
+        unlink(tmp_path);
+
+        if ((fd = open(tmp_path, (O_WRONLY | O_CREAT | O_EXCL | O_NOFOLLOW | O_CLOEXEC), 0666)) == -1)
+            goto exit;
+
+        if (fchmod(fd, 0666) || (! (fp = fdopen(fd, "wb")))){
+            close(fd);
+            unlink(tmp_path);
+            goto exit;
+        }
+
+        for (pair[1] = 0, i = 0; i < sizes[0]; i++){
+            pair[0] = pair[1] + 1;
+            pair[1] += counts[! offset][i];
+
+            for (j = counts[offset][i]; j--;)
+                fwrite(pair, sizeof(uint32_t), 2, fp);
+        }
+
+        if ((ferror(fp) | fclose(fp)) || rename(tmp_path, dest_files[offset])){
+            unlink(tmp_path);
+            goto exit;
+        }
+    }
+
+    exit_status = SUCCESS;
+
 exit:
-    if (fp)
-        fclose(fp);
+    free(counts[0]);
+    free(counts[1]);
 
+    trace_end(&scope);
     return exit_status;
 }
 
 
+/**
+ * @brief append to the line maps the lines reflected by the command line that has just been recorded.
+ *
+ * @param[in]  dest_files  array of the names of the line maps, in the order of the targets
+ * @param[in]  totals  array of the numbers of lines the log-files accounted for before the command line
+ * @param[in]  counts  array of the numbers of lines the command line reflected
+ * @return int  0 (success) or -1 (unexpected error)
+ *
+ * @note it fails without writing anything unless both line maps end at 'totals', so that the caller rebuilds them.
+ * @note the line maps only grow here, and readers never see anything but complete pairs within 'totals'.
+ */
+static int extend_line_map(const char * const dest_files[2], const int totals[2], const int counts[2]){
+    assert(dest_files);
+    assert(totals);
+    assert(counts);
+
+    int fds[2] = { -1, -1 }, offset, exit_status = UNEXPECTED_ERROR;
+    uint32_t pairs[512][2];
+    struct stat file_stat;
+    size_t i, j;
+
+    for (offset = 0; offset < 2; offset++){
+        assert((totals[offset] >= 0) && (counts[offset] >= 0));
+
+        if ((fds[offset] = open(dest_files[offset], (O_WRONLY | O_APPEND | O_NOFOLLOW | O_CLOEXEC))) == -1)
+            goto exit;
+        if (fstat(fds[offset], &file_stat) || (file_stat.st_size != (sizeof(pairs[0]) * totals[offset])))
+            goto exit;
+    }
+
+    for (offset = 0; offset < 2; offset++){
+        pairs[0][0] = totals[! offset] + 1;
+        pairs[0][1] = totals[! offset] + counts[! offset];
+
+        for (i = 1; i < numof(pairs); i++)
+            memcpy(pairs[i], pairs[0], sizeof(pairs[0]));
+
+        for (i = counts[offset]; i; i -= j){
+            j = (i < numof(pairs)) ? i : numof(pairs);
+
+            if (write(fds[offset], pairs, (sizeof(pairs[0]) * j)) != (sizeof(pairs[0]) * j))
+                goto exit;
+        }
+    }
+
+    exit_status = SUCCESS;
+
+exit:
+    for (offset = 0; offset < 2; offset++)
+        if (fds[offset] != -1)
+            close(fds[offset]);
+
+    return exit_status;
+}
+
+
+/**
+ * @brief check if the line maps are in step with the log-files, so that their lookups can be trusted.
+ *
+ * @param[in]  src_files  array of the names of the log-files, in the order of the targets
+ * @param[in]  dest_files  array of the names of the line maps, in the order of the targets
+ * @param[out] totals  array of length 2 for storing the numbers of lines the log-files account for
+ * @return int  0 (success) or -1 (not in step)
+ *
+ * @note a line map left stale by libdit or by an interrupted update differs in size from what the log-files count.
+ */
+static int verify_line_map(const char * const src_files[2], const char * const dest_files[2], int totals[2]){
+    assert(src_files);
+    assert(dest_files);
+    assert(totals);
+
+    int *counts, offset;
+    size_t sizes[2];
+    struct stat file_stat;
+
+    for (offset = 0; offset < 2; offset++){
+        totals[offset] = dit_read_erase_log(src_files[offset], &counts, (sizes + offset));
+        free(counts);
+
+        if (totals[offset] < 0)
+            return UNEXPECTED_ERROR;
+        if (stat(dest_files[offset], &file_stat) || (file_stat.st_size != (sizeof(uint32_t) * 2 * totals[offset])))
+            return UNEXPECTED_ERROR;
+    }
+
+    return (sizes[1] == sizes[0]) ? SUCCESS : UNEXPECTED_ERROR;
+}
+
+
+/**
+ * @brief find the lines of the other target file that were reflected by the same command line.
+ *
+ * @param[in]  fd  file descriptor of the line map of the target file
+ * @param[in]  total  the number of lines the log-file of the target file accounts for
+ * @param[in]  lineno  the line number in the target file, starting from 1
+ * @param[out] range  array of length 2 for storing the first and last line numbers in the other file
+ * @return int  0 (success) or -1 (not mapped)
+ *
+ * @note reads only the entry it needs, so it takes constant time however long the target files are.
+ * @note if the command line reflected no lines in the other file, the first line number exceeds the last one.
+ * @attention the line map should be verified by 'verify_line_map' beforehand.
+ */
+static int search_line_map(int fd, int total, size_t lineno, size_t range[2]){
+    assert(fd >= 0);
+    assert(total >= 0);
+    assert(range);
+
+    uint32_t pair[2];
+
+    if (lineno && (lineno <= total) &&
+        (pread(fd, pair, sizeof(pair), ((off_t) sizeof(pair) * (lineno - 1))) == sizeof(pair)) &&
+        pair[0] && (pair[0] <= (pair[1] + 1))
+    ){
+        range[0] = pair[0];
+        range[1] = pair[1];
+        return SUCCESS;
+    }
+
+    return UNEXPECTED_ERROR;
+}
+
+
 
 
 #ifndef NDEBUG
@@ -1720,11 +2653,14 @@ static void getsize_check_list_macro_test(void);
 static void marklines_containing_pattern_test(void);
 static void marklines_with_numbers_test(void);
 static void marklines_to_undo_test(void);
+static void marklines_to_substitute_test(void);
 
 static void receive_range_specification_test(void);
+static void receive_substitute_expr_test(void);
 static void popcount_check_list_test(void);
 
 static void manage_erase_logs_test(void);
+static void build_line_map_test(void);
 
 
 
@@ -1737,13 +2673,16 @@ void erase_test(void){
     do_test(getsize_check_list_macro_test);
 
     do_test(receive_range_specification_test);
+    do_test(receive_substitute_expr_test);
     do_test(popcount_check_list_test);
 
     do_test(marklines_containing_pattern_test);
     do_test(marklines_with_numbers_test);
     do_test(marklines_to_undo_test);
+    do_test(marklines_to_substitute_test);
 
     do_test(manage_erase_logs_test);
+    do_test(build_line_map_test);
 }
 
 
@@ -2072,6 +3011,118 @@ static void marklines_to_undo_test(void){
 
 
 
+static void marklines_to_substitute_test(void){
+    // changeable part for updating test cases
+    const char * const lines_array[] = {
+        "FROM alpine:3.18",
+        "RUN apk add curl=8.4.0-r0",
+        "",
+        "RUN apk add gcc=12.2.1-r0 make=4.4.1-r1",
+        "WORKDIR /dit/src",
+            NULL
+    };
+
+
+    const char * const *p_line;
+    char *dest, lines_sequence[256];
+    size_t total_size = 0, size, lines_num = 0;
+
+    for (p_line = lines_array; *p_line; p_line++){
+        dest = lines_sequence + total_size;
+
+        size = strlen(*p_line) + 1;
+        assert((total_size += size) <= 256);
+
+        lines_num++;
+        memcpy(dest, *p_line, (sizeof(char) * size));
+    }
+
+    unsigned int check_list[1] = {0};
+    erase_data data = { .lines_num = lines_num, .lines = lines_sequence, .check_list = check_list };
+
+
+    const struct {
+        const char * const expr;
+        const int flag;
+        const unsigned int result;
+        const char * const substs[5];
+    }
+    // changeable part for updating test cases
+    table[] = {
+        {
+            "/=[^ ]+//g",              true, 0x0000000a,
+            { NULL, "RUN apk add curl", NULL, "RUN apk add gcc make", NULL }
+        },
+        {
+            "|^RUN apk add|& --no-cache|", true, 0x0000000a,
+            { NULL, "RUN apk add --no-cache curl=8.4.0-r0", NULL, "RUN apk add --no-cache gcc=12.2.1-r0 make=4.4.1-r1", NULL }
+        },
+        {
+            "/([a-z]+)=([0-9.]+)-r[0-9]/\\2:\\1/", false, 0x00000008,
+            { NULL, NULL, NULL, "RUN apk add 12.2.1:gcc make=4.4.1-r1", NULL }
+        },
+        {
+            "/[0-9]*$/;/g",            true, 0x0000001f,
+            { "FROM alpine:3.;", "RUN apk add curl=8.4.0-r;", ";", "RUN apk add gcc=12.2.1-r0 make=4.4.1-r;", "WORKDIR /dit/src;" }
+        },
+        {
+            "/x*/-/g",                false, 0x00000018,
+            { NULL, NULL, NULL, "-R-U-N- -a-p-k- -a-d-d- -g-c-c-=-1-2-.-2-.-1---r-0- -m-a-k-e-=-4-.-4-.-1---r-1-", "-W-O-R-K-D-I-R- -/-d-i-t-/-s-r-c-" }
+        },
+        {
+            "/alpine/alpine/",         true, 0x00000000,
+            { NULL, NULL, NULL, NULL, NULL }
+        },
+        {
+            "/(/x/",                     -1, 0x00000000,
+            { NULL, NULL, NULL, NULL, NULL }
+        },
+        {  0,                           0,     0,     { NULL } }
+    };
+
+
+    int i, type;
+    unsigned int j;
+
+    for (i = 0; table[i].expr; i++){
+        fprintf(stderr, "  Specifying the %dth element '%s' ...\n", i, table[i].expr);
+
+        type = (table[i].flag < 0) ? POSSIBLE_ERROR : SUCCESS;
+        data.first_mark = table[i].flag;
+
+        // lines 4 and 5 are marked by the previous condition
+        *check_list = table[i].flag ? 0x00000000 : 0x00000018;
+
+        assert(marklines_to_substitute(&data, table[i].expr, 0) == type);
+        assert(! data.first_mark);
+        assert(*check_list == table[i].result);
+
+        for (j = 0; j < lines_num; j++)
+            if (getbit_check_list(check_list, j)){
+                assert(data.subst_offsets);
+                assert(data.subst_offsets[j]);
+                assert(! strcmp((data.substs.ptr + data.subst_offsets[j]), table[i].substs[j]));
+
+                fprintf(stderr, "    %u:  '%s'\n", (j + 1), table[i].substs[j]);
+            }
+            else
+                assert(! table[i].substs[j]);
+
+        if (data.subst_offsets){
+            free(data.subst_offsets);
+            free(data.substs.ptr);
+
+            data.subst_offsets = NULL;
+            data.substs.ptr = NULL;
+            data.substs.max = 0;
+            data.substs_len = 0;
+        }
+    }
+}
+
+
+
+
 static void receive_range_specification_test(void){
     const struct {
         const char * const range;
@@ -2139,6 +3190,59 @@ static void receive_range_specification_test(void){
 
 
 
+static void receive_substitute_expr_test(void){
+    const struct {
+        const char * const expr;
+        const char * const pattern;
+        const char * const repl;
+        const bool global;
+    }
+    // changeable part for updating test cases
+    table[] = {
+        { "/a/b/",             "a",           "b",           false },
+        { "/a//g",             "a",           "",            true  },
+        { "|/usr|/opt|g",      "/usr",        "/opt",        true  },
+        { "/a\\/b/c\\/d/",       "a/b",         "c/d",         false },
+        { "/(a)\\.b/\\1\\\\&/",    "(a)\\.b",      "\\1\\\\&",     false },
+        { "\na\nb\n",          "a",           "b",           false },
+        { ",[,]+, ,",          NULL,          NULL,          false },
+        { "",                  NULL,          NULL,          false },
+        { "/",                 NULL,          NULL,          false },
+        { "//b/",              NULL,          NULL,          false },
+        { "/a/b",              NULL,          NULL,          false },
+        { "/a/b/gi",           NULL,          NULL,          false },
+        { "\\a\\b\\",           NULL,          NULL,          false },
+        { "/a\\/b/",           NULL,          NULL,          false },
+        { "/a/x\ny/",          NULL,          NULL,          false },
+        { "/a/\\\n/g",         NULL,          NULL,          false },
+        {  0,                   0,             0,             0    }
+    };
+
+    int i, type;
+    char buf[64];
+    const char *repl;
+    bool global;
+
+    for (i = 0; table[i].expr; i++){
+        type = table[i].repl ? SUCCESS : FAILURE;
+
+        assert(strlen(table[i].expr) < 64);
+        assert(receive_substitute_expr(table[i].expr, buf, &repl, &global) == (! type));
+
+        if (type == SUCCESS){
+            assert(! strcmp(buf, table[i].pattern));
+            assert(! strcmp(repl, table[i].repl));
+            assert(global == table[i].global);
+        }
+
+        print_progress_test_loop('S', type, i);
+        xputs(table[i].expr);
+    }
+}
+
+
+
+
 static void popcount_check_list_test(void){
     const struct {
         const unsigned int bits;
@@ -2335,19 +3439,253 @@ static void manage_erase_logs_test(void){
         logs.extra = NULL;
 
         assert(manage_erase_logs(TMP_FILE1, 'r', &logs, false) == UNEXPECTED_ERROR);
+        assert(logs.reset_flag);
+
+        assert(! logs.array_size);
+        assert(! logs.array);
         assert(manage_erase_logs(TMP_FILE1, '\0', &logs, true) == SUCCESS);
+    }
+}
 
-        if (! i){
-            assert(logs.array_size == 3);
-            assert(logs.array);
+
+static void build_line_map_test(void){
+    const char * const src_files[2] = { TMP_FILE1, TMP_FILE2 };
+    const char * const dest_files[2] = { "/dit/tmp/line.map.test.hist", "/dit/tmp/line.map.test.dock" };
+
+    const struct {
+        const int counts[2][4];
+        const struct {
+            int target_id;
+            size_t lineno;
+            int first;
+            int last;
+        } queries[6];
+    }
+    // changeable part for updating test cases
+    table[] = {
+        {
+            { { 2, 0, 3, -1 }, { 1, 2, 0, -1 } },
+            {
+                { 1, 1,  1,  2 },
+                { 1, 2,  3,  2 },
+                { 1, 4, -1, -1 },
+                { 0, 1,  1,  1 },
+                { 0, 4,  4,  3 },
+                { 1, 0, -1, -1 }
+            }
+        },
+        {
+            { { 300, 0, -1 }, { 1, 254, -1 } },
+            {
+                { 1,   1,    1, 300 },
+                { 1, 255,  301, 300 },
+                { 0, 300,    1,   1 },
+                { 0, 301,   -1,  -1 },
+                { 1, 256,   -1,  -1 },
+                { 1,   0,   -1,  -1 }
+            }
+        },
+        {
+            { { 3, -1 }, { 1, 2, -1 } },
+            { { 1, 1, -1, -1 }, { 0, 1, -1, -1 } }
+        },
+        {
+            { { -1 }, { -1 } },
+            { { 0 } }
         }
-        else {
-            assert(! logs.array_size);
-            assert(! logs.array);
-            break;
+    };
+
+
+    size_t sizes[2], range[2];
+    int totals[2], counts[2], i, j, k, offset, fd, result;
+    bool mapped;
+
+    for (i = 0; table[i].counts[0][0] >= 0; i++){
+        for (offset = 0; offset < 2; offset++){
+            for (sizes[offset] = 0; table[i].counts[offset][sizes[offset]] >= 0; sizes[offset]++);
+            assert(sizes[offset]);
+
+            totals[offset] = 0;
+            counts[offset] = table[i].counts[offset][sizes[offset] - 1];
+
+            for (j = 0; j < (sizes[offset] - 1); j++)
+                totals[offset] += table[i].counts[offset][j];
         }
+
+        // the last command line is appended to the line maps built without it, as is done at each prompt
+        if (sizes[1] == sizes[0]){
+            for (offset = 0; offset < 2; offset++)
+                assert(! dit_write_erase_log(src_files[offset], table[i].counts[offset], (sizes[offset] - 1)));
+
+            assert(build_line_map(src_files, dest_files) == SUCCESS);
+            assert(extend_line_map(dest_files, totals, counts) == SUCCESS);
+
+            // the line maps that do not end where the log-files do are left as they are
+            assert(extend_line_map(dest_files, totals, counts) == UNEXPECTED_ERROR);
+        }
+
+        for (offset = 0; offset < 2; offset++)
+            assert(! dit_write_erase_log(src_files[offset], table[i].counts[offset], sizes[offset]));
+
+        if (sizes[1] != sizes[0])
+            assert(build_line_map(src_files, dest_files) == SUCCESS);
+
+        mapped = (verify_line_map(src_files, dest_files, totals) == SUCCESS);
+
+        for (j = 0; j < 6; j++){
+            if (! (table[i].queries[j].lineno || table[i].queries[j].target_id))
+                break;
+
+            k = table[i].queries[j].first;
+            offset = table[i].queries[j].target_id;
+            result = UNEXPECTED_ERROR;
+
+            if (mapped){
+                assert((fd = open(dest_files[offset], (O_RDONLY | O_CLOEXEC))) != -1);
+                result = search_line_map(fd, totals[offset], table[i].queries[j].lineno, range);
+                assert(! close(fd));
+            }
+
+            print_progress_test_loop('S', ((k < 0) ? FAILURE : SUCCESS), (i * 6 + j));
+            fprintf(stderr, "%s:  %zu\n", (offset ? "d" : "h"), table[i].queries[j].lineno);
+
+            if (k < 0)
+                assert(result == UNEXPECTED_ERROR);
+            else {
+                assert(result == SUCCESS);
+                assert(range[0] == k);
+                assert(range[1] == table[i].queries[j].last);
+            }
+        }
+    }
+
+    // the line maps are no longer trusted once either log-file has been edited without them
+    assert(! dit_write_erase_log(src_files[1], table[0].counts[1], 2));
+    assert(verify_line_map(src_files, dest_files, totals) == UNEXPECTED_ERROR);
+
+    assert(! unlink(TMP_FILE2));
+    assert(verify_line_map(src_files, dest_files, totals) == UNEXPECTED_ERROR);
+
+    for (offset = 0; offset < 2; offset++)
+        assert(! unlink(dest_files[offset]));
+}
+
+
+
+
+/******************************************************************************
+    * Benchmark Functions
+******************************************************************************/
+
+
+static void gen_check_list(bench_input *input);
+static void popcount_check_list_bench(const bench_input *input);
+
+
+
+
+void erase_bench(void){
+    do_bench(popcount_check_list_bench, gen_check_list);
+}
+
+
+
+
+static void gen_check_list(bench_input *input){
+    const size_t size = getsize_check_list(65536);
+
+    unsigned int *check_list;
+    size_t i;
+
+    assert((check_list = (unsigned int *) malloc(sizeof(unsigned int) * size)));
+
+    for (i = 0; i < size; i++)
+        check_list[i] = ((unsigned int) rand() << 16) ^ rand();
+
+    input->data = check_list;
+    input->items = size;
+    input->bytes = sizeof(unsigned int) * size;
+}
+
+
+static void popcount_check_list_bench(const bench_input *input){
+    bench_sink += popcount_check_list((unsigned int *) input->data, input->items);
+}
+
+
+
+
+/******************************************************************************
+    * Fuzzing Functions
+******************************************************************************/
+
+
+static void receive_range_specification_fuzz(const char *input, size_t len);
+static void marklines_containing_pattern_fuzz(const char *input, size_t len);
+
+
+/** the number of lines that can be specified in the range specification while fuzzing */
+#define FUZZ_RANGE_STOP 65536
+
+/** the number of lines of Dockerfile matched against the pattern while fuzzing */
+#define FUZZ_PATTERN_LINES 64
+
+
+
+
+void erase_fuzz(void){
+    const char * const range_seeds[] = { "1", "5-8,13,0,21-", "31-7,100,,24-24", "-", "1-2147483647", "2147483647-1" };
+    const char * const pattern_seeds[] = { "^RUN", "\\.tar\\.gz$", "(a|aa)*b", "^[[:space:]]*[^#]", "(.*)*x", "a{1,8}" };
+
+    do_fuzz(receive_range_specification_fuzz, range_seeds, ",");
+    do_fuzz(marklines_containing_pattern_fuzz, pattern_seeds, "");
+}
+
+
+
+
+static void receive_range_specification_fuzz(const char *input, size_t len){
+    static unsigned int check_list[getsize_check_list(FUZZ_RANGE_STOP)];
+
+    char range[len + 1];
+
+    memcpy(range, input, (sizeof(char) * (len + 1)));
+    bench_sink += receive_range_specification(range, FUZZ_RANGE_STOP, check_list);
+}
+
+
+static void marklines_containing_pattern_fuzz(const char *input, size_t len){
+    static char *lines = NULL;
+    static unsigned int check_list[getsize_check_list(FUZZ_PATTERN_LINES)];
+
+    erase_data data = {
+        .lines_num = FUZZ_PATTERN_LINES,
+        .list_size = getsize_check_list(FUZZ_PATTERN_LINES),
+        .check_list = check_list,
+        .first_mark = true
+    };
+
+    // the lines are generated once, and then kept until the process exits
+    if (! lines){
+        workload_rng rng;
+        FILE *fp;
+        size_t size;
+        char *tmp;
+
+        workload_seed(&rng, WORKLOAD_SEED);
+
+        assert((fp = open_memstream(&lines, &size)));
+        assert(! gen_workload_dockerfile(fp, &rng, FUZZ_PATTERN_LINES, NULL));
+        assert(! fclose(fp));
+
+        for (tmp = lines; (tmp = strchr(tmp, '\n')); *(tmp++) = '\0');
     }
+
+    data.lines = lines;
+    bench_sink += marklines_containing_pattern(&data, input, 0);
 }
 
 
-#endif // NDEBUG
\ No newline at end of file
+
+
+#endif // NDEBUG
@@ -56,12 +56,15 @@ static void erase_description(void);
 static void healthcheck_description(void);
 static void help_description(void);
 static void ignore_description(void);
+static void init_description(void);
 static void inspect_description(void);
 static void label_description(void);
 static void onbuild_description(void);
 static void optimize_description(void);
 static void package_description(void);
 static void reflect_description(void);
+static void session_description(void);
+static void stats_description(void);
 
 static void dit_example(void);
 static void cmd_example(void);
@@ -72,12 +75,15 @@ static void erase_example(void);
 static void healthcheck_example(void);
 static void help_example(void);
 static void ignore_example(void);
+static void init_example(void);
 static void inspect_example(void);
 static void label_example(void);
 static void onbuild_example(void);
 static void optimize_example(void);
 static void package_example(void);
 static void reflect_example(void);
+static void session_example(void);
+static void stats_example(void);
 
 
 extern const char * const cmd_reprs[CMDS_NUM];
@@ -98,6 +104,9 @@ static const int cmd_rearange[CMDS_NUM] = {
     DIT_REFLECT,
     DIT_ERASE,
     DIT_INSPECT,
+    DIT_SESSION,
+    DIT_STATS,
+    DIT_INIT,
     DIT_HELP
 };
 
@@ -113,12 +122,15 @@ static void (* const cmd_helps[HELP_CONTENTS_NUM][CMDS_NUM])(void) = {
         healthcheck_manual,
         help_manual,
         ignore_manual,
+        init_manual,
         inspect_manual,
         label_manual,
         onbuild_manual,
         optimize_manual,
         package_manual,
-        reflect_manual
+        reflect_manual,
+        session_manual,
+        stats_manual
     },
     {
         cmd_description,
@@ -129,12 +141,15 @@ static void (* const cmd_helps[HELP_CONTENTS_NUM][CMDS_NUM])(void) = {
         healthcheck_description,
         help_description,
         ignore_description,
+        init_description,
         inspect_description,
         label_description,
         onbuild_description,
         optimize_description,
         package_description,
-        reflect_description
+        reflect_description,
+        session_description,
+        stats_description
     },
     {
         cmd_example,
@@ -145,12 +160,15 @@ static void (* const cmd_helps[HELP_CONTENTS_NUM][CMDS_NUM])(void) = {
         healthcheck_example,
         help_example,
         ignore_example,
+        init_example,
         inspect_example,
         label_example,
         onbuild_example,
         optimize_example,
         package_example,
-        reflect_example
+        reflect_example,
+        session_example,
+        stats_example
     }
 };
 
@@ -384,6 +402,9 @@ static void dit_manual(void){
         "  reflect        append the contents of some files to "DOCKER_OR_HISTORY"\n"
         "  erase          delete some lines from "DOCKER_OR_HISTORY"\n"
         "  inspect        show some directory trees with details about each file\n"
+        "  session        save the files under construction to resume the container quickly\n"
+        "  stats          show the latency distribution of each phase of the dit commands\n"
+        "  init           prepare the internal files and symbolic links when the container starts\n"
         "  help           show information for some dit commands\n"
         "\n"
         "See 'dit help [OPTION]... [COMMAND]...' for details.\n"
@@ -456,6 +477,8 @@ void erase_manual(void){
         "  -E, --regexp=PATTERN          delete the lines that matches extended regular expression pattern\n"
         "  -N, --numbers=ARG[,ARG]...    delete the lines with the numbers specified by ARGs:\n"
         "                                  NUM (unique specification), [NUM]-[NUM] (range specification)\n"
+        "  -S, --substitute[=EXPR]       edit the lines instead of deleting them, by the substitution EXPR:\n"
+        "                                  /PATTERN/REPLACEMENT/[g] (omitted to revert the last substitution)\n"
         "  -Z, --undoes[=NUM]            delete the lines added within the last NUM (1 by default) times\n"
         "\n"
         "Options for Behavior:\n"
@@ -465,6 +488,7 @@ void erase_manual(void){
         "                                " TARGET_OPTION_ARGS
         "  -H, --history                 show the reflection history in the target files, and exit\n"
         "  -i, --ignore-case             ignore case distinctions in regular expression pattern matching\n"
+        "  -L, --linked                  also delete the lines in history-file that reflected the deleted lines\n"
         "  -m, --max-count=NUM           delete at most NUM lines, counting from the most recently added\n"
         "  -r, --reset                   reset the internal log-files\n"
         "  -s                            suppress repeated empty lines\n"
@@ -491,6 +515,15 @@ void erase_manual(void){
         "  - Information that the number of reflected lines is 0 is retained in the internal log-files,\n"
         "    and '-Z' counts the timing when adding one or more lines to any of the target files as one.\n"
         "  - The internal log-files are not saved across interruptions such as exiting the container.\n"
+        "  - When '-S' is given with EXPR, only the lines where PATTERN matches are edited, in which the\n"
+        "    first matched part, or every matched part if 'g' is given, is replaced with REPLACEMENT.\n"
+        "  - In EXPR, any character other than '\\' can be used as the delimiter instead of '/', and\n"
+        "    '&' and '\\1' to '\\9' in REPLACEMENT refer to the matched part and its subexpressions.\n"
+        "  - REPLACEMENT cannot contain newlines, since each edited line must remain a single line.\n"
+        "  - Since '-S' keeps the number of lines, the internal log-files for '-Z' remain valid, and the\n"
+        "    edited lines are recorded so that '-S' without EXPR can restore or edit them again.\n"
+        "  - '-S' cannot be combined with '-st' or '--blank', and '-S' without EXPR cannot be combined with\n"
+        "    any other Options for Deletion, and does nothing if the edited lines have been changed since.\n"
         "\n"
         "Remarks about Behavior:\n"
         "  - The argument for '--target' or '--blank' "CAN_BE_TRUNCATED".\n"
@@ -505,6 +538,10 @@ void erase_manual(void){
         "  - If you answer 'YES' to above confirmation, delete all the lines, if you answer 'NO', delete\n"
         "    lines you select in the same way as specifying the line numbers with '-N', and if you answer\n"
         "    'QUIT', stop deleting lines for which above confirmation has not yet been completed.\n"
+        "  - Other commands and libdit can edit the target files while the confirmation waits, and if\n"
+        "    they do, the target file is left as it is and it exits with an error.\n"
+        "  - '-L' links only the lines reflected at a previous prompt, and only while the internal\n"
+        "    log-files of both target files are consistent, and it cannot be combined with '-S' or '-h'.\n"
         "\n"
         "We take no responsibility for using regular expression pattern that uses excessive resources.\n"
         "See man page of 'REGEX' for details.\n"
@@ -623,10 +660,35 @@ void ignore_manual(void){
 }
 
 
+void init_manual(void){
+    fputs(
+        HELP_USAGES_STR
+        "  dit init [OPTION]...\n"
+        "Prepare the internal files, their permissions and the symbolic links for each dit command.\n"
+        "\n"
+        HELP_OPTIONS_STR
+        "  -s, --startup-time    record the time elapsed from the start of the container to now\n"
+        "      --help            " HELP_OPTION_DESC
+        "\n"
+        HELP_REMARKS_STR
+        "  - This command is executed by the entrypoint of the container as root, and other users\n"
+        "    can use it only with '-s'.\n"
+        "  - Running it repeatedly leaves the same state as running it once, that is, the settings\n"
+        "    of 'config' and 'ignore' are reset to the default each time.\n"
+        "  - The existing internal files are not truncated, except for those that store the state of\n"
+        "    the previous command line and the samples for 'stats'.\n"
+        "  - No symbolic link is created for this command itself.\n"
+        "  - With '-s', the time is recorded in seconds in '/dit/srv/startup-time'.  It is expected\n"
+        "    to be used when the first prompt is displayed.\n"
+    , stdout);
+}
+
+
 void inspect_manual(void){
     fputs(
         HELP_USAGES_STR
         "  dit inspect [OPTION]... [DIRECTORY]...\n"
+        "  dit inspect --compare DIRECTORY1 DIRECTORY2\n"
         "List information about the files under each specified DIRECTORY in a tree format.\n"
         "\n"
         HELP_OPTIONS_STR
@@ -638,6 +700,11 @@ void inspect_manual(void){
         "  -X                       sort by file extension, alphabetically\n"
         "      --sort=WORD          replace file sorting method:\n"
         "                             name (default), size (-S), extension (-X)\n"
+        "  -z, --compressibility    also list the estimated size of each file when compressed by\n"
+        "                             gzip and zstd, to find incompressible files in a layer\n"
+        "      --compare            list the files that differ between the two DIRECTORYs instead\n"
+        "      --into-archives      also list the entries of each tar, tar.gz and zip file,\n"
+        "                             to find large files in an archive without extracting it\n"
         "      --help               " HELP_OPTION_DESC
         "\n"
         HELP_REMARKS_STR
@@ -647,6 +714,15 @@ void inspect_manual(void){
         "  - User or group name longer than 8 characters are converted to the corresponding ID, and\n"
         "    the ID longer than 8 digits are converted to '#EXCESS' that means it is undisplayable.\n"
         "  - The units of file size are 'k,M,G,T,P,E,Z', which are powers of 1000.\n"
+        "  - The compressed size is estimated by an LZ77 parse over blocks sampled from each file,\n"
+        "    regarding any file that cannot be read and any special file as incompressible.\n"
+        "  - When comparing, each file is marked with '+' (added), '-' (removed), 'C' (contents\n"
+        "    changed) or '?' (unknown), followed by 'M' if its mode or owner changed. Regular files\n"
+        "    of the same size are compared by the hash values of their contents, which are cached\n"
+        "    in '/dit/var/inspect.snap' as long as each file keeps the same inode, mtime and ctime.\n"
+        "    The contents are read, and the cached values are used, only if you can read the file.\n"
+        "  - Each archive is recognized by its extension, and the size of an entry is that before\n"
+        "    compression. A compressed tar file is decompressed through a pipe from 'gzip'.\n"
         "\n"
         "This command is based on the 'ls' command which is a GNU one.\n"
         "See that man page for details.\n"
@@ -673,7 +749,57 @@ void onbuild_manual(void){
 void optimize_manual(void){
     fputs(
         HELP_USAGES_STR
-        "  dit optimize [OPTION]...\n"
+        "  dit optimize [OPTION]... [FILE]\n"
+        "Refactor FILE based on the best practices of Dockerfile, and print the result.\n"
+        "\n"
+        "Passes:\n"
+        "  hygiene        keep each package manager from leaving its cache in the layer, by giving\n"
+        "                   it an option such as '--no-cache' or appending the cleanup to the RUN,\n"
+        "                   unless a later RUN in the stage still uses the cache without refilling it\n"
+        "  consolidate    move the package installations in each stage into one early layer,\n"
+        "                   with the packages sorted and the index updated only once\n"
+        "  slim           find the documentation, locales, static libraries and debug symbols that\n"
+        "                   each instruction created in this container, and propose their cleanup\n"
+        "  link           give '--link' to each COPY in the final stage whose result does not\n"
+        "                   depend on the layers below it, so that a rebase reuses its layer\n"
+        "  parallel       move the independent chains of RUN instructions in the final stage into\n"
+        "                   their own stages, so that BuildKit builds them concurrently\n"
+        "\n"
+        HELP_OPTIONS_STR
+        "  -b, --budget=SIZE    set the size budget of the image to SIZE, or remove it if SIZE is 0\n"
+        "  -i, --in-place       overwrite FILE with the result instead of printing it\n"
+        "  -r, --reset          reset the settings of this command to the defaults\n"
+        "  -s, --slim           append the cleanup proposed by the slim pass to the instructions\n"
+        "      --help           " HELP_OPTION_DESC
+        "\n"
+        HELP_REMARKS_STR
+        "  - If FILE is not specified, it operates on 'Dockerfile.draft'.\n"
+        "  - Each pass can be disabled by setting it to false in '/dit/var/optimize.json'.\n"
+        "  - Each pass reports why it changed or left each line, to standard error unless '-i' is\n"
+        "    specified.  The lines no pass changed are printed exactly as they were.\n"
+        "  - An installation is not moved if it is run conditionally, uses variables, has different\n"
+        "    options, or might be overtaken by a command mentioning any package it installs.  It is\n"
+        "    not moved across a change of the package sources, a switch of users, or a variable\n"
+        "    that the package manager refers to, either, but those after it get their own layer.\n"
+        "  - The bytes each hygiene fix saves are estimated from the caches left in this container,\n"
+        "    only for the package manager recorded in '/dit/etc/package_manager', pip and npm.\n"
+        "  - The slim pass attributes each file to the instruction whose command line last changed it,\n"
+        "    by comparing its change time with the times recorded in '/dit/var/reflect.log'.  Static\n"
+        "    libraries are never removed by '-s', since a later build may link them.\n"
+        "  - The parallel pass regards an instruction as depending on an earlier one if it mentions a\n"
+        "    path or runs an executable the earlier one left, or if the earlier one left libraries or\n"
+        "    headers.  Each moved chain is built from the final stage so far, and the paths it left\n"
+        "    are copied back.  The critical path is estimated from the durations in the reflect log.\n"
+        "  - The link pass leaves COPY if the directories on the way to its destination are symbolic\n"
+        "    links, or are not root-owned with mode 755 in this container, or if '--chown' names a\n"
+        "    user that an earlier RUN may create.  The syntax directive is inserted if missing.\n"
+        "  - While the size budget is set, the image size is projected from the files in this container\n"
+        "    after printing the result, with the instructions adding the most bytes and their gzip\n"
+        "    estimates.  It exits with status 1 if the projection exceeds the budget, and warns if it\n"
+        "    uses more than 90% of it.  The prompt also shows the remaining budget as of the last check,\n"
+        "    as 'b:812.4M', or as 'b:~812.4M' once any line has been reflected since.\n"
+        "  - SIZE is a number optionally followed by a unit such as 'MB' or 'GiB', where the units\n"
+        "    without 'i' are powers of 1000 as in the reports of this command.\n"
     , stdout);
 }
 
@@ -721,6 +847,70 @@ void reflect_manual(void){
 }
 
 
+void session_manual(void){
+    fputs(
+        HELP_USAGES_STR
+        "  dit session [OPTION]... SUBCOMMAND\n"
+        "Save the files changed by the command lines so far, or restore them when the container starts.\n"
+        "\n"
+        "Subcommands:\n"
+        "  checkpoint    write the changed files and the state of history-file to '.dit_checkpoint'\n"
+        "  resume        restore the files, and print the command lines that remain to be replayed\n"
+        "\n"
+        HELP_OPTIONS_STR
+        "      --help    " HELP_OPTION_DESC
+        "\n"
+        HELP_REMARKS_STR
+        "  - SUBCOMMAND "CAN_BE_TRUNCATED".\n"
+        "  - The files whose status has changed since the container started are saved with their\n"
+        "    owners, permissions and modification times, except those under '/dit' and those on the\n"
+        "    other filesystems.  Only regular files, directories and symbolic links are saved.\n"
+        "  - Each changed directory is saved with the names of its entries, so that the files deleted\n"
+        "    before the checkpoint are deleted again on resume.\n"
+        "  - 'checkpoint' can only be run by root, since it reads every changed file.  If the default\n"
+        "    user of the container is not root, run it through a command such as 'sudo' if available.\n"
+        "  - The checkpoint is written by root to the directory shared with the host environment,\n"
+        "    readable only by its owner, and it is replaced only when the whole checkpoint has been written.\n"
+        "  - '.dit_checkpoint' is listed in '.dockerignore' only when 'dit init' creates that file,\n"
+        "    so add it yourself to an existing one to keep the checkpoint out of the build context.\n"
+        "  - 'resume' is executed by the entrypoint of the container as root.  If the lines covered by\n"
+        "    the checkpoint have been deleted from history-file, the checkpoint is ignored and all the\n"
+        "    lines are replayed as before.\n"
+        "  - Unless the checkpoint is owned by root and writable only by it, it is ignored and all the\n"
+        "    lines are replayed.  No file is restored through a symbolic link on its path.\n"
+        "  - On resume, the exported variables and the working directory at the time of the checkpoint\n"
+        "    are restored before the remaining lines, but the other shell variables are not.\n"
+    , stdout);
+}
+
+
+void stats_manual(void){
+    fputs(
+        HELP_USAGES_STR
+        "  dit stats [OPTION]... [COMMAND]...\n"
+        "Show the quantiles of the elapsed time of each phase of the specified dit COMMANDs.\n"
+        "\n"
+        HELP_OPTIONS_STR
+        "  -H, --histogram    also show the distribution of each phase in the style of HdrHistogram\n"
+        "  -r, --reset        discard all the samples recorded so far\n"
+        "      --help         " HELP_OPTION_DESC
+        "\n"
+        HELP_REMARKS_STR
+        "  - If no COMMANDs are specified, all the dit commands with any samples are shown.\n"
+        "  - Each COMMAND "CAN_BE_TRUNCATED".\n"
+        "  - Every dit command appends the elapsed time and the number of bytes read and written\n"
+        "    of its phases to '/dit/srv/stats.ring', which is emptied when the container starts.\n"
+        "  - Only the latest 16384 samples are kept, and the phase 'main' covers the whole command.\n"
+        "  - Each quantile is the upper bound of the bucket that contains it, where each power\n"
+        "    of 2 microseconds is divided into 8 buckets, so it is accurate to within 12.5%.\n"
+        "  - To record every phase with its arguments, set the environment variable 'DIT_TRACE' to\n"
+        "    the path of the file, in which the events are appended in Chrome trace-event format.\n"
+        "  - In that case, the number of allocations, the peak of the allocated bytes and the maximum\n"
+        "    resident set size of the command are also appended as the event named 'memory'.\n"
+    , stdout);
+}
+
+
 
 
 /******************************************************************************
@@ -764,6 +954,10 @@ static void ignore_description(void){
     puts("Edit the conditions when commands are not reflected in "DOCKER_OR_HISTORY", individually.");
 }
 
+static void init_description(void){
+    puts("Prepare the internal files and symbolic links of this tool when the container starts.");
+}
+
 static void inspect_description(void){
     puts("List information about the files under some directories in a tree format.");
 }
@@ -788,6 +982,14 @@ static void reflect_description(void){
     puts("Append the contents of some files to "DOCKER_OR_HISTORY".");
 }
 
+static void session_description(void){
+    puts("Save the files changed by the command lines so far, to resume the container without replaying them.");
+}
+
+static void stats_description(void){
+    puts("Show the latency distribution of each phase of the dit commands since the container started.");
+}
+
 
 
 
@@ -851,6 +1053,7 @@ static void erase_example(void){
         "dit erase -dh                              Delete the lines added just before.\n"
         "dit erase -diy -E '^ONBUILD[[:space:]]'    Delete all ONBUILD instructions from Dockerfile.\n"
         "dit erase -hm10 -N -                       Delete last 10 lines from history-file.\n"
+        "dit erase -dy -S'/=[0-9.]+//g' -E ^RUN     Unpin the package versions in RUN instructions.\n"
         "dit erase -v --target both                 Display the previous deleted lines.\n"
     , stdout);
 }
@@ -886,12 +1089,21 @@ static void ignore_example(void){
 }
 
 
+static void init_example(void){
+    fputs(
+        "dit init       Prepare all the internal files in the same way as the entrypoint of the container.\n"
+        "dit init -s    Record how long it took to display the first prompt after the container started.\n"
+    , stdout);
+}
+
+
 static void inspect_example(void){
     fputs(
         "dit inspect -S                 List the files under the current directory sorted by their size.\n"
         "dit inspect --sort=ext /dit    List the files under '/dit' sorted by their extension.\n"
         "dit inspect -CF /dev           List the files under '/dev', decorating their name.\n"
         "dit inspect /bin /sbin         List the files under '/bin' and '/sbin' respectively.\n"
+        "dit inspect -Sz /usr           List the files under '/usr' with their estimated compressed size.\n"
     , stdout);
 }
 
@@ -918,10 +1130,11 @@ static void onbuild_example(void){
 
 static void optimize_example(void){
     fputs(
-        "dit optimize \n"
-        "dit optimize \n"
-        "dit optimize \n"
-        "dit optimize \n"
+        "dit optimize                  Print the result of optimizing 'Dockerfile.draft'.\n"
+        "dit optimize -i               Optimize 'Dockerfile.draft' in place.\n"
+        "dit optimize -is              Optimize it in place, also removing the files no one needs.\n"
+        "dit optimize -b 1.5GB         Print the result, and check the image against a budget of 1.5 GB.\n"
+        "dit optimize Dockerfile.dev   Print the result of optimizing 'Dockerfile.dev'.\n"
     , stdout);
 }
 
@@ -946,6 +1159,23 @@ static void reflect_example(void){
 }
 
 
+static void session_example(void){
+    fputs(
+        "dit session checkpoint    Save the files changed since the container started.\n"
+        "dit session resume        Restore the saved files, and print the command lines to replay.\n"
+    , stdout);
+}
+
+
+static void stats_example(void){
+    fputs(
+        "dit stats               Show the quantiles of the elapsed time of all the dit commands.\n"
+        "dit stats -H refl er    Show the distributions for 'reflect' and 'erase' in detail.\n"
+        "dit stats -r            Discard all the samples to measure only the subsequent commands.\n"
+    , stdout);
+}
+
+
 
 
 #ifndef NDEBUG
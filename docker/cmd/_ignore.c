@@ -18,12 +18,6 @@
 #define IGNORE_FILE_D "/dit/var/ignore.json.dock"
 #define IGNORE_FILE_H "/dit/var/ignore.json.hist"
 
-#ifdef NDEBUG
-    #define IG_WRITER_FLAG  YYJSON_WRITE_NOFLAG
-#else
-    #define IG_WRITER_FLAG  YYJSON_WRITE_PRETTY
-#endif
-
 #define yyjson_mut_arr_add_arg(no_arg, mdoc, marr, arg) \
     ((no_arg) ? yyjson_mut_arr_add_null(mdoc, marr) : yyjson_mut_arr_add_str(mdoc, marr, arg))
 
@@ -84,13 +78,10 @@ static bool append_optarg(ig_conds *data, const optarg_info *p_info, const char
 static bool append_first_args(ig_conds *data, int argc, char **argv, ig_opts *opt);
 
 static void display_ignore_set(int argc, char **argv);
+static bool write_ignore_base(const char *file_name, int target_id);
 static bool edit_ignore_set(yyjson_mut_doc *mdoc, int argc, char **argv, const ig_opts *opt);
 static bool append_ignore_set(yyjson_mut_doc *mdoc, const ig_conds *data, const ig_opts *opt);
 
-static yyjson_val *get_setting_entity(yyjson_val *iobj, const char *name, size_t len);
-static bool check_if_contained(const char *target, yyjson_val *ival);
-
-
 extern const char * const target_args[ARGS_NUM];
 
 
@@ -111,17 +102,23 @@ static const char * const conds_keys[IG_CONDITIONS_NUM] = {
     "invert_flag"
 };
 
-/** array of integers representing whether a long option takes an argument */
-static const int has_arg_table[3] = { no_argument, required_argument, optional_argument };
-
 
 /** boolean value to prevent display confusion in certain cases when some errors occur */
 static bool no_suggestion = false;
 
 
-/** immutable JSON data that is the contents of the ignore-file (to use 'check_if_ignored' as callback) */
+/** immutable JSON data that is the contents of the ignore-file being edited, unless the default one is used */
 static yyjson_doc *idoc = NULL;
 
+/** root of the ignore set being displayed or edited, which is either in 'idoc' or in the compiled tables */
+static yyjson_val *iroot = NULL;
+
+/** handle of the dit library holding the ignore-file (to use 'check_if_ignored' as callback) */
+static dit_ctx *ig_ctx = NULL;
+
+/** which ignore-file the handle holds, 1 (targets Dockerfile) or 0 (targets history-file) */
+static int ig_target_id;
+
 
 
 
@@ -329,7 +326,12 @@ static int ignore_contents(int argc, char **argv, ig_opts *opt){
             assert(offset == ((bool) offset));
             file_name = ignore_files[opt->reset_flag][offset];
 
-            if ((idoc = yyjson_read_file(file_name, 0, NULL, &err))){
+            if (opt->reset_flag)
+                iroot = (yyjson_val *) ignore_tables[offset].vals;
+            else if ((idoc = yyjson_read_file(file_name, 0, &trace_alc, &err)))
+                iroot = yyjson_doc_get_root(idoc);
+
+            if (iroot){
                 mdoc = NULL;
                 success = true;
 
@@ -345,23 +347,27 @@ static int ignore_contents(int argc, char **argv, ig_opts *opt){
 
                     if (argc <= 0){
                         assert(opt->reset_flag);
-                        yyjson_write_file(file_name, idoc, IG_WRITER_FLAG, NULL, NULL);
+                        success = write_ignore_base(file_name, offset);
                     }
                     else {
-                        mdoc = yyjson_doc_mut_copy(idoc, NULL);
+                        if (idoc)
+                            mdoc = yyjson_doc_mut_copy(idoc, &trace_alc);
+                        else if ((mdoc = yyjson_mut_doc_new(&trace_alc)))
+                            yyjson_mut_doc_set_root(mdoc, yyjson_val_mut_copy(mdoc, iroot));
                         success = false;
                     }
                 }
 
                 yyjson_doc_free(idoc);
                 idoc = NULL;
+                iroot = NULL;
 
                 if (mdoc){
                     success = (! opt->additional_settings) ?
                         edit_ignore_set(mdoc, argc, argv, opt) : append_ignore_set(mdoc, &data, opt);
 
                     if (success)
-                        yyjson_mut_write_file(file_name, mdoc, IG_WRITER_FLAG, NULL, NULL);
+                        yyjson_mut_write_file(file_name, mdoc, IG_WRITER_FLAG, &trace_alc, NULL);
                     yyjson_mut_doc_free(mdoc);
                 }
 
@@ -432,7 +438,7 @@ static bool parse_additional_settings(ig_conds *data, int argc, char **argv, ig_
                             goto next;
                     }
                 }
-                if (! (data->pool || (data->pool = yyjson_mut_doc_new(NULL))))
+                if (! (data->pool || (data->pool = yyjson_mut_doc_new(&trace_alc))))
                     return false;
 
                 switch (phase){
@@ -875,12 +881,12 @@ static bool append_first_args(ig_conds *data, int argc, char **argv, ig_opts *op
  * @note the order of command names specified in non-optional arguments make sense.
  */
 static void display_ignore_set(int argc, char **argv){
-    assert(idoc);
+    assert(iroot);
     assert(argv);
 
     size_t size;
 
-    if ((size = yyjson_obj_size(idoc->root))){
+    if ((size = yyjson_obj_size(iroot))){
         const char *key;
         size_t remain;
         yyjson_val *ikey;
@@ -895,7 +901,7 @@ static void display_ignore_set(int argc, char **argv){
             if (argc && (! (key = *(argv++))))
                 continue;
 
-            for (remain = size, ikey = idoc->root + 1; remain--; ikey = unsafe_yyjson_get_next(ikey + 1)){
+            for (remain = size, ikey = iroot + 1; remain--; ikey = unsafe_yyjson_get_next(ikey + 1)){
                 assert(yyjson_is_str(ikey));
 
                 if (argc && strcmp(key, yyjson_get_str(ikey)))
@@ -923,6 +929,39 @@ static void display_ignore_set(int argc, char **argv){
 
 
 
+/**
+ * @brief reset the ignore-file by writing the default contents compiled into dit as they are.
+ *
+ * @param[in]  file_name  name of the ignore-file
+ * @param[in]  target_id  1 (targets Dockerfile), 0 (targets history-file)
+ * @return bool  successful or not
+ */
+static bool write_ignore_base(const char *file_name, int target_id){
+    assert(file_name);
+    assert(target_id == ((bool) target_id));
+
+    const ignore_table *table;
+    FILE *fp;
+    int errid = 0;
+
+    table = ignore_tables + target_id;
+
+    if ((fp = fopen(file_name, "w"))){
+        if (fwrite(table->text, sizeof(char), table->text_len, fp) != table->text_len)
+            errid = errno;
+        if (fclose(fp) && (! errid))
+            errid = errno;
+    }
+    else
+        errid = errno;
+
+    if (errid)
+        xperror_standards(file_name, errid);
+
+    return (! errid);
+}
+
+
 /**
  * @brief edit set of commands in the ignore-file.
  *
@@ -1052,15 +1091,29 @@ static bool append_ignore_set(yyjson_mut_doc *mdoc, const ig_conds *data, const
  * @param[in]  original  whether to use the original ignore-file
  * @return bool  successful or not
  *
+ * @note the original ignore-file is not read, since its contents are compiled into dit.
+ *
  * @attention the JSON data must be properly unloaded when finished using.
  */
 bool load_ignore_file(int target_id, int original){
-    assert(! idoc);
+    assert(! ig_ctx);
     assert(target_id == ((bool) target_id));
     assert(original == ((bool) original));
 
-    idoc = yyjson_read_file(ignore_files[original][target_id], 0, NULL, NULL);
-    return (bool) idoc;
+    trace_scope scope;
+
+    trace_begin(&scope, TRACE_LOAD_IGNORE_FILE, ignore_files[original][target_id]);
+
+    if ((ig_ctx = dit_open(NULL)) && (original ?
+        dit_use_ignore_base(ig_ctx, target_id) : dit_load_ignore(ig_ctx, target_id, ignore_files[0][target_id]))){
+        dit_close(ig_ctx);
+        ig_ctx = NULL;
+    }
+    ig_target_id = target_id;
+
+    trace_end(&scope);
+
+    return (bool) ig_ctx;
 }
 
 
@@ -1069,8 +1122,8 @@ bool load_ignore_file(int target_id, int original){
  *
  */
 void unload_ignore_file(void){
-    yyjson_doc_free(idoc);
-    idoc = NULL;
+    dit_close(ig_ctx);
+    ig_ctx = NULL;
 }
 
 
@@ -1080,203 +1133,173 @@ void unload_ignore_file(void){
  * @brief check if the execution of the specified command should be ignored.
  *
  * @param[in]  argc  the number of command line arguments
- * @param[out] argv  array of strings that are command line arguments
+ * @param[in]  argv  array of strings that are command line arguments
  * @return bool  the resulting boolean
  *
- * @note the contents of the ignore-file are used as much as possible while excluding invalid data.
+ * @note the check itself is done by 'dit_check_ignored', which never permutes the arguments.
  */
 bool check_if_ignored(int argc, char **argv){
     assert(argc > 0);
     assert(argv);
 
     bool result = false;
+    trace_scope scope;
 
-    if (idoc){
-        char *key;
-        yyjson_val *ival;
-        yyjson_obj_iter iter;
+    trace_begin(&scope, TRACE_CHECK_IF_IGNORED, *argv);
 
-        for (key = *argv;; key = strrchr(key, '/'))
-            if ((ival = get_setting_entity(idoc->root, key, strlen(key))))
-                break;
-            else if (! *key)
-                goto exit;
+    if (ig_ctx && dit_check_ignored(ig_ctx, ig_target_id, argc, argv, &result))
+        result = false;
 
-        if (yyjson_obj_iter_init(ival, &iter)){
-            int i, c;
-            yyjson_val *conds[IG_CONDITIONS_NUM];
-            const char *name;
-            size_t size = 1, idx, long_opts_num = 0;
-            bool no_short_opts = true;
-            uint64_t colons;
-            unsigned int detect_anymatch, invert_flag, matched = false;
+    trace_end(&scope);
+    return result;
+}
 
-            for (i = 0; i < IG_CONDITIONS_NUM; i++)
-                conds[i] = yyjson_obj_iter_get(&iter, conds_keys[i]);
 
-            ival = conds[IG_SHORT_OPTS];
 
-            if ((name = yyjson_get_str(ival)) && (! parse_short_opts(name))){
-                size += yyjson_get_len(ival);
-                no_short_opts = false;
-            }
-            else
-                name = "";
 
-            char short_opts[size + 1];
-            *short_opts = ':';
-            memcpy((short_opts + 1), name, size);
+#ifndef NDEBUG
 
-            ival = conds[IG_LONG_OPTS];
-            size = yyjson_obj_size(ival);
 
-            if (size > INT_MAX)
-                size = INT_MAX;
+/******************************************************************************
+    * Unit Test Functions
+******************************************************************************/
 
-            struct option long_opts[size + 1];
-            memset(long_opts, 0, (sizeof(struct option) * (size + 1)));
 
-            for (ival++; size--; ival = unsafe_yyjson_get_next(ival)){
-                if ((! (name = yyjson_get_str(ival++))) || (! *name) || strpbrk(name, ":=?") ||
-                    (! yyjson_is_uint(ival)) || ((colons = yyjson_get_uint(ival)) >= 3))
-                        continue;
+void ignore_test(void){
+    fputs("ignore test\n", stdout);
+}
 
-                for (idx = 0; (idx < long_opts_num) && strcmp(name, long_opts[idx].name); idx++);
 
-                if (idx == long_opts_num){
-                    long_opts_num++;
-                    long_opts[idx].name = name;
-                    long_opts[idx].has_arg = has_arg_table[colons];
-                }
-            }
+/******************************************************************************
+    * Benchmark Functions
+******************************************************************************/
 
-            optind = 0;
-            ival = conds[IG_OPTARGS];
 
-            detect_anymatch = yyjson_get_bool(conds[IG_DETECT_ANYMATCH]);
-            invert_flag = yyjson_get_bool(conds[IG_INVERT_FLAG]);
-            result = detect_anymatch ^ invert_flag;
+/** Data type for storing one of the command lines checked in the benchmark */
+typedef struct {
+    int argc;
+    char *argv[8];
+} bench_cmdline;
 
-            while ((c = getopt_long(argc, argv, short_opts, long_opts, &i)) >= 0){
-                switch (c){
-                    case ':':
-                    case '?':
-                        if ((no_short_opts && (! long_opts_num)) || detect_anymatch)
-                            continue;
-                        assert(detect_anymatch == matched);
-                        goto exit;
-                    case 0:
-                        name = long_opts[i].name;
-                        size = strlen(name);
-                        matched = (long_opts[i].has_arg == no_argument);
-                        break;
-                    default:
-                        name = strchr(short_opts, c);
-                        size = 1;
-                        matched = (name[1] != ':');
-                }
 
-                assert(name && *name);
-                assert(size);
+static void gen_command_lines(bench_input *input);
+static void check_if_ignored_bench(const bench_input *input);
 
-                if (! matched)
-                    matched = check_if_contained(optarg, get_setting_entity(ival, name, size));
 
-                if (detect_anymatch == matched)
-                    goto exit;
-            }
 
-            argc -= optind;
-            argv += optind;
 
-            ival = conds[IG_FIRST_ARGS];
-            name = (argc > 0) ? *argv : NULL;
+void ignore_bench(void){
+    if (load_ignore_file(1, true)){
+        do_bench(check_if_ignored_bench, gen_command_lines);
+        unload_ignore_file();
+    }
+    else
+        fputs("Skipped 'check_if_ignored_bench': cannot use the default ignore set\n\n", stderr);
+}
 
-            if (yyjson_is_arr(ival) && (detect_anymatch == check_if_contained(name, ival)))
-                goto exit;
 
-            ival = conds[IG_MAX_ARGC];
 
-            if (yyjson_is_uint(ival) && (detect_anymatch == (argc <= yyjson_get_uint(ival))))
-                goto exit;
-        }
 
-        result = (! result);
+static void gen_command_lines(bench_input *input){
+    const bench_cmdline cmdlines[] = {
+        { 3, { "ls", "-l", "/tmp" } },
+        { 2, { "cd", ".." } },
+        { 5, { "apt-get", "install", "-y", "--no-install-recommends", "curl" } },
+        { 2, { "/usr/bin/git", "status" } },
+        { 4, { "grep", "-rn", "pattern", "." } },
+        { 2, { "echo", "hello" } },
+        { 4, { "useradd", "-m", "-s", "/bin/sh" } },
+        { 3, { "history", "-c", "-w" } },
+        { 2, { "unknown-command", "arg" } },
+        { 3, { "declare", "-x", "VAR=value" } }
+    };
+    const size_t size = 64;
+
+    bench_cmdline *targets;
+    size_t i;
+    int j;
+
+    assert((targets = (bench_cmdline *) malloc(sizeof(bench_cmdline) * size)));
+    assert((input->extra = malloc(sizeof(char *) * 8)));
+
+    for (i = 0; i < size; i++){
+        memcpy((targets + i), (cmdlines + rand() % numof(cmdlines)), sizeof(bench_cmdline));
+
+        for (j = 0; j < targets[i].argc; j++)
+            input->bytes += strlen(targets[i].argv[j]) + 1;
     }
 
-exit:
-    return result;
+    input->data = targets;
+    input->items = size;
 }
 
 
+static void check_if_ignored_bench(const bench_input *input){
+    const bench_cmdline *targets;
+    char **argv;
+    size_t i;
 
+    targets = (const bench_cmdline *) input->data;
+    argv = (char **) input->extra;
 
-/**
- * @brief get the entity of the setting by following the link via the key of the JSON object.
- *
- * @param[in]  iobj  immutable JSON object
- * @param[in]  name  the first key (may not be null-terminated)
- * @param[in]  len  the length of the first key
- * @return yyjson_val*  the resulting immutable JSON value or NULL
- */
-static yyjson_val *get_setting_entity(yyjson_val *iobj, const char *name, size_t len){
-    assert(iobj);
-    assert(name);
+    // copy the arguments each time, as the callers of 'check_if_ignored' pass their own arrays
+    for (i = 0; i < input->items; i++){
+        memcpy(argv, targets[i].argv, sizeof(targets[i].argv));
+        bench_sink += check_if_ignored(targets[i].argc, argv);
+    }
+}
 
-    yyjson_val *ival;
 
-    while ((ival = yyjson_obj_getn(iobj, name, len)) && (name = yyjson_get_str(ival)))
-        len = yyjson_get_len(ival);
 
-    assert(! yyjson_is_str(ival));
 
-    return ival;
-}
+/******************************************************************************
+    * Fuzzing Functions
+******************************************************************************/
 
 
-/**
- * @brief check if the passed string is contained within the JSON array of expected strings.
- *
- * @param[in]  target  target string
- * @param[in]  ival  JSON array of expected strings
- * @return bool  the resulting boolean
- */
-static bool check_if_contained(const char *target, yyjson_val *ival){
-    yyjson_arr_iter iter;
+static void check_if_ignored_fuzz(const char *input, size_t len);
 
-    if (yyjson_arr_iter_init(ival, &iter)){
-        const char *name;
 
-        do {
-            if (! (ival = yyjson_arr_iter_next(&iter)))
-                return false;
 
-            if (yyjson_is_null(ival)){
-                if (! target)
-                    break;
-            }
-            else if (target && (name = yyjson_get_str(ival)) && (! strcmp(target, name)))
-                break;
-        } while (true);
-    }
 
-    return true;
-}
+void ignore_fuzz(void){
+    const char * const cmdline_seeds[] = {
+        "ls -l /tmp",
+        "apt-get install -y --no-install-recommends curl",
+        "/usr/bin/git status",
+        "useradd -m -s /bin/sh",
+        "history -c -w",
+        "declare -x VAR=value",
+        "wget -O - https://example.com/"
+    };
 
+    if (load_ignore_file(1, true)){
+        do_fuzz(check_if_ignored_fuzz, cmdline_seeds, " ");
+        unload_ignore_file();
+    }
+    else
+        fputs("Skipped 'check_if_ignored_fuzz': cannot use the default ignore set\n\n", stderr);
+}
 
 
 
-#ifndef NDEBUG
 
+static void check_if_ignored_fuzz(const char *input, size_t len){
+    char buf[len + 1], *argv[len / 2 + 2];
+    int argc = 0;
 
-/******************************************************************************
-    * Unit Test Functions
-******************************************************************************/
+    // split the input into the arguments at the spaces, as the shell does
+    memcpy(buf, input, (sizeof(char) * (len + 1)));
 
+    for (char *token = strtok(buf, " "); token; token = strtok(NULL, " "))
+        argv[argc++] = token;
+    argv[argc] = NULL;
 
-void ignore_test(void){
-    fputs("ignore test\n", stdout);
+    if (argc)
+        bench_sink += check_if_ignored(argc, argv);
 }
 
 
-#endif // NDEBUG
\ No newline at end of file
+
+
+#endif // NDEBUG
@@ -0,0 +1,684 @@
+/**
+ * @file _init.c
+ *
+ * Copyright (c) 2023 Tsukasa Inada
+ *
+ * @brief Described the dit command 'init', that prepares the internal files when the container starts.
+ * @author Tsukasa Inada
+ * @date 2023/10/02
+ *
+ * @note All the processing formerly done by the entrypoint with several external commands is done in one process.
+ * @note Running it repeatedly leaves the same state as running it once.
+ */
+
+#include "main.h"
+
+#define DIT_ROOT_DIR "/dit"
+#define DIT_SYMLINK_DIR "/usr/local/bin"
+
+#define DOCKER_FILE_BASE "/dit/etc/Dockerfile.base"
+#define STARTUP_TIME_FILE "/dit/srv/startup-time"
+
+#define INIT_CONTAINER_PID_STAT "/proc/1/stat"
+
+#define INIT_OPEN_FLAGS  (O_WRONLY | O_CREAT | O_NOCTTY | O_NONBLOCK | O_CLOEXEC)
+#define INIT_DIR_FLAGS  (O_RDONLY | O_DIRECTORY | O_CLOEXEC)
+
+
+/** Data type for storing the information about the directories under '/dit' */
+typedef struct {
+    const char *name;              /** directory name */
+    const char * const *files;     /** array of the names of the files to be created under the directory */
+    size_t files_num;              /** array size */
+    mode_t file_mode;              /** permissions of the files to be created */
+    mode_t dir_mode;               /** permissions of the directory after initialization */
+} init_dir;
+
+
+static int parse_opts(int argc, char **argv, bool *opt);
+static int do_init(void);
+static int record_startup_time(void);
+
+static bool check_base_image(int mnt_fd);
+static int write_file_at(int dirfd, const char *name, const char *contents, size_t size);
+static bool prepare_files(int dit_fd, const init_dir *dir);
+
+static int chmod_exec_files(int pwdfd, const char *name, bool isdir);
+static int chmod_read_files(int pwdfd, const char *name, bool isdir);
+
+static bool create_symlinks(int bin_fd);
+static int reset_internal_files(int srv_fd);
+
+
+extern const char * const cmd_reprs[CMDS_NUM];
+
+
+/** array of the names of the files in the directory shared with the host environment */
+static const char * const mnt_files[] = {
+    ".dit_history",
+    ".dockerignore",
+    "Dockerfile",
+    "Dockerfile.draft"
+};
+
+/** array of the names of the files that are recreated every time the container starts */
+static const char * const srv_files[] = {
+    "command-start",
+    "convert-result.dock",
+    "convert-result.hist",
+    "erase-result.dock",
+    "erase-result.hist",
+    "last-command-line",
+    "last-exit-status",
+    "last-history-number",
+    "reflect-report.prov",
+    "reflect-report.real",
+    "size-projection",
+    "startup-time",
+    "stats.ring"
+};
+
+/** array of the names of the files that store the settings and logs of this tool */
+static const char * const var_files[] = {
+    "cmd.log",
+    "config.stat",
+    "erase.log.dock",
+    "erase.log.hist",
+    "ignore.json.dock",
+    "ignore.json.hist",
+    "ignore.list.args",
+    "inspect.snap",
+    "line.map.dock",
+    "line.map.hist",
+    "optimize.json",
+    "reflect.log"
+};
+
+
+/** array of the directories that are prepared in the order of the elements */
+static const init_dir init_dirs[] = {
+    { "mnt", mnt_files, numof(mnt_files), 0666, 0        },
+    { "bin", NULL,      0,                0,    0555     },
+    { "etc", NULL,      0,                0,    0555     },
+    { "srv", srv_files, numof(srv_files), 0666, 0555     },
+    { "var", var_files, numof(var_files), 0666, 0555     }
+};
+
+
+/** the contents of '.dockerignore' created when it is empty */
+static const char dockerignore_contents[] = ".dit_checkpoint\n.dit_history\nDockerfile.draft\n";
+
+
+
+
+/******************************************************************************
+    * Local Main Interface
+******************************************************************************/
+
+
+/**
+ * @brief prepare the internal files of this tool when the container starts.
+ *
+ * @param[in]  argc  the number of command line arguments
+ * @param[out] argv  array of strings that are command line arguments
+ * @return int  command's exit status
+ *
+ * @note treated like a normal main function.
+ */
+int init(int argc, char **argv){
+    int i, exit_status = FAILURE;
+    bool startup_flag;
+
+    if (! (i = parse_opts(argc, argv, &startup_flag))){
+        if (argc <= optind)
+            exit_status = startup_flag ? record_startup_time() : do_init();
+        else
+            xperror_too_many_args(0);
+    }
+    else if (i > 0)
+        exit_status = SUCCESS;
+
+    if (exit_status){
+        if (exit_status < 0){
+            exit_status = FAILURE;
+            xperror_internal_file();
+        }
+        xperror_suggestion(true);
+    }
+    return exit_status;
+}
+
+
+/**
+ * @brief parse optional arguments.
+ *
+ * @param[in]  argc  the number of command line arguments
+ * @param[out] argv  array of strings that are command line arguments
+ * @param[out] opt  variable to store boolean representing whether to record the startup time
+ * @return int  0 (parse success), 1 (normally exit) or -1 (error exit)
+ *
+ * @note the arguments are expected to be passed as-is from main function.
+ */
+static int parse_opts(int argc, char **argv, bool *opt){
+    assert(opt);
+
+    const char *short_opts = "s";
+
+    const struct option long_opts[] = {
+        { "startup-time", no_argument, NULL, 's' },
+        { "help",         no_argument, NULL,  1  },
+        {  0,              0,           0,    0  }
+    };
+
+    *opt = false;
+
+    int c;
+
+    while ((c = getopt_long(argc, argv, short_opts, long_opts, NULL)) >= 0)
+        switch (c){
+            case 's':
+                *opt = true;
+                break;
+            case 1:
+                init_manual();
+                return NORMALLY_EXIT;
+            default:
+                return ERROR_EXIT;
+        }
+
+    return SUCCESS;
+}
+
+
+
+
+/******************************************************************************
+    * Initialization Part
+******************************************************************************/
+
+
+/**
+ * @brief prepare all the internal files, the permissions and the symbolic links.
+ *
+ * @return int  0 (success), 1 (environment error) or -1 (unexpected error)
+ *
+ * @note each step is performed relative to the file descriptor of the directory, using '*at' syscalls.
+ * @note the processing order follows the one in which the entrypoint used to perform it.
+ */
+static int do_init(void){
+    int dit_fd = -1, mnt_fd = -1, srv_fd = -1, bin_fd = -1, exit_status = FAILURE;
+    mode_t old_umask;
+    size_t i;
+    const char *errpath;
+
+    if (getuid()){
+        xperror_standards(NULL, EPERM);
+        goto exit;
+    }
+
+    if ((dit_fd = open(DIT_ROOT_DIR, INIT_DIR_FLAGS)) == -1){
+        xperror_standards(DIT_ROOT_DIR, errno);
+        goto exit;
+    }
+
+    if ((mnt_fd = openat(dit_fd, "mnt", INIT_DIR_FLAGS)) == -1){
+        xperror_individually("the directory to be bound is not specified");
+        goto exit;
+    }
+
+    if (! check_base_image(mnt_fd)){
+        xperror_individually("base-image inconsistency with the contents of 'Dockerfile.draft'");
+        goto exit;
+    }
+
+    exit_status = UNEXPECTED_ERROR;
+
+    struct stat file_stat;
+
+    // written only when it is empty, so that the lines the user has removed are never added back
+    if (fstatat(mnt_fd, ".dockerignore", &file_stat, 0) || (! file_stat.st_size))
+        if (write_file_at(mnt_fd, ".dockerignore", dockerignore_contents, (sizeof(dockerignore_contents) - 1)))
+            goto exit;
+
+    if ((bin_fd = open(DIT_SYMLINK_DIR, INIT_DIR_FLAGS)) == -1)
+        goto exit;
+
+    errpath = DIT_SYMLINK_DIR "/dit";
+
+    if (fchownat(bin_fd, "dit", 0, (gid_t) -1, 0) || fchmodat(bin_fd, "dit", (S_ISUID | 0111), 0))
+        goto errexit;
+
+    errpath = DIT_ROOT_DIR;
+
+    if ((! walkat(dit_fd, "bin", true, chmod_exec_files)) || (! walkat(dit_fd, "etc", true, chmod_read_files)))
+        goto errexit;
+
+    old_umask = umask(0);
+
+    for (i = 0; i < numof(init_dirs); i++)
+        if (! prepare_files(dit_fd, (init_dirs + i)))
+            break;
+
+    umask(old_umask);
+
+    if (i < numof(init_dirs))
+        goto exit;
+
+    errpath = REGCACHE_DIR;
+
+    // the regex cache is written by the setuid binary, so its directory is never left writable by the users
+    if ((mkdir(REGCACHE_DIR, 0755) && (errno != EEXIST)) || chmod(REGCACHE_DIR, 0755))
+        goto errexit;
+
+    errpath = DIT_ROOT_DIR;
+
+    if (fchmod(dit_fd, 0555))
+        goto errexit;
+
+    for (i = 0; i < numof(init_dirs); i++)
+        if (init_dirs[i].dir_mode && fchmodat(dit_fd, init_dirs[i].name, init_dirs[i].dir_mode, 0))
+            goto errexit;
+
+    errpath = DIT_SYMLINK_DIR;
+
+    if (! create_symlinks(bin_fd))
+        goto errexit;
+
+    if ((srv_fd = openat(dit_fd, "srv", INIT_DIR_FLAGS)) != -1)
+        exit_status = reset_internal_files(srv_fd);
+
+    goto exit;
+
+errexit:
+    xperror_standards(errpath, errno);
+exit:
+    if (srv_fd != -1)
+        close(srv_fd);
+    if (bin_fd != -1)
+        close(bin_fd);
+    if (mnt_fd != -1)
+        close(mnt_fd);
+    if (dit_fd != -1)
+        close(dit_fd);
+
+    return exit_status;
+}
+
+
+
+
+/**
+ * @brief check that the base image has not changed since 'Dockerfile.draft' was created.
+ *
+ * @param[in]  mnt_fd  file descriptor for the directory shared with the host environment
+ * @return bool  the resulting boolean
+ *
+ * @note compares the first lines of 'Dockerfile.draft' and 'Dockerfile.base' without reading whole files.
+ */
+static bool check_base_image(int mnt_fd){
+    assert(mnt_fd >= 0);
+
+    int fd;
+    FILE *draft_fp, *base_fp;
+    int c1, c2 = EOF;
+    bool consistent = true;
+
+    if ((fd = openat(mnt_fd, "Dockerfile.draft", (O_RDONLY | O_CLOEXEC))) != -1){
+        if ((draft_fp = fdopen(fd, "r"))){
+            if ((c1 = getc(draft_fp)) != EOF){
+                consistent = false;
+
+                if ((base_fp = fopen(DOCKER_FILE_BASE, "r"))){
+                    while ((c1 == (c2 = getc(base_fp))) && (c1 != '\n') && (c1 != EOF))
+                        c1 = getc(draft_fp);
+
+                    if (c1 == '\n')
+                        c1 = EOF;
+                    if (c2 == '\n')
+                        c2 = EOF;
+
+                    consistent = (c1 == c2);
+                    fclose(base_fp);
+                }
+            }
+            fclose(draft_fp);
+        }
+        else
+            close(fd);
+    }
+
+    return consistent;
+}
+
+
+/**
+ * @brief overwrite the specified file with the specified contents.
+ *
+ * @param[in]  dirfd  file descriptor for the directory containing the file
+ * @param[in]  name  file name
+ * @param[in]  contents  the contents to be written
+ * @param[in]  size  the length of the contents
+ * @return int  0 (success) or -1 (unexpected error)
+ */
+static int write_file_at(int dirfd, const char *name, const char *contents, size_t size){
+    assert(dirfd >= 0);
+    assert(name && *name);
+    assert(contents);
+
+    int fd, exit_status = UNEXPECTED_ERROR;
+
+    if ((fd = openat(dirfd, name, (INIT_OPEN_FLAGS | O_TRUNC), 0666)) != -1){
+        if ((! size) || (write(fd, contents, size) == ((ssize_t) size)))
+            exit_status = SUCCESS;
+        close(fd);
+    }
+
+    return exit_status;
+}
+
+
+/**
+ * @brief create the specified directory and the files under it if they do not exist.
+ *
+ * @param[in]  dit_fd  file descriptor for the root directory of this tool
+ * @param[in]  dir  the information about the directory
+ * @return bool  successful or not
+ *
+ * @note the existing files are neither truncated nor have their timestamps updated.
+ * @note the permissions of the files are changed explicitly, since the existing ones may differ.
+ */
+static bool prepare_files(int dit_fd, const init_dir *dir){
+    assert(dit_fd >= 0);
+    assert(dir);
+
+    int dirfd, fd;
+    size_t i;
+    bool success = false;
+
+    if (! dir->files_num)
+        return true;
+
+    if (mkdirat(dit_fd, dir->name, 0777) && (errno != EEXIST))
+        goto errexit;
+
+    if ((dirfd = openat(dit_fd, dir->name, INIT_DIR_FLAGS)) == -1)
+        goto errexit;
+
+    for (i = 0; i < dir->files_num; i++){
+        if ((fd = openat(dirfd, dir->files[i], INIT_OPEN_FLAGS, dir->file_mode)) == -1)
+            break;
+        if (fchmod(fd, dir->file_mode)){
+            close(fd);
+            break;
+        }
+        close(fd);
+    }
+
+    success = (i == dir->files_num);
+    close(dirfd);
+
+    if (success)
+        return true;
+
+errexit:
+    xperror_standards(dir->name, errno);
+    return false;
+}
+
+
+
+
+/**
+ * @brief the callback function that makes the regular files under '/dit/bin' executable only
+ *
+ * @param[in]  pwdfd  file descriptor that serves as the current working directory
+ * @param[in]  name  name of the file we are currently looking at
+ * @param[in]  isdir  whether it is a directory
+ * @return int  0 (success) or -1 (unexpected error)
+ */
+static int chmod_exec_files(int pwdfd, const char *name, bool isdir){
+    assert(pwdfd >= 0);
+    assert(name && *name);
+
+    struct stat file_stat;
+
+    if (isdir || fstatat(pwdfd, name, &file_stat, AT_SYMLINK_NOFOLLOW) || (! S_ISREG(file_stat.st_mode)))
+        return SUCCESS;
+
+    return fchmodat(pwdfd, name, 0111, 0);
+}
+
+
+/**
+ * @brief the callback function that makes the regular files under '/dit/etc' readable only
+ *
+ * @param[in]  pwdfd  file descriptor that serves as the current working directory
+ * @param[in]  name  name of the file we are currently looking at
+ * @param[in]  isdir  whether it is a directory
+ * @return int  0 (success) or -1 (unexpected error)
+ */
+static int chmod_read_files(int pwdfd, const char *name, bool isdir){
+    assert(pwdfd >= 0);
+    assert(name && *name);
+
+    struct stat file_stat;
+
+    if (isdir || fstatat(pwdfd, name, &file_stat, AT_SYMLINK_NOFOLLOW) || (! S_ISREG(file_stat.st_mode)))
+        return SUCCESS;
+
+    return fchmodat(pwdfd, name, 0444, 0);
+}
+
+
+
+
+/**
+ * @brief create a symbolic link to this tool for each dit command.
+ *
+ * @param[in]  bin_fd  file descriptor for the directory where this tool is located
+ * @return bool  successful or not
+ *
+ * @note the existing symbolic links are left as they are.
+ * @note the link for this command is not created, so that 'init' does not mean this command in the shell.
+ */
+static bool create_symlinks(int bin_fd){
+    assert(bin_fd >= 0);
+
+    for (int i = 0; i < CMDS_NUM; i++)
+        if ((i != DIT_INIT) && symlinkat("dit", bin_fd, cmd_reprs[i]) && (errno != EEXIST))
+            return false;
+
+    return true;
+}
+
+
+/**
+ * @brief initialize the contents of the internal files with the other dit commands.
+ *
+ * @param[in]  srv_fd  file descriptor for the directory where the files recreated at startup are located
+ * @return int  0 (success) or -1 (unexpected error)
+ *
+ * @note the dit commands are called as functions instead of being executed in child processes.
+ */
+static int reset_internal_files(int srv_fd){
+    assert(srv_fd >= 0);
+
+    char *config_argv[] = { "config", "-r", NULL };
+    char *ignore_both_argv[] = { "ignore", "-dhr", NULL };
+    char *optimize_argv[] = { "optimize", "-r", NULL };
+    char *reflect_argv[] = { "reflect", NULL };
+
+    const struct {
+        int (* const func)(int, char **);
+        const int argc;
+        char ** const argv;
+    }
+    cmd_calls[] = {
+        { config,   2, config_argv      },
+        { ignore,   2, ignore_both_argv },
+        { optimize, 2, optimize_argv    },
+        { reflect,  1, reflect_argv     }
+    };
+
+    int exit_status = UNEXPECTED_ERROR;
+
+    if (
+        write_file_at(srv_fd, "command-start", "", 0) ||
+        write_file_at(srv_fd, "last-exit-status", "0\n", 2) ||
+        write_file_at(srv_fd, "last-history-number", "-1\n", 3) ||
+        write_file_at(srv_fd, "reflect-report.real", "", 0) ||
+        write_file_at(srv_fd, "size-projection", "", 0) ||
+        write_file_at(srv_fd, "startup-time", "", 0) ||
+        write_file_at(srv_fd, "stats.ring", "", 0)
+    )
+        return exit_status;
+
+    exit_status = SUCCESS;
+
+    for (size_t i = 0; i < numof(cmd_calls); i++){
+        optind = 0;
+
+        if (cmd_calls[i].func(cmd_calls[i].argc, cmd_calls[i].argv))
+            exit_status = UNEXPECTED_ERROR;
+    }
+
+    optind = 0;
+    return exit_status;
+}
+
+
+
+
+/******************************************************************************
+    * Measurement Part
+******************************************************************************/
+
+
+/**
+ * @brief record the time elapsed from the start of the container to the first prompt.
+ *
+ * @return int  0 (success) or -1 (unexpected error)
+ *
+ * @note the start time of the container is that of the process with PID 1, in clock ticks since boot.
+ * @note it is expected to be called at the end of the profile read by the shell entered at startup.
+ */
+static int record_startup_time(void){
+    FILE *fp;
+    char buf[1024], *tmp;
+    unsigned long long start_ticks = 0;
+    long ticks_per_sec;
+    struct timespec now;
+    long long elapsed_ms;
+    int i, exit_status = UNEXPECTED_ERROR;
+
+    if ((fp = fopen(INIT_CONTAINER_PID_STAT, "r"))){
+        if (fgets(buf, sizeof(buf), fp) && (tmp = strrchr(buf, ')'))){
+            // move to the space just before the 22nd field 'starttime'
+            for (i = 0; i < 20; i++)
+                if (! (tmp = strchr((tmp + 1), ' ')))
+                    break;
+
+            if (tmp && (sscanf(tmp, "%llu", &start_ticks) == 1))
+                exit_status = SUCCESS;
+        }
+        fclose(fp);
+    }
+
+    if (exit_status || ((ticks_per_sec = sysconf(_SC_CLK_TCK)) <= 0) || clock_gettime(CLOCK_BOOTTIME, &now))
+        return UNEXPECTED_ERROR;
+
+    elapsed_ms = ((long long) now.tv_sec) * 1000 + now.tv_nsec / 1000000;
+    elapsed_ms -= (long long) ((start_ticks * 1000) / ticks_per_sec);
+
+    if (elapsed_ms < 0)
+        elapsed_ms = 0;
+
+    if ((fp = fopen(STARTUP_TIME_FILE, "w"))){
+        if (fprintf(fp, "%lld.%03lld\n", (elapsed_ms / 1000), (elapsed_ms % 1000)) < 0)
+            exit_status = UNEXPECTED_ERROR;
+        if (fclose(fp))
+            exit_status = UNEXPECTED_ERROR;
+    }
+    else
+        exit_status = UNEXPECTED_ERROR;
+
+    return exit_status;
+}
+
+
+
+
+#ifndef NDEBUG
+
+
+/******************************************************************************
+    * Unit Test Functions
+******************************************************************************/
+
+
+static void check_base_image_test(void);
+
+
+
+
+void init_test(void){
+    do_test(check_base_image_test);
+}
+
+
+
+
+static void check_base_image_test(void){
+    const struct {
+        const char * const draft;
+        const char * const base;
+        const bool result;
+    }
+    // changeable part for updating test cases
+    table[] = {
+        { "",                                "FROM alpine:latest\n",  true },
+        { "FROM alpine:latest\nRUN ls\n",    "FROM alpine:latest\n",  true },
+        { "FROM alpine:latest",              "FROM alpine:latest\n",  true },
+        { "FROM alpine:3.18\nRUN ls\n",      "FROM alpine:latest\n", false },
+        { "FROM alpine\n",                   "FROM alpine:latest\n", false },
+        { "FROM alpine:latest\n",            "",                     false },
+        {  0,                                 0,                        0  }
+    };
+
+    const char *draft_path = "/dit/tmp/Dockerfile.draft", *base_path = TMP_FILE1;
+    int i, tmp_fd, errid = 0;
+    FILE *fp;
+
+    if (rename(DOCKER_FILE_BASE, TMP_FILE2))
+        errid = errno;
+
+    assert((tmp_fd = open("/dit/tmp", INIT_DIR_FLAGS)) != -1);
+
+    for (i = 0; table[i].draft; i++){
+        assert((fp = fopen(draft_path, "w")));
+        assert(fputs(table[i].draft, fp) != EOF);
+        assert(! fclose(fp));
+
+        assert((fp = fopen(base_path, "w")));
+        assert(fputs(table[i].base, fp) != EOF);
+        assert(! fclose(fp));
+        assert(! rename(base_path, DOCKER_FILE_BASE));
+
+        assert(check_base_image(tmp_fd) == table[i].result);
+
+        print_progress_test_loop('S', (table[i].result ? SUCCESS : FAILURE), i);
+        fprintf(stderr, "'%.*s'\n", ((int) strcspn(table[i].draft, "\n")), table[i].draft);
+    }
+
+    assert(! close(tmp_fd));
+    assert(! unlink(draft_path));
+    assert(! unlink(DOCKER_FILE_BASE));
+
+    if (! errid)
+        assert(! rename(TMP_FILE2, DOCKER_FILE_BASE));
+    else
+        assert(errid == ENOENT);
+}
+
+
+#endif // NDEBUG
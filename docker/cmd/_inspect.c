@@ -18,7 +18,53 @@
         "\n" \
     )
 
+#define INSP_ESTIMATE_HEADER \
+    ( \
+        "\n" \
+        "Permission      User     Group      Size       Gzip~       Zstd~\n" \
+        "=================================================================" \
+        "\n" \
+    )
+
 #define INSP_INITIAL_DIRS_MAX 15  // 2^n - 1
+#define INSP_INITIAL_JOBS_MAX 63  // 2^n - 1
+
+#define INSP_SAMPLE_WHOLE_MAX (1 << 20)
+#define INSP_SAMPLE_BLOCKS_NUM 16
+#define INSP_SAMPLE_BLOCK_SIZE (1 << 16)
+
+#define INSP_HASH_BITS 15
+#define INSP_WORKERS_MAX 8
+
+#define INSP_SNAPSHOTS_FILE "/dit/var/inspect.snap"
+#define INSP_SNAPSHOTS_MAX 65536
+#define INSP_INITIAL_CHANGES_MAX 63  // 2^n - 1
+#define INSP_HASH_BLOCK_SIZE (1 << 16)
+
+#define INSP_ARCHIVE_NONE 0
+#define INSP_ARCHIVE_TAR  1
+#define INSP_ARCHIVE_TGZ  2
+#define INSP_ARCHIVE_ZIP  3
+
+#define INSP_GZIP_PATH "/bin/gzip"
+#define INSP_INITIAL_ENTRIES_MAX 63  // 2^n - 1
+
+#define INSP_TAR_BLOCK_SIZE 512
+#define INSP_TAR_META_MAX (1 << 20)
+
+#define INSP_ZIP_EOCD_SIG 0x06054B50
+#define INSP_ZIP_EOCD_SIZE 22
+#define INSP_ZIP64_LOCATOR_SIG 0x07064B50
+#define INSP_ZIP64_EOCD_SIG 0x06064B50
+#define INSP_ZIP64_EOCD_SIZE 56
+#define INSP_ZIP_CDH_SIG 0x02014B50
+#define INSP_ZIP_CDH_SIZE 46
+#define INSP_ZIP_LFH_SIG 0x04034B50
+#define INSP_ZIP_LFH_SIZE 30
+#define INSP_ZIP64_EXTRA_ID 0x0001
+#define INSP_ZIP_UNIX_EXTRA_ID 0x7875
+#define INSP_ZIP_UNIX 3
+#define INSP_ZIP_MSDOS_DIR 0x10
 
 
 /** Data type for storing the results of option parse */
@@ -26,6 +72,8 @@ typedef struct {
     unsigned int color;    /** whether to colorize file name based on file mode */
     bool classify;         /** whether to append i to file name based on file mode */
     bool numeric_id;       /** whether to represent users and groups numerically */
+    bool compress;         /** whether to estimate the compressed size of each file */
+    bool compare;          /** whether to compare two directory trees instead of showing them */
 } insp_opts;
 
 
@@ -36,6 +84,14 @@ typedef struct file_node{
     uid_t uid;                      /** file uid */
 	gid_t gid;                      /** file gid */
     off_t size;                     /** file size */
+    off_t gzip_size;                /** estimated file size when compressed by gzip */
+    off_t zstd_size;                /** estimated file size when compressed by zstd */
+    dev_t dev;                      /** ID of the device containing the file */
+    ino_t ino;                      /** inode number of the file */
+    struct timespec mtime;          /** time of last modification of the file */
+    struct timespec ctime;          /** time of last status change of the file */
+    uint64_t hash;                  /** hash value of the contents if this is a regular file that was hashed */
+    bool hashed;                    /** whether the hash value is set */
 
     char *link_path;                /** file name of link destination if this is a symbolic link */
     mode_t link_mode;               /** file mode of link destination if this is a symbolic link */
@@ -50,13 +106,134 @@ typedef struct file_node{
 } file_node;
 
 
+/** Data type for storing the regular files whose compressed size is to be estimated */
+typedef struct {
+    struct {
+        file_node *file;            /** the file to be estimated */
+        char *path;                 /** path of the file from the current working directory */
+    } *jobs;                        /** array for storing the files */
+    size_t jobs_num;                /** the current number of the files */
+    size_t jobs_max;                /** the current maximum length of the array */
+    atomic_size_t next;             /** index of the file to be estimated next */
+} insp_jobs;
+
+
+/** Data type for storing the hash value of a regular file, along with what identifies that version of it */
+typedef struct {
+    uint64_t dev;                   /** ID of the device containing the file */
+    uint64_t ino;                   /** inode number of the file */
+    uint64_t mtime_sec;             /** time of last modification, in seconds */
+    uint64_t mtime_nsec;            /** the remaining nanoseconds */
+    uint64_t ctime_sec;             /** time of last status change, in seconds */
+    uint64_t ctime_nsec;            /** the remaining nanoseconds */
+    uint64_t size;                  /** file size */
+    uint64_t hash;                  /** hash value of the contents */
+} insp_snapshot;
+
+
+/** Data type for storing an entry that differs between the two directory trees */
+typedef struct {
+    char *path;                     /** path of the entry relative to the roots */
+    int change_c;                   /** '+' (added), '-' (removed), 'C' (contents), '?' (unknown) or '\0' */
+    bool meta;                      /** whether the mode or the owner differs */
+    file_node *files[2];            /** the regular files whose contents are yet to be compared, or NULLs */
+} insp_change;
+
+
+/** Data type for storing some data commonly used when comparing two directory trees */
+typedef struct {
+    insp_change *changes;           /** array for storing the entries that differ, in the order of the walk */
+    size_t changes_num;             /** the current number of the entries */
+    size_t changes_max;             /** the current maximum length of the array */
+    insp_jobs jobs;                 /** the regular files to be hashed */
+    insp_snapshot *snaps;           /** the snapshots read from the cache, sorted by device and inode */
+    size_t snaps_num;               /** the number of the snapshots */
+    char paths[2][PATH_MAX];        /** paths of the files being compared on each side */
+    size_t roots_len[2];            /** the length of the path of each root */
+} insp_diff;
+
+
+/** Data type for storing an entry of an archive, which is listed without being extracted */
+typedef struct {
+    char *path;                     /** path of the entry in the archive */
+    char *link_path;                /** file name of link destination if this is a symbolic link */
+    mode_t mode;                    /** file mode */
+    uid_t uid;                      /** file uid */
+    gid_t gid;                      /** file gid */
+    off_t size;                     /** file size */
+    size_t index;                   /** the order in which the entry appears in the archive */
+} insp_entry;
+
+
+/** Data type for storing the entries read from an archive */
+typedef struct {
+    insp_entry *entries;            /** array for storing the entries */
+    size_t entries_num;             /** the current number of the entries */
+    size_t entries_max;             /** the current maximum length of the array */
+    int errid;                      /** serial number of the error encountered while reading the archive */
+    bool escaped;                   /** whether any entry was dropped since its path goes above the archive */
+} insp_archive;
+
+
+/** Data type for storing the parameters of the LZ77 parse that imitates a certain compressor */
+typedef struct {
+    size_t window;                  /** the maximum distance back to the start of a match */
+    size_t match_max;               /** the maximum length of a match */
+    double match_bits;              /** the fixed cost in bits of encoding a match */
+} lz_profile;
+
+
 static int parse_opts(int argc, char **argv, insp_opts *opt);
 static int do_inspect(int argc, char **argv, const insp_opts *opt);
+static int do_compare(char * const *paths);
 
 static file_node *construct_dir_tree(int pwdfd, const char *name);
 static file_node *new_file(int pwdfd, char *name);
 static bool append_file(file_node *tree, file_node *file);
 
+static void expand_archive(int pwdfd, file_node *file);
+static int check_if_archive(const char *name);
+static bool read_tar_entries(int fd, void *arg);
+static int check_tar_header(const unsigned char *header);
+static uint64_t parse_tar_number(const char *field, size_t len);
+static mode_t get_tar_file_type(int type);
+static char *join_tar_name(const unsigned char *header);
+static char *read_tar_data(int fd, uint64_t size, insp_archive *archive);
+static void parse_pax_records(char *data, uint64_t size, char *long_paths[2], uint64_t *p_size, bool *p_has_size);
+static bool skip_archive(int fd, uint64_t size, insp_archive *archive);
+static ssize_t read_archive(int fd, void *buf, size_t len);
+static uint64_t tar_padded(uint64_t size);
+static void read_zip_entries(int fd, insp_archive *archive);
+static void parse_zip_extra(const unsigned char *extra, size_t len, uint64_t values[3], insp_entry *entry);
+static uint64_t get_le(const unsigned char *p, size_t len);
+static bool append_entry(insp_archive *archive, insp_entry *entry);
+static bool build_archive_tree(file_node *file, insp_archive *archive);
+static file_node *new_archived_file(const char *name, size_t len, insp_entry *entry);
+static void settle_archive_tree(file_node *dir);
+static int qcmp_entry(const void *a, const void *b);
+
+static void estimate_dir_tree(file_node *tree);
+static void run_jobs(insp_jobs *jobs, void *(* worker)(void *));
+static bool append_job(insp_jobs *jobs, file_node *file, const char *path);
+static bool collect_estimate_jobs(file_node *file, char *path, size_t len, insp_jobs *jobs);
+static void *estimate_worker(void *arg);
+static void estimate_file(file_node *file, const char *path, unsigned char *buf, uint32_t *table);
+static void estimate_block(const unsigned char *buf, size_t len, uint32_t *table, double *gzip, double *zstd);
+static double estimate_lz_bits(const unsigned char *buf, size_t len, uint32_t *table, const lz_profile *prof);
+static void sum_estimates(file_node *file);
+
+static bool compare_dir_trees(file_node *trees[2], const char *cache_file, insp_diff *diff);
+static bool compare_files(insp_diff *diff, file_node *file1, file_node *file2, const size_t lens[2]);
+static size_t extend_path(insp_diff *diff, int side, size_t len, const char *name);
+static insp_change *append_change(insp_diff *diff, int side, const file_node *file, int change_c, bool meta);
+static bool request_hash(insp_diff *diff, file_node *file, int side);
+static void *hash_worker(void *arg);
+static void hash_file(file_node *file, const char *path, unsigned char *buf);
+static void read_snapshots(insp_diff *diff, const char *cache_file);
+static void write_snapshots(const insp_diff *diff, const char *cache_file);
+static int qcmp_snapshot(const void *a, const void *b);
+static void free_changes(insp_diff *diff);
+
 static int qcmp_name(const void *a, const void *b);
 static int qcmp_size(const void *a, const void *b);
 static int qcmp_ext(const void *a, const void *b);
@@ -71,6 +248,13 @@ static void print_file_size(off_t size);
 static void print_file_name(const file_node *file, const insp_opts *opt, bool link_flag);
 
 
+/** parameters of the LZ77 parse imitating gzip, that is, deflate with its 32 KiB window */
+static const lz_profile gzip_profile = { .window = 32768, .match_max = 258, .match_bits = 2 };
+
+/** parameters of the LZ77 parse imitating zstd, whose window covers any block sampled by this command */
+static const lz_profile zstd_profile = { .window = INSP_SAMPLE_WHOLE_MAX, .match_max = SIZE_MAX, .match_bits = 1 };
+
+
 /** array of strings in alphabetical order corresponding to each file sorting method */
 static const char * const sort_args[ARGS_NUM] = {
     "extension",
@@ -82,6 +266,9 @@ static const char * const sort_args[ARGS_NUM] = {
 /** comparison function used when qsort */
 static int (* qcmp)(const void *, const void *) = qcmp_name;
 
+/** whether to list the entries of each archive as the children of the file */
+static bool into_archives = false;
+
 
 
 
@@ -106,9 +293,21 @@ int inspect(int argc, char **argv){
     if (! (i = parse_opts(argc, argv, &opt))){
         argc -= optind;
         argv += optind;
-        exit_status = do_inspect(argc, argv, &opt);
+
+        if (! opt.compare)
+            exit_status = do_inspect(argc, argv, &opt);
+        else if (argc == 2)
+            exit_status = do_compare(argv);
+        else {
+            if (argc < 2)
+                xperror_missing_args("directory");
+            else
+                xperror_too_many_args(1);
+            i = ERROR_EXIT;
+        }
     }
-    else if (i < 0){
+
+    if (i < 0){
         exit_status = FAILURE;
         xperror_suggestion(true);
     }
@@ -132,13 +331,16 @@ int inspect(int argc, char **argv){
 static int parse_opts(int argc, char **argv, insp_opts *opt){
     assert(opt);
 
-    const char *short_opts = "CFnSX";
+    const char *short_opts = "CFnSXz";
 
     const struct option long_opts[] = {
         { "color",           no_argument,       NULL, 'C' },
         { "classify",        no_argument,       NULL, 'F' },
         { "numeric-uid-gid", no_argument,       NULL, 'n' },
+        { "compressibility", no_argument,       NULL, 'z' },
         { "help",            no_argument,       NULL,  1  },
+        { "compare",         no_argument,       NULL,  2  },
+        { "into-archives",   no_argument,       NULL,  3  },
         { "sort",            required_argument, NULL,  0  },
         {  0,                 0,                 0,    0  }
     };
@@ -146,6 +348,8 @@ static int parse_opts(int argc, char **argv, insp_opts *opt){
     opt->color = false;
     opt->classify = false;
     opt->numeric_id = false;
+    opt->compress = false;
+    opt->compare = false;
 
     int c, i;
     while ((c = getopt_long(argc, argv, short_opts, long_opts, &i)) >= 0)
@@ -165,9 +369,18 @@ static int parse_opts(int argc, char **argv, insp_opts *opt){
             case 'X':
                 qcmp = qcmp_ext;
                 break;
+            case 'z':
+                opt->compress = true;
+                break;
             case 1:
                 inspect_manual();
                 return NORMALLY_EXIT;
+            case 2:
+                opt->compare = true;
+                break;
+            case 3:
+                into_archives = true;
+                break;
             case 0:
                 if ((c = receive_expected_string(optarg, sort_args, ARGS_NUM, 2)) >= 0){
                     qcmp = c ? ((c == 1) ? qcmp_name : qcmp_size) : qcmp_ext;
@@ -199,9 +412,12 @@ static int parse_opts(int argc, char **argv, insp_opts *opt){
 static int do_inspect(int argc, char **argv, const insp_opts *opt){
     assert(opt);
 
-    const char *path;
+    const char *path, *header;
     file_node *tree;
     int offset = 1, exit_status = SUCCESS;
+    trace_scope scope;
+
+    header = opt->compress ? INSP_ESTIMATE_HEADER : INSP_DIRTREE_HEADER;
 
     if (argc <= 0){
         argc = 1;
@@ -213,9 +429,23 @@ static int do_inspect(int argc, char **argv, const insp_opts *opt){
     }
 
     do {
-        if (path && (tree = construct_dir_tree(AT_FDCWD, path))){
-            fputs((INSP_DIRTREE_HEADER + offset), stdout);
+        trace_begin(&scope, TRACE_CONSTRUCT_DIR_TREE, path);
+        tree = path ? construct_dir_tree(AT_FDCWD, path) : NULL;
+        trace_end(&scope);
+
+        if (tree){
+            if (opt->compress){
+                trace_begin(&scope, TRACE_ESTIMATE_DIR_TREE, path);
+                estimate_dir_tree(tree);
+                trace_end(&scope);
+            }
+
+            fputs((header + offset), stdout);
+
+            trace_begin(&scope, TRACE_DESTRUCT_DIR_TREE, path);
             destruct_dir_tree(tree, opt, 0);
+            trace_end(&scope);
+
             offset = 0;
         }
         else
@@ -230,6 +460,163 @@ static int do_inspect(int argc, char **argv, const insp_opts *opt){
 }
 
 
+/**
+ * @brief construct the two directory trees and display the entries that differ between them.
+ *
+ * @param[in]  paths  array of length 2 for the paths of the directory trees to be compared
+ * @return int  command's exit status
+ *
+ * @note each line consists of the kind of change, 'M' if the mode or the owner differs, and the relative path.
+ */
+static int do_compare(char * const *paths){
+    assert(paths);
+    assert(paths[0]);
+    assert(paths[1]);
+
+    file_node *trees[2] = {0};
+    insp_diff diff = {0};
+    const insp_change *change;
+    size_t i;
+    int side, exit_status = FAILURE;
+    trace_scope scope;
+
+    qcmp = qcmp_name;
+
+    for (side = 0; side < 2; side++){
+        trace_begin(&scope, TRACE_CONSTRUCT_DIR_TREE, paths[side]);
+        trees[side] = construct_dir_tree(AT_FDCWD, paths[side]);
+        trace_end(&scope);
+
+        if (! trees[side]){
+            xperror_standards(NULL, ENOMEM);
+            break;
+        }
+        if (trees[side]->noinfo){
+            xperror_standards(paths[side], trees[side]->errid);
+            break;
+        }
+    }
+
+    if (side == 2){
+        trace_begin(&scope, TRACE_COMPARE_DIR_TREES, paths[0]);
+        errno = 0;
+
+        if (compare_dir_trees(trees, INSP_SNAPSHOTS_FILE, &diff)){
+            for (i = 0, change = diff.changes; i < diff.changes_num; i++, change++)
+                if (change->change_c || change->meta)
+                    fprintf(stdout, "%c%c %s\n",
+                        (change->change_c ? change->change_c : ' '), (change->meta ? 'M' : ' '), change->path);
+
+            exit_status = SUCCESS;
+        }
+        else
+            xperror_standards(NULL, (errno ? errno : ENOMEM));
+
+        trace_end(&scope);
+        free_changes(&diff);
+    }
+
+    for (side = 2; side--;)
+        if (trees[side])
+            destruct_dir_tree(trees[side], NULL, 0);
+
+    return exit_status;
+}
+
+
+
+
+/**
+ * @brief measure the total size of the files under the specified path, as this command shows it.
+ *
+ * @param[in]  path  the path
+ * @param[in]  compress  whether to estimate the compressed size as well
+ * @param[out] sizes  array of length 3 for storing the size and its estimates when compressed by gzip and zstd
+ * @return bool  whether the path exists and could be measured
+ *
+ * @note the estimates are left equal to the size unless 'compress' is true.
+ */
+bool measure_dir_tree(const char *path, bool compress, off_t sizes[3]){
+    assert(path);
+    assert(sizes);
+
+    file_node *tree;
+    bool exists;
+
+    sizes[2] = (sizes[1] = (sizes[0] = 0));
+
+    if (! (tree = construct_dir_tree(AT_FDCWD, path)))
+        return false;
+
+    if (compress)
+        estimate_dir_tree(tree);
+    else {
+        tree->gzip_size = tree->size;
+        tree->zstd_size = tree->size;
+    }
+
+    sizes[0] = tree->size;
+    sizes[1] = tree->gzip_size;
+    sizes[2] = tree->zstd_size;
+
+    exists = ! tree->noinfo;
+    destruct_dir_tree(tree, NULL, 0);
+
+    return exists;
+}
+
+
+/**
+ * @brief estimate the compressed size of each of the specified regular files, as this command does.
+ *
+ * @param[in]  paths  array of the paths of the files
+ * @param[in]  paths_num  array size
+ * @param[out] sizes  array of length 3 for each file, whose first element is expected to be its size
+ * @return bool  successful or not
+ *
+ * @note the estimates of any file that could not be estimated are left equal to its size.
+ */
+bool estimate_file_sizes(char * const *paths, size_t paths_num, off_t (* sizes)[3]){
+    assert(paths || (! paths_num));
+    assert(sizes || (! paths_num));
+
+    file_node *files;
+    insp_jobs jobs = {0};
+    size_t i;
+
+    if (! paths_num)
+        return true;
+
+    files = (file_node *) calloc(paths_num, sizeof(file_node));
+    jobs.jobs = malloc(sizeof(*(jobs.jobs)) * paths_num);
+
+    if (files && jobs.jobs){
+        for (i = 0; i < paths_num; i++){
+            files[i].mode = S_IFREG;
+            files[i].size = sizes[i][0];
+            files[i].gzip_size = sizes[i][0];
+            files[i].zstd_size = sizes[i][0];
+
+            jobs.jobs[i].file = files + i;
+            jobs.jobs[i].path = paths[i];
+        }
+
+        jobs.jobs_num = paths_num;
+        run_jobs(&jobs, estimate_worker);
+
+        for (i = 0; i < paths_num; i++){
+            sizes[i][1] = files[i].gzip_size;
+            sizes[i][2] = files[i].zstd_size;
+        }
+    }
+
+    free(files);
+    free(jobs.jobs);
+
+    return (jobs.jobs_num > 0);
+}
+
+
 
 
 /******************************************************************************
@@ -245,6 +632,7 @@ static int do_inspect(int argc, char **argv, const insp_opts *opt){
  * @return file_node*  the result of sub-constructing
  *
  * @note at the same time, sorts files in directory.
+ * @note if requested, the entries of each archive are also listed as the children of the file.
  */
 static file_node *construct_dir_tree(int pwdfd, const char *name){
     assert((pwdfd >= 0) || (pwdfd == AT_FDCWD));
@@ -287,116 +675,2035 @@ static file_node *construct_dir_tree(int pwdfd, const char *name){
                 else
                     file->errid = errno;
             }
+            else if (into_archives && S_ISREG(file->mode))
+                expand_archive(pwdfd, file);
+        }
+        else
+            free(dest);
+    }
+
+    return file;
+}
+
+
+
+
+/**
+ * @brief create new element that makes up the directory tree.
+ *
+ * @param[in]  pwdfd  file descriptor that serves as the current working directory
+ * @param[in]  name  name of the file we are currently looking at
+ * @return file_node*  new element that makes up the directory tree
+ */
+static file_node *new_file(int pwdfd, char *name){
+    assert((pwdfd >= 0) || (pwdfd == AT_FDCWD));
+    assert(name);
+
+    file_node *file;
+    struct stat file_stat;
+
+    if ((file = (file_node *) calloc(1, sizeof(file_node)))){
+        file->name = name;
+        file->link_invalid = true;
+
+        if (! fstatat(pwdfd, name, &file_stat, AT_SYMLINK_NOFOLLOW)){
+            file->mode = file_stat.st_mode;
+            file->uid = file_stat.st_uid;
+            file->gid = file_stat.st_gid;
+            file->size = (file_stat.st_size > 0) ? file_stat.st_size : 0;
+            file->dev = file_stat.st_dev;
+            file->ino = file_stat.st_ino;
+            file->mtime = file_stat.st_mtim;
+            file->ctime = file_stat.st_ctim;
+
+            if (S_ISLNK(file_stat.st_mode)){
+                char *link_path;
+                ssize_t link_len;
+
+                if ((link_path = (char *) malloc(sizeof(char) * (file->size + 1)))){
+                    link_len = readlinkat(pwdfd, name, link_path, file->size);
+
+                    if (link_len > 0){
+                        if (! fstatat(pwdfd, name, &file_stat, 0)){
+                            file->link_mode = file_stat.st_mode;
+                            file->link_invalid = false;
+                        }
+                        else
+                            file->errid = errno;
+                    }
+                    else
+                        link_len = 0;
+
+                    link_path[link_len] = '\0';
+                    file->link_path = link_path;
+                }
+            }
+            else
+                file->link_invalid = false;
+        }
+        else {
+            file->errid = errno;
+            file->noinfo = true;
+        }
+    }
+
+    return file;
+}
+
+
+/**
+ * @brief append file to the directory tree under construction.
+ *
+ * @param[out] tree  the directory tree under construction
+ * @param[in]  file  file to append to the directory tree
+ * @return bool  successful or not
+ *
+ * @note any directory can have a virtually unlimited number of files.
+ */
+static bool append_file(file_node *tree, file_node *file){
+    assert(tree);
+    assert(file);
+
+    if (tree->children_num == tree->children_max){
+        size_t curr_max;
+        void *ptr;
+
+        if ((curr_max = tree->children_max)){
+            curr_max++;
+            assert(! (curr_max & (curr_max - 1)));
+
+            if (! (curr_max <<= 1))
+                return false;
+            curr_max--;
+        }
+        else
+            curr_max = INSP_INITIAL_DIRS_MAX;
+
+        if (! (ptr = realloc(tree->children, (sizeof(file_node *) * curr_max))))
+            return false;
+
+        tree->children = (file_node **) ptr;
+        tree->children_max = curr_max;
+    }
+
+    assert(tree->children);
+
+    tree->size += file->size;
+    tree->children[tree->children_num++] = file;
+    return true;
+}
+
+
+
+
+/******************************************************************************
+    * Archive Phase
+******************************************************************************/
+
+
+/**
+ * @brief list the entries of the archive as the children of the regular file, if it has a known extension.
+ *
+ * @param[in]  pwdfd  file descriptor that serves as the current working directory
+ * @param[out] file  the regular file
+ *
+ * @note the contents of the archive are never written to disk, and the size of the file itself is kept as it is.
+ * @note the entries read before an error are still listed, and the error is shown after the file name.
+ * @note if any entry is dropped because its path goes above the archive with '..', EPERM is shown as the error.
+ */
+static void expand_archive(int pwdfd, file_node *file){
+    assert((pwdfd >= 0) || (pwdfd == AT_FDCWD));
+    assert(file);
+    assert(file->name);
+    assert(S_ISREG(file->mode));
+
+    char * const argv[] = { "gzip", "-dc", NULL };
+    int type, fd, exit_status;
+    insp_archive archive = {0};
+    size_t i;
+
+    if ((type = check_if_archive(file->name)) == INSP_ARCHIVE_NONE)
+        return;
+
+    if ((fd = openat(pwdfd, file->name, (O_RDONLY | O_CLOEXEC))) == -1){
+        file->errid = errno;
+        return;
+    }
+
+    switch (type){
+        case INSP_ARCHIVE_TAR:
+            read_tar_entries(fd, &archive);
+            break;
+        case INSP_ARCHIVE_TGZ:
+            if ((exit_status = execute_stream(INSP_GZIP_PATH, argv, 0b10, fd, read_tar_entries, &archive)))
+                if (! archive.errid)
+                    archive.errid = (exit_status < 0) ? errno : EBADMSG;
+            break;
+        default:
+            assert(type == INSP_ARCHIVE_ZIP);
+            read_zip_entries(fd, &archive);
+    }
+
+    close(fd);
+
+    if ((! build_archive_tree(file, &archive)) && (! archive.errid))
+        archive.errid = ENOMEM;
+
+    // like tar, the entries going above the directory where the archive would be extracted are refused
+    if (archive.escaped && (! archive.errid))
+        archive.errid = EPERM;
+
+    if (archive.errid)
+        file->errid = archive.errid;
+
+    for (i = archive.entries_num; i--;){
+        free(archive.entries[i].path);
+        free(archive.entries[i].link_path);
+    }
+    free(archive.entries);
+}
+
+
+/**
+ * @brief check the kind of archive from the extension of the file name.
+ *
+ * @param[in]  name  file name
+ * @return int  INSP_ARCHIVE_TAR, INSP_ARCHIVE_TGZ, INSP_ARCHIVE_ZIP or INSP_ARCHIVE_NONE
+ */
+static int check_if_archive(const char *name){
+    assert(name);
+
+    // changeable part for updating the supported extensions
+    const struct {
+        const char *ext;
+        int type;
+    }
+    exts[] = {
+        { ".tar",    INSP_ARCHIVE_TAR      },
+        { ".tar.gz", INSP_ARCHIVE_TGZ },
+        { ".tgz",    INSP_ARCHIVE_TGZ },
+        { ".zip",    INSP_ARCHIVE_ZIP      }
+    };
+
+    size_t name_len, ext_len, i;
+
+    name_len = strlen(name);
+
+    for (i = 0; i < numof(exts); i++){
+        ext_len = strlen(exts[i].ext);
+
+        if ((name_len > ext_len) && (! strcmp((name + name_len - ext_len), exts[i].ext)))
+            return exts[i].type;
+    }
+
+    return INSP_ARCHIVE_NONE;
+}
+
+
+
+
+/**
+ * @brief read the headers of the tar archive one by one, skipping the contents of each entry.
+ *
+ * @param[in]  fd  file descriptor for the archive or the read end of the pipe from the decompressor
+ * @param[out] arg  variable to store the entries of the archive
+ * @return bool  always true, so that the rest of the decompressed contents is discarded
+ *
+ * @note supports the ustar format, along with the GNU and POSIX extensions for long names and large files.
+ * @note an archive that ends without the block of zeros is regarded as truncated.
+ */
+static bool read_tar_entries(int fd, void *arg){
+    assert(fd >= 0);
+    assert(arg);
+
+    insp_archive *archive;
+    unsigned char header[INSP_TAR_BLOCK_SIZE];
+    char *long_paths[2] = {0}, *data;
+    insp_entry entry;
+    uint64_t size, pax_size = 0;
+    bool has_pax_size = false;
+    ssize_t read_size;
+    int type, tmp;
+
+    archive = (insp_archive *) arg;
+
+    while (! archive->errid){
+        if ((read_size = read_archive(fd, header, INSP_TAR_BLOCK_SIZE)) != INSP_TAR_BLOCK_SIZE){
+            archive->errid = (read_size < 0) ? errno : EBADMSG;
+            break;
+        }
+
+        if ((tmp = check_tar_header(header)) <= 0){
+            if (tmp < 0)
+                archive->errid = EBADMSG;
+            break;
+        }
+
+        type = header[156];
+        size = parse_tar_number((char *) (header + 124), 12);
+
+        switch (type){
+            case 'L':
+            case 'K':
+            case 'x':
+                if (! (data = read_tar_data(fd, size, archive)))
+                    break;
+
+                if (type == 'x'){
+                    parse_pax_records(data, size, long_paths, &pax_size, &has_pax_size);
+                    free(data);
+                }
+                else {
+                    tmp = (type == 'K');
+                    free(long_paths[tmp]);
+                    long_paths[tmp] = data;
+                }
+                break;
+            case 'g':
+                skip_archive(fd, tar_padded(size), archive);
+                break;
+            default:
+                if (has_pax_size)
+                    size = pax_size;
+                if ((type >= '1') && (type <= '6'))
+                    size = 0;
+
+                entry.mode = get_tar_file_type(type) | (parse_tar_number((char *) (header + 100), 8) & ~S_IFMT);
+                entry.uid = parse_tar_number((char *) (header + 108), 8);
+                entry.gid = parse_tar_number((char *) (header + 116), 8);
+                entry.size = size;
+
+                entry.path = long_paths[0] ? long_paths[0] : join_tar_name(header);
+                entry.link_path = NULL;
+
+                if (S_ISLNK(entry.mode)){
+                    entry.link_path = long_paths[1] ? long_paths[1] : strndup((char *) (header + 157), 100);
+
+                    // as 'lstat' reports, rather than the size of the contents that a symbolic link does not have
+                    if (entry.link_path)
+                        entry.size = strlen(entry.link_path);
+                }
+                else
+                    free(long_paths[1]);
+
+                long_paths[0] = NULL;
+                long_paths[1] = NULL;
+                has_pax_size = false;
+
+                if (append_entry(archive, &entry))
+                    skip_archive(fd, tar_padded(size), archive);
+                else
+                    archive->errid = ENOMEM;
+        }
+    }
+
+    free(long_paths[0]);
+    free(long_paths[1]);
+
+    return true;
+}
+
+
+/**
+ * @brief check the header block of the tar archive by its checksum.
+ *
+ * @param[in]  header  the header block
+ * @return int  1 (valid), 0 (the end of the archive) or -1 (invalid)
+ */
+static int check_tar_header(const unsigned char *header){
+    assert(header);
+
+    uint64_t sum = 0;
+    bool zeros = true;
+    size_t i;
+
+    for (i = 0; i < INSP_TAR_BLOCK_SIZE; i++){
+        zeros &= ! header[i];
+        sum += ((i >= 148) && (i < 156)) ? ' ' : header[i];
+    }
+
+    if (zeros)
+        return 0;
+    return (sum == parse_tar_number((const char *) (header + 148), 8)) ? 1 : -1;
+}
+
+
+/**
+ * @brief parse the numeric field of the tar header.
+ *
+ * @param[in]  field  the field
+ * @param[in]  len  the length of the field
+ * @return uint64_t  the resulting value
+ *
+ * @note the field is either octal digits padded with spaces or nulls, or a big-endian binary for a large value.
+ */
+static uint64_t parse_tar_number(const char *field, size_t len){
+    assert(field);
+    assert(len);
+
+    const unsigned char *p;
+    uint64_t value = 0;
+
+    p = (const unsigned char *) field;
+
+    if (*p & 0x80){
+        if (*p & 0x40)
+            return 0;
+
+        for (value = *(p++) & 0x3F; --len; p++)
+            value = (value << 8) | *p;
+    }
+    else {
+        for (; len && (*p == ' '); len--, p++);
+
+        for (; len && (*p >= '0') && (*p <= '7'); len--, p++)
+            value = (value << 3) | (*p - '0');
+    }
+
+    return value;
+}
+
+
+/**
+ * @brief convert the type flag of the tar header to the file type.
+ *
+ * @param[in]  type  the type flag
+ * @return mode_t  the file type, where a hard link and any unknown type are regarded as a regular file
+ */
+static mode_t get_tar_file_type(int type){
+    switch (type){
+        case '2':
+            return S_IFLNK;
+        case '3':
+            return S_IFCHR;
+        case '4':
+            return S_IFBLK;
+        case '5':
+            return S_IFDIR;
+        case '6':
+            return S_IFIFO;
+        default:
+            return S_IFREG;
+    }
+}
+
+
+/**
+ * @brief join the prefix and the name fields of the tar header.
+ *
+ * @param[in]  header  the header block
+ * @return char*  the resulting path or NULL
+ *
+ * @note the prefix field is used only in the POSIX ustar format, since GNU tar stores other data there.
+ */
+static char *join_tar_name(const unsigned char *header){
+    assert(header);
+
+    const char *name, *prefix;
+    char *path;
+    size_t name_len, prefix_len = 0;
+
+    name = (const char *) header;
+    prefix = (const char *) (header + 345);
+
+    name_len = strnlen(name, 100);
+    if (! memcmp((header + 257), "ustar", 6))
+        prefix_len = strnlen(prefix, 155);
+
+    if ((path = (char *) malloc(sizeof(char) * (prefix_len + name_len + 2)))){
+        if (prefix_len){
+            memcpy(path, prefix, (sizeof(char) * prefix_len));
+            path[prefix_len++] = '/';
+        }
+        memcpy((path + prefix_len), name, (sizeof(char) * name_len));
+        path[prefix_len + name_len] = '\0';
+    }
+
+    return path;
+}
+
+
+/**
+ * @brief read the contents of the entry of the tar archive that holds some metadata.
+ *
+ * @param[in]  fd  file descriptor for the archive
+ * @param[in]  size  the size of the contents
+ * @param[out] archive  variable to store the error number
+ * @return char*  the null-terminated contents or NULL
+ */
+static char *read_tar_data(int fd, uint64_t size, insp_archive *archive){
+    assert(fd >= 0);
+    assert(archive);
+
+    char *data;
+    ssize_t read_size;
+
+    if (size >= INSP_TAR_META_MAX){
+        archive->errid = EBADMSG;
+        return NULL;
+    }
+    if (! (data = (char *) malloc(sizeof(char) * (size + 1)))){
+        archive->errid = ENOMEM;
+        return NULL;
+    }
+
+    if ((read_size = read_archive(fd, data, size)) == ((ssize_t) size)){
+        data[size] = '\0';
+
+        if (skip_archive(fd, (tar_padded(size) - size), archive))
+            return data;
+    }
+    else
+        archive->errid = (read_size < 0) ? errno : EBADMSG;
+
+    free(data);
+    return NULL;
+}
+
+
+/**
+ * @brief parse the records of the POSIX extended header, that is, "<length> <keyword>=<value>\n".
+ *
+ * @param[out] data  the contents of the extended header, which is null-terminated
+ * @param[in]  size  the size of the contents
+ * @param[out] long_paths  array of length 2 for storing the path and the link path that override the next header
+ * @param[out] p_size  variable to store the size that overrides the next header
+ * @param[out] p_has_size  variable to store whether the size is overridden
+ *
+ * @note any record that cannot be parsed and all that follow it are ignored.
+ */
+static void parse_pax_records(char *data, uint64_t size, char *long_paths[2], uint64_t *p_size, bool *p_has_size){
+    assert(data);
+    assert(long_paths);
+    assert(p_size);
+    assert(p_has_size);
+
+    char *end, *next, *key, *value, *tmp;
+    unsigned long len;
+    int i;
+
+    for (end = data + size; data < end; data = next){
+        len = strtoul(data, &key, 10);
+
+        if ((key == data) || (*key != ' ') || (len > ((unsigned long) (end - data))))
+            break;
+
+        next = data + len;
+        key++;
+
+        if ((next[-1] != '\n') || (! (value = memchr(key, '=', (next - key)))))
+            break;
+
+        *(value++) = '\0';
+        next[-1] = '\0';
+
+        if (! strcmp(key, "size")){
+            *p_size = strtoull(value, NULL, 10);
+            *p_has_size = true;
+        }
+        else if ((i = (! strcmp(key, "linkpath"))) || (! strcmp(key, "path"))){
+            if ((tmp = strdup(value))){
+                free(long_paths[i]);
+                long_paths[i] = tmp;
+            }
+        }
+    }
+}
+
+
+/**
+ * @brief skip the specified number of bytes of the archive.
+ *
+ * @param[in]  fd  file descriptor for the archive
+ * @param[in]  size  the number of bytes to be skipped
+ * @param[out] archive  variable to store the error number
+ * @return bool  successful or not
+ *
+ * @note tries 'lseek' first, which fails if the archive is read through a pipe.
+ */
+static bool skip_archive(int fd, uint64_t size, insp_archive *archive){
+    assert(fd >= 0);
+    assert(archive);
+
+    unsigned char buf[INSP_TAR_BLOCK_SIZE * 16];
+    size_t len;
+    ssize_t read_size = 0;
+
+    if ((((off_t) size) >= 0) && (lseek(fd, ((off_t) size), SEEK_CUR) != -1))
+        return true;
+
+    for (; size; size -= len){
+        len = (size < sizeof(buf)) ? size : sizeof(buf);
+
+        if ((read_size = read_archive(fd, buf, len)) != ((ssize_t) len)){
+            archive->errid = (read_size < 0) ? errno : EBADMSG;
+            return false;
+        }
+    }
+
+    return true;
+}
+
+
+/**
+ * @brief read the specified number of bytes from the archive, unless it reaches EOF.
+ *
+ * @param[in]  fd  file descriptor for the archive
+ * @param[out] buf  buffer for storing the read bytes
+ * @param[in]  len  the number of bytes to be read
+ * @return ssize_t  the number of read bytes or -1 (syscall error)
+ */
+static ssize_t read_archive(int fd, void *buf, size_t len){
+    assert(fd >= 0);
+    assert(buf || (! len));
+
+    size_t total = 0;
+    ssize_t read_size;
+
+    while (total < len){
+        if ((read_size = read(fd, ((char *) buf + total), (len - total))) > 0)
+            total += read_size;
+        else if (! read_size)
+            break;
+        else if (errno != EINTR)
+            return -1;
+    }
+
+    return total;
+}
+
+
+/**
+ * @brief round up the size of the contents of the entry of the tar archive to a multiple of the block size.
+ *
+ * @param[in]  size  the size of the contents
+ * @return uint64_t  the size including the padding
+ */
+static uint64_t tar_padded(uint64_t size){
+    return (size + (INSP_TAR_BLOCK_SIZE - 1)) & ~((uint64_t) (INSP_TAR_BLOCK_SIZE - 1));
+}
+
+
+
+
+/**
+ * @brief read the entries of the zip archive from its central directory, mapping the archive into memory.
+ *
+ * @param[in]  fd  file descriptor for the archive
+ * @param[out] archive  variable to store the entries of the archive
+ *
+ * @note supports the ZIP64 format, along with the extra field of Info-ZIP for the owner of each entry.
+ * @note the mode of each entry is taken from its external attributes if it was archived on Unix.
+ */
+static void read_zip_entries(int fd, insp_archive *archive){
+    assert(fd >= 0);
+    assert(archive);
+
+    struct stat file_stat;
+    const unsigned char *map, *p, *end, *name, *extra;
+    size_t size, pos, name_len, extra_len, comment_len;
+    uint64_t entries_num, cd_size, cd_offset, offset, values[3], i;
+    insp_entry entry;
+
+    if (fstat(fd, &file_stat)){
+        archive->errid = errno;
+        return;
+    }
+    if ((size = file_stat.st_size) < INSP_ZIP_EOCD_SIZE){
+        archive->errid = EBADMSG;
+        return;
+    }
+    if ((map = mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0)) == MAP_FAILED){
+        archive->errid = errno;
+        return;
+    }
+
+    // the end of central directory record is followed by a comment of at most 65535 bytes
+    for (pos = size - INSP_ZIP_EOCD_SIZE; get_le(map + pos, 4) != INSP_ZIP_EOCD_SIG; pos--)
+        if ((! pos) || ((size - INSP_ZIP_EOCD_SIZE - pos) >= UINT16_MAX)){
+            archive->errid = EBADMSG;
+            goto exit;
+        }
+
+    p = map + pos;
+    entries_num = get_le(p + 10, 2);
+    cd_size = get_le(p + 12, 4);
+    cd_offset = get_le(p + 16, 4);
+
+    if ((pos >= 20) && (get_le(p - 20, 4) == INSP_ZIP64_LOCATOR_SIG)){
+        offset = get_le(p - 12, 8);
+
+        if ((size >= INSP_ZIP64_EOCD_SIZE) && (offset <= (size - INSP_ZIP64_EOCD_SIZE))
+                                           && (get_le(map + offset, 4) == INSP_ZIP64_EOCD_SIG)){
+            entries_num = get_le(map + offset + 32, 8);
+            cd_size = get_le(map + offset + 40, 8);
+            cd_offset = get_le(map + offset + 48, 8);
+        }
+    }
+
+    if ((cd_offset > size) || (cd_size > (size - cd_offset))){
+        archive->errid = EBADMSG;
+        goto exit;
+    }
+
+    p = map + cd_offset;
+    end = p + cd_size;
+
+    for (i = 0; i < entries_num; i++){
+        if (((end - p) < INSP_ZIP_CDH_SIZE) || (get_le(p, 4) != INSP_ZIP_CDH_SIG)){
+            archive->errid = EBADMSG;
+            break;
+        }
+
+        name_len = get_le(p + 28, 2);
+        extra_len = get_le(p + 30, 2);
+        comment_len = get_le(p + 32, 2);
+
+        if (((size_t) (end - p)) < (INSP_ZIP_CDH_SIZE + name_len + extra_len + comment_len)){
+            archive->errid = EBADMSG;
+            break;
+        }
+
+        name = p + INSP_ZIP_CDH_SIZE;
+        extra = name + name_len;
+
+        values[0] = get_le(p + 24, 4);
+        values[1] = get_le(p + 20, 4);
+        values[2] = get_le(p + 42, 4);
+
+        entry.uid = 0;
+        entry.gid = 0;
+        entry.link_path = NULL;
+
+        parse_zip_extra(extra, extra_len, values, &entry);
+
+        entry.size = values[0];
+        offset = values[2];
+
+        if (((get_le(p + 4, 2) >> 8) == INSP_ZIP_UNIX) && (get_le(p + 38, 4) >> 16))
+            entry.mode = get_le(p + 38, 4) >> 16;
+        else if ((name_len && (name[name_len - 1] == '/')) || (get_le(p + 38, 4) & INSP_ZIP_MSDOS_DIR))
+            entry.mode = S_IFDIR | 0755;
+        else
+            entry.mode = S_IFREG | 0644;
+
+        if (S_ISDIR(entry.mode))
+            entry.size = 0;
+
+        // the target of a symbolic link is stored as its contents, which can be read only if not compressed
+        if (S_ISLNK(entry.mode) && (! get_le(p + 10, 2))
+                                && (size >= INSP_ZIP_LFH_SIZE) && (offset <= (size - INSP_ZIP_LFH_SIZE))){
+            pos = offset + INSP_ZIP_LFH_SIZE + get_le(map + offset + 26, 2) + get_le(map + offset + 28, 2);
+
+            if ((get_le(map + offset, 4) == INSP_ZIP_LFH_SIG) && (pos <= size) && (values[1] <= (size - pos)))
+                entry.link_path = strndup((const char *) (map + pos), values[1]);
+        }
+
+        if (S_ISLNK(entry.mode) && (! entry.link_path))
+            entry.link_path = strdup("");
+
+        entry.path = strndup((const char *) name, name_len);
+
+        if (! append_entry(archive, &entry)){
+            archive->errid = ENOMEM;
+            break;
+        }
+
+        p = extra + extra_len + comment_len;
+    }
+
+exit:
+    munmap((void *) map, size);
+}
+
+
+/**
+ * @brief parse the extra field of the central directory header of the zip archive.
+ *
+ * @param[in]  extra  the extra field
+ * @param[in]  len  the length of the extra field
+ * @param[out] values  array of length 3 for the uncompressed size, the compressed size and the local header offset
+ * @param[out] entry  variable to store the owner of the entry
+ *
+ * @note the ZIP64 field holds the 8-byte values only for the 4-byte ones that are saturated, in the above order.
+ */
+static void parse_zip_extra(const unsigned char *extra, size_t len, uint64_t values[3], insp_entry *entry){
+    assert(extra || (! len));
+    assert(values);
+    assert(entry);
+
+    const unsigned char *p, *end;
+    size_t id, data_len, id_len, i;
+
+    for (end = extra + len; (end - extra) >= 4; extra = p + data_len){
+        id = get_le(extra, 2);
+        data_len = get_le((extra + 2), 2);
+        p = extra + 4;
+
+        if (((size_t) (end - p)) < data_len)
+            break;
+
+        if (id == INSP_ZIP64_EXTRA_ID){
+            for (i = 0, len = 0; i < 3; i++)
+                if ((values[i] == UINT32_MAX) && ((data_len - len) >= 8)){
+                    values[i] = get_le((p + len), 8);
+                    len += 8;
+                }
+        }
+        else if ((id == INSP_ZIP_UNIX_EXTRA_ID) && (data_len >= 3) && (p[1] <= 8) && (data_len >= (3 + p[1]))){
+            entry->uid = get_le((p + 2), p[1]);
+            id_len = p[2 + p[1]];
+
+            if ((id_len <= 8) && (data_len >= (3 + p[1] + id_len)))
+                entry->gid = get_le((p + 3 + p[1]), id_len);
+        }
+    }
+}
+
+
+/**
+ * @brief read the little-endian unsigned integer.
+ *
+ * @param[in]  p  pointer to the integer
+ * @param[in]  len  the length of the integer, which is 8 or less
+ * @return uint64_t  the resulting value
+ */
+static uint64_t get_le(const unsigned char *p, size_t len){
+    assert(p || (! len));
+    assert(len <= 8);
+
+    uint64_t value = 0;
+
+    while (len--)
+        value = (value << 8) | p[len];
+
+    return value;
+}
+
+
+
+
+/**
+ * @brief append the entry to the entries of the archive, normalizing its path.
+ *
+ * @param[out] archive  variable to store the entries of the archive
+ * @param[out] entry  the entry, whose dynamic memory is handed over or released
+ * @return bool  successful or not
+ *
+ * @note the empty and '.' components of the path are removed, and the entry is dropped if nothing remains.
+ * @note each '..' component removes the one before it, and the entry is dropped if it goes above the archive.
+ * @note the leading slashes of an absolute path are removed as empty components, as tar does.
+ */
+static bool append_entry(insp_archive *archive, insp_entry *entry){
+    assert(archive);
+    assert(entry);
+
+    char *src, *dest;
+
+    if (! (entry->path && (entry->link_path || (! S_ISLNK(entry->mode)))))
+        goto error;
+
+    for (src = (dest = entry->path); *src;){
+        if ((*src == '/') || ((src[0] == '.') && ((src[1] == '/') || (! src[1])))){
+            src++;
+            continue;
+        }
+
+        if ((src[0] == '.') && (src[1] == '.') && ((src[2] == '/') || (! src[2]))){
+            if (dest == entry->path){
+                archive->escaped = true;
+                break;
+            }
+
+            while ((--dest > entry->path) && (*dest != '/'));
+            src += 2;
+            continue;
+        }
+
+        if (dest != entry->path)
+            *(dest++) = '/';
+        while (*src && (*src != '/'))
+            *(dest++) = *(src++);
+    }
+    *dest = '\0';
+
+    if (! *(entry->path)){
+        free(entry->path);
+        free(entry->link_path);
+        return true;
+    }
+
+    if (archive->entries_num == archive->entries_max){
+        size_t curr_max;
+        void *ptr;
+
+        if ((curr_max = archive->entries_max)){
+            curr_max++;
+            assert(! (curr_max & (curr_max - 1)));
+
+            if (! (curr_max <<= 1))
+                goto error;
+            curr_max--;
+        }
+        else
+            curr_max = INSP_INITIAL_ENTRIES_MAX;
+
+        if (! (ptr = realloc(archive->entries, (sizeof(insp_entry) * curr_max))))
+            goto error;
+
+        archive->entries = (insp_entry *) ptr;
+        archive->entries_max = curr_max;
+    }
+
+    entry->index = archive->entries_num;
+    archive->entries[archive->entries_num++] = *entry;
+
+    return true;
+
+error:
+    free(entry->path);
+    free(entry->link_path);
+    return false;
+}
+
+
+/**
+ * @brief build the tree of the entries of the archive under the regular file.
+ *
+ * @param[out] file  the regular file
+ * @param[out] archive  variable to store the entries of the archive, whose link paths are handed over
+ * @return bool  successful or not
+ *
+ * @note sorts the entries so that each directory comes just before its descendants, and the last duplicate wins.
+ * @note any missing directory in the path of an entry is complemented.
+ * @note as when extracting in order, a non-directory replaces the earlier descendants of the same path, and is
+ *   replaced by a later one in turn, so that each name appears only once in each directory.
+ */
+static bool build_archive_tree(file_node *file, insp_archive *archive){
+    assert(file);
+    assert(archive);
+
+    file_node root = {0}, *node, *dir, *last = NULL;
+    struct {
+        file_node *dir;
+        const char *path;
+        size_t len;
+        size_t since;
+    } *stack = NULL;
+    size_t depth = 0, stack_max = 0, i, len, since, last_index = 0, dup_since = 0;
+    insp_entry *entry;
+    const char *name, *slash;
+    void *ptr;
+    bool success = true;
+
+    if (! archive->entries_num)
+        return true;
+
+    qsort(archive->entries, archive->entries_num, sizeof(insp_entry), qcmp_entry);
+    root.mode = S_IFDIR;
+
+    for (i = 0, entry = archive->entries; success && (i < archive->entries_num); i++, entry++){
+        if (((i + 1) < archive->entries_num) && (! strcmp(entry->path, entry[1].path))){
+            if (! S_ISDIR(entry->mode))
+                dup_since = entry->index;
+            continue;
+        }
+
+        while (depth && (strncmp(entry->path, stack[depth - 1].path, stack[depth - 1].len)
+                      || (entry->path[stack[depth - 1].len] != '/')))
+            depth--;
+
+        name = entry->path + (depth ? (stack[depth - 1].len + 1) : 0);
+        since = depth ? stack[depth - 1].since : 0;
+
+        // the entries before a non-directory that replaced one of their ancestors are no longer there
+        if (entry->index < since){
+            dup_since = 0;
+            continue;
+        }
+
+        do {
+            slash = strchr(name, '/');
+            len = slash ? ((size_t) (slash - name)) : strlen(name);
+            dir = depth ? stack[depth - 1].dir : &root;
+
+            // only the last non-directory can have the same name, since it comes just before its descendants
+            if (slash && last && dir->children_num && (dir->children[dir->children_num - 1] == last) &&
+                (! strncmp(last->name, name, len)) && (! last->name[len]))
+            {
+                if (entry->index < last_index)
+                    break;
+
+                dir->size -= last->size;
+                dir->children_num--;
+                destruct_dir_tree(last, NULL, 0);
+
+                last = NULL;
+                if (since < last_index)
+                    since = last_index;
+            }
+
+            if (! (node = new_archived_file(name, len, (slash ? NULL : entry)))){
+                success = false;
+                break;
+            }
+            if (! append_file(dir, node)){
+                destruct_dir_tree(node, NULL, 0);
+                success = false;
+                break;
+            }
+
+            if (S_ISDIR(node->mode)){
+                if (depth == stack_max){
+                    stack_max = stack_max ? (stack_max * 2) : INSP_INITIAL_DIRS_MAX;
+
+                    if (! (ptr = realloc(stack, (sizeof(*stack) * stack_max)))){
+                        success = false;
+                        break;
+                    }
+                    stack = ptr;
+                }
+
+                stack[depth].dir = node;
+                stack[depth].path = entry->path;
+                stack[depth].len = (name - entry->path) + len;
+                stack[depth++].since = ((! slash) && (since < dup_since)) ? dup_since : since;
+            }
+            else {
+                last = node;
+                last_index = entry->index;
+            }
+
+            name = slash + 1;
+        } while (slash);
+
+        dup_since = 0;
+    }
+
+    free(stack);
+
+    if (success){
+        settle_archive_tree(&root);
+
+        file->children = root.children;
+        file->children_num = root.children_num;
+        file->children_max = root.children_max;
+    }
+    else {
+        for (i = root.children_num; i--;)
+            destruct_dir_tree(root.children[i], NULL, 0);
+        free(root.children);
+    }
+
+    return success;
+}
+
+
+/**
+ * @brief create new element that represents the entry of the archive.
+ *
+ * @param[in]  name  the name of the entry (may not be null-terminated)
+ * @param[in]  len  the length of the name
+ * @param[out] entry  the entry, whose link path is handed over, or NULL for a missing directory
+ * @return file_node*  new element that makes up the directory tree
+ */
+static file_node *new_archived_file(const char *name, size_t len, insp_entry *entry){
+    assert(name);
+
+    file_node *file;
+
+    if ((file = (file_node *) calloc(1, sizeof(file_node)))){
+        if ((file->name = strndup(name, len))){
+            if (entry){
+                file->mode = entry->mode;
+                file->uid = entry->uid;
+                file->gid = entry->gid;
+                file->size = entry->size;
+
+                file->link_path = entry->link_path;
+                entry->link_path = NULL;
+            }
+            else
+                file->mode = S_IFDIR | 0755;
+
+            return file;
+        }
+        free(file);
+    }
+
+    return NULL;
+}
+
+
+/**
+ * @brief sum up the sizes of the descendants of each directory in the archive and sort its children, recursively.
+ *
+ * @param[out] dir  the directory we are currently looking at
+ *
+ * @note the estimates of each entry are regarded as its size, since the entries are not extracted.
+ */
+static void settle_archive_tree(file_node *dir){
+    assert(dir);
+    assert(S_ISDIR(dir->mode));
+
+    file_node * const *p_file;
+    size_t size;
+
+    dir->size = 0;
+
+    for (size = dir->children_num, p_file = dir->children; size; size--, p_file++){
+        if (S_ISDIR((*p_file)->mode))
+            settle_archive_tree(*p_file);
+
+        (*p_file)->gzip_size = (*p_file)->size;
+        (*p_file)->zstd_size = (*p_file)->size;
+        dir->size += (*p_file)->size;
+    }
+
+    if (dir->children)
+        qsort(dir->children, dir->children_num, sizeof(file_node *), qcmp);
+}
+
+
+/**
+ * @brief comparison function used when sorting the entries of the archive by their paths.
+ *
+ * @param[in]  a  pointer to entry1
+ * @param[in]  b  pointer to entry2
+ * @return int  comparison result
+ *
+ * @note a slash is regarded as the smallest character, so that the descendants of each directory are contiguous.
+ * @note the entries with the same path are kept in the order in which they appear in the archive.
+ */
+static int qcmp_entry(const void *a, const void *b){
+    assert(a);
+    assert(b);
+
+    const insp_entry *entry1, *entry2;
+    const unsigned char *s1, *s2;
+    int c1, c2;
+
+    entry1 = (const insp_entry *) a;
+    entry2 = (const insp_entry *) b;
+
+    s1 = (const unsigned char *) entry1->path;
+    s2 = (const unsigned char *) entry2->path;
+
+    while (*s1 && (*s1 == *s2)){
+        s1++;
+        s2++;
+    }
+
+    c1 = (*s1 == '/') ? 1 : *s1;
+    c2 = (*s2 == '/') ? 1 : *s2;
+
+    if (c1 != c2)
+        return c1 - c2;
+    return (entry1->index > entry2->index) - (entry1->index < entry2->index);
+}
+
+
+
+
+/******************************************************************************
+    * Estimate Phase
+******************************************************************************/
+
+
+/**
+ * @brief estimate the compressed size of each file in the directory tree, in parallel.
+ *
+ * @param[out] tree  the directory tree
+ *
+ * @note any file that could not be estimated is regarded as incompressible.
+ * @note the estimates of each directory are the sums of those of its descendants.
+ */
+static void estimate_dir_tree(file_node *tree){
+    assert(tree);
+
+    char path[PATH_MAX];
+    insp_jobs jobs = {0};
+    size_t i;
+
+    if (collect_estimate_jobs(tree, path, 0, &jobs) && jobs.jobs_num)
+        run_jobs(&jobs, estimate_worker);
+
+    for (i = jobs.jobs_num; i--;)
+        free(jobs.jobs[i].path);
+    free(jobs.jobs);
+
+    sum_estimates(tree);
+}
+
+
+/**
+ * @brief process the collected files, dividing them among the workers.
+ *
+ * @param[out] jobs  the collected files, which are assumed to be at least one
+ * @param[in]  worker  function that processes the files taken one by one from 'jobs'
+ *
+ * @note the calling thread also works as one of the workers.
+ * @note the contents are read with the privileges of the real user, since this tool is a setuid program.
+ *   The effective user ID is switched before any worker starts, since it is shared by all the threads.
+ */
+static void run_jobs(insp_jobs *jobs, void *(* worker)(void *)){
+    assert(jobs);
+    assert(jobs->jobs_num);
+    assert(worker);
+
+    pthread_t workers[INSP_WORKERS_MAX];
+    long workers_num;
+    size_t i;
+    uid_t ruid, euid;
+
+    ruid = getuid();
+    euid = geteuid();
+
+    if ((ruid != euid) && seteuid(ruid))
+        return;
+
+    atomic_init(&(jobs->next), 0);
+
+    workers_num = sysconf(_SC_NPROCESSORS_ONLN);
+    if (workers_num > INSP_WORKERS_MAX)
+        workers_num = INSP_WORKERS_MAX;
+    if (workers_num > ((long) jobs->jobs_num))
+        workers_num = jobs->jobs_num;
+
+    for (i = 1; ((long) i) < workers_num; i++)
+        if (pthread_create((workers + i), NULL, worker, jobs))
+            break;
+
+    worker(jobs);
+
+    while (--i)
+        pthread_join(workers[i], NULL);
+
+    // if this fails, the rest is simply done with the privileges of the real user
+    if (ruid != euid)
+        seteuid(euid);
+}
+
+
+/**
+ * @brief collect the regular files in the directory tree, recursively.
+ *
+ * @param[out] file  the file we are currently looking at
+ * @param[out] path  buffer for storing the path of the file, which is assumed to be PATH_MAX long
+ * @param[in]  len  the length of the path of its parent directory
+ * @param[out] jobs  variable to store the collected files
+ * @return bool  successful or not
+ *
+ * @note initializes the estimates of each file to its size, which are overwritten by the workers.
+ */
+static bool collect_estimate_jobs(file_node *file, char *path, size_t len, insp_jobs *jobs){
+    assert(file);
+    assert(file->name);
+    assert(path);
+    assert(jobs);
+
+    int tmp;
+    file_node * const *p_file;
+    size_t size;
+
+    file->gzip_size = file->size;
+    file->zstd_size = file->size;
+
+    tmp = snprintf((path + len), (PATH_MAX - len), (len ? "/%s" : "%s"), file->name);
+    if ((tmp < 0) || ((size_t) tmp >= (PATH_MAX - len)))
+        return true;
+    len += tmp;
+
+    if (S_ISREG(file->mode) && file->size && (! append_job(jobs, file, path)))
+        return false;
+
+    // the entries of an archive have already been initialized, and cannot be opened by the workers
+    if (S_ISDIR(file->mode))
+        for (size = file->children_num, p_file = file->children; size; size--, p_file++)
+            if (! collect_estimate_jobs(*p_file, path, len, jobs))
+                return false;
+
+    return true;
+}
+
+
+/**
+ * @brief append the file to the files to be processed by the workers.
+ *
+ * @param[out] jobs  variable to store the collected files
+ * @param[in]  file  the file to be processed
+ * @param[in]  path  path of the file from the current working directory, which is copied
+ * @return bool  successful or not
+ */
+static bool append_job(insp_jobs *jobs, file_node *file, const char *path){
+    assert(jobs);
+    assert(file);
+    assert(path);
+
+    if (jobs->jobs_num == jobs->jobs_max){
+        size_t curr_max;
+        void *ptr;
+
+        if ((curr_max = jobs->jobs_max)){
+            curr_max++;
+            assert(! (curr_max & (curr_max - 1)));
+
+            if (! (curr_max <<= 1))
+                return false;
+            curr_max--;
+        }
+        else
+            curr_max = INSP_INITIAL_JOBS_MAX;
+
+        if (! (ptr = realloc(jobs->jobs, (sizeof(*(jobs->jobs)) * curr_max))))
+            return false;
+
+        jobs->jobs = ptr;
+        jobs->jobs_max = curr_max;
+    }
+
+    if (! (jobs->jobs[jobs->jobs_num].path = strdup(path)))
+        return false;
+    jobs->jobs[jobs->jobs_num++].file = file;
+
+    return true;
+}
+
+
+/**
+ * @brief estimate the compressed size of the files taken one by one from the shared array.
+ *
+ * @param[out] arg  the shared array of the files to be estimated
+ * @return void*  NULL
+ *
+ * @note each worker writes only to the file nodes it has taken, so that no locking is required.
+ */
+static void *estimate_worker(void *arg){
+    assert(arg);
+
+    insp_jobs *jobs;
+    unsigned char *buf;
+    uint32_t *table;
+    size_t i;
+
+    jobs = (insp_jobs *) arg;
+    buf = (unsigned char *) malloc(INSP_SAMPLE_WHOLE_MAX);
+    table = (uint32_t *) malloc(sizeof(uint32_t) << INSP_HASH_BITS);
+
+    if (buf && table)
+        while ((i = atomic_fetch_add(&(jobs->next), 1)) < jobs->jobs_num)
+            estimate_file(jobs->jobs[i].file, jobs->jobs[i].path, buf, table);
+
+    free(buf);
+    free(table);
+    return NULL;
+}
+
+
+/**
+ * @brief estimate the compressed size of the specified regular file.
+ *
+ * @param[out] file  the file to be estimated
+ * @param[in]  path  path of the file
+ * @param[out] buf  buffer that is INSP_SAMPLE_WHOLE_MAX bytes long
+ * @param[out] table  hash table used by the LZ77 parse
+ *
+ * @note a file larger than INSP_SAMPLE_WHOLE_MAX is estimated from evenly spaced blocks of it.
+ */
+static void estimate_file(file_node *file, const char *path, unsigned char *buf, uint32_t *table){
+    assert(file);
+    assert(path);
+    assert(buf);
+    assert(table);
+
+    int fd;
+    off_t offset;
+    size_t len, sampled = 0;
+    ssize_t tmp;
+    double gzip = 0, zstd = 0, ratio;
+
+    if ((fd = open(path, (O_RDONLY | O_NOFOLLOW))) == -1)
+        return;
+
+    if (file->size <= INSP_SAMPLE_WHOLE_MAX){
+        for (len = 0; len < ((size_t) file->size); len += tmp)
+            if ((tmp = read(fd, (buf + len), (file->size - len))) <= 0)
+                break;
+
+        if (len){
+            estimate_block(buf, len, table, &gzip, &zstd);
+            sampled = len;
+        }
+    }
+    else
+        for (int i = 0; i < INSP_SAMPLE_BLOCKS_NUM; i++){
+            offset = (file->size - INSP_SAMPLE_BLOCK_SIZE) / (INSP_SAMPLE_BLOCKS_NUM - 1) * i;
+
+            if ((tmp = pread(fd, buf, INSP_SAMPLE_BLOCK_SIZE, offset)) <= 0)
+                break;
+
+            estimate_block(buf, tmp, table, &gzip, &zstd);
+            sampled += tmp;
+        }
+
+    close(fd);
+
+    if (sampled){
+        ratio = ((double) file->size) / sampled;
+        file->gzip_size = ceil(gzip * ratio);
+        file->zstd_size = ceil(zstd * ratio);
+    }
+}
+
+
+/**
+ * @brief estimate the compressed size of the specified block, and add it to the running totals.
+ *
+ * @param[in]  buf  the block
+ * @param[in]  len  the length of the block
+ * @param[out] table  hash table used by the LZ77 parse
+ * @param[out] gzip  the running total of the size when compressed by gzip
+ * @param[out] zstd  the running total of the size when compressed by zstd
+ *
+ * @note each estimate is capped at the size when the block is stored as is by the compressor.
+ */
+static void estimate_block(const unsigned char *buf, size_t len, uint32_t *table, double *gzip, double *zstd){
+    assert(buf);
+    assert(len);
+    assert(table);
+    assert(gzip);
+    assert(zstd);
+
+    double gzip_bytes, zstd_bytes, stored;
+
+    gzip_bytes = estimate_lz_bits(buf, len, table, &gzip_profile) / 8;
+    stored = len + 5 * (len / 65535 + 1);
+    if (gzip_bytes > stored)
+        gzip_bytes = stored;
+
+    zstd_bytes = estimate_lz_bits(buf, len, table, &zstd_profile) / 8;
+    stored = len + 3 * (len / 131072 + 1);
+    if (zstd_bytes > stored)
+        zstd_bytes = stored;
+    if (zstd_bytes > gzip_bytes)
+        zstd_bytes = gzip_bytes;
+
+    *gzip += gzip_bytes;
+    *zstd += zstd_bytes;
+}
+
+
+/**
+ * @brief estimate the number of bits the specified block is compressed into by a greedy LZ77 parse.
+ *
+ * @param[in]  buf  the block
+ * @param[in]  len  the length of the block, which must not exceed INSP_SAMPLE_WHOLE_MAX
+ * @param[out] table  hash table that maps the first 4 bytes of each position to the latest position
+ * @param[in]  prof  the parameters imitating a certain compressor
+ * @return double  the estimated number of bits
+ *
+ * @note each match costs its fixed cost plus the bits needed to represent its distance and length.
+ * @note the literals are assumed to be entropy-coded with their order-0 statistics.
+ */
+static double estimate_lz_bits(const unsigned char *buf, size_t len, uint32_t *table, const lz_profile *prof){
+    assert(buf);
+    assert(len <= INSP_SAMPLE_WHOLE_MAX);
+    assert(table);
+    assert(prof);
+
+    size_t counts[UCHAR_MAX + 1] = {0}, literals = 0, i = 0, end, match, dist = 0;
+    uint32_t hash, prev;
+    double bits = 0;
+
+    memset(table, 0xff, (sizeof(uint32_t) << INSP_HASH_BITS));
+
+    while (i < len){
+        match = 0;
+
+        if ((i + 4) <= len){
+            memcpy(&hash, (buf + i), 4);
+            hash = (hash * 2654435761U) >> (32 - INSP_HASH_BITS);
+
+            prev = table[hash];
+            table[hash] = i;
+
+            if ((prev != UINT32_MAX) && ((dist = i - prev) <= prof->window) && (! memcmp((buf + i), (buf + prev), 4)))
+                for (match = 4; ((i + match) < len) && (match < prof->match_max); match++)
+                    if (buf[i + match] != buf[prev + match])
+                        break;
+        }
+
+        if (match){
+            bits += prof->match_bits + log2(dist) + log2(match);
+
+            for (end = i + match; ++i < end;)
+                if ((i + 4) <= len){
+                    memcpy(&hash, (buf + i), 4);
+                    table[(hash * 2654435761U) >> (32 - INSP_HASH_BITS)] = i;
+                }
+        }
+        else {
+            counts[buf[i++]]++;
+            literals++;
+        }
+    }
+
+    for (i = 0; i <= UCHAR_MAX; i++)
+        if (counts[i])
+            bits -= counts[i] * log2(((double) counts[i]) / literals);
+
+    return bits;
+}
+
+
+/**
+ * @brief add up the estimates of the descendants of each directory, recursively.
+ *
+ * @param[out] file  the file we are currently looking at
+ *
+ * @note the size of the directory itself is regarded as incompressible, like that of other special files.
+ */
+static void sum_estimates(file_node *file){
+    assert(file);
+
+    file_node * const *p_file;
+    size_t size;
+
+    for (size = file->children_num, p_file = file->children; size; size--, p_file++){
+        sum_estimates(*p_file);
+
+        file->gzip_size += (*p_file)->gzip_size - (*p_file)->size;
+        file->zstd_size += (*p_file)->zstd_size - (*p_file)->size;
+    }
+}
+
+
+
+
+/******************************************************************************
+    * Compare Phase
+******************************************************************************/
+
+
+/**
+ * @brief compare the two directory trees, hashing the regular files whose contents remain to be compared.
+ *
+ * @param[in]  trees  array of length 2 for the directory trees, whose children are sorted by name
+ * @param[in]  cache_file  name of the file for caching the hash values across runs, or NULL
+ * @param[out] diff  variable to store the entries that differ, which is assumed to be zero-initialized
+ * @return bool  successful or not
+ *
+ * @note the hash value of a file is reused as long as its device, inode, mtime, ctime and size are unchanged.
+ * @note the contents of a pair of files are regarded as unknown if either of them could not be hashed.
+ */
+static bool compare_dir_trees(file_node *trees[2], const char *cache_file, insp_diff *diff){
+    assert(trees);
+    assert(trees[0]);
+    assert(trees[1]);
+    assert(diff);
+
+    size_t lens[2], i;
+    int side;
+    insp_change *change;
+    bool success = false;
+
+    for (side = 0; side < 2; side++){
+        if (! (lens[side] = extend_path(diff, side, 0, trees[side]->name)))
+            return false;
+        diff->roots_len[side] = lens[side];
+    }
+
+    if (cache_file)
+        read_snapshots(diff, cache_file);
+
+    if (compare_files(diff, trees[0], trees[1], lens)){
+        if (diff->jobs.jobs_num)
+            run_jobs(&(diff->jobs), hash_worker);
+
+        for (i = 0, change = diff->changes; i < diff->changes_num; i++, change++)
+            if (change->files[0]){
+                assert(change->files[1]);
+
+                if (change->files[0]->hashed && change->files[1]->hashed)
+                    change->change_c = (change->files[0]->hash == change->files[1]->hash) ? '\0' : 'C';
+                else
+                    change->change_c = '?';
+            }
+
+        if (cache_file)
+            write_snapshots(diff, cache_file);
+
+        success = true;
+    }
+
+    for (i = diff->jobs.jobs_num; i--;)
+        free(diff->jobs.jobs[i].path);
+    free(diff->jobs.jobs);
+    free(diff->snaps);
+
+    diff->jobs = (insp_jobs) {0};
+    diff->snaps = NULL;
+    diff->snaps_num = 0;
+
+    return success;
+}
+
+
+/**
+ * @brief compare the two files that are at the same relative path, recursively.
+ *
+ * @param[out] diff  variable to store the entries that differ
+ * @param[in]  file1  the file on the first side
+ * @param[in]  file2  the file on the second side
+ * @param[in]  lens  the length of the path of each file, which is stored in 'diff->paths'
+ * @return bool  successful or not
+ *
+ * @note the contents of regular files of the same non-zero size are compared later by their hash values.
+ * @note an entry that exists on only one side is recorded without its descendants.
+ */
+static bool compare_files(insp_diff *diff, file_node *file1, file_node *file2, const size_t lens[2]){
+    assert(diff);
+    assert(file1);
+    assert(file2);
+    assert(lens);
+
+    int change_c = '\0';
+    bool meta;
+    insp_change *change;
+    file_node * const *children1, * const *children2;
+    size_t i, j, next_lens[2];
+    int tmp;
+
+    if (file1->noinfo || file2->noinfo)
+        return append_change(diff, 0, file1, '?', false);
+
+    if ((file1->mode & S_IFMT) != (file2->mode & S_IFMT))
+        return append_change(diff, 0, file1, '-', false) && append_change(diff, 1, file2, '+', false);
+
+    meta = (file1->mode != file2->mode) || (file1->uid != file2->uid) || (file1->gid != file2->gid);
+
+    if (S_ISREG(file1->mode)){
+        if (file1->size != file2->size)
+            change_c = 'C';
+        else if (file1->size){
+            if (! (change = append_change(diff, 0, file1, '\0', meta)))
+                return false;
+
+            change->files[0] = file1;
+            change->files[1] = file2;
+
+            return request_hash(diff, file1, 0) && request_hash(diff, file2, 1);
+        }
+    }
+    else if (S_ISLNK(file1->mode)){
+        if (strcmp((file1->link_path ? file1->link_path : ""), (file2->link_path ? file2->link_path : "")))
+            change_c = 'C';
+    }
+    else if (S_ISDIR(file1->mode) && (file1->errid || file2->errid))
+        change_c = '?';
+
+    if ((change_c || meta) && (! append_change(diff, 0, file1, change_c, meta)))
+        return false;
+
+    if (! (S_ISDIR(file1->mode) && (change_c != '?')))
+        return true;
+
+    children1 = file1->children;
+    children2 = file2->children;
+    i = 0;
+    j = 0;
+
+    while ((i < file1->children_num) || (j < file2->children_num)){
+        if (i == file1->children_num)
+            tmp = 1;
+        else if (j == file2->children_num)
+            tmp = -1;
+        else
+            tmp = strcmp(children1[i]->name, children2[j]->name);
+
+        if (tmp <= 0)
+            if (! (next_lens[0] = extend_path(diff, 0, lens[0], children1[i]->name)))
+                return false;
+        if (tmp >= 0)
+            if (! (next_lens[1] = extend_path(diff, 1, lens[1], children2[j]->name)))
+                return false;
+
+        if (tmp < 0){
+            if (! append_change(diff, 0, children1[i], '-', false))
+                return false;
+            i++;
+        }
+        else if (tmp > 0){
+            if (! append_change(diff, 1, children2[j], '+', false))
+                return false;
+            j++;
+        }
+        else {
+            if (! compare_files(diff, children1[i], children2[j], next_lens))
+                return false;
+            i++;
+            j++;
+        }
+    }
+
+    return true;
+}
+
+
+/**
+ * @brief append the file name to the path on the specified side.
+ *
+ * @param[out] diff  variable to store the path on each side
+ * @param[in]  side  0 or 1
+ * @param[in]  len  the length of the path of its parent directory, or 0 for the root
+ * @param[in]  name  the file name
+ * @return size_t  the length of the resulting path, or 0 if it is too long
+ */
+static size_t extend_path(insp_diff *diff, int side, size_t len, const char *name){
+    assert(diff);
+    assert((side == 0) || (side == 1));
+    assert(len < PATH_MAX);
+    assert(name);
+
+    char *path;
+    int tmp;
+
+    path = diff->paths[side];
+    tmp = snprintf((path + len), (PATH_MAX - len), (len ? "/%s" : "%s"), name);
+
+    if ((tmp <= 0) || ((size_t) tmp >= (PATH_MAX - len))){
+        errno = ENAMETOOLONG;
+        return 0;
+    }
+
+    return len + tmp;
+}
+
+
+/**
+ * @brief append the entry at the current path on the specified side to the entries that differ.
+ *
+ * @param[out] diff  variable to store the entries that differ
+ * @param[in]  side  0 or 1
+ * @param[in]  file  the file at the current path, which determines whether to add a trailing slash
+ * @param[in]  change_c  the kind of change
+ * @param[in]  meta  whether the mode or the owner differs
+ * @return insp_change*  the appended entry, or NULL if failed
+ */
+static insp_change *append_change(insp_diff *diff, int side, const file_node *file, int change_c, bool meta){
+    assert(diff);
+    assert((side == 0) || (side == 1));
+    assert(file);
+
+    const char *path;
+    size_t len;
+    bool isdir;
+    insp_change *change;
+
+    if (diff->changes_num == diff->changes_max){
+        size_t curr_max;
+        void *ptr;
+
+        if ((curr_max = diff->changes_max)){
+            curr_max++;
+            assert(! (curr_max & (curr_max - 1)));
+
+            if (! (curr_max <<= 1))
+                return NULL;
+            curr_max--;
+        }
+        else
+            curr_max = INSP_INITIAL_CHANGES_MAX;
+
+        if (! (ptr = realloc(diff->changes, (sizeof(insp_change) * curr_max))))
+            return NULL;
+
+        diff->changes = ptr;
+        diff->changes_max = curr_max;
+    }
+
+    path = diff->paths[side] + diff->roots_len[side];
+    if (*path == '/')
+        path++;
+    else if (! *path)
+        path = ".";
+
+    len = strlen(path);
+    isdir = S_ISDIR(file->mode) && (! file->noinfo) && (path[len - 1] != '/');
+
+    change = diff->changes + diff->changes_num;
+
+    if (! (change->path = (char *) malloc(sizeof(char) * (len + 2))))
+        return NULL;
+
+    memcpy(change->path, path, (sizeof(char) * len));
+    if (isdir)
+        change->path[len++] = '/';
+    change->path[len] = '\0';
+
+    change->change_c = change_c;
+    change->meta = meta;
+    change->files[0] = NULL;
+    change->files[1] = NULL;
+
+    diff->changes_num++;
+    return change;
+}
+
+
+/**
+ * @brief obtain the hash value of the regular file from the cache, or have it hashed by the workers.
+ *
+ * @param[out] diff  variable to store the files to be hashed
+ * @param[out] file  the regular file at the current path on the specified side
+ * @param[in]  side  0 or 1
+ * @return bool  successful or not
+ */
+static bool request_hash(insp_diff *diff, file_node *file, int side){
+    assert(diff);
+    assert(file);
+    assert(S_ISREG(file->mode));
+    assert((side == 0) || (side == 1));
+
+    insp_snapshot key = {0};
+    const insp_snapshot *snap;
+
+    if (diff->snaps_num){
+        key.dev = file->dev;
+        key.ino = file->ino;
+
+        snap = bsearch(&key, diff->snaps, diff->snaps_num, sizeof(insp_snapshot), qcmp_snapshot);
+
+        // 'access' checks the real user, who must be able to read the file to learn its hash value
+        if (snap && (snap->mtime_sec == (uint64_t) file->mtime.tv_sec)
+                 && (snap->mtime_nsec == (uint64_t) file->mtime.tv_nsec)
+                 && (snap->ctime_sec == (uint64_t) file->ctime.tv_sec)
+                 && (snap->ctime_nsec == (uint64_t) file->ctime.tv_nsec)
+                 && (snap->size == (uint64_t) file->size)
+                 && (! access(diff->paths[side], R_OK))){
+            file->hash = snap->hash;
+            file->hashed = true;
+            return true;
         }
-        else
-            free(dest);
     }
 
-    return file;
+    return append_job(&(diff->jobs), file, diff->paths[side]);
 }
 
 
+/**
+ * @brief hash the regular files taken one by one from the shared array.
+ *
+ * @param[out] arg  the shared array of the files to be hashed
+ * @return void*  NULL
+ *
+ * @note each worker writes only to the file nodes it has taken, so that no locking is required.
+ */
+static void *hash_worker(void *arg){
+    assert(arg);
+
+    insp_jobs *jobs;
+    unsigned char *buf;
+    size_t i;
+
+    jobs = (insp_jobs *) arg;
+
+    if ((buf = (unsigned char *) malloc(INSP_HASH_BLOCK_SIZE))){
+        while ((i = atomic_fetch_add(&(jobs->next), 1)) < jobs->jobs_num)
+            hash_file(jobs->jobs[i].file, jobs->jobs[i].path, buf);
+
+        free(buf);
+    }
+
+    return NULL;
+}
 
 
 /**
- * @brief create new element that makes up the directory tree.
+ * @brief hash the contents of the specified regular file.
  *
- * @param[in]  pwdfd  file descriptor that serves as the current working directory
- * @param[in]  name  name of the file we are currently looking at
- * @return file_node*  new element that makes up the directory tree
+ * @param[out] file  the file to be hashed
+ * @param[in]  path  path of the file
+ * @param[out] buf  buffer that is INSP_HASH_BLOCK_SIZE bytes long
+ *
+ * @note FNV-1a, whose upper bits are folded at the end.
+ * @note the file is regarded as not hashed unless it is read to the end with the size obtained beforehand.
  */
-static file_node *new_file(int pwdfd, char *name){
-    assert((pwdfd >= 0) || (pwdfd == AT_FDCWD));
-    assert(name);
+static void hash_file(file_node *file, const char *path, unsigned char *buf){
+    assert(file);
+    assert(path);
+    assert(buf);
 
-    file_node *file;
-    struct stat file_stat;
+    int fd;
+    ssize_t got;
+    uint64_t hash, total = 0;
+    const unsigned char *p;
 
-    if ((file = (file_node *) calloc(1, sizeof(file_node)))){
-        file->name = name;
-        file->link_invalid = true;
+    if ((fd = open(path, (O_RDONLY | O_NOFOLLOW))) == -1)
+        return;
 
-        if (! fstatat(pwdfd, name, &file_stat, AT_SYMLINK_NOFOLLOW)){
-            file->mode = file_stat.st_mode;
-            file->uid = file_stat.st_uid;
-            file->gid = file_stat.st_gid;
-            file->size = (file_stat.st_size > 0) ? file_stat.st_size : 0;
+    hash = UINT64_C(14695981039346656037);
 
-            if (S_ISLNK(file_stat.st_mode)){
-                char *link_path;
-                ssize_t link_len;
+    while ((got = read(fd, buf, INSP_HASH_BLOCK_SIZE)) > 0){
+        total += got;
 
-                if ((link_path = (char *) malloc(sizeof(char) * (file->size + 1)))){
-                    link_len = readlinkat(pwdfd, name, link_path, file->size);
+        for (p = buf; got--; p++){
+            hash ^= *p;
+            hash *= UINT64_C(1099511628211);
+        }
+    }
 
-                    if (link_len > 0){
-                        if (! fstatat(pwdfd, name, &file_stat, 0)){
-                            file->link_mode = file_stat.st_mode;
-                            file->link_invalid = false;
-                        }
-                        else
-                            file->errid = errno;
-                    }
-                    else
-                        link_len = 0;
+    if ((! got) && (total == (uint64_t) file->size)){
+        file->hash = hash ^ (hash >> 29);
+        file->hashed = true;
+    }
 
-                    link_path[link_len] = '\0';
-                    file->link_path = link_path;
+    close(fd);
+}
+
+
+/**
+ * @brief read the snapshots of the files hashed so far from the cache.
+ *
+ * @param[out] diff  variable to store the snapshots
+ * @param[in]  cache_file  name of the cache file
+ *
+ * @note if the cache file cannot be read or is not consistent with its size, proceeds as if it were empty.
+ */
+static void read_snapshots(insp_diff *diff, const char *cache_file){
+    assert(diff);
+    assert(cache_file);
+
+    FILE *fp;
+    size_t snaps_num;
+    insp_snapshot *snaps;
+
+    if ((fp = fopen(cache_file, "rb"))){
+        if ((fread(&snaps_num, sizeof(size_t), 1, fp) == 1) && snaps_num && (snaps_num <= INSP_SNAPSHOTS_MAX)){
+            if ((snaps = (insp_snapshot *) malloc(sizeof(insp_snapshot) * snaps_num))){
+                // a cache written in another format has a different size, and is discarded as a whole
+                if ((fread(snaps, sizeof(insp_snapshot), snaps_num, fp) == snaps_num) && (getc(fp) == EOF)){
+                    qsort(snaps, snaps_num, sizeof(insp_snapshot), qcmp_snapshot);
+                    diff->snaps = snaps;
+                    diff->snaps_num = snaps_num;
                 }
+                else
+                    free(snaps);
             }
-            else
-                file->link_invalid = false;
-        }
-        else {
-            file->errid = errno;
-            file->noinfo = true;
         }
+        fclose(fp);
     }
-
-    return file;
 }
 
 
 /**
- * @brief append file to the directory tree under construction.
+ * @brief write the snapshots of the files hashed in this run and the still relevant ones of the past to the cache.
  *
- * @param[out] tree  the directory tree under construction
- * @param[in]  file  file to append to the directory tree
- * @return bool  successful or not
+ * @param[in]  diff  variable to store the hashed files and the snapshots read from the cache
+ * @param[in]  cache_file  name of the cache file
  *
- * @note any directory can have a virtually unlimited number of files.
+ * @note the snapshots of this run take precedence over the others when the cache is full.
  */
-static bool append_file(file_node *tree, file_node *file){
-    assert(tree);
-    assert(file);
+static void write_snapshots(const insp_diff *diff, const char *cache_file){
+    assert(diff);
+    assert(cache_file);
+
+    insp_snapshot *snaps, *snap;
+    size_t snaps_max, snaps_num = 0, news_num, i;
+    const file_node *file;
+    FILE *fp;
+
+    snaps_max = diff->jobs.jobs_num + diff->snaps_num;
+    if (snaps_max > INSP_SNAPSHOTS_MAX)
+        snaps_max = INSP_SNAPSHOTS_MAX;
+
+    if ((! snaps_max) || (! (snaps = (insp_snapshot *) malloc(sizeof(insp_snapshot) * snaps_max))))
+        return;
+
+    for (i = 0; (i < diff->jobs.jobs_num) && (snaps_num < snaps_max); i++){
+        file = diff->jobs.jobs[i].file;
+
+        if (file->hashed){
+            snap = snaps + snaps_num++;
+
+            snap->dev = file->dev;
+            snap->ino = file->ino;
+            snap->mtime_sec = file->mtime.tv_sec;
+            snap->mtime_nsec = file->mtime.tv_nsec;
+            snap->ctime_sec = file->ctime.tv_sec;
+            snap->ctime_nsec = file->ctime.tv_nsec;
+            snap->size = file->size;
+            snap->hash = file->hash;
+        }
+    }
 
-    if (tree->children_num == tree->children_max){
-        size_t curr_max;
-        void *ptr;
+    if (snaps_num){
+        qsort(snaps, snaps_num, sizeof(insp_snapshot), qcmp_snapshot);
 
-        if ((curr_max = tree->children_max)){
-            curr_max++;
-            assert(! (curr_max & (curr_max - 1)));
+        for (news_num = 1, i = 1; i < snaps_num; i++)
+            if (qcmp_snapshot((snaps + news_num - 1), (snaps + i)))
+                snaps[news_num++] = snaps[i];
+        snaps_num = news_num;
+    }
+    news_num = snaps_num;
 
-            if (! (curr_max <<= 1))
-                return false;
-            curr_max--;
-        }
-        else
-            curr_max = INSP_INITIAL_DIRS_MAX;
+    for (i = 0; (i < diff->snaps_num) && (snaps_num < snaps_max); i++)
+        if (! (news_num && bsearch((diff->snaps + i), snaps, news_num, sizeof(insp_snapshot), qcmp_snapshot)))
+            snaps[snaps_num++] = diff->snaps[i];
 
-        if (! (ptr = realloc(tree->children, (sizeof(file_node *) * curr_max))))
-            return false;
+    qsort(snaps, snaps_num, sizeof(insp_snapshot), qcmp_snapshot);
 
-        tree->children = (file_node **) ptr;
-        tree->children_max = curr_max;
+    if ((fp = fopen(cache_file, "wb"))){
+        if (fwrite(&snaps_num, sizeof(size_t), 1, fp) == 1)
+            fwrite(snaps, sizeof(insp_snapshot), snaps_num, fp);
+        fclose(fp);
     }
 
-    assert(tree->children);
+    free(snaps);
+}
 
-    tree->size += file->size;
-    tree->children[tree->children_num++] = file;
-    return true;
+
+/**
+ * @brief comparison function used when sorting and searching the snapshots by their device and inode.
+ *
+ * @param[in]  a  pointer to snapshot1
+ * @param[in]  b  pointer to snapshot2
+ * @return int  comparison result
+ */
+static int qcmp_snapshot(const void *a, const void *b){
+    assert(a);
+    assert(b);
+
+    const insp_snapshot *snap1, *snap2;
+
+    snap1 = (const insp_snapshot *) a;
+    snap2 = (const insp_snapshot *) b;
+
+    if (snap1->dev != snap2->dev)
+        return (snap1->dev > snap2->dev) ? 1 : -1;
+    if (snap1->ino != snap2->ino)
+        return (snap1->ino > snap2->ino) ? 1 : -1;
+    return 0;
+}
+
+
+/**
+ * @brief release the entries that differ.
+ *
+ * @param[out] diff  variable to store the entries that differ
+ */
+static void free_changes(insp_diff *diff){
+    assert(diff);
+
+    size_t i;
+
+    for (i = diff->changes_num; i--;)
+        free(diff->changes[i].path);
+    free(diff->changes);
+
+    diff->changes = NULL;
+    diff->changes_num = 0;
+    diff->changes_max = 0;
 }
 
 
@@ -545,10 +2852,19 @@ static void destruct_dir_tree(file_node *file, const insp_opts *opt, size_t dept
             print_file_mode(file->mode);
             print_file_owner(file, opt->numeric_id);
             print_file_size(file->size);
+
+            if (opt->compress){
+                print_file_size(file->gzip_size);
+                print_file_size(file->zstd_size);
+            }
         }
-        else
+        else {
             fputs("       ???       ???       ???       ???    ", stdout);
 
+            if (opt->compress)
+                fputs("     ???         ???    ", stdout);
+        }
+
         if (depth){
             for (size = depth; --size;)
                 fputs("|   ", stdout);
@@ -775,35 +3091,30 @@ static void print_file_size(off_t size){
  * @param[in]  opt  variable to store the results of option parse
  * @param[in]  link_flag  whether or not to display the information of the link destination
  *
- * @note elements of the color code are assigned to the output string in order from the back.
+ * @note the file name is written in chunks, so its length does not affect the stack usage.
  */
 static void print_file_name(const file_node *file, const insp_opts *opt, bool link_flag){
     assert(file);
     assert(opt);
 
-    char *tmp, *output;
+    const char *name, *tmp;
     mode_t mode;
-    size_t size;
 
     if (! link_flag){
-        tmp = file->name;
+        name = file->name;
         mode = file->mode;
     }
     else {
-        tmp = file->link_path;
+        name = file->link_path;
         mode = file->link_mode;
     }
 
-    assert(tmp && *tmp);
-    size = 12 + (strlen(tmp) * 4 + 1) + 4;  // the length of " -> \e[??;??m%s\e[0m"
+    assert(name && *name);
 
-    char buf[size];
-    output = buf + 12;
-    size = get_sanitized_string(output, tmp, false);
+    if (link_flag)
+        fputs(" -> ", stdout);
 
     if (opt->color){
-        memcpy((output + size), "\e[0m", (sizeof(char) * 5));
-
         if (! file->link_invalid)
             switch ((mode & S_IFMT)){
                 case S_IFREG:
@@ -847,19 +3158,13 @@ static void print_file_name(const file_node *file, const insp_opts *opt, bool li
         else
             tmp = "\e[31m";
 
-        size = strlen(tmp);
-        assert(size >= 4);
-
-        output -= size;
-        memcpy(output, tmp, (sizeof(char) * size));
+        fputs(tmp, stdout);
     }
 
-    if (link_flag){
-        output -= 4;
-        memcpy(output, " -> ", (sizeof(char) * 4));
-    }
+    fprint_sanitized_string(stdout, name, false);
 
-    fputs(output, stdout);
+    if (opt->color)
+        fputs("\e[0m", stdout);
 
 
     int c;
@@ -906,6 +3211,13 @@ static void fcmp_name_test(void);
 static void fcmp_size_test(void);
 static void fcmp_ext_test(void);
 
+static void estimate_block_test(void);
+
+static void compare_dir_trees_test(void);
+static void expand_archive_test(void);
+
+static void write_compare_test_file(const char *name, const char *contents, mode_t mode);
+
 
 
 
@@ -916,6 +3228,11 @@ void inspect_test(void){
     do_test(fcmp_name_test);
     do_test(fcmp_size_test);
     do_test(fcmp_ext_test);
+
+    do_test(estimate_block_test);
+
+    do_test(compare_dir_trees_test);
+    do_test(expand_archive_test);
 }
 
 
@@ -1165,4 +3482,362 @@ static void fcmp_ext_test(void){
 
 
 
-#endif // NDEBUG
\ No newline at end of file
+static void estimate_block_test(void){
+    // changeable part for updating test cases
+    const struct {
+        const char * const desc;
+        const char * const unit;
+        const double gzip_min;
+        const double gzip_max;
+    }
+    table[] = {
+        { "random bytes",      NULL,                             0.98, 1.01 },
+        { "zeros",             "",                               0.00, 0.02 },
+        { "repeated text",     "dit inspect --compressibility\n", 0.00, 0.05 },
+        { "repeated word",     "RUN apt-get install -y ",        0.00, 0.05 },
+        {  0,                  NULL,                             0,    0    }
+    };
+
+    const size_t len = INSP_SAMPLE_BLOCK_SIZE;
+    unsigned char *buf;
+    uint32_t *table_buf;
+    size_t unit_len, j;
+    double gzip, zstd;
+
+    assert((buf = (unsigned char *) malloc(len)));
+    assert((table_buf = (uint32_t *) malloc(sizeof(uint32_t) << INSP_HASH_BITS)));
+
+    for (int i = 0; table[i].desc; i++){
+        if (! table[i].unit)
+            for (j = 0; j < len; j++)
+                buf[j] = rand() & UCHAR_MAX;
+        else if ((unit_len = strlen(table[i].unit)))
+            for (j = 0; j < len; j++)
+                buf[j] = table[i].unit[j % unit_len];
+        else
+            memset(buf, 0, len);
+
+        gzip = 0;
+        zstd = 0;
+        estimate_block(buf, len, table_buf, &gzip, &zstd);
+
+        assert(gzip >= (table[i].gzip_min * len));
+        assert(gzip <= (table[i].gzip_max * len));
+        assert(zstd <= gzip);
+
+        print_progress_test_loop('\0', -1, i);
+        fprintf(stderr, "%-13s  %6.0f  %6.0f\n", table[i].desc, gzip, zstd);
+    }
+
+    free(buf);
+    free(table_buf);
+}
+
+
+
+
+#define INSP_TEST_DIR "/dit/tmp/compare.test"
+
+
+static void write_compare_test_file(const char *name, const char *contents, mode_t mode){
+    char path[PATH_MAX];
+    FILE *fp;
+
+    snprintf(path, PATH_MAX, "%s/%s", INSP_TEST_DIR, name);
+
+    assert((fp = fopen(path, "w")));
+    assert(fputs(contents, fp) != EOF);
+    assert(! fclose(fp));
+    assert(! chmod(path, mode));
+}
+
+
+static void compare_dir_trees_test(void){
+    // changeable part for updating test cases
+    const struct {
+        const char * const name;
+        const char * const contents[2];
+        const mode_t modes[2];
+    }
+    files[] = {
+        { "same",        { "hello\n", "hello\n" }, { 0644, 0644 } },
+        { "samesize",    { "abc\n",   "abd\n"   }, { 0644, 0644 } },
+        { "size",        { "ab\n",    "abcd\n"  }, { 0644, 0644 } },
+        { "mode",        { "mode\n",  "mode\n"  }, { 0644, 0600 } },
+        { "sub/y",       { "y\n",     "y\n"     }, { 0644, 0644 } },
+        {  0,            { 0,         0         }, { 0,    0    } }
+    };
+    const char * const results[] = {
+        "C  link",
+        " M mode",
+        "-  only_a",
+        "+  only_b/",
+        "C  samesize",
+        "C  size",
+        "-  type",
+        "+  type/",
+        NULL
+    };
+
+    const char * const roots[2] = { INSP_TEST_DIR "/a", INSP_TEST_DIR "/b" };
+    char path[PATH_MAX], line[PATH_MAX + 4];
+    file_node *trees[2];
+    insp_diff diff = {0};
+    const insp_change *change;
+    struct stat file_stat;
+    struct timespec times[2];
+    size_t i, j;
+    int side, round;
+
+    if (! access(INSP_TEST_DIR, F_OK))
+        assert(walkat(AT_FDCWD, INSP_TEST_DIR, true, removeat));
+
+    assert(! mkdir(INSP_TEST_DIR, 0755));
+
+    for (side = 0; side < 2; side++){
+        assert(! mkdir(roots[side], 0755));
+        snprintf(path, PATH_MAX, "%s/sub", roots[side]);
+        assert(! mkdir(path, 0755));
+
+        for (i = 0; files[i].name; i++){
+            snprintf(path, PATH_MAX, "%c/%s", ("ab"[side]), files[i].name);
+            write_compare_test_file(path, files[i].contents[side], files[i].modes[side]);
+        }
+
+        snprintf(path, PATH_MAX, "%s/link", roots[side]);
+        assert(! symlink((side ? "same" : "size"), path));
+    }
+
+    write_compare_test_file("a/only_a", "only\n", 0644);
+    assert(! mkdir(INSP_TEST_DIR "/b/only_b", 0755));
+    write_compare_test_file("a/type", "type\n", 0644);
+    assert(! mkdir(INSP_TEST_DIR "/b/type", 0755));
+
+    qcmp = qcmp_name;
+    unlink(TMP_FILE1);
+
+    // the second round reuses the hash values cached in the first round
+    for (round = 0; round < 2; round++){
+        for (side = 0; side < 2; side++)
+            assert((trees[side] = construct_dir_tree(AT_FDCWD, roots[side])));
+
+        assert(compare_dir_trees(trees, TMP_FILE1, &diff));
+        assert(! diff.jobs.jobs_num);
+
+        for (i = 0, j = 0, change = diff.changes; i < diff.changes_num; i++, change++)
+            if (change->change_c || change->meta){
+                snprintf(line, sizeof(line), "%c%c %s",
+                    (change->change_c ? change->change_c : ' '), (change->meta ? 'M' : ' '), change->path);
+
+                assert(results[j]);
+                assert(! strcmp(line, results[j]));
+
+                print_progress_test_loop('\0', -1, j++);
+                fprintf(stderr, "%s\n", line);
+            }
+        assert(! results[j]);
+
+        free_changes(&diff);
+
+        for (side = 2; side--;)
+            destruct_dir_tree(trees[side], NULL, 0);
+    }
+
+    // a modification that keeps the size and mtime is still found with the cache, since the ctime changes
+    assert(! stat(INSP_TEST_DIR "/a/same", &file_stat));
+    write_compare_test_file("a/same", "jello\n", 0644);
+
+    times[0] = file_stat.st_atim;
+    times[1] = file_stat.st_mtim;
+    assert(! utimensat(AT_FDCWD, INSP_TEST_DIR "/a/same", times, 0));
+
+    for (side = 0; side < 2; side++)
+        assert((trees[side] = construct_dir_tree(AT_FDCWD, roots[side])));
+
+    assert(compare_dir_trees(trees, TMP_FILE1, &diff));
+
+    for (i = 0, change = diff.changes; i < diff.changes_num; i++, change++)
+        if (! strcmp(change->path, "same"))
+            break;
+    assert((i < diff.changes_num) && (change->change_c == 'C'));
+
+    free_changes(&diff);
+
+    for (side = 2; side--;)
+        destruct_dir_tree(trees[side], NULL, 0);
+
+    assert(walkat(AT_FDCWD, INSP_TEST_DIR, true, removeat));
+    assert(! unlink(TMP_FILE1));
+}
+
+
+
+
+#define INSP_ARCHIVE_TEST_DIR "/dit/tmp/archive.test"
+
+
+static void expand_archive_test(void){
+    // changeable part for updating test cases
+    const struct {
+        const char * const name;
+        const int errid;
+    }
+    table[] = {
+        { "a.tar",         0       },
+        { "a.tar.gz",      0       },
+        { "a.zip",         0       },
+        { "truncated.tar", EBADMSG },
+        {  0,              0       }
+    };
+
+    // tar archives of empty entries, where each path is preceded by its type flag
+    const struct {
+        const char * const name;
+        const char * const entries[4];
+        const int errid;
+        const char * const child;
+        const mode_t type;
+        const size_t children_num;
+    }
+    edges[] = {
+        { "dup.tar",  { "0p", "0p/q", "0p",             NULL }, 0,     "p", S_IFREG, 0 },
+        { "rep.tar",  { "0p", "0p/q", "0p/r",           NULL }, 0,     "p", S_IFDIR, 2 },
+        { "over.tar", { "0p/q", "0p", "5p",             NULL }, 0,     "p", S_IFDIR, 0 },
+        { "dot.tar",  { "0a/../b", "0../c", "0/./d/..", NULL }, EPERM, "b", S_IFREG, 0 },
+        {  0,         { NULL                                 }, 0,     0,   0,       0 }
+    };
+
+    // 'd/' (0755), 'd/f' (0640, "abc"), 'e' (0644, empty) and 'l' (-> 'd/f'), archived on Unix without compression
+    const char zip_bytes[] =
+        "\x50\x4B\x03\x04\x14\x00\x00\x00\x00\x00\x00\x00\xF2\x54\x00\x00"
+        "\x00\x00\x00\x00\x00\x00\x00\x00\x00\x00\x02\x00\x00\x00\x64\x2F"
+        "\x50\x4B\x03\x04\x14\x00\x00\x00\x00\x00\x00\x00\xF2\x54\xC2\x41"
+        "\x24\x35\x03\x00\x00\x00\x03\x00\x00\x00\x03\x00\x00\x00\x64\x2F"
+        "\x66\x61\x62\x63\x50\x4B\x03\x04\x14\x00\x00\x00\x00\x00\x00\x00"
+        "\xF2\x54\x00\x00\x00\x00\x00\x00\x00\x00\x00\x00\x00\x00\x01\x00"
+        "\x00\x00\x65\x50\x4B\x03\x04\x14\x00\x00\x00\x00\x00\x00\x00\xF2"
+        "\x54\xEE\x46\x52\x06\x03\x00\x00\x00\x03\x00\x00\x00\x01\x00\x00"
+        "\x00\x6C\x64\x2F\x66\x50\x4B\x01\x02\x14\x03\x14\x00\x00\x00\x00"
+        "\x00\x00\x00\xF2\x54\x00\x00\x00\x00\x00\x00\x00\x00\x00\x00\x00"
+        "\x00\x02\x00\x00\x00\x00\x00\x00\x00\x00\x00\x10\x00\xED\x41\x00"
+        "\x00\x00\x00\x64\x2F\x50\x4B\x01\x02\x14\x03\x14\x00\x00\x00\x00"
+        "\x00\x00\x00\xF2\x54\xC2\x41\x24\x35\x03\x00\x00\x00\x03\x00\x00"
+        "\x00\x03\x00\x00\x00\x00\x00\x00\x00\x00\x00\x00\x00\xA0\x81\x20"
+        "\x00\x00\x00\x64\x2F\x66\x50\x4B\x01\x02\x14\x03\x14\x00\x00\x00"
+        "\x00\x00\x00\x00\xF2\x54\x00\x00\x00\x00\x00\x00\x00\x00\x00\x00"
+        "\x00\x00\x01\x00\x00\x00\x00\x00\x00\x00\x00\x00\x00\x00\xA4\x81"
+        "\x44\x00\x00\x00\x65\x50\x4B\x01\x02\x14\x03\x14\x00\x00\x00\x00"
+        "\x00\x00\x00\xF2\x54\xEE\x46\x52\x06\x03\x00\x00\x00\x03\x00\x00"
+        "\x00\x01\x00\x00\x00\x00\x00\x00\x00\x00\x00\x00\x00\xFF\xA1\x63"
+        "\x00\x00\x00\x6C\x50\x4B\x05\x06\x00\x00\x00\x00\x04\x00\x04\x00"
+        "\xBF\x00\x00\x00\x85\x00\x00\x00\x00\x00";
+
+    char * const argv[] = {
+        "sh", "-c",
+        "set -e; cd " INSP_ARCHIVE_TEST_DIR "; mkdir -p src/d; printf abc > src/d/f; chmod 640 src/d/f;"
+        "touch src/e; ln -s d/f src/l; tar -C src -cf a.tar .; gzip -c a.tar > a.tar.gz; head -c 700 a.tar > truncated.tar",
+        NULL
+    };
+
+    unsigned char header[INSP_TAR_BLOCK_SIZE];
+    char path[PATH_MAX];
+    file_node *file, *child;
+    struct stat file_stat;
+    unsigned int sum;
+    size_t n;
+    FILE *fp;
+    int i, j, k;
+
+    if (! access(INSP_ARCHIVE_TEST_DIR, F_OK))
+        assert(walkat(AT_FDCWD, INSP_ARCHIVE_TEST_DIR, true, removeat));
+
+    assert(! mkdir(INSP_ARCHIVE_TEST_DIR, 0755));
+    assert(! execute("/bin/sh", argv, 0b11));
+
+    assert((fp = fopen(INSP_ARCHIVE_TEST_DIR "/a.zip", "wb")));
+    assert(fwrite(zip_bytes, sizeof(char), (sizeof(zip_bytes) - 1), fp) == (sizeof(zip_bytes) - 1));
+    assert(! fclose(fp));
+
+    for (i = 0; table[i].name; i++){
+        snprintf(path, PATH_MAX, "%s/%s", INSP_ARCHIVE_TEST_DIR, table[i].name);
+
+        assert((file = new_file(AT_FDCWD, strdup(path))));
+        assert(! stat(path, &file_stat));
+
+        expand_archive(AT_FDCWD, file);
+
+        assert(file->errid == table[i].errid);
+        assert(file->size == file_stat.st_size);
+
+        if (! table[i].errid){
+            assert(file->children_num == 3);
+
+            child = file->children[0];
+            assert(S_ISDIR(child->mode) && (! strcmp(child->name, "d")));
+            assert((child->size == 3) && (child->children_num == 1));
+
+            child = child->children[0];
+            assert(! strcmp(child->name, "f"));
+            assert((child->mode == (S_IFREG | 0640)) && (child->size == 3));
+
+            child = file->children[1];
+            assert(! strcmp(child->name, "e"));
+            assert(S_ISREG(child->mode) && (! child->size));
+
+            child = file->children[2];
+            assert(! strcmp(child->name, "l"));
+            assert(S_ISLNK(child->mode) && (! strcmp(child->link_path, "d/f")));
+        }
+
+        print_progress_test_loop('\0', -1, i);
+        fprintf(stderr, "%-13s  %zu entries\n", table[i].name, file->children_num);
+
+        destruct_dir_tree(file, NULL, 0);
+    }
+
+    for (j = 0; edges[j].name; i++, j++){
+        snprintf(path, PATH_MAX, "%s/%s", INSP_ARCHIVE_TEST_DIR, edges[j].name);
+        assert((fp = fopen(path, "wb")));
+
+        for (k = 0; edges[j].entries[k]; k++){
+            memset(header, 0, INSP_TAR_BLOCK_SIZE);
+            strcpy((char *) header, (edges[j].entries[k] + 1));
+            memcpy((header + 100), "0000644", 7);
+            memcpy((header + 124), "00000000000", 11);
+            header[156] = edges[j].entries[k][0];
+
+            for (sum = 0, n = 0; n < INSP_TAR_BLOCK_SIZE; n++)
+                sum += ((n >= 148) && (n < 156)) ? ' ' : header[n];
+            snprintf((char *) (header + 148), 8, "%06o", sum);
+
+            assert(fwrite(header, sizeof(char), INSP_TAR_BLOCK_SIZE, fp) == INSP_TAR_BLOCK_SIZE);
+        }
+
+        memset(header, 0, INSP_TAR_BLOCK_SIZE);
+        for (n = 2; n--;)
+            assert(fwrite(header, sizeof(char), INSP_TAR_BLOCK_SIZE, fp) == INSP_TAR_BLOCK_SIZE);
+        assert(! fclose(fp));
+
+        assert((file = new_file(AT_FDCWD, strdup(path))));
+        expand_archive(AT_FDCWD, file);
+
+        assert(file->errid == edges[j].errid);
+        assert(file->children_num == 1);
+
+        child = file->children[0];
+        assert(! strcmp(child->name, edges[j].child));
+        assert(((child->mode & S_IFMT) == edges[j].type) && (child->children_num == edges[j].children_num));
+
+        print_progress_test_loop('\0', -1, i);
+        fprintf(stderr, "%-13s  %zu entries\n", edges[j].name, file->children_num);
+
+        destruct_dir_tree(file, NULL, 0);
+    }
+
+    assert(walkat(AT_FDCWD, INSP_ARCHIVE_TEST_DIR, true, removeat));
+}
+
+
+
+
+#endif // NDEBUG
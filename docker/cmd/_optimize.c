@@ -1,10 +1,4938 @@
+/**
+ * @file _optimize.c
+ *
+ * Copyright (c) 2023 Tsukasa Inada
+ *
+ * @brief Described the dit command 'optimize', that refactors Dockerfile based on its best practices.
+ * @author Tsukasa Inada
+ * @date 2023/10/18
+ *
+ * @note Dockerfile is parsed into a list of instructions, where each RUN in shell form is split into commands.
+ * @note Each optimization is a pass that rewrites this list, reporting why it did or did not change a line.
+ * @note The instructions not rewritten by any pass are written back exactly as they were.
+ */
+
 #include "main.h"
 
+#define OPTIMIZE_SETTINGS_FILE "/dit/var/optimize.json"
+#define PACKAGE_MANAGER_FILE "/dit/etc/package_manager"
+#define DPKG_STATUS_FILE "/var/lib/dpkg/status"
+#define APT_EXTENDED_STATES_FILE "/var/lib/apt/extended_states"
+#define SIZE_PROJECTION_FILE "/dit/srv/size-projection"
+
+#define OPT_INITIAL_INSTRS_MAX 63  // 2^n - 1
+#define OPT_INITIAL_CMDS_MAX 7     // 2^n - 1
+#define OPT_INITIAL_WORDS_MAX 7    // 2^n - 1
+
+#define OPT_PKG_MANAGERS_NUM 5
+#define OPT_INLINE_PACKAGES_MAX 3
+
+#define OPT_CMD_OTHER    0
+#define OPT_CMD_TRIVIAL  1
+#define OPT_CMD_INSTALL  2
+#define OPT_CMD_UPDATE   3
+#define OPT_CMD_CLEAN    4
+#define OPT_CMD_REMOVE   5
+#define OPT_CMD_SOURCES  6
+
+#define SLIM_DOCS           0
+#define SLIM_LOCALES        1
+#define SLIM_STATIC_LIBS    2
+#define SLIM_DEBUG_SYMBOLS  3
+#define SLIM_CATEGORIES_NUM 4
+
+#define SLIM_SECTIONS_MAX 4096
+#define SLIM_NAMES_MAX (1 << 20)
+
+#define PARALLEL_STAGES_MAX 8
+#define PARALLEL_COPIES_MAX 16
+#define PARALLEL_NAME_MAX 32
+
+#define PAR_NONE SIZE_MAX
+#define PAR_FOREIGN (SIZE_MAX - 1)
+
+#define BUDGET_TOP_INSTRS_MAX 5
+#define BUDGET_WARNING_PERCENT 90
+#define BUDGET_TEXT_MAX 48
+
+
+/** Data type for storing the results of option parse */
+typedef struct {
+    bool in_place;         /** whether to overwrite the source Dockerfile with the result */
+    bool reset;            /** whether to reset the settings of this command */
+    bool slim;             /** whether to inject the cleanup proposed by the slim pass */
+    off_t budget;          /** the size budget to be set, or -1 if it is not changed */
+} opt_opts;
+
+
+/** Data type for storing the settings read from the settings file */
+typedef struct {
+    bool consolidate;      /** whether to consolidate the package installations in each stage */
+    bool hygiene;          /** whether to make each package manager leave no cache in the layer */
+    bool slim;             /** whether to find the removable files each instruction creates */
+    bool link;             /** whether to give '--link' to COPY instructions that do not depend on earlier layers */
+    bool parallel;         /** whether to split the independent chains of RUN instructions into stages */
+    off_t budget;          /** the size budget of the image in bytes, or 0 if there is none */
+} opt_settings;
+
+
+/** Data type for storing a command in RUN instruction */
+typedef struct {
+    char *text;            /** the command, where continuations and redundant spaces are removed */
+    char **words;          /** null-terminated array of the words making up the command */
+    size_t words_num;      /** the number of the words */
+    size_t verb;           /** index of the word naming the executable */
+    size_t sub;            /** index of the subcommand word if this operates a package manager */
+    int sep;               /** the operator preceding this ('&' for '&&', '|' for '||', ';' or '\0') */
+    int kind;              /** what this does, that is one of 'OPT_CMD_*' */
+    int manager;           /** index of the package manager this operates, or -1 */
+    bool removed;          /** whether any pass has removed this */
+} opt_cmd;
+
+
+/** Data type for storing an instruction in Dockerfile */
+typedef struct {
+    char *lead;            /** the comments and empty lines preceding this */
+    char *text;            /** the original lines of this */
+    char *args;            /** the arguments, where continuations are joined */
+    char *flags;           /** the flags such as '--mount' given to RUN, or NULL */
+    char *before;          /** the new instructions to be inserted before this, or NULL */
+    int id;                /** ID of the instruction, or -1 if unknown */
+    size_t line;           /** line number where this begins in the original Dockerfile */
+    size_t stage;          /** the number of FROM instructions up to and including this */
+
+    opt_cmd *cmds;         /** array for storing the commands if this is RUN that can be split safely */
+    size_t cmds_num;       /** the current number of the commands */
+    size_t cmds_max;       /** the current maximum length of the array */
+
+    bool modified;         /** whether any pass has changed the commands of this */
+    bool removed;          /** whether any pass has removed this */
+} opt_instr;
+
+
+/** Data type for storing Dockerfile as the list of instructions */
+typedef struct {
+    opt_instr *instrs;     /** array for storing the instructions */
+    size_t instrs_num;     /** the current number of the instructions */
+    size_t instrs_max;     /** the current maximum length of the array */
+    char *tail;            /** the comments and empty lines following the last instruction */
+    FILE *report;          /** stream to which each pass reports its decisions */
+} opt_ir;
+
+
+/** Data type for storing the properties of a package manager */
+typedef struct {
+    const char *name;                 /** name of the executable */
+    const char *install;              /** subcommand to install packages */
+    const char *update;               /** subcommand to update the package index */
+    const char * const *removes;      /** null-terminated array of the subcommands to remove packages */
+    const char *cache;                /** the directory where the package index or cache is stored */
+    const char * const *arg_opts;     /** null-terminated array of the options that take a separate argument */
+} pkg_manager;
+
+
+/** Data type for storing a rule that keeps a package manager from leaving its cache in the layer */
+typedef struct {
+    const char *tool;                 /** name of the executable the rule applies to */
+    const char * const *subs;         /** null-terminated array of the subcommands the rule applies to */
+    const char *recorded;             /** the package manager recorded by dit the rule belongs to, or NULL */
+    const char *option;               /** the option to be given to the command, or NULL */
+    const char *alias;                /** substring of any word that has the same effect as the option, or NULL */
+    const char *cleanup;              /** the command to be appended to the layer, or NULL */
+    const char *cleaned;              /** the path or the subcommands of the tool that already do the cleanup */
+    const char *env;                  /** the variable that already has the same effect, or NULL */
+    const char *cache;                /** the directory left in the layer without the fix, or NULL */
+    const char * const *needs;        /** null-terminated array of the subcommands that need the cache, or NULL */
+    const char * const *refills;      /** null-terminated array of the subcommands that refill the cache, or NULL */
+} hygiene_rule;
+
+
+/** Data type for storing a package in the database of dpkg */
+typedef struct {
+    const char *name;                 /** name of the package */
+    const char *depends[2];           /** the value of 'Depends' and 'Pre-Depends', or NULL */
+    const char *provides;             /** the value of 'Provides', or NULL */
+    off_t size;                       /** the value of 'Installed-Size' in bytes */
+    bool installed;                   /** whether the package is installed */
+    bool essential;                   /** whether the package is essential to the system */
+    bool manual;                      /** whether the package is installed explicitly */
+    bool kept;                        /** whether the package is needed without the recommended packages */
+} dpkg_pkg;
+
+
+/** Data type for storing a line in the reflect log */
+typedef struct {
+    struct timespec start;            /** when the command line started */
+    struct timespec end;              /** when the line was reflected in Dockerfile */
+    const char *line;                 /** the reflected line */
+    size_t instr;                     /** index of the instruction made of the line, or SIZE_MAX */
+} opt_entry;
+
+
+/** Data type for storing the removable files attributed to an instruction */
+typedef struct {
+    off_t bytes[SLIM_CATEGORIES_NUM];             /** the bytes saved by removing the files of each category */
+    unsigned int roots;                           /** bit set of the directories under which the files are found */
+    char **paths[SLIM_CATEGORIES_NUM];            /** array of the files to be listed in the cleanup, or NULL */
+    size_t paths_num[SLIM_CATEGORIES_NUM];        /** the current number of the files */
+    size_t paths_max[SLIM_CATEGORIES_NUM];        /** the current maximum length of the array */
+} slim_attr;
+
+
+/** Data type for storing the state of the scan for removable files */
+typedef struct {
+    const opt_entry *entries;             /** array of the lines in the reflect log, in chronological order */
+    size_t entries_num;                   /** array size */
+    slim_attr *attrs;                     /** array of the removable files attributed to each instruction */
+    off_t totals[SLIM_CATEGORIES_NUM];    /** the bytes of the removable files of each category */
+    int category;                         /** the category of the files under the directory being scanned */
+    unsigned int root;                    /** the bit representing the directory being scanned */
+    const char *keep;                     /** the language whose locales are kept besides English, or NULL */
+} slim_scan;
+
+
+/** Data type for storing the paths an instruction in the final stage left by itself */
+typedef struct {
+    char **roots;                         /** array of the largest files and directories left only by this */
+    size_t roots_num;                     /** the current number of the paths */
+    size_t roots_max;                     /** the current maximum length of the array */
+    bool shared;                          /** whether any of the paths is under the directories other builds also change */
+    bool provides;                        /** whether any of the paths is under the directories of libraries or headers */
+    bool logged;                          /** whether any line making this is in the reflect log */
+    double seconds;                       /** the total duration of the command lines making this */
+} par_node;
+
+
+/** Data type for storing the state of the scan for the paths each instruction left by itself */
+typedef struct {
+    const opt_entry *entries;             /** array of the lines in the reflect log, in chronological order */
+    size_t entries_num;                   /** array size */
+    par_node *nodes;                      /** array of the paths left by each instruction in the final stage */
+    size_t nodes_num;                     /** array size */
+    size_t start;                         /** index of the first instruction following FROM of the final stage */
+    dev_t dev;                            /** the device of the root directory */
+    bool failed;                          /** whether any path could not be stored */
+} par_scan;
+
+
+/** Data type for storing the files attributed to an instruction when projecting the image size */
+typedef struct {
+    off_t bytes;                          /** the bytes of the files */
+    size_t instr;                         /** index of the instruction */
+    char **paths;                         /** array of the paths of the files */
+    off_t (* sizes)[3];                   /** array of the size of each file and its estimates when compressed */
+    size_t paths_num;                     /** the current number of the files */
+    size_t paths_max;                     /** the current maximum length of the arrays */
+} budget_attr;
+
+
+/** Data type for storing the state of the scan for the projected image size */
+typedef struct {
+    const opt_entry *entries;             /** array of the lines in the reflect log, in chronological order */
+    size_t entries_num;                   /** array size */
+    budget_attr *attrs;                   /** array of the files attributed to each instruction, or NULL */
+    off_t total;                          /** the bytes of all files in the image */
+    dev_t dev;                            /** the device of the root directory */
+} budget_scan;
+
+
+/** Data type for storing the location of a command in Dockerfile */
+typedef struct {
+    size_t instr;          /** index of the instruction */
+    size_t cmd;            /** index of the command in the instruction */
+} opt_loc;
+
+
+static int parse_opts(int argc, char **argv, opt_opts *opt);
+static int do_optimize(const char *src_file, const opt_opts *opt);
+static int reset_settings(void);
+static void load_settings(opt_settings *settings);
+static int save_budget(off_t budget);
+
+static bool parse_dockerfile(opt_ir *ir, const char *src);
+static bool append_instr(opt_ir *ir, const char *lead, size_t lead_len, const char *text, size_t text_len);
+static bool check_if_continued(const char *line, const char *next);
+static const char *skip_heredoc(const char *args, const char *next);
+static bool split_run_commands(opt_instr *instr, char *args);
+static bool append_cmd(opt_instr *instr, const char *start, const char *end, int sep);
+static bool split_words(opt_cmd *cmd);
+static void classify_cmd(opt_cmd *cmd);
+static size_t find_subcommand(const opt_cmd *cmd, const pkg_manager *manager);
+
+static void apply_hygiene(opt_ir *ir, const char *recorded);
+static size_t match_hygiene_rule(const opt_cmd *cmd, const hygiene_rule *rule);
+static size_t match_subcommand(const opt_cmd *cmd, const char *tool, const char * const *subs);
+static bool check_if_cleaned(const opt_instr *instr, size_t i, const hygiene_rule *rule);
+static size_t check_if_needed_later(const opt_ir *ir, size_t i, const hygiene_rule *rule);
+static bool insert_option(opt_cmd *cmd, size_t i, const char *option);
+static off_t estimate_hygiene_saving(const hygiene_rule *rule, const char *recorded);
+static off_t estimate_recommends_size(void);
+static size_t parse_dpkg_status(char *src, dpkg_pkg **p_pkgs);
+static void keep_dpkg_depends(dpkg_pkg *pkgs, size_t pkgs_num, dpkg_pkg *pkg);
+static int qcmp_dpkg_pkg(const void *a, const void *b);
+
+static void consolidate_installs(opt_ir *ir);
+static void consolidate_stage(opt_ir *ir, size_t start, size_t end);
+static size_t consolidate_group(opt_ir *ir, size_t first, size_t *p_cmd, size_t end);
+static const char *check_if_hoistable(const opt_ir *ir, const opt_loc *loc, size_t point, const opt_cmd *model);
+static bool check_if_barrier(const opt_instr *instr);
+static bool compare_install_opts(const opt_cmd *cmd1, const opt_cmd *cmd2);
+static char *render_install_layer(
+    const opt_ir *ir, const opt_loc *locs, size_t locs_num, const opt_cmd *update, const char * const *extras, size_t extras_num
+);
+static void update_removed_instr(opt_instr *instr);
+
+static void slim_layers(opt_ir *ir, bool inject);
+static size_t load_reflect_log(const opt_ir *ir, char *src, opt_entry **p_entries);
+static void scan_slim_files(slim_scan *scan, int pwdfd, const char *name, char *path, size_t len, size_t depth);
+static void attribute_slim_file(slim_scan *scan, const char *path, const struct stat *file_stat, int category, off_t bytes);
+static bool check_if_kept_locale(const char *name, const char *keep);
+static off_t count_debug_bytes(int fd);
+static char *render_slim_cleanup(const slim_attr *attr, int category, const char *keep);
+static void print_quoted_path(FILE *fp, const char *path);
+static int qcmp_entry(const void *a, const void *b);
+static int compare_timespec(struct timespec ts1, struct timespec ts2);
+
+static void link_copies(opt_ir *ir);
+static const char *parse_copy_args(const char *args, const char *cwd, char *dest, const char **p_owner);
+static const char *check_link_destination(const char *dest, char *path);
+static size_t find_user_creation(const opt_ir *ir, size_t start, size_t end, const char *owner);
+static bool check_if_syntax_given(const char *lead);
+
+static void parallelize_stages(opt_ir *ir);
+static bool split_parallel_block(
+    opt_ir *ir, const par_scan *scan, size_t from, size_t start, size_t end, size_t *parents, double before, size_t unlogged
+);
+static bool check_if_parallelizable(const opt_instr *instr, const par_node *node);
+static bool check_if_dependent(const opt_instr *instr, const par_node *node, const char *cwd);
+static size_t find_parallel_chain(size_t *parents, size_t i);
+static bool resolve_mentioned_path(const char *word, const char *cwd, char *path);
+static size_t scan_parallel_files(par_scan *scan, int pwdfd, const char *name, char *path, size_t len);
+static void append_parallel_root(par_node *node, const char *path, bool *p_failed);
+static void get_chain_hint(
+    const opt_ir *ir, const par_scan *scan, size_t *parents, size_t start, size_t end, size_t chain, char *hint
+);
+static bool get_stage_alias(const opt_instr *instr, char *name);
+static void make_stage_name(
+    const opt_ir *ir, const char *hint, const char (* names)[PARALLEL_NAME_MAX], size_t names_num, char *name
+);
+static void write_stage_args(const opt_ir *ir, size_t from, size_t end, FILE *fp);
+static void print_copy_paths(FILE *fp, const char *path);
+
+static int check_budget(const opt_ir *ir, off_t budget);
+static off_t project_image_size(budget_scan *scan);
+static void scan_image_files(budget_scan *scan, int pwdfd, const char *name, char *path, size_t len);
+static void attribute_image_file(budget_scan *scan, const char *path, const struct stat *file_stat, off_t bytes);
+static void record_projection(off_t projected, off_t budget);
+static off_t parse_size(const char *target);
+static int qcmp_budget_attr(const void *a, const void *b);
+
+static void write_dockerfile(const opt_ir *ir, FILE *fp);
+static void write_run_instr(const opt_instr *instr, FILE *fp);
+static void free_ir(opt_ir *ir);
+
+static char *read_whole_file(const char *file_name, size_t *p_len);
+static void print_saving(FILE *fp, off_t size);
+static size_t find_entry_instr(const opt_entry *entries, size_t entries_num, struct timespec ctime);
+static const char *basename_of(const char *path);
+static bool check_if_same_manager(int manager1, int manager2);
+static bool check_if_option(const opt_cmd *cmd, size_t i, const pkg_manager *manager, bool *p_arg);
+static bool check_if_yes_option(const char *word);
+static bool check_if_local_package(const char *word);
+static bool match_package_name(const char *word, const char *package);
+
+
+static const char * const apt_removes[] = { "autoremove", "purge", "remove", NULL };
+static const char * const apk_removes[] = { "del", NULL };
+static const char * const yum_removes[] = { "erase", "remove", NULL };
+
+static const char * const apt_arg_opts[] = { "-c", "-o", "-t", NULL };
+static const char * const apk_arg_opts[] = { "-X", "-p", "-t", "--repository", "--root", "--virtual", NULL };
+static const char * const yum_arg_opts[] = { "-c", "-d", "-e", "-R", NULL };
+
+static const char * const apt_hygiene_subs[] = { "install", "update", NULL };
+static const char * const install_subs[] = { "install", NULL };
+static const char * const apk_add_subs[] = { "add", NULL };
+static const char * const apk_update_subs[] = { "update", "upgrade", NULL };
+static const char * const npm_install_subs[] = { "ci", "i", "install", NULL };
+static const char * const apt_needing_subs[] = { "build-dep", "dist-upgrade", "full-upgrade", "install", "source", "upgrade", NULL };
+static const char * const apt_refilling_subs[] = { "update", NULL };
+
+static const char * const user_creation_cmds[] = { "addgroup", "adduser", "groupadd", "groupmod", "useradd", "usermod", NULL };
+
+
+/** array of the package managers whose commands are recognized by the passes */
+static const pkg_manager pkg_managers[OPT_PKG_MANAGERS_NUM] = {
+    { "apk",     "add",     "update",    apk_removes, "/var/cache/apk",     apk_arg_opts },
+    { "apt",     "install", "update",    apt_removes, "/var/lib/apt/lists", apt_arg_opts },
+    { "apt-get", "install", "update",    apt_removes, "/var/lib/apt/lists", apt_arg_opts },
+    { "dnf",     "install", "makecache", yum_removes, "/var/cache/dnf",     yum_arg_opts },
+    { "yum",     "install", "makecache", yum_removes, "/var/cache/yum",     yum_arg_opts }
+};
+
+/** array of the paths whose change affects which packages can be installed */
+static const char * const sources_paths[] = {
+    "/etc/apk/",
+    "/etc/apt/",
+    "/etc/dnf/",
+    "/etc/yum.conf",
+    "/etc/yum.repos.d"
+};
+
+/** array of the commands that change where or how packages are fetched */
+static const char * const sources_cmds[] = {
+    "add-apt-repository",
+    "apt-key",
+    "yum-config-manager"
+};
+
+/** array of the words that begin a compound command, which is not split into its components */
+static const char * const compound_words[] = {
+    "case", "do", "done", "elif", "else", "esac", "fi", "for", "function", "if", "then", "until", "while", "{", "}"
+};
+
+/** array of the substrings of the variables that change the behavior of the package managers */
+static const char * const install_envs[] = {
+    "DEBIAN_FRONTEND",
+    "PROXY",
+    "proxy"
+};
+
+
+/** array of the rules applied by the hygiene pass, in the order of checking */
+static const hygiene_rule hygiene_rules[] = {
+    {
+        "apt-get", install_subs,     "apt-get", "--no-install-recommends", "Install-Recommends",
+        NULL,                       NULL,                 NULL,               NULL,
+        NULL,                       NULL
+    },
+    {
+        "apt",     install_subs,     "apt-get", "--no-install-recommends", "Install-Recommends",
+        NULL,                       NULL,                 NULL,               NULL,
+        NULL,                       NULL
+    },
+    {
+        "apt-get", apt_hygiene_subs, "apt-get", NULL,                      NULL,
+        "rm -rf /var/lib/apt/lists/*", "/var/lib/apt/lists", NULL,            "/var/lib/apt/lists",
+        apt_needing_subs,           apt_refilling_subs
+    },
+    {
+        "apt",     apt_hygiene_subs, "apt-get", NULL,                      NULL,
+        "rm -rf /var/lib/apt/lists/*", "/var/lib/apt/lists", NULL,            "/var/lib/apt/lists",
+        apt_needing_subs,           apt_refilling_subs
+    },
+    {
+        "apk",     apk_add_subs,     "apk",     "--no-cache",              NULL,
+        NULL,                       "/var/cache/apk",     NULL,               "/var/cache/apk",
+        NULL,                       NULL
+    },
+    {
+        "apk",     apk_update_subs,  "apk",     NULL,                      NULL,
+        "rm -rf /var/cache/apk/*",  "/var/cache/apk",     NULL,               "/var/cache/apk",
+        NULL,                       NULL
+    },
+    {
+        "yum",     install_subs,     "yum",     NULL,                      NULL,
+        "yum clean all",            "clean all",          NULL,               "/var/cache/yum",
+        NULL,                       NULL
+    },
+    {
+        "dnf",     install_subs,     "yum",     NULL,                      NULL,
+        "dnf clean all",            "clean all",          NULL,               "/var/cache/dnf",
+        NULL,                       NULL
+    },
+    {
+        "pip",     install_subs,     NULL,      "--no-cache-dir",          NULL,
+        NULL,                       NULL,                 "PIP_NO_CACHE_DIR", "/root/.cache/pip",
+        NULL,                       NULL
+    },
+    {
+        "pip3",    install_subs,     NULL,      "--no-cache-dir",          NULL,
+        NULL,                       NULL,                 "PIP_NO_CACHE_DIR", "/root/.cache/pip",
+        NULL,                       NULL
+    },
+    {
+        "npm",     npm_install_subs, NULL,      NULL,                      NULL,
+        "npm cache clean --force",  "cache clean",        NULL,               "/root/.npm/_cacache",
+        NULL,                       NULL
+    }
+};
+
+
+/** the directories scanned by the slim pass, and the category of the files under each of them */
+static const struct {
+    const char *path;
+    int category;
+}
+slim_roots[] = {
+    { "/usr/share/doc",         SLIM_DOCS          },
+    { "/usr/share/man",         SLIM_DOCS          },
+    { "/usr/share/info",        SLIM_DOCS          },
+    { "/usr/local/share/doc",   SLIM_DOCS          },
+    { "/usr/local/share/man",   SLIM_DOCS          },
+    { "/usr/share/locale",      SLIM_LOCALES       },
+    { "/usr/local/share/locale", SLIM_LOCALES      },
+    { "/bin",                   SLIM_DEBUG_SYMBOLS },
+    { "/lib",                   SLIM_DEBUG_SYMBOLS },
+    { "/lib64",                 SLIM_DEBUG_SYMBOLS },
+    { "/opt",                   SLIM_DEBUG_SYMBOLS },
+    { "/sbin",                  SLIM_DEBUG_SYMBOLS },
+    { "/usr/bin",               SLIM_DEBUG_SYMBOLS },
+    { "/usr/lib",               SLIM_DEBUG_SYMBOLS },
+    { "/usr/lib64",             SLIM_DEBUG_SYMBOLS },
+    { "/usr/libexec",           SLIM_DEBUG_SYMBOLS },
+    { "/usr/local/bin",         SLIM_DEBUG_SYMBOLS },
+    { "/usr/local/lib",         SLIM_DEBUG_SYMBOLS },
+    { "/usr/local/sbin",        SLIM_DEBUG_SYMBOLS },
+    { "/usr/sbin",              SLIM_DEBUG_SYMBOLS }
+};
+
+/** array of the descriptions of each category of the removable files */
+static const char * const slim_descs[SLIM_CATEGORIES_NUM] = {
+    "documentation",
+    "locales other than English",
+    "static libraries",
+    "debug symbols"
+};
+
+/** array of the commands given the files of each category one by one, or NULL if the files are removed by directory */
+static const char * const slim_list_cmds[SLIM_CATEGORIES_NUM] = {
+    NULL,
+    NULL,
+    "rm -f",
+    "strip --strip-unneeded"
+};
+
+/** array of the paths where the command to strip debug symbols is looked for */
+static const char * const strip_paths[] = {
+    "/usr/bin/strip",
+    "/usr/local/bin/strip",
+    "/bin/strip"
+};
+
+
+/** the Dockerfile optimized when no file is specified */
+static const char *optimize_src_file = DOCKER_FILE_DRAFT;
+
+/** whether to suppress the suggestion, since the only error is that the image exceeds the size budget */
+static bool no_suggestion = false;
+
+
+
+
+/******************************************************************************
+    * Local Main Interface
+******************************************************************************/
+
+
+/**
+ * @brief refactor Dockerfile based on its best practices.
+ *
+ * @param[in]  argc  the number of command line arguments
+ * @param[out] argv  array of strings that are command line arguments
+ * @return int  command's exit status
+ *
+ * @note treated like a normal main function.
+ */
+int optimize(int argc, char **argv){
+    int i, exit_status = FAILURE;
+    opt_opts opt;
+
+    if (! (i = parse_opts(argc, argv, &opt))){
+        argc -= optind;
+        argv += optind;
+
+        if (opt.reset){
+            if (argc <= 0)
+                exit_status = reset_settings();
+            else
+                xperror_too_many_args(0);
+        }
+        else if (argc > 1)
+            xperror_too_many_args(1);
+        else
+            exit_status = do_optimize(((argc > 0) ? *argv : optimize_src_file), &opt);
+    }
+    else if (i > 0)
+        exit_status = SUCCESS;
+
+    if (exit_status){
+        if (exit_status < 0){
+            exit_status = FAILURE;
+            xperror_internal_file();
+        }
+        else if (no_suggestion)
+            return exit_status;
+        xperror_suggestion(true);
+    }
+    return exit_status;
+}
+
+
+
+
+/**
+ * @brief parse optional arguments.
+ *
+ * @param[in]  argc  the number of command line arguments
+ * @param[out] argv  array of strings that are command line arguments
+ * @param[out] opt  variable to store the results of option parse
+ * @return int  0 (parse success), 1 (normally exit) or -1 (error exit)
+ *
+ * @note the arguments are expected to be passed as-is from main function.
+ */
+static int parse_opts(int argc, char **argv, opt_opts *opt){
+    assert(opt);
+
+    const char *short_opts = "b:irs";
+
+    const struct option long_opts[] = {
+        { "budget",   required_argument, NULL, 'b' },
+        { "in-place", no_argument,       NULL, 'i' },
+        { "reset",    no_argument,       NULL, 'r' },
+        { "slim",     no_argument,       NULL, 's' },
+        { "help",     no_argument,       NULL,  1  },
+        {  0,          0,                 0,    0  }
+    };
+
+    opt->in_place = false;
+    opt->reset = false;
+    opt->slim = false;
+    opt->budget = -1;
+
+    int c;
+    while ((c = getopt_long(argc, argv, short_opts, long_opts, NULL)) >= 0)
+        switch (c){
+            case 'b':
+                if ((opt->budget = parse_size(optarg)) < 0){
+                    xperror_invalid_arg('O', 1, long_opts[0].name, optarg);
+                    return ERROR_EXIT;
+                }
+                break;
+            case 'i':
+                opt->in_place = true;
+                break;
+            case 'r':
+                opt->reset = true;
+                break;
+            case 's':
+                opt->slim = true;
+                break;
+            case 1:
+                optimize_manual();
+                return NORMALLY_EXIT;
+            default:
+                return ERROR_EXIT;
+        }
+
+    return SUCCESS;
+}
+
+
+
+
+/**
+ * @brief optimize the specified Dockerfile, and write the result.
+ *
+ * @param[in]  src_file  the Dockerfile to be optimized
+ * @param[in]  opt  variable to store the results of option parse
+ * @return int  0 (success), 1 (possible error) or -1 (unexpected error)
+ *
+ * @note the result is written to standard output unless overwriting the source, and the report to the other.
+ * @note if the size budget is set, the projected image size is checked against it after writing the result.
+ */
+static int do_optimize(const char *src_file, const opt_opts *opt){
+    assert(src_file);
+    assert(opt);
+
+    char *src, *recorded;
+    int exit_status = UNEXPECTED_ERROR;
+    opt_settings settings;
+    opt_ir ir = {0};
+    FILE *fp;
+
+    if (! (src = read_whole_file(src_file, NULL))){
+        if (errno == ENOMEM)
+            return exit_status;
+
+        xperror_standards(src_file, errno);
+        return POSSIBLE_ERROR;
+    }
+
+    if ((opt->budget >= 0) && save_budget(opt->budget)){
+        free(src);
+        return exit_status;
+    }
+
+    load_settings(&settings);
+    ir.report = opt->in_place ? stdout : stderr;
+
+    if (parse_dockerfile(&ir, src)){
+        if (settings.hygiene){
+            recorded = get_one_liner(PACKAGE_MANAGER_FILE);
+            apply_hygiene(&ir, recorded);
+            free(recorded);
+        }
+        if (settings.consolidate)
+            consolidate_installs(&ir);
+        if (settings.slim)
+            slim_layers(&ir, opt->slim);
+        if (settings.link)
+            link_copies(&ir);
+        if (settings.parallel)
+            parallelize_stages(&ir);
+
+        if (! opt->in_place){
+            write_dockerfile(&ir, stdout);
+            exit_status = SUCCESS;
+        }
+        else if ((fp = fopen(src_file, "w"))){
+            write_dockerfile(&ir, fp);
+
+            if (! fclose(fp))
+                exit_status = SUCCESS;
+        }
+
+        if ((! exit_status) && (settings.budget > 0) && (exit_status = check_budget(&ir, settings.budget)) > 0){
+            xperror_message("the projected image size exceeds the budget", NULL);
+            no_suggestion = true;
+        }
+    }
+
+    free_ir(&ir);
+    free(src);
+
+    return exit_status;
+}
+
+
+
+
+/**
+ * @brief reset the settings of this command to the defaults.
+ *
+ * @return int  0 (success) or -1 (unexpected error)
+ */
+static int reset_settings(void){
+    const char *contents =
+        "{\n"
+        "  \"hygiene\": true,\n"
+        "  \"consolidate\": true,\n"
+        "  \"slim\": true,\n"
+        "  \"link\": true,\n"
+        "  \"parallel\": true,\n"
+        "  \"budget\": 0\n"
+        "}\n";
+
+    int exit_status = UNEXPECTED_ERROR;
+    FILE *fp;
+
+    if ((fp = fopen(OPTIMIZE_SETTINGS_FILE, "w"))){
+        if ((fputs(contents, fp) != EOF) & (! fclose(fp)))
+            exit_status = SUCCESS;
+    }
+    return exit_status;
+}
+
+
+/**
+ * @brief load the settings of this command.
+ *
+ * @param[out] settings  variable to store the settings
+ *
+ * @note the settings missing from the settings file are regarded as their defaults.
+ * @note the size budget is regarded as missing unless it is a non-negative integer.
+ */
+static void load_settings(opt_settings *settings){
+    assert(settings);
+
+    const struct {
+        const char *name;
+        bool *p_flag;
+    }
+    passes[] = {
+        { "consolidate", &(settings->consolidate) },
+        { "hygiene",     &(settings->hygiene)     },
+        { "link",        &(settings->link)        },
+        { "parallel",    &(settings->parallel)    },
+        { "slim",        &(settings->slim)        }
+    };
+
+    yyjson_doc *idoc;
+    yyjson_val *ival;
+    size_t i;
+
+    for (i = 0; i < numof(passes); i++)
+        *(passes[i].p_flag) = true;
+    settings->budget = 0;
+
+    if ((idoc = yyjson_read_file(OPTIMIZE_SETTINGS_FILE, 0, &trace_alc, NULL))){
+        for (i = 0; i < numof(passes); i++)
+            if ((ival = yyjson_obj_get(yyjson_doc_get_root(idoc), passes[i].name)) && yyjson_is_bool(ival))
+                *(passes[i].p_flag) = yyjson_get_bool(ival);
+
+        if ((ival = yyjson_obj_get(yyjson_doc_get_root(idoc), "budget")) && yyjson_is_uint(ival))
+            if (yyjson_get_uint(ival) <= INT64_MAX)
+                settings->budget = yyjson_get_uint(ival);
+
+        yyjson_doc_free(idoc);
+    }
+}
+
+
+/**
+ * @brief set the size budget of the image in the settings file, keeping the other settings.
+ *
+ * @param[in]  budget  the size budget in bytes, or 0 to remove it
+ * @return int  0 (success) or -1 (unexpected error)
+ *
+ * @note the projection recorded for the prompt is discarded, until it is measured against the new budget.
+ */
+static int save_budget(off_t budget){
+    assert(budget >= 0);
+
+    int exit_status = UNEXPECTED_ERROR;
+    yyjson_doc *idoc;
+    yyjson_mut_doc *mdoc = NULL;
+    yyjson_mut_val *mval;
+
+    if ((idoc = yyjson_read_file(OPTIMIZE_SETTINGS_FILE, 0, &trace_alc, NULL))){
+        if (yyjson_is_obj(yyjson_doc_get_root(idoc)))
+            mdoc = yyjson_doc_mut_copy(idoc, &trace_alc);
+        yyjson_doc_free(idoc);
+    }
+
+    if (! mdoc){
+        if (! (mdoc = yyjson_mut_doc_new(&trace_alc)))
+            return exit_status;
+        if ((mval = yyjson_mut_obj(mdoc)))
+            yyjson_mut_doc_set_root(mdoc, mval);
+    }
+
+    if (mdoc->root && yyjson_mut_obj_put(mdoc->root, yyjson_mut_str(mdoc, "budget"), yyjson_mut_uint(mdoc, budget)))
+        if (yyjson_mut_write_file(OPTIMIZE_SETTINGS_FILE, mdoc, YYJSON_WRITE_PRETTY, &trace_alc, NULL))
+            exit_status = SUCCESS;
+
+    yyjson_mut_doc_free(mdoc);
+    record_projection(-1, 0);
+
+    return exit_status;
+}
+
+
+
+
+/******************************************************************************
+    * Parse Phase
+******************************************************************************/
+
+
+/**
+ * @brief parse Dockerfile into the list of instructions.
+ *
+ * @param[out] ir  variable to store the list of instructions
+ * @param[in]  src  the contents of Dockerfile
+ * @return bool  successful or not
+ *
+ * @note the comments and empty lines in the middle of an instruction are kept in its original lines.
+ */
+static bool parse_dockerfile(opt_ir *ir, const char *src){
+    assert(ir);
+    assert(src);
+
+    const char *lead, *line, *next, *start, *tmp;
+    size_t line_num = 1, start_num;
+
+    for (lead = (line = src); *line; line = next, line_num++){
+        if (! (next = strchr(line, '\n')))
+            next = line + strlen(line);
+        else
+            next++;
+
+        for (tmp = line; (*tmp == ' ') || (*tmp == '\t'); tmp++);
+        if ((*tmp == '#') || (*tmp == '\n') || (*tmp == '\r') || (! *tmp))
+            continue;
+
+        start = line;
+        start_num = line_num;
+
+        while (check_if_continued(line, next) && *next){
+            do {
+                line = next;
+                line_num++;
+
+                if (! (next = strchr(line, '\n')))
+                    next = line + strlen(line);
+                else
+                    next++;
+
+                for (tmp = line; (*tmp == ' ') || (*tmp == '\t'); tmp++);
+            } while (((*tmp == '#') || (*tmp == '\n') || (*tmp == '\r')) && *next);
+        }
+
+        if (! append_instr(ir, lead, (start - lead), start, (next - start)))
+            return false;
+
+        ir->instrs[ir->instrs_num - 1].line = start_num;
+
+        if ((tmp = skip_heredoc(ir->instrs[ir->instrs_num - 1].args, next)) != next){
+            for (line = next; line < tmp; line++)
+                if (*line == '\n')
+                    line_num++;
+
+            free(ir->instrs[ir->instrs_num - 1].text);
+            if (! (ir->instrs[ir->instrs_num - 1].text = strndup(start, (tmp - start))))
+                return false;
+            next = tmp;
+        }
+
+        lead = next;
+    }
+
+    return (ir->tail = strdup(lead));
+}
+
+
+/**
+ * @brief append an instruction to the list of instructions.
+ *
+ * @param[out] ir  the list of instructions
+ * @param[in]  lead  the comments and empty lines preceding the instruction
+ * @param[in]  lead_len  the length of them
+ * @param[in]  text  the original lines of the instruction
+ * @param[in]  text_len  the length of them
+ * @return bool  successful or not
+ */
+static bool append_instr(opt_ir *ir, const char *lead, size_t lead_len, const char *text, size_t text_len){
+    assert(ir);
+    assert(lead);
+    assert(text);
+
+    opt_instr *instr;
+    const char *line, *next, *end, *tmp;
+    char *args;
+    size_t len = 0;
+
+    if (ir->instrs_num == ir->instrs_max){
+        size_t curr_max;
+        void *ptr;
+
+        if ((curr_max = ir->instrs_max)){
+            if (! (curr_max = ((curr_max + 1) << 1) - 1))
+                return false;
+        }
+        else
+            curr_max = OPT_INITIAL_INSTRS_MAX;
+
+        if (! (ptr = realloc(ir->instrs, (sizeof(opt_instr) * curr_max))))
+            return false;
+
+        ir->instrs = (opt_instr *) ptr;
+        ir->instrs_max = curr_max;
+    }
+
+    instr = ir->instrs + ir->instrs_num;
+    memset(instr, 0, sizeof(opt_instr));
+    instr->id = -1;
+
+    if (! (args = (char *) malloc(sizeof(char) * (text_len + 1))))
+        return false;
+
+    for (line = text, end = text + text_len; line < end; line = next){
+        if (! (next = memchr(line, '\n', (end - line))))
+            next = end;
+
+        for (tmp = line; (*tmp == ' ') || (*tmp == '\t'); tmp++);
+
+        if ((line == text) || ((tmp < next) && (*tmp != '#') && (*tmp != '\r'))){
+            for (tmp = next; (tmp > line) && isspace((unsigned char) tmp[-1]); tmp--);
+            if ((tmp > line) && (tmp[-1] == '\\') && (next < end))
+                tmp--;
+
+            if (len)
+                args[len++] = ' ';
+            memcpy((args + len), line, (tmp - line));
+            len += tmp - line;
+        }
+
+        if (next < end)
+            next++;
+    }
+    args[len] = '\0';
+
+    instr->args = args;
+    ir->instrs_num++;
+
+    if (! ((instr->lead = strndup(lead, lead_len)) && (instr->text = strndup(text, text_len))))
+        return false;
+
+    if ((args = receive_dockerfile_instr(args, &(instr->id))))
+        memmove(instr->args, args, (strlen(args) + 1));
+    else
+        *(instr->args) = '\0';
+
+    instr->stage = ((ir->instrs_num > 1) ? instr[-1].stage : 0) + (instr->id == ID_FROM);
+
+    if ((instr->id == ID_RUN) && (! split_run_commands(instr, instr->args))){
+        for (size_t i = instr->cmds_num; i--;){
+            free(instr->cmds[i].text);
+            for (size_t j = instr->cmds[i].words_num; j--;)
+                free(instr->cmds[i].words[j]);
+            free(instr->cmds[i].words);
+        }
+        instr->cmds_num = 0;
+    }
+
+    return true;
+}
+
+
+/**
+ * @brief check if the specified line continues to the next line.
+ *
+ * @param[in]  line  the beginning of the line
+ * @param[in]  next  the beginning of the next line
+ * @return bool  the resulting boolean
+ */
+static bool check_if_continued(const char *line, const char *next){
+    assert(line);
+    assert(next);
+
+    while ((next > line) && isspace((unsigned char) next[-1]))
+        next--;
+
+    return ((next > line) && (next[-1] == '\\'));
+}
+
+
+/**
+ * @brief skip the here-document given to the instruction, if any.
+ *
+ * @param[in]  args  the arguments of the instruction
+ * @param[in]  next  the beginning of the line following the instruction
+ * @return const char*  the beginning of the line following the here-document, or 'next' if there is none
+ */
+static const char *skip_heredoc(const char *args, const char *next){
+    assert(args);
+    assert(next);
+
+    const char *tmp, *line;
+    size_t len;
+    bool strip;
+
+    for (tmp = args; (tmp = strstr(tmp, "<<")); tmp += 2)
+        if ((tmp[2] != '<') && ((tmp == args) || (tmp[-1] != '<')))
+            break;
+
+    if (! tmp)
+        return next;
+
+    tmp += 2;
+    if ((strip = (*tmp == '-')))
+        tmp++;
+    if ((*tmp == '\'') || (*tmp == '"'))
+        tmp++;
+
+    for (len = 0; isalnum((unsigned char) tmp[len]) || (tmp[len] == '_'); len++);
+    if (! len)
+        return next;
+
+    for (line = next; *line; line = next){
+        if (! (next = strchr(line, '\n')))
+            next = line + strlen(line);
+        else
+            next++;
+
+        if (strip)
+            while (*line == '\t')
+                line++;
+
+        if ((! strncmp(line, tmp, len)) && ((line[len] == '\n') || (line[len] == '\r') || (! line[len])))
+            break;
+    }
+
+    return next;
+}
+
+
+/**
+ * @brief split the arguments of RUN instruction into the commands joined by '&&', '||' or ';'.
+ *
+ * @param[out] instr  RUN instruction
+ * @param[in]  args  the arguments of the instruction
+ * @return bool  whether the arguments could be split safely
+ *
+ * @note the arguments in exec form, the here-documents and the compound commands cannot be split.
+ * @note the flags preceding the commands are stored separately.
+ */
+static bool split_run_commands(opt_instr *instr, char *args){
+    assert(instr);
+    assert(args);
+
+    const char *start, *tmp;
+    int quote = '\0', sep = '\0', c;
+    size_t depth = 0;
+
+    while (! strncmp(args, "--", 2)){
+        while (*args && (! isspace((unsigned char) *args)))
+            args++;
+        while (isspace((unsigned char) *args))
+            args++;
+    }
+
+    if (args != instr->args){
+        if (! (instr->flags = strndup(instr->args, (args - instr->args))))
+            return false;
+
+        for (c = strlen(instr->flags); c && isspace((unsigned char) instr->flags[c - 1]); c--)
+            instr->flags[c - 1] = '\0';
+    }
+
+    if ((*args == '[') || strstr(args, "<<"))
+        return false;
+
+    for (start = (tmp = args); true; tmp++){
+        c = (unsigned char) *tmp;
+
+        if (quote){
+            if (! c)
+                return false;
+            if ((c == '\\') && (quote == '"') && tmp[1])
+                tmp++;
+            else if (c == quote)
+                quote = '\0';
+            continue;
+        }
+
+        switch (c){
+            case '\\':
+                if (tmp[1])
+                    tmp++;
+                continue;
+            case '\'':
+            case '"':
+                quote = c;
+                continue;
+            case '(':
+                depth++;
+                continue;
+            case ')':
+                if (depth)
+                    depth--;
+                continue;
+            case '#':
+                if ((tmp == args) || isspace((unsigned char) tmp[-1]))
+                    return false;
+                continue;
+            case '&':
+                if ((tmp > args) && ((tmp[-1] == '>') || (tmp[-1] == '<')))
+                    continue;
+                if (tmp[1] == '>')
+                    continue;
+                if (tmp[1] != '&')
+                    return false;
+                break;
+            case '|':
+                if (tmp[1] != '|')
+                    continue;
+                break;
+            case ';':
+            case '\0':
+                break;
+            default:
+                continue;
+        }
+
+        if (depth && c){
+            if (c != ';')
+                tmp++;
+            continue;
+        }
+
+        if (! append_cmd(instr, start, tmp, sep))
+            return false;
+
+        if (! c)
+            break;
+
+        sep = c;
+        if (c != ';')
+            tmp++;
+        start = tmp + 1;
+    }
+
+    return instr->cmds_num;
+}
+
+
+/**
+ * @brief append a command to RUN instruction.
+ *
+ * @param[out] instr  RUN instruction
+ * @param[in]  start  the beginning of the command
+ * @param[in]  end  the end of the command
+ * @param[in]  sep  the operator preceding the command
+ * @return bool  successful or not
+ *
+ * @note an empty command such as the one following the last ';' is ignored.
+ */
+static bool append_cmd(opt_instr *instr, const char *start, const char *end, int sep){
+    assert(instr);
+    assert(start);
+    assert(end >= start);
+
+    opt_cmd *cmd;
+    char *text;
+    size_t len = 0;
+    int quote = '\0';
+
+    while ((start < end) && isspace((unsigned char) *start))
+        start++;
+    while ((end > start) && isspace((unsigned char) end[-1]))
+        end--;
+
+    if (start == end)
+        return true;
+
+    if (instr->cmds_num == instr->cmds_max){
+        size_t curr_max;
+        void *ptr;
+
+        curr_max = instr->cmds_max ? (((instr->cmds_max + 1) << 1) - 1) : OPT_INITIAL_CMDS_MAX;
+
+        if (! (ptr = realloc(instr->cmds, (sizeof(opt_cmd) * curr_max))))
+            return false;
+
+        instr->cmds = (opt_cmd *) ptr;
+        instr->cmds_max = curr_max;
+    }
+
+    if (! (text = (char *) malloc(sizeof(char) * (end - start + 1))))
+        return false;
+
+    for (; start < end; start++){
+        if (quote){
+            if ((*start == '\\') && (quote == '"') && ((start + 1) < end))
+                text[len++] = *(start++);
+            else if (*start == quote)
+                quote = '\0';
+        }
+        else if (isspace((unsigned char) *start)){
+            if (text[len - 1] != ' ')
+                text[len++] = ' ';
+            continue;
+        }
+        else if (*start == '\\'){
+            if ((start + 1) < end)
+                text[len++] = *(start++);
+        }
+        else if ((*start == '\'') || (*start == '"'))
+            quote = *start;
+
+        text[len++] = *start;
+    }
+    text[len] = '\0';
+
+    cmd = instr->cmds + instr->cmds_num++;
+    memset(cmd, 0, sizeof(opt_cmd));
+    cmd->text = text;
+    cmd->sep = sep;
+
+    if (! split_words(cmd))
+        return false;
+
+    classify_cmd(cmd);
+
+    if ((cmd->kind == OPT_CMD_OTHER) && cmd->words_num){
+        size_t i;
+        for (i = 0; i < numof(compound_words); i++)
+            if (! strcmp(cmd->words[cmd->verb], compound_words[i]))
+                return false;
+    }
+    return true;
+}
+
+
+/**
+ * @brief split the command into the words separated by spaces outside quotes.
+ *
+ * @param[out] cmd  the command
+ * @return bool  successful or not
+ *
+ * @note each word keeps its quotes as they are.
+ */
+static bool split_words(opt_cmd *cmd){
+    assert(cmd);
+    assert(cmd->text);
+
+    const char *start, *tmp;
+    size_t words_max = 0;
+    int quote;
+    void *ptr;
+
+    for (tmp = cmd->text; *tmp;){
+        for (start = tmp, quote = '\0'; *tmp && (quote || (*tmp != ' ')); tmp++){
+            if (quote){
+                if ((*tmp == '\\') && (quote == '"') && tmp[1])
+                    tmp++;
+                else if (*tmp == quote)
+                    quote = '\0';
+            }
+            else if (*tmp == '\\'){
+                if (tmp[1])
+                    tmp++;
+            }
+            else if ((*tmp == '\'') || (*tmp == '"'))
+                quote = *tmp;
+        }
+
+        if ((cmd->words_num + 1) >= words_max){
+            words_max = words_max ? (((words_max + 1) << 1) - 1) : OPT_INITIAL_WORDS_MAX;
+
+            if (! (ptr = realloc(cmd->words, (sizeof(char *) * words_max))))
+                return false;
+            cmd->words = (char **) ptr;
+        }
+
+        if (! (cmd->words[cmd->words_num] = strndup(start, (tmp - start))))
+            return false;
+        cmd->words[++(cmd->words_num)] = NULL;
+
+        if (*tmp)
+            tmp++;
+    }
+
+    return cmd->words;
+}
+
+
+/**
+ * @brief classify what the command does.
+ *
+ * @param[out] cmd  the command
+ *
+ * @note the variable assignments and 'sudo' or 'env' preceding the executable are skipped.
+ */
+static void classify_cmd(opt_cmd *cmd){
+    assert(cmd);
+
+    const char *verb, *word;
+    size_t i, j;
+
+    cmd->kind = OPT_CMD_OTHER;
+    cmd->manager = -1;
+
+    for (i = 0; (i < cmd->words_num); i++){
+        word = cmd->words[i];
+
+        if ((isalpha((unsigned char) *word) || (*word == '_')) && (word = strchr(word, '='))){
+            for (j = 0; (cmd->words[i] + j) < word; j++)
+                if (! (isalnum((unsigned char) cmd->words[i][j]) || (cmd->words[i][j] == '_')))
+                    break;
+            if ((cmd->words[i] + j) == word)
+                continue;
+        }
+        else if ((! strcmp(cmd->words[i], "sudo")) || (! strcmp(cmd->words[i], "env")))
+            continue;
+        else if ((*(cmd->words[i]) == '-') && i && (! strcmp(basename_of(cmd->words[i - 1]), "sudo")))
+            continue;
+
+        break;
+    }
+
+    if (i >= cmd->words_num){
+        cmd->kind = OPT_CMD_TRIVIAL;
+        return;
+    }
+
+    cmd->verb = i;
+    verb = basename_of(cmd->words[i]);
+
+    if ((! strcmp(verb, "set")) || (! strcmp(verb, ":")) || (! strcmp(verb, "true"))){
+        cmd->kind = OPT_CMD_TRIVIAL;
+        return;
+    }
+
+    for (j = 0; j < OPT_PKG_MANAGERS_NUM; j++)
+        if (! strcmp(verb, pkg_managers[j].name)){
+            const pkg_manager *manager;
+
+            manager = pkg_managers + j;
+            cmd->manager = j;
+
+            if (! (cmd->sub = find_subcommand(cmd, manager)))
+                return;
+
+            word = cmd->words[cmd->sub];
+
+            if (! strcmp(word, manager->install))
+                cmd->kind = OPT_CMD_INSTALL;
+            else if (! strcmp(word, manager->update))
+                cmd->kind = OPT_CMD_UPDATE;
+            else if (! strcmp(word, "clean"))
+                cmd->kind = OPT_CMD_CLEAN;
+            else if ((! strcmp(word, "cache")) && cmd->words[cmd->sub + 1] && (! strcmp(cmd->words[cmd->sub + 1], "clean")))
+                cmd->kind = OPT_CMD_CLEAN;
+            else if (! strcmp(word, "config-manager"))
+                cmd->kind = OPT_CMD_SOURCES;
+            else
+                for (const char * const *p_word = manager->removes; *p_word; p_word++)
+                    if (! strcmp(word, *p_word)){
+                        cmd->kind = OPT_CMD_REMOVE;
+                        break;
+                    }
+            return;
+        }
+
+    for (j = 0; j < numof(sources_cmds); j++)
+        if (! strcmp(verb, sources_cmds[j])){
+            cmd->kind = OPT_CMD_SOURCES;
+            return;
+        }
+
+    for (i = cmd->verb + 1; i < cmd->words_num; i++){
+        word = cmd->words[i];
+
+        if ((! strcmp(verb, "rpm")) && (! strcmp(word, "--import")))
+            cmd->kind = OPT_CMD_SOURCES;
+        else if ((! strcmp(verb, "dpkg")) && (! strcmp(word, "--add-architecture")))
+            cmd->kind = OPT_CMD_SOURCES;
+        else
+            for (j = 0; j < numof(sources_paths); j++)
+                if (strstr(word, sources_paths[j]))
+                    cmd->kind = OPT_CMD_SOURCES;
+
+        if (cmd->kind == OPT_CMD_SOURCES)
+            return;
+    }
+
+    if (! strcmp(verb, "rm"))
+        for (i = cmd->verb + 1; i < cmd->words_num; i++)
+            for (j = 0; j < OPT_PKG_MANAGERS_NUM; j++)
+                if (! strncmp(cmd->words[i], pkg_managers[j].cache, strlen(pkg_managers[j].cache))){
+                    cmd->kind = OPT_CMD_CLEAN;
+                    cmd->manager = j;
+                    return;
+                }
+}
+
+
+/**
+ * @brief find the subcommand given to the package manager.
+ *
+ * @param[in]  cmd  the command operating the package manager
+ * @param[in]  manager  the package manager
+ * @return size_t  index of the subcommand word, or 0 if there is none
+ */
+static size_t find_subcommand(const opt_cmd *cmd, const pkg_manager *manager){
+    assert(cmd);
+    assert(manager);
+
+    size_t i;
+    bool has_arg;
+
+    for (i = cmd->verb + 1; i < cmd->words_num; i++)
+        if (check_if_option(cmd, i, manager, &has_arg))
+            i += has_arg;
+        else
+            return i;
+
+    return 0;
+}
+
+
+
+
+/******************************************************************************
+    * Hygiene Pass
+******************************************************************************/
+
+
+/**
+ * @brief make each package manager leave no cache in the layer where it runs.
+ *
+ * @param[out] ir  the list of instructions
+ * @param[in]  recorded  the package manager recorded by dit, or NULL
+ *
+ * @note the missing option is given to the command, or the missing cleanup is appended to the same RUN instruction.
+ * @note the cleanup is not appended if a later RUN instruction in the same stage uses the cache without refilling it.
+ * @note the bytes saved are estimated from the caches in this container, only for the recorded package manager.
+ */
+static void apply_hygiene(opt_ir *ir, const char *recorded){
+    assert(ir);
+
+    off_t savings[numof(hygiene_rules)], saving, total = 0;
+    bool disabled[numof(hygiene_rules)] = {0}, appended[numof(hygiene_rules)];
+    size_t cmds_num, fixes_num = 0, i, j, k, sub, needed;
+    const hygiene_rule *rule;
+    opt_instr *instr;
+    opt_cmd *cmd;
+    int sep;
+
+    for (k = 0; k < numof(hygiene_rules); k++)
+        savings[k] = -1;
+
+    for (i = 0; i < ir->instrs_num; i++){
+        instr = ir->instrs + i;
+
+        for (k = 0; k < numof(hygiene_rules); k++){
+            if (! hygiene_rules[k].env)
+                continue;
+
+            if (instr->id == ID_FROM)
+                disabled[k] = false;
+            else if (((instr->id == ID_ENV) || (instr->id == ID_ARG)) && strstr(instr->args, hygiene_rules[k].env))
+                disabled[k] = true;
+        }
+
+        if ((instr->id != ID_RUN) || (! instr->cmds_num))
+            continue;
+
+        memset(appended, false, sizeof(appended));
+        sep = '&';
+
+        for (j = 1; j < instr->cmds_num; j++)
+            if (instr->cmds[j].sep == ';'){
+                sep = ';';
+                break;
+            }
+
+        for (cmds_num = instr->cmds_num, j = 0; j < cmds_num; j++){
+            cmd = instr->cmds + j;
+
+            for (k = 0; (! cmd->removed) && (k < numof(hygiene_rules)); k++){
+                rule = hygiene_rules + k;
+
+                if (! (sub = match_hygiene_rule(cmd, rule)))
+                    continue;
+                if (rule->env && (disabled[k] || strstr(cmd->text, rule->env)))
+                    continue;
+                if (rule->cleaned && check_if_cleaned(instr, j, rule))
+                    continue;
+                if (rule->cleanup && (! appended[k]) && (needed = check_if_needed_later(ir, i, rule))){
+                    fprintf(ir->report, "hygiene: line %zu: kept '%s' after '%s %s', since line %zu needs it\n",
+                        instr->line, rule->cache, rule->tool, cmd->words[sub], needed);
+                    appended[k] = true;
+                    continue;
+                }
+
+                if (rule->option){
+                    size_t n;
+                    for (n = cmd->verb + 1; n < cmd->words_num; n++)
+                        if ((! strcmp(cmd->words[n], rule->option)) || (rule->alias && strstr(cmd->words[n], rule->alias)))
+                            break;
+                    if (n < cmd->words_num)
+                        continue;
+
+                    if (! insert_option(cmd, sub, rule->option))
+                        return;
+                    fprintf(ir->report, "hygiene: line %zu: added '%s' to '%s %s'", instr->line, rule->option, rule->tool, cmd->words[sub]);
+                }
+                else {
+                    if (appended[k])
+                        continue;
+
+                    if (! append_cmd(instr, rule->cleanup, (rule->cleanup + strlen(rule->cleanup)), sep))
+                        return;
+                    cmd = instr->cmds + j;
+                    appended[k] = true;
+                    fprintf(ir->report, "hygiene: line %zu: appended '%s' after '%s %s'", instr->line, rule->cleanup, rule->tool, cmd->words[sub]);
+                }
+
+                instr->modified = true;
+                fixes_num++;
+
+                if (savings[k] < 0)
+                    savings[k] = estimate_hygiene_saving(rule, recorded);
+
+                if ((saving = savings[k]) > 0){
+                    fputs(", saving about ", ir->report);
+                    print_saving(ir->report, saving);
+                    total += saving;
+
+                    for (size_t m = 0; m < numof(hygiene_rules); m++)
+                        if ((rule->cache && hygiene_rules[m].cache && (! strcmp(rule->cache, hygiene_rules[m].cache))) ||
+                            ((! rule->cache) && (! hygiene_rules[m].cache) && (rule->option == hygiene_rules[m].option)))
+                            savings[m] = 0;
+                }
+                fputc('\n', ir->report);
+            }
+        }
+    }
+
+    if (fixes_num){
+        fprintf(ir->report, "hygiene: %zu fix%s, saving about ", fixes_num, ((fixes_num > 1) ? "es" : ""));
+        print_saving(ir->report, total);
+        fputs(" in total as far as measured in this container\n", ir->report);
+    }
+}
+
+
+/**
+ * @brief check if the command is one the specified rule applies to.
+ *
+ * @param[in]  cmd  the command
+ * @param[in]  rule  the rule
+ * @return size_t  index of the subcommand word, or 0 if the rule does not apply
+ */
+static size_t match_hygiene_rule(const opt_cmd *cmd, const hygiene_rule *rule){
+    assert(cmd);
+    assert(rule);
+
+    return match_subcommand(cmd, rule->tool, rule->subs);
+}
+
+
+/**
+ * @brief check if the command runs the specified tool with any of the specified subcommands.
+ *
+ * @param[in]  cmd  the command
+ * @param[in]  tool  name of the executable
+ * @param[in]  subs  null-terminated array of the subcommands
+ * @return size_t  index of the subcommand word, or 0 if there is no match
+ *
+ * @note 'python -m pip' is regarded as running 'pip'.
+ */
+static size_t match_subcommand(const opt_cmd *cmd, const char *tool, const char * const *subs){
+    assert(cmd);
+    assert(tool);
+    assert(subs);
+
+    const char * const *p_sub;
+    size_t i;
+
+    if ((cmd->kind == OPT_CMD_TRIVIAL) || (! cmd->words_num))
+        return 0;
+
+    i = cmd->verb;
+
+    if (strcmp(basename_of(cmd->words[i]), tool)){
+        if (strncmp(basename_of(cmd->words[i]), "python", 6) || ((i + 2) >= cmd->words_num))
+            return 0;
+        if (strcmp(cmd->words[i + 1], "-m") || strcmp(cmd->words[i + 2], tool))
+            return 0;
+        i += 2;
+    }
+
+    if ((i == cmd->verb) && (cmd->manager >= 0))
+        i = cmd->sub;
+    else
+        for (i++; (i < cmd->words_num) && (*(cmd->words[i]) == '-'); i++);
+
+    if (i && (i < cmd->words_num))
+        for (p_sub = subs; *p_sub; p_sub++)
+            if (! strcmp(cmd->words[i], *p_sub))
+                return i;
+
+    return 0;
+}
+
+
+/**
+ * @brief check if any command following the specified one in the same instruction does the cleanup.
+ *
+ * @param[in]  instr  RUN instruction
+ * @param[in]  i  index of the command
+ * @param[in]  rule  the rule
+ * @return bool  the resulting boolean
+ *
+ * @note unless the cleanup is given as a path, it must be done by the same tool as the rule applies to.
+ */
+static bool check_if_cleaned(const opt_instr *instr, size_t i, const hygiene_rule *rule){
+    assert(instr);
+    assert(rule);
+    assert(rule->cleaned);
+
+    const opt_cmd *cmd;
+
+    for (i++; i < instr->cmds_num; i++){
+        cmd = instr->cmds + i;
+
+        if (cmd->removed || (! strstr(cmd->text, rule->cleaned)))
+            continue;
+        if ((*(rule->cleaned) == '/') || (cmd->words_num && (! strcmp(basename_of(cmd->words[cmd->verb]), rule->tool))))
+            return true;
+    }
+
+    return false;
+}
+
+
+/**
+ * @brief check if any later RUN instruction in the same stage needs the cache the cleanup of the rule removes.
+ *
+ * @param[in]  ir  the list of instructions
+ * @param[in]  i  index of the RUN instruction the cleanup would be appended to
+ * @param[in]  rule  the rule
+ * @return size_t  the line number of the instruction that needs the cache, or 0 if there is none
+ *
+ * @note an instruction that refills the cache before using it, like 'apt-get update', ends the search.
+ * @note the rules sharing the same cache, such as those for 'apt' and 'apt-get', are checked together.
+ */
+static size_t check_if_needed_later(const opt_ir *ir, size_t i, const hygiene_rule *rule){
+    assert(ir);
+    assert(i < ir->instrs_num);
+    assert(rule);
+
+    const opt_instr *instr;
+    const opt_cmd *cmd;
+    const hygiene_rule *other;
+    size_t stage, j, k;
+
+    if (! (rule->needs && rule->cache))
+        return 0;
+
+    for (stage = ir->instrs[i++].stage; (i < ir->instrs_num) && (ir->instrs[i].stage == stage); i++){
+        instr = ir->instrs + i;
+
+        if (instr->id != ID_RUN)
+            continue;
+
+        for (j = 0; j < instr->cmds_num; j++){
+            cmd = instr->cmds + j;
+
+            if (cmd->removed)
+                continue;
+
+            for (k = 0; k < numof(hygiene_rules); k++){
+                other = hygiene_rules + k;
+
+                if (! (other->needs && other->cache && (! strcmp(other->cache, rule->cache))))
+                    continue;
+                if (other->refills && match_subcommand(cmd, other->tool, other->refills))
+                    return 0;
+                if (match_subcommand(cmd, other->tool, other->needs))
+                    return instr->line;
+            }
+        }
+    }
+
+    return 0;
+}
+
+
+/**
+ * @brief insert the option just after the specified word of the command.
+ *
+ * @param[out] cmd  the command
+ * @param[in]  i  index of the word
+ * @param[in]  option  the option
+ * @return bool  successful or not
+ *
+ * @note the command text is rebuilt from its words.
+ */
+static bool insert_option(opt_cmd *cmd, size_t i, const char *option){
+    assert(cmd);
+    assert(i < cmd->words_num);
+    assert(option);
+
+    char *text, *word;
+    size_t len, n;
+    void *ptr;
+
+    len = strlen(cmd->text) + strlen(option) + 2;
+
+    if (! (text = (char *) malloc(sizeof(char) * len)))
+        return false;
+    if (! (word = strdup(option))){
+        free(text);
+        return false;
+    }
+    if (! (ptr = realloc(cmd->words, (sizeof(char *) * (cmd->words_num + 2))))){
+        free(word);
+        free(text);
+        return false;
+    }
+
+    cmd->words = (char **) ptr;
+    memmove((cmd->words + i + 2), (cmd->words + i + 1), (sizeof(char *) * (cmd->words_num - i)));
+    cmd->words[i + 1] = word;
+    cmd->words_num++;
+
+    for (len = 0, n = 0; n < cmd->words_num; n++)
+        len += sprintf((text + len), (n ? " %s" : "%s"), cmd->words[n]);
+
+    free(cmd->text);
+    cmd->text = text;
+
+    return true;
+}
+
+
+/**
+ * @brief estimate the bytes the specified rule saves in each layer.
+ *
+ * @param[in]  rule  the rule
+ * @param[in]  recorded  the package manager recorded by dit, or NULL
+ * @return off_t  the estimated bytes, or 0 if unknown
+ *
+ * @note the cache is measured as it is in this container, which reflects the commands already executed.
+ */
+static off_t estimate_hygiene_saving(const hygiene_rule *rule, const char *recorded){
+    assert(rule);
+
+    off_t sizes[3];
+
+    if (recorded && rule->recorded && strcmp(recorded, rule->recorded))
+        return 0;
+
+    if (! rule->cache)
+        return (rule->option && (! strcmp(rule->option, "--no-install-recommends"))) ? estimate_recommends_size() : 0;
+
+    return measure_dir_tree(rule->cache, false, sizes) ? sizes[0] : 0;
+}
+
+
+/**
+ * @brief estimate the installed size of the packages pulled in only as recommended ones.
+ *
+ * @return off_t  the estimated bytes, or 0 if unknown
+ *
+ * @note the essential packages and the ones not marked as automatically installed by apt are regarded as needed.
+ * @note every installed alternative or provider of a dependency is regarded as needed.
+ */
+static off_t estimate_recommends_size(void){
+    dpkg_pkg *pkgs = NULL, *pkg, key = {0};
+    char *src, *states, *line, *next, *name = NULL;
+    size_t pkgs_num = 0, i;
+    off_t size = 0;
+
+    if (! (src = read_whole_file(DPKG_STATUS_FILE, NULL)))
+        return 0;
+
+    if ((pkgs_num = parse_dpkg_status(src, &pkgs)) && (states = read_whole_file(APT_EXTENDED_STATES_FILE, NULL))){
+        for (line = states; *line; line = next){
+            if ((next = strchr(line, '\n')))
+                *(next++) = '\0';
+            else
+                next = line + strlen(line);
+
+            if (! strncmp(line, "Package:", 8))
+                for (name = line + 8; *name == ' '; name++);
+            else if (name && (! strcmp(line, "Auto-Installed: 1"))){
+                key.name = name;
+                if ((pkg = (dpkg_pkg *) bsearch(&key, pkgs, pkgs_num, sizeof(dpkg_pkg), qcmp_dpkg_pkg)))
+                    pkg->manual = false;
+            }
+        }
+        free(states);
+
+        for (i = 0; i < pkgs_num; i++)
+            if (pkgs[i].installed && (pkgs[i].manual || pkgs[i].essential) && (! pkgs[i].kept))
+                keep_dpkg_depends(pkgs, pkgs_num, (pkgs + i));
+
+        for (i = 0; i < pkgs_num; i++)
+            if (pkgs[i].installed && (! pkgs[i].kept))
+                size += pkgs[i].size;
+    }
+
+    free(pkgs);
+    free(src);
+    return size;
+}
+
+
+/**
+ * @brief parse the database of dpkg into the array of packages sorted by name.
+ *
+ * @param[out] src  the contents of the database
+ * @param[out] p_pkgs  variable to store the array of packages
+ * @return size_t  the number of the packages
+ *
+ * @note the packages point to the contents of the database, which are split into lines in place.
+ * @attention if the return value is non-zero, the array should be released by the caller.
+ */
+static size_t parse_dpkg_status(char *src, dpkg_pkg **p_pkgs){
+    assert(src);
+    assert(p_pkgs);
+
+    dpkg_pkg *pkgs = NULL, *pkg = NULL;
+    size_t pkgs_num = 0, pkgs_max = 0;
+    char *line, *next, *value;
+    void *ptr;
+
+    for (line = src; *line; line = next){
+        if ((next = strchr(line, '\n')))
+            *(next++) = '\0';
+        else
+            next = line + strlen(line);
+
+        if (! *line){
+            pkg = NULL;
+            continue;
+        }
+        if (isspace((unsigned char) *line) || (! (value = strchr(line, ':'))))
+            continue;
+
+        for (*(value++) = '\0'; *value == ' '; value++);
+
+        if (! strcmp(line, "Package")){
+            if (pkgs_num == pkgs_max){
+                pkgs_max = pkgs_max ? (((pkgs_max + 1) << 1) - 1) : OPT_INITIAL_INSTRS_MAX;
+
+                if (! (ptr = realloc(pkgs, (sizeof(dpkg_pkg) * pkgs_max)))){
+                    free(pkgs);
+                    return 0;
+                }
+                pkgs = (dpkg_pkg *) ptr;
+            }
+
+            pkg = pkgs + pkgs_num++;
+            memset(pkg, 0, sizeof(dpkg_pkg));
+            pkg->name = value;
+            pkg->manual = true;
+        }
+        else if (pkg){
+            if (! strcmp(line, "Status"))
+                pkg->installed = (strlen(value) > 10) && (! strcmp((value + strlen(value) - 10), " installed"));
+            else if (! strcmp(line, "Installed-Size"))
+                pkg->size = strtoll(value, NULL, 10) * 1024;
+            else if (! strcmp(line, "Depends"))
+                pkg->depends[0] = value;
+            else if (! strcmp(line, "Pre-Depends"))
+                pkg->depends[1] = value;
+            else if (! strcmp(line, "Provides"))
+                pkg->provides = value;
+            else if ((! strcmp(line, "Essential")) && (! strcmp(value, "yes")))
+                pkg->essential = true;
+        }
+    }
+
+    if (pkgs_num)
+        qsort(pkgs, pkgs_num, sizeof(dpkg_pkg), qcmp_dpkg_pkg);
+    else
+        free(pkgs);
+
+    *p_pkgs = pkgs;
+    return pkgs_num;
+}
+
+
+/**
+ * @brief mark the package and the ones it depends on as needed, recursively.
+ *
+ * @param[out] pkgs  the array of packages sorted by name
+ * @param[in]  pkgs_num  the number of the packages
+ * @param[out] pkg  the package
+ */
+static void keep_dpkg_depends(dpkg_pkg *pkgs, size_t pkgs_num, dpkg_pkg *pkg){
+    assert(pkgs);
+    assert(pkg);
+
+    dpkg_pkg *dep, key = {0};
+    const char *value, *provided;
+    char name[256];
+    size_t len, i, j;
+
+    pkg->kept = true;
+
+    for (i = 0; i < numof(pkg->depends); i++)
+        for (value = pkg->depends[i]; value && *value;){
+            value += strspn(value, " ,|");
+            len = strcspn(value, " ,|:(");
+
+            if (len && (len < sizeof(name))){
+                memcpy(name, value, len);
+                name[len] = '\0';
+                key.name = name;
+
+                if ((dep = (dpkg_pkg *) bsearch(&key, pkgs, pkgs_num, sizeof(dpkg_pkg), qcmp_dpkg_pkg))){
+                    if (dep->installed && (! dep->kept))
+                        keep_dpkg_depends(pkgs, pkgs_num, dep);
+                }
+                else
+                    for (j = 0; j < pkgs_num; j++)
+                        if (pkgs[j].installed && (! pkgs[j].kept) && (provided = pkgs[j].provides))
+                            for (; (provided = strstr(provided, name)); provided += len)
+                                if (((provided == pkgs[j].provides) || strchr(" ,", provided[-1])) && strchr(" ,:(", provided[len])){
+                                    keep_dpkg_depends(pkgs, pkgs_num, (pkgs + j));
+                                    break;
+                                }
+            }
+
+            value += len;
+            value += strcspn(value, ",|");
+        }
+}
+
+
+
+
+/******************************************************************************
+    * Consolidation Pass
+******************************************************************************/
+
+
+/**
+ * @brief consolidate the package installations in each stage into one early layer.
+ *
+ * @param[out] ir  the list of instructions
+ *
+ * @note the index of the package manager is updated only once in the new layer.
+ */
+static void consolidate_installs(opt_ir *ir){
+    assert(ir);
+
+    size_t start, end;
+
+    for (start = 0; start < ir->instrs_num; start = end){
+        for (end = start + 1; (end < ir->instrs_num) && (ir->instrs[end].id != ID_FROM); end++);
+
+        if (ir->instrs[start].id == ID_FROM)
+            consolidate_stage(ir, start, end);
+    }
+}
+
+
+/**
+ * @brief consolidate the package installations in the specified stage.
+ *
+ * @param[out] ir  the list of instructions
+ * @param[in]  start  index of FROM instruction beginning the stage
+ * @param[in]  end  index of the instruction following the stage
+ *
+ * @note each change in the package sources or each barrier after an installation begins a new group.
+ */
+static void consolidate_stage(opt_ir *ir, size_t start, size_t end){
+    assert(ir);
+    assert(start < end);
+
+    size_t i, j = 0;
+
+    for (i = start + 1; i < end;)
+        i = consolidate_group(ir, i, &j, end);
+}
+
+
+/**
+ * @brief consolidate the package installations up to the next change in the package sources or the next barrier.
+ *
+ * @param[out] ir  the list of instructions
+ * @param[in]  first  index of the instruction beginning the group
+ * @param[out] p_cmd  index of the command beginning the group, to which that of the next group is stored
+ * @param[in]  end  index of the instruction following the stage
+ * @return size_t  index of the instruction beginning the next group, or 'end'
+ *
+ * @note the new layer is placed just after the last instruction the installations may depend on.
+ * @note an index update is removed only if all the installations it serves are moved to the new layer.
+ * @note an installation that no other one can join is reported as left, like those that cannot be moved.
+ */
+static size_t consolidate_group(opt_ir *ir, size_t first, size_t *p_cmd, size_t end){
+    assert(ir);
+    assert(first < end);
+    assert(p_cmd);
+
+    opt_loc *locs, loc;
+    const char **extras;
+    size_t point, next = end, stop, locs_num = 0, extras_num = 0, updates_num = 0, i, j, k;
+    const opt_cmd *model = NULL, *update = NULL, *cmd;
+    const char *reason;
+    opt_instr *instr;
+    bool hoisted;
+    char *layer;
+
+    j = *p_cmd;
+    *p_cmd = 0;
+
+    if (! (locs = (opt_loc *) malloc(sizeof(opt_loc) * (end - first))))
+        return end;
+    if (! (extras = (const char **) malloc(sizeof(char *) * (end - first)))){
+        free(locs);
+        return end;
+    }
+
+    point = first;
+
+    for (i = first; (i < end) && (next == end); i++, j = 0){
+        instr = ir->instrs + i;
+
+        // the instruction the group resumes from in the middle has already been found not to be a barrier
+        if ((! j) && check_if_barrier(instr)){
+            if (locs_num){
+                next = i;
+                break;
+            }
+            point = i + 1;
+            continue;
+        }
+
+        for (; j < instr->cmds_num; j++){
+            cmd = instr->cmds + j;
+
+            if ((cmd->kind == OPT_CMD_SOURCES) || (cmd->kind == OPT_CMD_REMOVE)){
+                if (locs_num){
+                    next = i;
+                    *p_cmd = j;
+                    break;
+                }
+                point = i + 1;
+            }
+            else if (cmd->kind == OPT_CMD_INSTALL){
+                if (point > i)
+                    reason = "it follows a change of the package sources in the same instruction";
+                else {
+                    loc.instr = i;
+                    loc.cmd = j;
+
+                    if (! (reason = check_if_hoistable(ir, &loc, point, model))){
+                        if (! model)
+                            model = cmd;
+                        if (locs_num < (end - first))
+                            locs[locs_num++] = loc;
+                        continue;
+                    }
+                }
+                fprintf(ir->report, "consolidate: line %zu: left as it is, since %s\n", instr->line, reason);
+            }
+        }
+    }
+
+    if (! model)
+        goto exit;
+
+    // the commands of the next group are left to it, including those following its beginning in the same instruction
+    stop = (next < end) ? (next + 1) : end;
+
+    for (i = point; i < stop; i++)
+        for (instr = ir->instrs + i, j = 0; j < instr->cmds_num; j++){
+            if ((i == next) && (j == *p_cmd))
+                break;
+            if ((instr->cmds[j].kind != OPT_CMD_UPDATE) || (! check_if_same_manager(instr->cmds[j].manager, model->manager)))
+                continue;
+
+            hoisted = true;
+
+            for (size_t m = i, n = j + 1; hoisted && (m < end); m++, n = 0)
+                for (; n < ir->instrs[m].cmds_num; n++){
+                    cmd = ir->instrs[m].cmds + n;
+
+                    if (! check_if_same_manager(cmd->manager, model->manager))
+                        continue;
+                    if (cmd->kind == OPT_CMD_UPDATE){
+                        m = end;
+                        break;
+                    }
+                    if (cmd->kind == OPT_CMD_INSTALL){
+                        for (k = 0; k < locs_num; k++)
+                            if ((locs[k].instr == m) && (locs[k].cmd == n))
+                                break;
+                        if (k == locs_num){
+                            hoisted = false;
+                            break;
+                        }
+                    }
+                }
+
+            if (hoisted){
+                instr->cmds[j].removed = true;
+                if (! updates_num++)
+                    update = instr->cmds + j;
+            }
+        }
+
+    if ((locs_num < 2) && (updates_num < 2)){
+        for (i = point; i < stop; i++)
+            for (j = 0; j < ir->instrs[i].cmds_num; j++)
+                if ((ir->instrs[i].cmds[j].kind == OPT_CMD_UPDATE) && ((i != next) || (j < *p_cmd)))
+                    ir->instrs[i].cmds[j].removed = false;
+
+        for (k = 0; k < locs_num; k++)
+            fprintf(ir->report, "consolidate: line %zu: left as it is, since no other installation can join it\n",
+                ir->instrs[locs[k].instr].line);
+        goto exit;
+    }
+
+    for (k = 0; k < locs_num; k++)
+        ir->instrs[locs[k].instr].cmds[locs[k].cmd].removed = true;
+
+    for (k = 0; k < locs_num; k++){
+        if (k && (locs[k].instr == locs[k - 1].instr))
+            continue;
+
+        instr = ir->instrs + locs[k].instr;
+
+        for (hoisted = true, j = 0; j < instr->cmds_num; j++){
+            cmd = instr->cmds + j;
+            if ((! cmd->removed) && check_if_same_manager(cmd->manager, model->manager) &&
+                ((cmd->kind == OPT_CMD_INSTALL) || (cmd->kind == OPT_CMD_UPDATE)))
+                hoisted = false;
+        }
+
+        if (hoisted)
+            for (j = 0; j < instr->cmds_num; j++){
+                cmd = instr->cmds + j;
+                if ((! cmd->removed) && (cmd->kind == OPT_CMD_CLEAN) && check_if_same_manager(cmd->manager, model->manager)){
+                    for (i = 0; i < extras_num; i++)
+                        if (! strcmp(extras[i], cmd->text))
+                            break;
+                    if (i == extras_num)
+                        extras[extras_num++] = cmd->text;
+                    instr->cmds[j].removed = true;
+                }
+            }
+    }
+
+    if ((layer = render_install_layer(ir, locs, locs_num, update, extras, extras_num))){
+        instr = ir->instrs + point;
+        instr->before = layer;
+
+        for (i = point; i < stop; i++)
+            for (j = 0; j < ir->instrs[i].cmds_num; j++)
+                if (ir->instrs[i].cmds[j].removed){
+                    update_removed_instr(ir->instrs + i);
+                    break;
+                }
+
+        fprintf(ir->report, "consolidate: line %zu: inserted one layer installing the packages of line", instr->line);
+        for (k = 0; k < locs_num; k++)
+            if ((! k) || (locs[k].instr != locs[k - 1].instr))
+                fprintf(ir->report, (k ? ", %zu" : " %zu"), ir->instrs[locs[k].instr].line);
+        fprintf(ir->report, ", where %zu index update%s merged into one\n", updates_num, ((updates_num == 1) ? " is" : "s are"));
+    }
+
+exit:
+    free(locs);
+    free(extras);
+    return next;
+}
+
+
+/**
+ * @brief check if the installation can be moved to the specified position.
+ *
+ * @param[in]  ir  the list of instructions
+ * @param[in]  loc  the location of the installation
+ * @param[in]  point  index of the instruction before which the new layer is inserted
+ * @param[in]  model  the first installation moved to the new layer, or NULL
+ * @return const char*  the reason why it cannot be moved, or NULL
+ *
+ * @note it cannot be moved if any command it would overtake mentions any package it installs,
+ * since such a command may depend on the absence of the package.
+ */
+static const char *check_if_hoistable(const opt_ir *ir, const opt_loc *loc, size_t point, const opt_cmd *model){
+    assert(ir);
+    assert(loc);
+    assert(point <= loc->instr);
+
+    static char reason[BUFSIZ];
+
+    const opt_instr *instr;
+    const opt_cmd *cmd, *other;
+    size_t i, j, k, n;
+    bool has_arg;
+
+    instr = ir->instrs + loc->instr;
+    cmd = instr->cmds + loc->cmd;
+
+    if ((cmd->sep == '|') || (((loc->cmd + 1) < instr->cmds_num) && (instr->cmds[loc->cmd + 1].sep == '|')))
+        return "it is run conditionally";
+    if (instr->flags)
+        return "its instruction has some flags such as '--mount'";
+    if (strpbrk(cmd->text, "$`<>|"))
+        return "it uses some variables, substitutions or redirections";
+    if (model && (! check_if_same_manager(model->manager, cmd->manager)))
+        return "it uses another package manager";
+    if (model && (! compare_install_opts(model, cmd)))
+        return "it is given different options";
+
+    for (i = cmd->sub + 1; i < cmd->words_num; i++){
+        if (check_if_option(cmd, i, (pkg_managers + cmd->manager), &has_arg)){
+            if ((! strcmp(cmd->words[i], "--virtual")) ||
+                ((! strcmp(pkg_managers[cmd->manager].name, "apk")) && (! strcmp(cmd->words[i], "-t"))))
+                return "it installs a virtual package";
+            i += has_arg;
+            continue;
+        }
+
+        if (check_if_local_package(cmd->words[i]))
+            return "it installs some local files";
+
+        for (j = point; j <= loc->instr; j++)
+            for (n = ((j == loc->instr) ? loc->cmd : ir->instrs[j].cmds_num), k = 0; k < n; k++){
+                other = ir->instrs[j].cmds + k;
+
+                if ((other->kind != OPT_CMD_OTHER) || other->removed)
+                    continue;
+
+                for (size_t m = 0; m < other->words_num; m++)
+                    if (match_package_name(other->words[m], cmd->words[i])){
+                        snprintf(reason, sizeof(reason), "line %zu may depend on the absence of %s", ir->instrs[j].line, cmd->words[i]);
+                        return reason;
+                    }
+            }
+    }
+
+    return NULL;
+}
+
+
+/**
+ * @brief check if the instruction is what the package installations following it may depend on.
+ *
+ * @param[in]  instr  the instruction
+ * @return bool  the resulting boolean
+ *
+ * @note they are switching users, copying the files into the package sources, and changing the variables
+ * that the package managers refer to.
+ */
+static bool check_if_barrier(const opt_instr *instr){
+    assert(instr);
+    assert(instr->args);
+
+    size_t i;
+
+    switch (instr->id){
+        case ID_USER:
+        case ID_SHELL:
+        case ID_ONBUILD:
+            return true;
+        case ID_ADD:
+        case ID_COPY:
+            for (i = 0; i < numof(sources_paths); i++)
+                if (strstr(instr->args, sources_paths[i]))
+                    return true;
+            return false;
+        case ID_ARG:
+        case ID_ENV:
+            for (i = 0; i < numof(install_envs); i++)
+                if (strstr(instr->args, install_envs[i]))
+                    return true;
+            return false;
+        case ID_RUN:
+            return (! instr->cmds_num) && strstr(instr->args, "/etc/");
+    }
+
+    return false;
+}
+
+
+/**
+ * @brief compare the options of the two installations, regardless of their order and the options to say yes.
+ *
+ * @param[in]  cmd1  an installation
+ * @param[in]  cmd2  another installation
+ * @return bool  whether they are given the same options
+ */
+static bool compare_install_opts(const opt_cmd *cmd1, const opt_cmd *cmd2){
+    assert(cmd1);
+    assert(cmd2);
+    assert(cmd1->manager == cmd2->manager);
+
+    const opt_cmd *cmds[2] = { cmd1, cmd2 };
+    size_t i, j, k, counts[2] = {0};
+    bool has_arg, found;
+
+    for (k = 0; k < 2; k++)
+        for (i = cmds[k]->verb + 1; i < cmds[k]->words_num; i++)
+            if ((i != cmds[k]->sub) && check_if_option(cmds[k], i, (pkg_managers + cmds[k]->manager), &has_arg)){
+                if (! check_if_yes_option(cmds[k]->words[i])){
+                    counts[k]++;
+
+                    for (found = false, j = cmds[! k]->verb + 1; j < cmds[! k]->words_num; j++)
+                        if (! strcmp(cmds[k]->words[i], cmds[! k]->words[j])){
+                            found = (! has_arg) || (cmds[! k]->words[j + 1] && (! strcmp(cmds[k]->words[i + 1], cmds[! k]->words[j + 1])));
+                            break;
+                        }
+                    if (! found)
+                        return false;
+                }
+                i += has_arg;
+            }
+
+    return (counts[0] == counts[1]);
+}
+
+
+/**
+ * @brief render the new layer that installs all the packages at once.
+ *
+ * @param[in]  ir  the list of instructions
+ * @param[in]  locs  the locations of the installations to be merged
+ * @param[in]  locs_num  the number of them
+ * @param[in]  update  the index update to be run first, or NULL
+ * @param[in]  extras  the commands that clean the package index or cache after the installation
+ * @param[in]  extras_num  the number of them
+ * @return char*  RUN instruction of the new layer, or NULL
+ *
+ * @note the packages are sorted alphabetically without duplicates.
+ */
+static char *render_install_layer(
+    const opt_ir *ir, const opt_loc *locs, size_t locs_num, const opt_cmd *update, const char * const *extras, size_t extras_num
+){
+    assert(ir);
+    assert(locs);
+    assert(locs_num);
+
+    const opt_cmd *model, *cmd;
+    const char **pkgs;
+    size_t pkgs_num = 0, pkgs_max = 0, size, i, j, k;
+    bool has_arg, has_yes = false, model_yes = false;
+    char *layer = NULL;
+    FILE *fp;
+
+    model = ir->instrs[locs->instr].cmds + locs->cmd;
+
+    for (k = 0; k < locs_num; k++)
+        pkgs_max += ir->instrs[locs[k].instr].cmds[locs[k].cmd].words_num;
+
+    if (! (pkgs = (const char **) malloc(sizeof(char *) * pkgs_max)))
+        return NULL;
+
+    for (k = 0; k < locs_num; k++){
+        cmd = ir->instrs[locs[k].instr].cmds + locs[k].cmd;
+
+        for (i = cmd->verb + 1; i < cmd->words_num; i++)
+            if (check_if_option(cmd, i, (pkg_managers + cmd->manager), &has_arg)){
+                if (check_if_yes_option(cmd->words[i])){
+                    has_yes = true;
+                    model_yes |= (cmd == model);
+                }
+                i += has_arg;
+            }
+            else if (i > cmd->sub)
+                pkgs[pkgs_num++] = cmd->words[i];
+    }
+
+    qsort(pkgs, pkgs_num, sizeof(char *), qstrcmp);
+
+    for (j = 0, i = 0; i < pkgs_num; i++)
+        if ((! j) || strcmp(pkgs[j - 1], pkgs[i]))
+            pkgs[j++] = pkgs[i];
+    pkgs_num = j;
+
+    if ((fp = open_memstream(&layer, &size))){
+        fputs("RUN ", fp);
+
+        if (update)
+            fprintf(fp, "%s \\\n    && ", update->text);
+
+        for (i = 0; i <= model->sub; i++)
+            fprintf(fp, (i ? " %s" : "%s"), model->words[i]);
+
+        if (has_yes && (! model_yes))
+            fputs(" -y", fp);
+
+        for (i = model->sub + 1; i < model->words_num; i++)
+            if (check_if_option(model, i, (pkg_managers + model->manager), &has_arg)){
+                fprintf(fp, " %s", model->words[i]);
+                if (has_arg)
+                    fprintf(fp, " %s", model->words[++i]);
+            }
+
+        for (i = 0; i < pkgs_num; i++)
+            fprintf(fp, ((pkgs_num > OPT_INLINE_PACKAGES_MAX) ? " \\\n        %s" : " %s"), pkgs[i]);
+
+        for (i = 0; i < extras_num; i++)
+            fprintf(fp, " \\\n    && %s", extras[i]);
+
+        fputc('\n', fp);
+
+        if (fclose(fp)){
+            free(layer);
+            layer = NULL;
+        }
+    }
+
+    free(pkgs);
+    return layer;
+}
+
+
+/**
+ * @brief update the state of the instruction some of whose commands have been removed.
+ *
+ * @param[out] instr  RUN instruction
+ *
+ * @note the instruction is removed if only trivial commands such as 'set -eux' remain.
+ */
+static void update_removed_instr(opt_instr *instr){
+    assert(instr);
+
+    size_t i;
+
+    instr->modified = true;
+    instr->removed = true;
+
+    for (i = 0; i < instr->cmds_num; i++)
+        if ((! instr->cmds[i].removed) && (instr->cmds[i].kind != OPT_CMD_TRIVIAL)){
+            instr->removed = false;
+            break;
+        }
+}
+
+
+
+
+/******************************************************************************
+    * Slim Pass
+******************************************************************************/
+
+
+/**
+ * @brief find the removable files each instruction created, and propose or inject their cleanup.
+ *
+ * @param[out] ir  the list of instructions
+ * @param[in]  inject  whether to append the cleanup to the instructions that created the files
+ *
+ * @note a file is attributed to the instruction whose command line ran when its status was last changed.
+ * @note static libraries are only proposed to be removed, since a later build may link them.
+ */
+static void slim_layers(opt_ir *ir, bool inject){
+    assert(ir);
+
+    slim_scan scan = {0};
+    opt_entry *entries = NULL;
+    struct timespec strip_ctime = {0}, end;
+    struct stat file_stat;
+    char *src, *keep = NULL, *cleanup, path[PATH_MAX];
+    const char *reason, *lang;
+    size_t entries_num = 0, i, j, len;
+    off_t attributed[SLIM_CATEGORIES_NUM] = {0};
+    bool strip_found = false;
+    opt_instr *instr;
+    slim_attr *attr;
+    int c, sep;
+
+    if ((src = read_whole_file(REFLECT_LOG_FILE, NULL)))
+        entries_num = load_reflect_log(ir, src, &entries);
+
+    for (i = 0; i < entries_num; i++)
+        if (entries[i].instr != SIZE_MAX)
+            break;
+
+    if (i == entries_num){
+        fputs("slim: no instruction is found in the reflect log, so no file can be attributed to them\n", ir->report);
+        goto exit;
+    }
+
+    if (! (scan.attrs = (slim_attr *) calloc(ir->instrs_num, sizeof(slim_attr))))
+        goto exit;
+
+    if ((((lang = getenv("LC_ALL")) && *lang) || ((lang = getenv("LANG")) && *lang)) && islower((unsigned char) *lang))
+        if (strncmp(lang, "en", 2) && (keep = strndup(lang, strcspn(lang, "_.@"))))
+            scan.keep = keep;
+
+    scan.entries = entries;
+    scan.entries_num = entries_num;
+
+    for (i = 0; i < numof(slim_roots); i++)
+        if ((! lstat(slim_roots[i].path, &file_stat)) && S_ISDIR(file_stat.st_mode)){
+            scan.category = slim_roots[i].category;
+            scan.root = 1U << i;
+            len = strlen(slim_roots[i].path);
+            memcpy(path, slim_roots[i].path, (len + 1));
+            scan_slim_files(&scan, AT_FDCWD, slim_roots[i].path, path, len, 0);
+        }
+
+    for (i = 0; i < numof(strip_paths); i++)
+        if (! stat(strip_paths[i], &file_stat)){
+            strip_ctime = file_stat.st_ctim;
+            strip_found = true;
+            break;
+        }
+
+    for (i = 0; i < ir->instrs_num; i++){
+        instr = ir->instrs + i;
+        attr = scan.attrs + i;
+
+        for (end.tv_sec = 0, end.tv_nsec = 0, j = 0; j < entries_num; j++)
+            if ((entries[j].instr == i) && (compare_timespec(entries[j].end, end) > 0))
+                end = entries[j].end;
+
+        for (sep = '&', j = 1; j < instr->cmds_num; j++)
+            if (instr->cmds[j].sep == ';')
+                sep = ';';
+
+        for (c = 0; c < SLIM_CATEGORIES_NUM; c++){
+            if (attr->bytes[c] <= 0)
+                continue;
+            if (! (cleanup = render_slim_cleanup(attr, c, scan.keep)))
+                goto exit;
+
+            attributed[c] += attr->bytes[c];
+            reason = NULL;
+
+            if ((instr->id != ID_RUN) || (! instr->cmds_num))
+                reason = "it is not RUN in shell form";
+            else if (instr->modified && instr->removed)
+                reason = "it is removed by another pass";
+            else if (c == SLIM_STATIC_LIBS)
+                reason = "a later build may link them";
+            else if ((c == SLIM_DEBUG_SYMBOLS) && ((! strip_found) || (compare_timespec(strip_ctime, end) > 0)))
+                reason = "'strip' is not installed at that point";
+            else
+                for (j = 0; j < instr->cmds_num; j++)
+                    if (instr->cmds[j].removed){
+                        reason = "some of its commands are moved by another pass";
+                        break;
+                    }
+
+            if (inject && (! reason)){
+                if (! append_cmd(instr, cleanup, (cleanup + strlen(cleanup)), sep)){
+                    free(cleanup);
+                    goto exit;
+                }
+                instr->modified = true;
+                fprintf(ir->report, "slim: line %zu: appended ", instr->line);
+            }
+            else {
+                fprintf(ir->report, "slim: line %zu: ", instr->line);
+                print_saving(ir->report, attr->bytes[c]);
+                fprintf(ir->report, " of %s could be removed by appending ", slim_descs[c]);
+            }
+
+            if (slim_list_cmds[c])
+                fprintf(ir->report, "'%s' on %zu file%s", slim_list_cmds[c], attr->paths_num[c], ((attr->paths_num[c] > 1) ? "s" : ""));
+            else
+                fprintf(ir->report, "'%s'", cleanup);
+
+            if (inject && (! reason)){
+                fputs(", removing ", ir->report);
+                print_saving(ir->report, attr->bytes[c]);
+                fprintf(ir->report, " of %s\n", slim_descs[c]);
+            }
+            else if (inject)
+                fprintf(ir->report, ", but left as it is, since %s\n", reason);
+            else
+                fputc('\n', ir->report);
+
+            free(cleanup);
+        }
+    }
+
+    for (c = 0; c < SLIM_CATEGORIES_NUM; c++)
+        if (scan.totals[c] > 0){
+            fputs("slim: ", ir->report);
+            print_saving(ir->report, scan.totals[c]);
+            fprintf(ir->report, " of %s in this container, ", slim_descs[c]);
+            print_saving(ir->report, attributed[c]);
+            fputs(" of which is attributed to this Dockerfile\n", ir->report);
+        }
+
+exit:
+    if (scan.attrs){
+        for (i = 0; i < ir->instrs_num; i++)
+            for (c = 0; c < SLIM_CATEGORIES_NUM; c++){
+                for (j = 0; j < scan.attrs[i].paths_num[c]; j++)
+                    free(scan.attrs[i].paths[c][j]);
+                free(scan.attrs[i].paths[c]);
+            }
+        free(scan.attrs);
+    }
+    free(keep);
+    free(entries);
+    free(src);
+}
+
+
+/**
+ * @brief load the reflect log, and find the instruction made of each line in it.
+ *
+ * @param[in]  ir  the list of instructions
+ * @param[out] src  the contents of the reflect log
+ * @param[out] p_entries  variable to store the array of the lines sorted by when their command lines started
+ * @return size_t  the number of the lines
+ *
+ * @note the n-th line of the same contents is regarded as making the n-th instruction of them, if any.
+ * @note the lines point to the contents of the reflect log, which are split into lines in place.
+ * @attention if the return value is non-zero, the array should be released by the caller.
+ */
+static size_t load_reflect_log(const opt_ir *ir, char *src, opt_entry **p_entries){
+    assert(ir);
+    assert(src);
+    assert(p_entries);
+
+    opt_entry *entries = NULL, *entry;
+    size_t entries_num = 0, entries_max = 0, nth, i, len;
+    long long start_sec, end_sec;
+    char *line, *next;
+    int offset;
+    void *ptr;
+
+    for (line = src; *line; line = next){
+        if ((next = strchr(line, '\n')))
+            *(next++) = '\0';
+        else
+            next = line + strlen(line);
+
+        offset = 0;
+
+        if (entries_num == entries_max){
+            entries_max = entries_max ? (((entries_max + 1) << 1) - 1) : OPT_INITIAL_INSTRS_MAX;
+
+            if (! (ptr = realloc(entries, (sizeof(opt_entry) * entries_max)))){
+                free(entries);
+                return 0;
+            }
+            entries = (opt_entry *) ptr;
+        }
+
+        entry = entries + entries_num;
+
+        if ((sscanf(line, "%lld.%ld %lld.%ld %n", &start_sec, &(entry->start.tv_nsec), &end_sec, &(entry->end.tv_nsec), &offset) < 4) ||
+            (! offset))
+            continue;
+
+        entry->start.tv_sec = start_sec;
+        entry->end.tv_sec = end_sec;
+        entry->line = line + offset;
+        entry->instr = SIZE_MAX;
+        entries_num++;
+    }
+
+    for (i = 0; i < entries_num; i++){
+        entry = entries + i;
+        len = strlen(entry->line);
+
+        for (nth = 0, offset = 0; offset < ((int) i); offset++)
+            nth += (! strcmp(entries[offset].line, entry->line));
+
+        for (size_t j = 0; j < ir->instrs_num; j++){
+            const char *text = ir->instrs[j].text;
+
+            if (strncmp(text, entry->line, len) || (text[len] && strcmp((text + len), "\n")))
+                continue;
+
+            entry->instr = j;
+            if (! nth--)
+                break;
+        }
+    }
+
+    if (entries_num)
+        qsort(entries, entries_num, sizeof(opt_entry), qcmp_entry);
+    else {
+        free(entries);
+        entries = NULL;
+    }
+
+    *p_entries = entries;
+    return entries_num;
+}
+
+
+/**
+ * @brief scan the specified file and all files below it for the removable files.
+ *
+ * @param[out] scan  the state of the scan
+ * @param[in]  pwdfd  file descriptor that serves as the current working directory
+ * @param[in]  name  name of the file we are currently looking at
+ * @param[out] path  buffer of length 'PATH_MAX' storing the path of the file
+ * @param[in]  len  the length of the path
+ * @param[in]  depth  the depth of the file from the directory being scanned
+ *
+ * @note symbolic links are not followed, so that each file is counted only once.
+ */
+static void scan_slim_files(slim_scan *scan, int pwdfd, const char *name, char *path, size_t len, size_t depth){
+    assert(scan);
+    assert((pwdfd >= 0) || (pwdfd == AT_FDCWD));
+    assert(name);
+    assert(path);
+
+    struct stat file_stat;
+    struct dirent *entry;
+    size_t name_len;
+    off_t bytes;
+    DIR *dir;
+    int fd, category;
+
+    if (fstatat(pwdfd, name, &file_stat, AT_SYMLINK_NOFOLLOW))
+        return;
+
+    if (S_ISDIR(file_stat.st_mode)){
+        if ((scan->category == SLIM_LOCALES) && (depth == 1) && check_if_kept_locale(name, scan->keep))
+            return;
+        if ((fd = openat(pwdfd, name, (O_RDONLY | O_DIRECTORY))) == -1)
+            return;
+        if (! (dir = fdopendir(fd))){
+            close(fd);
+            return;
+        }
+
+        while ((entry = readdir(dir)))
+            if (check_if_valid_dirent(entry->d_name) && ((len + (name_len = strlen(entry->d_name)) + 2) <= PATH_MAX)){
+                path[len] = '/';
+                memcpy((path + len + 1), entry->d_name, (name_len + 1));
+                scan_slim_files(scan, fd, entry->d_name, path, (len + name_len + 1), (depth + 1));
+                path[len] = '\0';
+            }
+
+        closedir(dir);
+        return;
+    }
+
+    if (! S_ISREG(file_stat.st_mode))
+        return;
+
+    bytes = file_stat.st_size;
+    category = scan->category;
+
+    if (category == SLIM_LOCALES){
+        if (depth < 2)
+            return;
+    }
+    else if (category == SLIM_DEBUG_SYMBOLS){
+        name_len = strlen(name);
+
+        if ((name_len > 2) && (! strcmp((name + name_len - 2), ".a")))
+            category = SLIM_STATIC_LIBS;
+        else {
+            if ((! (file_stat.st_mode & (S_IXUSR | S_IXGRP | S_IXOTH))) && (! strstr(name, ".so")))
+                return;
+            if ((fd = openat(pwdfd, name, (O_RDONLY | O_NOCTTY | O_NONBLOCK))) == -1)
+                return;
+            bytes = count_debug_bytes(fd);
+            close(fd);
+        }
+    }
+
+    if (bytes > 0)
+        attribute_slim_file(scan, path, &file_stat, category, bytes);
+}
+
+
+/**
+ * @brief attribute the removable file to the instruction whose command line changed its status last.
+ *
+ * @param[out] scan  the state of the scan
+ * @param[in]  path  path of the file
+ * @param[in]  file_stat  the status of the file
+ * @param[in]  category  the category of the file
+ * @param[in]  bytes  the bytes saved by removing the file
+ */
+static void attribute_slim_file(slim_scan *scan, const char *path, const struct stat *file_stat, int category, off_t bytes){
+    assert(scan);
+    assert(path);
+    assert(file_stat);
+    assert((category >= 0) && (category < SLIM_CATEGORIES_NUM));
+
+    size_t i;
+    slim_attr *attr;
+    void *ptr;
+
+    scan->totals[category] += bytes;
+
+    if ((i = find_entry_instr(scan->entries, scan->entries_num, file_stat->st_ctim)) == SIZE_MAX)
+        return;
+
+    attr = scan->attrs + i;
+    attr->bytes[category] += bytes;
+    attr->roots |= scan->root;
+
+    if (slim_list_cmds[category]){
+        if (attr->paths_num[category] == attr->paths_max[category]){
+            size_t curr_max;
+
+            curr_max = attr->paths_max[category] ? (((attr->paths_max[category] + 1) << 1) - 1) : OPT_INITIAL_WORDS_MAX;
+
+            if (! (ptr = realloc(attr->paths[category], (sizeof(char *) * curr_max))))
+                return;
+
+            attr->paths[category] = (char **) ptr;
+            attr->paths_max[category] = curr_max;
+        }
+
+        if ((attr->paths[category][attr->paths_num[category]] = strdup(path)))
+            attr->paths_num[category]++;
+    }
+}
+
+
+/**
+ * @brief check if the locales of the specified language are kept.
+ *
+ * @param[in]  name  name of the directory storing the locales of a language
+ * @param[in]  keep  the language kept besides English, or NULL
+ * @return bool  the resulting boolean
+ */
+static bool check_if_kept_locale(const char *name, const char *keep){
+    assert(name);
+
+    return (! strncmp(name, "en", 2)) || (keep && (! strncmp(name, keep, strlen(keep))));
+}
+
+
+/**
+ * @brief count the bytes of the sections that are removed by stripping the ELF file.
+ *
+ * @param[in]  fd  file descriptor of the file
+ * @return off_t  the resulting bytes, or 0 if the file is not an executable or shared object of this machine
+ *
+ * @note the symbol table and the debugging information are counted with their headers, as 'strip --strip-unneeded' removes them.
+ */
+static off_t count_debug_bytes(int fd){
+    assert(fd >= 0);
+
+    const uint16_t endian = 1;
+    union {
+        Elf32_Ehdr h32;
+        Elf64_Ehdr h64;
+    } ehdr;
+    unsigned char *shdrs = NULL;
+    char *names = NULL;
+    size_t shnum, shentsize, shstrndx, name, names_size, i;
+    off_t shoff, names_offset, bytes = 0;
+    uint32_t type;
+    uint64_t size;
+    bool is64;
+
+    if (pread(fd, &ehdr, sizeof(ehdr), 0) < ((ssize_t) sizeof(Elf32_Ehdr)))
+        return 0;
+    if (memcmp(ehdr.h32.e_ident, ELFMAG, SELFMAG))
+        return 0;
+    if (ehdr.h32.e_ident[EI_DATA] != ((*((const unsigned char *) &endian)) ? ELFDATA2LSB : ELFDATA2MSB))
+        return 0;
+
+    if ((is64 = (ehdr.h32.e_ident[EI_CLASS] == ELFCLASS64))){
+        if ((ehdr.h64.e_type != ET_EXEC) && (ehdr.h64.e_type != ET_DYN))
+            return 0;
+        shoff = ehdr.h64.e_shoff;
+        shnum = ehdr.h64.e_shnum;
+        shentsize = ehdr.h64.e_shentsize;
+        shstrndx = ehdr.h64.e_shstrndx;
+    }
+    else if (ehdr.h32.e_ident[EI_CLASS] == ELFCLASS32){
+        if ((ehdr.h32.e_type != ET_EXEC) && (ehdr.h32.e_type != ET_DYN))
+            return 0;
+        shoff = ehdr.h32.e_shoff;
+        shnum = ehdr.h32.e_shnum;
+        shentsize = ehdr.h32.e_shentsize;
+        shstrndx = ehdr.h32.e_shstrndx;
+    }
+    else
+        return 0;
+
+    if ((! shnum) || (shnum > SLIM_SECTIONS_MAX) || (shstrndx >= shnum))
+        return 0;
+    if (shentsize != (is64 ? sizeof(Elf64_Shdr) : sizeof(Elf32_Shdr)))
+        return 0;
+
+    if (! (shdrs = (unsigned char *) malloc(shnum * shentsize)))
+        return 0;
+    if (pread(fd, shdrs, (shnum * shentsize), shoff) != ((ssize_t) (shnum * shentsize)))
+        goto exit;
+
+    if (is64){
+        names_offset = ((Elf64_Shdr *) shdrs)[shstrndx].sh_offset;
+        names_size = ((Elf64_Shdr *) shdrs)[shstrndx].sh_size;
+    }
+    else {
+        names_offset = ((Elf32_Shdr *) shdrs)[shstrndx].sh_offset;
+        names_size = ((Elf32_Shdr *) shdrs)[shstrndx].sh_size;
+    }
+
+    if ((! names_size) || (names_size > SLIM_NAMES_MAX) || (! (names = (char *) malloc(names_size + 1))))
+        goto exit;
+    if (pread(fd, names, names_size, names_offset) != ((ssize_t) names_size))
+        goto exit;
+    names[names_size] = '\0';
+
+    for (i = 0; i < shnum; i++){
+        if (is64){
+            name = ((Elf64_Shdr *) shdrs)[i].sh_name;
+            type = ((Elf64_Shdr *) shdrs)[i].sh_type;
+            size = ((Elf64_Shdr *) shdrs)[i].sh_size;
+        }
+        else {
+            name = ((Elf32_Shdr *) shdrs)[i].sh_name;
+            type = ((Elf32_Shdr *) shdrs)[i].sh_type;
+            size = ((Elf32_Shdr *) shdrs)[i].sh_size;
+        }
+
+        if ((name >= names_size) || (type == SHT_NOBITS))
+            continue;
+
+        if ((! strcmp((names + name), ".symtab")) || (! strcmp((names + name), ".strtab")) ||
+            (! strncmp((names + name), ".debug", 6)) || (! strncmp((names + name), ".zdebug", 7)))
+            bytes += size + shentsize;
+    }
+
+exit:
+    free(names);
+    free(shdrs);
+    return bytes;
+}
+
+
+/**
+ * @brief render the command that removes the files of the specified category attributed to an instruction.
+ *
+ * @param[in]  attr  the removable files attributed to the instruction
+ * @param[in]  category  the category
+ * @param[in]  keep  the language whose locales are kept besides English, or NULL
+ * @return char*  the resulting command, or NULL on failure
+ *
+ * @note the documentation and locales are removed by directory, which never enlarges the layer.
+ * @attention if the return value is non-NULL, it should be released by the caller.
+ */
+static char *render_slim_cleanup(const slim_attr *attr, int category, const char *keep){
+    assert(attr);
+    assert((category >= 0) && (category < SLIM_CATEGORIES_NUM));
+
+    char *cleanup = NULL;
+    size_t size, i;
+    FILE *fp;
+
+    if (! (fp = open_memstream(&cleanup, &size)))
+        return NULL;
+
+    if (slim_list_cmds[category]){
+        fputs(slim_list_cmds[category], fp);
+
+        for (i = 0; i < attr->paths_num[category]; i++){
+            fputc(' ', fp);
+            print_quoted_path(fp, attr->paths[category][i]);
+        }
+    }
+    else {
+        fputs(((category == SLIM_DOCS) ? "rm -rf" : "find"), fp);
+
+        for (i = 0; i < numof(slim_roots); i++)
+            if ((slim_roots[i].category == category) && (attr->roots & (1U << i)))
+                fprintf(fp, ((category == SLIM_DOCS) ? " %s/*" : " %s"), slim_roots[i].path);
+
+        if (category == SLIM_LOCALES){
+            fputs(" -mindepth 1 -maxdepth 1 -type d ! -name 'en*'", fp);
+            if (keep)
+                fprintf(fp, " ! -name '%s*'", keep);
+            fputs(" -exec rm -rf {} +", fp);
+        }
+    }
+
+    if (fclose(fp)){
+        free(cleanup);
+        cleanup = NULL;
+    }
+
+    return cleanup;
+}
+
+
+/**
+ * @brief print the path quoted for the shell if necessary.
+ *
+ * @param[out] fp  the destination stream
+ * @param[in]  path  the path
+ */
+static void print_quoted_path(FILE *fp, const char *path){
+    assert(fp);
+    assert(path);
+
+    const char *tmp;
+
+    for (tmp = path; *tmp; tmp++)
+        if (! (isalnum((unsigned char) *tmp) || strchr("+,-./:=@_", *tmp)))
+            break;
+
+    if (! *tmp){
+        fputs(path, fp);
+        return;
+    }
+
+    fputc('\'', fp);
+    for (tmp = path; *tmp; tmp++)
+        if (*tmp == '\'')
+            fputs("'\\''", fp);
+        else
+            fputc(*tmp, fp);
+    fputc('\'', fp);
+}
+
+
+
+
+/******************************************************************************
+    * Link Pass
+******************************************************************************/
+
+
+/**
+ * @brief give '--link' to each COPY instruction in the final stage that does not depend on the earlier layers.
+ *
+ * @param[out] ir  the list of instructions
+ *
+ * @note the layer of COPY with '--link' is reused even if the layers below it change, such as on a new base image.
+ * @note since it is laid over them as it is, COPY is left if its result would differ from copying into them.
+ */
+static void link_copies(opt_ir *ir){
+    assert(ir);
+
+    char cwd[PATH_MAX] = "", dest[PATH_MAX], path[PATH_MAX], *text;
+    const char *reason, *owner, *args;
+    opt_instr *instr;
+    size_t start, linked = 0, i, len;
+
+    for (start = ir->instrs_num; start--;)
+        if (ir->instrs[start].id == ID_FROM)
+            break;
+
+    for (i = 0; i < ir->instrs_num; i++){
+        instr = ir->instrs + i;
+
+        if (instr->removed)
+            continue;
+
+        if (instr->id == ID_FROM)
+            *cwd = '\0';
+        else if (instr->id == ID_WORKDIR){
+            for (args = instr->args; isspace((unsigned char) *args); args++);
+            if (! (((*args == '/') || *cwd) && resolve_mentioned_path(args, cwd, cwd)))
+                *cwd = '\0';
+        }
+
+        if (instr->id != ID_COPY)
+            continue;
+
+        *path = '\0';
+        owner = NULL;
+
+        if ((start == SIZE_MAX) || (i < start))
+            reason = "it is not in the final stage, whose files this container has";
+        else if (! (reason = parse_copy_args(instr->args, cwd, dest, &owner))){
+            if (owner && (len = find_user_creation(ir, start, i, owner))){
+                fprintf(ir->report, "link: line %zu: left as it is, since its owner '%.*s' may be created by line %zu\n",
+                    instr->line, ((int) strcspn(owner, " \t")), owner, len);
+                continue;
+            }
+            reason = check_link_destination(dest, path);
+        }
+
+        if (reason){
+            fprintf(ir->report, "link: line %zu: left as it is, since %s", instr->line, reason);
+            if (*path)
+                fprintf(ir->report, " '%s'", path);
+            fputc('\n', ir->report);
+            continue;
+        }
+
+        for (args = instr->text; isspace((unsigned char) *args); args++);
+        len = (args - instr->text) + strcspn(args, " \t\r\n\\");
+
+        if (! (text = (char *) malloc(strlen(instr->text) + 8)))
+            return;
+        sprintf(text, "%.*s --link%s", ((int) len), instr->text, (instr->text + len));
+
+        free(instr->text);
+        instr->text = text;
+        linked++;
+
+        fprintf(ir->report, "link: line %zu: added '--link', copying into '%s'\n", instr->line, dest);
+    }
+
+    if (linked && (! check_if_syntax_given(ir->instrs->lead))){
+        len = ir->instrs->before ? strlen(ir->instrs->before) : 0;
+
+        if (! (text = (char *) malloc(len + 31)))
+            return;
+        sprintf(text, "# syntax=docker/dockerfile:1\n%s", (len ? ir->instrs->before : ""));
+
+        free(ir->instrs->before);
+        ir->instrs->before = text;
+
+        fputs("link: inserted '# syntax=docker/dockerfile:1' at the top, since '--link' needs the syntax 1.4 or later\n",
+            ir->report);
+    }
+}
+
+
+/**
+ * @brief parse the arguments of COPY instruction, and resolve its destination.
+ *
+ * @param[in]  args  the arguments, where continuations are joined
+ * @param[in]  cwd  the working directory, or an empty string if it is unknown
+ * @param[out] dest  buffer of length 'PATH_MAX' for storing the destination
+ * @param[out] p_owner  variable to store the value of '--chown' terminated by a space, or NULL
+ * @return const char*  why the destination cannot be resolved, or NULL
+ *
+ * @note both the shell form and the JSON form are accepted, but neither here-documents nor variables.
+ */
+static const char *parse_copy_args(const char *args, const char *cwd, char *dest, const char **p_owner){
+    assert(args);
+    assert(cwd);
+    assert(dest);
+    assert(p_owner);
+
+    char buf[PATH_MAX];
+    const char *word, *last = NULL;
+    size_t len, words_num = 0;
+    yyjson_doc *idoc;
+    yyjson_val *ival;
+
+    *p_owner = NULL;
+
+    for (word = args; (*(word += strspn(word, " \t")) == '-') && (word[1] == '-'); word += len){
+        len = strcspn(word, " \t");
+
+        if (((len == 6) || (word[6] == '=')) && (! strncmp(word, "--link", 6)))
+            return "it already has '--link'";
+        if (! strncmp(word, "--chown=", 8))
+            *p_owner = word + 8;
+    }
+
+    if (*word == '['){
+        if (! (idoc = yyjson_read_opts(((char *) word), strlen(word), 0, &trace_alc, NULL)))
+            return "its arguments cannot be parsed";
+
+        if (yyjson_is_arr(yyjson_doc_get_root(idoc)) && (yyjson_arr_size(yyjson_doc_get_root(idoc)) > 1))
+            if ((ival = yyjson_arr_get_last(yyjson_doc_get_root(idoc))) && yyjson_is_str(ival))
+                if ((len = yyjson_get_len(ival)) < PATH_MAX){
+                    memcpy(buf, yyjson_get_str(ival), (len + 1));
+                    words_num = 2;
+                }
+
+        yyjson_doc_free(idoc);
+    }
+    else {
+        if (strstr(word, "<<"))
+            return "it copies here-documents";
+
+        for (; *word; word += len, word += strspn(word, " \t")){
+            len = strcspn(word, " \t");
+            last = word;
+            words_num++;
+        }
+
+        if (last && ((len = strcspn(last, " \t")) < PATH_MAX)){
+            memcpy(buf, last, len);
+            buf[len] = '\0';
+        }
+        else
+            words_num = 0;
+    }
+
+    if (words_num < 2)
+        return "its arguments cannot be parsed";
+
+    if (strpbrk(buf, "$`"))
+        return "its destination refers to a variable";
+    if ((*buf != '/') && (! *cwd))
+        return "the working directory it copies into is unknown";
+
+    if ((buf[0] == '.') && (buf[1] == '/') && (! buf[2]))
+        buf[1] = '\0';
+
+    return resolve_mentioned_path(buf, cwd, dest) ? NULL : "its destination cannot be resolved";
+}
+
+
+/**
+ * @brief check if '--link' keeps the result of copying into the specified destination in this container.
+ *
+ * @param[in]  dest  the destination
+ * @param[out] path  buffer of length 'PATH_MAX' for storing the path in the way, if any
+ * @return const char*  why '--link' changes the result, which is followed by the path, or NULL
+ *
+ * @note the directories on the way are laid over as root-owned with mode 755, hiding what they were below.
+ */
+static const char *check_link_destination(const char *dest, char *path){
+    assert(dest);
+    assert(path);
+
+    struct stat file_stat;
+    char *next;
+
+    strcpy(path, dest);
+
+    for (next = path; next;){
+        if ((next = strchr((next + 1), '/')))
+            *next = '\0';
+
+        if (path[1]){
+            if (lstat(path, &file_stat)){
+                if (errno == ENOENT)
+                    break;
+                return "this container cannot tell what is at";
+            }
+
+            if (S_ISLNK(file_stat.st_mode))
+                return "'--link' would hide the symbolic link";
+
+            if (S_ISDIR(file_stat.st_mode)){
+                if (file_stat.st_uid || file_stat.st_gid)
+                    return "'--link' would reset the owner of";
+                if ((file_stat.st_mode & 07777) != 0755)
+                    return "'--link' would reset the mode of";
+            }
+        }
+
+        if (next)
+            *next = '/';
+    }
+
+    *path = '\0';
+    return NULL;
+}
+
+
+/**
+ * @brief find the last RUN instruction in the stage that may create the owner given to COPY instruction.
+ *
+ * @param[in]  ir  the list of instructions
+ * @param[in]  start  index of FROM instruction beginning the stage
+ * @param[in]  end  index of COPY instruction
+ * @param[in]  owner  the value of '--chown' terminated by a space
+ * @return size_t  line number of the instruction, or 0 if the owner is given by IDs or there are none
+ *
+ * @note the names given to '--chown' with '--link' are looked up before the earlier layers are applied.
+ */
+static size_t find_user_creation(const opt_ir *ir, size_t start, size_t end, const char *owner){
+    assert(ir);
+    assert(start < end);
+    assert(owner);
+
+    const opt_instr *instr;
+    const opt_cmd *cmd;
+    const char * const *p_name;
+    size_t len, i, j;
+
+    for (; *owner && (*owner != ' ') && (*owner != '\t'); owner += len){
+        owner += (*owner == ':');
+        len = strcspn(owner, ": \t");
+
+        if ((len != strspn(owner, "0123456789")) && ((len != 4) || strncmp(owner, "root", 4)))
+            break;
+    }
+
+    if ((! *owner) || (*owner == ' ') || (*owner == '\t'))
+        return 0;
+
+    for (i = end; --i > start;){
+        instr = ir->instrs + i;
+
+        if ((instr->id != ID_RUN) || instr->removed)
+            continue;
+
+        for (p_name = user_creation_cmds; *p_name; p_name++){
+            if (! instr->cmds_num){
+                if (strstr(instr->args, *p_name))
+                    return instr->line;
+            }
+            else
+                for (j = 0; j < instr->cmds_num; j++){
+                    cmd = instr->cmds + j;
+                    if ((! cmd->removed) && cmd->words_num && (! strcmp(basename_of(cmd->words[cmd->verb]), *p_name)))
+                        return instr->line;
+                }
+        }
+    }
+
+    return 0;
+}
+
+
+/**
+ * @brief check if the parser directives at the top of Dockerfile include the syntax directive.
+ *
+ * @param[in]  lead  the comments and empty lines preceding the first instruction
+ * @return bool  the resulting boolean
+ */
+static bool check_if_syntax_given(const char *lead){
+    assert(lead);
+
+    const char *line, *tmp;
+    size_t len;
+
+    for (line = lead; *line == '#'; line = tmp + 1){
+        for (tmp = line + 1; (*tmp == ' ') || (*tmp == '\t'); tmp++);
+        line = tmp;
+
+        for (len = 0; isalnum((unsigned char) line[len]); len++);
+        for (tmp = line + len; (*tmp == ' ') || (*tmp == '\t'); tmp++);
+
+        if ((! len) || (*tmp != '='))
+            break;
+        if ((len == 6) && (! strncasecmp(line, "syntax", 6)))
+            return true;
+        if (! (tmp = strchr(tmp, '\n')))
+            break;
+    }
+
+    return false;
+}
+
+
+
+
+/******************************************************************************
+    * Parallel Pass
+******************************************************************************/
+
+
+/**
+ * @brief split the independent chains of RUN instructions in the final stage into stages built in parallel.
+ *
+ * @param[out] ir  the list of instructions
+ *
+ * @note two instructions are dependent if the latter mentions the files or runs the executables the former left.
+ * @note only the first run of consecutive RUN instructions that has at least two movable chains is split.
+ */
+static void parallelize_stages(opt_ir *ir){
+    assert(ir);
+
+    par_scan scan = {0};
+    opt_entry *entries = NULL;
+    char *src, path[PATH_MAX] = "/";
+    struct stat file_stat;
+    size_t entries_num = 0, *parents = NULL, start, end, unlogged = 0, i, j;
+    double before = 0;
+    bool logged;
+
+    for (start = ir->instrs_num; start--;)
+        if (ir->instrs[start].id == ID_FROM)
+            break;
+
+    if (start == SIZE_MAX)
+        return;
+
+    if ((src = read_whole_file(REFLECT_LOG_FILE, NULL)))
+        entries_num = load_reflect_log(ir, src, &entries);
+
+    scan.entries = entries;
+    scan.entries_num = entries_num;
+    scan.start = start + 1;
+    scan.nodes_num = ir->instrs_num - scan.start;
+
+    if ((! scan.nodes_num) || (! (scan.nodes = (par_node *) calloc(scan.nodes_num, sizeof(par_node)))))
+        goto exit;
+    if (! (parents = (size_t *) malloc(sizeof(size_t) * scan.nodes_num)))
+        goto exit;
+
+    for (i = 0; i < entries_num; i++)
+        if ((entries[i].instr != SIZE_MAX) && (entries[i].instr >= scan.start)){
+            scan.nodes[entries[i].instr - scan.start].seconds +=
+                (entries[i].end.tv_sec - entries[i].start.tv_sec) + (entries[i].end.tv_nsec - entries[i].start.tv_nsec) / 1e9;
+            scan.nodes[entries[i].instr - scan.start].logged = true;
+        }
+
+    for (logged = false, i = 0; i < scan.nodes_num; i++){
+        before += scan.nodes[i].seconds;
+        logged |= scan.nodes[i].logged;
+
+        if ((ir->instrs[scan.start + i].id == ID_RUN) && (! ir->instrs[scan.start + i].removed))
+            unlogged += (! scan.nodes[i].logged);
+    }
+
+    if (! logged){
+        fputs("parallel: no instruction of the final stage is found in the reflect log\n", ir->report);
+        goto exit;
+    }
+
+    if (lstat(path, &file_stat))
+        goto exit;
+
+    scan.dev = file_stat.st_dev;
+    scan_parallel_files(&scan, AT_FDCWD, path, path, 1);
+
+    if (scan.failed)
+        goto exit;
+
+    for (i = scan.start; i < ir->instrs_num; i = end){
+        for (; (i < ir->instrs_num) && (! check_if_parallelizable(ir->instrs + i, scan.nodes + (i - scan.start))); i++);
+
+        for (end = i, j = 0; end < ir->instrs_num; end++)
+            if (! ir->instrs[end].removed){
+                if (! check_if_parallelizable(ir->instrs + end, scan.nodes + (end - scan.start)))
+                    break;
+                j++;
+            }
+
+        if ((j > 1) && split_parallel_block(ir, &scan, start, i, end, parents, before, unlogged))
+            goto exit;
+    }
+
+    fputs("parallel: no two independent chains of RUN instructions are found in the final stage\n", ir->report);
+
+exit:
+    if (scan.nodes){
+        for (i = 0; i < scan.nodes_num; i++){
+            for (j = 0; j < scan.nodes[i].roots_num; j++)
+                free(scan.nodes[i].roots[j]);
+            free(scan.nodes[i].roots);
+        }
+        free(scan.nodes);
+    }
+    free(parents);
+    free(entries);
+    free(src);
+}
+
+
+/**
+ * @brief split the independent chains in the specified run of RUN instructions into their own stages.
+ *
+ * @param[out] ir  the list of instructions
+ * @param[in]  scan  the state of the scan, where the files each instruction left are stored
+ * @param[in]  from  index of FROM instruction beginning the final stage
+ * @param[in]  start  index of the first instruction in the run
+ * @param[in]  end  index of the instruction following the run
+ * @param[out] parents  array for storing the chain each instruction in the final stage belongs to
+ * @param[in]  before  the estimated critical path of the final stage in seconds
+ * @param[in]  unlogged  the number of the instructions in the final stage that are not in the reflect log
+ * @return bool  whether the run is split
+ *
+ * @note a chain is not moved if it leaves no file, too many paths, or any file under '/etc' or '/var'.
+ */
+static bool split_parallel_block(
+    opt_ir *ir, const par_scan *scan, size_t from, size_t start, size_t end, size_t *parents, double before, size_t unlogged
+){
+    assert(ir);
+    assert(scan);
+    assert(parents);
+    assert(from < start);
+    assert(start < end);
+
+    char cwd[PATH_MAX] = "/", names[PARALLEL_STAGES_MAX + 1][PARALLEL_NAME_MAX], hint[PARALLEL_NAME_MAX], *stages = NULL, *text;
+    size_t chains[PARALLEL_STAGES_MAX], chains_num = 0, roots_num, i, j, k, size;
+    double slowest = 0, moved = 0, seconds;
+    const char *reason, *args;
+    const par_node *node;
+    opt_instr *instr;
+    bool first;
+    FILE *fp;
+
+    for (i = from + 1; i < start; i++){
+        if (ir->instrs[i].removed)
+            continue;
+        if (ir->instrs[i].id == ID_ONBUILD)
+            return false;
+
+        if (ir->instrs[i].id == ID_WORKDIR){
+            for (args = ir->instrs[i].args; isspace((unsigned char) *args); args++);
+            if (! resolve_mentioned_path(args, cwd, cwd))
+                return false;
+        }
+    }
+
+    for (i = start; i < end; i++)
+        parents[i - scan->start] = i - scan->start;
+
+    for (j = start; j < end; j++)
+        if (! ir->instrs[j].removed)
+            for (i = start; i < j; i++)
+                if ((! ir->instrs[i].removed) && check_if_dependent(ir->instrs + j, scan->nodes + (i - scan->start), cwd))
+                    parents[find_parallel_chain(parents, (j - scan->start))] = find_parallel_chain(parents, (i - scan->start));
+
+    for (i = start; i < end; i++){
+        if (ir->instrs[i].removed || (find_parallel_chain(parents, (i - scan->start)) != (i - scan->start)))
+            continue;
+
+        for (roots_num = 0, seconds = 0, reason = NULL, j = i; j < end; j++)
+            if ((! ir->instrs[j].removed) && (find_parallel_chain(parents, (j - scan->start)) == (i - scan->start))){
+                node = scan->nodes + (j - scan->start);
+                roots_num += node->roots_num;
+                seconds += node->seconds;
+
+                if (node->shared)
+                    reason = "it changes the files under '/etc', '/root' or '/var', which other stages may also change";
+            }
+
+        if (! reason){
+            if (! roots_num)
+                reason = "it leaves no file to be copied";
+            else if (roots_num > PARALLEL_COPIES_MAX)
+                reason = "it leaves too many paths to be copied";
+            else if (chains_num == PARALLEL_STAGES_MAX)
+                reason = "there are too many chains";
+        }
+
+        if (reason)
+            fprintf(ir->report, "parallel: line %zu is left in the final stage, since %s\n", ir->instrs[i].line, reason);
+        else {
+            chains[chains_num++] = i - scan->start;
+            moved += seconds;
+            if (seconds > slowest)
+                slowest = seconds;
+        }
+    }
+
+    if (chains_num < 2)
+        return false;
+
+    text = NULL;
+    if (! get_stage_alias(ir->instrs + from, names[0])){
+        make_stage_name(ir, "base", names, 0, names[0]);
+
+        instr = ir->instrs + from;
+        for (size = strlen(instr->text); size && isspace((unsigned char) instr->text[size - 1]); size--);
+
+        if (! (text = (char *) malloc(size + strlen(names[0]) + 6)))
+            return false;
+        sprintf(text, "%.*s AS %s\n", ((int) size), instr->text, names[0]);
+    }
+
+    for (k = 0; k < chains_num; k++){
+        get_chain_hint(ir, scan, parents, start, end, chains[k], hint);
+        make_stage_name(ir, hint, names, (k + 1), names[k + 1]);
+    }
+
+    if (! (fp = open_memstream(&stages, &size))){
+        free(text);
+        return false;
+    }
+
+    if (ir->instrs[start].before)
+        fputs(ir->instrs[start].before, fp);
+
+    for (k = 0; k < chains_num; k++){
+        fprintf(fp, "\nFROM %s AS %s\n", names[0], names[k + 1]);
+        write_stage_args(ir, from, start, fp);
+
+        for (i = start; i < end; i++)
+            if ((! ir->instrs[i].removed) && (find_parallel_chain(parents, (i - scan->start)) == chains[k])){
+                instr = ir->instrs + i;
+                fputs(instr->lead, fp);
+
+                if (instr->modified)
+                    write_run_instr(instr, fp);
+                else {
+                    fputs(instr->text, fp);
+                    if ((! (size = strlen(instr->text))) || (instr->text[size - 1] != '\n'))
+                        fputc('\n', fp);
+                }
+            }
+    }
+
+    fprintf(fp, "\nFROM %s\n", names[0]);
+    write_stage_args(ir, from, start, fp);
+
+    for (k = 0; k < chains_num; k++)
+        for (i = start; i < end; i++)
+            if ((! ir->instrs[i].removed) && (find_parallel_chain(parents, (i - scan->start)) == chains[k])){
+                node = scan->nodes + (i - scan->start);
+
+                for (j = 0; j < node->roots_num; j++){
+                    fprintf(fp, "COPY --from=%s ", names[k + 1]);
+                    print_copy_paths(fp, node->roots[j]);
+                }
+            }
+
+    if (fclose(fp)){
+        free(stages);
+        free(text);
+        return false;
+    }
+
+    if (text){
+        free(ir->instrs[from].text);
+        ir->instrs[from].text = text;
+    }
+
+    free(ir->instrs[start].before);
+    ir->instrs[start].before = stages;
+
+    for (k = 0; k < chains_num; k++){
+        fputs("parallel: line", ir->report);
+
+        for (first = true, roots_num = 0, i = start; i < end; i++)
+            if ((! ir->instrs[i].removed) && (find_parallel_chain(parents, (i - scan->start)) == chains[k])){
+                roots_num += scan->nodes[i - scan->start].roots_num;
+                fprintf(ir->report, (first ? " %zu" : ", %zu"), ir->instrs[i].line);
+                first = false;
+            }
+
+        fprintf(ir->report, " moved to stage '%s', copying %zu path%s into the final stage\n",
+            names[k + 1], roots_num, ((roots_num > 1) ? "s" : ""));
+    }
+
+    for (i = start; i < end; i++)
+        if (! ir->instrs[i].removed)
+            for (k = 0; k < chains_num; k++)
+                if (find_parallel_chain(parents, (i - scan->start)) == chains[k]){
+                    ir->instrs[i].removed = true;
+                    *(ir->instrs[i].lead) = '\0';
+                    break;
+                }
+
+    fputs("parallel: the critical path of the final stage is estimated at ", ir->report);
+    fprintf(ir->report, "%.1f s before and %.1f s after", before, (before - moved + slowest));
+    if (unlogged)
+        fprintf(ir->report, ", without %zu instruction%s not in the reflect log", unlogged, ((unlogged > 1) ? "s" : ""));
+    fputc('\n', ir->report);
+
+    return true;
+}
+
+
+/**
+ * @brief check if the instruction can be moved to another stage as a part of a chain.
+ *
+ * @param[in]  instr  the instruction
+ * @param[in]  node  the files the instruction left
+ * @return bool  the resulting boolean
+ *
+ * @note the instructions changing the installed packages are left, since the database of packages cannot be merged.
+ */
+static bool check_if_parallelizable(const opt_instr *instr, const par_node *node){
+    assert(instr);
+    assert(node);
+
+    size_t i;
+
+    if ((instr->id != ID_RUN) || instr->removed || instr->flags || (! instr->cmds_num) || (! node->logged))
+        return false;
+
+    for (i = 0; i < instr->cmds_num; i++)
+        if ((! instr->cmds[i].removed) && (instr->cmds[i].kind >= OPT_CMD_INSTALL))
+            return false;
+
+    return true;
+}
+
+
+/**
+ * @brief check if the instruction depends on the files an earlier instruction left.
+ *
+ * @param[in]  instr  the later instruction
+ * @param[in]  node  the files the earlier instruction left
+ * @param[in]  cwd  the working directory where the later instruction starts
+ * @return bool  the resulting boolean
+ *
+ * @note the libraries and headers are regarded as used by any later instruction, since builds find them implicitly.
+ */
+static bool check_if_dependent(const opt_instr *instr, const par_node *node, const char *cwd){
+    assert(instr);
+    assert(node);
+    assert(cwd);
+
+    char dir[PATH_MAX], path[PATH_MAX];
+    const opt_cmd *cmd;
+    size_t i, j, k, len;
+
+    if (node->provides)
+        return true;
+
+    strcpy(dir, cwd);
+
+    for (i = 0; i < instr->cmds_num; i++){
+        cmd = instr->cmds + i;
+        if (cmd->removed || (cmd->verb >= cmd->words_num))
+            continue;
+
+        for (j = 0; j < node->roots_num; j++)
+            if (strstr(node->roots[j], "bin/") && (! strcmp(basename_of(node->roots[j]), cmd->words[cmd->verb])))
+                return true;
+
+        for (j = 0; j < cmd->words_num; j++)
+            if (resolve_mentioned_path(cmd->words[j], dir, path))
+                for (k = 0; k < node->roots_num; k++){
+                    len = strlen(node->roots[k]);
+                    if ((! strncmp(path, node->roots[k], len)) && ((! path[len]) || (path[len] == '/')))
+                        return true;
+                }
+
+        if ((! strcmp(cmd->words[cmd->verb], "cd")) && ((cmd->verb + 1) < cmd->words_num))
+            resolve_mentioned_path(cmd->words[cmd->verb + 1], dir, dir);
+    }
+
+    return false;
+}
+
+
+/**
+ * @brief find the chain the instruction belongs to, compressing the path to it.
+ *
+ * @param[out] parents  array of the instruction each instruction is chained to
+ * @param[in]  i  index of the instruction in the final stage
+ * @return size_t  index of the instruction representing the chain
+ */
+static size_t find_parallel_chain(size_t *parents, size_t i){
+    assert(parents);
+
+    size_t root, next;
+
+    for (root = i; parents[root] != root; root = parents[root]);
+
+    for (; i != root; i = next){
+        next = parents[i];
+        parents[i] = root;
+    }
+
+    return root;
+}
+
+
+/**
+ * @brief resolve the path the word mentions, from the specified working directory.
+ *
+ * @param[in]  word  the word, which may be quoted or be the value of an option such as '--prefix=/usr'
+ * @param[in]  cwd  the working directory
+ * @param[out] path  buffer of length 'PATH_MAX' for storing the resulting path, which may be the same as 'cwd'
+ * @return bool  whether the word mentions a path that can be resolved
+ *
+ * @note the path is cut just before any wildcard, and the words referring to variables are never resolved.
+ */
+static bool resolve_mentioned_path(const char *word, const char *cwd, char *path){
+    assert(word);
+    assert(cwd);
+    assert(path);
+
+    char buf[PATH_MAX];
+    const char *tmp;
+    size_t len;
+    int n;
+
+    if (strpbrk(word, "$`"))
+        return false;
+
+    if ((tmp = strchr(word, '=')) && (tmp[1] == '/'))
+        word = tmp + 1;
+    else if ((*word == '-') || tmp)
+        return false;
+
+    if ((*word == '\'') || (*word == '"'))
+        word++;
+    while ((word[0] == '.') && (word[1] == '/'))
+        word += 2;
+
+    if (! (len = strcspn(word, "'\"*?[")))
+        return false;
+
+    if (*word == '/')
+        n = snprintf(buf, PATH_MAX, "%.*s", ((int) len), word);
+    else
+        n = snprintf(buf, PATH_MAX, (strcmp(cwd, "/") ? "%s/%.*s" : "%s%.*s"), cwd, ((int) len), word);
+
+    if ((n < 0) || (n >= PATH_MAX))
+        return false;
+
+    while ((n > 1) && ((buf[n - 1] == '/') || ((buf[n - 1] == '.') && (buf[n - 2] == '/'))))
+        buf[--n] = '\0';
+
+    memcpy(path, buf, (n + 1));
+    return true;
+}
+
+
+/**
+ * @brief scan the specified file and all files below it for the paths each instruction left by itself.
+ *
+ * @param[out] scan  the state of the scan
+ * @param[in]  pwdfd  file descriptor that serves as the current working directory
+ * @param[in]  name  name of the file we are currently looking at
+ * @param[out] path  buffer of length 'PATH_MAX' storing the path of the file
+ * @param[in]  len  the length of the path
+ * @return size_t  index of the only instruction that left the files, 'PAR_NONE' if there are none, or 'PAR_FOREIGN'
+ *
+ * @note the largest directories whose files were all left by the same instruction are stored as its paths.
+ */
+static size_t scan_parallel_files(par_scan *scan, int pwdfd, const char *name, char *path, size_t len){
+    assert(scan);
+    assert((pwdfd >= 0) || (pwdfd == AT_FDCWD));
+    assert(name);
+    assert(path);
+    assert(len);
+
+    struct stat file_stat;
+    struct dirent *entry;
+    char **names = NULL;
+    size_t *labels = NULL, names_num = 0, names_max = 0, name_len, sep, label = PAR_NONE, child, i;
+    void *ptr;
+    DIR *dir;
+    int fd;
+
+    if (fstatat(pwdfd, name, &file_stat, AT_SYMLINK_NOFOLLOW))
+        return PAR_NONE;
+    if ((file_stat.st_dev != scan->dev) || (! strcmp(path, "/dit")))
+        return PAR_FOREIGN;
+
+    if (! S_ISDIR(file_stat.st_mode)){
+        i = find_entry_instr(scan->entries, scan->entries_num, file_stat.st_ctim);
+        return ((i != SIZE_MAX) && (i >= scan->start)) ? (i - scan->start) : PAR_FOREIGN;
+    }
+
+    if ((fd = openat(pwdfd, name, (O_RDONLY | O_DIRECTORY))) == -1)
+        return PAR_FOREIGN;
+    if (! (dir = fdopendir(fd))){
+        close(fd);
+        return PAR_FOREIGN;
+    }
+
+    sep = (path[len - 1] != '/');
+
+    while ((entry = readdir(dir))){
+        if (! check_if_valid_dirent(entry->d_name))
+            continue;
+        if ((len + sep + (name_len = strlen(entry->d_name)) + 1) > PATH_MAX){
+            label = PAR_FOREIGN;
+            continue;
+        }
+
+        path[len] = '/';
+        memcpy((path + len + sep), entry->d_name, (name_len + 1));
+        child = scan_parallel_files(scan, fd, entry->d_name, path, (len + sep + name_len));
+        path[len] = '\0';
+
+        if (child < PAR_FOREIGN){
+            if (names_num == names_max){
+                names_max = names_max ? (((names_max + 1) << 1) - 1) : OPT_INITIAL_WORDS_MAX;
+
+                if ((ptr = realloc(labels, (sizeof(size_t) * names_max))))
+                    labels = (size_t *) ptr;
+                if ((! ptr) || (! (ptr = realloc(names, (sizeof(char *) * names_max))))){
+                    scan->failed = true;
+                    break;
+                }
+                names = (char **) ptr;
+            }
+
+            if (! (names[names_num] = strdup(entry->d_name))){
+                scan->failed = true;
+                break;
+            }
+            labels[names_num++] = child;
+        }
+
+        if (child != PAR_NONE)
+            label = ((label == PAR_NONE) || (label == child)) ? child : PAR_FOREIGN;
+    }
+
+    closedir(dir);
+
+    for (i = 0; i < names_num; i++){
+        if ((label == PAR_FOREIGN) && (! scan->failed)){
+            snprintf((path + len), (PATH_MAX - len), (sep ? "/%s" : "%s"), names[i]);
+            append_parallel_root((scan->nodes + labels[i]), path, &(scan->failed));
+            path[len] = '\0';
+        }
+        free(names[i]);
+    }
+
+    free(names);
+    free(labels);
+
+    return label;
+}
+
+
+/**
+ * @brief store the path as one of those the instruction left by itself.
+ *
+ * @param[out] node  the files the instruction left
+ * @param[in]  path  the path
+ * @param[out] p_failed  variable to be set to true on failure
+ */
+static void append_parallel_root(par_node *node, const char *path, bool *p_failed){
+    assert(node);
+    assert(path);
+    assert(p_failed);
+
+    const char * const shared_dirs[] = { "/etc/", "/root/", "/var/" };
+    const char * const library_dirs[] = { "/lib/", "/lib64/", "/usr/include/", "/usr/lib/", "/usr/lib64/", "/usr/local/include/", "/usr/local/lib/" };
+
+    size_t curr_max, i;
+    void *ptr;
+
+    if (node->roots_num == node->roots_max){
+        curr_max = node->roots_max ? (((node->roots_max + 1) << 1) - 1) : OPT_INITIAL_WORDS_MAX;
+
+        if (! (ptr = realloc(node->roots, (sizeof(char *) * curr_max)))){
+            *p_failed = true;
+            return;
+        }
+        node->roots = (char **) ptr;
+        node->roots_max = curr_max;
+    }
+
+    if (! (node->roots[node->roots_num] = strdup(path))){
+        *p_failed = true;
+        return;
+    }
+    node->roots_num++;
+
+    for (i = 0; i < numof(shared_dirs); i++)
+        if (! strncmp(path, shared_dirs[i], strlen(shared_dirs[i])))
+            node->shared = true;
+
+    for (i = 0; i < numof(library_dirs); i++)
+        if (! strncmp(path, library_dirs[i], strlen(library_dirs[i])))
+            node->provides = true;
+}
+
+
+/**
+ * @brief get the hint for the name of the stage the chain is moved to, from the paths it left.
+ *
+ * @param[in]  ir  the list of instructions
+ * @param[in]  scan  the state of the scan, where the files each instruction left are stored
+ * @param[out] parents  array of the instruction each instruction in the final stage is chained to
+ * @param[in]  start  index of the first instruction in the run containing the chain
+ * @param[in]  end  index of the instruction following the run
+ * @param[in]  chain  index of the instruction representing the chain in the final stage
+ * @param[out] hint  buffer of length 'PARALLEL_NAME_MAX' for storing the hint
+ *
+ * @note the first directory is preferred, and the extension is removed from the name of a file.
+ */
+static void get_chain_hint(
+    const opt_ir *ir, const par_scan *scan, size_t *parents, size_t start, size_t end, size_t chain, char *hint
+){
+    assert(ir);
+    assert(scan);
+    assert(parents);
+    assert(hint);
+
+    struct stat file_stat;
+    const par_node *node;
+    char *tmp;
+    size_t i, j;
+
+    strcpy(hint, "build");
+
+    for (i = end; i-- > start;)
+        if ((! ir->instrs[i].removed) && (find_parallel_chain(parents, (i - scan->start)) == chain))
+            for (node = scan->nodes + (i - scan->start), j = node->roots_num; j--;){
+                snprintf(hint, PARALLEL_NAME_MAX, "%s", basename_of(node->roots[j]));
+
+                if ((! lstat(node->roots[j], &file_stat)) && S_ISDIR(file_stat.st_mode))
+                    return;
+                if ((tmp = strchr((hint + 1), '.')))
+                    *tmp = '\0';
+            }
+}
+
+
+/**
+ * @brief get the name given to the stage by the specified FROM instruction.
+ *
+ * @param[in]  instr  FROM instruction
+ * @param[out] name  buffer of length 'PARALLEL_NAME_MAX' for storing the name
+ * @return bool  whether the stage is named
+ */
+static bool get_stage_alias(const opt_instr *instr, char *name){
+    assert(instr);
+    assert(name);
+
+    const char *word, *next;
+    size_t len;
+    bool as_found = false;
+
+    for (word = instr->args; *(word += strspn(word, " \t\r\n")); word = next){
+        len = strcspn(word, " \t\r\n");
+        next = word + len;
+
+        if (as_found){
+            if (len >= PARALLEL_NAME_MAX)
+                return false;
+            memcpy(name, word, len);
+            name[len] = '\0';
+            return true;
+        }
+        as_found = (len == 2) && (toupper((unsigned char) word[0]) == 'A') && (toupper((unsigned char) word[1]) == 'S');
+    }
+
+    return false;
+}
+
+
+/**
+ * @brief make the name of a new stage from the hint, so that it is different from the names of the other stages.
+ *
+ * @param[in]  ir  the list of instructions
+ * @param[in]  hint  the hint for the name, such as the directory the stage builds
+ * @param[in]  names  array of the names already given to the new stages
+ * @param[in]  names_num  array size
+ * @param[out] name  buffer of length 'PARALLEL_NAME_MAX' for storing the resulting name
+ *
+ * @note the name begins with a letter and consists of lowercase letters, digits, '-', '_' and '.'.
+ */
+static void make_stage_name(
+    const opt_ir *ir, const char *hint, const char (* names)[PARALLEL_NAME_MAX], size_t names_num, char *name
+){
+    assert(ir);
+    assert(hint);
+    assert(names || (! names_num));
+    assert(name);
+
+    char stem[PARALLEL_NAME_MAX - 8], alias[PARALLEL_NAME_MAX];
+    size_t len = 0, n, i;
+
+    for (; *hint && (! isalpha((unsigned char) *hint)); hint++);
+
+    for (; *hint && (len < (sizeof(stem) - 1)); hint++)
+        if (isalnum((unsigned char) *hint) || strchr("-_.", *hint))
+            stem[len++] = tolower((unsigned char) *hint);
+        else
+            stem[len++] = '-';
+
+    if (len)
+        stem[len] = '\0';
+    else
+        strcpy(stem, "build");
+
+    for (n = 1;; n++){
+        snprintf(name, PARALLEL_NAME_MAX, ((n > 1) ? "%s-%zu" : "%s"), stem, n);
+
+        for (i = 0; i < names_num; i++)
+            if (! strcasecmp(names[i], name))
+                break;
+        if (i < names_num)
+            continue;
+
+        for (i = 0; i < ir->instrs_num; i++)
+            if ((ir->instrs[i].id == ID_FROM) && get_stage_alias((ir->instrs + i), alias) && (! strcasecmp(alias, name)))
+                break;
+        if (i == ir->instrs_num)
+            break;
+    }
+}
+
+
+/**
+ * @brief write the build arguments declared in the final stage so far, which are not inherited by the new stages.
+ *
+ * @param[in]  ir  the list of instructions
+ * @param[in]  from  index of FROM instruction beginning the final stage
+ * @param[in]  end  index of the instruction before which the new stages are inserted
+ * @param[out] fp  the destination stream
+ */
+static void write_stage_args(const opt_ir *ir, size_t from, size_t end, FILE *fp){
+    assert(ir);
+    assert(fp);
+
+    const char *text;
+    size_t len;
+
+    for (from++; from < end; from++)
+        if ((ir->instrs[from].id == ID_ARG) && (! ir->instrs[from].removed)){
+            text = ir->instrs[from].text;
+            fputs(text, fp);
+
+            if ((! (len = strlen(text))) || (text[len - 1] != '\n'))
+                fputc('\n', fp);
+        }
+}
+
+
+/**
+ * @brief print the arguments of COPY instruction copying the path to the same path.
+ *
+ * @param[out] fp  the destination stream
+ * @param[in]  path  the path
+ *
+ * @note the JSON form is used if the path contains any character that the shell form cannot express.
+ */
+static void print_copy_paths(FILE *fp, const char *path){
+    assert(fp);
+    assert(path);
+
+    const char *tmp;
+    int i;
+
+    if (! strpbrk(path, " \t\"\\")){
+        fprintf(fp, "%s %s\n", path, path);
+        return;
+    }
+
+    fputc('[', fp);
+
+    for (i = 0; i < 2; i++){
+        fputs((i ? ", \"" : "\""), fp);
+
+        for (tmp = path; *tmp; tmp++){
+            if ((*tmp == '"') || (*tmp == '\\'))
+                fputc('\\', fp);
+            fputc(*tmp, fp);
+        }
+        fputc('"', fp);
+    }
+
+    fputs("]\n", fp);
+}
+
+
+
+
+/******************************************************************************
+    * Budget Check
+******************************************************************************/
+
+
+/**
+ * @brief project the image size, and report it against the size budget with the instructions enlarging it most.
+ *
+ * @param[in]  ir  the list of instructions
+ * @param[in]  budget  the size budget in bytes
+ * @return int  0 (within the budget), 1 (exceeding the budget) or -1 (unexpected error)
+ *
+ * @note the image is projected from this container, where each instruction adds the files it created or changed.
+ * @note the compressed sizes of the top instructions are estimated as 'dit inspect -z' does, for reference only.
+ */
+static int check_budget(const opt_ir *ir, off_t budget){
+    assert(ir);
+    assert(budget > 0);
+
+    budget_scan scan = {0};
+    opt_entry *entries = NULL;
+    budget_attr **tops = NULL, *attr;
+    char *src;
+    const char *text;
+    size_t entries_num = 0, tops_num = 0, i, j;
+    off_t projected, attributed = 0, gzip;
+    int exit_status = UNEXPECTED_ERROR, len;
+
+    if ((src = read_whole_file(REFLECT_LOG_FILE, NULL)))
+        entries_num = load_reflect_log(ir, src, &entries);
+
+    scan.entries = entries;
+    scan.entries_num = entries_num;
+
+    if (entries_num && (! (scan.attrs = (budget_attr *) calloc(ir->instrs_num, sizeof(budget_attr)))))
+        goto exit;
+    if ((projected = project_image_size(&scan)) < 0)
+        goto exit;
+
+    record_projection(projected, budget);
+
+    if (scan.attrs){
+        if (! (tops = (budget_attr **) malloc(sizeof(budget_attr *) * ir->instrs_num)))
+            goto exit;
+
+        for (i = 0; i < ir->instrs_num; i++)
+            if (scan.attrs[i].bytes > 0){
+                scan.attrs[i].instr = i;
+                attributed += scan.attrs[i].bytes;
+                tops[tops_num++] = scan.attrs + i;
+            }
+
+        qsort(tops, tops_num, sizeof(budget_attr *), qcmp_budget_attr);
+        if (tops_num > BUDGET_TOP_INSTRS_MAX)
+            tops_num = BUDGET_TOP_INSTRS_MAX;
+    }
+
+    if (! tops_num)
+        fputs("budget: no file in this container is attributed to the instructions in the reflect log\n", ir->report);
+
+    for (i = 0; i < tops_num; i++){
+        attr = tops[i];
+        gzip = attr->bytes;
+
+        if (estimate_file_sizes(attr->paths, attr->paths_num, attr->sizes))
+            for (j = 0; j < attr->paths_num; j++)
+                gzip -= attr->sizes[j][0] - attr->sizes[j][1];
+
+        text = ir->instrs[attr->instr].text;
+        len = strcspn(text, "\n");
+        while ((len > 0) && ((text[len - 1] == '\\') || (text[len - 1] == ' ') || (text[len - 1] == '\r')))
+            len--;
+
+        fprintf(ir->report, "budget: line %zu: ", ir->instrs[attr->instr].line);
+        print_saving(ir->report, attr->bytes);
+        fputs(" (gzip~ ", ir->report);
+        print_saving(ir->report, ((gzip > 0) ? gzip : 0));
+
+        if (len > BUDGET_TEXT_MAX)
+            fprintf(ir->report, ") by '%.*s...'\n", BUDGET_TEXT_MAX, text);
+        else
+            fprintf(ir->report, ") by '%.*s'\n", len, text);
+    }
+
+    fputs("budget: ", ir->report);
+    print_saving(ir->report, (projected - attributed));
+    fputs(" in the base image and the changes not attributed to this Dockerfile\n", ir->report);
+
+    fputs("budget: the projected image size is ", ir->report);
+    print_saving(ir->report, projected);
+    fputs(" against the budget of ", ir->report);
+    print_saving(ir->report, budget);
+
+    if (projected > budget){
+        fputs(", exceeding it by ", ir->report);
+        print_saving(ir->report, (projected - budget));
+        fputc('\n', ir->report);
+        exit_status = POSSIBLE_ERROR;
+    }
+    else {
+        fputs(", leaving ", ir->report);
+        print_saving(ir->report, (budget - projected));
+
+        if ((projected / (double) budget) * 100 >= BUDGET_WARNING_PERCENT)
+            fprintf(ir->report, ", but more than %d%% of it is used", BUDGET_WARNING_PERCENT);
+        fputc('\n', ir->report);
+        exit_status = SUCCESS;
+    }
+
+exit:
+    if (scan.attrs){
+        for (i = 0; i < ir->instrs_num; i++){
+            for (j = 0; j < scan.attrs[i].paths_num; j++)
+                free(scan.attrs[i].paths[j]);
+            free(scan.attrs[i].paths);
+            free(scan.attrs[i].sizes);
+        }
+        free(scan.attrs);
+    }
+    free(tops);
+    free(entries);
+    free(src);
+
+    return exit_status;
+}
+
+
+/**
+ * @brief measure the projected image size, attributing each file to an instruction if possible.
+ *
+ * @param[out] scan  the state of the scan
+ * @return off_t  the projected image size in bytes, or -1 on failure
+ *
+ * @note neither the files of this tool nor those on the other file systems such as '/proc' are counted.
+ */
+static off_t project_image_size(budget_scan *scan){
+    assert(scan);
+
+    struct stat file_stat;
+    char path[PATH_MAX] = "/";
+
+    if (lstat(path, &file_stat))
+        return -1;
+
+    scan->dev = file_stat.st_dev;
+    scan->total = 0;
+    scan_image_files(scan, AT_FDCWD, path, path, 1);
+
+    return scan->total;
+}
+
+
+/**
+ * @brief scan the specified file and all files below it for the projected image size.
+ *
+ * @param[out] scan  the state of the scan
+ * @param[in]  pwdfd  file descriptor that serves as the current working directory
+ * @param[in]  name  name of the file we are currently looking at
+ * @param[out] path  buffer of length 'PATH_MAX' storing the path of the file
+ * @param[in]  len  the length of the path
+ *
+ * @note a file with multiple hard links is counted in equal parts by each of them.
+ */
+static void scan_image_files(budget_scan *scan, int pwdfd, const char *name, char *path, size_t len){
+    assert(scan);
+    assert((pwdfd >= 0) || (pwdfd == AT_FDCWD));
+    assert(name);
+    assert(path);
+    assert(len);
+
+    struct stat file_stat;
+    struct dirent *entry;
+    size_t name_len, sep;
+    DIR *dir;
+    int fd;
+
+    if (fstatat(pwdfd, name, &file_stat, AT_SYMLINK_NOFOLLOW) || (file_stat.st_dev != scan->dev))
+        return;
+
+    if (S_ISDIR(file_stat.st_mode)){
+        if ((! strcmp(path, "/dit")) || ((fd = openat(pwdfd, name, (O_RDONLY | O_DIRECTORY))) == -1))
+            return;
+        if (! (dir = fdopendir(fd))){
+            close(fd);
+            return;
+        }
+
+        sep = (path[len - 1] != '/');
+
+        while ((entry = readdir(dir)))
+            if (check_if_valid_dirent(entry->d_name) && ((len + sep + (name_len = strlen(entry->d_name)) + 1) <= PATH_MAX)){
+                path[len] = '/';
+                memcpy((path + len + sep), entry->d_name, (name_len + 1));
+                scan_image_files(scan, fd, entry->d_name, path, (len + sep + name_len));
+                path[len] = '\0';
+            }
+
+        closedir(dir);
+        return;
+    }
+
+    if (S_ISREG(file_stat.st_mode) || S_ISLNK(file_stat.st_mode))
+        attribute_image_file(scan, path, &file_stat, (file_stat.st_size / (file_stat.st_nlink ? file_stat.st_nlink : 1)));
+}
+
+
+/**
+ * @brief add the file to the projected image size, and attribute it to the instruction that created or changed it.
+ *
+ * @param[out] scan  the state of the scan
+ * @param[in]  path  path of the file
+ * @param[in]  file_stat  the status of the file
+ * @param[in]  bytes  the bytes the file adds to the image
+ *
+ * @note only the regular files are kept for the estimates of their compressed size.
+ */
+static void attribute_image_file(budget_scan *scan, const char *path, const struct stat *file_stat, off_t bytes){
+    assert(scan);
+    assert(path);
+    assert(file_stat);
+
+    size_t i;
+    budget_attr *attr;
+    void *ptr;
+
+    scan->total += bytes;
 
+    if ((! scan->attrs) || ((i = find_entry_instr(scan->entries, scan->entries_num, file_stat->st_ctim)) == SIZE_MAX))
+        return;
 
-int optimize(int argc, char **argv){
-    fputs("optimize\n", stdout);
-    return 0;
+    attr = scan->attrs + i;
+    attr->bytes += bytes;
+
+    if ((! S_ISREG(file_stat->st_mode)) || (! bytes))
+        return;
+
+    if (attr->paths_num == attr->paths_max){
+        size_t curr_max;
+
+        curr_max = attr->paths_max ? (((attr->paths_max + 1) << 1) - 1) : OPT_INITIAL_WORDS_MAX;
+
+        if (! (ptr = realloc(attr->sizes, (sizeof(*(attr->sizes)) * curr_max))))
+            return;
+        attr->sizes = ptr;
+
+        if (! (ptr = realloc(attr->paths, (sizeof(char *) * curr_max))))
+            return;
+        attr->paths = (char **) ptr;
+        attr->paths_max = curr_max;
+    }
+
+    if ((attr->paths[attr->paths_num] = strdup(path))){
+        attr->sizes[attr->paths_num][0] = bytes;
+        attr->paths_num++;
+    }
+}
+
+
+/**
+ * @brief record the projected image size with the budget, from which the prompt shows the remaining budget.
+ *
+ * @param[in]  projected  the projected image size in bytes, or -1 to discard the record
+ * @param[in]  budget  the size budget in bytes
+ *
+ * @note the record is left as it is if it cannot be updated, since it is only for reference.
+ * @note the budget is recorded together, so that the prompt does not have to read the settings file.
+ */
+static void record_projection(off_t projected, off_t budget){
+    FILE *fp;
+
+    if ((fp = fopen(SIZE_PROJECTION_FILE, "w"))){
+        if (projected >= 0)
+            fprintf(fp, "%lld %lld\n", ((long long) projected), ((long long) budget));
+        fclose(fp);
+    }
+}
+
+
+/**
+ * @brief parse the target string as a size, which may be followed by a unit such as 'MB' or 'GiB'.
+ *
+ * @param[in]  target  target string
+ * @return off_t  the resulting size in bytes, or -1 if the string is invalid
+ *
+ * @note the units without 'i' are powers of 1000, as the sizes are reported by this command.
+ */
+static off_t parse_size(const char *target){
+    assert(target);
+
+    const char *units = "KMGTP", *tmp;
+    double size = 0, scale = 1, base = 1000;
+    bool digits = false;
+    int i;
+
+    for (; isdigit((unsigned char) *target); target++, digits = true)
+        size = size * 10 + (*target - '0');
+
+    if (*target == '.')
+        while (isdigit((unsigned char) *(++target))){
+            scale /= 10;
+            size += (*target - '0') * scale;
+            digits = true;
+        }
+
+    if (! digits)
+        return -1;
+
+    if (*target && (tmp = strchr(units, toupper((unsigned char) *target)))){
+        if (*(++target) == 'i'){
+            base = 1024;
+            target++;
+        }
+        for (i = tmp - units + 1; i--;)
+            size *= base;
+    }
+
+    if ((*target == 'B') || (*target == 'b'))
+        target++;
+
+    if (*target || (size >= 0x1p62))
+        return -1;
+
+    return (off_t) (size + 0.5);
+}
+
+
+/**
+ * @brief comparison function between the files attributed to instructions.
+ *
+ * @param[in]  a  pointer to the files attributed to an instruction
+ * @param[in]  b  pointer to the files attributed to an instruction
+ * @return int  comparison result of their bytes, where the larger comes first
+ */
+static int qcmp_budget_attr(const void *a, const void *b){
+    off_t bytes1, bytes2;
+
+    bytes1 = (*((budget_attr * const *) a))->bytes;
+    bytes2 = (*((budget_attr * const *) b))->bytes;
+
+    return (bytes1 < bytes2) - (bytes1 > bytes2);
+}
+
+
+
+
+/******************************************************************************
+    * Output Phase
+******************************************************************************/
+
+
+/**
+ * @brief write the list of instructions as Dockerfile.
+ *
+ * @param[in]  ir  the list of instructions
+ * @param[out] fp  the destination stream
+ */
+static void write_dockerfile(const opt_ir *ir, FILE *fp){
+    assert(ir);
+    assert(fp);
+
+    const opt_instr *instr;
+    size_t i, len;
+
+    for (i = 0; i < ir->instrs_num; i++){
+        instr = ir->instrs + i;
+
+        if (instr->before)
+            fputs(instr->before, fp);
+
+        fputs(instr->lead, fp);
+
+        if (instr->removed)
+            continue;
+
+        if (instr->modified)
+            write_run_instr(instr, fp);
+        else {
+            fputs(instr->text, fp);
+
+            if ((! (len = strlen(instr->text))) || (instr->text[len - 1] != '\n'))
+                fputc('\n', fp);
+        }
+    }
+
+    if (ir->tail)
+        fputs(ir->tail, fp);
+}
+
+
+/**
+ * @brief write RUN instruction from its remaining commands.
+ *
+ * @param[in]  instr  RUN instruction
+ * @param[out] fp  the destination stream
+ *
+ * @note if the original instruction spans multiple lines, each command is written on its own line.
+ */
+static void write_run_instr(const opt_instr *instr, FILE *fp){
+    assert(instr);
+    assert(instr->cmds_num);
+    assert(fp);
+
+    const opt_cmd *cmd;
+    const char *sep;
+    bool multiline, first = true;
+    size_t i;
+
+    multiline = strchr(instr->text, '\n') && (strchr(instr->text, '\n')[1] != '\0');
+
+    fputs("RUN ", fp);
+    if (instr->flags)
+        fprintf(fp, "%s ", instr->flags);
+
+    for (i = 0; i < instr->cmds_num; i++){
+        cmd = instr->cmds + i;
+
+        if (cmd->removed)
+            continue;
+
+        if (! first){
+            sep = (cmd->sep == '&') ? "&&" : ((cmd->sep == '|') ? "||" : ";");
+
+            if (*sep == ';')
+                fputs((multiline ? "; \\\n    " : "; "), fp);
+            else
+                fprintf(fp, (multiline ? " \\\n    %s " : " %s "), sep);
+        }
+
+        fputs(cmd->text, fp);
+        first = false;
+    }
+
+    fputc('\n', fp);
+}
+
+
+/**
+ * @brief release the list of instructions.
+ *
+ * @param[out] ir  the list of instructions
+ */
+static void free_ir(opt_ir *ir){
+    assert(ir);
+
+    opt_instr *instr;
+    size_t i, j, k;
+
+    for (i = 0; i < ir->instrs_num; i++){
+        instr = ir->instrs + i;
+
+        for (j = 0; j < instr->cmds_num; j++){
+            for (k = 0; k < instr->cmds[j].words_num; k++)
+                free(instr->cmds[j].words[k]);
+            free(instr->cmds[j].words);
+            free(instr->cmds[j].text);
+        }
+
+        free(instr->cmds);
+        free(instr->lead);
+        free(instr->text);
+        free(instr->args);
+        free(instr->flags);
+        free(instr->before);
+    }
+
+    free(ir->instrs);
+    free(ir->tail);
+    memset(ir, 0, sizeof(opt_ir));
+}
+
+
+
+
+/******************************************************************************
+    * Utility Functions
+******************************************************************************/
+
+
+/**
+ * @brief read the whole contents of the specified file.
+ *
+ * @param[in]  file_name  the file
+ * @param[out] p_len  variable to store the length of the contents, or NULL
+ * @return char*  the null-terminated contents, or NULL with errno set
+ *
+ * @attention if the return value is non-NULL, it should be released by the caller.
+ */
+static char *read_whole_file(const char *file_name, size_t *p_len){
+    assert(file_name);
+
+    char *contents;
+    size_t size = BUFSIZ, len = 0, tmp;
+    FILE *fp;
+    void *ptr;
+
+    if (! (fp = fopen(file_name, "r")))
+        return NULL;
+
+    if ((contents = (char *) malloc(sizeof(char) * size)))
+        while ((tmp = fread((contents + len), sizeof(char), (size - len - 1), fp)) > 0)
+            if (((len += tmp) + 1) == size){
+                if (! (ptr = realloc(contents, (sizeof(char) * (size <<= 1))))){
+                    free(contents);
+                    contents = NULL;
+                    break;
+                }
+                contents = (char *) ptr;
+            }
+
+    fclose(fp);
+
+    if (contents){
+        contents[len] = '\0';
+        if (p_len)
+            *p_len = len;
+    }
+    else
+        errno = ENOMEM;
+
+    return contents;
+}
+
+
+/**
+ * @brief print the bytes saved in the same units as 'dit inspect'.
+ *
+ * @param[out] fp  the destination stream
+ * @param[in]  size  the bytes
+ */
+static void print_saving(FILE *fp, off_t size){
+    assert(fp);
+    assert(size >= 0);
+
+    int i = 0;
+    lldiv_t tmp = {0};
+
+    while ((size >= 1000) && (i < 8)){
+        i++;
+        tmp = lldiv(size, 1000);
+        size = tmp.quot;
+    }
+
+    if (i)
+        fprintf(fp, "%d.%d %cB", ((int) size), ((int) (tmp.rem / 100)), " kMGTPEZY"[i]);
+    else
+        fprintf(fp, "%d B", ((int) size));
+}
+
+
+/**
+ * @brief find the instruction whose command line was running when a file had its status changed.
+ *
+ * @param[in]  entries  array of the lines in the reflect log, in chronological order
+ * @param[in]  entries_num  array size
+ * @param[in]  ctime  when the status of the file was last changed
+ * @return size_t  index of the instruction, or SIZE_MAX if the change is not in any command line
+ */
+static size_t find_entry_instr(const opt_entry *entries, size_t entries_num, struct timespec ctime){
+    assert(entries || (! entries_num));
+
+    size_t left = 0, right, mid;
+    const opt_entry *entry;
+
+    for (right = entries_num; left < right;){
+        mid = (left + right) / 2;
+        if (compare_timespec(entries[mid].start, ctime) <= 0)
+            left = mid + 1;
+        else
+            right = mid;
+    }
+
+    if (! left)
+        return SIZE_MAX;
+
+    entry = entries + left - 1;
+    if (compare_timespec(ctime, entry->end) > 0)
+        return SIZE_MAX;
+
+    return entry->instr;
+}
+
+
+/**
+ * @brief comparison function between packages of dpkg.
+ *
+ * @param[in]  a  pointer to the package
+ * @param[in]  b  pointer to the package
+ * @return int  comparison result of their names
+ */
+static int qcmp_dpkg_pkg(const void *a, const void *b){
+    return strcmp(((const dpkg_pkg *) a)->name, ((const dpkg_pkg *) b)->name);
+}
+
+
+/**
+ * @brief comparison function between lines in the reflect log.
+ *
+ * @param[in]  a  pointer to the line
+ * @param[in]  b  pointer to the line
+ * @return int  comparison result of when their command lines started
+ */
+static int qcmp_entry(const void *a, const void *b){
+    return compare_timespec(((const opt_entry *) a)->start, ((const opt_entry *) b)->start);
+}
+
+
+/**
+ * @brief compare two points in time.
+ *
+ * @param[in]  ts1  a point in time
+ * @param[in]  ts2  a point in time
+ * @return int  negative, 0 or positive integer, as the former is earlier than, same as or later than the latter
+ */
+static int compare_timespec(struct timespec ts1, struct timespec ts2){
+    if (ts1.tv_sec != ts2.tv_sec)
+        return (ts1.tv_sec < ts2.tv_sec) ? -1 : 1;
+
+    return (ts1.tv_nsec > ts2.tv_nsec) - (ts1.tv_nsec < ts2.tv_nsec);
+}
+
+
+/**
+ * @brief get the last component of the specified path.
+ *
+ * @param[in]  path  the path
+ * @return const char*  the last component
+ */
+static const char *basename_of(const char *path){
+    assert(path);
+
+    const char *tmp;
+
+    if ((tmp = strrchr(path, '/')) && tmp[1])
+        return tmp + 1;
+    return path;
+}
+
+
+/**
+ * @brief check if the two package managers share the same package index, like 'apt' and 'apt-get'.
+ *
+ * @param[in]  manager1  index of a package manager, or -1
+ * @param[in]  manager2  index of another package manager, or -1
+ * @return bool  the resulting boolean
+ */
+static bool check_if_same_manager(int manager1, int manager2){
+    assert(manager1 < OPT_PKG_MANAGERS_NUM);
+    assert(manager2 < OPT_PKG_MANAGERS_NUM);
+
+    return (manager1 >= 0) && (manager2 >= 0) && (! strcmp(pkg_managers[manager1].cache, pkg_managers[manager2].cache));
+}
+
+
+/**
+ * @brief check if the specified word of the command operating a package manager is its option.
+ *
+ * @param[in]  cmd  the command
+ * @param[in]  i  index of the word
+ * @param[in]  manager  the package manager
+ * @param[out] p_arg  variable to store whether the option takes the next word as its argument
+ * @return bool  the resulting boolean
+ */
+static bool check_if_option(const opt_cmd *cmd, size_t i, const pkg_manager *manager, bool *p_arg){
+    assert(cmd);
+    assert(i < cmd->words_num);
+    assert(manager);
+    assert(p_arg);
+
+    const char *word;
+
+    word = cmd->words[i];
+    *p_arg = false;
+
+    if (*word != '-')
+        return false;
+
+    for (const char * const *p_word = manager->arg_opts; *p_word; p_word++)
+        if (! strcmp(word, *p_word)){
+            *p_arg = ((i + 1) < cmd->words_num);
+            break;
+        }
+
+    return true;
+}
+
+
+/**
+ * @brief check if the option only makes the package manager answer yes or be quiet.
+ *
+ * @param[in]  word  the option
+ * @return bool  the resulting boolean
+ */
+static bool check_if_yes_option(const char *word){
+    assert(word);
+
+    return (! strcmp(word, "-y")) || (! strcmp(word, "--yes")) || (! strcmp(word, "--assume-yes")) ||
+        (! strcmp(word, "-q")) || (! strcmp(word, "-qq")) || (! strcmp(word, "--quiet"));
+}
+
+
+/**
+ * @brief check if the package to be installed is a local file instead of one in the repositories.
+ *
+ * @param[in]  word  the package
+ * @return bool  the resulting boolean
+ */
+static bool check_if_local_package(const char *word){
+    assert(word);
+
+    size_t len;
+
+    if (strchr(word, '/'))
+        return true;
+
+    len = strlen(word);
+    return (len > 4) && ((! strcmp((word + len - 4), ".deb")) || (! strcmp((word + len - 4), ".rpm")) ||
+        (! strcmp((word + len - 4), ".apk")));
+}
+
+
+/**
+ * @brief check if the word names the specified package, ignoring its version or architecture.
+ *
+ * @param[in]  word  the word
+ * @param[in]  package  the package, which may be followed by its version or architecture
+ * @return bool  the resulting boolean
+ */
+static bool match_package_name(const char *word, const char *package){
+    assert(word);
+    assert(package);
+
+    size_t len;
+
+    word = basename_of(word);
+    len = strcspn(package, "=:<>~");
+
+    return len && (! strncmp(word, package, len)) && (! word[len]);
+}
+
+
+
+
+/******************************************************************************
+    * Function used in separate files
+******************************************************************************/
+
+
+/**
+ * @brief get the budget remaining after the projected image size recorded by the last budget check.
+ *
+ * @param[out] p_remaining  variable to store the remaining budget in bytes, which is negative if exceeded
+ * @param[out] p_stale  variable to store whether any line has been reflected since the record
+ * @return bool  whether the remaining budget is stored
+ *
+ * @note nothing is stored unless this command has checked the image against the size budget.
+ * @note the image is never measured here, since this function is called from the prompt after each command line.
+ */
+bool get_remaining_budget(off_t *p_remaining, bool *p_stale){
+    assert(p_remaining);
+    assert(p_stale);
+
+    struct stat file_stat;
+    struct timespec recorded;
+    char *line, *tmp, *end;
+    long long projected, budget;
+    bool success = false;
+
+    if (stat(SIZE_PROJECTION_FILE, &file_stat) || (! file_stat.st_size))
+        return success;
+
+    recorded = file_stat.st_mtim;
+
+    if ((line = get_one_liner(SIZE_PROJECTION_FILE))){
+        errno = 0;
+        projected = strtoll(line, &end, 10);
+
+        if ((! errno) && (end != line) && (*end == ' ')){
+            budget = strtoll((tmp = end), &end, 10);
+
+            if ((! errno) && (end != tmp) && (! *end) && (projected >= 0) && (budget > 0)){
+                *p_remaining = budget - projected;
+                *p_stale = (! stat(REFLECT_LOG_FILE, &file_stat)) && (
+                    (file_stat.st_mtim.tv_sec > recorded.tv_sec) ||
+                    ((file_stat.st_mtim.tv_sec == recorded.tv_sec) && (file_stat.st_mtim.tv_nsec > recorded.tv_nsec))
+                );
+                success = true;
+            }
+        }
+    }
+
+    free(line);
+    return success;
 }
 
 
@@ -17,9 +4945,598 @@ int optimize(int argc, char **argv){
     * Unit Test Functions
 ******************************************************************************/
 
+
+static void split_run_commands_test(void);
+static void classify_cmd_test(void);
+static void apply_hygiene_test(void);
+static void consolidate_installs_test(void);
+static void load_reflect_log_test(void);
+static void render_slim_cleanup_test(void);
+static void parse_copy_args_test(void);
+static void resolve_mentioned_path_test(void);
+static void parse_size_test(void);
+
+
+
+
 void optimize_test(void){
-    fputs("optimize test\n", stdout);
+    do_test(split_run_commands_test);
+    do_test(classify_cmd_test);
+    do_test(apply_hygiene_test);
+    do_test(consolidate_installs_test);
+    do_test(load_reflect_log_test);
+    do_test(render_slim_cleanup_test);
+    do_test(parse_copy_args_test);
+    do_test(resolve_mentioned_path_test);
+    do_test(parse_size_test);
+}
+
+
+
+
+static void split_run_commands_test(void){
+    // changeable part for updating test cases
+    const struct {
+        const char * const args;
+        const size_t cmds_num;
+        const char * const last;
+        const int last_sep;
+    }
+    table[] = {
+        { "apt-get update && apt-get install -y curl",        2, "apt-get install -y curl",     '&'  },
+        { "set -eux;   make  'a  b';",                        2, "make 'a  b'",                 ';'  },
+        { "make || true",                                     2, "true",                        '|'  },
+        { "echo \"a && b\" | tee x > /dev/null 2>&1",         1, "echo \"a && b\" | tee x > /dev/null 2>&1", '\0' },
+        { "--mount=type=cache,target=/root/.cache pip install x", 1, "pip install x",           '\0' },
+        { "x=$(a && b) && echo $x",                           2, "echo $x",                     '&'  },
+        { "[ \"make\" ]",                                     0,  NULL,                         '\0' },
+        { "if true; then make; fi",                           0,  NULL,                         '\0' },
+        { "sleep 1 &",                                        0,  NULL,                         '\0' },
+        { "make # comment",                                   0,  NULL,                         '\0' },
+        {  0,                                                 0,  NULL,                         '\0' }
+    };
+
+    opt_instr instr;
+    char *args;
+    size_t i, j;
+
+    for (i = 0; table[i].args; i++){
+        memset(&instr, 0, sizeof(opt_instr));
+        assert((args = strdup(table[i].args)));
+        instr.args = args;
+
+        if (table[i].cmds_num){
+            assert(split_run_commands(&instr, args));
+            assert(instr.cmds_num == table[i].cmds_num);
+            assert(! strcmp(instr.cmds[instr.cmds_num - 1].text, table[i].last));
+            assert(instr.cmds[instr.cmds_num - 1].sep == table[i].last_sep);
+        }
+        else
+            assert(! split_run_commands(&instr, args));
+
+        for (j = 0; j < instr.cmds_num; j++){
+            for (size_t k = 0; k < instr.cmds[j].words_num; k++)
+                free(instr.cmds[j].words[k]);
+            free(instr.cmds[j].words);
+            free(instr.cmds[j].text);
+        }
+        free(instr.cmds);
+        free(instr.flags);
+        free(args);
+
+        print_progress_test_loop('\0', -1, i);
+        fprintf(stderr, "%s\n", table[i].args);
+    }
+}
+
+
+
+
+static void classify_cmd_test(void){
+    // changeable part for updating test cases
+    const struct {
+        const char * const text;
+        const int kind;
+        const char * const manager;
+    }
+    table[] = {
+        { "apt-get install -y --no-install-recommends curl", OPT_CMD_INSTALL, "apt-get" },
+        { "DEBIAN_FRONTEND=noninteractive apt-get -y install gcc", OPT_CMD_INSTALL, "apt-get" },
+        { "sudo -E apt update",                              OPT_CMD_UPDATE,  "apt"     },
+        { "apk add --no-cache bash",                         OPT_CMD_INSTALL, "apk"     },
+        { "apk del .build-deps",                             OPT_CMD_REMOVE,  "apk"     },
+        { "yum clean all",                                   OPT_CMD_CLEAN,   "yum"     },
+        { "rm -rf /var/lib/apt/lists/*",                     OPT_CMD_CLEAN,   "apt"     },
+        { "apt-get -o Acquire::Retries=3 update",            OPT_CMD_UPDATE,  "apt-get" },
+        { "echo 'deb http://x y main' > /etc/apt/sources.list.d/x.list", OPT_CMD_SOURCES, NULL },
+        { "add-apt-repository ppa:x/y",                      OPT_CMD_SOURCES, NULL      },
+        { "set -eux",                                        OPT_CMD_TRIVIAL, NULL      },
+        { "make install",                                    OPT_CMD_OTHER,   NULL      },
+        {  0,                                                0,               NULL      }
+    };
+
+    opt_cmd cmd;
+    size_t i, j;
+
+    for (i = 0; table[i].text; i++){
+        memset(&cmd, 0, sizeof(opt_cmd));
+        assert((cmd.text = strdup(table[i].text)));
+        assert(split_words(&cmd));
+
+        classify_cmd(&cmd);
+        assert(cmd.kind == table[i].kind);
+
+        if (table[i].manager && (table[i].kind != OPT_CMD_CLEAN))
+            assert(! strcmp(pkg_managers[cmd.manager].name, table[i].manager));
+        else if (! table[i].manager)
+            assert(cmd.manager < 0);
+
+        for (j = 0; j < cmd.words_num; j++)
+            free(cmd.words[j]);
+        free(cmd.words);
+        free(cmd.text);
+
+        print_progress_test_loop('\0', -1, i);
+        fprintf(stderr, "%s\n", table[i].text);
+    }
+}
+
+
+
+
+static void apply_hygiene_test(void){
+    // changeable part for updating test cases
+    const struct {
+        const char * const src;
+        const char * const recorded;
+        const char * const result;
+    }
+    table[] = {
+        {
+            "FROM debian\n"
+            "RUN apt-get update && apt-get install -y curl\n"
+            "RUN set -eux; \\\n"
+            "    apt-get update; \\\n"
+            "    apt-get install -y -o APT::Install-Recommends=false make; \\\n"
+            "    rm -rf /var/lib/apt/lists/*\n",
+
+            "apt-get",
+
+            "FROM debian\n"
+            "RUN apt-get update && apt-get install --no-install-recommends -y curl && rm -rf /var/lib/apt/lists/*\n"
+            "RUN set -eux; \\\n"
+            "    apt-get update; \\\n"
+            "    apt-get install -y -o APT::Install-Recommends=false make; \\\n"
+            "    rm -rf /var/lib/apt/lists/*\n"
+        },
+        {
+            "FROM alpine\n"
+            "RUN apk update && \\\n"
+            "    apk add git\n"
+            "RUN apk add py3-pip && pip install flask\n"
+            "ENV PIP_NO_CACHE_DIR=1\n"
+            "RUN python3 -m pip install requests && npm ci\n"
+            "FROM alpine\n"
+            "RUN python3 -m pip install requests\n",
+
+            "apk",
+
+            "FROM alpine\n"
+            "RUN apk update \\\n"
+            "    && apk add git \\\n"
+            "    && rm -rf /var/cache/apk/*\n"
+            "RUN apk add --no-cache py3-pip && pip install --no-cache-dir flask\n"
+            "ENV PIP_NO_CACHE_DIR=1\n"
+            "RUN python3 -m pip install requests && npm ci && npm cache clean --force\n"
+            "FROM alpine\n"
+            "RUN python3 -m pip install --no-cache-dir requests\n"
+        },
+        {
+            "FROM centos\n"
+            "RUN yum install -y httpd; dnf install -y nginx && dnf clean all\n"
+            "RUN [\"yum\", \"install\", \"-y\", \"git\"]\n"
+            "RUN pip3 --no-cache-dir install six && echo apt-get install\n",
+
+            NULL,
+
+            "FROM centos\n"
+            "RUN yum install -y httpd; dnf install -y nginx && dnf clean all; yum clean all\n"
+            "RUN [\"yum\", \"install\", \"-y\", \"git\"]\n"
+            "RUN pip3 --no-cache-dir install six && echo apt-get install\n"
+        },
+        {
+            "FROM debian:12\n"
+            "RUN apt-get update && apt-get install -y curl\n"
+            "RUN echo 'deb https://example.com stable main' > /etc/apt/sources.list.d/x.list\n"
+            "RUN apt-get update && apt-get install -y xpkg\n"
+            "RUN apt-get remove -y curl\n"
+            "RUN apt install -y jq\n"
+            "FROM debian:12\n"
+            "RUN apt-get update && apt-get install -y git\n",
+
+            NULL,
+
+            "FROM debian:12\n"
+            "RUN apt-get update && apt-get install --no-install-recommends -y curl && rm -rf /var/lib/apt/lists/*\n"
+            "RUN echo 'deb https://example.com stable main' > /etc/apt/sources.list.d/x.list\n"
+            "RUN apt-get update && apt-get install --no-install-recommends -y xpkg\n"
+            "RUN apt-get remove -y curl\n"
+            "RUN apt install --no-install-recommends -y jq && rm -rf /var/lib/apt/lists/*\n"
+            "FROM debian:12\n"
+            "RUN apt-get update && apt-get install --no-install-recommends -y git && rm -rf /var/lib/apt/lists/*\n"
+        },
+        {  0,  0,  0  }
+    };
+
+    opt_ir ir;
+    char *result;
+    size_t size, i;
+    FILE *fp, *report;
+
+    assert((report = fopen("/dev/null", "w")));
+
+    for (i = 0; table[i].src; i++){
+        memset(&ir, 0, sizeof(opt_ir));
+        ir.report = report;
+
+        assert(parse_dockerfile(&ir, table[i].src));
+        apply_hygiene(&ir, table[i].recorded);
+
+        assert((fp = open_memstream(&result, &size)));
+        write_dockerfile(&ir, fp);
+        assert(! fclose(fp));
+
+        assert(! strcmp(result, table[i].result));
+
+        free(result);
+        free_ir(&ir);
+
+        print_progress_test_loop('\0', -1, i);
+        fprintf(stderr, "%.*s\n", ((int) strcspn(table[i].src, "\n")), table[i].src);
+    }
+
+    fclose(report);
+}
+
+
+static void consolidate_installs_test(void){
+    // changeable part for updating test cases
+    const struct {
+        const char * const src;
+        const char * const result;
+    }
+    table[] = {
+        {
+            "FROM debian\n"
+            "RUN apt-get update && apt-get install -y curl\n"
+            "WORKDIR /src\n"
+            "# build\n"
+            "RUN set -eux; \\\n"
+            "    apt-get update; \\\n"
+            "    apt-get install -y make gcc curl; \\\n"
+            "    rm -rf /var/lib/apt/lists/*; \\\n"
+            "    make\n",
+
+            "FROM debian\n"
+            "RUN apt-get update \\\n"
+            "    && apt-get install -y curl gcc make \\\n"
+            "    && rm -rf /var/lib/apt/lists/*\n"
+            "WORKDIR /src\n"
+            "# build\n"
+            "RUN set -eux; \\\n"
+            "    make\n"
+        },
+        {
+            "FROM alpine AS builder\n"
+            "ENV LANG=C\n"
+            "RUN apk add --no-cache git\n"
+            "USER nobody\n"
+            "RUN apk add --no-cache make\n"
+            "FROM alpine\n"
+            "RUN apk add --no-cache gcc\n"
+            "RUN which jq || echo missing\n"
+            "RUN apk add --no-cache jq && apk add --no-cache musl-dev\n",
+
+            "FROM alpine AS builder\n"
+            "ENV LANG=C\n"
+            "RUN apk add --no-cache git\n"
+            "USER nobody\n"
+            "RUN apk add --no-cache make\n"
+            "FROM alpine\n"
+            "RUN apk add --no-cache gcc musl-dev\n"
+            "RUN which jq || echo missing\n"
+            "RUN apk add --no-cache jq\n"
+        },
+        {
+            "FROM debian\n"
+            "RUN apt-get update && apt-get install -y gnupg\n"
+            "RUN apt-key add /tmp/key && apt-get update\n"
+            "RUN apt-get install -y --no-install-recommends nodejs\n"
+            "RUN apt-get install -y yarn\n",
+
+            NULL
+        },
+        {
+            "FROM debian\n"
+            "RUN apt-get update && apt-get install -y curl gnupg\n"
+            "RUN curl -fsSL https://example.com/key | gpg --dearmor -o /usr/share/keyrings/x.gpg \\\n"
+            "    && echo 'deb http://x y main' > /etc/apt/sources.list.d/x.list\n"
+            "RUN apt-get update && apt-get install -y nodejs\n"
+            "RUN apt-get update && apt-get install -y yarn\n"
+            "USER nobody\n"
+            "RUN apt-get update && apt-get install -y git\n",
+
+            "FROM debian\n"
+            "RUN apt-get update && apt-get install -y curl gnupg\n"
+            "RUN curl -fsSL https://example.com/key | gpg --dearmor -o /usr/share/keyrings/x.gpg \\\n"
+            "    && echo 'deb http://x y main' > /etc/apt/sources.list.d/x.list\n"
+            "RUN apt-get update \\\n"
+            "    && apt-get install -y nodejs yarn\n"
+            "USER nobody\n"
+            "RUN apt-get update && apt-get install -y git\n"
+        },
+        {  0,  0  }
+    };
+
+    opt_ir ir;
+    char *result;
+    size_t size, i;
+    FILE *fp, *report;
+
+    assert((report = fopen("/dev/null", "w")));
+
+    for (i = 0; table[i].src; i++){
+        memset(&ir, 0, sizeof(opt_ir));
+        ir.report = report;
+
+        assert(parse_dockerfile(&ir, table[i].src));
+        consolidate_installs(&ir);
+
+        assert((fp = open_memstream(&result, &size)));
+        write_dockerfile(&ir, fp);
+        assert(! fclose(fp));
+
+        assert(! strcmp(result, (table[i].result ? table[i].result : table[i].src)));
+
+        free(result);
+        free_ir(&ir);
+
+        print_progress_test_loop('\0', -1, i);
+        fprintf(stderr, "%.*s\n", ((int) strcspn(table[i].src, "\n")), table[i].src);
+    }
+
+    fclose(report);
+}
+
+
+static void load_reflect_log_test(void){
+    // changeable part for updating test cases
+    const char * const src =
+        "FROM debian\n"
+        "RUN make\n"
+        "RUN make install\n"
+        "RUN make\n";
+
+    const char * const log =
+        "30.000000000 31.500000000 RUN make\n"
+        "10.000000000 11.000000000 RUN make\n"
+        "20.000000000 21.000000000 RUN echo erased\n"
+        "broken line\n"
+        "40.000000000 42.250000000 RUN make install\n"
+        "50.000000000 51.000000000 RUN make\n";
+
+    const struct {
+        const long long start;
+        const char * const line;
+        const size_t instr;
+    }
+    table[] = {
+        { 10, "RUN make",         3        },
+        { 20, "RUN echo erased",  SIZE_MAX },
+        { 30, "RUN make",         1        },
+        { 40, "RUN make install", 2        },
+        { 50, "RUN make",         3        },
+        {  0,  0,                 0        }
+    };
+
+    opt_ir ir = {0};
+    opt_entry *entries;
+    char *contents;
+    size_t i;
+
+    assert(parse_dockerfile(&ir, src));
+    assert((contents = strdup(log)));
+    assert(load_reflect_log(&ir, contents, &entries) == 5);
+
+    for (i = 0; table[i].line; i++){
+        assert(entries[i].start.tv_sec == table[i].start);
+        assert(! strcmp(entries[i].line, table[i].line));
+        assert(entries[i].instr == table[i].instr);
+
+        print_progress_test_loop('\0', -1, i);
+        fprintf(stderr, "%s\n", table[i].line);
+    }
+
+    assert(entries[3].end.tv_nsec == 250000000);
+
+    free(entries);
+    free(contents);
+    free_ir(&ir);
+}
+
+
+static void render_slim_cleanup_test(void){
+    char *libs[] = { "/usr/local/lib/libfoo.a", "/opt/my lib/it's.a" };
+
+    // changeable part for updating test cases
+    const struct {
+        const int category;
+        const unsigned int roots;
+        const char * const keep;
+        const char * const result;
+    }
+    table[] = {
+        { SLIM_DOCS,          (1U << 0) | (1U << 1) | (1U << 5), NULL, "rm -rf /usr/share/doc/* /usr/share/man/*"                        },
+        { SLIM_LOCALES,       (1U << 5) | (1U << 6),             NULL,
+          "find /usr/share/locale /usr/local/share/locale -mindepth 1 -maxdepth 1 -type d ! -name 'en*' -exec rm -rf {} +"          },
+        { SLIM_LOCALES,       (1U << 5),                         "ja",
+          "find /usr/share/locale -mindepth 1 -maxdepth 1 -type d ! -name 'en*' ! -name 'ja*' -exec rm -rf {} +"                    },
+        { SLIM_STATIC_LIBS,   (1U << 13),                        NULL, "rm -f /usr/local/lib/libfoo.a '/opt/my lib/it'\\''s.a'"          },
+        { SLIM_DEBUG_SYMBOLS, (1U << 13),                        NULL, "strip --strip-unneeded /usr/local/lib/libfoo.a"                 },
+        {  -1,                 0,                                NULL,  NULL                                                           }
+    };
+
+    slim_attr attr;
+    char *result;
+    int i;
+
+    for (i = 0; table[i].result; i++){
+        memset(&attr, 0, sizeof(slim_attr));
+        attr.roots = table[i].roots;
+        attr.paths[SLIM_STATIC_LIBS] = libs;
+        attr.paths_num[SLIM_STATIC_LIBS] = 2;
+        attr.paths[SLIM_DEBUG_SYMBOLS] = libs;
+        attr.paths_num[SLIM_DEBUG_SYMBOLS] = 1;
+
+        assert((result = render_slim_cleanup(&attr, table[i].category, table[i].keep)));
+        assert(! strcmp(result, table[i].result));
+        free(result);
+
+        print_progress_test_loop('\0', -1, i);
+        fprintf(stderr, "%s\n", slim_descs[table[i].category]);
+    }
+}
+
+
+
+static void parse_copy_args_test(void){
+    // changeable part for updating test cases
+    const struct {
+        const char * const args;
+        const char * const cwd;
+        const char * const result;
+        const char * const owner;
+    }
+    table[] = {
+        { "app.py /app/",                         "",     "/app",           NULL      },
+        { ". .",                                  "/src", "/src",           NULL      },
+        { "a b ./",                               "/src", "/src",           NULL      },
+        { "--chown=app:app go.mod go.sum ./pkg/", "/src", "/src/pkg",       "app:app" },
+        { "--from=build /out/bin /usr/local/bin", "",     "/usr/local/bin", NULL      },
+        { "[\"my app\", \"/opt/my app/\"]",       "/",    "/opt/my app",    NULL      },
+        { "--chmod=755 [\"run.sh\", \"bin/\"]",   "/app", "/app/bin",       NULL      },
+        { "--link src /src",                      "/",    NULL,             NULL      },
+        { "--link=false src /src",                "/",    NULL,             NULL      },
+        { "app.py app/",                          "",     NULL,             NULL      },
+        { "app.py ${APP_HOME}",                   "/",    NULL,             NULL      },
+        { "<<EOF /etc/motd",                      "/",    NULL,             NULL      },
+        { "--chown=app /app",                     "/",    NULL,             "app"     },
+        { "[\"app.py\"]",                         "/",    NULL,             NULL      },
+        {  NULL,                                   NULL,   NULL,             NULL      }
+    };
+
+    char dest[PATH_MAX];
+    const char *owner;
+    int i;
+
+    for (i = 0; table[i].args; i++){
+        if (table[i].result){
+            assert(! parse_copy_args(table[i].args, table[i].cwd, dest, &owner));
+            assert(! strcmp(dest, table[i].result));
+        }
+        else
+            assert(parse_copy_args(table[i].args, table[i].cwd, dest, &owner));
+
+        if (table[i].owner){
+            assert(owner && (strcspn(owner, " \t") == strlen(table[i].owner)));
+            assert(! strncmp(owner, table[i].owner, strlen(table[i].owner)));
+        }
+        else
+            assert(! owner);
+
+        print_progress_test_loop('\0', -1, i);
+        fprintf(stderr, "%s\n", table[i].args);
+    }
+}
+
+
+static void resolve_mentioned_path_test(void){
+    // changeable part for updating test cases
+    const struct {
+        const char * const word;
+        const char * const cwd;
+        const char * const result;
+    }
+    table[] = {
+        { "/usr/local/bin/foo",        "/",        "/usr/local/bin/foo" },
+        { "/opt/foo/",                 "/",        "/opt/foo"           },
+        { "foo-1.2",                   "/src",     "/src/foo-1.2"       },
+        { "./build/.",                 "/src/foo", "/src/foo/build"     },
+        { "tmp",                       "/",        "/tmp"               },
+        { "--prefix=/opt/foo",         "/src",     "/opt/foo"           },
+        { "\"/opt/tool b/bin\"",       "/",        "/opt/tool b/bin"    },
+        { "'/opt/foo/'*",              "/",        "/opt/foo"           },
+        { "/src/foo/*.tar.gz",         "/",        "/src/foo"           },
+        { "-j4",                       "/src",     NULL                 },
+        { "CC=gcc",                    "/src",     NULL                 },
+        { "$HOME/foo",                 "/src",     NULL                 },
+        { "*",                         "/src",     NULL                 },
+        {  NULL,                        NULL,      NULL                 }
+    };
+
+    char path[PATH_MAX];
+    int i;
+
+    for (i = 0; table[i].word; i++){
+        if (table[i].result){
+            assert(resolve_mentioned_path(table[i].word, table[i].cwd, path));
+            assert(! strcmp(path, table[i].result));
+        }
+        else
+            assert(! resolve_mentioned_path(table[i].word, table[i].cwd, path));
+
+        print_progress_test_loop('\0', -1, i);
+        fprintf(stderr, "%s\n", table[i].word);
+    }
+}
+
+
+static void parse_size_test(void){
+    // changeable part for updating test cases
+    const struct {
+        const char * const target;
+        const off_t result;
+    }
+    table[] = {
+        { "0",        0                         },
+        { "1500",     1500                      },
+        { "512B",     512                       },
+        { "300MB",    300000000                 },
+        { "1.5G",     1500000000                },
+        { "2g",       2000000000                },
+        { "64KiB",    65536                     },
+        { "1.5Mi",    1572864                   },
+        { ".5kb",     500                       },
+        { "1T",       1000000000000             },
+        { "",         -1                        },
+        { "MB",       -1                        },
+        { "1.5.0G",   -1                        },
+        { "12 MB",    -1                        },
+        { "-5M",      -1                        },
+        { "10X",      -1                        },
+        { "9999P",    -1                        },
+        {  NULL,       0                        }
+    };
+
+    int i;
+
+    for (i = 0; table[i].target; i++){
+        assert(parse_size(table[i].target) == table[i].result);
+
+        print_progress_test_loop('\0', -1, i);
+        fprintf(stderr, "'%s'\n", table[i].target);
+    }
 }
 
 
-#endif // NDEBUG
\ No newline at end of file
+#endif // NDEBUG
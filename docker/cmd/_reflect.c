@@ -9,6 +9,8 @@
  *
  * @note In the provisional report file, two provisional numbers of reflected lines are stored.
  * @note In the conclusive report file, the text to show on prompt the number of reflected lines is stored.
+ * @note In the reflect log, each line reflected in Dockerfile is stored with when its command line ran.
+ * @note The provisional report is also locked by 'flock' while editing the target files, as libdit does.
  */
 
 #include "main.h"
@@ -18,6 +20,10 @@
 #define REFLECT_FILE_P "/dit/srv/reflect-report.prov"
 #define REFLECT_FILE_R "/dit/srv/reflect-report.real"
 
+#define COMMAND_START_FILE "/dit/srv/command-start"
+
+#define REFLECT_TAIL_CHUNK 4096
+
 #define update_provisional_report(reflecteds)  manage_provisional_report(reflecteds, "r+w\0")
 #define reset_provisional_report(reflecteds)  manage_provisional_report(reflecteds, "r\0w\0")
 
@@ -54,6 +60,9 @@ static const char *check_dockerfile_instr(char *target);
 static size_t read_dockerfile_base(char **p_start);
 
 static int record_reflected_lines(void);
+static int log_reflected_lines(int lines_num);
+static char *read_last_lines(const char *file_name, int lines_num, size_t *p_size);
+static void format_remaining_budget(char *buf, size_t size, off_t remaining, bool stale);
 static int manage_provisional_report(int reflecteds[2], const char *mode);
 
 
@@ -68,6 +77,11 @@ extern const char * const target_args[ARGS_NUM];
 static bool no_suggestion = false;
 
 
+/** file descriptor holding the lock of the provisional report, and the number of nested locks */
+static int report_lock_fd = -1;
+static int report_lock_depth = 0;
+
+
 /** whether this command found a CMD/ENTRYPOINT instruction in the lines to be reflected in Dockerfile */
 static bool first_cmd = true;
 static bool first_entrypoint = true;
@@ -224,6 +238,8 @@ static int do_reflect(int argc, char **argv, const refl_opts *opt){
     if (argc < 0)
         argc = 0;
 
+    lock_provisional_report();
+
     do
         if (opt->target_c != "dh"[--offset]){
             data.target_id = offset;
@@ -243,6 +259,7 @@ static int do_reflect(int argc, char **argv, const refl_opts *opt){
     if (update_provisional_report(data.reflecteds))
         exit_status = UNEXPECTED_ERROR;
 
+    unlock_provisional_report();
     return exit_status;
 }
 
@@ -278,11 +295,13 @@ int reflect_to_dockerfile(size_t lines_num, char *lines, bool verbose, int instr
         .verbose = verbose
     };
 
+    lock_provisional_report();
     exit_status = reflect_lines(&data, &opt);
 
     if (update_provisional_report(data.reflecteds) && (exit_status >= 0))
         exit_status = UNEXPECTED_ERROR - exit_status;
 
+    unlock_provisional_report();
     return exit_status;
 }
 
@@ -409,8 +428,10 @@ static int reflect_lines(refl_data *data, const refl_opts *opt){
     const char *dest_file;
     int file_size, exit_status = SUCCESS;
     char *seq = NULL;
+    trace_scope scope;
 
     dest_file = target_files[data->target_id];
+    trace_begin(&scope, TRACE_REFLECT_LINES, dest_file);
 
     if ((file_size = get_file_size(dest_file)) != -2){
         if (data->lines_num){
@@ -510,6 +531,7 @@ exit:
     if (seq)
         free(seq);
 
+    trace_end(&scope);
     return exit_status;
 }
 
@@ -605,22 +627,38 @@ static size_t read_dockerfile_base(char **p_start){
  * @return int  0 (success) or -1 (unexpected error)
  *
  * @note some functions detect errors when initializing each file, but they are ignored.
+ * @note if the size budget has been checked, the prompt also shows the budget remaining as of the check.
  */
 static int record_reflected_lines(void){
     bool first_access;
     int exit_status, reflecteds[2] = {0};
+    trace_scope scope;
 
+    trace_begin(&scope, TRACE_RECORD_REFLECTED_LINES, NULL);
     first_access = (! get_file_size(DIT_PROFILE));
+
+    lock_provisional_report();
     exit_status = reset_provisional_report(reflecteds);
 
     if ((reflecteds[1] || reflecteds[0] || first_access) && update_erase_logs(reflecteds))
         exit_status = UNEXPECTED_ERROR;
 
+    unlock_provisional_report();
+
+    if ((reflecteds[1] > 0) && (! first_access) && log_reflected_lines(reflecteds[1]))
+        exit_status = UNEXPECTED_ERROR;
+
     if (first_access)
         exit_status = SUCCESS;
 
     FILE *fp;
     int code;
+    char budget_repr[32] = "";
+    off_t remaining;
+    bool stale;
+
+    if (get_remaining_budget(&remaining, &stale))
+        format_remaining_budget(budget_repr, sizeof(budget_repr), remaining, stale);
 
     if ((fp = fopen(REFLECT_FILE_R, "w"))){
         code = 31;  // red
@@ -629,18 +667,179 @@ static int record_reflected_lines(void){
             code++;  // grean
 
         fprintf(
-            fp, CC(" [") "d:+%hu h:+%hu" CC("] ") "\\u:\\w " CC("\\$ "),
-            code, reflecteds[1], reflecteds[0], code, code
+            fp, CC(" [") "d:+%hu h:+%hu%s" CC("] ") "\\u:\\w " CC("\\$ "),
+            code, reflecteds[1], reflecteds[0], budget_repr, code, code
         );
         fclose(fp);
     }
     else
         exit_status = UNEXPECTED_ERROR;
 
+    trace_end(&scope);
     return exit_status;
 }
 
 
+/**
+ * @brief append the lines just reflected in Dockerfile to the reflect log.
+ *
+ * @param[in]  lines_num  the number of the lines
+ * @return int  0 (success) or -1 (unexpected error)
+ *
+ * @note each entry consists of when the command line started and ended, and the reflected line.
+ * @note the start is the time the prompt stamped on the file just before executing the command line.
+ * @note the empty lines and comments are not logged, and nothing is logged without the valid stamp.
+ * @note only the end of Dockerfile is read, since this function runs on every prompt.
+ */
+static int log_reflected_lines(int lines_num){
+    assert(lines_num > 0);
+
+    struct stat file_stat;
+    struct timespec end;
+    char *tail, *line, *next;
+    size_t size, i;
+    int exit_status = SUCCESS;
+    FILE *fp;
+
+    if (stat(COMMAND_START_FILE, &file_stat) || clock_gettime(CLOCK_REALTIME, &end))
+        return exit_status;
+
+    if ((file_stat.st_mtim.tv_sec > end.tv_sec) ||
+        ((file_stat.st_mtim.tv_sec == end.tv_sec) && (file_stat.st_mtim.tv_nsec > end.tv_nsec)))
+        return exit_status;
+
+    if (! (tail = read_last_lines(DOCKER_FILE_DRAFT, lines_num, &size)))
+        return UNEXPECTED_ERROR;
+
+    if ((fp = fopen(REFLECT_LOG_FILE, "a"))){
+        for (line = tail; line < (tail + size); line = next){
+            next = strchr(line, '\n');
+            *(next++) = '\0';
+            i = strspn(line, " \t");
+
+            if (line[i] && (line[i] != '#'))
+                fprintf(
+                    fp, "%lld.%09ld %lld.%09ld %s\n",
+                    ((long long) file_stat.st_mtim.tv_sec), file_stat.st_mtim.tv_nsec,
+                    ((long long) end.tv_sec), end.tv_nsec, line
+                );
+        }
+
+        if (fclose(fp))
+            exit_status = UNEXPECTED_ERROR;
+    }
+    else
+        exit_status = UNEXPECTED_ERROR;
+
+    free(tail);
+    return exit_status;
+}
+
+
+/**
+ * @brief read the last lines of the file, without reading the lines before them.
+ *
+ * @param[in]  file_name  target file name
+ * @param[in]  lines_num  the number of the lines
+ * @param[out] p_size  variable to store the size of the lines
+ * @return char*  the null-terminated lines, each of which ends with a newline, or NULL
+ *
+ * @note the file is read backward in chunks whose size doubles, until the lines are found or the file is exhausted.
+ * @note a missing newline at the end of the file is supplied.
+ * @attention the return value must be released by the caller.
+ */
+static char *read_last_lines(const char *file_name, int lines_num, size_t *p_size){
+    assert(file_name);
+    assert(lines_num > 0);
+    assert(p_size);
+
+    int fd, found;
+    struct stat file_stat;
+    char *buf = NULL, *tmp;
+    size_t size, len = 0, i;
+
+    if ((fd = open(file_name, (O_RDONLY | O_CLOEXEC))) == -1)
+        return NULL;
+
+    if (fstat(fd, &file_stat))
+        goto exit;
+
+    size = file_stat.st_size;
+
+    do {
+        len = len ? (len * 2) : REFLECT_TAIL_CHUNK;
+
+        if (len > size)
+            len = size;
+
+        if (! (tmp = (char *) realloc(buf, (sizeof(char) * (len + 2))))){
+            free(buf);
+            buf = NULL;
+            goto exit;
+        }
+        buf = tmp;
+
+        if (len && (pread(fd, buf, len, (size - len)) != ((ssize_t) len))){
+            free(buf);
+            buf = NULL;
+            goto exit;
+        }
+
+        // the newline that ends the last line does not separate it from the next one
+        i = (len && (buf[len - 1] == '\n')) ? (len - 1) : len;
+
+        for (found = 0; i; i--)
+            if ((buf[i - 1] == '\n') && (++found == lines_num))
+                break;
+    } while ((! i) && (len < size));
+
+    if (len && (buf[len - 1] != '\n'))
+        buf[len++] = '\n';
+    buf[len] = '\0';
+
+    if (i)
+        memmove(buf, (buf + i), (sizeof(char) * (len - i + 1)));
+    *p_size = len - i;
+
+exit:
+    close(fd);
+    return buf;
+}
+
+
+/**
+ * @brief format the remaining budget to be shown in the prompt.
+ *
+ * @param[out] buf  buffer for storing the resulting string
+ * @param[in]  size  the size of the buffer
+ * @param[in]  remaining  the remaining budget in bytes, which is negative if exceeded
+ * @param[in]  stale  whether any line has been reflected since the budget was last checked
+ *
+ * @note the budget is shortened to one decimal place with the prefix of the unit, as in ' b:812.4M'.
+ * @note the stale budget is marked with a tilde, as in ' b:~812.4M'.
+ */
+static void format_remaining_budget(char *buf, size_t size, off_t remaining, bool stale){
+    assert(buf);
+    assert(size);
+
+    int i = 0;
+    lldiv_t tmp = { .quot = llabs(remaining), .rem = 0 };
+
+    while ((tmp.quot >= 1000) && (i < 6)){
+        i++;
+        tmp = lldiv(tmp.quot, 1000);
+    }
+
+    if (i)
+        snprintf(
+            buf, size, " b:%s%s%lld.%lld%c",
+            (stale ? "~" : ""), ((remaining < 0) ? "-" : ""), tmp.quot, (tmp.rem / 100), " kMGTPE"[i]
+        );
+    else
+        snprintf(buf, size, " b:%s%lld", (stale ? "~" : ""), ((long long) remaining));
+}
+
+
 
 
 /**
@@ -686,7 +885,7 @@ static int manage_provisional_report(int reflecteds[2], const char *mode){
 
         if (fp){
             if (mode_c == 'r'){
-                if (fread(array_for_read, sizeof(int), 2, fp) == 2){
+                if (! dit_read_report(fp, array_for_read)){
                     for (i = 0; i < 2; i++){
                         j = reflecteds[i] + array_for_read[i];
 
@@ -699,8 +898,8 @@ static int manage_provisional_report(int reflecteds[2], const char *mode){
                 else
                     exit_status = UNEXPECTED_ERROR;
             }
-            else
-                fwrite(array_for_write, sizeof(int), 2, fp);
+            else if (dit_write_report(fp, array_for_write))
+                exit_status = UNEXPECTED_ERROR;
 
             if (! keep_c){
                 fclose(fp);
@@ -751,6 +950,67 @@ int write_provisional_report(int reflecteds[2]){
 }
 
 
+/**
+ * @brief read the provisional number of reflected lines apart from the file handler kept by 'read_provisional_report'.
+ *
+ * @param[out] reflecteds  array of length 2 for storing the provisional number of reflected lines
+ * @return int  0 (success) or -1 (unexpected error)
+ *
+ * @note used to find whether another process has edited the target files since they were read.
+ */
+int peek_provisional_report(int reflecteds[2]){
+    assert(reflecteds);
+
+    FILE *fp;
+    int exit_status = UNEXPECTED_ERROR;
+
+    if ((fp = fopen(REFLECT_FILE_P, "rb"))){
+        if (! dit_read_report(fp, reflecteds))
+            exit_status = SUCCESS;
+        fclose(fp);
+    }
+    return exit_status;
+}
+
+
+/**
+ * @brief lock the provisional report, so that no other process edits the target files at the same time.
+ *
+ * @return int  0 (success) or -1 (unexpected error)
+ *
+ * @note the lock is the same 'flock' that libdit takes, so the commands and the hosts of libdit exclude each other.
+ * @note the calls can be nested, and the lock is held until the outermost call is paired with the unlock.
+ * @note if the lock cannot be taken, the processing goes on without it, as it did before the lock existed.
+ * @attention each call must be paired with 'unlock_provisional_report'.
+ */
+int lock_provisional_report(void){
+    if (report_lock_depth++)
+        return SUCCESS;
+
+    if ((report_lock_fd = open(REFLECT_FILE_P, (O_RDONLY | O_CLOEXEC))) != -1){
+        if (! flock(report_lock_fd, LOCK_EX))
+            return SUCCESS;
+
+        close(report_lock_fd);
+        report_lock_fd = -1;
+    }
+    return UNEXPECTED_ERROR;
+}
+
+
+/**
+ * @brief unlock the provisional report locked by 'lock_provisional_report'.
+ */
+void unlock_provisional_report(void){
+    assert(report_lock_depth > 0);
+
+    if ((! --report_lock_depth) && (report_lock_fd != -1)){
+        close(report_lock_fd);
+        report_lock_fd = -1;
+    }
+}
+
+
 
 
 #ifndef NDEBUG
@@ -761,8 +1021,75 @@ int write_provisional_report(int reflecteds[2]){
 ******************************************************************************/
 
 
+static void read_last_lines_test(void);
+
+
+
+
 void reflect_test(void){
-    fputs("reflect test\n", stdout);
+    do_test(read_last_lines_test);
+}
+
+
+
+
+static void read_last_lines_test(void){
+    const struct {
+        const char * const contents;
+        const int lines_num;
+        const char * const result;
+    }
+    // changeable part for updating test cases
+    table[] = {
+        { "a\nb\nc\n",       1,  "c\n"          },
+        { "a\nb\nc\n",       2,  "b\nc\n"       },
+        { "a\nb\nc",          2,  "b\nc\n"       },
+        { "a\nb\nc\n",       5,  "a\nb\nc\n"    },
+        { "\n\nx\n",         2,  "\nx\n"        },
+        { "",                 1,  ""            },
+        {  0,                 0,   0            }
+    };
+
+    char *lines, *contents;
+    size_t size, i, len;
+    FILE *fp;
+
+    for (i = 0; table[i].contents; i++){
+        assert((fp = fopen(TMP_FILE1, "w")));
+        assert(fputs(table[i].contents, fp) != EOF);
+        assert(! fclose(fp));
+
+        assert((lines = read_last_lines(TMP_FILE1, table[i].lines_num, &size)));
+        assert(size == strlen(table[i].result));
+        assert(! strcmp(lines, table[i].result));
+        free(lines);
+
+        print_progress_test_loop('\0', '\0', i);
+        fprintf(stderr, "%zu bytes from the last %d lines\n", size, table[i].lines_num);
+    }
+
+    // longer than several chunks, so that the file is read backward more than once
+    len = REFLECT_TAIL_CHUNK * 5;
+    assert((contents = (char *) malloc(sizeof(char) * (len + 1))));
+    memset(contents, 'x', len);
+    contents[REFLECT_TAIL_CHUNK] = '\n';
+    contents[len - 1] = '\n';
+    contents[len] = '\0';
+
+    assert((fp = fopen(TMP_FILE1, "w")));
+    assert(fputs(contents, fp) != EOF);
+    assert(! fclose(fp));
+
+    assert((lines = read_last_lines(TMP_FILE1, 1, &size)));
+    assert(size == (len - REFLECT_TAIL_CHUNK - 1));
+    assert(! strcmp(lines, (contents + REFLECT_TAIL_CHUNK + 1)));
+    free(lines);
+
+    print_progress_test_loop('\0', '\0', i);
+    fprintf(stderr, "%zu bytes from the last line\n", size);
+
+    free(contents);
+    assert(! unlink(TMP_FILE1));
 }
 
 
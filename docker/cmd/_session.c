@@ -0,0 +1,1617 @@
+/**
+ * @file _session.c
+ *
+ * Copyright (c) 2023 Tsukasa Inada
+ *
+ * @brief Described the dit command 'session', that saves and restores the filesystem under construction.
+ * @author Tsukasa Inada
+ * @date 2023/10/17
+ *
+ * @note The files changed since the container started are detected by their ctime, as a snapshot diff.
+ * @note The start of the container is the ctime of '/dit/srv', whose permissions 'dit init' resets every time.
+ * @note The checkpoint is a stream of entries, each consisting of a fixed-size header, the path and the data.
+ * @note On resume, only the command lines appended to history-file after the checkpoint are replayed.
+ */
+
+#include "main.h"
+
+#define CHECKPOINT_FILE "/dit/mnt/.dit_checkpoint"
+#define CHECKPOINT_TMP_FILE "/dit/mnt/.dit_checkpoint.tmp"
+#define HISTORY_FILE "/dit/mnt/.dit_history"
+#define STARTUP_REFERENCE "/dit/srv"
+
+#define CKPT_MAGIC 0x504b4344
+#define CKPT_VERSION 1
+
+#define CKPT_ENVIRON_MAX 0x100000
+#define CKPT_LISTING_MAX 0x4000000
+#define CKPT_SENDFILE_MAX 0x7ffff000
+
+#define SESSION_SUBCMDS_NUM 2
+
+#define later_timespec(a, b)  (((a).tv_sec > (b).tv_sec) || (((a).tv_sec == (b).tv_sec) && ((a).tv_nsec > (b).tv_nsec)))
+
+
+/** Data type for the header at the beginning of the checkpoint, followed by the environment variables */
+typedef struct {
+    uint32_t magic;           /** 'CKPT_MAGIC' */
+    uint32_t version;         /** 'CKPT_VERSION' */
+    uint64_t history_size;    /** the number of bytes of history-file whose effects the checkpoint contains */
+    uint64_t history_hash;    /** the hash value of those bytes */
+    uint64_t environ_size;    /** the total size of the null-terminated environment variables */
+} ckpt_header;
+
+
+/** Data type for the header of each file in the checkpoint, followed by its path and data */
+typedef struct {
+    int64_t mtime_sec;        /** the modification time in seconds */
+    int64_t mtime_nsec;       /** the fractional part of the modification time in nanoseconds */
+    uint64_t data_size;       /** the size of the contents, the link target or the list of the entry names */
+    uint32_t path_len;        /** the length of the absolute path, where 0 marks the end of the checkpoint */
+    uint32_t mode;            /** the file type and permissions */
+    uint32_t uid;             /** the user ID of the owner */
+    uint32_t gid;             /** the group ID of the owner */
+} ckpt_entry;
+
+
+/** Data type for storing the state while writing or extracting the checkpoint */
+typedef struct {
+    int fd;                        /** file descriptor for the checkpoint */
+    off_t offset;                  /** the offset of the next entry, when extracting */
+    struct timespec since;         /** the time the container started */
+    dev_t dev;                     /** the device of the root directory, beyond which the walk does not go */
+    size_t files_num;              /** the number of files written or extracted */
+    uint64_t bytes;                /** the number of bytes of their contents */
+    char path[PATH_MAX];           /** the path of the file we are currently looking at */
+    size_t path_len;               /** the length of the path */
+    int root_fd;                   /** file descriptor for the directory under which the entries are extracted */
+} ckpt_state;
+
+
+/** Data type for storing the modification time of a directory, restored after its contents */
+typedef struct {
+    char *path;                    /** the path of the directory */
+    struct timespec mtime;         /** its modification time */
+} ckpt_dir_time;
+
+
+static int parse_opts(int argc, char **argv);
+static int do_checkpoint(void);
+static int do_resume(void);
+
+static bool get_startup_time(struct timespec *p_since);
+static char *read_history(size_t *p_size);
+static uint64_t hash_bytes(const char *data, size_t size);
+static bool check_if_verified(int fd);
+
+static bool write_checkpoint(ckpt_state *state, const char *root, const char *history, size_t history_size);
+static bool write_environ(int fd, uint64_t *p_size);
+static bool archive_tree(ckpt_state *state, int pwdfd, const char *name);
+static bool archive_entry(ckpt_state *state, const struct stat *file_stat, const char *data, int data_fd);
+
+static bool extract_checkpoint(ckpt_state *state, const char *root);
+static bool extract_entry(
+    ckpt_state *state, int dir_fd, const char *name, const ckpt_entry *entry, const char *data, ckpt_dir_time *dir_time
+);
+static bool prune_dir(ckpt_state *state, int fd, const char *listing, size_t size);
+static bool check_extractable_path(const char *path, const char *root);
+static int open_parent_dir(int root_fd, const char *root, char *path, const char **p_name);
+static bool check_if_excluded(const char *dir_path, const char *name);
+
+static void write_replay(FILE *fp, const char *env, size_t env_size, const char *rest, size_t rest_size);
+static bool check_if_restorable_env(const char *env);
+static void fprint_quoted(FILE *fp, const char *str, size_t size);
+
+static bool write_all(int fd, const void *buf, size_t size);
+static bool read_all_at(int fd, void *buf, size_t size, off_t offset);
+static uint64_t copy_data(int out_fd, int in_fd, off_t *p_offset, uint64_t size);
+
+
+/** array of strings representing each subcommand in alphabetical order */
+static const char * const subcmd_reprs[SESSION_SUBCMDS_NUM] = {
+    "checkpoint",
+    "resume"
+};
+
+/** array of the names of the environment variables that belong to each container or shell */
+static const char * const volatile_envs[] = {
+    "ENV",
+    "HOME",
+    "HOSTNAME",
+    "OLDPWD",
+    "PROMPT_COMMAND",
+    "PS1",
+    "SHLVL",
+    "TERM",
+    "USER",
+    "_"
+};
+
+
+/** the directory under which the files are checkpointed */
+static const char *session_root = "/";
+
+/** the directory excluded from the checkpoint, since it holds the internal files of this tool */
+static const char *session_excluded = "/dit";
+
+
+
+
+/******************************************************************************
+    * Local Main Interface
+******************************************************************************/
+
+
+/**
+ * @brief save or restore the filesystem under construction.
+ *
+ * @param[in]  argc  the number of command line arguments
+ * @param[out] argv  array of strings that are command line arguments
+ * @return int  command's exit status
+ *
+ * @note treated like a normal main function.
+ */
+int session(int argc, char **argv){
+    int i, exit_status = FAILURE;
+
+    if (! (i = parse_opts(argc, argv))){
+        argc -= optind;
+        argv += optind;
+
+        if (argc <= 0)
+            xperror_missing_args("subcommand");
+        else if (argc > 1)
+            xperror_too_many_args(1);
+        else if ((i = receive_expected_string(*argv, subcmd_reprs, SESSION_SUBCMDS_NUM, 2)) < 0){
+            xperror_invalid_arg('C', i, "subcommand", *argv);
+            xperror_valid_args(subcmd_reprs, SESSION_SUBCMDS_NUM);
+        }
+        else
+            exit_status = i ? do_resume() : do_checkpoint();
+    }
+    else if (i > 0)
+        exit_status = SUCCESS;
+
+    if (exit_status){
+        if (exit_status < 0){
+            exit_status = FAILURE;
+            xperror_internal_file();
+        }
+        xperror_suggestion(true);
+    }
+    return exit_status;
+}
+
+
+/**
+ * @brief parse optional arguments.
+ *
+ * @param[in]  argc  the number of command line arguments
+ * @param[out] argv  array of strings that are command line arguments
+ * @return int  0 (parse success), 1 (normally exit) or -1 (error exit)
+ *
+ * @note the arguments are expected to be passed as-is from main function.
+ */
+static int parse_opts(int argc, char **argv){
+    const char *short_opts = "";
+
+    const struct option long_opts[] = {
+        { "help", no_argument, NULL, 1 },
+        {  0,      0,           0,   0 }
+    };
+
+    int c;
+
+    while ((c = getopt_long(argc, argv, short_opts, long_opts, NULL)) >= 0)
+        switch (c){
+            case 1:
+                session_manual();
+                return NORMALLY_EXIT;
+            default:
+                return ERROR_EXIT;
+        }
+
+    return SUCCESS;
+}
+
+
+
+
+/**
+ * @brief save the files changed since the container started, along with the state of history-file.
+ *
+ * @return int  0 (success), 1 (permission error) or -1 (unexpected error)
+ *
+ * @note the checkpoint is written to a temporary file, and replaces the previous one only when completed.
+ * @note the temporary file is created anew with permissions 0600, since it contains the files only root can read.
+ *
+ * @attention this function must be called by root, since it reads every file regardless of the permissions.
+ */
+static int do_checkpoint(void){
+    ckpt_state *state;
+    char *history;
+    size_t history_size = 0, lines_num = 0, i;
+    int exit_status = UNEXPECTED_ERROR;
+
+    if (getuid()){
+        xperror_individually("only root can write the checkpoint");
+        return POSSIBLE_ERROR;
+    }
+
+    if (! (state = (ckpt_state *) malloc(sizeof(ckpt_state))))
+        return exit_status;
+
+    if (get_startup_time(&(state->since)) && (history = read_history(&history_size))){
+        for (i = 0; i < history_size; i++)
+            if (history[i] == '\n')
+                lines_num++;
+
+        if (unlink(CHECKPOINT_TMP_FILE) && (errno != ENOENT))
+            state->fd = -1;
+        else
+            state->fd = open(CHECKPOINT_TMP_FILE, (O_WRONLY | O_CREAT | O_EXCL | O_NOFOLLOW | O_CLOEXEC), 0600);
+
+        if (state->fd != -1){
+            if (write_checkpoint(state, session_root, history, history_size)){
+                if (! close(state->fd))
+                    exit_status = SUCCESS;
+            }
+            else
+                close(state->fd);
+
+            if (exit_status || rename(CHECKPOINT_TMP_FILE, CHECKPOINT_FILE)){
+                exit_status = UNEXPECTED_ERROR;
+                unlink(CHECKPOINT_TMP_FILE);
+            }
+            else
+                printf("Checkpointed %zu files of %" PRIu64 " bytes, covering %zu lines of history-file.\n",
+                    state->files_num, state->bytes, lines_num);
+        }
+
+        free(history);
+    }
+
+    free(state);
+    return exit_status;
+}
+
+
+/**
+ * @brief restore the files from the checkpoint, and print the command lines that remain to be replayed.
+ *
+ * @return int  0 (success), 1 (permission error) or -1 (unexpected error)
+ *
+ * @note if no valid checkpoint is found, all the command lines in history-file are printed.
+ * @note the checkpoint is ignored if the lines it covers have since been deleted from history-file.
+ * @note the exported variables and the working directory at the time of the checkpoint are restored first.
+ * @note unless the checkpoint is verified to have been written by root, it is ignored like an invalid one,
+ *   since anyone who can write to the shared directory can replace it.
+ *
+ * @attention this function must be called by root, after 'dit init' when the container starts.
+ */
+static int do_resume(void){
+    ckpt_state *state;
+    ckpt_header header;
+    char *history, *env = NULL;
+    size_t history_size = 0, offset = 0, env_size = 0;
+    int exit_status = UNEXPECTED_ERROR;
+
+    if (getuid()){
+        xperror_standards(NULL, EPERM);
+        return POSSIBLE_ERROR;
+    }
+
+    if (! (state = (ckpt_state *) malloc(sizeof(ckpt_state))))
+        return exit_status;
+
+    if ((history = read_history(&history_size))){
+        exit_status = SUCCESS;
+
+        if ((state->fd = open(CHECKPOINT_FILE, (O_RDONLY | O_NOFOLLOW | O_NONBLOCK | O_CLOEXEC))) != -1){
+            if (! check_if_verified(state->fd))
+                xperror_message("not written by root, so ignored", "checkpoint");
+            else if (read_all_at(state->fd, &header, sizeof(header), 0) &&
+                (header.magic == CKPT_MAGIC) && (header.version == CKPT_VERSION) &&
+                (header.environ_size <= CKPT_ENVIRON_MAX))
+            {
+                if ((header.history_size <= history_size) &&
+                    (hash_bytes(history, header.history_size) == header.history_hash))
+                {
+                    exit_status = UNEXPECTED_ERROR;
+                    env_size = header.environ_size;
+                    state->offset = sizeof(header) + env_size;
+
+                    if ((env = (char *) malloc(sizeof(char) * (env_size + 1))) &&
+                        read_all_at(state->fd, env, env_size, sizeof(header)) &&
+                        get_startup_time(&(state->since)) && extract_checkpoint(state, session_root))
+                    {
+                        exit_status = SUCCESS;
+                        offset = header.history_size;
+
+                        fprintf(stderr, "Restored %zu files of %" PRIu64 " bytes from the checkpoint.\n",
+                            state->files_num, state->bytes);
+                    }
+                    else
+                        env_size = 0;
+                }
+                else
+                    xperror_message("not matching the contents of history-file, so ignored", "checkpoint");
+            }
+            else if (get_file_size(CHECKPOINT_FILE))
+                xperror_message("invalid format, so ignored", "checkpoint");
+
+            close(state->fd);
+        }
+
+        write_replay(stdout, env, env_size, (history + offset), (history_size - offset));
+
+        if (env)
+            free(env);
+        free(history);
+    }
+
+    free(state);
+    return exit_status;
+}
+
+
+
+
+/**
+ * @brief get the time when the container started.
+ *
+ * @param[out] p_since  variable to store the time
+ * @return bool  successful or not
+ */
+static bool get_startup_time(struct timespec *p_since){
+    assert(p_since);
+
+    struct stat file_stat;
+
+    if (stat(STARTUP_REFERENCE, &file_stat))
+        return false;
+
+    *p_since = file_stat.st_ctim;
+    return true;
+}
+
+
+/**
+ * @brief read the whole contents of history-file.
+ *
+ * @param[out] p_size  variable to store the size of the contents that end with a newline
+ * @return char*  the null-terminated contents or NULL
+ *
+ * @note a missing history-file is treated as an empty one.
+ * @attention the return value must be released by the caller.
+ */
+static char *read_history(size_t *p_size){
+    assert(p_size);
+
+    int fd;
+    struct stat file_stat;
+    char *history = NULL;
+    size_t size = 0;
+
+    if ((fd = open(HISTORY_FILE, (O_RDONLY | O_CLOEXEC))) != -1){
+        if ((! fstat(fd, &file_stat)) && (history = (char *) malloc(sizeof(char) * (file_stat.st_size + 1)))){
+            size = file_stat.st_size;
+
+            if (! read_all_at(fd, history, size, 0)){
+                free(history);
+                history = NULL;
+            }
+        }
+        close(fd);
+    }
+    else if ((errno == ENOENT) && (history = (char *) malloc(sizeof(char))))
+        size = 0;
+
+    if (history){
+        // the last line being written is not yet a complete command line
+        while (size && (history[size - 1] != '\n'))
+            size--;
+
+        history[size] = '\0';
+        *p_size = size;
+    }
+
+    return history;
+}
+
+
+/**
+ * @brief check whether the checkpoint can be trusted as the one written by 'dit session checkpoint'.
+ *
+ * @param[in]  fd  file descriptor for the checkpoint
+ * @return bool  the resulting boolean
+ *
+ * @note it must be a regular file owned by root, with a single link, that no one else can write to.
+ */
+static bool check_if_verified(int fd){
+    assert(fd >= 0);
+
+    struct stat file_stat;
+
+    return (! fstat(fd, &file_stat)) && S_ISREG(file_stat.st_mode) && (! file_stat.st_uid) &&
+        (file_stat.st_nlink == 1) && (! (file_stat.st_mode & (S_IWGRP | S_IWOTH)));
+}
+
+
+/**
+ * @brief calculate the FNV-1a hash value of the bytes.
+ *
+ * @param[in]  data  the bytes
+ * @param[in]  size  the number of bytes
+ * @return uint64_t  the hash value
+ */
+static uint64_t hash_bytes(const char *data, size_t size){
+    assert(data || (! size));
+
+    uint64_t hash = 14695981039346656037ULL;
+
+    while (size--)
+        hash = (hash ^ ((unsigned char) *(data++))) * 1099511628211ULL;
+
+    return hash;
+}
+
+
+
+
+/******************************************************************************
+    * Checkpoint Part
+******************************************************************************/
+
+
+/**
+ * @brief write the checkpoint of the files under the root directory.
+ *
+ * @param[out] state  variable to store the state while writing the checkpoint
+ * @param[in]  root  the root directory
+ * @param[in]  history  the contents of history-file
+ * @param[in]  history_size  the size of the contents
+ * @return bool  successful or not
+ *
+ * @note the other filesystems mounted under the root directory, such as '/proc' and '/dit/mnt', are skipped.
+ * @attention 'state->fd' and 'state->since' must be set before calling this function.
+ */
+static bool write_checkpoint(ckpt_state *state, const char *root, const char *history, size_t history_size){
+    assert(state);
+    assert(root && (*root == '/'));
+    assert(history);
+
+    ckpt_header header = {0};
+    ckpt_entry end = {0};
+    struct stat file_stat;
+
+    header.magic = CKPT_MAGIC;
+    header.version = CKPT_VERSION;
+    header.history_size = history_size;
+    header.history_hash = hash_bytes(history, history_size);
+
+    if (! (write_all(state->fd, &header, sizeof(header)) && write_environ(state->fd, &(header.environ_size))))
+        return false;
+
+    if (stat(root, &file_stat) || ((state->path_len = strlen(root)) >= PATH_MAX))
+        return false;
+
+    state->dev = file_stat.st_dev;
+    state->files_num = 0;
+    state->bytes = 0;
+    memcpy(state->path, root, (sizeof(char) * (state->path_len + 1)));
+
+    bool success;
+    trace_scope scope;
+
+    trace_begin(&scope, TRACE_WRITE_CHECKPOINT, root);
+    success = archive_tree(state, AT_FDCWD, root) && write_all(state->fd, &end, sizeof(end));
+    trace_end(&scope);
+
+    // the size of the environment variables is known only after they are written
+    return success && (pwrite(state->fd, &header, sizeof(header), 0) == sizeof(header));
+}
+
+
+/**
+ * @brief write the environment variables that should be restored on resume.
+ *
+ * @param[in]  fd  file descriptor for the checkpoint
+ * @param[out] p_size  variable to store the total size of the written variables
+ * @return bool  successful or not
+ */
+static bool write_environ(int fd, uint64_t *p_size){
+    assert(fd >= 0);
+    assert(p_size);
+
+    extern char **environ;
+    size_t size;
+
+    *p_size = 0;
+
+    for (char **p_env = environ; *p_env; p_env++)
+        if (check_if_restorable_env(*p_env)){
+            size = strlen(*p_env) + 1;
+
+            if ((*p_size + size) > CKPT_ENVIRON_MAX)
+                break;
+            if (! write_all(fd, *p_env, size))
+                return false;
+
+            *p_size += size;
+        }
+
+    return true;
+}
+
+
+/**
+ * @brief write the file and all files below it that have changed since the container started.
+ *
+ * @param[out] state  variable to store the state while writing the checkpoint
+ * @param[in]  pwdfd  file descriptor that serves as the current working directory
+ * @param[in]  name  name of the file we are currently looking at, whose path is in 'state->path'
+ * @return bool  successful or not
+ *
+ * @note a changed directory is written with the list of its entries, so that deletions can be restored.
+ * @note the files that disappear during the walk are skipped, as are the sockets, pipes and devices.
+ */
+static bool archive_tree(ckpt_state *state, int pwdfd, const char *name){
+    assert(state);
+    assert(name && *name);
+
+    struct stat file_stat;
+    bool changed, success = true;
+    int fd;
+
+    if (fstatat(pwdfd, name, &file_stat, AT_SYMLINK_NOFOLLOW))
+        return (errno == ENOENT);
+
+    if ((file_stat.st_dev != state->dev) || (session_excluded && (! strcmp(state->path, session_excluded))))
+        return true;
+
+    changed = later_timespec(file_stat.st_ctim, state->since);
+
+    if (S_ISDIR(file_stat.st_mode)){
+        struct dirent **entries;
+        int entries_num, i;
+        char *listing = NULL;
+        size_t size = 0, len, path_len;
+
+        if ((fd = openat(pwdfd, name, (O_RDONLY | O_DIRECTORY | O_NOFOLLOW | O_CLOEXEC))) == -1)
+            return (errno == ENOENT);
+
+        if ((entries_num = scandir(state->path, &entries, filter_dirent, alphasort)) == -1){
+            close(fd);
+            return false;
+        }
+
+        if (changed){
+            for (i = 0; i < entries_num; i++)
+                size += strlen(entries[i]->d_name) + 1;
+
+            if ((listing = (char *) malloc(sizeof(char) * (size + 1)))){
+                size = 0;
+
+                for (i = 0; i < entries_num; i++){
+                    len = strlen(entries[i]->d_name) + 1;
+                    memcpy((listing + size), entries[i]->d_name, len);
+                    size += len;
+                }
+
+                success = archive_entry(state, &file_stat, listing, -1);
+                free(listing);
+            }
+            else
+                success = false;
+        }
+
+        path_len = state->path_len;
+
+        for (i = 0; i < entries_num; i++){
+            if (success){
+                len = strlen(entries[i]->d_name);
+
+                if ((path_len + len + 1) < PATH_MAX){
+                    if (state->path[path_len - 1] != '/')
+                        state->path[state->path_len++] = '/';
+
+                    memcpy((state->path + state->path_len), entries[i]->d_name, (sizeof(char) * (len + 1)));
+                    state->path_len += len;
+
+                    success = archive_tree(state, fd, entries[i]->d_name);
+
+                    state->path_len = path_len;
+                    state->path[path_len] = '\0';
+                }
+            }
+            free(entries[i]);
+        }
+
+        free(entries);
+        close(fd);
+    }
+    else if (changed){
+        if (S_ISREG(file_stat.st_mode)){
+            if ((fd = openat(pwdfd, name, (O_RDONLY | O_NOFOLLOW | O_NOCTTY | O_NONBLOCK | O_CLOEXEC))) == -1)
+                return (errno == ENOENT);
+
+            success = archive_entry(state, &file_stat, NULL, fd);
+            close(fd);
+        }
+        else if (S_ISLNK(file_stat.st_mode)){
+            char target[PATH_MAX];
+            ssize_t len;
+
+            if ((len = readlinkat(pwdfd, name, target, (PATH_MAX - 1))) == -1)
+                return (errno == ENOENT);
+
+            file_stat.st_size = len;
+            success = archive_entry(state, &file_stat, target, -1);
+        }
+    }
+
+    return success;
+}
+
+
+/**
+ * @brief write an entry of the checkpoint.
+ *
+ * @param[out] state  variable to store the state while writing the checkpoint
+ * @param[in]  file_stat  the information about the file, whose size is the size of its data
+ * @param[in]  data  the data, or NULL if it is read from 'data_fd'
+ * @param[in]  data_fd  file descriptor for the contents of the regular file, or -1
+ * @return bool  successful or not
+ *
+ * @note if the file shrinks while being read, the rest is filled with null characters.
+ */
+static bool archive_entry(ckpt_state *state, const struct stat *file_stat, const char *data, int data_fd){
+    assert(state);
+    assert(file_stat);
+    assert(data || (data_fd >= 0));
+
+    ckpt_entry entry;
+    uint64_t copied;
+    static const char zeros[4096] = {0};
+
+    entry.mtime_sec = file_stat->st_mtim.tv_sec;
+    entry.mtime_nsec = file_stat->st_mtim.tv_nsec;
+    entry.data_size = file_stat->st_size;
+    entry.path_len = state->path_len;
+    entry.mode = file_stat->st_mode;
+    entry.uid = file_stat->st_uid;
+    entry.gid = file_stat->st_gid;
+
+    if (! (write_all(state->fd, &entry, sizeof(entry)) && write_all(state->fd, state->path, state->path_len)))
+        return false;
+
+    if (data){
+        if (! write_all(state->fd, data, entry.data_size))
+            return false;
+    }
+    else
+        for (copied = copy_data(state->fd, data_fd, NULL, entry.data_size); copied < entry.data_size;){
+            size_t size = sizeof(zeros);
+
+            if (size > (entry.data_size - copied))
+                size = entry.data_size - copied;
+            if (! write_all(state->fd, zeros, size))
+                return false;
+
+            copied += size;
+        }
+
+    // the list of the entry names is not counted as a file
+    if (! S_ISDIR(entry.mode)){
+        state->files_num++;
+        state->bytes += entry.data_size;
+    }
+    return true;
+}
+
+
+
+
+/******************************************************************************
+    * Resume Part
+******************************************************************************/
+
+
+/**
+ * @brief extract all the entries of the checkpoint.
+ *
+ * @param[out] state  variable to store the state while extracting the checkpoint
+ * @param[in]  root  the directory under which all the entries must be
+ * @return bool  successful or not
+ *
+ * @note the modification times of the directories are restored last, since extracting their contents changes them.
+ * @note each entry is resolved from the root directory without following symbolic links, so that no entry is
+ *   written through a symbolic link extracted before it.
+ * @attention 'state->fd', 'state->offset' and 'state->since' must be set before calling this function.
+ */
+static bool extract_checkpoint(ckpt_state *state, const char *root){
+    assert(state);
+    assert(root && (*root == '/'));
+
+    ckpt_entry entry;
+    ckpt_dir_time *dir_times = NULL, *tmp;
+    size_t dirs_num = 0, dirs_max = 0;
+    char *data;
+    const char *name;
+    bool success = false;
+    struct timespec times[2];
+    int dir_fd;
+
+    trace_scope scope;
+
+    if ((state->root_fd = open(root, (O_RDONLY | O_DIRECTORY | O_CLOEXEC))) == -1)
+        return false;
+
+    trace_begin(&scope, TRACE_EXTRACT_CHECKPOINT, root);
+    state->files_num = 0;
+    state->bytes = 0;
+
+    while (read_all_at(state->fd, &entry, sizeof(entry), state->offset)){
+        state->offset += sizeof(entry);
+
+        if (! entry.path_len){
+            success = true;
+            break;
+        }
+
+        if ((entry.path_len >= PATH_MAX) || (! read_all_at(state->fd, state->path, entry.path_len, state->offset)))
+            break;
+
+        state->offset += entry.path_len;
+        state->path[entry.path_len] = '\0';
+        state->path_len = entry.path_len;
+
+        if (! check_extractable_path(state->path, root))
+            break;
+
+        data = NULL;
+
+        if (! S_ISREG(entry.mode)){
+            if (entry.data_size > (S_ISDIR(entry.mode) ? CKPT_LISTING_MAX : (PATH_MAX - 1)))
+                break;
+            if (! (data = (char *) malloc(sizeof(char) * (entry.data_size + 1))))
+                break;
+            if (! read_all_at(state->fd, data, entry.data_size, state->offset)){
+                free(data);
+                break;
+            }
+            data[entry.data_size] = '\0';
+        }
+
+        if (S_ISDIR(entry.mode) && (dirs_num >= dirs_max)){
+            dirs_max = dirs_max ? (dirs_max * 2) : 64;
+
+            if (! (tmp = (ckpt_dir_time *) realloc(dir_times, (sizeof(ckpt_dir_time) * dirs_max)))){
+                free(data);
+                break;
+            }
+            dir_times = tmp;
+        }
+
+        if ((dir_fd = open_parent_dir(state->root_fd, root, state->path, &name)) == -1){
+            free(data);
+            break;
+        }
+
+        if (! extract_entry(state, dir_fd, name, &entry, data, (dir_times + dirs_num))){
+            close(dir_fd);
+            free(data);
+            break;
+        }
+
+        close(dir_fd);
+
+        if (S_ISDIR(entry.mode))
+            dirs_num++;
+
+        state->offset += entry.data_size;
+        free(data);
+    }
+
+    times[0].tv_sec = 0;
+    times[0].tv_nsec = UTIME_OMIT;
+
+    while (dirs_num--){
+        times[1] = dir_times[dirs_num].mtime;
+
+        if ((dir_fd = open_parent_dir(state->root_fd, root, dir_times[dirs_num].path, &name)) != -1){
+            if (utimensat(dir_fd, name, times, AT_SYMLINK_NOFOLLOW))
+                success = false;
+            close(dir_fd);
+        }
+        else
+            success = false;
+
+        free(dir_times[dirs_num].path);
+    }
+
+    if (dir_times)
+        free(dir_times);
+
+    close(state->root_fd);
+
+    trace_end(&scope);
+
+    return success;
+}
+
+
+/**
+ * @brief extract an entry of the checkpoint, replacing the existing file.
+ *
+ * @param[out] state  variable to store the state while extracting the checkpoint
+ * @param[in]  dir_fd  file descriptor for the directory containing the entry
+ * @param[in]  name  name of the entry in the directory
+ * @param[in]  entry  the header of the entry
+ * @param[in]  data  the link target or the list of the entry names, or NULL for the regular file
+ * @param[out] dir_time  variable to store the modification time of the directory
+ * @return bool  successful or not
+ *
+ * @note the owner is changed before the permissions, since 'chown' clears the set-user-ID bit.
+ * @note the directory is opened without following symbolic links, and its attributes are changed through it.
+ */
+static bool extract_entry(
+    ckpt_state *state, int dir_fd, const char *name, const ckpt_entry *entry, const char *data, ckpt_dir_time *dir_time
+){
+    assert(state);
+    assert(dir_fd >= 0);
+    assert(name && *name);
+    assert(entry);
+    assert(S_ISREG(entry->mode) || data);
+
+    struct stat file_stat;
+    struct timespec times[2];
+    bool exists, success;
+    int fd;
+    mode_t mode;
+    off_t offset;
+
+    exists = (! fstatat(dir_fd, name, &file_stat, AT_SYMLINK_NOFOLLOW));
+    mode = entry->mode & 07777;
+
+    times[0].tv_sec = 0;
+    times[0].tv_nsec = UTIME_OMIT;
+    times[1].tv_sec = entry->mtime_sec;
+    times[1].tv_nsec = entry->mtime_nsec;
+
+    if (exists && (! (S_ISDIR(entry->mode) && S_ISDIR(file_stat.st_mode)))){
+        if (S_ISDIR(file_stat.st_mode) ? (! walkat(dir_fd, name, true, removeat)) : unlinkat(dir_fd, name, 0))
+            return false;
+        exists = false;
+    }
+
+    switch (entry->mode & S_IFMT){
+        case S_IFDIR:
+            if ((! exists) && mkdirat(dir_fd, name, S_IRWXU))
+                return false;
+            if ((fd = openat(dir_fd, name, (O_RDONLY | O_DIRECTORY | O_NOFOLLOW | O_CLOEXEC))) == -1)
+                return false;
+
+            success = (! fchown(fd, entry->uid, entry->gid)) && (! fchmod(fd, mode)) &&
+                prune_dir(state, fd, data, entry->data_size) && (dir_time->path = strdup(state->path));
+
+            close(fd);
+
+            if (success)
+                dir_time->mtime = times[1];
+            return success;
+        case S_IFREG:
+            if ((fd = openat(dir_fd, name, (O_WRONLY | O_CREAT | O_EXCL | O_NOFOLLOW | O_CLOEXEC), S_IRUSR)) == -1)
+                return false;
+
+            offset = state->offset;
+
+            if ((copy_data(fd, state->fd, &offset, entry->data_size) == entry->data_size) &&
+                (! fchown(fd, entry->uid, entry->gid)) && (! fchmod(fd, mode)) && (! futimens(fd, times)))
+            {
+                state->files_num++;
+                state->bytes += entry->data_size;
+                return (! close(fd));
+            }
+
+            close(fd);
+            return false;
+        case S_IFLNK:
+            if (symlinkat(data, dir_fd, name) || fchownat(dir_fd, name, entry->uid, entry->gid, AT_SYMLINK_NOFOLLOW))
+                return false;
+            if (utimensat(dir_fd, name, times, AT_SYMLINK_NOFOLLOW))
+                return false;
+
+            state->files_num++;
+            state->bytes += entry->data_size;
+            return true;
+        default:
+            return false;
+    }
+}
+
+
+/**
+ * @brief delete the entries of the directory that had been deleted at the time of the checkpoint.
+ *
+ * @param[out] state  variable to store the state while extracting the checkpoint
+ * @param[in]  fd  file descriptor for the directory
+ * @param[in]  listing  the null-terminated names of the entries at the time of the checkpoint
+ * @param[in]  size  the total size of the names
+ * @return bool  successful or not
+ *
+ * @note only the entries that existed when the container started are deleted, and the others are left.
+ * @note the mount points and the excluded directory are never deleted.
+ */
+static bool prune_dir(ckpt_state *state, int fd, const char *listing, size_t size){
+    assert(state);
+    assert(fd >= 0);
+    assert(listing);
+
+    const char **names, *name;
+    size_t names_num = 0, i;
+    DIR *dir;
+    struct dirent *entry;
+    struct stat dir_stat, file_stat;
+    bool success = true;
+
+    for (i = 0; i < size; i++)
+        if (! listing[i])
+            names_num++;
+
+    if (! (names = (const char **) malloc(sizeof(const char *) * (names_num + 1))))
+        return false;
+
+    for (i = 0, name = listing; i < names_num; i++, name += strlen(name) + 1)
+        names[i] = name;
+
+    qsort(names, names_num, sizeof(const char *), qstrcmp);
+
+    if (((fd = fcntl(fd, F_DUPFD_CLOEXEC, 0)) != -1) && (dir = fdopendir(fd))){
+
+        if (fstat(fd, &dir_stat))
+            success = false;
+
+        while (success && (entry = readdir(dir))){
+            name = entry->d_name;
+
+            if ((! check_if_valid_dirent(name)) || bsearch(&name, names, names_num, sizeof(const char *), qstrcmp))
+                continue;
+            if (fstatat(fd, name, &file_stat, AT_SYMLINK_NOFOLLOW))
+                continue;
+            if ((file_stat.st_dev != dir_stat.st_dev) || later_timespec(file_stat.st_ctim, state->since))
+                continue;
+
+            if (check_if_excluded(state->path, name))
+                continue;
+
+            if (S_ISDIR(file_stat.st_mode))
+                success = walkat(fd, name, true, removeat);
+            else
+                success = (! unlinkat(fd, name, 0));
+        }
+
+        closedir(dir);
+    }
+    else {
+        if (fd != -1)
+            close(fd);
+        success = false;
+    }
+
+    free(names);
+    return success;
+}
+
+
+/**
+ * @brief check that the path of the entry is safe to extract.
+ *
+ * @param[in]  path  the absolute path of the entry
+ * @param[in]  root  the directory under which all the entries must be
+ * @return bool  the resulting boolean
+ *
+ * @note the paths that go up with '..', or are in the excluded directory, are rejected.
+ */
+static bool check_extractable_path(const char *path, const char *root){
+    assert(path);
+    assert(root);
+
+    size_t len;
+
+    len = strlen(path);
+
+    if ((*path != '/') || strstr(path, "/../") || ((len >= 3) && (! strcmp((path + len - 3), "/.."))))
+        return false;
+
+    if ((len = strlen(root)) > 1)
+        if (strncmp(path, root, len) || (path[len] && (path[len] != '/')))
+            return false;
+
+    if (session_excluded){
+        len = strlen(session_excluded);
+
+        if ((! strncmp(path, session_excluded, len)) && ((! path[len]) || (path[len] == '/')))
+            return false;
+    }
+
+    return true;
+}
+
+
+/**
+ * @brief open the directory containing the entry, without following any symbolic link on the way.
+ *
+ * @param[in]  root_fd  file descriptor for the directory under which all the entries must be
+ * @param[in]  root  the path of that directory
+ * @param[out] path  the absolute path of the entry, which has been checked by 'check_extractable_path'
+ * @param[out] p_name  variable to store the last component of the path, or "." for the root directory itself
+ * @return int  file descriptor for the directory containing the entry, or -1
+ *
+ * @note the path is resolved from the root directory one component at a time with 'O_NOFOLLOW'.
+ * @note the empty, '.' and '..' components are rejected, and the path is left as it was.
+ * @attention the return value must be closed by the caller.
+ */
+static int open_parent_dir(int root_fd, const char *root, char *path, const char **p_name){
+    assert(root_fd >= 0);
+    assert(root && (*root == '/'));
+    assert(path && (! strncmp(path, root, strlen(root))));
+    assert(p_name);
+
+    char *name, *slash;
+    int dir_fd, next_fd;
+
+    name = path + strlen(root);
+    if (*name == '/')
+        name++;
+
+    if ((dir_fd = fcntl(root_fd, F_DUPFD_CLOEXEC, 0)) == -1)
+        return -1;
+
+    if (! *name){
+        *p_name = ".";
+        return dir_fd;
+    }
+
+    for (; (slash = strchr(name, '/')); name = slash + 1){
+        *slash = '\0';
+
+        if (*name && check_if_valid_dirent(name))
+            next_fd = openat(dir_fd, name, (O_RDONLY | O_DIRECTORY | O_NOFOLLOW | O_CLOEXEC));
+        else {
+            next_fd = -1;
+            errno = EINVAL;
+        }
+
+        *slash = '/';
+        close(dir_fd);
+
+        if ((dir_fd = next_fd) == -1)
+            return -1;
+    }
+
+    if (! (*name && check_if_valid_dirent(name))){
+        close(dir_fd);
+        errno = EINVAL;
+        return -1;
+    }
+
+    *p_name = name;
+    return dir_fd;
+}
+
+
+/**
+ * @brief check whether the entry of the directory is the excluded directory.
+ *
+ * @param[in]  dir_path  the absolute path of the directory
+ * @param[in]  name  name of the entry
+ * @return bool  the resulting boolean
+ */
+static bool check_if_excluded(const char *dir_path, const char *name){
+    assert(dir_path && (*dir_path == '/'));
+    assert(name);
+
+    size_t len;
+
+    if (! session_excluded)
+        return false;
+
+    len = dir_path[1] ? strlen(dir_path) : 0;
+
+    return (! strncmp(session_excluded, dir_path, len)) && (session_excluded[len] == '/') &&
+        (! strcmp((session_excluded + len + 1), name));
+}
+
+
+
+
+/******************************************************************************
+    * Replay Part
+******************************************************************************/
+
+
+/**
+ * @brief write the command lines that reproduce the shell at the time of the checkpoint and after it.
+ *
+ * @param[out] fp  the stream to write to
+ * @param[in]  env  the null-terminated environment variables saved in the checkpoint, or NULL
+ * @param[in]  env_size  the total size of the variables
+ * @param[in]  rest  the command lines appended to history-file after the checkpoint
+ * @param[in]  rest_size  the size of the command lines
+ *
+ * @note only the variables whose values differ from the current environment are exported.
+ * @note the working directory is changed last, so that it is the one the following lines expect.
+ */
+static void write_replay(FILE *fp, const char *env, size_t env_size, const char *rest, size_t rest_size){
+    assert(fp);
+    assert(env || (! env_size));
+    assert(rest || (! rest_size));
+
+    const char *pwd = NULL, *value, *curr;
+    size_t len;
+
+    for (const char *end = env + env_size; env < end; env += strlen(env) + 1){
+        if (! check_if_restorable_env(env))
+            continue;
+
+        value = strchr(env, '=') + 1;
+        len = value - env - 1;
+
+        if ((len == 3) && (! strncmp(env, "PWD", 3))){
+            pwd = value;
+            continue;
+        }
+
+        char name[len + 1];
+
+        memcpy(name, env, (sizeof(char) * len));
+        name[len] = '\0';
+
+        if ((curr = getenv(name)) && (! strcmp(curr, value)))
+            continue;
+
+        fprintf(fp, "export %s=", name);
+        fprint_quoted(fp, value, strlen(value));
+        putc('\n', fp);
+    }
+
+    if (pwd){
+        fputs("cd ", fp);
+        fprint_quoted(fp, pwd, strlen(pwd));
+        putc('\n', fp);
+    }
+
+    fwrite(rest, sizeof(char), rest_size, fp);
+}
+
+
+/**
+ * @brief check whether the environment variable should be restored on resume.
+ *
+ * @param[in]  env  the environment variable in the form 'NAME=VALUE'
+ * @return bool  the resulting boolean
+ *
+ * @note the variables whose names cannot be exported by the shell, such as the exported functions, are excluded.
+ */
+static bool check_if_restorable_env(const char *env){
+    assert(env);
+
+    const char *tmp;
+    size_t len, i;
+
+    if (! (isalpha((unsigned char) *env) || (*env == '_')))
+        return false;
+
+    for (tmp = env + 1; *tmp != '='; tmp++)
+        if (! (isalnum((unsigned char) *tmp) || (*tmp == '_')))
+            return false;
+
+    len = tmp - env;
+
+    for (i = 0; i < numof(volatile_envs); i++)
+        if ((! strncmp(env, volatile_envs[i], len)) && (! volatile_envs[i][len]))
+            return false;
+
+    return true;
+}
+
+
+/**
+ * @brief print the string quoted so that the shell reads it as it is.
+ *
+ * @param[out] fp  the stream to write to
+ * @param[in]  str  the string
+ * @param[in]  size  the length of the string
+ */
+static void fprint_quoted(FILE *fp, const char *str, size_t size){
+    assert(fp);
+    assert(str);
+
+    putc('\'', fp);
+
+    for (; size--; str++){
+        if (*str == '\'')
+            fputs("'\\''", fp);
+        else
+            putc(*str, fp);
+    }
+
+    putc('\'', fp);
+}
+
+
+
+
+/******************************************************************************
+    * Input and Output
+******************************************************************************/
+
+
+/**
+ * @brief write all the bytes, retrying on partial writes.
+ *
+ * @param[in]  fd  file descriptor to write to
+ * @param[in]  buf  the bytes
+ * @param[in]  size  the number of bytes
+ * @return bool  successful or not
+ */
+static bool write_all(int fd, const void *buf, size_t size){
+    assert(fd >= 0);
+    assert(buf || (! size));
+
+    ssize_t written;
+
+    while (size){
+        if ((written = write(fd, buf, size)) == -1){
+            if (errno == EINTR)
+                continue;
+            return false;
+        }
+
+        buf = (const char *) buf + written;
+        size -= written;
+    }
+
+    return true;
+}
+
+
+/**
+ * @brief read exactly the specified number of bytes at the offset.
+ *
+ * @param[in]  fd  file descriptor to read from
+ * @param[out] buf  variable to store the bytes
+ * @param[in]  size  the number of bytes
+ * @param[in]  offset  the offset in the file
+ * @return bool  whether all the bytes have been read
+ */
+static bool read_all_at(int fd, void *buf, size_t size, off_t offset){
+    assert(fd >= 0);
+    assert(buf || (! size));
+
+    ssize_t got;
+
+    while (size){
+        if ((got = pread(fd, buf, size, offset)) <= 0){
+            if ((got == -1) && (errno == EINTR))
+                continue;
+            return false;
+        }
+
+        buf = (char *) buf + got;
+        size -= got;
+        offset += got;
+    }
+
+    return true;
+}
+
+
+/**
+ * @brief copy the bytes between files in the kernel.
+ *
+ * @param[in]  out_fd  file descriptor to write to
+ * @param[in]  in_fd  file descriptor to read from
+ * @param[out] p_offset  variable to store the offset to read from, or NULL to use the file offset
+ * @param[in]  size  the number of bytes
+ * @return uint64_t  the number of bytes copied, which is less than 'size' at the end of file or on error
+ */
+static uint64_t copy_data(int out_fd, int in_fd, off_t *p_offset, uint64_t size){
+    assert(out_fd >= 0);
+    assert(in_fd >= 0);
+
+    uint64_t copied = 0, count;
+    ssize_t sent;
+
+    while (copied < size){
+        count = size - copied;
+
+        if (count > CKPT_SENDFILE_MAX)
+            count = CKPT_SENDFILE_MAX;
+
+        if ((sent = sendfile(out_fd, in_fd, p_offset, count)) <= 0){
+            if ((sent == -1) && (errno == EINTR))
+                continue;
+            break;
+        }
+
+        copied += sent;
+    }
+
+    return copied;
+}
+
+
+
+
+#ifndef NDEBUG
+
+
+/******************************************************************************
+    * Unit Test Functions
+******************************************************************************/
+
+
+#define SESSION_TEST_DIR "/dit/tmp/session.test"
+
+
+static void round_trip_test(void);
+static void write_replay_test(void);
+
+static void write_test_file(const char *name, const char *contents);
+static bool check_test_file(const char *name, const char *contents);
+
+
+
+
+void session_test(void){
+    do_test(round_trip_test);
+    do_test(write_replay_test);
+}
+
+
+
+
+static void round_trip_test(void){
+    const char * const base_files[] = { "keep", "gone", "dir/old", "excluded/old" };
+    const struct timespec interval = { 0, 20000000 };
+
+    // a symbolic link to another directory, followed by an entry through it
+    const struct {
+        const char * const path;
+        const mode_t mode;
+        const char * const data;
+    }
+    crafted[] = {
+        { SESSION_TEST_DIR "/x",   (S_IFLNK | 0777), "target" },
+        { SESSION_TEST_DIR "/x/f", (S_IFREG | 0644), "evil"   }
+    };
+
+    ckpt_state *state;
+    ckpt_header header;
+    ckpt_entry entry;
+    const char *name;
+    int fd;
+    struct timespec since;
+    struct stat file_stat;
+    char target[PATH_MAX];
+    ssize_t len;
+    size_t i;
+    int round;
+
+    assert((state = (ckpt_state *) malloc(sizeof(ckpt_state))));
+
+    session_root = SESSION_TEST_DIR;
+    session_excluded = SESSION_TEST_DIR "/excluded";
+
+    // the first round builds the checkpoint, and the second one resumes from it on a fresh base
+    for (round = 0; round < 2; round++){
+        if (! access(SESSION_TEST_DIR, F_OK))
+            assert(walkat(AT_FDCWD, SESSION_TEST_DIR, true, removeat));
+
+        assert(! mkdir(SESSION_TEST_DIR, 0755));
+        assert(! mkdir(SESSION_TEST_DIR "/dir", 0755));
+        assert(! mkdir(SESSION_TEST_DIR "/excluded", 0755));
+
+        for (i = 0; i < numof(base_files); i++)
+            write_test_file(base_files[i], "base");
+
+        assert(! clock_gettime(CLOCK_REALTIME, &since));
+        assert(! nanosleep(&interval, NULL));
+
+        state->since = since;
+        assert((state->fd = open(TMP_FILE1, (round ? O_RDONLY : (O_WRONLY | O_CREAT | O_TRUNC)), 0600)) != -1);
+
+        if (! round){
+            write_test_file("keep", "changed");
+            write_test_file("new", "new");
+            write_test_file("excluded/new", "new");
+            assert(! mkdir(SESSION_TEST_DIR "/dir/sub", 0700));
+            write_test_file("dir/sub/file", "");
+            write_test_file("suid", "suid");
+            assert(! chmod(SESSION_TEST_DIR "/suid", (S_ISUID | 0755)));
+            assert(! symlink("new", SESSION_TEST_DIR "/link"));
+            assert(! unlink(SESSION_TEST_DIR "/gone"));
+
+            assert(write_checkpoint(state, session_root, "", 0));
+            fprintf(stderr, "  checkpointed %zu files of %" PRIu64 " bytes\n", state->files_num, state->bytes);
+
+            // 'keep', 'new', 'link', 'dir/sub/file', 'suid' and the listings of 3 directories
+            assert(state->files_num == 5);
+            assert(state->bytes == strlen("changed") + strlen("new") + strlen("new") + strlen("suid"));
+        }
+        else {
+            // created after the start of the container, so it must not be deleted
+            write_test_file("later", "later");
+
+            assert(read_all_at(state->fd, &header, sizeof(header), 0));
+            assert((header.magic == CKPT_MAGIC) && (! header.history_size));
+
+            state->offset = sizeof(header) + header.environ_size;
+            assert(extract_checkpoint(state, session_root));
+            fprintf(stderr, "  restored %zu files of %" PRIu64 " bytes\n", state->files_num, state->bytes);
+
+            assert(check_test_file("keep", "changed"));
+            assert(check_test_file("new", "new"));
+            assert(check_test_file("dir/old", "base"));
+            assert(check_test_file("dir/sub/file", ""));
+            assert(check_test_file("excluded/old", "base"));
+            assert(check_test_file("later", "later"));
+            assert(! stat(SESSION_TEST_DIR "/suid", &file_stat));
+            assert((file_stat.st_mode & 07777) == (S_ISUID | 0755));
+            assert(access(SESSION_TEST_DIR "/gone", F_OK) && (errno == ENOENT));
+            assert(access(SESSION_TEST_DIR "/excluded/new", F_OK) && (errno == ENOENT));
+
+            assert((len = readlink(SESSION_TEST_DIR "/link", target, PATH_MAX)) == 3);
+            assert(! strncmp(target, "new", 3));
+        }
+
+        assert(! close(state->fd));
+    }
+
+    // no entry is written through a symbolic link extracted before it
+    assert(! mkdir(SESSION_TEST_DIR "/target", 0755));
+    assert((state->fd = open(TMP_FILE1, (O_WRONLY | O_TRUNC))) != -1);
+    assert(write_all(state->fd, &header, sizeof(header)));
+
+    for (i = 0; i < numof(crafted); i++){
+        memset(&entry, 0, sizeof(entry));
+        entry.path_len = strlen(crafted[i].path);
+        entry.mode = crafted[i].mode;
+        entry.data_size = strlen(crafted[i].data);
+
+        assert(write_all(state->fd, &entry, sizeof(entry)));
+        assert(write_all(state->fd, crafted[i].path, entry.path_len));
+        assert(write_all(state->fd, crafted[i].data, entry.data_size));
+    }
+
+    memset(&entry, 0, sizeof(entry));
+    assert(write_all(state->fd, &entry, sizeof(entry)));
+    assert(! close(state->fd));
+
+    assert((state->fd = open(TMP_FILE1, O_RDONLY)) != -1);
+    state->offset = sizeof(header);
+    assert(! extract_checkpoint(state, session_root));
+    assert(! close(state->fd));
+
+    assert(! lstat(SESSION_TEST_DIR "/x", &file_stat) && S_ISLNK(file_stat.st_mode));
+    assert(access(SESSION_TEST_DIR "/target/f", F_OK) && (errno == ENOENT));
+    fputs("  refused to write through the extracted symbolic link\n", stderr);
+
+    assert(walkat(AT_FDCWD, SESSION_TEST_DIR, true, removeat));
+
+    // a checkpoint that others can write to is never trusted
+    assert((state->fd = open(TMP_FILE1, O_RDONLY)) != -1);
+    assert(! fchmod(state->fd, 0666));
+    assert(! check_if_verified(state->fd));
+    assert(! close(state->fd));
+    assert(! unlink(TMP_FILE1));
+
+    // a path outside the root or going up is never extracted
+    assert(! check_extractable_path("/etc/passwd", SESSION_TEST_DIR));
+    assert(! check_extractable_path(SESSION_TEST_DIR "/../x", SESSION_TEST_DIR));
+    assert(! check_extractable_path(SESSION_TEST_DIR "/..", SESSION_TEST_DIR));
+    assert(! check_extractable_path(SESSION_TEST_DIR "/excluded/x", SESSION_TEST_DIR));
+    assert(check_extractable_path(SESSION_TEST_DIR "/..x", SESSION_TEST_DIR));
+
+    // the components that do not name an entry are rejected when resolving the path
+    assert((fd = open("/dit/tmp", (O_RDONLY | O_DIRECTORY))) != -1);
+
+    strcpy(target, "/dit/tmp/./x");
+    assert((open_parent_dir(fd, "/dit/tmp", target, &name) == -1) && (errno == EINVAL));
+    assert(! strcmp(target, "/dit/tmp/./x"));
+
+    strcpy(target, "/dit/tmp//x");
+    assert((open_parent_dir(fd, "/dit/tmp", target, &name) == -1) && (errno == EINVAL));
+
+    assert(! close(fd));
+
+    session_root = "/";
+    session_excluded = "/dit";
+    free(state);
+}
+
+
+static void write_test_file(const char *name, const char *contents){
+    char path[PATH_MAX];
+    FILE *fp;
+
+    snprintf(path, PATH_MAX, "%s/%s", SESSION_TEST_DIR, name);
+
+    assert((fp = fopen(path, "w")));
+    assert(fputs(contents, fp) != EOF);
+    assert(! fclose(fp));
+}
+
+
+static bool check_test_file(const char *name, const char *contents){
+    char path[PATH_MAX], buf[64];
+    FILE *fp;
+    size_t size;
+
+    snprintf(path, PATH_MAX, "%s/%s", SESSION_TEST_DIR, name);
+
+    if (! (fp = fopen(path, "r")))
+        return false;
+
+    size = fread(buf, sizeof(char), (sizeof(buf) - 1), fp);
+    buf[size] = '\0';
+    fclose(fp);
+
+    return (! strcmp(buf, contents));
+}
+
+
+
+
+static void write_replay_test(void){
+    // changeable part for updating test cases
+    const struct {
+        const char env[64];
+        size_t env_size;
+        const char * const rest;
+        const char * const result;
+    }
+    // when adding items, it is necessary to match the sizes of the null-terminated environment variables
+    table[] = {
+        { "",                                0, "",             ""                                                 },
+        { "",                                0, "make\n",       "make\n"                                           },
+        { "DIT_TEST_A=1",                   13, "",             "export DIT_TEST_A='1'\n"                          },
+        { "DIT_TEST_B=it's",                16, "ls\n",         "export DIT_TEST_B='it'\\''s'\nls\n"               },
+        { "PWD=/usr/src\0DIT_TEST_C=",      25, "make\n",       "export DIT_TEST_C=''\ncd '/usr/src'\nmake\n"      },
+        { "HOME=/root\0SHLVL=2\0A%%=1",     25, "",             ""                                                 },
+        { "DIT_TEST_D=0",                   13, "",             ""                                                 },
+        { "",                                0,  NULL,          NULL                                               }
+    };
+
+    int i;
+    FILE *fp;
+    char buf[256];
+    size_t size;
+
+    assert(! setenv("DIT_TEST_D", "0", 1));
+
+    for (i = 0; table[i].rest; i++){
+        assert((fp = fopen(TMP_FILE1, "w+")));
+
+        write_replay(fp, table[i].env, table[i].env_size, table[i].rest, strlen(table[i].rest));
+
+        rewind(fp);
+        size = fread(buf, sizeof(char), (sizeof(buf) - 1), fp);
+        buf[size] = '\0';
+        assert(! fclose(fp));
+
+        assert(! strcmp(buf, table[i].result));
+
+        print_progress_test_loop('\0', '\0', i);
+        fprintf(stderr, "%zu bytes of replay\n", size);
+    }
+
+    assert(! unsetenv("DIT_TEST_D"));
+    assert(! unlink(TMP_FILE1));
+}
+
+
+#endif // NDEBUG
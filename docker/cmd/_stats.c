@@ -0,0 +1,553 @@
+/**
+ * @file _stats.c
+ *
+ * Copyright (c) 2023 Tsukasa Inada
+ *
+ * @brief Described the dit command 'stats', that shows the latency distribution of each phase of the dit commands.
+ * @author Tsukasa Inada
+ * @date 2023/10/11
+ *
+ * @note The samples are read from the ring buffer to which every dit command appends them in 'trace.c'.
+ * @note Each power of 2 is divided into 8 buckets, so the displayed quantiles are accurate to within 12.5%.
+ */
+
+#include "main.h"
+
+#define STATS_SUB_BITS 3
+#define STATS_SUB_COUNT (1 << STATS_SUB_BITS)
+#define STATS_BUCKETS_NUM ((64 - STATS_SUB_BITS + 1) * STATS_SUB_COUNT)
+
+#define STATS_BAR_WIDTH 30
+
+#define STATS_TABLE_HEADER \
+    ( \
+        "COMMAND     PHASE                           COUNT       P50       P99       MAX  BYTES/OP\n" \
+        "=========================================================================================\n" \
+    )
+
+
+/** Data type for storing the results of option parse */
+typedef struct {
+    bool histogram;    /** whether to display the distribution of each phase */
+    bool reset;        /** whether to discard all the samples */
+} stats_opts;
+
+
+/** Data type for storing the distribution of the elapsed time of a phase in microseconds */
+typedef struct {
+    uint64_t count;                           /** the number of samples */
+    uint64_t max;                             /** the maximum elapsed time */
+    uint64_t bytes;                           /** the total number of bytes read and written */
+    uint64_t buckets[STATS_BUCKETS_NUM];      /** the number of samples in each bucket */
+} stats_hist;
+
+
+static int parse_opts(int argc, char **argv, stats_opts *opt);
+static int do_stats(int argc, char **argv, const stats_opts *opt);
+static int reset_stats(void);
+
+static bool collect_samples(const stats_ring *ring, stats_hist *(*hists)[TRACE_PHASES_NUM], uint64_t *p_lost);
+static void display_hist(int cmd_id, int phase_id, const stats_hist *hist, bool histogram);
+
+static int getidx_bucket(uint64_t val);
+static uint64_t getmax_bucket(int idx);
+static uint64_t get_quantile(const stats_hist *hist, unsigned int permille);
+static void print_duration(uint64_t usec);
+
+
+extern const char * const cmd_reprs[CMDS_NUM];
+
+
+
+
+/******************************************************************************
+    * Local Main Interface
+******************************************************************************/
+
+
+/**
+ * @brief show the distribution of the elapsed time of each phase of the dit commands.
+ *
+ * @param[in]  argc  the number of command line arguments
+ * @param[out] argv  array of strings that are command line arguments
+ * @return int  command's exit status
+ *
+ * @note treated like a normal main function.
+ */
+int stats(int argc, char **argv){
+    int i, exit_status = FAILURE;
+    stats_opts opt;
+
+    if (! (i = parse_opts(argc, argv, &opt))){
+        argc -= optind;
+        argv += optind;
+
+        if (opt.reset){
+            if (argc <= 0)
+                exit_status = reset_stats();
+            else
+                xperror_too_many_args(0);
+        }
+        else
+            exit_status = do_stats(argc, argv, &opt);
+    }
+    else if (i > 0)
+        exit_status = SUCCESS;
+
+    if (exit_status){
+        if (exit_status < 0){
+            exit_status = FAILURE;
+            xperror_internal_file();
+        }
+        xperror_suggestion(true);
+    }
+    return exit_status;
+}
+
+
+/**
+ * @brief parse optional arguments.
+ *
+ * @param[in]  argc  the number of command line arguments
+ * @param[out] argv  array of strings that are command line arguments
+ * @param[out] opt  variable to store the results of option parse
+ * @return int  0 (parse success), 1 (normally exit) or -1 (error exit)
+ *
+ * @note the arguments are expected to be passed as-is from main function.
+ */
+static int parse_opts(int argc, char **argv, stats_opts *opt){
+    assert(opt);
+
+    const char *short_opts = "Hr";
+
+    const struct option long_opts[] = {
+        { "histogram", no_argument, NULL, 'H' },
+        { "reset",     no_argument, NULL, 'r' },
+        { "help",      no_argument, NULL,  1  },
+        {  0,           0,           0,    0  }
+    };
+
+    opt->histogram = false;
+    opt->reset = false;
+
+    int c;
+    while ((c = getopt_long(argc, argv, short_opts, long_opts, NULL)) >= 0)
+        switch (c){
+            case 'H':
+                opt->histogram = true;
+                break;
+            case 'r':
+                opt->reset = true;
+                break;
+            case 1:
+                stats_manual();
+                return NORMALLY_EXIT;
+            default:
+                return ERROR_EXIT;
+        }
+
+    return SUCCESS;
+}
+
+
+
+
+/******************************************************************************
+    * Display Part
+******************************************************************************/
+
+
+/**
+ * @brief display the quantiles of the elapsed time for each pair of a dit command and its phase.
+ *
+ * @param[in]  argc  the number of non-optional arguments
+ * @param[in]  argv  array of strings that are non-optional arguments
+ * @param[in]  opt  variable to store the results of option parse
+ * @return int  0 (success), 1 (argument recognition error) or -1 (unexpected error)
+ *
+ * @note if no COMMANDs are specified, all the dit commands with any samples are displayed.
+ */
+static int do_stats(int argc, char **argv, const stats_opts *opt){
+    assert(opt);
+
+    bool targets[CMDS_NUM];
+    int cmd_id, phase_id, exit_status = SUCCESS;
+    stats_ring *ring;
+    stats_hist *hists[CMDS_NUM][TRACE_PHASES_NUM] = {0};
+    uint64_t lost = 0;
+
+    memset(targets, (argc <= 0), sizeof(targets));
+
+    for (; argc > 0; argc--, argv++){
+        if ((cmd_id = receive_expected_string(*argv, cmd_reprs, CMDS_NUM, 2)) < 0){
+            xperror_invalid_arg('C', cmd_id, "command", *argv);
+            return POSSIBLE_ERROR;
+        }
+        assert(cmd_id < CMDS_NUM);
+        targets[cmd_id] = true;
+    }
+
+    if (! (ring = map_stats_ring(STATS_RING_FILE, false))){
+        // no dit command has appended any samples yet
+        if (! get_file_size(STATS_RING_FILE))
+            return SUCCESS;
+        return UNEXPECTED_ERROR;
+    }
+
+    if (collect_samples(ring, hists, &lost)){
+        if (lost)
+            printf("(%" PRIu64 " older samples have been overwritten)\n", lost);
+
+        fputs(STATS_TABLE_HEADER, stdout);
+
+        for (cmd_id = 0; cmd_id < CMDS_NUM; cmd_id++)
+            for (phase_id = 0; phase_id < TRACE_PHASES_NUM; phase_id++)
+                if (targets[cmd_id] && hists[cmd_id][phase_id])
+                    display_hist(cmd_id, phase_id, hists[cmd_id][phase_id], opt->histogram);
+    }
+    else
+        exit_status = UNEXPECTED_ERROR;
+
+    for (cmd_id = 0; cmd_id < CMDS_NUM; cmd_id++)
+        for (phase_id = 0; phase_id < TRACE_PHASES_NUM; phase_id++)
+            free(hists[cmd_id][phase_id]);
+
+    munmap(ring, sizeof(stats_ring));
+    return exit_status;
+}
+
+
+/**
+ * @brief discard all the samples recorded so far.
+ *
+ * @return int  0 (success) or -1 (unexpected error)
+ *
+ * @note the file is not truncated, since other dit commands may be appending the samples to it.
+ */
+static int reset_stats(void){
+    stats_ring *ring;
+    size_t i;
+
+    if (! (ring = map_stats_ring(STATS_RING_FILE, true)))
+        return UNEXPECTED_ERROR;
+
+    for (i = 0; i < STATS_RING_SIZE; i++)
+        atomic_store_explicit(&(ring->samples[i].seq), 0, memory_order_relaxed);
+    atomic_store(&(ring->head), 0);
+
+    munmap(ring, sizeof(stats_ring));
+    return SUCCESS;
+}
+
+
+
+
+/**
+ * @brief classify the samples in the ring buffer into the histograms.
+ *
+ * @param[in]  ring  the ring buffer mapped into the memory
+ * @param[out] hists  2D array of the histograms, where only the necessary ones are allocated
+ * @param[out] p_lost  variable to store the number of samples that have been overwritten
+ * @return bool  successful or not
+ *
+ * @note the samples being written or having been overwritten during the reading are skipped.
+ */
+static bool collect_samples(const stats_ring *ring, stats_hist *(*hists)[TRACE_PHASES_NUM], uint64_t *p_lost){
+    assert(ring);
+    assert(hists);
+    assert(p_lost);
+
+    uint64_t head, seq, usec;
+    size_t i;
+    stats_sample sample;
+    stats_hist *hist;
+
+    head = atomic_load_explicit(&(ring->head), memory_order_acquire);
+    *p_lost = (head > STATS_RING_SIZE) ? (head - STATS_RING_SIZE) : 0;
+
+    for (i = 0; i < STATS_RING_SIZE; i++){
+        if (! (seq = atomic_load_explicit(&(ring->samples[i].seq), memory_order_acquire)))
+            continue;
+
+        sample.dur_ns = ring->samples[i].dur_ns;
+        sample.bytes = ring->samples[i].bytes;
+        sample.cmd_id = ring->samples[i].cmd_id;
+        sample.phase_id = ring->samples[i].phase_id;
+
+        atomic_thread_fence(memory_order_acquire);
+
+        if (
+            (seq != atomic_load_explicit(&(ring->samples[i].seq), memory_order_relaxed)) ||
+            (sample.cmd_id >= CMDS_NUM) || (sample.phase_id >= TRACE_PHASES_NUM)
+        )
+            continue;
+
+        if (! (hist = hists[sample.cmd_id][sample.phase_id])){
+            if (! (hist = (stats_hist *) calloc(1, sizeof(stats_hist))))
+                return false;
+            hists[sample.cmd_id][sample.phase_id] = hist;
+        }
+
+        usec = sample.dur_ns / 1000;
+
+        hist->count++;
+        hist->bytes += sample.bytes;
+        hist->buckets[getidx_bucket(usec)]++;
+
+        if (hist->max < usec)
+            hist->max = usec;
+    }
+
+    return true;
+}
+
+
+/**
+ * @brief display one row of the table, and the distribution if necessary.
+ *
+ * @param[in]  cmd_id  ID of the dit command
+ * @param[in]  phase_id  ID of the phase
+ * @param[in]  hist  the histogram for the pair of them
+ * @param[in]  histogram  whether to display the distribution
+ *
+ * @note the distribution is displayed in the style of HdrHistogram, with the cumulative percentile.
+ */
+static void display_hist(int cmd_id, int phase_id, const stats_hist *hist, bool histogram){
+    assert((cmd_id >= 0) && (cmd_id < CMDS_NUM));
+    assert((phase_id >= 0) && (phase_id < TRACE_PHASES_NUM));
+    assert(hist);
+    assert(hist->count);
+
+    int idx;
+    uint64_t peak = 0, accum = 0;
+    size_t width;
+
+    printf("%-11s %-28s %8" PRIu64, cmd_reprs[cmd_id], trace_phases[phase_id], hist->count);
+
+    print_duration(get_quantile(hist, 500));
+    print_duration(get_quantile(hist, 990));
+    print_duration(hist->max);
+
+    printf("  %8" PRIu64 "\n", (hist->bytes / hist->count));
+
+    if (histogram){
+        for (idx = 0; idx < STATS_BUCKETS_NUM; idx++)
+            if (peak < hist->buckets[idx])
+                peak = hist->buckets[idx];
+
+        for (idx = 0; idx < STATS_BUCKETS_NUM; idx++)
+            if (hist->buckets[idx]){
+                accum += hist->buckets[idx];
+                width = (hist->buckets[idx] * STATS_BAR_WIDTH + peak - 1) / peak;
+
+                fputs("      <=", stdout);
+                print_duration(getmax_bucket(idx));
+                printf(
+                    "  %7.3f%%  %8" PRIu64 "  %.*s\n",
+                    (accum * 100.0 / hist->count), hist->buckets[idx],
+                    ((int) width), "##############################"
+                );
+            }
+
+        putchar('\n');
+    }
+}
+
+
+
+
+/******************************************************************************
+    * Utilities
+******************************************************************************/
+
+
+/**
+ * @brief get the index of the bucket in which the specified value is counted.
+ *
+ * @param[in]  val  target value
+ * @return int  the resulting index
+ *
+ * @note the values less than 8 have their own buckets, and the others share them with the nearby values.
+ */
+static int getidx_bucket(uint64_t val){
+    int exp;
+
+    if (val < STATS_SUB_COUNT)
+        return (int) val;
+
+    exp = 63 - __builtin_clzll(val);
+    assert(exp >= STATS_SUB_BITS);
+
+    return (exp - STATS_SUB_BITS + 1) * STATS_SUB_COUNT + ((val >> (exp - STATS_SUB_BITS)) & (STATS_SUB_COUNT - 1));
+}
+
+
+/**
+ * @brief get the maximum value counted in the specified bucket.
+ *
+ * @param[in]  idx  index of the bucket
+ * @return uint64_t  the resulting value
+ */
+static uint64_t getmax_bucket(int idx){
+    assert((idx >= 0) && (idx < STATS_BUCKETS_NUM));
+
+    int exp;
+    uint64_t lower;
+
+    if (idx < STATS_SUB_COUNT)
+        return (uint64_t) idx;
+
+    exp = idx / STATS_SUB_COUNT + STATS_SUB_BITS - 1;
+    lower = ((uint64_t) (STATS_SUB_COUNT + (idx % STATS_SUB_COUNT))) << (exp - STATS_SUB_BITS);
+
+    return lower + ((((uint64_t) 1) << (exp - STATS_SUB_BITS)) - 1);
+}
+
+
+/**
+ * @brief get the specified quantile of the histogram.
+ *
+ * @param[in]  hist  target histogram
+ * @param[in]  permille  the quantile in permille
+ * @return uint64_t  the maximum value of the bucket that contains the quantile, but not more than the maximum
+ */
+static uint64_t get_quantile(const stats_hist *hist, unsigned int permille){
+    assert(hist);
+    assert(hist->count);
+    assert(permille <= 1000);
+
+    uint64_t rank, accum = 0, val;
+    int idx;
+
+    rank = (hist->count * permille + 999) / 1000;
+    if (! rank)
+        rank = 1;
+
+    for (idx = 0; idx < (STATS_BUCKETS_NUM - 1); idx++)
+        if ((accum += hist->buckets[idx]) >= rank)
+            break;
+
+    val = getmax_bucket(idx);
+    return (val < hist->max) ? val : hist->max;
+}
+
+
+/**
+ * @brief print the elapsed time in 10 characters, choosing the appropriate unit.
+ *
+ * @param[in]  usec  the elapsed time in microseconds
+ */
+static void print_duration(uint64_t usec){
+    if (usec < 1000)
+        printf("  %6" PRIu64 "us", usec);
+    else if (usec < 1000000)
+        printf("  %6.2fms", (usec / 1000.0));
+    else
+        printf("  %6.2fs ", (usec / 1000000.0));
+}
+
+
+
+
+#ifndef NDEBUG
+
+
+/******************************************************************************
+    * Unit Test Functions
+******************************************************************************/
+
+
+static void getidx_bucket_test(void);
+static void get_quantile_test(void);
+
+
+
+
+void stats_test(void){
+    do_test(getidx_bucket_test);
+    do_test(get_quantile_test);
+}
+
+
+
+
+static void getidx_bucket_test(void){
+    const struct {
+        const uint64_t val;
+        const int idx;
+        const uint64_t max;
+    }
+    // changeable part for updating test cases
+    table[] = {
+        {                    0,     0,                    0 },
+        {                    7,     7,                    7 },
+        {                    8,     8,                    8 },
+        {                   15,    15,                   15 },
+        {                   16,    16,                   17 },
+        {                   17,    16,                   17 },
+        {                   31,    23,                   31 },
+        {                 1000,    63,                 1023 },
+        {              1000000,   143,              1048575 },
+        {           UINT64_MAX,   495,           UINT64_MAX },
+        {                    0,    -1,                    0 }
+    };
+
+    int i;
+
+    for (i = 0; table[i].idx >= 0; i++){
+        assert(getidx_bucket(table[i].val) == table[i].idx);
+        assert(getmax_bucket(table[i].idx) == table[i].max);
+        assert(getidx_bucket(getmax_bucket(table[i].idx)) == table[i].idx);
+
+        print_progress_test_loop('\0', -1, i);
+        fprintf(stderr, "%" PRIu64 " -> %d\n", table[i].val, table[i].idx);
+    }
+
+    // every bucket is contiguous with the next one
+    for (i = 0; i < (STATS_BUCKETS_NUM - 1); i++)
+        assert(getidx_bucket(getmax_bucket(i) + 1) == (i + 1));
+}
+
+
+
+
+static void get_quantile_test(void){
+    const struct {
+        const uint64_t vals[8];
+        const unsigned int permille;
+        const uint64_t result;
+    }
+    // changeable part for updating test cases
+    table[] = {
+        { {    5                                     },  500,    5 },
+        { {    1,    2,    3,    4                   },  500,    2 },
+        { {    1,    2,    3,    4                   },  990,    4 },
+        { {  100,  100,  100,  100,  100, 9000       },  500,  103 },
+        { {  100,  100,  100,  100,  100, 9000       },  990, 9000 },
+        { {   20,   21,   22,   23,   24,   25       }, 1000,   25 },
+        { {    0                                     },    0,    0 }
+    };
+
+    int i, j;
+    stats_hist hist;
+
+    for (i = 0; table[i].permille; i++){
+        memset(&hist, 0, sizeof(stats_hist));
+
+        for (j = 0; (j < 8) && (table[i].vals[j] || (! j)); j++){
+            hist.count++;
+            hist.buckets[getidx_bucket(table[i].vals[j])]++;
+
+            if (hist.max < table[i].vals[j])
+                hist.max = table[i].vals[j];
+        }
+
+        assert(get_quantile(&hist, table[i].permille) == table[i].result);
+
+        print_progress_test_loop('\0', -1, i);
+        fprintf(stderr, "%" PRIu64 "\n", table[i].result);
+    }
+}
+
+
+#endif // NDEBUG
@@ -0,0 +1,307 @@
+/**
+ * @file benchgen.c
+ *
+ * Copyright (c) 2023 Tsukasa Inada
+ *
+ * @brief Described the extra command 'benchgen', that generates the synthetic inputs for the benchmarks.
+ * @author Tsukasa Inada
+ * @date 2023/10/14
+ *
+ * @note the generated inputs are the same as the ones used by 'dit bench' and 'dit test', if the seed is the same.
+ * @note implemented as a separate command so that the shell scripts can prepare the inputs at any scale.
+ */
+
+
+#include "debug.h"
+
+#include <assert.h>
+#include <errno.h>
+#include <getopt.h>
+#include <limits.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "workload.h"
+
+
+#define SUCCESS 0
+#define FAILURE 1
+
+
+/** Data type for storing the results of option parse */
+typedef struct {
+    size_t count;           /** the number of lines or entries */
+    uint64_t seed;          /** the seed of the pseudo-random number generator */
+    workload_tree shape;    /** the shape of the directory tree */
+} benchgen_opts;
+
+
+static int parse_opts(int argc, char **argv, benchgen_opts *opt);
+static bool parse_number(const char *arg, unsigned long long max, unsigned long long *p_num);
+static int do_benchgen(int kind, const char *dest, benchgen_opts *opt);
+
+static void benchgen_manual(void);
+
+
+/** string representing an invoked command name */
+static const char *program_name;
+
+
+
+
+/******************************************************************************
+    * Global Main Interface
+******************************************************************************/
+
+
+/**
+ * @brief the extra command 'benchgen'
+ *
+ * @param[in]  argc  the number of command line arguments
+ * @param[in]  argv  array of strings that are command line arguments
+ * @return int  command's exit status
+ */
+int main(int argc, char **argv){
+    benchgen_opts opt;
+    const char *dest = NULL;
+    int i, kind;
+
+    if ((argc <= 0) || (! (argv && (program_name = *argv))))
+        return -1;
+
+    if ((i = parse_opts(argc, argv, &opt)))
+        return (i > 0) ? SUCCESS : FAILURE;
+
+    argc -= optind;
+    argv += optind;
+
+    if (argc <= 0){
+        fprintf(stderr, "%s: requires the kind of inputs\n", program_name);
+        return FAILURE;
+    }
+
+    for (kind = 0; strcmp(*argv, workload_kinds[kind]);)
+        if (++kind == WORKLOAD_KINDS_NUM){
+            fprintf(stderr, "%s: invalid kind of inputs: '%s'\n", program_name, *argv);
+            return FAILURE;
+        }
+
+    if (argc > 1){
+        dest = argv[1];
+
+        if (argc > 2){
+            fprintf(stderr, "%s: too many arguments\n", program_name);
+            return FAILURE;
+        }
+    }
+    else if (kind == WORKLOAD_TREE){
+        fprintf(stderr, "%s: requires the root directory of the tree\n", program_name);
+        return FAILURE;
+    }
+
+    if (do_benchgen(kind, dest, &opt)){
+        fprintf(stderr, "%s: %s: %s\n", program_name, (dest ? dest : "stdout"), strerror(errno));
+        return FAILURE;
+    }
+    return SUCCESS;
+}
+
+
+
+
+/**
+ * @brief parse optional arguments.
+ *
+ * @param[in]  argc  the number of command line arguments
+ * @param[out] argv  array of strings that are command line arguments
+ * @param[out] opt  variable to store the results of option parse
+ * @return int  0 (parse success), 1 (normally exit) or -1 (error exit)
+ */
+static int parse_opts(int argc, char **argv, benchgen_opts *opt){
+    assert(opt);
+
+    const char *short_opts = "+b:d:f:lm:M:n:s:";
+
+    const struct option long_opts[] = {
+        { "binary",    required_argument, NULL, 'b' },
+        { "depth",     required_argument, NULL, 'd' },
+        { "fanout",    required_argument, NULL, 'f' },
+        { "log-scale", no_argument,       NULL, 'l' },
+        { "min-size",  required_argument, NULL, 'm' },
+        { "max-size",  required_argument, NULL, 'M' },
+        { "count",     required_argument, NULL, 'n' },
+        { "seed",      required_argument, NULL, 's' },
+        { "help",      no_argument,       NULL,  1  },
+        {  0,           0,                 0,    0  }
+    };
+
+    opt->count = 1000;
+    opt->seed = WORKLOAD_SEED;
+    opt->shape.fanout = 4;
+    opt->shape.depth = 2;
+    opt->shape.min_size = 0;
+    opt->shape.max_size = 65536;
+    opt->shape.log_scale = false;
+    opt->shape.binary = 25;
+
+    unsigned long long num;
+    int c;
+
+    while ((c = getopt_long(argc, argv, short_opts, long_opts, NULL)) >= 0){
+        if ((c > 1) && (c != 'l') && (c != '?')){
+            if (! parse_number(optarg, ((c == 'b') ? 100 : ((c == 'd') ? 16 : ULLONG_MAX)), &num)){
+                fprintf(stderr, "%s: invalid argument for '-%c': '%s'\n", program_name, c, optarg);
+                return -1;
+            }
+        }
+
+        switch (c){
+            case 'b':
+                opt->shape.binary = num;
+                break;
+            case 'd':
+                opt->shape.depth = num;
+                break;
+            case 'f':
+                opt->shape.fanout = (num < UINT_MAX) ? num : UINT_MAX;
+                break;
+            case 'l':
+                opt->shape.log_scale = true;
+                break;
+            case 'm':
+                opt->shape.min_size = (num < SIZE_MAX) ? num : SIZE_MAX;
+                break;
+            case 'M':
+                opt->shape.max_size = (num < SIZE_MAX) ? num : SIZE_MAX;
+                break;
+            case 'n':
+                opt->count = (num < SIZE_MAX) ? num : SIZE_MAX;
+                break;
+            case 's':
+                opt->seed = num;
+                break;
+            case 1:
+                benchgen_manual();
+                return 1;
+            default:
+                return -1;
+        }
+    }
+
+    if (opt->shape.min_size > opt->shape.max_size){
+        fprintf(stderr, "%s: the minimum size exceeds the maximum size\n", program_name);
+        return -1;
+    }
+    return 0;
+}
+
+
+/**
+ * @brief parse the string as a non-negative integer.
+ *
+ * @param[in]  arg  target string
+ * @param[in]  max  the maximum acceptable value
+ * @param[out] p_num  variable to store the resulting integer
+ * @return bool  successful or not
+ */
+static bool parse_number(const char *arg, unsigned long long max, unsigned long long *p_num){
+    assert(arg);
+    assert(p_num);
+
+    char *endptr;
+
+    if ((*arg < '0') || (*arg > '9'))
+        return false;
+
+    errno = 0;
+    *p_num = strtoull(arg, &endptr, 10);
+
+    return (! (errno || *endptr)) && (*p_num <= max);
+}
+
+
+
+
+/**
+ * @brief generate the specified kind of inputs.
+ *
+ * @param[in]  kind  ID of the kind of inputs
+ * @param[in]  dest  the output file or the root directory, or NULL
+ * @param[in]  opt  variable to store the results of option parse
+ * @return int  0 (success) or -1 (unexpected error)
+ *
+ * @note if the output file is NULL or "-", the generated contents are written to stdout.
+ */
+static int do_benchgen(int kind, const char *dest, benchgen_opts *opt){
+    assert(opt);
+
+    int (* const gen_funcs[WORKLOAD_TREE])(FILE *, workload_rng *, size_t, size_t *) = {
+        gen_workload_history,
+        gen_workload_dockerfile,
+        gen_workload_ignore
+    };
+
+    workload_rng rng;
+    FILE *fp;
+    int exit_status;
+
+    workload_seed(&rng, opt->seed);
+
+    if (kind == WORKLOAD_TREE){
+        assert(dest);
+        return gen_workload_tree(dest, &rng, &(opt->shape), NULL);
+    }
+
+    assert((kind >= 0) && (kind < WORKLOAD_TREE));
+
+    if (! (dest && strcmp(dest, "-")))
+        fp = stdout;
+    else if (! (fp = fopen(dest, "w")))
+        return -1;
+
+    exit_status = gen_funcs[kind](fp, &rng, opt->count, NULL);
+
+    if (fp == stdout){
+        if (fflush(fp))
+            exit_status = -1;
+    }
+    else if (fclose(fp))
+        exit_status = -1;
+
+    return exit_status;
+}
+
+
+
+
+/**
+ * @brief print the manual of this command.
+ */
+static void benchgen_manual(void){
+    printf(
+        "Usages:\n"
+        "  %s [OPTION]... history|dockerfile|ignore [FILE]\n"
+        "  %s [OPTION]... tree DIR\n"
+        "Generate the synthetic inputs for the benchmarks from a seed.\n"
+        "\n"
+        "Options:\n"
+        "  -n, --count=NUM       generate NUM lines of history-file or Dockerfile, or NUM entries of ignore-file\n"
+        "                          (1000 by default)\n"
+        "  -s, --seed=NUM        use NUM as the seed of the pseudo-random number generator\n"
+        "  -f, --fanout=NUM      put NUM files and NUM subdirectories in each directory (4 by default)\n"
+        "  -d, --depth=NUM       nest the subdirectories NUM levels deep (2 by default)\n"
+        "  -m, --min-size=SIZE   make each file at least SIZE bytes (0 by default)\n"
+        "  -M, --max-size=SIZE   make each file at most SIZE bytes (65536 by default)\n"
+        "  -l, --log-scale       distribute the file sizes evenly on a logarithmic scale\n"
+        "  -b, --binary=PERCENT  fill PERCENT of the files with incompressible bytes (25 by default)\n"
+        "      --help            display this help, and exit normally\n"
+        "\n"
+        "Remarks:\n"
+        "  - If FILE is omitted or '-', the generated contents are written to standard output.\n"
+        "  - The files other than the incompressible ones consist of words separated by spaces and newlines.\n",
+        program_name, program_name
+    );
+}
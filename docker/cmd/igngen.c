@@ -0,0 +1,427 @@
+/**
+ * @file igngen.c
+ *
+ * Copyright (c) 2023 Tsukasa Inada
+ *
+ * @brief Described the extra command 'igngen', that compiles the base ignore-files into the C source of the tables.
+ * @author Tsukasa Inada
+ * @date 2023/10/20
+ *
+ * @note run at build time, so that the dit commands can use the default ignore sets without parsing any JSON.
+ * @note each table keeps the values in the layout of yyjson, and finds the command names by perfect hashing.
+ */
+
+
+#include "debug.h"
+
+#include <assert.h>
+#include <errno.h>
+#include <inttypes.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "igntab.h"
+#include "yyjson.h"
+
+
+#define SUCCESS 0
+#define FAILURE 1
+
+#define IGNGEN_LINE_MAX 96
+
+
+/** Data type for storing the perfect hash table built for the command names in one base ignore-file */
+typedef struct {
+    uint32_t *disps;          /** the displacement of each bucket */
+    uint32_t *slots;          /** index of the key stored in each slot, or 'IGNTAB_EMPTY_SLOT' */
+    uint32_t buckets_num;     /** the number of buckets */
+    uint32_t slots_num;       /** the number of slots */
+} igngen_hash;
+
+
+static int do_igngen(const char * const *file_names);
+static bool build_perfect_hash(yyjson_val *root, igngen_hash *hash);
+static void emit_table(yyjson_doc *idoc, const igngen_hash *hash, const char *text, size_t len, char suffix);
+static void emit_string(const char *str, size_t len, bool split_lines);
+
+static void igngen_manual(void);
+
+
+/** string representing an invoked command name */
+static const char *program_name;
+
+
+
+
+/******************************************************************************
+    * Global Main Interface
+******************************************************************************/
+
+
+/**
+ * @brief the extra command 'igngen'
+ *
+ * @param[in]  argc  the number of command line arguments
+ * @param[in]  argv  array of strings that are command line arguments
+ * @return int  command's exit status
+ */
+int main(int argc, char **argv){
+    if ((argc <= 0) || (! (argv && (program_name = *argv))))
+        return -1;
+
+    if ((argc == 2) && (! strcmp(argv[1], "--help"))){
+        igngen_manual();
+        return SUCCESS;
+    }
+
+    if (argc != 3){
+        fprintf(stderr, "%s: requires the base ignore-files for history-file and Dockerfile\n", program_name);
+        return FAILURE;
+    }
+
+    return do_igngen((const char * const *) (argv + 1));
+}
+
+
+
+
+/**
+ * @brief compile the base ignore-files, and write the resulting C source to standard output.
+ *
+ * @param[in]  file_names  array of length 2 storing the base ignore-files for history-file and Dockerfile
+ * @return int  command's exit status
+ *
+ * @note the contents written when resetting are made by the same writer flag as the dit command 'ignore'.
+ */
+static int do_igngen(const char * const *file_names){
+    assert(file_names);
+
+    yyjson_doc *idocs[2] = {0};
+    yyjson_read_err err;
+    igngen_hash hashes[2] = {0};
+    char *texts[2] = {0};
+    size_t lens[2];
+    int i, exit_status = FAILURE;
+
+    for (i = 0; i < 2; i++){
+        if (! (idocs[i] = yyjson_read_file(file_names[i], 0, NULL, &err))){
+            fprintf(stderr, "%s: %s: %s\n", program_name, file_names[i], err.msg);
+            goto exit;
+        }
+        if (! yyjson_is_obj(idocs[i]->root)){
+            fprintf(stderr, "%s: %s: not a JSON object\n", program_name, file_names[i]);
+            goto exit;
+        }
+        if (yyjson_doc_get_val_count(idocs[i]) >= IGNTAB_EMPTY_SLOT){
+            fprintf(stderr, "%s: %s: too many values\n", program_name, file_names[i]);
+            goto exit;
+        }
+        if (! ((texts[i] = yyjson_write(idocs[i], IG_WRITER_FLAG, (lens + i))) && build_perfect_hash(idocs[i]->root, (hashes + i)))){
+            fprintf(stderr, "%s: %s: %s\n", program_name, file_names[i], strerror(errno));
+            goto exit;
+        }
+    }
+
+    printf(
+        "/**\n"
+        " * @file igntab.c\n"
+        " *\n"
+        " * @brief Generated by 'igngen' from '%s' and '%s', so do not edit it by hand.\n"
+        " */\n"
+        "\n"
+        "#include \"igntab.h\"\n",
+        file_names[0], file_names[1]
+    );
+
+    for (i = 0; i < 2; i++)
+        emit_table(idocs[i], (hashes + i), texts[i], lens[i], "hd"[i]);
+
+    fputs("\n\nconst ignore_table ignore_tables[2] = {\n", stdout);
+
+    for (i = 0; i < 2; i++)
+        printf(
+            "    { ignore_vals_%c, ignore_disps_%c, ignore_slots_%c, %" PRIu32 ", %" PRIu32 ", ignore_text_%c, %zu }%s\n",
+            "hd"[i], "hd"[i], "hd"[i], hashes[i].buckets_num, hashes[i].slots_num, "hd"[i], lens[i], (i ? "" : ",")
+        );
+
+    fputs("};\n", stdout);
+
+    if (fflush(stdout))
+        fprintf(stderr, "%s: stdout: %s\n", program_name, strerror(errno));
+    else
+        exit_status = SUCCESS;
+
+exit:
+    for (i = 0; i < 2; i++){
+        yyjson_doc_free(idocs[i]);
+        free(texts[i]);
+        free(hashes[i].disps);
+        free(hashes[i].slots);
+    }
+
+    return exit_status;
+}
+
+
+/**
+ * @brief build the perfect hash table for the command names by hashing and displacing the buckets.
+ *
+ * @param[in]  root  the root object of the base ignore-file
+ * @param[out] hash  variable to store the resulting table
+ * @return bool  successful or not
+ *
+ * @note the larger buckets are placed first, since they are the harder ones to find free slots for.
+ * @note the later duplicates of a command name are left out, as 'yyjson_obj_getn' finds the first one.
+ */
+static bool build_perfect_hash(yyjson_val *root, igngen_hash *hash){
+    assert(yyjson_is_obj(root));
+    assert(hash);
+
+    size_t keys_num, i, j, k;
+    uint32_t *keys, *bucket_of, *sizes, *order, *tmp, disp, b;
+    yyjson_val *ikey;
+    bool success = false;
+
+    keys_num = yyjson_obj_size(root);
+
+    hash->buckets_num = (keys_num + IGNTAB_BUCKET_SIZE - 1) / IGNTAB_BUCKET_SIZE;
+    hash->slots_num = (keys_num * 100) / IGNTAB_LOAD_PERCENT + 1;
+
+    if (! hash->buckets_num)
+        hash->buckets_num = 1;
+
+    keys = (uint32_t *) malloc(sizeof(uint32_t) * (keys_num + 1));
+    bucket_of = (uint32_t *) malloc(sizeof(uint32_t) * (keys_num + 1));
+    sizes = (uint32_t *) calloc(hash->buckets_num, sizeof(uint32_t));
+    order = (uint32_t *) malloc(sizeof(uint32_t) * hash->buckets_num);
+    tmp = (uint32_t *) malloc(sizeof(uint32_t) * (keys_num + 1));
+    hash->disps = (uint32_t *) calloc(hash->buckets_num, sizeof(uint32_t));
+    hash->slots = (uint32_t *) malloc(sizeof(uint32_t) * hash->slots_num);
+
+    if (! (keys && bucket_of && sizes && order && tmp && hash->disps && hash->slots))
+        goto exit;
+
+    for (i = 0; i < hash->slots_num; i++)
+        hash->slots[i] = IGNTAB_EMPTY_SLOT;
+
+    // the command names except duplicates, and the bucket of each of them
+    for (i = 0, k = 0, ikey = root + 1; i < keys_num; i++, ikey = unsafe_yyjson_get_next(ikey + 1)){
+        for (j = 0; j < k; j++)
+            if (yyjson_equals_strn((root + keys[j]), yyjson_get_str(ikey), yyjson_get_len(ikey)))
+                break;
+
+        if (j == k){
+            keys[k] = ikey - root;
+            bucket_of[k] = igntab_hash(yyjson_get_str(ikey), yyjson_get_len(ikey), 0) % hash->buckets_num;
+            sizes[bucket_of[k++]]++;
+        }
+    }
+    keys_num = k;
+
+    // insertion sort of the buckets in descending order of their sizes
+    for (i = 0; i < hash->buckets_num; i++){
+        for (b = i, j = i; j && (sizes[order[j - 1]] < sizes[b]); j--)
+            order[j] = order[j - 1];
+        order[j] = b;
+    }
+
+    for (i = 0; i < hash->buckets_num; i++){
+        b = order[i];
+
+        for (disp = 1; disp != IGNTAB_EMPTY_SLOT; disp++){
+            size_t n = 0;
+
+            for (k = 0; k < keys_num; k++)
+                if (bucket_of[k] == b){
+                    ikey = root + keys[k];
+                    tmp[n] = igntab_hash(yyjson_get_str(ikey), yyjson_get_len(ikey), disp) % hash->slots_num;
+
+                    if (hash->slots[tmp[n]] != IGNTAB_EMPTY_SLOT)
+                        break;
+                    for (j = 0; (j < n) && (tmp[j] != tmp[n]); j++);
+                    if (j < n)
+                        break;
+
+                    n++;
+                }
+
+            if (k == keys_num){
+                for (n = 0, k = 0; k < keys_num; k++)
+                    if (bucket_of[k] == b)
+                        hash->slots[tmp[n++]] = keys[k];
+
+                hash->disps[b] = disp;
+                break;
+            }
+        }
+
+        if (disp == IGNTAB_EMPTY_SLOT){
+            errno = EAGAIN;
+            goto exit;
+        }
+    }
+
+    success = true;
+
+exit:
+    free(keys);
+    free(bucket_of);
+    free(sizes);
+    free(order);
+    free(tmp);
+
+    return success;
+}
+
+
+
+
+/**
+ * @brief emit the C source of the table for one base ignore-file.
+ *
+ * @param[in]  idoc  the base ignore-file
+ * @param[in]  hash  the perfect hash table for its command names
+ * @param[in]  text  the contents written when it is reset
+ * @param[in]  len  the length of the contents
+ * @param[in]  suffix  'h' (history-file) or 'd' (Dockerfile)
+ *
+ * @note the strings are gathered into one array, each of which is null-terminated as yyjson expects.
+ * @note the payload other than strings and containers is emitted as its bit pattern.
+ */
+static void emit_table(yyjson_doc *idoc, const igngen_hash *hash, const char *text, size_t len, char suffix){
+    assert(idoc);
+    assert(hash);
+    assert(text);
+
+    yyjson_val *ival;
+    size_t vals_num, i, offset = 0;
+    uint8_t type;
+
+    vals_num = yyjson_doc_get_val_count(idoc);
+
+    printf("\n\nstatic const char ignore_strs_%c[] =\n", suffix);
+
+    for (ival = idoc->root, i = 0; i < vals_num; ival++, i++){
+        type = yyjson_get_type(ival);
+
+        if ((type == YYJSON_TYPE_STR) || (type == YYJSON_TYPE_RAW)){
+            fputs("    ", stdout);
+            emit_string(unsafe_yyjson_get_str(ival), (unsafe_yyjson_get_len(ival) + 1), false);
+            fputc('\n', stdout);
+        }
+    }
+
+    printf("    \"\";\n\nstatic const yyjson_val ignore_vals_%c[%zu] = {\n", suffix, vals_num);
+
+    for (ival = idoc->root, i = 0; i < vals_num; ival++, i++){
+        printf("    { UINT64_C(0x%016" PRIx64 "), ", ival->tag);
+
+        switch ((type = yyjson_get_type(ival))){
+            case YYJSON_TYPE_STR:
+            case YYJSON_TYPE_RAW:
+                printf("{ .str = ignore_strs_%c + %zu }", suffix, offset);
+                offset += unsafe_yyjson_get_len(ival) + 1;
+                break;
+            case YYJSON_TYPE_ARR:
+            case YYJSON_TYPE_OBJ:
+                printf("{ .ofs = %zu }", ival->uni.ofs);
+                break;
+            case YYJSON_TYPE_NUM:
+                printf("{ .u64 = UINT64_C(0x%016" PRIx64 ") }", ival->uni.u64);
+                break;
+            default:
+                fputs("{ 0 }", stdout);
+        }
+
+        fputs(((i + 1) < vals_num) ? " },\n" : " }\n", stdout);
+    }
+
+    printf("};\n\nstatic const uint32_t ignore_disps_%c[%" PRIu32 "] = {", suffix, hash->buckets_num);
+
+    for (i = 0; i < hash->buckets_num; i++)
+        printf("%s%" PRIu32 "%s", ((i % 12) ? " " : "\n    "), hash->disps[i], (((i + 1) < hash->buckets_num) ? "," : ""));
+
+    printf("\n};\n\nstatic const uint32_t ignore_slots_%c[%" PRIu32 "] = {", suffix, hash->slots_num);
+
+    for (i = 0; i < hash->slots_num; i++){
+        fputs(((i % 8) ? " " : "\n    "), stdout);
+
+        if (hash->slots[i] != IGNTAB_EMPTY_SLOT)
+            printf("%" PRIu32, hash->slots[i]);
+        else
+            fputs("IGNTAB_EMPTY_SLOT", stdout);
+
+        if ((i + 1) < hash->slots_num)
+            fputc(',', stdout);
+    }
+
+    printf("\n};\n\nstatic const char ignore_text_%c[] =\n    ", suffix);
+    emit_string(text, len, true);
+    fputs(";\n", stdout);
+}
+
+
+/**
+ * @brief emit the bytes as C string literals.
+ *
+ * @param[in]  str  the bytes (may contain null characters)
+ * @param[in]  len  the number of bytes
+ * @param[in]  split_lines  whether to begin a new literal after each newline
+ *
+ * @note the bytes other than printable ASCII characters are escaped in three octal digits,
+ * @note so that the following digits are never taken as a part of the escape sequence.
+ */
+static void emit_string(const char *str, size_t len, bool split_lines){
+    assert(str || (! len));
+
+    size_t width = 0;
+    unsigned char c;
+
+    fputc('"', stdout);
+
+    while (len--){
+        c = *(str++);
+
+        if ((c == '"') || (c == '\\') || (c == '?'))
+            width += printf("\\%c", c);
+        else if (c == '\n'){
+            fputs("\\n", stdout);
+            width += 2;
+        }
+        else if ((c >= 0x20) && (c < 0x7f)){
+            fputc(c, stdout);
+            width++;
+        }
+        else
+            width += printf("\\%03o", c);
+
+        if (len && ((split_lines && (c == '\n')) || (width >= IGNGEN_LINE_MAX))){
+            fputs("\"\n    \"", stdout);
+            width = 0;
+        }
+    }
+
+    fputc('"', stdout);
+}
+
+
+
+
+/**
+ * @brief display the manual for this command.
+ *
+ */
+static void igngen_manual(void){
+    printf(
+        "Usage: %s HISTORY-BASE DOCKERFILE-BASE\n"
+        "Compile the base ignore-files into the C source of the tables linked into the dit command.\n"
+        "\n"
+        "Remarks:\n"
+        "  - The C source is written to standard output.\n"
+        "  - Each base ignore-file must be a JSON object associating command names with their details.\n",
+        program_name
+    );
+}
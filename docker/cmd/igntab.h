@@ -0,0 +1,111 @@
+#ifndef DIT_IGNORE_TABLES
+#define DIT_IGNORE_TABLES
+
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "yyjson.h"
+
+
+/******************************************************************************
+    * commonly used Macros
+******************************************************************************/
+
+#ifdef NDEBUG
+    #define IG_WRITER_FLAG  YYJSON_WRITE_NOFLAG
+#else
+    #define IG_WRITER_FLAG  YYJSON_WRITE_PRETTY
+#endif
+
+
+#define IGNTAB_BUCKET_SIZE 4
+#define IGNTAB_LOAD_PERCENT 80
+
+#define IGNTAB_EMPTY_SLOT UINT32_MAX
+
+
+
+
+/******************************************************************************
+    * commonly used Data Types
+******************************************************************************/
+
+/**
+ * Data type for storing the default ignore set of one target, compiled from its base ignore-file by 'igngen'
+ *
+ * @note 'vals' has the same layout as the values of an immutable JSON document, so yyjson can read it as it is.
+ * @note each command name is found by hashing it into a bucket, whose displacement rehashes it into a slot.
+ */
+typedef struct {
+    const yyjson_val *vals;      /** the values of the base ignore-file, whose first one is the root object */
+    const uint32_t *disps;       /** the displacement of each bucket */
+    const uint32_t *slots;       /** index in 'vals' of the key stored in each slot, or 'IGNTAB_EMPTY_SLOT' */
+    uint32_t buckets_num;        /** the number of buckets */
+    uint32_t slots_num;          /** the number of slots */
+    const char *text;            /** the contents of the ignore-file written when it is reset */
+    size_t text_len;             /** the length of the contents */
+} ignore_table;
+
+
+
+
+/******************************************************************************
+    * Interface for the Ignore Tables
+******************************************************************************/
+
+extern const ignore_table ignore_tables[2];
+
+
+/**
+ * @brief hash the command name with the seed, in the same way at build time and at run time.
+ *
+ * @param[in]  name  the command name (may not be null-terminated)
+ * @param[in]  len  the length of the command name
+ * @param[in]  seed  0 for choosing the bucket, or the displacement for choosing the slot
+ * @return uint64_t  the resulting hash value
+ *
+ * @note FNV-1a, whose initial state is perturbed by the seed and whose upper bits are folded at the end.
+ */
+static inline uint64_t igntab_hash(const char *name, size_t len, uint64_t seed){
+    uint64_t hash;
+
+    hash = UINT64_C(14695981039346656037) ^ (seed * UINT64_C(0x9E3779B97F4A7C15));
+
+    while (len--){
+        hash ^= (unsigned char) *(name++);
+        hash *= UINT64_C(1099511628211);
+    }
+
+    return hash ^ (hash >> 29);
+}
+
+
+/**
+ * @brief look up the command name in the compiled ignore set, as 'yyjson_obj_getn' does for its root object.
+ *
+ * @param[in]  table  the compiled ignore set
+ * @param[in]  name  the command name (may not be null-terminated)
+ * @param[in]  len  the length of the command name
+ * @return yyjson_val*  the value associated with the command name, or NULL
+ */
+static inline yyjson_val *igntab_lookup(const ignore_table *table, const char *name, size_t len){
+    uint32_t disp, idx;
+    yyjson_val *ikey;
+
+    disp = table->disps[igntab_hash(name, len, 0) % table->buckets_num];
+    idx = table->slots[igntab_hash(name, len, disp) % table->slots_num];
+
+    if (idx != IGNTAB_EMPTY_SLOT){
+        ikey = (yyjson_val *) (table->vals + idx);
+
+        if ((unsafe_yyjson_get_len(ikey) == len) && (! memcmp(unsafe_yyjson_get_str(ikey), name, len)))
+            return ikey + 1;
+    }
+
+    return NULL;
+}
+
+
+#endif // DIT_IGNORE_TABLES
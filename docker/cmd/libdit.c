@@ -0,0 +1,1955 @@
+/**
+ * @file libdit.c
+ *
+ * Copyright (c) 2023 Tsukasa Inada
+ *
+ * @brief Described the library that lets other programs do what some dit commands do, without executing them.
+ * @author Tsukasa Inada
+ * @date 2023/10/19
+ *
+ * @note Every function takes a handle holding the root of the internal files, the loaded ignore-files and the last error.
+ * @note No function refers to any global variable, so that each thread can call them with its own handle.
+ * @note The files are shared with the dit commands in the same format, including the provisional report and the
+ *       log-files for 'dit erase', so that the prompt and undoing also see the changes made through this library.
+ * @note Those two formats are implemented only here, and the dit commands also read and write them through it.
+ * @note The provisional report is locked by 'flock' while the files are edited, and 'dit reflect', 'dit erase'
+ *       and the prompt take the same lock, so that they never edit the same files at the same time.
+ */
+
+#include "igntab.h"
+#include "libdit.h"
+#include "yyjson.h"
+
+#include <assert.h>
+#include <ctype.h>
+#include <errno.h>
+#include <limits.h>
+#include <stdarg.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+
+#include <sys/types.h>
+
+#include <dirent.h>
+#include <fcntl.h>
+#include <getopt.h>
+#include <sys/file.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#define LIBDIT_DOCKER_FILE "/mnt/Dockerfile.draft"
+#define LIBDIT_HISTORY_FILE "/mnt/.dit_history"
+#define LIBDIT_DOCKER_FILE_BASE "/etc/Dockerfile.base"
+
+#define LIBDIT_REFLECT_FILE_P "/srv/reflect-report.prov"
+
+#define LIBDIT_ERASE_RESULT_FILE_D "/srv/erase-result.dock"
+#define LIBDIT_ERASE_RESULT_FILE_H "/srv/erase-result.hist"
+
+#define LIBDIT_ERASE_FILE_D "/var/erase.log.dock"
+#define LIBDIT_ERASE_FILE_H "/var/erase.log.hist"
+
+#define LIBDIT_IGNORE_FILE_D "/var/ignore.json.dock"
+#define LIBDIT_IGNORE_FILE_H "/var/ignore.json.hist"
+
+#define LIBDIT_ROOT_MAX (PATH_MAX - 32)
+#define LIBDIT_INITIAL_LINES_MAX 15  // 2^n - 1
+
+#define LIBDIT_INSTRS_NUM 18
+#define LIBDIT_INSTR_LEN_MAX 11
+
+#define LIBDIT_ID_CMD          2
+#define LIBDIT_ID_ENTRYPOINT   4
+#define LIBDIT_ID_FROM         7
+#define LIBDIT_ID_MAINTAINER  10
+
+#define IG_CONDITIONS_NUM   7
+
+#define IG_SHORT_OPTS       0
+#define IG_LONG_OPTS        1
+#define IG_OPTARGS          2
+#define IG_FIRST_ARGS       3
+#define IG_MAX_ARGC         4
+#define IG_DETECT_ANYMATCH  5
+#define IG_INVERT_FLAG      6
+
+#define check_if_valid_target(target)  (((target) == DIT_TARGET_HISTORY) || ((target) == DIT_TARGET_DOCKERFILE))
+
+
+/** Data type for the handle that holds everything a host needs to call the functions of this library */
+struct dit_ctx {
+    char root[LIBDIT_ROOT_MAX];        /** the directory where the internal files of dit are placed */
+    yyjson_doc *ignores[2];            /** the ignore-file loaded for each target, or NULL */
+    const ignore_table *bases[2];      /** the default ignore set used for each target instead of a file, or NULL */
+    char error[DIT_ERROR_MAX];         /** the message describing the last error */
+};
+
+
+/** Data type for storing the state of scanning the arguments in the same way as glibc 'getopt_long' */
+typedef struct {
+    char * const *argv;        /** array of strings that are command line arguments, which is never permuted */
+    int argc;                  /** array size */
+    int optind;                /** index of the next argument to be scanned */
+    const char *nextchar;      /** the rest of the short options being scanned, or NULL */
+    const char *optarg;        /** the argument of the option just scanned, or NULL */
+    const char *first_arg;     /** the first non-optional argument, or NULL */
+    int args_num;              /** the number of non-optional arguments */
+} ig_scan;
+
+
+/** Data type for storing a long option accepted by the detailed conditions */
+typedef struct {
+    const char *name;          /** option name */
+    int has_arg;               /** whether to take an argument, in the same way as 'struct option' */
+} ig_long_opt;
+
+
+static int set_error(dit_ctx *ctx, const char *format, ...);
+static bool make_path(dit_ctx *ctx, const char *file_name, char *path);
+
+static int erase_lines(dit_ctx *ctx, int target, dit_line_pred pred, void *arg, dit_lines *erased, int reflecteds[2]);
+static int read_lines(dit_ctx *ctx, const char *path, char **p_buf, size_t *p_lines_num);
+static int append_line(dit_ctx *ctx, dit_lines *lines, const char *line, size_t lineno, size_t *p_max);
+static int get_instr_id(const char *line);
+static bool check_if_cmd_or_entrypoint(const char *line, size_t lineno, void *arg);
+
+static FILE *lock_provisional_report(dit_ctx *ctx, int reflecteds[2]);
+static int unlock_provisional_report(dit_ctx *ctx, FILE *fp, const int reflecteds[2]);
+
+static bool match_ignore_set(yyjson_val *root, const ignore_table *table, int argc, char * const *argv);
+static int scan_next_option(ig_scan *scan, const char *short_opts, const ig_long_opt *long_opts, size_t size, size_t *p_idx);
+static void record_arg(ig_scan *scan, const char *arg);
+static bool check_short_opts(const char *target);
+static yyjson_val *get_setting_entity(yyjson_val *iobj, const ignore_table *table, const char *name, size_t len);
+static bool check_if_contained(const char *target, yyjson_val *ival);
+
+static bool walk_tree(int pwdfd, const char *name, int type, dit_walk_func func, void *arg);
+
+
+/** array of the names of the target files, in the order of the targets */
+static const char * const target_files[2] = {
+    LIBDIT_HISTORY_FILE,
+    LIBDIT_DOCKER_FILE
+};
+
+/** array of the names of the files for storing the lines deleted last time, in the order of the targets */
+static const char * const erase_results[2] = {
+    LIBDIT_ERASE_RESULT_FILE_H,
+    LIBDIT_ERASE_RESULT_FILE_D
+};
+
+/** array of the names of the log-files for 'dit erase', in the order of the targets */
+static const char * const erase_logs[2] = {
+    LIBDIT_ERASE_FILE_H,
+    LIBDIT_ERASE_FILE_D
+};
+
+/** array of the names of the ignore-files, in the order of the targets */
+static const char * const ignore_files[2] = {
+    LIBDIT_IGNORE_FILE_H,
+    LIBDIT_IGNORE_FILE_D
+};
+
+/** array of the Dockerfile instructions, sorted in the same way as 'docker_instr_reprs' */
+static const char * const instr_names[LIBDIT_INSTRS_NUM] = {
+    "ADD",
+    "ARG",
+    "CMD",
+    "COPY",
+    "ENTRYPOINT",
+    "ENV",
+    "EXPOSE",
+    "FROM",
+    "HEALTHCHECK",
+    "LABEL",
+    "MAINTAINER",
+    "ONBUILD",
+    "RUN",
+    "SHELL",
+    "STOPSIGNAL",
+    "USER",
+    "VOLUME",
+    "WORKDIR"
+};
+
+/** array of keys pointing to each detailed condition in the ignore-file */
+static const char * const conds_keys[IG_CONDITIONS_NUM] = {
+    "short_opts",
+    "long_opts",
+    "optargs",
+    "first_args",
+    "max_argc",
+    "detect_anymatch",
+    "invert_flag"
+};
+
+
+
+
+/******************************************************************************
+    * Handle
+******************************************************************************/
+
+
+/**
+ * @brief create a handle for calling the functions of this library.
+ *
+ * @param[in]  root  the directory where the internal files of dit are placed, or NULL for '/dit'
+ * @return dit_ctx*  the resulting handle, or NULL with 'errno' set
+ *
+ * @attention the handle must be released by 'dit_close', and must not be shared by threads at the same time.
+ */
+dit_ctx *dit_open(const char *root){
+    dit_ctx *ctx;
+    size_t len;
+
+    if (! root)
+        root = DIT_DEFAULT_ROOT;
+
+    for (len = strlen(root); (len > 1) && (root[len - 1] == '/'); len--);
+
+    if (len >= LIBDIT_ROOT_MAX){
+        errno = ENAMETOOLONG;
+        return NULL;
+    }
+
+    if ((ctx = (dit_ctx *) calloc(1, sizeof(dit_ctx)))){
+        memcpy(ctx->root, root, len);
+        ctx->root[len] = '\0';
+    }
+
+    return ctx;
+}
+
+
+/**
+ * @brief release the handle and everything it holds.
+ *
+ * @param[out] ctx  the handle, or NULL
+ */
+void dit_close(dit_ctx *ctx){
+    if (ctx){
+        yyjson_doc_free(ctx->ignores[0]);
+        yyjson_doc_free(ctx->ignores[1]);
+        free(ctx);
+    }
+}
+
+
+/**
+ * @brief get the message describing the last error that occurred in the functions called with the handle.
+ *
+ * @param[in]  ctx  the handle
+ * @return const char*  the message, which is the empty string if no error has occurred
+ */
+const char *dit_strerror(const dit_ctx *ctx){
+    assert(ctx);
+
+    return ctx->error;
+}
+
+
+
+
+/******************************************************************************
+    * Reflect and Erase
+******************************************************************************/
+
+
+/**
+ * @brief reflect the specified lines in Dockerfile or history-file, as 'dit reflect' does.
+ *
+ * @param[out] ctx  the handle
+ * @param[in]  target  'DIT_TARGET_DOCKERFILE' or 'DIT_TARGET_HISTORY'
+ * @param[in]  lines  array of the lines without their newlines
+ * @param[in]  lines_num  array size
+ * @return int  0 (success) or -1 (error)
+ *
+ * @note if Dockerfile is empty, it is initialized based on its base file before the lines.
+ * @note reflecting CMD or ENTRYPOINT instruction deletes those already in Dockerfile, leaving only the new ones.
+ * @note no line is reflected unless all of them are valid.
+ */
+int dit_reflect(dit_ctx *ctx, int target, const char * const *lines, size_t lines_num){
+    assert(ctx);
+
+    char path[PATH_MAX], *base = NULL, *line;
+    size_t base_num = 0, i;
+    int reflecteds[2], id, exit_status = -1;
+    bool has_cmd = false, has_entrypoint = false;
+    struct stat file_stat;
+    FILE *report_fp, *fp;
+
+    if (! check_if_valid_target(target))
+        return set_error(ctx, "invalid target: %d", target);
+    if ((! lines) && lines_num)
+        return set_error(ctx, "no lines to be reflected");
+    if (lines_num >= INT_MAX)
+        return set_error(ctx, "too many lines to be reflected");
+
+    for (i = 0; i < lines_num; i++){
+        if ((! lines[i]) || strchr(lines[i], '\n'))
+            return set_error(ctx, "line %zu: not a single line", (i + 1));
+
+        if (target == DIT_TARGET_DOCKERFILE){
+            if ((id = get_instr_id(lines[i])) == -1)
+                return set_error(ctx, "line %zu: invalid instruction", (i + 1));
+            if ((id == LIBDIT_ID_FROM) || (id == LIBDIT_ID_MAINTAINER))
+                return set_error(ctx, "line %zu: instruction not allowed", (i + 1));
+
+            if (id == LIBDIT_ID_CMD){
+                if (has_cmd)
+                    return set_error(ctx, "line %zu: duplicated CMD instruction", (i + 1));
+                has_cmd = true;
+            }
+            else if (id == LIBDIT_ID_ENTRYPOINT){
+                if (has_entrypoint)
+                    return set_error(ctx, "line %zu: duplicated ENTRYPOINT instruction", (i + 1));
+                has_entrypoint = true;
+            }
+        }
+    }
+
+    if (! lines_num)
+        return 0;
+
+    if (! make_path(ctx, target_files[target], path))
+        return exit_status;
+    if (! (report_fp = lock_provisional_report(ctx, reflecteds)))
+        return exit_status;
+
+    if ((target == DIT_TARGET_DOCKERFILE) && (stat(path, &file_stat) || (! file_stat.st_size))){
+        char base_path[PATH_MAX];
+
+        if ((! make_path(ctx, LIBDIT_DOCKER_FILE_BASE, base_path)) || read_lines(ctx, base_path, &base, &base_num))
+            goto exit;
+
+        for (line = base, i = 0; i < base_num; line += strlen(line) + 1, i++)
+            if (((id = get_instr_id(line)) == -1) || ((! i) && (id != LIBDIT_ID_FROM))){
+                set_error(ctx, "%s: line %zu: invalid base of Dockerfile", base_path, (i + 1));
+                goto exit;
+            }
+
+        if (! base_num){
+            set_error(ctx, "%s: empty base of Dockerfile", base_path);
+            goto exit;
+        }
+    }
+    else if ((has_cmd || has_entrypoint) && erase_lines(ctx, target, check_if_cmd_or_entrypoint, NULL, NULL, reflecteds))
+        goto exit;
+
+    if (! (fp = fopen(path, "a"))){
+        set_error(ctx, "cannot open '%s': %m", path);
+        goto exit;
+    }
+
+    for (line = base, i = 0; i < base_num; line += strlen(line) + 1, i++)
+        fprintf(fp, "%s\n", line);
+    for (i = 0; i < lines_num; i++)
+        fprintf(fp, "%s\n", lines[i]);
+
+    if (fclose(fp)){
+        set_error(ctx, "cannot write '%s': %m", path);
+        goto exit;
+    }
+
+    if (reflecteds[target] <= (INT_MAX - ((int) (base_num + lines_num))))
+        reflecteds[target] += base_num + lines_num;
+    exit_status = 0;
+
+exit:
+    if (unlock_provisional_report(ctx, report_fp, reflecteds))
+        exit_status = -1;
+
+    free(base);
+    return exit_status;
+}
+
+
+/**
+ * @brief delete the lines chosen by the predicate from Dockerfile or history-file, as 'dit erase' does.
+ *
+ * @param[out] ctx  the handle
+ * @param[in]  target  'DIT_TARGET_DOCKERFILE' or 'DIT_TARGET_HISTORY'
+ * @param[in]  pred  the predicate called on each line, which returns true for the lines to be deleted
+ * @param[in]  arg  the argument passed to the predicate as it is
+ * @param[out] erased  variable to store the deleted lines, or NULL
+ * @return int  0 (success) or -1 (error)
+ *
+ * @note the log-file is updated so that 'dit erase -u' undoes the reflections except the deleted lines.
+ * @note the line maps no longer match the log-file, so 'dit' ignores them until it rebuilds them at the next prompt.
+ * @attention the deleted lines stored in 'erased' should be released by 'dit_free_lines'.
+ */
+int dit_erase(dit_ctx *ctx, int target, dit_line_pred pred, void *arg, dit_lines *erased){
+    assert(ctx);
+
+    int reflecteds[2], exit_status;
+    FILE *fp;
+
+    if (! check_if_valid_target(target))
+        return set_error(ctx, "invalid target: %d", target);
+    if (! pred)
+        return set_error(ctx, "no predicate to choose the lines");
+
+    if (! (fp = lock_provisional_report(ctx, reflecteds)))
+        return -1;
+
+    exit_status = erase_lines(ctx, target, pred, arg, erased, reflecteds);
+
+    if (unlock_provisional_report(ctx, fp, reflecteds))
+        exit_status = -1;
+
+    return exit_status;
+}
+
+
+/**
+ * @brief get the lines in history-file chosen by the predicate.
+ *
+ * @param[out] ctx  the handle
+ * @param[in]  pred  the predicate called on each line, or NULL to choose all lines
+ * @param[in]  arg  the argument passed to the predicate as it is
+ * @param[out] result  variable to store the chosen lines
+ * @return int  0 (success) or -1 (error)
+ *
+ * @attention the lines stored in 'result' should be released by 'dit_free_lines'.
+ */
+int dit_query_history(dit_ctx *ctx, dit_line_pred pred, void *arg, dit_lines *result){
+    assert(ctx);
+
+    char path[PATH_MAX], *buf, *line;
+    size_t lines_num, lines_max = 0, i;
+    int exit_status = -1;
+
+    if (! result)
+        return set_error(ctx, "no variable to store the lines");
+
+    result->lines = NULL;
+    result->linenos = NULL;
+    result->lines_num = 0;
+
+    if (make_path(ctx, target_files[DIT_TARGET_HISTORY], path) && (! read_lines(ctx, path, &buf, &lines_num))){
+        exit_status = 0;
+
+        for (line = buf, i = 0; i < lines_num; line += strlen(line) + 1, i++)
+            if (((! pred) || pred(line, (i + 1), arg)) && append_line(ctx, result, line, (i + 1), &lines_max)){
+                dit_free_lines(result);
+                exit_status = -1;
+                break;
+            }
+
+        free(buf);
+    }
+
+    return exit_status;
+}
+
+
+/**
+ * @brief release the lines stored by the functions of this library.
+ *
+ * @param[out] lines  variable storing the lines
+ */
+void dit_free_lines(dit_lines *lines){
+    if (lines){
+        for (size_t i = lines->lines_num; i--;)
+            free(lines->lines[i]);
+
+        free(lines->lines);
+        free(lines->linenos);
+
+        lines->lines = NULL;
+        lines->linenos = NULL;
+        lines->lines_num = 0;
+    }
+}
+
+
+
+
+/**
+ * @brief delete the lines chosen by the predicate, while the provisional report is locked.
+ *
+ * @param[out] ctx  the handle
+ * @param[in]  target  'DIT_TARGET_DOCKERFILE' or 'DIT_TARGET_HISTORY'
+ * @param[in]  pred  the predicate called on each line
+ * @param[in]  arg  the argument passed to the predicate as it is
+ * @param[out] erased  variable to store the deleted lines, or NULL
+ * @param[out] reflecteds  array of length 2 storing the provisional number of reflected lines
+ * @return int  0 (success) or -1 (error)
+ *
+ * @note the lines reflected after the last prompt are counted in 'reflecteds', and the others in the log-file.
+ * @note if the log-file does not match the target file, it is reset as if all lines were reflected at once.
+ */
+static int erase_lines(dit_ctx *ctx, int target, dit_line_pred pred, void *arg, dit_lines *erased, int reflecteds[2]){
+    assert(ctx);
+    assert(check_if_valid_target(target));
+    assert(pred);
+    assert(reflecteds);
+
+    char path[PATH_MAX], log_path[PATH_MAX], result_path[PATH_MAX], *buf, *line;
+    size_t lines_num, erased_num = 0, counts_num = 0, erased_max = 0, accum = 0, i, j = 0;
+    int total, *counts = NULL, exit_status = -1;
+    bool *marks = NULL;
+    FILE *fp = NULL, *result_fp = NULL;
+
+    if (erased){
+        erased->lines = NULL;
+        erased->linenos = NULL;
+        erased->lines_num = 0;
+    }
+
+    if (! (make_path(ctx, target_files[target], path) && make_path(ctx, erase_logs[target], log_path)))
+        return exit_status;
+    if (! make_path(ctx, erase_results[target], result_path))
+        return exit_status;
+    if (read_lines(ctx, path, &buf, &lines_num))
+        return exit_status;
+
+    if (lines_num >= INT_MAX){
+        set_error(ctx, "%s: too many lines", path);
+        goto exit;
+    }
+    if (lines_num && (! (marks = (bool *) calloc(lines_num, sizeof(bool))))){
+        set_error(ctx, "cannot allocate memory: %m");
+        goto exit;
+    }
+
+    for (line = buf, i = 0; i < lines_num; line += strlen(line) + 1, i++)
+        if ((marks[i] = pred(line, (i + 1), arg)))
+            erased_num++;
+
+    exit_status = 0;
+    if (! erased_num)
+        goto exit;
+    exit_status = -1;
+
+    if ((total = lines_num - reflecteds[target]) < 0){
+        total = lines_num;
+        reflecteds[target] = 0;
+    }
+
+    if (dit_read_erase_log(log_path, &counts, &counts_num) != total){
+        free(counts);
+
+        if (! (counts = (int *) malloc(sizeof(int)))){
+            set_error(ctx, "cannot allocate memory: %m");
+            goto exit;
+        }
+        *counts = total;
+        counts_num = 1;
+    }
+
+    if (! ((fp = fopen(path, "w")) && (result_fp = fopen(result_path, "w")))){
+        set_error(ctx, "cannot open '%s': %m", (fp ? result_path : path));
+        goto exit;
+    }
+
+    for (line = buf, i = 0; i < lines_num; line += strlen(line) + 1, i++){
+        if (! marks[i]){
+            fprintf(fp, "%s\n", line);
+            continue;
+        }
+
+        if (i < ((size_t) total)){
+            while (i >= accum)
+                accum += counts[j++];
+            counts[j - 1]--;
+        }
+        else
+            reflecteds[target]--;
+
+        if (*line)
+            fprintf(result_fp, "%s\n", line);
+
+        if (erased && append_line(ctx, erased, line, (i + 1), &erased_max))
+            goto exit;
+    }
+
+    if ((exit_status = dit_write_erase_log(log_path, counts, counts_num)))
+        exit_status = set_error(ctx, "cannot write '%s': %m", log_path);
+
+exit:
+    if (fp && fclose(fp) && (! exit_status))
+        exit_status = set_error(ctx, "cannot write '%s': %m", path);
+    if (result_fp)
+        fclose(result_fp);
+
+    if (exit_status && erased)
+        dit_free_lines(erased);
+
+    free(counts);
+    free(marks);
+    free(buf);
+
+    return exit_status;
+}
+
+
+/**
+ * @brief read the whole file, splitting it into lines.
+ *
+ * @param[out] ctx  the handle
+ * @param[in]  path  the path of the file
+ * @param[out] p_buf  variable to store the sequence of the lines, each of which is null-terminated
+ * @param[out] p_lines_num  variable to store the number of the lines
+ * @return int  0 (success) or -1 (error)
+ *
+ * @note a missing file is regarded as an empty one.
+ * @attention the sequence stored in 'p_buf' should be released by the caller.
+ */
+static int read_lines(dit_ctx *ctx, const char *path, char **p_buf, size_t *p_lines_num){
+    assert(ctx);
+    assert(path);
+    assert(p_buf);
+    assert(p_lines_num);
+
+    char *buf = NULL, *tmp;
+    size_t len = 0, max = 0, lines_num = 0, size;
+    FILE *fp;
+    void *ptr = NULL;
+
+    *p_buf = NULL;
+    *p_lines_num = 0;
+
+    if (! (fp = fopen(path, "r")))
+        return (errno == ENOENT) ? 0 : set_error(ctx, "cannot open '%s': %m", path);
+
+    do {
+        if ((max - len) < BUFSIZ){
+            if (! (ptr = realloc(buf, (max += BUFSIZ) + 1))){
+                set_error(ctx, "cannot allocate memory: %m");
+                break;
+            }
+            buf = (char *) ptr;
+        }
+        len += (size = fread((buf + len), sizeof(char), (max - len), fp));
+    } while (size);
+
+    if ((! ptr) || ferror(fp)){
+        if (ptr)
+            set_error(ctx, "cannot read '%s': %m", path);
+
+        fclose(fp);
+        free(buf);
+        return -1;
+    }
+
+    fclose(fp);
+
+    if (len && (buf[len - 1] != '\n'))
+        buf[len++] = '\n';
+
+    for (tmp = buf; (tmp = memchr(tmp, '\n', (len - (tmp - buf)))); *(tmp++) = '\0')
+        lines_num++;
+
+    *p_buf = buf;
+    *p_lines_num = lines_num;
+    return 0;
+}
+
+
+/**
+ * @brief append a copy of the line to the lines to be returned.
+ *
+ * @param[out] ctx  the handle
+ * @param[out] lines  variable storing the lines
+ * @param[in]  line  the line
+ * @param[in]  lineno  the line number of the line
+ * @param[out] p_max  variable storing the current maximum length of the arrays
+ * @return int  0 (success) or -1 (error)
+ */
+static int append_line(dit_ctx *ctx, dit_lines *lines, const char *line, size_t lineno, size_t *p_max){
+    assert(ctx);
+    assert(lines);
+    assert(line);
+    assert(p_max);
+
+    char *copy;
+
+    if (lines->lines_num == *p_max){
+        size_t curr_max;
+        void *ptr;
+
+        if ((curr_max = *p_max)){
+            if (! (curr_max = ((curr_max + 1) << 1) - 1))
+                return set_error(ctx, "too many lines");
+        }
+        else
+            curr_max = LIBDIT_INITIAL_LINES_MAX;
+
+        if (! (ptr = realloc(lines->lines, (sizeof(char *) * curr_max))))
+            return set_error(ctx, "cannot allocate memory: %m");
+        lines->lines = (char **) ptr;
+
+        if (! (ptr = realloc(lines->linenos, (sizeof(size_t) * curr_max))))
+            return set_error(ctx, "cannot allocate memory: %m");
+        lines->linenos = (size_t *) ptr;
+
+        *p_max = curr_max;
+    }
+
+    if (! (copy = strdup(line)))
+        return set_error(ctx, "cannot allocate memory: %m");
+
+    lines->lines[lines->lines_num] = copy;
+    lines->linenos[lines->lines_num++] = lineno;
+
+    return 0;
+}
+
+
+/**
+ * @brief get which instruction in Dockerfile the specified line is, in the same way as 'receive_dockerfile_instr'.
+ *
+ * @param[in]  line  target line
+ * @return int  index of the instruction, -1 if it is invalid, or -2 if it is an empty line or a comment
+ */
+static int get_instr_id(const char *line){
+    assert(line);
+
+    size_t len;
+    int min = 0, max = LIBDIT_INSTRS_NUM - 1, mid, cmp;
+
+    while (isspace((unsigned char) *line))
+        line++;
+
+    if ((! *line) || (*line == '#'))
+        return -2;
+
+    for (len = 0; line[len] && (! isspace((unsigned char) line[len])); len++)
+        if (len >= LIBDIT_INSTR_LEN_MAX)
+            return -1;
+
+    if (! line[len])
+        return -1;
+
+    while (min <= max){
+        mid = (min + max) / 2;
+
+        if (! (cmp = strncasecmp(line, instr_names[mid], len)))
+            cmp = - (unsigned char) instr_names[mid][len];
+
+        if (! cmp){
+            for (line += len; isspace((unsigned char) *line); line++);
+            return *line ? mid : -1;
+        }
+
+        if (cmp < 0)
+            max = mid - 1;
+        else
+            min = mid + 1;
+    }
+
+    return -1;
+}
+
+
+/**
+ * @brief the predicate to be passed to 'erase_lines' when reflecting CMD or ENTRYPOINT instruction.
+ *
+ * @param[in]  line  target line
+ * @param[in]  lineno  the line number of the line (unused)
+ * @param[in]  arg  the argument (unused)
+ * @return bool  whether the line is CMD or ENTRYPOINT instruction
+ */
+static bool check_if_cmd_or_entrypoint(const char *line, size_t lineno, void *arg){
+    assert(line);
+
+    int id;
+
+    id = get_instr_id(line);
+    return (id == LIBDIT_ID_CMD) || (id == LIBDIT_ID_ENTRYPOINT);
+}
+
+
+
+
+/**
+ * @brief open the provisional report of the numbers of reflected lines, and lock it against the other handles.
+ *
+ * @param[out] ctx  the handle
+ * @param[out] reflecteds  array of length 2 for storing the provisional numbers
+ * @return FILE*  the locked report, or NULL
+ *
+ * @note the numbers that cannot be read are regarded as 0, as the prompt resets them.
+ * @attention the report must be unlocked by 'unlock_provisional_report'.
+ */
+static FILE *lock_provisional_report(dit_ctx *ctx, int reflecteds[2]){
+    assert(ctx);
+    assert(reflecteds);
+
+    char path[PATH_MAX];
+    FILE *fp = NULL;
+
+    if (make_path(ctx, LIBDIT_REFLECT_FILE_P, path)){
+        if ((fp = fopen(path, "rb+"))){
+            if (flock(fileno(fp), LOCK_EX)){
+                set_error(ctx, "cannot lock '%s': %m", path);
+                fclose(fp);
+                return NULL;
+            }
+
+            if (dit_read_report(fp, reflecteds)){
+                reflecteds[0] = 0;
+                reflecteds[1] = 0;
+            }
+        }
+        else
+            set_error(ctx, "cannot open '%s': %m", path);
+    }
+
+    return fp;
+}
+
+
+/**
+ * @brief write the provisional numbers of reflected lines, and unlock the report.
+ *
+ * @param[out] ctx  the handle
+ * @param[out] fp  the locked report
+ * @param[in]  reflecteds  array of length 2 storing the provisional numbers
+ * @return int  0 (success) or -1 (error)
+ */
+static int unlock_provisional_report(dit_ctx *ctx, FILE *fp, const int reflecteds[2]){
+    assert(ctx);
+    assert(fp);
+    assert(reflecteds);
+
+    int exit_status = 0;
+
+    rewind(fp);
+
+    if (dit_write_report(fp, reflecteds))
+        exit_status = -1;
+    if (fclose(fp))
+        exit_status = -1;
+
+    return exit_status ? set_error(ctx, "cannot write the provisional report: %m") : exit_status;
+}
+
+
+
+
+/******************************************************************************
+    * Formats shared with the dit commands
+******************************************************************************/
+
+
+/**
+ * @brief read the provisional numbers of reflected lines from the current position of the report.
+ *
+ * @param[in]  fp  the provisional report
+ * @param[out] reflecteds  array of length 2 for storing the provisional numbers
+ * @return int  0 (success) or -1 (error)
+ *
+ * @note 'reflecteds' is left as it is if the numbers cannot be read or are negative.
+ */
+int dit_read_report(FILE *fp, int reflecteds[2]){
+    assert(fp);
+    assert(reflecteds);
+
+    int nums[2];
+
+    if ((fread(nums, sizeof(int), 2, fp) != 2) || (nums[0] < 0) || (nums[1] < 0))
+        return -1;
+
+    reflecteds[0] = nums[0];
+    reflecteds[1] = nums[1];
+    return 0;
+}
+
+
+/**
+ * @brief write the provisional numbers of reflected lines at the current position of the report.
+ *
+ * @param[out] fp  the provisional report
+ * @param[in]  reflecteds  array of length 2 storing the provisional numbers
+ * @return int  0 (success) or -1 (error)
+ */
+int dit_write_report(FILE *fp, const int reflecteds[2]){
+    assert(fp);
+    assert(reflecteds);
+
+    return (fwrite(reflecteds, sizeof(int), 2, fp) == 2) ? 0 : -1;
+}
+
+
+/**
+ * @brief read the numbers of lines reflected at each prompt from the log-file for 'dit erase'.
+ *
+ * @param[in]  path  the path of the log-file
+ * @param[out] p_counts  variable to store the array of the numbers from the oldest, or NULL
+ * @param[out] p_size  variable to store the array size
+ * @return int  the sum of the numbers, or -1 if the log-file is missing or broken
+ *
+ * @note the numbers of 'UCHAR_MAX' or more are read from after the array of bytes.
+ * @attention the array stored in 'p_counts' should be released by the caller.
+ */
+int dit_read_erase_log(const char *path, int **p_counts, size_t *p_size){
+    assert(path);
+    assert(p_counts);
+    assert(p_size);
+
+    unsigned char *array = NULL;
+    size_t size, i = 0;
+    int *counts = NULL, sum = 0;
+    FILE *fp;
+
+    *p_counts = NULL;
+    *p_size = 0;
+
+    if (! (fp = fopen(path, "rb")))
+        return -1;
+
+    if ((fread(&size, sizeof(size), 1, fp) == 1) && size && (size <= INT_MAX) &&
+        (array = (unsigned char *) malloc(size)) && (counts = (int *) malloc(sizeof(int) * size)) &&
+        (fread(array, sizeof(unsigned char), size, fp) == size)
+    ){
+        for (; i < size; i++){
+            if (array[i] < UCHAR_MAX)
+                counts[i] = array[i];
+            else if ((fread((counts + i), sizeof(int), 1, fp) != 1) || (counts[i] < UCHAR_MAX))
+                break;
+
+            if (counts[i] > (INT_MAX - sum))
+                break;
+            sum += counts[i];
+        }
+    }
+
+    fclose(fp);
+    free(array);
+
+    if ((! counts) || (i < size)){
+        free(counts);
+        return -1;
+    }
+
+    *p_counts = counts;
+    *p_size = size;
+    return sum;
+}
+
+
+/**
+ * @brief write the numbers of lines reflected at each prompt to the log-file for 'dit erase'.
+ *
+ * @param[in]  path  the path of the log-file
+ * @param[in]  counts  array of the numbers, from the oldest
+ * @param[in]  size  array size
+ * @return int  0 (success) or -1 (error)
+ *
+ * @note the numbers of 'UCHAR_MAX' or more are written after the array of bytes, to keep the file small.
+ */
+int dit_write_erase_log(const char *path, const int *counts, size_t size){
+    assert(path);
+    assert(counts);
+    assert(size);
+
+    unsigned char val;
+    size_t i;
+    FILE *fp;
+
+    if (! (fp = fopen(path, "wb")))
+        return -1;
+
+    fwrite(&size, sizeof(size), 1, fp);
+
+    for (i = 0; i < size; i++){
+        val = (counts[i] < UCHAR_MAX) ? counts[i] : UCHAR_MAX;
+        fwrite(&val, sizeof(unsigned char), 1, fp);
+    }
+    for (i = 0; i < size; i++)
+        if (counts[i] >= UCHAR_MAX)
+            fwrite((counts + i), sizeof(int), 1, fp);
+
+    return (ferror(fp) | fclose(fp)) ? -1 : 0;
+}
+
+
+
+
+/******************************************************************************
+    * Ignore
+******************************************************************************/
+
+
+/**
+ * @brief load the ignore-file used by 'dit convert' into the handle.
+ *
+ * @param[out] ctx  the handle
+ * @param[in]  target  'DIT_TARGET_DOCKERFILE' or 'DIT_TARGET_HISTORY'
+ * @param[in]  file_name  the ignore-file to be loaded instead of the current one for the target, or NULL
+ * @return int  0 (success) or -1 (error)
+ *
+ * @note the ignore-file loaded before for the target is released, and so is the default ignore set.
+ */
+int dit_load_ignore(dit_ctx *ctx, int target, const char *file_name){
+    assert(ctx);
+
+    char path[PATH_MAX];
+    yyjson_read_err err;
+
+    if (! check_if_valid_target(target))
+        return set_error(ctx, "invalid target: %d", target);
+
+    if (! file_name){
+        if (! make_path(ctx, ignore_files[target], path))
+            return -1;
+        file_name = path;
+    }
+
+    yyjson_doc_free(ctx->ignores[target]);
+    ctx->bases[target] = NULL;
+
+    if (! (ctx->ignores[target] = yyjson_read_file(file_name, 0, NULL, &err)))
+        return set_error(ctx, "cannot load '%s': %s", file_name, err.msg);
+
+    return 0;
+}
+
+
+/**
+ * @brief use the default ignore set compiled into this library, instead of loading any ignore-file.
+ *
+ * @param[out] ctx  the handle
+ * @param[in]  target  'DIT_TARGET_DOCKERFILE' or 'DIT_TARGET_HISTORY'
+ * @return int  0 (success) or -1 (error)
+ *
+ * @note the default ignore set is the base ignore-file at build time, which 'dit ignore -r' restores.
+ * @note no file is read, and the command names are found by perfect hashing.
+ */
+int dit_use_ignore_base(dit_ctx *ctx, int target){
+    assert(ctx);
+
+    if (! check_if_valid_target(target))
+        return set_error(ctx, "invalid target: %d", target);
+
+    yyjson_doc_free(ctx->ignores[target]);
+    ctx->ignores[target] = NULL;
+    ctx->bases[target] = ignore_tables + target;
+
+    return 0;
+}
+
+
+/**
+ * @brief check if the execution of the specified command should be ignored when reflected in the target file.
+ *
+ * @param[out] ctx  the handle
+ * @param[in]  target  'DIT_TARGET_DOCKERFILE' or 'DIT_TARGET_HISTORY'
+ * @param[in]  argc  the number of command line arguments
+ * @param[in]  argv  array of strings that are command line arguments, which is never permuted
+ * @param[out] p_ignored  variable to store the resulting boolean
+ * @return int  0 (success) or -1 (error)
+ *
+ * @note if neither an ignore-file nor the default ignore set is selected for the target, the current ignore-file is loaded first.
+ * @note the options are recognized as glibc 'getopt_long' does, including the abbreviations of long options.
+ */
+int dit_check_ignored(dit_ctx *ctx, int target, int argc, char * const *argv, bool *p_ignored){
+    assert(ctx);
+
+    if (! check_if_valid_target(target))
+        return set_error(ctx, "invalid target: %d", target);
+    if ((argc <= 0) || (! argv) || (! *argv) || (! p_ignored))
+        return set_error(ctx, "no command line to be checked");
+
+    if (ctx->bases[target])
+        *p_ignored = match_ignore_set((yyjson_val *) ctx->bases[target]->vals, ctx->bases[target], argc, argv);
+    else {
+        if ((! ctx->ignores[target]) && dit_load_ignore(ctx, target, NULL))
+            return -1;
+
+        *p_ignored = match_ignore_set(yyjson_doc_get_root(ctx->ignores[target]), NULL, argc, argv);
+    }
+    return 0;
+}
+
+
+
+
+/**
+ * @brief check if the command line meets the detailed conditions for the command in the ignore-file.
+ *
+ * @param[in]  root  the root of the ignore-file
+ * @param[in]  table  the default ignore set whose values contain 'root', or NULL
+ * @param[in]  argc  the number of command line arguments
+ * @param[in]  argv  array of strings that are command line arguments
+ * @return bool  the resulting boolean
+ *
+ * @note the contents of the ignore-file are used as much as possible while excluding invalid data.
+ */
+static bool match_ignore_set(yyjson_val *root, const ignore_table *table, int argc, char * const *argv){
+    assert(argc > 0);
+    assert(argv);
+
+    const char *key;
+    yyjson_val *ival;
+    yyjson_obj_iter iter;
+
+    // the file path, its base name and the empty string, in this order
+    for (key = *argv;; key = (key = strrchr(key, '/')) ? (key + 1) : "")
+        if ((ival = get_setting_entity(root, table, key, strlen(key))))
+            break;
+        else if (! *key)
+            return false;
+
+    if (! yyjson_obj_iter_init(ival, &iter))
+        return true;
+
+    int c;
+    yyjson_val *conds[IG_CONDITIONS_NUM], *ikey;
+    ig_scan scan = { .argv = argv, .argc = argc, .optind = 1 };
+    const char *name;
+    size_t size = 1, i, long_opts_num = 0;
+    bool no_short_opts = true;
+    uint64_t colons;
+    unsigned int detect_anymatch, invert_flag, matched = false, result;
+
+    for (i = 0; i < IG_CONDITIONS_NUM; i++)
+        conds[i] = yyjson_obj_iter_get(&iter, conds_keys[i]);
+
+    ival = conds[IG_SHORT_OPTS];
+
+    if ((name = yyjson_get_str(ival)) && check_short_opts(name)){
+        size += yyjson_get_len(ival);
+        no_short_opts = false;
+    }
+    else
+        name = "";
+
+    char short_opts[size + 1];
+    *short_opts = ':';
+    memcpy((short_opts + 1), name, size);
+
+    ival = conds[IG_LONG_OPTS];
+    size = yyjson_obj_size(ival);
+
+    if (size > INT_MAX)
+        size = INT_MAX;
+
+    ig_long_opt long_opts[size + 1];
+
+    if (yyjson_obj_iter_init(ival, &iter))
+        while ((ikey = yyjson_obj_iter_next(&iter))){
+            ival = yyjson_obj_iter_get_val(ikey);
+
+            if ((! (name = yyjson_get_str(ikey))) || (! *name) || strpbrk(name, ":=?") ||
+                (! yyjson_is_uint(ival)) || ((colons = yyjson_get_uint(ival)) >= 3))
+                    continue;
+
+            for (i = 0; (i < long_opts_num) && strcmp(name, long_opts[i].name); i++);
+
+            if (i == long_opts_num){
+                long_opts_num++;
+                long_opts[i].name = name;
+                long_opts[i].has_arg = colons;
+            }
+        }
+
+    ival = conds[IG_OPTARGS];
+
+    detect_anymatch = yyjson_get_bool(conds[IG_DETECT_ANYMATCH]);
+    invert_flag = yyjson_get_bool(conds[IG_INVERT_FLAG]);
+    result = detect_anymatch ^ invert_flag;
+
+    while ((c = scan_next_option(&scan, short_opts, long_opts, long_opts_num, &i)) >= 0){
+        switch (c){
+            case ':':
+            case '?':
+                if ((no_short_opts && (! long_opts_num)) || detect_anymatch)
+                    continue;
+                return result;
+            case 0:
+                name = long_opts[i].name;
+                size = strlen(name);
+                matched = (long_opts[i].has_arg == no_argument);
+                break;
+            default:
+                name = strchr(short_opts, c);
+                size = 1;
+                matched = (name[1] != ':');
+        }
+
+        assert(name && *name);
+
+        if (! matched)
+            matched = check_if_contained(scan.optarg, get_setting_entity(ival, NULL, name, size));
+
+        if (detect_anymatch == matched)
+            return result;
+    }
+
+    ival = conds[IG_FIRST_ARGS];
+
+    if (yyjson_is_arr(ival) && (detect_anymatch == check_if_contained(scan.first_arg, ival)))
+        return result;
+
+    ival = conds[IG_MAX_ARGC];
+
+    if (yyjson_is_uint(ival) && (detect_anymatch == (scan.args_num <= yyjson_get_uint(ival))))
+        return result;
+
+    return (! result);
+}
+
+
+/**
+ * @brief scan the next option in the command line, as glibc 'getopt_long' does when permuting the arguments.
+ *
+ * @param[out] scan  the state of the scan
+ * @param[in]  short_opts  the short options beginning with ':'
+ * @param[in]  long_opts  array of the long options
+ * @param[in]  size  array size
+ * @param[out] p_idx  variable to store index of the long option if the return value is 0
+ * @return int  the short option, 0 (long option), '?' (unknown option), ':' (missing argument) or -1 (end)
+ *
+ * @note instead of permuting the arguments, the non-optional arguments are counted as they are skipped.
+ * @note an abbreviated long option is ambiguous only if the options it matches differ in taking an argument.
+ */
+static int scan_next_option(ig_scan *scan, const char *short_opts, const ig_long_opt *long_opts, size_t size, size_t *p_idx){
+    assert(scan);
+    assert(short_opts && (*short_opts == ':'));
+    assert(long_opts || (! size));
+    assert(p_idx);
+
+    const char *arg, *opt;
+    size_t len, found, i;
+    int c;
+
+    scan->optarg = NULL;
+
+    if (! (scan->nextchar && *(scan->nextchar))){
+        for (; scan->optind < scan->argc; scan->optind++){
+            arg = scan->argv[scan->optind];
+
+            if ((arg[0] == '-') && arg[1])
+                break;
+            record_arg(scan, arg);
+        }
+
+        if (scan->optind >= scan->argc)
+            return -1;
+
+        if (! strcmp(arg, "--")){
+            while (++(scan->optind) < scan->argc)
+                record_arg(scan, scan->argv[scan->optind]);
+            return -1;
+        }
+
+        if (arg[1] != '-'){
+            scan->nextchar = arg + 1;
+            goto short_opt;
+        }
+
+        scan->optind++;
+        scan->nextchar = NULL;
+
+        opt = arg + 2;
+        len = strcspn(opt, "=");
+
+        for (found = SIZE_MAX, i = 0; i < size; i++)
+            if ((! strncmp(long_opts[i].name, opt, len)) && (! long_opts[i].name[len])){
+                found = i;
+                break;
+            }
+
+        if (found == SIZE_MAX)
+            for (i = 0; i < size; i++)
+                if (! strncmp(long_opts[i].name, opt, len)){
+                    if (found == SIZE_MAX)
+                        found = i;
+                    else if (long_opts[found].has_arg != long_opts[i].has_arg)
+                        return '?';
+                }
+
+        if (found == SIZE_MAX)
+            return '?';
+
+        if (opt[len] == '='){
+            if (long_opts[found].has_arg == no_argument)
+                return '?';
+            scan->optarg = opt + len + 1;
+        }
+        else if (long_opts[found].has_arg == required_argument){
+            if (scan->optind >= scan->argc)
+                return ':';
+            scan->optarg = scan->argv[scan->optind++];
+        }
+
+        *p_idx = found;
+        return 0;
+    }
+
+short_opt:
+    c = (unsigned char) *(scan->nextchar++);
+
+    if (! *(scan->nextchar))
+        scan->optind++;
+
+    if ((c == ':') || (c == ';') || (! (opt = strchr(short_opts, c))))
+        return '?';
+
+    if (opt[1] == ':'){
+        if (*(scan->nextchar)){
+            scan->optarg = scan->nextchar;
+            scan->optind++;
+        }
+        else if (opt[2] != ':'){
+            if (scan->optind >= scan->argc){
+                scan->nextchar = NULL;
+                return ':';
+            }
+            scan->optarg = scan->argv[scan->optind++];
+        }
+        scan->nextchar = NULL;
+    }
+
+    return c;
+}
+
+
+/**
+ * @brief record the non-optional argument skipped by the scan.
+ *
+ * @param[out] scan  the state of the scan
+ * @param[in]  arg  the non-optional argument
+ */
+static void record_arg(ig_scan *scan, const char *arg){
+    assert(scan);
+    assert(arg);
+
+    if (! (scan->args_num++))
+        scan->first_arg = arg;
+}
+
+
+/**
+ * @brief check if the target string is valid as the short options in the ignore-file.
+ *
+ * @param[in]  target  target string
+ * @return bool  the resulting boolean
+ *
+ * @note each option must appear once and may be followed by up to two colons, as 'parse_short_opts' accepts.
+ */
+static bool check_short_opts(const char *target){
+    assert(target);
+
+    unsigned int i;
+    int colons = 2;
+    bool ascii_table[UCHAR_MAX + 1] = {0};
+
+    if (strchr(target, '='))
+        return false;
+
+    while ((i = (unsigned char) *(target++))){
+        if (i == ':'){
+            if (colons < 2){
+                colons++;
+                continue;
+            }
+        }
+        else if ((i != '?') && (! ascii_table[i])){
+            colons = 0;
+            ascii_table[i] = true;
+            continue;
+        }
+        return false;
+    }
+
+    return true;
+}
+
+
+/**
+ * @brief get the entity of the setting by following the link via the key of the JSON object.
+ *
+ * @param[in]  iobj  immutable JSON object
+ * @param[in]  table  the default ignore set whose root is 'iobj', or NULL to search 'iobj' linearly
+ * @param[in]  name  the first key (may not be null-terminated)
+ * @param[in]  len  the length of the first key
+ * @return yyjson_val*  the resulting immutable JSON value or NULL
+ */
+static yyjson_val *get_setting_entity(yyjson_val *iobj, const ignore_table *table, const char *name, size_t len){
+    assert(name);
+
+    yyjson_val *ival;
+
+    while ((ival = (table ? igntab_lookup(table, name, len) : yyjson_obj_getn(iobj, name, len))) && (name = yyjson_get_str(ival)))
+        len = yyjson_get_len(ival);
+
+    return ival;
+}
+
+
+/**
+ * @brief check if the passed string is contained within the JSON array of expected strings.
+ *
+ * @param[in]  target  target string, or NULL to look for null
+ * @param[in]  ival  JSON array of expected strings
+ * @return bool  the resulting boolean, which is true unless 'ival' is an array
+ */
+static bool check_if_contained(const char *target, yyjson_val *ival){
+    yyjson_arr_iter iter;
+    const char *name;
+
+    if (yyjson_arr_iter_init(ival, &iter))
+        while (true){
+            if (! (ival = yyjson_arr_iter_next(&iter)))
+                return false;
+
+            if (yyjson_is_null(ival)){
+                if (! target)
+                    break;
+            }
+            else if (target && (name = yyjson_get_str(ival)) && (! strcmp(target, name)))
+                break;
+        }
+
+    return true;
+}
+
+
+
+
+/******************************************************************************
+    * Walk
+******************************************************************************/
+
+
+/**
+ * @brief call the function on the specified file and all files below it, children first.
+ *
+ * @param[out] ctx  the handle, or NULL if the error message is not needed
+ * @param[in]  dirfd  file descriptor that serves as the current working directory, or 'AT_FDCWD'
+ * @param[in]  name  name of the file
+ * @param[in]  type  1 (directory), 0 (not directory) or -1 (unknown)
+ * @param[in]  func  the function called on each file
+ * @param[in]  arg  the argument passed to the function as it is
+ * @return int  0 (success) or -1 (error, or the function returned non-zero)
+ *
+ * @note the symbolic links are never followed, and the walk stops at the first failure.
+ */
+int dit_walk(dit_ctx *ctx, int dirfd, const char *name, int type, dit_walk_func func, void *arg){
+    if ((! name) || (! *name) || (type < -1) || (type > 1) || (! func)){
+        errno = EINVAL;
+        return ctx ? set_error(ctx, "invalid arguments to walk") : -1;
+    }
+
+    if (walk_tree(dirfd, name, type, func, arg))
+        return 0;
+
+    return ctx ? set_error(ctx, "cannot walk '%s': %m", name) : -1;
+}
+
+
+/**
+ * @brief walk the tree below the file recursively.
+ *
+ * @param[in]  pwdfd  file descriptor that serves as the current working directory
+ * @param[in]  name  name of the file we are currently looking at
+ * @param[in]  type  1 (directory), 0 (not directory) or -1 (unknown)
+ * @param[in]  func  the function called on each file
+ * @param[in]  arg  the argument passed to the function as it is
+ * @return bool  successful or not
+ */
+static bool walk_tree(int pwdfd, const char *name, int type, dit_walk_func func, void *arg){
+    assert((pwdfd >= 0) || (pwdfd == AT_FDCWD));
+    assert(name && *name);
+    assert((type >= -1) && (type <= 1));
+    assert(func);
+
+    bool call_ok;
+    int new_fd;
+    DIR *dir;
+
+    call_ok = (! type);
+
+    if (type){
+        if ((new_fd = openat(pwdfd, name, (O_RDONLY | O_DIRECTORY))) != -1){
+            if ((dir = fdopendir(new_fd))){
+                struct dirent *entry;
+                const char *child;
+                bool isdir;
+                struct stat file_stat;
+
+                while ((entry = readdir(dir))){
+                    child = entry->d_name;
+                    assert(child && *child);
+
+                    if ((child[0] != '.') || child[(child[1] != '.') ? 1 : 2]){
+#ifdef _DIRENT_HAVE_D_TYPE
+                        if (entry->d_type != DT_UNKNOWN)
+                            isdir = (entry->d_type == DT_DIR);
+                        else
+#endif
+                        if (! fstatat(new_fd, child, &file_stat, AT_SYMLINK_NOFOLLOW))
+                            isdir = S_ISDIR(file_stat.st_mode);
+                        else
+                            break;
+
+                        if (! walk_tree(new_fd, child, isdir, func, arg))
+                            break;
+                    }
+                }
+
+                closedir(dir);
+
+                type = true;
+                call_ok = (! entry);
+            }
+            else
+                close(new_fd);
+        }
+        else if ((type == -1) && (errno == ENOTDIR)){
+            type = false;
+            call_ok = true;
+        }
+    }
+
+    return call_ok && (! func(pwdfd, name, type, arg));
+}
+
+
+
+
+/******************************************************************************
+    * Utilities
+******************************************************************************/
+
+
+/**
+ * @brief store the message describing the error in the handle.
+ *
+ * @param[out] ctx  the handle
+ * @param[in]  format  the format of the message, where '%m' is replaced with the message of 'errno'
+ * @return int  -1, so that the caller can return it as it is
+ */
+static int set_error(dit_ctx *ctx, const char *format, ...){
+    assert(ctx);
+    assert(format);
+
+    va_list sp;
+
+    va_start(sp, format);
+    vsnprintf(ctx->error, DIT_ERROR_MAX, format, sp);
+    va_end(sp);
+
+    return -1;
+}
+
+
+/**
+ * @brief make the path of the internal file under the root of the handle.
+ *
+ * @param[out] ctx  the handle
+ * @param[in]  file_name  the path of the internal file relative to the root, beginning with '/'
+ * @param[out] path  buffer of length 'PATH_MAX' for storing the resulting path
+ * @return bool  successful or not
+ */
+static bool make_path(dit_ctx *ctx, const char *file_name, char *path){
+    assert(ctx);
+    assert(file_name && (*file_name == '/'));
+    assert(path);
+
+    int n;
+
+    n = snprintf(path, PATH_MAX, "%s%s", (strcmp(ctx->root, "/") ? ctx->root : ""), file_name);
+
+    if ((n < 0) || (n >= PATH_MAX)){
+        set_error(ctx, "too long path of '%s'", file_name);
+        return false;
+    }
+    return true;
+}
+
+
+
+
+#ifndef NDEBUG
+
+#include "test.h"
+
+
+/******************************************************************************
+    * Unit Test Functions
+******************************************************************************/
+
+
+#define LIBDIT_TEST_ROOT "/dit/tmp/libdit.test"
+
+#define make_test_text(file_name, text)  make_test_file(file_name, text, strlen(text))
+#define check_test_text(file_name, text)  check_test_file(file_name, text, strlen(text))
+
+
+static void dit_reflect_test(void);
+static void dit_erase_test(void);
+static void dit_check_ignored_test(void);
+static void dit_use_ignore_base_test(void);
+static void dit_walk_test(void);
+
+static bool check_if_containing(const char *line, size_t lineno, void *arg);
+static int count_files(int dirfd, const char *name, bool isdir, void *arg);
+static int remove_files(int dirfd, const char *name, bool isdir, void *arg);
+
+static void make_test_file(const char *file_name, const void *data, size_t size);
+static void check_test_file(const char *file_name, const void *expected, size_t size);
+
+
+
+
+void libdit_test(void){
+    const char * const dirs[] = { "", "/etc", "/mnt", "/srv", "/var" };
+
+    char path[PATH_MAX];
+    size_t i;
+
+    dit_walk(NULL, AT_FDCWD, LIBDIT_TEST_ROOT, -1, remove_files, NULL);
+
+    for (i = 0; i < (sizeof(dirs) / sizeof(*dirs)); i++){
+        snprintf(path, PATH_MAX, "%s%s", LIBDIT_TEST_ROOT, dirs[i]);
+        assert(! mkdir(path, 0755));
+    }
+
+    // the tests share the above tree, which is removed by the last one
+    do_test(dit_reflect_test);
+    do_test(dit_erase_test);
+    do_test(dit_check_ignored_test);
+    do_test(dit_use_ignore_base_test);
+    do_test(dit_walk_test);
+}
+
+
+
+
+static void dit_reflect_test(void){
+    const char * const lines[] = { "RUN make", "CMD [ \"a\" ]" };
+    const char * const cmd_line[] = { "cmd [ \"b\" ]" };
+    const char * const hist_lines[] = { "ls -l", "make" };
+
+    // changeable part for updating test cases
+    const char * const invalid_lines[][2] = {
+        { "FROM debian",            NULL             },
+        { "  maintainer someone",   NULL             },
+        { "RUN",                    NULL             },
+        { "UNKNOWN arg",            NULL             },
+        { "RUN make\nRUN clean",    NULL             },
+        { "CMD [ \"a\" ]",          "CMD [ \"b\" ]"  },
+        { "ENTRYPOINT a",           "entrypoint b"   },
+        {  0,                        0               }
+    };
+
+    const char *dockerfile = "FROM alpine\nRUN make\ncmd [ \"b\" ]\n";
+    const int zeros[2] = {0}, reflecteds[2] = {0, 3};
+    dit_ctx *ctx;
+    int i;
+
+    assert((ctx = dit_open(LIBDIT_TEST_ROOT "/")));
+    assert(! *dit_strerror(ctx));
+
+    make_test_text(LIBDIT_DOCKER_FILE_BASE, "FROM alpine\n");
+    make_test_file(LIBDIT_REFLECT_FILE_P, zeros, sizeof(zeros));
+
+    // Dockerfile is initialized based on its base file, whose lines are also counted
+    assert(! dit_reflect(ctx, DIT_TARGET_DOCKERFILE, lines, 2));
+    check_test_text(LIBDIT_DOCKER_FILE, "FROM alpine\nRUN make\nCMD [ \"a\" ]\n");
+
+    // CMD instruction replaces the existing one
+    assert(! dit_reflect(ctx, DIT_TARGET_DOCKERFILE, cmd_line, 1));
+    check_test_text(LIBDIT_DOCKER_FILE, dockerfile);
+    check_test_file(LIBDIT_REFLECT_FILE_P, reflecteds, sizeof(reflecteds));
+
+    for (i = 0; invalid_lines[i][0]; i++){
+        print_progress_test_loop('\0', -1, i);
+        fprintf(stderr, "%s\n", invalid_lines[i][0]);
+
+        assert(dit_reflect(ctx, DIT_TARGET_DOCKERFILE, invalid_lines[i], (invalid_lines[i][1] ? 2 : 1)) == -1);
+        assert(*dit_strerror(ctx));
+    }
+
+    check_test_text(LIBDIT_DOCKER_FILE, dockerfile);
+    assert(dit_reflect(ctx, 2, hist_lines, 2) == -1);
+
+    // no line is regarded as an instruction in history-file
+    assert(! dit_reflect(ctx, DIT_TARGET_HISTORY, *invalid_lines, 1));
+    assert(dit_reflect(ctx, DIT_TARGET_HISTORY, invalid_lines[4], 1) == -1);
+    make_test_text(LIBDIT_HISTORY_FILE, "old\n");
+    make_test_file(LIBDIT_REFLECT_FILE_P, reflecteds, sizeof(reflecteds));
+
+    assert(! dit_reflect(ctx, DIT_TARGET_HISTORY, hist_lines, 2));
+    check_test_text(LIBDIT_HISTORY_FILE, "old\nls -l\nmake\n");
+
+    dit_close(ctx);
+}
+
+
+static void dit_erase_test(void){
+    const size_t size = 1;
+    const int reflecteds[2] = {1, 3};
+
+    unsigned char logs[sizeof(size_t) + 1] = {0};
+    dit_ctx *ctx;
+    dit_lines result;
+
+    assert((ctx = dit_open(LIBDIT_TEST_ROOT)));
+
+    // 'old' was reflected before the last prompt, and the others after it
+    memcpy(logs, &size, sizeof(size_t));
+    logs[sizeof(size_t)] = 1;
+    make_test_file(LIBDIT_ERASE_FILE_H, logs, sizeof(logs));
+
+    assert(! dit_erase(ctx, DIT_TARGET_HISTORY, check_if_containing, "l", &result));
+    assert(result.lines_num == 2);
+    assert((! strcmp(result.lines[0], "old")) && (result.linenos[0] == 1));
+    assert((! strcmp(result.lines[1], "ls -l")) && (result.linenos[1] == 2));
+    dit_free_lines(&result);
+
+    logs[sizeof(size_t)] = 0;
+    check_test_file(LIBDIT_ERASE_FILE_H, logs, sizeof(logs));
+    check_test_file(LIBDIT_REFLECT_FILE_P, reflecteds, sizeof(reflecteds));
+    check_test_text(LIBDIT_ERASE_RESULT_FILE_H, "old\nls -l\n");
+    check_test_text(LIBDIT_HISTORY_FILE, "make\n");
+
+    assert(! dit_erase(ctx, DIT_TARGET_HISTORY, check_if_containing, "x", NULL));
+    check_test_text(LIBDIT_HISTORY_FILE, "make\n");
+    assert(dit_erase(ctx, DIT_TARGET_HISTORY, NULL, NULL, NULL) == -1);
+
+    assert(! dit_query_history(ctx, NULL, NULL, &result));
+    assert(result.lines_num == 1);
+    assert((! strcmp(*result.lines, "make")) && (*result.linenos == 1));
+    dit_free_lines(&result);
+
+    assert(! dit_query_history(ctx, check_if_containing, "x", &result));
+    assert(! result.lines_num);
+
+    dit_close(ctx);
+}
+
+
+static void dit_check_ignored_test(void){
+    // changeable part for updating test cases
+    const char * const ignore_json =
+        "{"
+            "\"cd\": {},"
+            "\"ls\": { \"short_opts\": \"alR\", \"max_argc\": 1 },"
+            "\"apt-get\": {"
+                "\"short_opts\": \"yqo:\","
+                "\"long_opts\": { \"no-install-recommends\": 0, \"option\": 1 },"
+                "\"optargs\": { \"o\": [\"Acquire::Retries=3\"], \"option\": \"o\" },"
+                "\"first_args\": [\"install\", \"update\"]"
+            "},"
+            "\"grep\": { \"invert_flag\": true },"
+            "\"egrep\": \"grep\""
+        "}";
+
+    const struct {
+        int argc;
+        char *argv[6];
+        bool expected;
+    } table[] = {
+        { 2, { "cd", ".." },                                               true  },
+        { 3, { "ls", "-la", "/tmp" },                                      true  },
+        { 3, { "ls", "/tmp", "-R" },                                       true  },
+        { 4, { "/bin/ls", "-l", "a", "b" },                                false },
+        { 2, { "ls", "-x" },                                               false },
+        { 5, { "apt-get", "install", "-y", "--no-install", "curl" },       true  },
+        { 4, { "apt-get", "-o", "Acquire::Retries=3", "update" },          true  },
+        { 3, { "apt-get", "--opt=Acquire::Retries=3", "update" },          true  },
+        { 3, { "apt-get", "-oFoo=1", "update" },                           false },
+        { 3, { "apt-get", "remove", "curl" },                              false },
+        { 3, { "apt-get", "--", "-y" },                                    false },
+        { 3, { "apt-get", "update", "--option" },                          false },
+        { 2, { "egrep", "x" },                                             false },
+        { 1, { "make" },                                                   false },
+        { 0, { 0 },                                                        false }
+    };
+
+    char *argv[6];
+    dit_ctx *ctx;
+    bool ignored;
+    int i;
+
+    assert((ctx = dit_open(LIBDIT_TEST_ROOT)));
+    assert(dit_check_ignored(ctx, DIT_TARGET_DOCKERFILE, 1, table->argv, &ignored) == -1);
+
+    make_test_text(LIBDIT_IGNORE_FILE_D, ignore_json);
+
+    for (i = 0; table[i].argc; i++){
+        print_progress_test_loop('\0', -1, i);
+        fprintf(stderr, "%s\n", *table[i].argv);
+
+        memcpy(argv, table[i].argv, sizeof(argv));
+        assert(! dit_check_ignored(ctx, DIT_TARGET_DOCKERFILE, table[i].argc, argv, &ignored));
+        assert(ignored == table[i].expected);
+
+        // the arguments are never permuted
+        assert(! memcmp(argv, table[i].argv, sizeof(argv)));
+    }
+
+    assert(dit_load_ignore(ctx, DIT_TARGET_HISTORY, LIBDIT_TEST_ROOT "/nonexistent") == -1);
+    assert(*dit_strerror(ctx));
+
+    dit_close(ctx);
+}
+
+
+static void dit_use_ignore_base_test(void){
+    // changeable part for updating test cases
+    const char * const args_table[][3] = {
+        { NULL,   NULL,       NULL      },
+        { "-y",   "install",  "curl"    },
+        { "--",   "-x",       NULL      },
+        { "-la",  "/tmp",     NULL      },
+        { "-h",   NULL,       NULL      },
+        { "x",    "y",        "z"       }
+    };
+
+    const size_t args_num = sizeof(args_table) / sizeof(*args_table);
+    const char * const file_names[2] = { LIBDIT_IGNORE_FILE_H, LIBDIT_IGNORE_FILE_D };
+
+    const ignore_table *table;
+    yyjson_doc *doc;
+    yyjson_val *ikey, *ival;
+    size_t idx, max, i, j, len;
+    dit_ctx *ctxs[2];
+    const char *key;
+    char *argv[4], name[64];
+    int target, argc;
+    bool results[2];
+
+    assert((ctxs[0] = dit_open(LIBDIT_TEST_ROOT)));
+    assert((ctxs[1] = dit_open(LIBDIT_TEST_ROOT)));
+
+    for (target = 0; target < 2; target++){
+        table = ignore_tables + target;
+        assert((doc = yyjson_read(table->text, table->text_len, 0)));
+
+        // the compiled set is exactly what the reset ignore-file contains
+        make_test_file(file_names[target], table->text, table->text_len);
+        assert(! dit_use_ignore_base(ctxs[0], target));
+        assert(! dit_load_ignore(ctxs[1], target, NULL));
+
+        yyjson_obj_foreach(yyjson_doc_get_root(doc), idx, max, ikey, ival){
+            assert((key = yyjson_get_str(ikey)));
+            len = yyjson_get_len(ikey);
+
+            print_progress_test_loop('\0', -1, idx);
+            fprintf(stderr, "%s\n", key);
+
+            if (ival == yyjson_obj_getn(doc->root, key, len))
+                assert(yyjson_equals(igntab_lookup(table, key, len), ival));
+
+            if (len && (len < (sizeof(name) - 1))){
+                memcpy(name, key, len);
+                name[len] = 'x';
+                assert((! igntab_lookup(table, name, len + 1)) == (! yyjson_obj_getn(doc->root, name, len + 1)));
+                assert((! igntab_lookup(table, name, len - 1)) == (! yyjson_obj_getn(doc->root, name, len - 1)));
+            }
+
+            for (i = 0; i < args_num; i++){
+                argv[0] = (char *) key;
+                for (j = 0, argc = 1; (j < 3) && args_table[i][j]; j++)
+                    argv[argc++] = (char *) args_table[i][j];
+                argv[argc] = NULL;
+
+                for (j = 0; j < 2; j++)
+                    assert(! dit_check_ignored(ctxs[j], target, argc, argv, (results + j)));
+                assert(results[0] == results[1]);
+            }
+        }
+
+        yyjson_doc_free(doc);
+    }
+
+    // the default ignore set is left by loading any ignore-file
+    assert(! dit_load_ignore(ctxs[0], DIT_TARGET_DOCKERFILE, NULL));
+    assert(dit_use_ignore_base(ctxs[0], -1) == -1);
+
+    dit_close(ctxs[0]);
+    dit_close(ctxs[1]);
+
+    // the tree is left as it was for the next test, except for the ignore-file of Dockerfile
+    assert(! unlink(LIBDIT_TEST_ROOT LIBDIT_IGNORE_FILE_H));
+}
+
+
+static void dit_walk_test(void){
+    dit_ctx *ctx;
+    size_t count = 0;
+
+    assert((ctx = dit_open(LIBDIT_TEST_ROOT)));
+
+    // 9 files, 4 directories and the root
+    assert(! dit_walk(ctx, AT_FDCWD, LIBDIT_TEST_ROOT, 1, count_files, &count));
+    assert(count == 14);
+
+    // the walk stops as soon as the callback fails, which happens when the count overflows
+    count = SIZE_MAX - 5;
+    assert(dit_walk(ctx, AT_FDCWD, LIBDIT_TEST_ROOT, -1, count_files, &count) == -1);
+    assert(! count);
+
+    assert(dit_walk(ctx, AT_FDCWD, LIBDIT_TEST_ROOT, 2, count_files, &count) == -1);
+    assert(*dit_strerror(ctx));
+
+    assert(! dit_walk(NULL, AT_FDCWD, LIBDIT_TEST_ROOT, -1, remove_files, NULL));
+    assert(access(LIBDIT_TEST_ROOT, F_OK) && (errno == ENOENT));
+
+    dit_close(ctx);
+}
+
+
+
+
+static bool check_if_containing(const char *line, size_t lineno, void *arg){
+    assert(line);
+    assert(lineno);
+    assert(arg);
+
+    return strstr(line, (const char *) arg);
+}
+
+
+static int count_files(int dirfd, const char *name, bool isdir, void *arg){
+    assert(arg);
+
+    size_t *p_count;
+
+    p_count = (size_t *) arg;
+    return ! ++(*p_count);
+}
+
+
+static int remove_files(int dirfd, const char *name, bool isdir, void *arg){
+    return unlinkat(dirfd, name, (isdir ? AT_REMOVEDIR : 0));
+}
+
+
+static void make_test_file(const char *file_name, const void *data, size_t size){
+    char path[PATH_MAX];
+    FILE *fp;
+
+    snprintf(path, PATH_MAX, "%s%s", LIBDIT_TEST_ROOT, file_name);
+
+    assert((fp = fopen(path, "wb")));
+    assert(fwrite(data, sizeof(char), size, fp) == size);
+    assert(! fclose(fp));
+}
+
+
+static void check_test_file(const char *file_name, const void *expected, size_t size){
+    char path[PATH_MAX], buf[size + 1];
+    FILE *fp;
+
+    snprintf(path, PATH_MAX, "%s%s", LIBDIT_TEST_ROOT, file_name);
+
+    assert((fp = fopen(path, "rb")));
+    assert(fread(buf, sizeof(char), (size + 1), fp) == size);
+    assert(! memcmp(buf, expected, size));
+    assert(! fclose(fp));
+}
+
+
+#endif // NDEBUG
@@ -0,0 +1,82 @@
+#ifndef DIT_LIBRARY
+#define DIT_LIBRARY
+
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdio.h>
+
+
+/******************************************************************************
+    * commonly used Macros
+******************************************************************************/
+
+#define DIT_DEFAULT_ROOT "/dit"
+
+#define DIT_TARGET_HISTORY     0
+#define DIT_TARGET_DOCKERFILE  1
+
+#define DIT_ERROR_MAX 256
+
+
+
+
+/******************************************************************************
+    * commonly used Data Types
+******************************************************************************/
+
+/** Data type for the handle that holds everything a host needs to call the functions of this library */
+typedef struct dit_ctx dit_ctx;
+
+
+/** Data type for storing the lines returned by the functions of this library */
+typedef struct {
+    char **lines;          /** array of the lines without their newlines */
+    size_t *linenos;       /** array of the line number of each line in the file it was read from */
+    size_t lines_num;      /** array size */
+} dit_lines;
+
+
+/** Data type for the predicate that chooses the lines of Dockerfile or history-file */
+typedef bool (* dit_line_pred)(const char *line, size_t lineno, void *arg);
+
+/** Data type for the callback called on each file in the tree, where a non-zero return stops the walk */
+typedef int (* dit_walk_func)(int dirfd, const char *name, bool isdir, void *arg);
+
+
+
+
+/******************************************************************************
+    * Interface for the dit Library
+******************************************************************************/
+
+dit_ctx *dit_open(const char *root);
+void dit_close(dit_ctx *ctx);
+const char *dit_strerror(const dit_ctx *ctx);
+
+int dit_reflect(dit_ctx *ctx, int target, const char * const *lines, size_t lines_num);
+int dit_erase(dit_ctx *ctx, int target, dit_line_pred pred, void *arg, dit_lines *erased);
+int dit_query_history(dit_ctx *ctx, dit_line_pred pred, void *arg, dit_lines *result);
+void dit_free_lines(dit_lines *lines);
+
+int dit_load_ignore(dit_ctx *ctx, int target, const char *file_name);
+int dit_use_ignore_base(dit_ctx *ctx, int target);
+int dit_check_ignored(dit_ctx *ctx, int target, int argc, char * const *argv, bool *p_ignored);
+
+int dit_walk(dit_ctx *ctx, int dirfd, const char *name, int type, dit_walk_func func, void *arg);
+
+
+
+
+/******************************************************************************
+    * Formats shared with the dit commands
+******************************************************************************/
+
+int dit_read_report(FILE *fp, int reflecteds[2]);
+int dit_write_report(FILE *fp, const int reflecteds[2]);
+
+int dit_read_erase_log(const char *path, int **p_counts, size_t *p_size);
+int dit_write_erase_log(const char *path, const int *counts, size_t size);
+
+
+#endif // DIT_LIBRARY
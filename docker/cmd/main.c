@@ -17,6 +17,14 @@
 
 #define XSTRCAT_INITIAL_MAX 1023  // 2^n - 1
 
+#define EXECUTE_INITIAL_MAX 4095  // 2^n - 1
+
+#ifdef __AVX2__
+#define SANITIZE_VECTOR_SIZE 32
+#else
+#define SANITIZE_VECTOR_SIZE 16
+#endif
+
 
 /** Data type for storing the information for one loop for 'xfgets_for_loop' */
 typedef struct {
@@ -25,9 +33,29 @@ typedef struct {
     char *dest;         /** pointer to the beginning of dynamic memory for storing read lines as string */
     int curr_max;       /** the current maximum length of the string that can be preserved */
     int curr_len;       /** the total length of the preserved strings including null characters */
+    trace_scope scope;  /** the state at the beginning of the loop, used only while tracing */
 } xfgets_info;
 
 
+/** Data type for saving the signal settings changed while waiting for child processes */
+typedef struct {
+    struct sigaction sigint_act;    /** the previous action for SIGINT */
+    struct sigaction sigquit_act;   /** the previous action for SIGQUIT */
+    sigset_t old_mask;              /** the previous signal mask */
+} spawn_signals;
+
+
+/** Data type for passing the destination of the captured stdout of a child process to its reader */
+typedef struct {
+    inf_str *output;    /** variable to store the contents as a null-terminated string */
+    size_t *p_len;      /** variable to store the length of the contents */
+} capture_dest;
+
+
+/** Data type for scanning some bytes of the string to be sanitized at a time */
+typedef unsigned char sanitize_vector __attribute__ ((vector_size (SANITIZE_VECTOR_SIZE)));
+
+
 /** array of the names of the target files */
 const char * const target_files[2] = {
     HISTORY_FILE,
@@ -57,12 +85,15 @@ const char * const cmd_reprs[CMDS_NUM] = {
     "healthcheck",
     "help",
     "ignore",
+    "init",
     "inspect",
     "label",
     "onbuild",
     "optimize",
     "package",
-    "reflect"
+    "reflect",
+    "session",
+    "stats"
 };
 
 
@@ -128,12 +159,15 @@ static int (* const cmd_funcs[CMDS_NUM])(int, char **) = {
     healthcheck,
     help,
     ignore,
+    init,
     inspect,
     label,
     onbuild,
     optimize,
     package,
-    reflect
+    reflect,
+    session,
+    stats
 };
 
 
@@ -166,6 +200,10 @@ static const char escape_hex_table[32 * 2] = {
 };
 
 
+/** the environment passed to the child processes */
+extern char **environ;
+
+
 /** string representing a dit command invoked */
 static const char *program_name = "dit";
 
@@ -206,9 +244,19 @@ int main(int argc, char **argv){
             test(argc, argv, cmd_id);
 #endif
             if (cmd_id >= 0){
+                trace_scope scope;
+                int exit_status;
+
                 assert(cmd_id < CMDS_NUM);
                 program_name = *argv;
-                return cmd_funcs[cmd_id](argc, argv);
+
+                trace_init(cmd_id);
+                trace_begin(&scope, TRACE_MAIN, NULL);
+
+                exit_status = cmd_funcs[cmd_id](argc, argv);
+
+                trace_end(&scope);
+                return exit_status;
             }
 
             xperror_invalid_arg('C', 1, "command", *argv);
@@ -507,6 +555,8 @@ char *xfgets_for_loop(const char *src_file, char **p_start, size_t *p_len, int *
             return NULL;
         }
 
+        trace_begin(&(info.scope), TRACE_XFGETS_FOR_LOOP, (src_file ? src_file : "stdin"));
+
         info_idx++;
         assert(info_idx >= 0);
 
@@ -614,6 +664,8 @@ finish:
     else
         clearerr(info.fp);
 
+    trace_end(&(info.scope));
+
     if (p_start){
         if ((! errid) && (info.curr_len > 0)){
             assert(info.dest);
@@ -747,6 +799,250 @@ bool xstrcat_inf_len(inf_str *base, size_t base_len, const char *suf, size_t suf
 ******************************************************************************/
 
 
+/**
+ * @brief make the calling process ignore the interrupts from the terminal while waiting for child processes.
+ *
+ * @param[out] saved  variable to store the signal settings before the change
+ *
+ * @note signal handling conforms to the specifications of 'system' function.
+ * @note 'pthread_sigmask' function is not used because it is not any of async-signal-safe functions.
+ */
+static void block_parent_signals(spawn_signals *saved){
+    assert(saved);
+
+    struct sigaction new_act = {0};
+
+    new_act.sa_handler = SIG_IGN;
+    sigemptyset(&(new_act.sa_mask));
+    sigaction(SIGINT, &new_act, &(saved->sigint_act));
+    sigaction(SIGQUIT, &new_act, &(saved->sigquit_act));
+
+    sigaddset(&(new_act.sa_mask), SIGCHLD);
+    sigprocmask(SIG_BLOCK, &(new_act.sa_mask), &(saved->old_mask));
+}
+
+
+/**
+ * @brief restore the signal settings changed by 'block_parent_signals'.
+ *
+ * @param[in]  saved  the signal settings before the change
+ */
+static void restore_parent_signals(const spawn_signals *saved){
+    assert(saved);
+
+    sigaction(SIGINT, &(saved->sigint_act), NULL);
+    sigaction(SIGQUIT, &(saved->sigquit_act), NULL);
+    sigprocmask(SIG_SETMASK, &(saved->old_mask), NULL);
+}
+
+
+/**
+ * @brief print the command line to be executed to stderr.
+ *
+ * @param[in]  argv  NULL-terminated array of strings that are command line arguments
+ */
+static void print_command_line(char * const argv[]){
+    assert(argv && argv[0]);
+
+    fputc('+', stderr);
+
+    for (char * const *p_arg = argv; *p_arg; p_arg++)
+        print_sanitized_string(*p_arg);
+
+    fputc('\n', stderr);
+}
+
+
+
+
+/**
+ * @brief create a child process that executes the specified command.
+ *
+ * @param[in]  cmd_file  command path
+ * @param[in]  argv  NULL-terminated array of strings that are command line arguments
+ * @param[in]  mode  some flags (bit 1: how to handle stdout)
+ * @param[in]  in_fd  file descriptor to be used as stdin of the child process or -1
+ * @param[in]  out_fd  file descriptor to be used as stdout of the child process or -1
+ * @param[in]  saved  the signal settings before 'block_parent_signals' was called
+ * @return pid_t  process ID of the child process or -1 (syscall error)
+ *
+ * @note 'posix_spawn' function avoids the cost of copying the page tables of the calling process.
+ * @note if 'in_fd' is -1, stdin is inherited from the calling process.
+ * @note if 'out_fd' is -1, stdout is discarded when the LSB of 'mode' is set, otherwise it is grouped with stderr.
+ * @note the child process restores the default actions and the signal mask that the caller originally had.
+ */
+static pid_t spawn_child(
+    const char *cmd_file,
+    char * const argv[],
+    unsigned int mode,
+    int in_fd,
+    int out_fd,
+    const spawn_signals *saved
+){
+    assert(cmd_file);
+    assert(argv && argv[0]);
+    assert(saved);
+
+    posix_spawn_file_actions_t actions;
+    posix_spawnattr_t attr;
+    sigset_t default_set;
+    pid_t pid = -1;
+    int errcode;
+
+    if ((errcode = posix_spawn_file_actions_init(&actions)))
+        goto exit;
+
+    if ((in_fd >= 0) && (errcode = posix_spawn_file_actions_adddup2(&actions, in_fd, STDIN_FILENO)))
+        goto destroy;
+
+    if (out_fd >= 0)
+        errcode = posix_spawn_file_actions_adddup2(&actions, out_fd, STDOUT_FILENO);
+    else if (mode & 0b01)
+        errcode = posix_spawn_file_actions_addopen(&actions, STDOUT_FILENO, "/dev/null", O_WRONLY, 0);
+    else
+        errcode = posix_spawn_file_actions_adddup2(&actions, STDERR_FILENO, STDOUT_FILENO);
+
+    if (! errcode){
+        if (! (errcode = posix_spawnattr_init(&attr))){
+            sigemptyset(&default_set);
+            sigaddset(&default_set, SIGINT);
+            sigaddset(&default_set, SIGQUIT);
+
+            if (! (
+                (errcode = posix_spawnattr_setflags(&attr, (POSIX_SPAWN_SETSIGDEF | POSIX_SPAWN_SETSIGMASK))) ||
+                (errcode = posix_spawnattr_setsigdefault(&attr, &default_set)) ||
+                (errcode = posix_spawnattr_setsigmask(&attr, &(saved->old_mask)))
+            ))
+                if ((errcode = posix_spawn(&pid, cmd_file, &actions, &attr, argv, environ)))
+                    pid = -1;
+
+            posix_spawnattr_destroy(&attr);
+        }
+    }
+
+destroy:
+    posix_spawn_file_actions_destroy(&actions);
+
+exit:
+    if (errcode)
+        errno = errcode;
+    return pid;
+}
+
+
+/**
+ * @brief wait for the specified child process to terminate.
+ *
+ * @param[in]  pid  process ID of the child process
+ * @return int  the exit status based on the shell's or -1 (syscall error)
+ */
+static int wait_child(pid_t pid){
+    assert(pid > 0);
+
+    siginfo_t info;
+    int exit_status = -1;
+
+    info.si_pid = 0;
+
+    while (waitid(P_PID, (id_t) pid, &info, WEXITED))
+        if (errno != EINTR)
+            return exit_status;
+
+    switch (info.si_code){
+        case CLD_EXITED:
+            exit_status = info.si_status;
+            break;
+        case CLD_KILLED:
+        case CLD_DUMPED:
+            exit_status = 128 + info.si_status;
+            break;
+        default:
+            exit_status = 128;
+    }
+
+    return exit_status;
+}
+
+
+/**
+ * @brief read all the contents that the child process writes to the specified pipe.
+ *
+ * @param[in]  fd  file descriptor for the read end of the pipe
+ * @param[out] arg  the destination of the contents
+ * @return bool  successful or not
+ *
+ * @note the size of the buffer doubles in the same way as 'xstrcat_inf_len'.
+ */
+static bool read_child_output(int fd, void *arg){
+    assert(fd >= 0);
+    assert(arg);
+
+    inf_str *output;
+    size_t *p_len, len = 0, curr_max;
+    char *start;
+    ssize_t read_size;
+
+    output = ((capture_dest *) arg)->output;
+    p_len = ((capture_dest *) arg)->p_len;
+
+    assert(output);
+    assert(p_len);
+
+    do {
+        if ((output->max - len) < 2){
+            curr_max = output->max;
+
+            if (! curr_max)
+                curr_max = EXECUTE_INITIAL_MAX;
+            else {
+                curr_max++;
+                assert(! (curr_max & (curr_max - 1)));
+
+                if (! (curr_max <<= 1))
+                    break;
+                curr_max--;
+            }
+
+            if (! (start = (char *) realloc(output->ptr, (sizeof(char) * curr_max))))
+                break;
+            output->ptr = start;
+            output->max = curr_max;
+        }
+
+        assert(output->ptr);
+
+        if ((read_size = read(fd, (output->ptr + len), (output->max - len - 1))) > 0)
+            len += read_size;
+        else if (! read_size){
+            output->ptr[len] = '\0';
+            *p_len = len;
+            return true;
+        }
+    } while ((read_size > 0) || (errno == EINTR));
+
+    return false;
+}
+
+
+/**
+ * @brief discard the rest of the contents that the child process writes to the specified pipe.
+ *
+ * @param[in]  fd  file descriptor for the read end of the pipe
+ */
+static void discard_child_output(int fd){
+    assert(fd >= 0);
+
+    char buf[4096];
+    ssize_t read_size;
+
+    do
+        read_size = read(fd, buf, sizeof(buf));
+    while ((read_size > 0) || ((read_size < 0) && (errno == EINTR)));
+}
+
+
+
+
 /**
  * @brief execute the specified command in a child process.
  *
@@ -756,8 +1052,6 @@ bool xstrcat_inf_len(inf_str *base, size_t base_len, const char *suf, size_t suf
  * @return int  0 (success), -1 (syscall error) or positive integer (command error)
  *
  * @note this function is to avoid the inefficiency and the inconvenience when using 'system' function.
- * @note signal handling conforms to the specifications of 'system' function.
- * @note 'pthread_sigmask' function is not used because it is not any of async-signal-safe functions.
  * @note discards stdout if the LSB of 'mode' is set, otherwise groups stdout with stderr.
  * @note the exit status that can be returned as a return value is based on the shell's.
  *
@@ -765,78 +1059,232 @@ bool xstrcat_inf_len(inf_str *base, size_t base_len, const char *suf, size_t suf
  * @attention calling this function in a multithreaded process is not recommended.
  */
 int execute(const char *cmd_file, char * const argv[], unsigned int mode){
+    assert(mode < 4);
+
+    return execute_capture(cmd_file, argv, mode, NULL, NULL);
+}
+
+
+/**
+ * @brief execute the specified command in a child process, capturing its stdout if necessary.
+ *
+ * @param[in]  cmd_file  command path
+ * @param[in]  argv  NULL-terminated array of strings that are command line arguments
+ * @param[in]  mode  some flags (bit 1: how to handle stdout, bit 2: refrain from printing extra messages)
+ * @param[out] output  variable to store the contents of stdout of the child process or NULL
+ * @param[out] p_len  variable to store the length of the captured contents or NULL
+ * @return int  0 (success), -1 (syscall error) or positive integer (command error)
+ *
+ * @note if 'output' is non-NULL, stdout of the child process is connected to a pipe and read until EOF.
+ * @note the captured contents are always null-terminated, and the LSB of 'mode' is ignored at that time.
+ *
+ * @attention each element of 'output' must be initialized with 0 before the first call.
+ * @attention if 'output->ptr' is non-NULL, it should be released by the caller.
+ */
+int execute_capture(const char *cmd_file, char * const argv[], unsigned int mode, inf_str *output, size_t *p_len){
+    assert(mode < 4);
+    assert((! output) || p_len);
+
+    capture_dest dest = { output, p_len };
+
+    return execute_stream(cmd_file, argv, mode, -1, (output ? read_child_output : NULL), &dest);
+}
+
+
+/**
+ * @brief execute the specified command in a child process, passing its stdout to the reader through a pipe.
+ *
+ * @param[in]  cmd_file  command path
+ * @param[in]  argv  NULL-terminated array of strings that are command line arguments
+ * @param[in]  mode  some flags (bit 1: how to handle stdout, bit 2: refrain from printing extra messages)
+ * @param[in]  in_fd  file descriptor to be used as stdin of the child process or -1
+ * @param[in]  reader  function that reads the contents of stdout of the child process from the pipe or NULL
+ * @param[out] arg  argument passed to 'reader'
+ * @return int  0 (success), -1 (syscall error) or positive integer (command error)
+ *
+ * @note if 'reader' is non-NULL, stdout of the child process is connected to a pipe, and the LSB of 'mode' is ignored.
+ * @note once 'reader' returns true, the rest of the contents is discarded until EOF so that the child never blocks.
+ * @note 'reader' returning false is regarded as a syscall error, whose error number is the errno it set.
+ */
+int execute_stream(
+    const char *cmd_file,
+    char * const argv[],
+    unsigned int mode,
+    int in_fd,
+    bool (* reader)(int, void *),
+    void *arg
+){
     assert(cmd_file);
     assert(argv && argv[0]);
     assert(mode < 4);
 
-    struct sigaction new_act = {0}, sigint_act, sigquit_act;
-    sigset_t old_mask;
+    spawn_signals saved;
+    int pipe_fds[2] = { -1, -1 }, exit_status = -1, errcode = 0;
+    pid_t pid;
+    bool captured = true;
+    trace_scope scope;
 
-    pid_t pid, err = -1;
-    int tmp = 0, exit_status = -1;
+    if (! (mode & 0b10))
+        print_command_line(argv);
 
-    if (! (mode & 0b10)){
-        fputc('+', stderr);
+    trace_begin(&scope, TRACE_EXECUTE, argv[0]);
 
-        for (char * const *p_arg = argv; *p_arg; p_arg++)
-            print_sanitized_string(*p_arg);
+    if (reader){
+        if (pipe(pipe_fds))
+            goto exit;
 
-        fputc('\n', stderr);
+        if ((fcntl(pipe_fds[0], F_SETFD, FD_CLOEXEC) == -1) || (fcntl(pipe_fds[1], F_SETFD, FD_CLOEXEC) == -1))
+            goto exit;
     }
 
-    new_act.sa_handler = SIG_IGN;
-    sigemptyset(&(new_act.sa_mask));
-    sigaction(SIGINT, &new_act, &sigint_act);
-    sigaction(SIGQUIT, &new_act, &sigquit_act);
+    block_parent_signals(&saved);
 
-    sigaddset(&(new_act.sa_mask), SIGCHLD);
-    sigprocmask(SIG_BLOCK, &(new_act.sa_mask), &old_mask);
+    if ((pid = spawn_child(cmd_file, argv, mode, in_fd, pipe_fds[1], &saved)) > 0){
+        if (reader){
+            close(pipe_fds[1]);
+            pipe_fds[1] = -1;
 
-    switch ((pid = fork())){
-        case 0:   // child
-            tmp = (mode & 0b01) ? open("/dev/null", O_WRONLY) : STDERR_FILENO;
-            exit_status = 126;
+            if ((captured = reader(pipe_fds[0], arg)))
+                discard_child_output(pipe_fds[0]);
+            else
+                errcode = errno;
 
-            if (tmp >= 0){
-                if (dup2(tmp, STDOUT_FILENO) != -1){
-                    err = 0;
-                    exit_status++;
-                }
-                if (tmp != STDERR_FILENO)
-                    close(tmp);
-            }
-            break;
-        case -1:  // error
-            break;
-        default:  // parent
-            while (((err = waitpid(pid, &tmp, 0)) == -1) && (errno == EINTR));
+            close(pipe_fds[0]);
+            pipe_fds[0] = -1;
+        }
+
+        if ((exit_status = wait_child(pid)) < 0)
+            errcode = errno;
+        else if (! captured){
+            exit_status = -1;
+            if (! errcode)
+                errcode = ENOMEM;
+        }
     }
+    else
+        errcode = errno;
 
-    sigaction(SIGINT, &sigint_act, NULL);
-    sigaction(SIGQUIT, &sigquit_act, NULL);
-    sigprocmask(SIG_SETMASK, &old_mask, NULL);
+    restore_parent_signals(&saved);
 
-    // child
-    if (! pid){
-        if (! err){
-            execv(cmd_file, argv);
-            assert(exit_status == 127);
-        }
-        _exit(exit_status);
+exit:
+    if ((exit_status < 0) && (! errcode))
+        errcode = errno;
+
+    trace_end(&scope);
+
+    for (int i = 0; i < 2; i++)
+        if (pipe_fds[i] != -1)
+            close(pipe_fds[i]);
+
+    if ((mode & 0b10) ? (exit_status < 0) : exit_status){
+        errno = errcode;
+        xperror_child_process(argv[0], exit_status);
     }
 
-    // parent
-    if (err != -1){
-        if (WIFEXITED(tmp))
-            exit_status = WEXITSTATUS(tmp);
-        else {
-            exit_status = 128;
-            if (WIFSIGNALED(tmp))
-                exit_status += WTERMSIG(tmp);
-        }
+    return exit_status;
+}
+
+
+/**
+ * @brief execute the specified commands concurrently in child processes.
+ *
+ * @param[out] jobs  array of the commands to be executed, where the result of each command is also stored
+ * @param[in]  size  array size
+ * @param[in]  mode  some flags (bit 1: how to handle stdout, bit 2: refrain from printing extra messages)
+ * @return int  0 (success), -1 (syscall error) or positive integer (command error)
+ *
+ * @note all the child processes are created first, and they are reaped in the order in which they terminate.
+ * @note each child process is monitored through pidfd if the kernel supports it, otherwise in array order.
+ * @note the return value is the first non-zero exit status in array order.
+ *
+ * @attention calling this function in a multithreaded process is not recommended.
+ */
+int execute_jobs(exec_job *jobs, size_t size, unsigned int mode){
+    assert(jobs);
+    assert(size);
+    assert(mode < 4);
+
+    spawn_signals saved;
+    size_t i, running = 0;
+    int exit_status = 0;
+
+    block_parent_signals(&saved);
+
+    for (i = 0; i < size; i++){
+        assert(jobs[i].cmd_file);
+        assert(jobs[i].argv && jobs[i].argv[0]);
+
+        if (! (mode & 0b10))
+            print_command_line(jobs[i].argv);
+
+        jobs[i].exit_status = -1;
+        jobs[i].errnum = 0;
+
+        if ((jobs[i].pid = spawn_child(jobs[i].cmd_file, jobs[i].argv, mode, -1, -1, &saved)) > 0)
+            running++;
+        else
+            jobs[i].errnum = errno;
     }
-    if ((mode & 0b10) ? (exit_status < 0) : exit_status)
-        xperror_child_process(argv[0], exit_status);
+
+#ifdef SYS_pidfd_open
+    struct pollfd fds[size];
+    int ready;
+
+    // every descriptor is invalidated first, so that only the opened ones are closed if any of them fails
+    for (i = 0; i < size; i++){
+        fds[i].fd = -1;
+        fds[i].events = POLLIN;
+    }
+
+    for (i = 0; i < size; i++)
+        if ((jobs[i].pid > 0) && ((fds[i].fd = syscall(SYS_pidfd_open, jobs[i].pid, 0)) == -1))
+            break;
+
+    if (i == size)
+        while (running){
+            if ((ready = poll(fds, size, -1)) == -1){
+                if (errno == EINTR)
+                    continue;
+                break;
+            }
+
+            for (i = 0; ready && (i < size); i++)
+                if ((fds[i].fd != -1) && fds[i].revents){
+                    if ((jobs[i].exit_status = wait_child(jobs[i].pid)) < 0)
+                        jobs[i].errnum = errno;
+
+                    close(fds[i].fd);
+                    fds[i].fd = -1;
+                    jobs[i].pid = -1;
+                    ready--;
+                    running--;
+                }
+        }
+
+    for (i = 0; i < size; i++)
+        if (fds[i].fd != -1)
+            close(fds[i].fd);
+#endif
+
+    for (i = 0; running && (i < size); i++)
+        if (jobs[i].pid > 0){
+            if ((jobs[i].exit_status = wait_child(jobs[i].pid)) < 0)
+                jobs[i].errnum = errno;
+            jobs[i].pid = -1;
+            running--;
+        }
+
+    restore_parent_signals(&saved);
+
+    for (i = 0; i < size; i++)
+        if (jobs[i].exit_status){
+            if ((mode & 0b10) ? (jobs[i].exit_status < 0) : true){
+                errno = jobs[i].errnum;
+                xperror_child_process(jobs[i].argv[0], jobs[i].exit_status);
+            }
+            if (! exit_status)
+                exit_status = jobs[i].exit_status;
+        }
 
     return exit_status;
 }
@@ -844,6 +1292,25 @@ int execute(const char *cmd_file, char * const argv[], unsigned int mode){
 
 
 
+/**
+ * @brief the callback function to be passed as 'func' in 'dit_walk' function
+ *
+ * @param[in]  pwdfd  file descriptor that serves as the current working directory
+ * @param[in]  name  name of the file we are currently looking at
+ * @param[in]  isdir  whether it is a directory
+ * @param[in]  arg  pointer to the callback function passed to 'walkat'
+ * @return int  the return value of the callback function
+ */
+static int call_walk_callback(int pwdfd, const char *name, bool isdir, void *arg){
+    assert(arg);
+
+    int (* callback)(int, const char *, bool);
+
+    callback = *((int (**)(int, const char *, bool)) arg);
+    return callback(pwdfd, name, isdir);
+}
+
+
 /**
  * @brief the function that recursively scans the specified file and all files below it
  *
@@ -856,6 +1323,7 @@ int execute(const char *cmd_file, char * const argv[], unsigned int mode){
  * @note the arguments received by the callback function are the almost identical to those of this function.
  * @note the third argument of the callback function indicates whether the file of interest is a directory.
  * @note the callback function must return 0 on success and non-zero on failure.
+ * @note the scan itself is done by 'dit_walk', to which the callback is passed through above 'call_walk_callback'.
  */
 bool walkat(int pwdfd, const char *name, int type, int (* callback)(int, const char *, bool)){
     assert((pwdfd >= 0) || (pwdfd == AT_FDCWD));
@@ -863,56 +1331,7 @@ bool walkat(int pwdfd, const char *name, int type, int (* callback)(int, const c
     assert((type >= -1) && (type <= 1));
     assert(callback);
 
-    bool call_ok;
-    int new_fd;
-    DIR *dir;
-
-    call_ok = (! type);
-
-    if (type){
-        if ((new_fd = openat(pwdfd, name, (O_RDONLY | O_DIRECTORY))) != -1){
-            if ((dir = fdopendir(new_fd))){
-                struct dirent *entry;
-                const char *child;
-                bool isdir;
-                struct stat file_stat;
-
-                while ((entry = readdir(dir))){
-                    child = entry->d_name;
-                    assert(child && *child);
-
-                    if (check_if_valid_dirent(child)){
-#ifdef _DIRENT_HAVE_D_TYPE
-                        if (entry->d_type != DT_UNKNOWN)
-                            isdir = (entry->d_type == DT_DIR);
-                        else
-#endif
-                        if (! fstatat(new_fd, child, &file_stat, AT_SYMLINK_NOFOLLOW))
-                            isdir = S_ISDIR(file_stat.st_mode);
-                        else
-                            break;
-
-                        if (! walkat(new_fd, child, isdir, callback))
-                            break;
-                    }
-                }
-
-                closedir(dir);
-
-                type = true;
-                call_ok = (! entry);
-            }
-            else
-                close(new_fd);
-        }
-        else if ((type == -1) && (errno == ENOTDIR)){
-            type = false;
-            call_ok = true;
-        }
-    }
-
-    assert((! call_ok) || (type == ((bool) type)));
-    return (bool) (call_ok && (! callback(pwdfd, name, type)));
+    return (! dit_walk(NULL, pwdfd, name, type, call_walk_callback, &callback));
 }
 
 
@@ -1282,6 +1701,86 @@ int get_last_exit_status(void){
 
 
 
+/**
+ * @brief count the bytes that can be output as they are from the beginning of the target string.
+ *
+ * @param[in]  target  target string
+ * @param[in]  len  the length of the target string
+ * @param[in]  quoted  whether to use quotation
+ * @return size_t  the length of the leading span that does not need to be escaped
+ *
+ * @note scans 'SANITIZE_VECTOR_SIZE' bytes at a time, which the compiler can map to SIMD instructions.
+ */
+static size_t count_clean_bytes(const char *target, size_t len, bool quoted){
+    assert(target);
+
+    sanitize_vector vec, mask;
+    uint64_t words[SANITIZE_VECTOR_SIZE / sizeof(uint64_t)];
+    unsigned char bytes[SANITIZE_VECTOR_SIZE];
+    size_t i = 0;
+    unsigned int j, k;
+
+    for (; (len - i) >= SANITIZE_VECTOR_SIZE; i += SANITIZE_VECTOR_SIZE){
+        memcpy(&vec, (target + i), SANITIZE_VECTOR_SIZE);
+
+        mask = (sanitize_vector) ((vec < 0x20) | (vec > 0x7E));
+        mask |= (sanitize_vector) ((vec == '\"') | (vec == '\'') | (vec == '\\'));
+        if (! quoted)
+            mask |= (sanitize_vector) (vec == ' ');
+
+        memcpy(words, &mask, SANITIZE_VECTOR_SIZE);
+
+        for (j = 0; j < numof(words); j++)
+            if (words[j]){
+                memcpy(bytes, &mask, SANITIZE_VECTOR_SIZE);
+
+                for (k = j * sizeof(uint64_t); ! bytes[k]; k++)
+                    assert(k < SANITIZE_VECTOR_SIZE);
+
+                return i + k;
+            }
+    }
+
+    for (; i < len; i++){
+        j = (unsigned char) target[i];
+        if ((j / 128) || ((escape_char_table[j] != '_') && ((j != ' ') || (! quoted))))
+            break;
+    }
+
+    return i;
+}
+
+
+/**
+ * @brief store the escape sequence representing the specified byte.
+ *
+ * @param[out] dest  where to store the escape sequence (at least 4 bytes)
+ * @param[in]  i  target byte that needs to be escaped
+ * @return size_t  the length of the stored escape sequence
+ */
+static size_t escape_one_byte(char *dest, unsigned int i){
+    assert(dest);
+    assert(i && (i < 256));
+
+    int c = '?';
+
+    if (! (i / 128)){
+        assert(escape_char_table[i] != '_');
+
+        if ((c = escape_char_table[i]) == '?'){
+            memcpy(dest, "\\x", (sizeof(char) * 2));
+            memcpy((dest + 2), ((i / 32) ? "7F" : &(escape_hex_table[i * 2])), (sizeof(char) * 2));
+            return 4;
+        }
+    }
+
+    assert(strchr("abefnrtv \"\'\\?", c));
+    dest[0] = '\\';
+    dest[1] = c;
+    return 2;
+}
+
+
 /**
  * @brief get the sanitized string for display.
  *
@@ -1290,6 +1789,8 @@ int get_last_exit_status(void){
  * @param[in]  quoted  whether to use quotation
  * @return size_t  the length of the stored string
  *
+ * @note the spans that do not need to be escaped are copied in bulk.
+ *
  * @attention the size of 'dest' must be greater than four times the length of the string before conversion.
  */
 size_t get_sanitized_string(char *dest, const char *target, bool quoted){
@@ -1297,38 +1798,22 @@ size_t get_sanitized_string(char *dest, const char *target, bool quoted){
     assert(target);
 
     char *buf;
-    unsigned int i;
-    int c;
+    size_t len, size;
 
     buf = dest;
+    len = strlen(target);
 
-    while ((i = (unsigned char) *(target++))){
-        c = '?';
-
-        if (! (i / 128)){
-            assert(i < sizeof(escape_char_table));
+    while (true){
+        size = count_clean_bytes(target, len, quoted);
+        memcpy(buf, target, (sizeof(char) * size));
+        buf += size;
 
-            switch ((c = escape_char_table[i])){
-                case '?':
-                    memcpy(buf, "\\x", (sizeof(char) * 2));
-                    buf += 2;
-                    memcpy(buf, ((i / 32) ? "7F" : &(escape_hex_table[i * 2])), (sizeof(char) * 2));
-                    buf += 2;
-                    continue;
-                case ' ':
-                    assert(i == ' ');
-                    if (! quoted)
-                        break;
-                case '_':
-                    assert(isprint(i));
-                    *(buf++) = i;
-                    continue;
-            }
-        }
+        if (! (len -= size))
+            break;
 
-        assert(strchr("abefnrtv \"\'\\?", c));
-        *(buf++) = '\\';
-        *(buf++) = c;
+        target += size;
+        buf += escape_one_byte(buf, (unsigned char) *(target++));
+        len--;
     }
 
     *buf = '\0';
@@ -1339,26 +1824,52 @@ size_t get_sanitized_string(char *dest, const char *target, bool quoted){
 
 
 /**
- * @brief print the sanitized string to stderr.
+ * @brief write the sanitized string to the specified stream.
  *
+ * @param[in]  stream  output stream
  * @param[in]  target  target string
+ * @param[in]  quoted  whether to use quotation
  *
- * @note add a space before the target string and display it.
+ * @note unlike 'get_sanitized_string', no buffer proportional to the length of the target string is required.
  */
-void print_sanitized_string(const char *target){
+void fprint_sanitized_string(FILE *stream, const char *target, bool quoted){
+    assert(stream);
     assert(target);
 
-    size_t size;
-    size = (strlen(target) * 4 + 1) + 1;
+    char buf[4];
+    size_t len, size;
 
-    char buf[size];
-    get_sanitized_string((buf + 1), target, false);
+    len = strlen(target);
+
+    while (true){
+        if ((size = count_clean_bytes(target, len, quoted)))
+            fwrite(target, sizeof(char), size, stream);
 
-    *buf = ' ';
-    fputs(buf, stderr);
+        if (! (len -= size))
+            break;
+
+        target += size;
+        size = escape_one_byte(buf, (unsigned char) *(target++));
+        fwrite(buf, sizeof(char), size, stream);
+        len--;
+    }
 }
 
 
+/**
+ * @brief print the sanitized string to stderr.
+ *
+ * @param[in]  target  target string
+ *
+ * @note add a space before the target string and display it.
+ */
+void print_sanitized_string(const char *target){
+    assert(target);
+
+    fputc(' ', stderr);
+    fprint_sanitized_string(stderr, target, false);
+}
+
 
 
 #ifndef NDEBUG
@@ -1380,6 +1891,8 @@ static void xstrcmp_upper_case_test(void);
 static void xstrcat_inf_len_test(void);
 
 static void execute_test(void);
+static void execute_capture_test(void);
+static void execute_jobs_test(void);
 static void walk_test(void);
 
 static void receive_positive_integer_test(void);
@@ -1408,8 +1921,16 @@ void dit_test(void){
     do_test(get_last_exit_status_test);
     do_test(get_sanitized_string_test);
 
+    do_test(execute_capture_test);
+    do_test(execute_jobs_test);
+
     do_test(execute_test);
     do_test(walk_test);
+
+    trace_test();
+    workload_test();
+    regcache_test();
+    libdit_test();
 }
 
 
@@ -1750,6 +2271,92 @@ static void execute_test(void){
 
 
 
+static void execute_capture_test(void){
+    const struct {
+        const char *script;
+        const char *result;
+        const size_t len;
+        const int exit_status;
+    }
+    // changeable part for updating test cases
+    table[] = {
+        { "printf ''",                                "",                0,            0 },
+        { "echo dit",                                 "dit\n",           4,            0 },
+        { "echo out; echo err >&2; exit 3",           "out\n",           4,            3 },
+        { "head -c 100000 /dev/zero | tr '\\0' _",    NULL,         100000,            0 },
+        { "kill -TERM $$",                              NULL,              0, 128 + SIGTERM },
+        {  0,                                            0,               0,            0 }
+    };
+
+    int i;
+    char *argv[] = { "sh", "-c", NULL, NULL };
+    inf_str output = {0};
+    size_t len;
+
+    for (i = 0; table[i].script; i++){
+        argv[2] = (char *) table[i].script;
+        len = (size_t) -1;
+
+        assert(execute_capture("/bin/sh", argv, 0b10, &output, &len) == table[i].exit_status);
+        assert(output.ptr);
+
+        if (table[i].result){
+            assert(len == table[i].len);
+            assert(! strcmp(output.ptr, table[i].result));
+        }
+        else if (table[i].len){
+            assert(len == table[i].len);
+            assert(strspn(output.ptr, "_") == len);
+            assert(output.max > len);
+        }
+
+        print_progress_test_loop('\0', -1, i);
+        fprintf(stderr, "%3d  %s\n", table[i].exit_status, table[i].script);
+    }
+
+    free(output.ptr);
+}
+
+
+
+
+static void execute_jobs_test(void){
+    char * const argv1[] = { "sh", "-c", "sleep 0.2", NULL };
+    char * const argv2[] = { "sh", "-c", "sleep 0.1; exit 2", NULL };
+    char * const argv3[] = { "test", NULL };
+
+    exec_job jobs[] = {
+        { .cmd_file = "/bin/sh", .argv = argv1 },
+        { .cmd_file = "/bin/sh", .argv = argv2 },
+        { .cmd_file = "/bin/sh", .argv = argv1 },
+        { .cmd_file = "/dit/tmp/no-such-command", .argv = argv3 }
+    };
+
+    struct timespec start, end;
+    long elapsed;
+
+    assert(! clock_gettime(CLOCK_MONOTONIC, &start));
+    assert(execute_jobs(jobs, numof(jobs), 0b10) == 2);
+    assert(! clock_gettime(CLOCK_MONOTONIC, &end));
+
+    elapsed = (end.tv_sec - start.tv_sec) * 1000 + (end.tv_nsec - start.tv_nsec) / 1000000;
+
+    assert(! jobs[0].exit_status);
+    assert(jobs[1].exit_status == 2);
+    assert(! jobs[2].exit_status);
+    assert((jobs[3].exit_status == -1) && (jobs[3].errnum == ENOENT));
+
+    for (size_t i = 0; i < numof(jobs); i++)
+        assert(jobs[i].pid == -1);
+
+    // the child processes that sleep for 0.2 seconds each run concurrently
+    assert(elapsed < 400);
+    fprintf(stderr, "  elapsed:  %ld ms\n", elapsed);
+}
+
+
+
+
 static inf_str walked_start = {0};
 static size_t walked_len = 0;
 
@@ -2180,25 +2787,263 @@ static void get_sanitized_string_test(void){
         { "\002-\020",           false, "\\x02-\\x10"              },
         { "\a\b \r\n \v\f",      false, "\\a\\b\\ \\r\\n\\ \\v\\f" },
         { "\033[??;??m \033[0m", false, "\\e[??;??m\\ \\e[0m"      },
+
+        // the cases where the bytes to be escaped are located across the scanning units
+        {
+            "0123456789abcdef0123456789abcde\"0123456789ABCDEF",
+            true,
+            "0123456789abcdef0123456789abcde\\\"0123456789ABCDEF"
+        },
+        {
+            "0123456789abcdef0123456789abcdef0123456789abcdef\x7F",
+            false,
+            "0123456789abcdef0123456789abcdef0123456789abcdef\\x7F"
+        },
+        {
+            "/usr/local/lib/python3.11/site-packages/\xE3\x81\x82 \t0123456789abcdef",
+            false,
+            "/usr/local/lib/python3.11/site-packages/\\?\\?\\?\\ \\t0123456789abcdef"
+        },
+
         {  0,                      0,    0                         }
     };
 
     int i;
-    char buf[64];
-    size_t len;
+    char buf[256], *output;
+    size_t len, size;
+    FILE *fp;
 
     for (i = 0; table[i].target; i++){
         len = get_sanitized_string(buf, table[i].target, table[i].quoted);
-        assert(len < 64);
+        assert(len < 256);
         assert(len == strlen(table[i].result));
         assert(! memcmp(buf, table[i].result, (sizeof(char) * (len + 1))));
 
+        output = NULL;
+        assert((fp = open_memstream(&output, &size)));
+        fprint_sanitized_string(fp, table[i].target, table[i].quoted);
+        assert(! fclose(fp));
+
+        assert(size == len);
+        assert(! memcmp(output, table[i].result, (sizeof(char) * (len + 1))));
+        free(output);
+
         print_progress_test_loop('\0', -1, i);
         fprintf(stderr, "'%s'\n", table[i].result);
     }
+
+
+    // the case where the target string spans many vectors and escape sequences
+    char target[768], result[768 * 4];
+    size_t j;
+
+    for (j = 0; j < (sizeof(target) - 1); j++)
+        target[j] = ((j % 7) == 6) ? '\t' : ((j % 61) == 60) ? '\x7F' : ('a' + (j % 26));
+    target[j] = '\0';
+
+    len = get_sanitized_string(result, target, false);
+
+    output = NULL;
+    assert((fp = open_memstream(&output, &size)));
+    fprint_sanitized_string(fp, target, false);
+    assert(! fclose(fp));
+
+    assert(size == len);
+    assert(! memcmp(output, result, (sizeof(char) * (len + 1))));
+    free(output);
+
+    print_progress_test_loop('\0', -1, i);
+    fprintf(stderr, "%zu bytes written to the stream\n", len);
+}
+
+
+
+
+/******************************************************************************
+    * Benchmark Functions
+******************************************************************************/
+
+
+static void gen_command_names(bench_input *input);
+static void gen_dockerfile_lines(bench_input *input);
+static void gen_history_file(bench_input *input);
+static void gen_unsanitized_string(bench_input *input);
+
+static void receive_expected_string_bench(const bench_input *input);
+static void receive_dockerfile_instr_bench(const bench_input *input);
+static void xfgets_for_loop_bench(const bench_input *input);
+static void get_sanitized_string_bench(const bench_input *input);
+
+
+
+
+void dit_bench(void){
+    do_bench(receive_expected_string_bench, gen_command_names);
+    do_bench(receive_dockerfile_instr_bench, gen_dockerfile_lines);
+    do_bench(xfgets_for_loop_bench, gen_history_file);
+    do_bench(get_sanitized_string_bench, gen_unsanitized_string);
+}
+
+
+
+
+static void gen_command_names(bench_input *input){
+    const char * const others[] = { "", "c", "re", "insp", "er", "Reflect", "dit", "optimizer" };
+    const size_t size = 256;
+
+    const char **names;
+    size_t i, j;
+
+    assert((names = (const char **) malloc(sizeof(const char *) * size)));
+
+    for (i = 0; i < size; i++){
+        j = rand() % (CMDS_NUM + numof(others));
+        names[i] = (j < CMDS_NUM) ? cmd_reprs[j] : others[j - CMDS_NUM];
+        input->bytes += strlen(names[i]) + 1;
+    }
+
+    input->data = names;
+    input->items = size;
+}
+
+
+static void receive_expected_string_bench(const bench_input *input){
+    const char * const *names;
+    size_t i;
+
+    names = (const char * const *) input->data;
+
+    for (i = 0; i < input->items; i++)
+        bench_sink += receive_expected_string(names[i], cmd_reprs, CMDS_NUM, 2);
+}
+
+
+
+
+static void gen_dockerfile_lines(bench_input *input){
+    const size_t size = 256;
+
+    workload_rng rng;
+    FILE *fp;
+    char **targets, *buf;
+    size_t buf_size, i;
+
+    workload_seed(&rng, rand());
+
+    assert((fp = open_memstream(&buf, &buf_size)));
+    assert(! gen_workload_dockerfile(fp, &rng, size, &(input->bytes)));
+    assert(! fclose(fp));
+
+    assert((targets = (char **) malloc(sizeof(char *) * size)));
+
+    for (i = 0; i < size; i++){
+        targets[i] = buf;
+        assert((buf = strchr(buf, '\n')));
+        *(buf++) = '\0';
+    }
+
+    input->data = targets;
+    input->extra = targets[0];
+    input->items = size;
+}
+
+
+static void receive_dockerfile_instr_bench(const bench_input *input){
+    char * const *targets;
+    size_t i;
+    int instr_id;
+
+    targets = (char * const *) input->data;
+
+    for (i = 0; i < input->items; i++){
+        instr_id = -1;
+        bench_sink += (size_t) receive_dockerfile_instr(targets[i], &instr_id);
+    }
+}
+
+
+
+
+static void gen_history_file(bench_input *input){
+    const size_t size = 10000;
+
+    workload_rng rng;
+    FILE *fp;
+
+    workload_seed(&rng, rand());
+
+    assert((fp = fopen(TMP_FILE1, "w")));
+    assert(! gen_workload_history(fp, &rng, size, &(input->bytes)));
+    assert(! fclose(fp));
+
+    input->items = size;
+}
+
+
+static void xfgets_for_loop_bench(const bench_input *input){
+    char *line;
+
+    while ((line = xfgets_for_loop(TMP_FILE1, NULL, NULL, NULL)))
+        bench_sink += (unsigned char) *line;
+}
+
+
+
+
+static void gen_unsanitized_string(bench_input *input){
+    const size_t size = 4096;
+
+    char *target;
+    size_t i;
+    int c;
+
+    assert((target = (char *) malloc(sizeof(char) * (size + 1))));
+    assert((input->extra = malloc(sizeof(char) * (size * 4 + 1))));
+
+    // about 3% of the characters need to be escaped
+    for (i = 0; i < size; i++){
+        c = rand() % 100;
+        target[i] = (c < 1) ? '\t' : ((c < 3) ? '\'' : (' ' + 1 + rand() % 94));
+    }
+    target[size] = '\0';
+
+    input->data = target;
+    input->items = 1;
+    input->bytes = size;
+}
+
+
+static void get_sanitized_string_bench(const bench_input *input){
+    bench_sink += get_sanitized_string((char *) input->extra, (const char *) input->data, true);
+}
+
+
+
+
+/******************************************************************************
+    * Fuzzing Functions
+******************************************************************************/
+
+
+static void receive_expected_string_fuzz(const char *input, size_t len);
+
+
+
+
+void dit_fuzz(void){
+    const char * const cmd_seeds[] = { "c", "co", "conv", "erase", "insp", "Reflect", "optimizer", "healthcheckk" };
+
+    do_fuzz(receive_expected_string_fuzz, cmd_seeds, "");
+}
+
+
+
+
+static void receive_expected_string_fuzz(const char *input, size_t len){
+    bench_sink += receive_expected_string(input, cmd_reprs, CMDS_NUM, 3);
 }
 
 
 
 
-#endif // NDEBUG
\ No newline at end of file
+#endif // NDEBUG
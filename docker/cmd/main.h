@@ -8,9 +8,13 @@
 #include <ctype.h>
 #include <errno.h>
 #include <limits.h>
+#include <malloc.h>
+#include <math.h>
 #include <signal.h>
 #include <stdarg.h>
+#include <stdatomic.h>
 #include <stdbool.h>
+#include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -19,17 +23,31 @@
 #include <sys/types.h>
 
 #include <dirent.h>
+#include <elf.h>
 #include <fcntl.h>
 #include <getopt.h>
 #include <grp.h>
+#include <inttypes.h>
+#include <poll.h>
+#include <pthread.h>
 #include <pwd.h>
 #include <regex.h>
+#include <spawn.h>
+#include <sys/file.h>
 #include <sys/mman.h>
+#include <sys/resource.h>
+#include <sys/sendfile.h>
 #include <sys/stat.h>
+#include <sys/syscall.h>
 #include <sys/wait.h>
 #include <unistd.h>
 
+#include "igntab.h"
+#include "libdit.h"
+#include "regcache.h"
 #include "test.h"
+#include "trace.h"
+#include "workload.h"
 #include "yyjson.h"
 
 
@@ -49,7 +67,7 @@
 #define UNEXPECTED_ERROR (-1)
 #define FATAL_ERROR  (UNEXPECTED_ERROR + ERROR_EXIT)
 
-#define CMDS_NUM 14
+#define CMDS_NUM 17
 #define ARGS_NUM 3
 #define DOCKER_INSTRS_NUM 18
 
@@ -69,6 +87,8 @@
 #define ERASE_RESULT_FILE_D "/dit/srv/erase-result.dock"
 #define ERASE_RESULT_FILE_H "/dit/srv/erase-result.hist"
 
+#define REFLECT_LOG_FILE "/dit/var/reflect.log"
+
 
 
 
@@ -103,6 +123,16 @@
 #define remove_all(name)  walk(name, removeat)
 
 
+/******************************************************************************
+    * commonly used Allocators
+******************************************************************************/
+
+#define malloc(size)  trace_malloc(size)
+#define calloc(nmemb, size)  trace_calloc(nmemb, size)
+#define realloc(ptr, size)  trace_realloc(ptr, size)
+#define free(ptr)  trace_free(ptr)
+
+
 
 
 /******************************************************************************
@@ -117,12 +147,15 @@
 #define DIT_HEALTHCHECK   5
 #define DIT_HELP          6
 #define DIT_IGNORE        7
-#define DIT_INSPECT       8
-#define DIT_LABEL         9
-#define DIT_ONBUILD      10
-#define DIT_OPTIMIZE     11
-#define DIT_PACKAGE      12
-#define DIT_REFLECT      13
+#define DIT_INIT          8
+#define DIT_INSPECT       9
+#define DIT_LABEL        10
+#define DIT_ONBUILD      11
+#define DIT_OPTIMIZE     12
+#define DIT_PACKAGE      13
+#define DIT_REFLECT      14
+#define DIT_SESSION      15
+#define DIT_STATS        16
 
 
 /******************************************************************************
@@ -162,6 +195,16 @@ typedef struct {
 } inf_str;
 
 
+/** Data type for storing the information about a command to be executed concurrently with others */
+typedef struct {
+    const char *cmd_file;    /** command path */
+    char * const *argv;      /** NULL-terminated array of strings that are command line arguments */
+    pid_t pid;               /** process ID of the child process while it is running, otherwise -1 */
+    int exit_status;         /** 0 (success), -1 (syscall error) or positive integer (command error) */
+    int errnum;              /** the error number when a syscall error occurred */
+} exec_job;
+
+
 
 
 /******************************************************************************
@@ -176,12 +219,15 @@ int erase(int argc, char **argv);
 int healthcheck(int argc, char **argv);
 int help(int argc, char **argv);
 int ignore(int argc, char **argv);
+int init(int argc, char **argv);
 int inspect(int argc, char **argv);
 int label(int argc, char **argv);
 int onbuild(int argc, char **argv);
 int optimize(int argc, char **argv);
 int package(int argc, char **argv);
 int reflect(int argc, char **argv);
+int session(int argc, char **argv);
+int stats(int argc, char **argv);
 
 
 /******************************************************************************
@@ -196,12 +242,15 @@ void erase_manual(void);
 void healthcheck_manual(void);
 void help_manual(void);
 void ignore_manual(void);
+void init_manual(void);
 void inspect_manual(void);
 void label_manual(void);
 void onbuild_manual(void);
 void optimize_manual(void);
 void package_manual(void);
 void reflect_manual(void);
+void session_manual(void);
+void stats_manual(void);
 
 
 /******************************************************************************
@@ -217,9 +266,17 @@ bool load_ignore_file(int offset, int original);
 void unload_ignore_file(void);
 bool check_if_ignored(int argc, char **argv);
 
+bool measure_dir_tree(const char *path, bool compress, off_t sizes[3]);
+bool estimate_file_sizes(char * const *paths, size_t paths_num, off_t (* sizes)[3]);
+
+bool get_remaining_budget(off_t *p_remaining, bool *p_stale);
+
 int reflect_to_dockerfile(size_t lines_num, char *lines, bool verbose, int instr_c);
 int read_provisional_report(int reflecteds[2]);
 int write_provisional_report(int reflecteds[2]);
+int peek_provisional_report(int reflecteds[2]);
+int lock_provisional_report(void);
+void unlock_provisional_report(void);
 
 
 /******************************************************************************
@@ -259,6 +316,9 @@ bool xstrcat_inf_len(inf_str *base, size_t base_len, const char *suf, size_t suf
 ******************************************************************************/
 
 int execute(const char *cmd_file, char * const argv[], unsigned int mode);
+int execute_capture(const char *cmd_file, char * const argv[], unsigned int mode, inf_str *output, size_t *p_len);
+int execute_stream(const char *cmd_file, char * const argv[], unsigned int mode, int in_fd, bool (* reader)(int, void *), void *arg);
+int execute_jobs(exec_job *jobs, size_t size, unsigned int mode);
 
 bool walkat(int pwdfd, const char *name, int type, int (* callback)(int, const char *, bool));
 
@@ -286,6 +346,7 @@ int get_file_size(const char *file_name);
 int get_last_exit_status(void);
 
 size_t get_sanitized_string(char *dest, const char *target, bool quoted);
+void fprint_sanitized_string(FILE *stream, const char *target, bool quoted);
 void print_sanitized_string(const char *target);
 
 
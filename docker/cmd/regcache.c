@@ -0,0 +1,1267 @@
+/**
+ * @file regcache.c
+ *
+ * Copyright (c) 2023 Tsukasa Inada
+ *
+ * @brief Described the cache of regex patterns compiled into deterministic automata shared by all dit commands.
+ * @author Tsukasa Inada
+ * @date 2023/10/16
+ *
+ * @note The automata only answer whether a string contains a match, and cover the common subset of ERE.
+ * @note For the other patterns or flags, and for the automata that would be too large, 'regcomp' is used.
+ * @note Each pattern is stored in one of the slots of the cache, chosen by the hash of the pattern and flags.
+ * @note The cache files are mapped read-only, and replaced with 'rename' so that readers never see a partial one.
+ */
+
+#include "main.h"
+
+#define REGCACHE_CFLAGS (REG_EXTENDED | REG_ICASE | REG_NOSUB)
+
+#define REGCACHE_PATH_MAX 64
+#define REGCACHE_NODES_MAX 512
+#define REGCACHE_NFA_MAX 1024
+#define REGCACHE_DEPTH_MAX 32
+#define REGCACHE_DUP_MAX 255
+#define REGCACHE_BUCKETS 512
+
+#define REGCACHE_WORDS  ((REGCACHE_NFA_MAX + 31) >> 5)
+
+#define regcache_trans(header)  ((const uint16_t *) ((const regcache_header *) (header) + 1))
+#define regcache_classes(header) \
+    ((const unsigned char *) (regcache_trans(header) + (size_t) (header)->states_num * (header)->classes_num))
+#define regcache_accepts(header)  (regcache_classes(header) + 256)
+#define regcache_pattern(header)  ((const char *) (regcache_accepts(header) + (header)->states_num))
+
+#define regcache_size(states_num, classes_num, pattern_len) \
+    (sizeof(regcache_header) + sizeof(uint16_t) * (states_num) * (classes_num) + 256 + (states_num) + (pattern_len) + 1)
+
+#define setbit_byte_set(set, c)  ((set)[(c) >> 5] |= (1U << ((c) & 0b11111)))
+#define getbit_byte_set(set, c)  ((set)[(c) >> 5] & (1U << ((c) & 0b11111)))
+
+
+/** Data type for storing a node of the syntax tree of a regex pattern */
+typedef struct {
+    int type;            /** 'c' (bytes), '.' (concatenation), '|' (alternation), '*' (repetition), '^', '$' or 'e' */
+    int left;            /** index of the left or only child */
+    int right;           /** index of the right child */
+    int min;             /** the minimum number of repetitions */
+    int max;             /** the maximum number of repetitions, or -1 if unlimited */
+    uint32_t set[8];     /** set of bytes matched by the node */
+} regcache_node;
+
+
+/** Data type for storing a state of the nondeterministic automaton */
+typedef struct {
+    int type;            /** 'c' (bytes), 's' (split), '^', '$' or 'm' (match) */
+    int node;            /** index of the node that has the set of bytes */
+    int out1;            /** the next state */
+    int out2;            /** the other next state, if split */
+} regcache_nfa;
+
+
+/** Data type for storing the intermediate data to build an automaton */
+typedef struct {
+    const char *src;                                     /** the rest of the pattern string */
+    int cflags;                                          /** the flags passed to 'regcomp_cached' */
+    int depth;                                           /** the nesting level of parentheses */
+    size_t nodes_num;                                    /** the number of nodes */
+    regcache_node nodes[REGCACHE_NODES_MAX];             /** the syntax tree */
+    size_t nfa_num;                                      /** the number of states of the NFA */
+    regcache_nfa nfa[REGCACHE_NFA_MAX];                  /** the NFA */
+    size_t states_num;                                   /** the number of states of the DFA */
+    uint32_t sets[REGCACHE_STATES_MAX][REGCACHE_WORDS];  /** the set of states of the NFA for each state of the DFA */
+    int chains[REGCACHE_STATES_MAX];                     /** index of the next state in the same bucket, or -1 */
+    int buckets[REGCACHE_BUCKETS];                       /** index of the first state in each bucket, or -1 */
+    int stack[REGCACHE_NFA_MAX];                         /** work area to compute the closures */
+} regcache_builder;
+
+
+static bool map_regcache(const char *path, const char *pattern, int cflags, cached_regex *creg);
+static bool check_regcache(const regcache_header *header, size_t size, const char *pattern, int cflags);
+static void write_regcache(const char *path, const regcache_header *header, size_t size);
+
+static regcache_header *build_regcache(const char *pattern, int cflags, size_t *p_size);
+
+static int parse_alternation(regcache_builder *builder);
+static int parse_concatenation(regcache_builder *builder);
+static int parse_repetition(regcache_builder *builder);
+static int parse_atom(regcache_builder *builder);
+static bool parse_bracket(regcache_builder *builder, uint32_t *set);
+static void fold_byte_set(uint32_t *set);
+static int new_node(regcache_builder *builder, int type, int left, int right);
+
+static int generate_nfa(regcache_builder *builder, int node, int next);
+static int new_nfa(regcache_builder *builder, int type, int node, int out1, int out2);
+
+static regcache_header *construct_dfa(regcache_builder *builder, int start, const char *pattern, size_t *p_size);
+static void compute_closure(regcache_builder *builder, uint32_t *set, bool at_begin, bool at_end);
+static int lookup_dfa_state(regcache_builder *builder, const uint32_t *set);
+
+
+/** name of the directory where the cache files are stored */
+static const char *regcache_dir = REGCACHE_DIR;
+
+
+/** array of the character classes available in bracket expressions, and the corresponding functions */
+static const struct {
+    const char *name;
+    int (* func)(int);
+} regcache_char_classes[] = {
+    { "alnum",  isalnum  },
+    { "alpha",  isalpha  },
+    { "blank",  isblank  },
+    { "cntrl",  iscntrl  },
+    { "digit",  isdigit  },
+    { "graph",  isgraph  },
+    { "lower",  islower  },
+    { "print",  isprint  },
+    { "punct",  ispunct  },
+    { "space",  isspace  },
+    { "upper",  isupper  },
+    { "xdigit", isxdigit },
+    {  NULL,    NULL     }
+};
+
+
+
+
+/******************************************************************************
+    * Interface for the Regex Cache
+******************************************************************************/
+
+
+/**
+ * @brief compile a regex pattern, reusing the automaton in the cache if possible.
+ *
+ * @param[out] creg  variable to store the compiled pattern
+ * @param[in]  pattern  regex pattern string
+ * @param[in]  cflags  the flags for 'regcomp'
+ * @return int  0 (success) or the error code returned by 'regcomp'
+ *
+ * @note on failure, 'creg->preg' can be passed to 'regerror'.
+ * @note the validity of the pattern is always checked by 'regcomp' before an automaton is cached.
+ * @note failures to read or write the cache are ignored, since the cache is only an optimization.
+ *
+ * @attention the compiled pattern must be released by 'regfree_cached' unless an error is returned.
+ */
+int regcomp_cached(cached_regex *creg, const char *pattern, int cflags){
+    assert(creg);
+    assert(pattern);
+
+    char path[REGCACHE_PATH_MAX];
+    uint32_t hash = 2166136261U;
+    const unsigned char *src;
+    int errcode;
+    bool cacheable;
+    regcache_header *header;
+
+    creg->dfa = NULL;
+    creg->dfa_size = 0;
+    creg->mapped = false;
+
+    if ((cacheable = ((cflags & REG_EXTENDED) && (! (cflags & ~REGCACHE_CFLAGS))))){
+        for (src = (const unsigned char *) pattern; *src; src++)
+            hash = (hash ^ *src) * 16777619U;
+        hash = (hash ^ ((unsigned int) cflags)) * 16777619U;
+        hash = (hash ^ REGCACHE_VERSION) * 16777619U;
+
+        snprintf(path, REGCACHE_PATH_MAX, "%s/%02x.dfa", regcache_dir, (hash % REGCACHE_SLOTS));
+
+        if (map_regcache(path, pattern, cflags, creg))
+            return SUCCESS;
+    }
+
+    if ((errcode = regcomp(&(creg->preg), pattern, cflags)))
+        return errcode;
+
+    if (cacheable && (header = build_regcache(pattern, cflags, &(creg->dfa_size)))){
+        regfree(&(creg->preg));
+        creg->dfa = header;
+        write_regcache(path, header, creg->dfa_size);
+    }
+
+    return SUCCESS;
+}
+
+
+/**
+ * @brief check whether the string contains a match for the compiled pattern.
+ *
+ * @param[in]  creg  compiled pattern
+ * @param[in]  string  target string
+ * @return int  0 (match), 'REG_NOMATCH' or the other error code returned by 'regexec'
+ *
+ * @note the same as calling 'regexec' with no subexpressions and no flags.
+ */
+int regexec_cached(const cached_regex *creg, const char *string){
+    assert(creg);
+    assert(string);
+
+    if (! creg->dfa)
+        return regexec(&(creg->preg), string, 0, NULL, 0);
+
+    const uint16_t *trans;
+    const unsigned char *classes, *accepts, *src;
+    size_t classes_num;
+    unsigned int state = 0, flags;
+
+    trans = regcache_trans(creg->dfa);
+    classes = regcache_classes(creg->dfa);
+    accepts = regcache_accepts(creg->dfa);
+    classes_num = creg->dfa->classes_num;
+
+    src = (const unsigned char *) string;
+
+    while (! ((flags = accepts[state]) & (REGCACHE_ACCEPT | REGCACHE_DEAD))){
+        if (! *src)
+            return (flags & REGCACHE_ACCEPT_AT_END) ? SUCCESS : REG_NOMATCH;
+        state = trans[state * classes_num + classes[*(src++)]];
+    }
+
+    return (flags & REGCACHE_ACCEPT) ? SUCCESS : REG_NOMATCH;
+}
+
+
+/**
+ * @brief release the compiled pattern.
+ *
+ * @param[out] creg  compiled pattern
+ */
+void regfree_cached(cached_regex *creg){
+    assert(creg);
+
+    if (creg->dfa){
+        if (creg->mapped)
+            munmap((void *) creg->dfa, creg->dfa_size);
+        else
+            free((void *) creg->dfa);
+
+        creg->dfa = NULL;
+    }
+    else
+        regfree(&(creg->preg));
+}
+
+
+
+
+/******************************************************************************
+    * Cache Files
+******************************************************************************/
+
+
+/**
+ * @brief map the automaton for the pattern from the cache file, if it is valid.
+ *
+ * @param[in]  path  name of the cache file
+ * @param[in]  pattern  regex pattern string
+ * @param[in]  cflags  the flags for 'regcomp'
+ * @param[out] creg  variable to store the mapped automaton
+ * @return bool  whether the automaton has been mapped
+ */
+static bool map_regcache(const char *path, const char *pattern, int cflags, cached_regex *creg){
+    assert(path);
+    assert(pattern);
+    assert(creg);
+
+    int fd;
+    struct stat file_stat;
+    void *addr = MAP_FAILED;
+
+    if ((fd = open(path, (O_RDONLY | O_NOFOLLOW | O_NONBLOCK | O_CLOEXEC))) != -1){
+        if ((! fstat(fd, &file_stat)) && S_ISREG(file_stat.st_mode) &&
+            (file_stat.st_size >= ((off_t) sizeof(regcache_header))))
+            addr = mmap(NULL, file_stat.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        close(fd);
+    }
+
+    if (addr != MAP_FAILED){
+        if (check_regcache(addr, file_stat.st_size, pattern, cflags)){
+            creg->dfa = addr;
+            creg->dfa_size = file_stat.st_size;
+            creg->mapped = true;
+            return true;
+        }
+        munmap(addr, file_stat.st_size);
+    }
+
+    return false;
+}
+
+
+/**
+ * @brief check that the automaton is consistent and built for the pattern by this version of the engine.
+ *
+ * @param[in]  header  the automaton
+ * @param[in]  size  the size of the automaton
+ * @param[in]  pattern  regex pattern string
+ * @param[in]  cflags  the flags for 'regcomp'
+ * @return bool  valid or not
+ *
+ * @note all the transitions are checked, so that a broken cache file never causes out-of-bounds access.
+ */
+static bool check_regcache(const regcache_header *header, size_t size, const char *pattern, int cflags){
+    assert(header);
+    assert(pattern);
+
+    size_t len, i;
+    const uint16_t *trans;
+    const unsigned char *classes;
+
+    if ((header->magic != REGCACHE_MAGIC) || (header->version != REGCACHE_VERSION) || (header->cflags != cflags))
+        return false;
+
+    len = strlen(pattern);
+
+    if ((header->pattern_len != len) || (! header->states_num) || (header->states_num > REGCACHE_STATES_MAX))
+        return false;
+    if ((! header->classes_num) || (header->classes_num > 256))
+        return false;
+    if (size != regcache_size(header->states_num, header->classes_num, len))
+        return false;
+    if (memcmp(regcache_pattern(header), pattern, (sizeof(char) * (len + 1))))
+        return false;
+
+    classes = regcache_classes(header);
+
+    for (i = 0; i < 256; i++)
+        if (classes[i] >= header->classes_num)
+            return false;
+
+    trans = regcache_trans(header);
+
+    for (i = header->states_num * header->classes_num; i--;)
+        if (trans[i] >= header->states_num)
+            return false;
+
+    return true;
+}
+
+
+/**
+ * @brief store the automaton in the cache file, replacing the one in the same slot.
+ *
+ * @param[in]  path  name of the cache file
+ * @param[in]  header  the automaton
+ * @param[in]  size  the size of the automaton
+ *
+ * @note the directory is created only by 'dit init', so that no user can plant a file or a symbolic link in it.
+ * @note the temporary file is created exclusively, since this runs with the privileges of the setuid binary.
+ */
+static void write_regcache(const char *path, const regcache_header *header, size_t size){
+    assert(path);
+    assert(header);
+
+    char tmp_path[REGCACHE_PATH_MAX + 16];
+    int fd;
+    bool written = false;
+
+    snprintf(tmp_path, sizeof(tmp_path), "%s.%d", path, ((int) getpid()));
+
+    if ((fd = open(tmp_path, (O_WRONLY | O_CREAT | O_EXCL | O_NOFOLLOW | O_CLOEXEC), 0644)) != -1){
+        written = (write(fd, header, size) == ((ssize_t) size));
+
+        if (close(fd))
+            written = false;
+        if (! (written && (! rename(tmp_path, path))))
+            unlink(tmp_path);
+    }
+}
+
+
+
+
+/******************************************************************************
+    * Build Phase
+******************************************************************************/
+
+
+/**
+ * @brief build an automaton that determines whether a string contains a match for the pattern.
+ *
+ * @param[in]  pattern  regex pattern string that has been successfully compiled by 'regcomp'
+ * @param[in]  cflags  the flags for 'regcomp'
+ * @param[out] p_size  variable to store the size of the automaton
+ * @return regcache_header*  the automaton or NULL
+ *
+ * @note returns NULL if the pattern uses unsupported syntax or if the automaton would be too large.
+ * @note unsupported are back-references, GNU extensions such as '\\w', and equivalence or collating classes.
+ */
+static regcache_header *build_regcache(const char *pattern, int cflags, size_t *p_size){
+    assert(pattern);
+    assert(p_size);
+
+    regcache_builder *builder;
+    regcache_header *header = NULL;
+    int root, start;
+
+    if ((builder = (regcache_builder *) malloc(sizeof(regcache_builder)))){
+        builder->src = pattern;
+        builder->cflags = cflags;
+        builder->depth = 0;
+        builder->nodes_num = 0;
+        builder->nfa_num = 0;
+
+        if (((root = parse_alternation(builder)) >= 0) && (! *(builder->src))){
+            if ((start = new_nfa(builder, 'm', -1, -1, -1)) >= 0)
+                if ((start = generate_nfa(builder, root, start)) >= 0)
+                    header = construct_dfa(builder, start, pattern, p_size);
+        }
+
+        free(builder);
+    }
+
+    return header;
+}
+
+
+
+
+/**
+ * @brief parse the alternation of the concatenations.
+ *
+ * @param[out] builder  variable to store the intermediate data to build an automaton
+ * @return int  index of the resulting node or -1 (unsupported)
+ */
+static int parse_alternation(regcache_builder *builder){
+    assert(builder);
+
+    int left, right;
+
+    if (((left = parse_concatenation(builder)) >= 0) && (*(builder->src) == '|')){
+        do {
+            builder->src++;
+
+            if ((right = parse_concatenation(builder)) < 0)
+                return -1;
+            if ((left = new_node(builder, '|', left, right)) < 0)
+                return -1;
+        } while (*(builder->src) == '|');
+    }
+
+    return left;
+}
+
+
+/**
+ * @brief parse the concatenation of the repetitions.
+ *
+ * @param[out] builder  variable to store the intermediate data to build an automaton
+ * @return int  index of the resulting node or -1 (unsupported)
+ */
+static int parse_concatenation(regcache_builder *builder){
+    assert(builder);
+
+    int left = -1, right;
+
+    while (*(builder->src) && (*(builder->src) != '|') && (*(builder->src) != ')')){
+        if ((right = parse_repetition(builder)) < 0)
+            return -1;
+
+        if (left >= 0){
+            if ((left = new_node(builder, '.', left, right)) < 0)
+                return -1;
+        }
+        else
+            left = right;
+    }
+
+    if (left < 0)
+        left = new_node(builder, 'e', -1, -1);
+
+    return left;
+}
+
+
+/**
+ * @brief parse an atom followed by any number of repetition operators.
+ *
+ * @param[out] builder  variable to store the intermediate data to build an automaton
+ * @return int  index of the resulting node or -1 (unsupported)
+ */
+static int parse_repetition(regcache_builder *builder){
+    assert(builder);
+
+    int node, type, min, max;
+    char *endptr;
+
+    if ((node = parse_atom(builder)) < 0)
+        return -1;
+
+    type = builder->nodes[node].type;
+
+    do {
+        switch (*(builder->src)){
+            case '*':
+                min = 0;
+                max = -1;
+                break;
+            case '+':
+                min = 1;
+                max = -1;
+                break;
+            case '?':
+                min = 0;
+                max = 1;
+                break;
+            case '{':
+                if (! isdigit((unsigned char) builder->src[1]))
+                    return -1;
+
+                min = strtol((builder->src + 1), &endptr, 10);
+                max = min;
+
+                if (*endptr == ','){
+                    max = -1;
+
+                    if (isdigit((unsigned char) *(++endptr)))
+                        max = strtol(endptr, &endptr, 10);
+                }
+                if ((*endptr != '}') || (min > REGCACHE_DUP_MAX) || (max > REGCACHE_DUP_MAX))
+                    return -1;
+                if ((max >= 0) && (min > max))
+                    return -1;
+
+                builder->src = endptr;
+                break;
+            default:
+                return node;
+        }
+
+        // the repetition of an anchor is interpreted differently by each implementation
+        if ((type == '^') || (type == '$'))
+            return -1;
+
+        builder->src++;
+
+        if ((node = new_node(builder, '*', node, -1)) < 0)
+            return -1;
+
+        builder->nodes[node].min = min;
+        builder->nodes[node].max = max;
+    } while (true);
+}
+
+
+/**
+ * @brief parse an atom of the pattern.
+ *
+ * @param[out] builder  variable to store the intermediate data to build an automaton
+ * @return int  index of the resulting node or -1 (unsupported)
+ */
+static int parse_atom(regcache_builder *builder){
+    assert(builder);
+
+    int node, c;
+    uint32_t *set;
+
+    switch ((c = (unsigned char) *(builder->src++))){
+        case '(':
+            if (++(builder->depth) > REGCACHE_DEPTH_MAX)
+                return -1;
+            if (((node = parse_alternation(builder)) < 0) || (*(builder->src++) != ')'))
+                return -1;
+            builder->depth--;
+            return node;
+        case '^':
+        case '$':
+            return new_node(builder, c, -1, -1);
+        case '*':
+        case '+':
+        case '?':
+        case '{':
+            return -1;
+    }
+
+    if ((node = new_node(builder, 'c', -1, -1)) < 0)
+        return -1;
+
+    set = builder->nodes[node].set;
+
+    switch (c){
+        case '.':
+            memset(set, 0xff, (sizeof(uint32_t) * 8));
+            break;
+        case '[':
+            if (! parse_bracket(builder, set))
+                return -1;
+            break;
+        case '\\':
+            c = (unsigned char) *(builder->src++);
+
+            // back-references and GNU extensions
+            if ((! c) || isalnum(c) || strchr("<>`'", c))
+                return -1;
+        default:
+            setbit_byte_set(set, c);
+    }
+
+    if (builder->cflags & REG_ICASE)
+        fold_byte_set(set);
+
+    // strings never contain the null character
+    set[0] &= ~1U;
+
+    return node;
+}
+
+
+/**
+ * @brief parse a bracket expression.
+ *
+ * @param[out] builder  variable to store the intermediate data to build an automaton
+ * @param[out] set  set of bytes to store the result
+ * @return bool  successful or not
+ *
+ * @note in the C locale, each range is interpreted in the order of byte values.
+ */
+static bool parse_bracket(regcache_builder *builder, uint32_t *set){
+    assert(builder);
+    assert(set);
+
+    const unsigned char *src;
+    const char *end;
+    int c, d, i;
+    bool negate = false;
+
+    src = (const unsigned char *) builder->src;
+
+    if (*src == '^'){
+        negate = true;
+        src++;
+    }
+
+    c = *src;
+
+    do {
+        if (! c)
+            return false;
+
+        if (c == '['){
+            switch (src[1]){
+                case ':':
+                    if (! (end = strstr((const char *) (src + 2), ":]")))
+                        return false;
+
+                    for (i = 0; regcache_char_classes[i].name; i++)
+                        if ((strlen(regcache_char_classes[i].name) == (end - ((const char *) src + 2))) &&
+                            (! strncmp(regcache_char_classes[i].name, ((const char *) src + 2), (end - ((const char *) src + 2)))))
+                            break;
+
+                    if (! regcache_char_classes[i].name)
+                        return false;
+
+                    for (d = 1; d < 256; d++)
+                        if (regcache_char_classes[i].func(d))
+                            setbit_byte_set(set, d);
+
+                    src = (const unsigned char *) end + 2;
+                    continue;
+                case '=':
+                case '.':
+                    return false;
+            }
+        }
+
+        d = c;
+        src++;
+
+        if ((*src == '-') && src[1] && (src[1] != ']')){
+            if ((src[1] == '[') || ((d = src[1]) < c))
+                return false;
+            src += 2;
+        }
+
+        for (; c <= d; c++)
+            setbit_byte_set(set, c);
+    } while ((c = *src) != ']');
+
+    // the case is ignored before the negation, so that '[^a]' matches neither 'a' nor 'A'
+    if (builder->cflags & REG_ICASE)
+        fold_byte_set(set);
+
+    if (negate)
+        for (i = 0; i < 8; i++)
+            set[i] = ~set[i];
+
+    builder->src = (const char *) (src + 1);
+    return true;
+}
+
+
+/**
+ * @brief add the other case of each letter to the set of bytes.
+ *
+ * @param[out] set  set of bytes
+ */
+static void fold_byte_set(uint32_t *set){
+    assert(set);
+
+    int c;
+
+    for (c = 0; c < 256; c++)
+        if (getbit_byte_set(set, c)){
+            if (islower(c))
+                setbit_byte_set(set, toupper(c));
+            else if (isupper(c))
+                setbit_byte_set(set, tolower(c));
+        }
+}
+
+
+/**
+ * @brief add a new node to the syntax tree.
+ *
+ * @param[out] builder  variable to store the intermediate data to build an automaton
+ * @param[in]  type  type of the node
+ * @param[in]  left  index of the left or only child
+ * @param[in]  right  index of the right child
+ * @return int  index of the new node or -1 (too many nodes)
+ */
+static int new_node(regcache_builder *builder, int type, int left, int right){
+    assert(builder);
+
+    regcache_node *node;
+
+    if (builder->nodes_num >= REGCACHE_NODES_MAX)
+        return -1;
+
+    node = builder->nodes + builder->nodes_num;
+
+    node->type = type;
+    node->left = left;
+    node->right = right;
+    node->min = 1;
+    node->max = 1;
+    memset(node->set, 0, (sizeof(uint32_t) * 8));
+
+    return builder->nodes_num++;
+}
+
+
+
+
+/**
+ * @brief generate the states of the NFA for the node, followed by the specified state.
+ *
+ * @param[out] builder  variable to store the intermediate data to build an automaton
+ * @param[in]  node  index of the node
+ * @param[in]  next  index of the state that follows the node
+ * @return int  index of the first state for the node or -1 (too many states)
+ *
+ * @note the bounded repetitions are expanded, like 'a{1,3}' into 'a(a(a)?)?'.
+ */
+static int generate_nfa(regcache_builder *builder, int node, int next){
+    assert(builder);
+    assert((node >= 0) && (node < builder->nodes_num));
+
+    const regcache_node *curr;
+    int state, loop, i, first;
+
+    if (next < 0)
+        return -1;
+
+    curr = builder->nodes + node;
+
+    switch (curr->type){
+        case 'c':
+            return new_nfa(builder, 'c', node, next, -1);
+        case '.':
+            return generate_nfa(builder, curr->left, generate_nfa(builder, curr->right, next));
+        case '|':
+            if ((first = generate_nfa(builder, curr->left, next)) < 0)
+                return -1;
+            return new_nfa(builder, 's', -1, first, generate_nfa(builder, curr->right, next));
+        case '*':
+            state = next;
+
+            if (curr->max < 0){
+                if ((loop = new_nfa(builder, 's', -1, -1, next)) < 0)
+                    return -1;
+                if ((builder->nfa[loop].out1 = generate_nfa(builder, curr->left, loop)) < 0)
+                    return -1;
+                state = loop;
+            }
+            else
+                for (i = curr->max - curr->min; i--;){
+                    if ((first = generate_nfa(builder, curr->left, state)) < 0)
+                        return -1;
+                    if ((state = new_nfa(builder, 's', -1, first, next)) < 0)
+                        return -1;
+                }
+
+            for (i = curr->min; i--;)
+                if ((state = generate_nfa(builder, curr->left, state)) < 0)
+                    return -1;
+
+            return state;
+        case '^':
+        case '$':
+            return new_nfa(builder, curr->type, -1, next, -1);
+        default:
+            assert(curr->type == 'e');
+            return next;
+    }
+}
+
+
+/**
+ * @brief add a new state to the NFA.
+ *
+ * @param[out] builder  variable to store the intermediate data to build an automaton
+ * @param[in]  type  type of the state
+ * @param[in]  node  index of the node that has the set of bytes, or -1
+ * @param[in]  out1  index of the next state, or -1
+ * @param[in]  out2  index of the other next state, or -1
+ * @return int  index of the new state or -1 (too many states)
+ */
+static int new_nfa(regcache_builder *builder, int type, int node, int out1, int out2){
+    assert(builder);
+
+    regcache_nfa *state;
+
+    if ((builder->nfa_num >= REGCACHE_NFA_MAX) || ((type == 's') && (out2 < 0)))
+        return -1;
+
+    state = builder->nfa + builder->nfa_num;
+
+    state->type = type;
+    state->node = node;
+    state->out1 = out1;
+    state->out2 = out2;
+
+    return builder->nfa_num++;
+}
+
+
+
+
+/**
+ * @brief construct the DFA from the NFA by the subset construction, and serialize it.
+ *
+ * @param[out] builder  variable to store the intermediate data to build an automaton
+ * @param[in]  start  index of the initial state of the NFA
+ * @param[in]  pattern  regex pattern string
+ * @param[out] p_size  variable to store the size of the automaton
+ * @return regcache_header*  the automaton or NULL
+ *
+ * @note the initial state of the NFA is added after each byte, so that a match is searched at any position.
+ * @note the bytes that belong to the same sets in all the nodes are merged into one equivalence class.
+ * @note the states that contain a match are not expanded, since the search ends there.
+ */
+static regcache_header *construct_dfa(regcache_builder *builder, int start, const char *pattern, size_t *p_size){
+    assert(builder);
+    assert((start >= 0) && (start < builder->nfa_num));
+    assert(pattern);
+    assert(p_size);
+
+    unsigned char classes[256], reprs[256], accepts[REGCACHE_STATES_MAX];
+    int maps[256][2], classes_num = 1, i, j, c, next;
+    uint16_t *trans;
+    uint32_t set[REGCACHE_WORDS];
+    size_t words, len;
+    const regcache_nfa *state;
+    regcache_header *header;
+    bool has_bytes;
+
+    memset(classes, 0, sizeof(classes));
+
+    for (i = 0; i < builder->nodes_num; i++)
+        if (builder->nodes[i].type == 'c'){
+            for (j = 0; j < classes_num; j++){
+                maps[j][0] = -1;
+                maps[j][1] = -1;
+            }
+            j = 0;
+
+            for (c = 0; c < 256; c++){
+                int *p_map = &(maps[classes[c]][(bool) getbit_byte_set(builder->nodes[i].set, c)]);
+
+                if (*p_map < 0)
+                    *p_map = j++;
+                classes[c] = *p_map;
+            }
+            classes_num = j;
+        }
+
+    for (c = 256; c--;)
+        reprs[classes[c]] = c;
+
+    if (! (trans = (uint16_t *) malloc(sizeof(uint16_t) * REGCACHE_STATES_MAX * classes_num)))
+        return NULL;
+
+    words = (builder->nfa_num + 31) >> 5;
+
+    for (i = 0; i < REGCACHE_BUCKETS; i++)
+        builder->buckets[i] = -1;
+
+    memset(set, 0, sizeof(set));
+    setbit_byte_set(set, start);
+    compute_closure(builder, set, true, false);
+
+    // the initial state is never shared, since only it can pass through '^'
+    memcpy(builder->sets[0], set, (sizeof(uint32_t) * words));
+    builder->states_num = 1;
+
+    for (i = 0; i < builder->states_num; i++){
+        accepts[i] = 0;
+        has_bytes = false;
+
+        for (j = 0; j < builder->nfa_num; j++)
+            if (getbit_byte_set(builder->sets[i], j)){
+                if (builder->nfa[j].type == 'm')
+                    accepts[i] |= REGCACHE_ACCEPT;
+                else if (builder->nfa[j].type == 'c')
+                    has_bytes = true;
+            }
+
+        memcpy(set, builder->sets[i], (sizeof(uint32_t) * words));
+        compute_closure(builder, set, (! i), true);
+
+        for (j = 0; j < builder->nfa_num; j++)
+            if (getbit_byte_set(set, j) && (builder->nfa[j].type == 'm'))
+                accepts[i] |= REGCACHE_ACCEPT_AT_END;
+
+        if (! (accepts[i] || has_bytes))
+            accepts[i] = REGCACHE_DEAD;
+
+        for (c = 0; c < classes_num; c++){
+            next = i;
+
+            if (! (accepts[i] & (REGCACHE_ACCEPT | REGCACHE_DEAD))){
+                memset(set, 0, sizeof(set));
+                setbit_byte_set(set, start);
+
+                for (j = 0; j < builder->nfa_num; j++)
+                    if (getbit_byte_set(builder->sets[i], j)){
+                        state = builder->nfa + j;
+
+                        if ((state->type == 'c') && getbit_byte_set(builder->nodes[state->node].set, reprs[c]))
+                            setbit_byte_set(set, state->out1);
+                    }
+
+                compute_closure(builder, set, false, false);
+
+                if ((next = lookup_dfa_state(builder, set)) < 0){
+                    free(trans);
+                    return NULL;
+                }
+            }
+
+            trans[i * classes_num + c] = next;
+        }
+    }
+
+    len = strlen(pattern);
+    *p_size = regcache_size(builder->states_num, classes_num, len);
+
+    if ((header = (regcache_header *) malloc(*p_size))){
+        header->magic = REGCACHE_MAGIC;
+        header->version = REGCACHE_VERSION;
+        header->cflags = builder->cflags;
+        header->pattern_len = len;
+        header->states_num = builder->states_num;
+        header->classes_num = classes_num;
+
+        memcpy((void *) regcache_trans(header), trans, (sizeof(uint16_t) * builder->states_num * classes_num));
+        memcpy((void *) regcache_classes(header), classes, sizeof(classes));
+        memcpy((void *) regcache_accepts(header), accepts, builder->states_num);
+        memcpy((void *) regcache_pattern(header), pattern, (sizeof(char) * (len + 1)));
+    }
+
+    free(trans);
+    return header;
+}
+
+
+/**
+ * @brief add the states reachable without consuming any byte to the set of states of the NFA.
+ *
+ * @param[out] builder  variable to store the intermediate data to build an automaton
+ * @param[out] set  the set of states of the NFA
+ * @param[in]  at_begin  whether at the beginning of the string, where '^' is satisfied
+ * @param[in]  at_end  whether at the end of the string, where '$' is satisfied
+ */
+static void compute_closure(regcache_builder *builder, uint32_t *set, bool at_begin, bool at_end){
+    assert(builder);
+    assert(set);
+
+    const regcache_nfa *state;
+    int i, top = 0, next;
+
+    for (i = 0; i < builder->nfa_num; i++)
+        if (getbit_byte_set(set, i))
+            builder->stack[top++] = i;
+
+    while (top){
+        state = builder->nfa + builder->stack[--top];
+
+        for (i = 0; i < 2; i++){
+            next = -1;
+
+            switch (state->type){
+                case 's':
+                    next = i ? state->out2 : state->out1;
+                    break;
+                case '^':
+                    if (at_begin && (! i))
+                        next = state->out1;
+                    break;
+                case '$':
+                    if (at_end && (! i))
+                        next = state->out1;
+            }
+
+            if ((next >= 0) && (! getbit_byte_set(set, next))){
+                setbit_byte_set(set, next);
+                builder->stack[top++] = next;
+            }
+        }
+    }
+}
+
+
+/**
+ * @brief find the state of the DFA for the set of states of the NFA, or add a new one.
+ *
+ * @param[out] builder  variable to store the intermediate data to build an automaton
+ * @param[in]  set  the set of states of the NFA
+ * @return int  index of the state of the DFA or -1 (too many states)
+ */
+static int lookup_dfa_state(regcache_builder *builder, const uint32_t *set){
+    assert(builder);
+    assert(set);
+
+    size_t words, i;
+    uint32_t hash = 2166136261U;
+    int state;
+
+    words = (builder->nfa_num + 31) >> 5;
+
+    for (i = 0; i < words; i++)
+        hash = (hash ^ set[i]) * 16777619U;
+    hash %= REGCACHE_BUCKETS;
+
+    for (state = builder->buckets[hash]; state >= 0; state = builder->chains[state])
+        if (! memcmp(builder->sets[state], set, (sizeof(uint32_t) * words)))
+            return state;
+
+    if (builder->states_num >= REGCACHE_STATES_MAX)
+        return -1;
+
+    state = builder->states_num++;
+
+    memcpy(builder->sets[state], set, (sizeof(uint32_t) * words));
+    builder->chains[state] = builder->buckets[hash];
+    builder->buckets[hash] = state;
+
+    return state;
+}
+
+
+
+
+#ifndef NDEBUG
+
+
+/******************************************************************************
+    * Unit Test Functions
+******************************************************************************/
+
+
+#define REGCACHE_TEST_DIR "/dit/tmp/regex.test"
+
+
+static void build_regcache_test(void);
+static void regcomp_cached_test(void);
+
+static void remove_regcache_test_dir(void);
+
+
+
+
+void regcache_test(void){
+    do_test(build_regcache_test);
+    do_test(regcomp_cached_test);
+}
+
+
+
+
+static void build_regcache_test(void){
+    // changeable part for updating test cases
+    const char * const patterns[] = {
+        "^[[:space:]]*(CMD|ENTRYPOINT)[[:space:]]",
+        "^[[:space:]]*[^#]",
+        "\"[[:print:]]+\"",
+        "^RUN[[:print:]]+([^&]*&{2}|[^|]*\\|{2})",
+        "\\.tar\\.gz$",
+        "^$",
+        "",
+        "a|b|",
+        "(a|aa)*b",
+        "(.*)*x",
+        "a{2,3}b",
+        "x{2,}",
+        "^(ab)?c{0,1}$",
+        "[]a-]+",
+        "[^]a-]",
+        "[a-cx-z0-2]+$",
+        "$|^",
+        "a^b",
+        "colou?r",
+        "[[:upper:][:digit:]]{2}",
+            NULL
+    };
+
+    const char * const strings[] = {
+        "",
+        "CMD [ \"optimize\" ]",
+        "  ENTRYPOINT [ \"dit\" ]",
+        "# comment",
+        "RUN make && make clean",
+        "RUN true || false",
+        "curl -L https://example.com/a.tar.gz",
+        "aab",
+        "aaaa",
+        "xx",
+        "abc",
+        "c",
+        "]-]",
+        "zz1",
+        "color and colour",
+        "A1b2",
+        "ab^",
+            NULL
+    };
+
+    const char * const unsupported[] = {
+        "\\<word\\>",
+        "(a)\\1",
+        "[[=a=]]",
+        "^*",
+        "a{300}",
+        "(a|b)*a(a|b){12}",
+            NULL
+    };
+
+    const int flags[2] = { (REG_EXTENDED | REG_NOSUB), (REG_EXTENDED | REG_NOSUB | REG_ICASE) };
+
+    int i, j, k, expected;
+    regex_t preg;
+    cached_regex creg = { .mapped = false };
+    size_t size;
+
+    for (i = 0; patterns[i]; i++)
+        for (k = 0; k < 2; k++){
+            assert(! regcomp(&preg, patterns[i], flags[k]));
+            assert((creg.dfa = build_regcache(patterns[i], flags[k], &size)));
+
+            creg.dfa_size = size;
+            assert(check_regcache(creg.dfa, size, patterns[i], flags[k]));
+
+            for (j = 0; strings[j]; j++){
+                expected = regexec(&preg, strings[j], 0, NULL, 0);
+                assert(regexec_cached(&creg, strings[j]) == expected);
+            }
+
+            regfree(&preg);
+            regfree_cached(&creg);
+
+            print_progress_test_loop('S', SUCCESS, (i * 2 + k));
+            fprintf(stderr, "%-3s  %s\n", (k ? "-i" : ""), patterns[i]);
+        }
+
+    for (j = 0; unsupported[j]; j++){
+        assert(! build_regcache(unsupported[j], flags[0], &size));
+
+        print_progress_test_loop('S', FAILURE, (i * 2 + j));
+        fprintf(stderr, "%-3s  %s\n", "", unsupported[j]);
+    }
+}
+
+
+
+
+static void regcomp_cached_test(void){
+    const char *pattern = "^[[:space:]]*(CMD|ENTRYPOINT)[[:space:]]";
+    const int cflags = REG_EXTENDED | REG_NOSUB;
+
+    cached_regex creg;
+    DIR *dir;
+    struct dirent *entry;
+    char path[PATH_MAX];
+    int fd, i;
+
+    regcache_dir = REGCACHE_TEST_DIR;
+    remove_regcache_test_dir();
+    assert(! mkdir(REGCACHE_TEST_DIR, 0755));
+
+    // compiled and written to the cache at the first time, and mapped from it at the second time
+    for (i = 0; i < 2; i++){
+        assert(! regcomp_cached(&creg, pattern, cflags));
+        assert(creg.dfa);
+        assert(creg.mapped == i);
+        assert(! regexec_cached(&creg, "ENTRYPOINT [ \"dit\" ]"));
+        assert(regexec_cached(&creg, "RUN make") == REG_NOMATCH);
+        regfree_cached(&creg);
+
+        fprintf(stderr, "  %s from the cache\n", (i ? "mapped" : "not mapped"));
+    }
+
+    // a broken cache file is ignored and replaced
+    assert((dir = opendir(REGCACHE_TEST_DIR)));
+
+    while ((entry = readdir(dir)))
+        if (check_if_valid_dirent(entry->d_name)){
+            snprintf(path, sizeof(path), "%s/%s", REGCACHE_TEST_DIR, entry->d_name);
+            assert((fd = open(path, O_WRONLY)) != -1);
+            assert(write(fd, "broken", 6) == 6);
+            assert(! close(fd));
+        }
+
+    assert(! closedir(dir));
+
+    assert(! regcomp_cached(&creg, pattern, cflags));
+    assert(creg.dfa && (! creg.mapped));
+    regfree_cached(&creg);
+    fputs("  not mapped from the broken cache\n", stderr);
+
+    // the same pattern with different flags is not taken from the cache
+    assert(! regcomp_cached(&creg, pattern, (cflags | REG_ICASE)));
+    assert(creg.dfa && (! creg.mapped));
+    assert(! regexec_cached(&creg, "cmd [ \"dit\" ]"));
+    regfree_cached(&creg);
+
+    // unsupported flags and invalid patterns fall back to 'regcomp'
+    assert(! regcomp_cached(&creg, pattern, (REG_EXTENDED | REG_NEWLINE)));
+    assert(! creg.dfa);
+    regfree_cached(&creg);
+
+    assert(regcomp_cached(&creg, "*.txt", cflags));
+    assert(! creg.dfa);
+
+    remove_regcache_test_dir();
+    regcache_dir = REGCACHE_DIR;
+}
+
+
+static void remove_regcache_test_dir(void){
+    DIR *dir;
+    struct dirent *entry;
+    char path[PATH_MAX];
+
+    if ((dir = opendir(REGCACHE_TEST_DIR))){
+        while ((entry = readdir(dir)))
+            if (check_if_valid_dirent(entry->d_name)){
+                snprintf(path, sizeof(path), "%s/%s", REGCACHE_TEST_DIR, entry->d_name);
+                assert(! unlink(path));
+            }
+
+        assert(! closedir(dir));
+        assert(! rmdir(REGCACHE_TEST_DIR));
+    }
+}
+
+
+#endif // NDEBUG
@@ -0,0 +1,63 @@
+#ifndef DIT_REGEX_CACHE
+#define DIT_REGEX_CACHE
+
+
+/******************************************************************************
+    * commonly used Macros
+******************************************************************************/
+
+#define REGCACHE_DIR "/dit/var/regex"
+
+#define REGCACHE_MAGIC 0x52544944
+#define REGCACHE_VERSION 1
+
+#define REGCACHE_SLOTS 64
+#define REGCACHE_STATES_MAX 256
+
+
+#define REGCACHE_ACCEPT         0b001
+#define REGCACHE_ACCEPT_AT_END  0b010
+#define REGCACHE_DEAD           0b100
+
+
+
+
+/******************************************************************************
+    * commonly used Data Types
+******************************************************************************/
+
+/**
+ * Data type for the header of the automaton, followed by the table of transitions, the equivalence classes
+ * of bytes, the flags of each state and the pattern string, in that order
+ */
+typedef struct {
+    uint32_t magic;          /** 'REGCACHE_MAGIC' */
+    uint32_t version;        /** 'REGCACHE_VERSION' of the engine that built the automaton */
+    int32_t cflags;          /** the flags passed to 'regcomp_cached' */
+    uint32_t pattern_len;    /** the length of the pattern string */
+    uint32_t states_num;     /** the number of states, where the initial state is always 0 */
+    uint32_t classes_num;    /** the number of equivalence classes of bytes */
+} regcache_header;
+
+
+/** Data type for storing a regex pattern compiled into either an automaton or 'regex_t' */
+typedef struct {
+    const regcache_header *dfa;    /** the automaton, or NULL if falling back to 'preg' */
+    size_t dfa_size;               /** the size of the automaton */
+    bool mapped;                   /** whether the automaton is mapped from the cache file */
+    regex_t preg;                  /** the pattern compiled by 'regcomp' when no automaton is available */
+} cached_regex;
+
+
+
+
+/******************************************************************************
+    * Interface for the Regex Cache
+******************************************************************************/
+
+int regcomp_cached(cached_regex *creg, const char *pattern, int cflags);
+int regexec_cached(const cached_regex *creg, const char *string);
+void regfree_cached(cached_regex *creg);
+
+
+#endif // DIT_REGEX_CACHE
@@ -15,6 +15,30 @@
 
 
 static bool parse_opts(int argc, char **argv);
+static void bench(void);
+static int qcmp_double(const void *a, const void *b);
+
+static void fuzz(void);
+static double measure_fuzz_input(void (* func)(const char *, size_t), const char *input, size_t len, unsigned long long iters);
+static size_t mutate_fuzz_input(char *input, size_t len, workload_rng *rng, const char * const *seeds, size_t size);
+static double estimate_fuzz_growth(void (* func)(const char *, size_t), const char *input, const char *sep, double base);
+static void print_fuzz_input(FILE *fp, const char *input);
+static int mute_stderr(void);
+static void unmute_stderr(int fd);
+
+
+/** variable to which the results of the benchmarked functions are stored so as not to be optimized away */
+volatile size_t bench_sink = 0;
+
+/** the number of results of the benchmarks emitted so far */
+static unsigned int bench_count = 0;
+
+
+/** the number of results of the fuzzing emitted so far */
+static unsigned int fuzz_count = 0;
+
+/** the number of the fuzzed functions whose cost was regarded as superlinear */
+static unsigned int fuzz_flagged = 0;
 
 
 
@@ -32,6 +56,8 @@ static bool parse_opts(int argc, char **argv);
  * @param[in]  cmd_id  index number corresponding to one of the dit commands or negative integer
  *
  * @note if unit tests were performed in this function, it will not return to the caller.
+ * @note 'dit bench' runs all the benchmarks instead, in the same way as 'dit test'.
+ * @note 'dit fuzz' searches the inputs that make each fuzzed function the slowest instead.
  */
 void test(int argc, char **argv, int cmd_id){
     assert(argc > 0);
@@ -51,20 +77,27 @@ void test(int argc, char **argv, int cmd_id){
             healthcheck_test,
             help_test,
             ignore_test,
+            init_test,
             inspect_test,
             label_test,
             onbuild_test,
             optimize_test,
             package_test,
-            reflect_test
+            reflect_test,
+            session_test,
+            stats_test
         };
 
         test_flag = parse_opts(argc, argv);
         test_func = test_funcs[cmd_id];
     }
     else if (argc == 1){
-        test_flag = (! strcmp(*argv, "test"));
-        test_func = dit_test;
+        if ((test_flag = (! strcmp(*argv, "test"))))
+            test_func = dit_test;
+        else if ((test_flag = (! strcmp(*argv, "bench"))))
+            test_func = bench;
+        else if ((test_flag = (! strcmp(*argv, "fuzz"))))
+            test_func = fuzz;
     }
 
     if (test_flag){
@@ -107,6 +140,495 @@ static bool parse_opts(int argc, char **argv){
 
 
 
+/******************************************************************************
+    * Benchmark Part
+******************************************************************************/
+
+
+/**
+ * @brief run all the benchmarks, and emit their results to stdout as a JSON array.
+ *
+ * @note the progress and the human-readable results are printed to stderr.
+ * @note the inputs are generated from the fixed seed, so that the results can be compared between commits.
+ */
+static void bench(void){
+    void (* const bench_funcs[])(void) = {
+        dit_bench,
+        erase_bench,
+        ignore_bench
+    };
+
+    srand(BENCH_SEED);
+    fputs("[", stdout);
+
+    for (size_t i = 0; i < numof(bench_funcs); i++)
+        bench_funcs[i]();
+
+    fputs("\n]\n", stdout);
+}
+
+
+/**
+ * @brief measure the time taken by one operation of the specified function.
+ *
+ * @param[in]  name  name of the function
+ * @param[in]  file  name of the source file where the benchmark is defined
+ * @param[in]  func  the function that performs one operation
+ * @param[in]  input  the input prepared by a generator
+ *
+ * @note after the warmup, the number of iterations in one run is doubled until it takes long enough.
+ * @note the median of the runs is regarded as the result, which is less affected by noise than the mean.
+ */
+void run_bench(const char *name, const char *file, void (* func)(const bench_input *), const bench_input *input){
+    assert(name);
+    assert(file);
+    assert(func);
+    assert(input);
+
+    double results[BENCH_RUNS], median, min;
+    unsigned long long iters = 1, elapsed, i;
+    struct timespec start, end;
+    int run, count;
+
+    for (count = BENCH_WARMUP_RUNS; count--;)
+        func(input);
+
+    run = -1;
+
+    do {
+        clock_gettime(CLOCK_MONOTONIC, &start);
+
+        for (i = iters; i--;)
+            func(input);
+
+        clock_gettime(CLOCK_MONOTONIC, &end);
+
+        elapsed = (end.tv_sec - start.tv_sec) * 1000000000ULL + end.tv_nsec - start.tv_nsec;
+
+        if (run < 0){
+            if ((elapsed < BENCH_RUN_NSEC) && (iters < (1ULL << 40))){
+                iters <<= 1;
+                continue;
+            }
+            run = 0;
+        }
+        else
+            results[run++] = ((double) elapsed) / iters;
+
+    } while (run < BENCH_RUNS);
+
+    qsort(results, BENCH_RUNS, sizeof(double), qcmp_double);
+    median = results[BENCH_RUNS / 2];
+    min = results[0];
+
+    fprintf(stderr, "  %14.1f ns/op", median);
+
+    if (input->items > 1)
+        fprintf(stderr, "  %10.1f ns/item", (median / input->items));
+    if (input->bytes)
+        fprintf(stderr, "  %10.2f MB/s", (input->bytes * 1000.0 / median));
+
+    fputs("\n\n", stderr);
+
+    printf(
+        "%s\n  {\"name\": \"%s\", \"file\": \"%s\", \"runs\": %d, \"iterations\": %llu, "
+        "\"ns_per_op\": %.1f, \"min_ns_per_op\": %.1f, \"items_per_op\": %zu, \"bytes_per_op\": %zu, "
+        "\"bytes_per_sec\": %.0f}",
+        (bench_count++ ? "," : ""), name, file, BENCH_RUNS, iters,
+        median, min, input->items, input->bytes, (input->bytes * 1e9 / median)
+    );
+}
+
+
+/**
+ * @brief comparison function between the results of runs.
+ *
+ * @param[in]  a  pointer to the first result
+ * @param[in]  b  pointer to the second result
+ * @return int  comparison result
+ */
+static int qcmp_double(const void *a, const void *b){
+    double x, y;
+
+    x = *((const double *) a);
+    y = *((const double *) b);
+
+    return (x > y) - (x < y);
+}
+
+
+
+
+/******************************************************************************
+    * Fuzzing Part
+******************************************************************************/
+
+
+/**
+ * @brief run all the fuzzing, and emit their results to stdout as a JSON array.
+ *
+ * @note if the cost of any function was regarded as superlinear, exits with the failure status.
+ */
+static void fuzz(void){
+    void (* const fuzz_funcs[])(void) = {
+        dit_fuzz,
+        erase_fuzz,
+        ignore_fuzz
+    };
+
+    fputs("[", stdout);
+
+    for (size_t i = 0; i < numof(fuzz_funcs); i++)
+        fuzz_funcs[i]();
+
+    fputs("\n]\n", stdout);
+
+    if (fuzz_flagged){
+        fprintf(stderr, "Found %u functions whose cost grows superlinearly.\n", fuzz_flagged);
+        fflush(stdout);
+        exit(FAILURE);
+    }
+}
+
+
+/**
+ * @brief search the input that maximizes the time per byte taken by the specified function.
+ *
+ * @param[in]  name  name of the function
+ * @param[in]  file  name of the source file where the fuzzing is defined
+ * @param[in]  func  the function that processes one input of the specified length
+ * @param[in]  seeds  array of the initial inputs, whose tokens are also used by the mutation
+ * @param[in]  size  array size
+ * @param[in]  sep  separator inserted between the repetitions of the worst input, such as "," or ""
+ *
+ * @note the time per byte is measured after subtracting the time taken for the empty input.
+ * @note the time is divided by at least 'FUZZ_MIN_SIZE' bytes, so as not to favor the shortest inputs.
+ * @note the mutation stops after 'FUZZ_ROUNDS' rounds or 'FUZZ_TOTAL_NSEC' nanoseconds, whichever comes first.
+ * @note the worst input found is repeated several times, to check how its cost grows with its length.
+ * @note the diagnostics printed by the fuzzed function are discarded while measuring.
+ */
+void run_fuzz(
+    const char *name,
+    const char *file,
+    void (* func)(const char *, size_t),
+    const char * const *seeds,
+    size_t size,
+    const char *sep
+){
+    assert(name);
+    assert(file);
+    assert(func);
+    assert(seeds);
+    assert(size);
+    assert(sep);
+
+    char worst[FUZZ_MAX_SIZE + 1], work[FUZZ_MAX_SIZE + 1];
+    size_t worst_len, work_len, i;
+    unsigned long long iters;
+    double base, worst_cost, cost, growth;
+    struct timespec start, now;
+    workload_rng rng;
+    int fd;
+
+    workload_seed(&rng, FUZZ_SEED);
+    fd = mute_stderr();
+
+    // the number of calls in one run is calibrated with the first seed, so that the noise is small enough
+    work_len = strlen(*seeds);
+
+    for (iters = 1; iters < (1ULL << 16); iters <<= 1)
+        if ((measure_fuzz_input(func, *seeds, work_len, iters) * iters) >= FUZZ_MEASURE_NSEC)
+            break;
+
+    base = measure_fuzz_input(func, "", 0, iters);
+    worst_cost = -1;
+    worst_len = 0;
+    *worst = '\0';
+
+    for (i = 0; i < size; i++){
+        assert((work_len = strlen(seeds[i])) <= FUZZ_MAX_SIZE);
+
+        cost = (measure_fuzz_input(func, seeds[i], work_len, iters) - base) / ((work_len > FUZZ_MIN_SIZE) ? work_len : FUZZ_MIN_SIZE);
+
+        if (cost > worst_cost){
+            worst_cost = cost;
+            worst_len = work_len;
+            memcpy(worst, seeds[i], (sizeof(char) * (work_len + 1)));
+        }
+    }
+
+    clock_gettime(CLOCK_MONOTONIC, &start);
+
+    for (i = 0; i < FUZZ_ROUNDS; i++){
+        clock_gettime(CLOCK_MONOTONIC, &now);
+
+        if (((now.tv_sec - start.tv_sec) * 1e9 + (now.tv_nsec - start.tv_nsec)) >= FUZZ_TOTAL_NSEC)
+            break;
+
+        memcpy(work, worst, (sizeof(char) * (worst_len + 1)));
+        work_len = mutate_fuzz_input(work, worst_len, &rng, seeds, size);
+
+        cost = (measure_fuzz_input(func, work, work_len, iters) - base) / ((work_len > FUZZ_MIN_SIZE) ? work_len : FUZZ_MIN_SIZE);
+
+        if (cost > worst_cost){
+            worst_cost = cost;
+            worst_len = work_len;
+            memcpy(worst, work, (sizeof(char) * (work_len + 1)));
+        }
+    }
+
+    growth = estimate_fuzz_growth(func, worst, sep, base);
+    unmute_stderr(fd);
+
+    fputs("  worst input: '", stderr);
+    print_fuzz_input(stderr, worst);
+    fprintf(stderr, "' (%zu bytes)\n", worst_len);
+    fprintf(stderr, "  %14.2f ns/byte  %10.2f growth", worst_cost, growth);
+
+    if (growth > FUZZ_GROWTH_LIMIT){
+        fuzz_flagged++;
+        fputs("  (superlinear)", stderr);
+    }
+    fputs("\n\n", stderr);
+
+    printf("%s\n  {\"name\": \"%s\", \"file\": \"%s\", \"rounds\": %zu, \"input\": \"", (fuzz_count++ ? "," : ""), name, file, i);
+    print_fuzz_input(stdout, worst);
+    printf(
+        "\", \"bytes\": %zu, \"ns_per_byte\": %.2f, \"growth\": %.2f, \"superlinear\": %s}",
+        worst_len, worst_cost, growth, ((growth > FUZZ_GROWTH_LIMIT) ? "true" : "false")
+    );
+}
+
+
+/**
+ * @brief measure the time taken by one call of the fuzzed function.
+ *
+ * @param[in]  func  the fuzzed function
+ * @param[in]  input  null-terminated input
+ * @param[in]  len  the length of the input
+ * @param[in]  iters  the number of calls in one run
+ * @return double  the minimum time in nanoseconds among the runs
+ */
+static double measure_fuzz_input(void (* func)(const char *, size_t), const char *input, size_t len, unsigned long long iters){
+    assert(func);
+    assert(input);
+    assert(iters);
+
+    struct timespec start, end;
+    double elapsed, result = -1;
+    unsigned long long i;
+    int run;
+
+    for (run = 3; run--;){
+        clock_gettime(CLOCK_MONOTONIC, &start);
+
+        for (i = iters; i--;)
+            func(input, len);
+
+        clock_gettime(CLOCK_MONOTONIC, &end);
+
+        elapsed = ((end.tv_sec - start.tv_sec) * 1e9 + (end.tv_nsec - start.tv_nsec)) / iters;
+
+        if ((result < 0) || (elapsed < result))
+            result = elapsed;
+    }
+
+    return result;
+}
+
+
+/**
+ * @brief apply one random mutation to the input.
+ *
+ * @param[out] input  buffer of at least 'FUZZ_MAX_SIZE + 1' bytes that contains the input
+ * @param[in]  len  the length of the input
+ * @param[out] rng  the state of the pseudo-random number generator
+ * @param[in]  seeds  array of the initial inputs
+ * @param[in]  size  array size
+ * @return size_t  the length of the mutated input
+ *
+ * @note the repetition of a part of the input is the most effective way to find superlinear behavior.
+ */
+static size_t mutate_fuzz_input(char *input, size_t len, workload_rng *rng, const char * const *seeds, size_t size){
+    assert(input);
+    assert(len <= FUZZ_MAX_SIZE);
+    assert(seeds);
+
+    const char *src;
+    size_t pos, span, src_len;
+    int c;
+
+    pos = workload_range(rng, (len + 1));
+    src = seeds[workload_range(rng, size)];
+
+    // pick a character from the seeds more often than a random printable one
+    src_len = strlen(src);
+    c = (src_len && workload_range(rng, 4)) ? src[workload_range(rng, src_len)] : (' ' + workload_range(rng, 95));
+
+    switch (len ? workload_range(rng, 5) : 1){
+        case 0:
+            if (pos == len)
+                pos--;
+            input[pos] = c;
+            break;
+        case 1:
+            if (len < FUZZ_MAX_SIZE){
+                memmove((input + pos + 1), (input + pos), (sizeof(char) * (len - pos)));
+                input[pos] = c;
+                len++;
+            }
+            break;
+        case 2:
+            if (pos == len)
+                pos--;
+            memmove((input + pos), (input + pos + 1), (sizeof(char) * (len - pos - 1)));
+            len--;
+            break;
+        case 3:
+            if (pos == len)
+                pos = 0;
+            src = input + pos;
+            src_len = len - pos;
+        default:
+            if (src_len){
+                span = workload_range(rng, ((src_len < 8) ? src_len : 8)) + 1;
+                src += workload_range(rng, (src_len - span + 1));
+
+                if ((len + span) <= FUZZ_MAX_SIZE){
+                    memmove((input + pos + span), (input + pos), (sizeof(char) * (len - pos)));
+                    memmove((input + pos), ((src < (input + pos)) ? src : (src + span)), (sizeof(char) * span));
+                    len += span;
+                }
+            }
+    }
+
+    input[len] = '\0';
+    return len;
+}
+
+
+/**
+ * @brief estimate the exponent of the growth of the cost when the input is repeated.
+ *
+ * @param[in]  func  the fuzzed function
+ * @param[in]  input  null-terminated input
+ * @param[in]  sep  separator inserted between the repetitions
+ * @param[in]  base  the time taken for the empty input
+ * @return double  the slope of the cost against the length on a log-log scale
+ *
+ * @note the number of calls is calibrated once with the shortest input, so that each run takes long enough.
+ */
+static double estimate_fuzz_growth(void (* func)(const char *, size_t), const char *input, const char *sep, double base){
+    assert(func);
+    assert(input);
+    assert(sep);
+
+    char *scaled;
+    size_t len, sep_len, scaled_len = 0, count = 0, i;
+    unsigned long long iters = 1;
+    double x, y, sum_x = 0, sum_y = 0, sum_xx = 0, sum_xy = 0;
+    int j;
+
+    if (! (len = strlen(input)))
+        return 0;
+
+    sep_len = strlen(sep);
+    assert((scaled = (char *) malloc(sizeof(char) * (((len + sep_len) << (FUZZ_SCALES - 1)) + 1))));
+
+    while (((measure_fuzz_input(func, input, len, iters) * iters) < FUZZ_RUN_NSEC) && (iters < (1ULL << 20)))
+        iters <<= 1;
+
+    for (j = 0; j < FUZZ_SCALES; j++){
+        for (; count < (1U << j); count++){
+            if (count){
+                memcpy((scaled + scaled_len), sep, (sizeof(char) * sep_len));
+                scaled_len += sep_len;
+            }
+            memcpy((scaled + scaled_len), input, (sizeof(char) * len));
+            scaled_len += len;
+        }
+        scaled[scaled_len] = '\0';
+
+        i = (iters >> j) ? (iters >> j) : 1;
+
+        x = log2(scaled_len);
+        y = measure_fuzz_input(func, scaled, scaled_len, i) - base;
+        y = log2((y > 1) ? y : 1);
+
+        sum_x += x;
+        sum_y += y;
+        sum_xx += x * x;
+        sum_xy += x * y;
+    }
+
+    free(scaled);
+    return (FUZZ_SCALES * sum_xy - sum_x * sum_y) / (FUZZ_SCALES * sum_xx - sum_x * sum_x);
+}
+
+
+/**
+ * @brief print the input as the contents of a JSON string.
+ *
+ * @param[out] fp  handler for the output file
+ * @param[in]  input  null-terminated input
+ */
+static void print_fuzz_input(FILE *fp, const char *input){
+    assert(fp);
+    assert(input);
+
+    int c;
+
+    while ((c = (unsigned char) *(input++))){
+        if ((c == '"') || (c == '\\'))
+            fprintf(fp, "\\%c", c);
+        else if ((c < ' ') || (c > '~'))
+            fprintf(fp, "\\u%04x", c);
+        else
+            putc(c, fp);
+    }
+}
+
+
+/**
+ * @brief discard the subsequent outputs to stderr.
+ *
+ * @return int  the duplicated descriptor of the original stderr, or -1
+ */
+static int mute_stderr(void){
+    int fd, null_fd;
+
+    fflush(stderr);
+
+    if ((fd = dup(STDERR_FILENO)) != -1){
+        if ((null_fd = open("/dev/null", O_WRONLY)) != -1){
+            dup2(null_fd, STDERR_FILENO);
+            close(null_fd);
+        }
+        else {
+            close(fd);
+            fd = -1;
+        }
+    }
+    return fd;
+}
+
+
+/**
+ * @brief restore the stderr that was discarded by 'mute_stderr'.
+ *
+ * @param[in]  fd  the return value of 'mute_stderr'
+ */
+static void unmute_stderr(int fd){
+    if (fd != -1){
+        fflush(stderr);
+        dup2(fd, STDERR_FILENO);
+        close(fd);
+    }
+}
+
+
+
+
 /******************************************************************************
     * Utilities
 ******************************************************************************/
@@ -15,6 +15,23 @@
 #define TMP_FILE2 "/dit/tmp/test2.tmp"
 
 
+#define BENCH_SEED 20231012
+#define BENCH_WARMUP_RUNS 3
+#define BENCH_RUNS 7
+#define BENCH_RUN_NSEC 20000000
+
+
+#define FUZZ_SEED 20231015
+#define FUZZ_ROUNDS 1000
+#define FUZZ_MIN_SIZE 32
+#define FUZZ_MAX_SIZE 128
+#define FUZZ_TOTAL_NSEC 2000000000
+#define FUZZ_MEASURE_NSEC 20000
+#define FUZZ_SCALES 6
+#define FUZZ_RUN_NSEC 2000000
+#define FUZZ_GROWTH_LIMIT 1.5
+
+
 #define xputs(str) \
     do { \
         fputs(str, stderr); \
@@ -32,6 +49,24 @@
 #define no_test()  fputs("No unit tests.\n\n", stderr)
 
 
+#define do_bench(func, gen) \
+    do { \
+        bench_input input = {0}; \
+        fprintf(stderr, "Benchmarking %s:%u: '"#func"' ...\n", __FILE__, __LINE__); \
+        gen(&input); \
+        run_bench(#func, __FILE__, func, &input); \
+        free(input.data); \
+        free(input.extra); \
+    } while (false)
+
+
+#define do_fuzz(func, seeds, sep) \
+    do { \
+        fprintf(stderr, "Fuzzing %s:%u: '"#func"' ...\n", __FILE__, __LINE__); \
+        run_fuzz(#func, __FILE__, func, seeds, (sizeof(seeds) / sizeof(*seeds)), sep); \
+    } while (false)
+
+
 
 
 /******************************************************************************
@@ -58,6 +93,15 @@ typedef const struct {
 } comptest_table;
 
 
+/** Data type for passing the input prepared by a generator to the function to be benchmarked */
+typedef struct {
+    void *data;       /** dynamic memory for the input or NULL */
+    void *extra;      /** dynamic memory used by the function, such as output buffer, or NULL */
+    size_t items;     /** the number of items processed in one operation */
+    size_t bytes;     /** the number of bytes processed in one operation */
+} bench_input;
+
+
 
 
 /******************************************************************************
@@ -66,12 +110,26 @@ typedef const struct {
 
 void test(int argc, char **argv, int cmd_id);
 
+void run_bench(const char *name, const char *file, void (* func)(const bench_input *), const bench_input *input);
+void run_fuzz(
+    const char *name,
+    const char *file,
+    void (* func)(const char *, size_t),
+    const char * const *seeds,
+    size_t size,
+    const char *sep
+);
+
 
 /******************************************************************************
     * Unit Test Functions
 ******************************************************************************/
 
 void dit_test(void);
+void trace_test(void);
+void workload_test(void);
+void regcache_test(void);
+void libdit_test(void);
 void cmd_test(void);
 void config_test(void);
 void convert_test(void);
@@ -80,12 +138,35 @@ void erase_test(void);
 void healthcheck_test(void);
 void help_test(void);
 void ignore_test(void);
+void init_test(void);
 void inspect_test(void);
 void label_test(void);
 void onbuild_test(void);
 void optimize_test(void);
 void package_test(void);
 void reflect_test(void);
+void session_test(void);
+void stats_test(void);
+
+
+/******************************************************************************
+    * Benchmark Functions
+******************************************************************************/
+
+extern volatile size_t bench_sink;
+
+void dit_bench(void);
+void erase_bench(void);
+void ignore_bench(void);
+
+
+/******************************************************************************
+    * Fuzzing Functions
+******************************************************************************/
+
+void dit_fuzz(void);
+void erase_fuzz(void);
+void ignore_fuzz(void);
 
 
 /******************************************************************************
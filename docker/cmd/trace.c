@@ -0,0 +1,890 @@
+/**
+ * @file trace.c
+ *
+ * Copyright (c) 2023 Tsukasa Inada
+ *
+ * @brief Described the instrumentation layer that records the timings of the major phases of each dit command.
+ * @author Tsukasa Inada
+ * @date 2023/10/09
+ *
+ * @note The events are emitted in the JSON array format of Chrome trace-event, only if 'DIT_TRACE' is set.
+ * @note The closing bracket of the array is omitted, so that several processes can append to the same file.
+ * @note Regardless of 'DIT_TRACE', the elapsed time of each phase is appended to the ring buffer for 'stats'.
+ * @note Under 'DIT_TRACE', the dynamic memory allocations are also counted and reported at exit.
+ */
+
+#include "main.h"
+
+#define TRACE_IO_FILE "/proc/self/io"
+
+#define TRACE_BUFFER_SIZE 16384
+#define TRACE_EVENT_MAX 1024
+#define TRACE_DETAIL_MAX 256
+
+
+/** whether the events or the samples are being recorded */
+bool trace_enabled = false;
+
+/** array of the names of the phases, used as the names of the events */
+const char * const trace_phases[TRACE_PHASES_NUM] = {
+    "main",
+    "xfgets_for_loop",
+    "execute",
+    "construct_erase_data",
+    "marklines_containing_pattern",
+    "delete_marked_lines",
+    "manage_erase_logs",
+    "load_ignore_file",
+    "check_if_ignored",
+    "reflect_lines",
+    "record_reflected_lines",
+    "construct_dir_tree",
+    "destruct_dir_tree",
+    "write_checkpoint",
+    "extract_checkpoint",
+    "estimate_dir_tree",
+    "build_line_map",
+    "compare_dir_trees"
+};
+
+
+extern const char * const cmd_reprs[CMDS_NUM];
+
+
+static int open_trace_file(const char *cmd_name);
+static size_t read_trace_counters(trace_counters *counters);
+static size_t print_json_string(char *dest, const char *src, size_t limit);
+
+static void append_trace_event(const char *event, size_t size);
+static void flush_trace_events(void);
+static void append_stats_sample(int phase_id, long long dur_ns, unsigned long long bytes);
+static void emit_memory_event(void);
+
+static void count_alloc(size_t size, size_t usable_size);
+static void uncount_alloc(size_t usable_size);
+
+static void *trace_alc_malloc(void *ctx, size_t size);
+static void *trace_alc_realloc(void *ctx, void *ptr, size_t size);
+static void trace_alc_free(void *ctx, void *ptr);
+
+
+/** file descriptor for the file specified by 'DIT_TRACE' */
+static int trace_fd = -1;
+
+/** file descriptor for the file that provides the I/O counters */
+static int io_fd = -1;
+
+/** process ID to be embedded in each event */
+static pid_t trace_pid = 0;
+
+/** ID of the dit command to be embedded in each sample */
+static int trace_cmd_id = 0;
+
+/** buffer for storing the events that have not been written yet */
+static char trace_buf[TRACE_BUFFER_SIZE];
+
+/** the length of the events stored in above buffer */
+static size_t trace_len = 0;
+
+/** the file to which the samples are appended, which is replaced only by the unit tests */
+static const char *stats_file = STATS_RING_FILE;
+
+/** the ring buffer mapped into the memory or NULL */
+static stats_ring *mapped_ring = NULL;
+
+
+/** whether the dynamic memory allocations are being counted */
+static bool count_allocs = false;
+
+/** the statistics of the dynamic memory allocations since the counting started, with the fields of 'trace_allocs' */
+static struct {
+    atomic_ullong count;
+    atomic_ullong bytes;
+    atomic_size_t live;
+    atomic_size_t peak;
+    atomic_size_t largest;
+} allocs;
+
+
+/** allocator passed to the yyjson functions, so that the memory for JSON documents is also counted */
+const yyjson_alc trace_alc = {
+    trace_alc_malloc,
+    trace_alc_realloc,
+    trace_alc_free,
+    NULL
+};
+
+
+
+
+/******************************************************************************
+    * Interface for the Instrumentation
+******************************************************************************/
+
+
+/**
+ * @brief start recording the events and the samples for the specified dit command.
+ *
+ * @param[in]  cmd_id  ID of the dit command invoked
+ *
+ * @note the events are recorded only if the environment variable 'DIT_TRACE' is set.
+ * @note the samples are recorded only if the ring buffer for 'stats' has been prepared.
+ * @note the remaining events are written when the process exits normally.
+ */
+void trace_init(int cmd_id){
+    assert((cmd_id >= 0) && (cmd_id < CMDS_NUM));
+
+    static bool registered = false;
+
+    if (trace_enabled)
+        return;
+
+    trace_pid = getpid();
+    trace_cmd_id = cmd_id;
+
+    trace_fd = open_trace_file(cmd_reprs[cmd_id]);
+    mapped_ring = map_stats_ring(stats_file, true);
+    count_allocs = (trace_fd != -1);
+
+    if ((trace_fd != -1) || mapped_ring){
+        io_fd = open(TRACE_IO_FILE, (O_RDONLY | O_CLOEXEC));
+        trace_enabled = true;
+
+        if (! registered)
+            registered = (! atexit(trace_finish));
+    }
+}
+
+
+/**
+ * @brief write the remaining events and stop recording.
+ *
+ * @note also registered by 'atexit' function in 'trace_init'.
+ */
+void trace_finish(void){
+    if (trace_enabled){
+        if (trace_fd != -1){
+            emit_memory_event();
+            flush_trace_events();
+
+            if (trace_fd != -1)
+                close(trace_fd);
+        }
+        if (io_fd != -1)
+            close(io_fd);
+        if (mapped_ring)
+            munmap(mapped_ring, sizeof(stats_ring));
+
+        trace_fd = -1;
+        io_fd = -1;
+        mapped_ring = NULL;
+        count_allocs = false;
+        trace_enabled = false;
+    }
+}
+
+
+
+
+/**
+ * @brief record the state at the beginning of the specified phase.
+ *
+ * @param[out] scope  variable to store the state
+ * @param[in]  phase_id  ID of the phase
+ * @param[in]  detail  additional information such as the target file or NULL
+ *
+ * @note preserves 'errno', so that it can be placed anywhere in the instrumented functions.
+ *
+ * @attention 'detail' must be valid until 'trace_scope_end' is called with the same scope.
+ */
+void trace_scope_begin(trace_scope *scope, int phase_id, const char *detail){
+    assert(scope);
+    assert((phase_id >= 0) && (phase_id < TRACE_PHASES_NUM));
+
+    int errnum;
+    size_t size;
+
+    errnum = errno;
+
+    scope->phase_id = phase_id;
+    scope->detail = detail;
+
+    // exclude the read performed here from the differences
+    if ((size = read_trace_counters(&(scope->counters)))){
+        scope->counters.rchar += size;
+        scope->counters.syscr++;
+    }
+
+    clock_gettime(CLOCK_MONOTONIC, &(scope->start));
+
+    errno = errnum;
+}
+
+
+/**
+ * @brief emit the event and the sample for the phase that began with the specified scope.
+ *
+ * @param[in]  scope  the state at the beginning of the phase
+ *
+ * @note the differences of the I/O counters include the I/O caused by the phases nested inside.
+ * @note preserves 'errno' as well as 'trace_scope_begin'.
+ */
+void trace_scope_end(trace_scope *scope){
+    assert(scope);
+    assert((scope->phase_id >= 0) && (scope->phase_id < TRACE_PHASES_NUM));
+
+    struct timespec end;
+    trace_counters counters;
+    long long start_ns, dur_ns;
+    char event[TRACE_EVENT_MAX];
+    size_t size;
+    int errnum;
+
+    errnum = errno;
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    read_trace_counters(&counters);
+
+    start_ns = ((long long) scope->start.tv_sec) * 1000000000 + scope->start.tv_nsec;
+    dur_ns = (((long long) end.tv_sec) * 1000000000 + end.tv_nsec) - start_ns;
+
+    counters.rchar -= scope->counters.rchar;
+    counters.wchar -= scope->counters.wchar;
+    counters.syscr -= scope->counters.syscr;
+    counters.syscw -= scope->counters.syscw;
+
+    if (mapped_ring)
+        append_stats_sample(scope->phase_id, dur_ns, (counters.rchar + counters.wchar));
+
+    if (trace_fd != -1){
+        size = snprintf(
+            event, sizeof(event),
+            "{\"name\":\"%s\",\"cat\":\"dit\",\"ph\":\"X\",\"pid\":%d,\"tid\":%d,"
+            "\"ts\":%lld.%03lld,\"dur\":%lld.%03lld,\"args\":{"
+            "\"read_bytes\":%llu,\"write_bytes\":%llu,\"read_syscalls\":%llu,\"write_syscalls\":%llu",
+            trace_phases[scope->phase_id], ((int) trace_pid), ((int) trace_pid),
+            (start_ns / 1000), (start_ns % 1000), (dur_ns / 1000), (dur_ns % 1000),
+            counters.rchar, counters.wchar, counters.syscr, counters.syscw
+        );
+        assert(size < (sizeof(event) - (TRACE_DETAIL_MAX * 6 + 16)));
+
+        if (scope->detail){
+            memcpy((event + size), ",\"detail\":\"", (sizeof(char) * 11));
+            size += 11;
+            size += print_json_string((event + size), scope->detail, TRACE_DETAIL_MAX);
+            event[size++] = '\"';
+        }
+
+        memcpy((event + size), "}},\n", (sizeof(char) * 4));
+        append_trace_event(event, (size + 4));
+    }
+
+    errno = errnum;
+}
+
+
+
+
+/**
+ * @brief map the ring buffer for 'stats' into the memory.
+ *
+ * @param[in]  file_name  the file that stores the ring buffer
+ * @param[in]  writable  whether to map it so that the samples can be appended
+ * @return stats_ring*  the mapped ring buffer or NULL
+ *
+ * @note if the file is empty and 'writable' is true, it is extended to the size of the ring buffer.
+ * @note the file of any other size is regarded as not prepared.
+ *
+ * @attention the return value must be released with 'munmap' function, for the size of 'stats_ring'.
+ */
+stats_ring *map_stats_ring(const char *file_name, bool writable){
+    assert(file_name);
+
+    int fd;
+    struct stat file_stat;
+    void *addr;
+    stats_ring *ring = NULL;
+
+    if ((fd = open(file_name, ((writable ? O_RDWR : O_RDONLY) | O_CLOEXEC))) != -1){
+        if (! fstat(fd, &file_stat)){
+            // the file filled with zeros is a valid empty ring buffer
+            if (writable && (! file_stat.st_size) && (! ftruncate(fd, sizeof(stats_ring))))
+                file_stat.st_size = sizeof(stats_ring);
+
+            if (file_stat.st_size == sizeof(stats_ring)){
+                addr = mmap(NULL, sizeof(stats_ring), (PROT_READ | (writable ? PROT_WRITE : 0)), MAP_SHARED, fd, 0);
+                if (addr != MAP_FAILED)
+                    ring = (stats_ring *) addr;
+            }
+        }
+        close(fd);
+    }
+
+    return ring;
+}
+
+
+
+
+/******************************************************************************
+    * Counting Allocator
+******************************************************************************/
+
+
+/**
+ * @brief allocate the memory like 'malloc', counting the allocation if necessary.
+ *
+ * @param[in]  size  the number of bytes to allocate
+ * @return void*  the allocated memory or NULL
+ *
+ * @note the dit commands call this function instead of 'malloc', by the macro defined in 'main.h'.
+ */
+void *trace_malloc(size_t size){
+    void *ptr;
+
+    if ((ptr = (malloc)(size)) && count_allocs)
+        count_alloc(size, malloc_usable_size(ptr));
+
+    return ptr;
+}
+
+
+/**
+ * @brief allocate the zero-initialized memory like 'calloc', counting the allocation if necessary.
+ *
+ * @param[in]  nmemb  the number of elements
+ * @param[in]  size  the size of each element
+ * @return void*  the allocated memory or NULL
+ */
+void *trace_calloc(size_t nmemb, size_t size){
+    void *ptr;
+
+    if ((ptr = (calloc)(nmemb, size)) && count_allocs)
+        count_alloc((nmemb * size), malloc_usable_size(ptr));
+
+    return ptr;
+}
+
+
+/**
+ * @brief change the size of the memory like 'realloc', counting the reallocation if necessary.
+ *
+ * @param[in]  ptr  the memory to be resized or NULL
+ * @param[in]  size  the new number of bytes
+ * @return void*  the resized memory or NULL
+ *
+ * @note if the reallocation fails, the original memory is regarded as still allocated.
+ */
+void *trace_realloc(void *ptr, size_t size){
+    size_t old_size = 0;
+
+    if (ptr && count_allocs)
+        old_size = malloc_usable_size(ptr);
+
+    if ((ptr = (realloc)(ptr, size)) && count_allocs){
+        uncount_alloc(old_size);
+        count_alloc(size, malloc_usable_size(ptr));
+    }
+
+    return ptr;
+}
+
+
+/**
+ * @brief release the memory like 'free', counting the release if necessary.
+ *
+ * @param[in]  ptr  the memory to be released or NULL
+ */
+void trace_free(void *ptr){
+    if (ptr && count_allocs)
+        uncount_alloc(malloc_usable_size(ptr));
+
+    (free)(ptr);
+}
+
+
+/**
+ * @brief get the statistics of the dynamic memory allocations counted so far.
+ *
+ * @param[out] p_allocs  variable to store the statistics
+ */
+void get_trace_allocs(trace_allocs *p_allocs){
+    assert(p_allocs);
+
+    p_allocs->count = atomic_load(&(allocs.count));
+    p_allocs->bytes = atomic_load(&(allocs.bytes));
+    p_allocs->live = atomic_load(&(allocs.live));
+    p_allocs->peak = atomic_load(&(allocs.peak));
+    p_allocs->largest = atomic_load(&(allocs.largest));
+}
+
+
+
+
+/******************************************************************************
+    * Utilities
+******************************************************************************/
+
+
+/**
+ * @brief open the file specified by 'DIT_TRACE', and emit the event that names the process.
+ *
+ * @param[in]  cmd_name  the name of the dit command invoked
+ * @return int  file descriptor for the opened file or -1
+ *
+ * @note the file is opened with the privileges of the real user, since this tool is a setuid program.
+ */
+static int open_trace_file(const char *cmd_name){
+    assert(cmd_name);
+
+    const char *path;
+    uid_t ruid, euid;
+    int fd;
+    struct stat file_stat;
+    char event[TRACE_EVENT_MAX];
+    size_t size;
+
+    if ((! (path = getenv(TRACE_ENV_NAME))) || (! *path))
+        return -1;
+
+    ruid = getuid();
+    euid = geteuid();
+
+    if ((ruid != euid) && seteuid(ruid))
+        return -1;
+
+    fd = open(path, (O_WRONLY | O_CREAT | O_APPEND | O_CLOEXEC), 0666);
+
+    if ((ruid != euid) && seteuid(euid)){
+        if (fd != -1)
+            close(fd);
+        return -1;
+    }
+
+    if (fd == -1)
+        return -1;
+
+    if ((! fstat(fd, &file_stat)) && (! file_stat.st_size))
+        if (write(fd, "[\n", 2) != 2){
+            close(fd);
+            return -1;
+        }
+
+    size = snprintf(
+        event, sizeof(event),
+        "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":%d,\"tid\":%d,\"args\":{\"name\":\"dit ",
+        ((int) trace_pid), ((int) trace_pid)
+    );
+    size += print_json_string((event + size), cmd_name, TRACE_DETAIL_MAX);
+    memcpy((event + size), "\"}},\n", (sizeof(char) * 5));
+    append_trace_event(event, (size + 5));
+
+    return fd;
+}
+
+
+/**
+ * @brief read the current I/O counters of the calling process.
+ *
+ * @param[out] counters  variable to store the I/O counters
+ * @return size_t  the number of bytes read to get the counters
+ *
+ * @note the read performed by this function is not included in the resulting counters.
+ * @note if the counters cannot be read, they are all regarded as 0.
+ */
+static size_t read_trace_counters(trace_counters *counters){
+    assert(counters);
+
+    char buf[512], *tmp;
+    ssize_t size;
+    unsigned long long *p_val;
+
+    memset(counters, 0, sizeof(trace_counters));
+
+    if ((io_fd == -1) || ((size = pread(io_fd, buf, (sizeof(buf) - 1), 0)) <= 0))
+        return 0;
+
+    buf[size] = '\0';
+
+    for (tmp = buf; tmp; tmp = strchr(tmp, '\n')){
+        if (*tmp == '\n')
+            tmp++;
+
+        if (! strncmp(tmp, "rchar:", 6))
+            p_val = &(counters->rchar);
+        else if (! strncmp(tmp, "wchar:", 6))
+            p_val = &(counters->wchar);
+        else if (! strncmp(tmp, "syscr:", 6))
+            p_val = &(counters->syscr);
+        else if (! strncmp(tmp, "syscw:", 6))
+            p_val = &(counters->syscw);
+        else
+            continue;
+
+        *p_val = strtoull((tmp + 6), NULL, 10);
+    }
+
+    return (size_t) size;
+}
+
+
+/**
+ * @brief store the specified string as the contents of a JSON string.
+ *
+ * @param[out] dest  where to store the escaped string
+ * @param[in]  src  the string to be escaped
+ * @param[in]  limit  the maximum number of bytes read from 'src'
+ * @return size_t  the length of the stored string
+ *
+ * @attention the size of 'dest' must be greater than six times 'limit'.
+ */
+static size_t print_json_string(char *dest, const char *src, size_t limit){
+    assert(dest);
+    assert(src);
+
+    char *buf;
+    unsigned int c;
+
+    buf = dest;
+
+    while (limit-- && (c = (unsigned char) *(src++))){
+        if ((c == '\"') || (c == '\\')){
+            *(buf++) = '\\';
+            *(buf++) = c;
+        }
+        else if (c < 0x20)
+            buf += sprintf(buf, "\\u%04x", c);
+        else
+            *(buf++) = c;
+    }
+
+    return (size_t) (buf - dest);
+}
+
+
+/**
+ * @brief store the specified event in the buffer, writing out the buffer if necessary.
+ *
+ * @param[in]  event  the event in JSON format
+ * @param[in]  size  the length of the event
+ */
+static void append_trace_event(const char *event, size_t size){
+    assert(event);
+    assert(size < TRACE_BUFFER_SIZE);
+
+    if ((TRACE_BUFFER_SIZE - trace_len) < size)
+        flush_trace_events();
+
+    memcpy((trace_buf + trace_len), event, (sizeof(char) * size));
+    trace_len += size;
+}
+
+
+/**
+ * @brief write out the events stored in the buffer.
+ *
+ * @note each event is written with one 'write' syscall, so that the events of processes are not mixed.
+ * @note if the write fails, the trace file is given up for the rest of the process.
+ */
+static void flush_trace_events(void){
+    if ((trace_fd != -1) && trace_len && (write(trace_fd, trace_buf, trace_len) == -1)){
+        close(trace_fd);
+        trace_fd = -1;
+    }
+
+    trace_len = 0;
+}
+
+
+/**
+ * @brief append the sample to the ring buffer for 'stats', without taking any locks.
+ *
+ * @param[in]  phase_id  ID of the phase
+ * @param[in]  dur_ns  the elapsed time in nanoseconds
+ * @param[in]  bytes  the total number of bytes read and written
+ *
+ * @note the sequence number of the sample is cleared while it is written, so readers can detect torn samples.
+ */
+static void append_stats_sample(int phase_id, long long dur_ns, unsigned long long bytes){
+    assert(mapped_ring);
+
+    uint64_t seq;
+    stats_sample *sample;
+
+    seq = atomic_fetch_add_explicit(&(mapped_ring->head), 1, memory_order_relaxed);
+    sample = mapped_ring->samples + (seq & (STATS_RING_SIZE - 1));
+
+    atomic_store_explicit(&(sample->seq), 0, memory_order_relaxed);
+    atomic_thread_fence(memory_order_release);
+
+    sample->dur_ns = (dur_ns > 0) ? dur_ns : 0;
+    sample->bytes = bytes;
+    sample->cmd_id = trace_cmd_id;
+    sample->phase_id = phase_id;
+
+    atomic_store_explicit(&(sample->seq), (seq + 1), memory_order_release);
+}
+
+
+
+
+/**
+ * @brief emit the event that reports the statistics of the dynamic memory allocations and the maximum RSS.
+ *
+ * @note the event is emitted as an instant event of the whole process, at the time when it is emitted.
+ */
+static void emit_memory_event(void){
+    struct timespec now;
+    struct rusage usage;
+    long long now_ns;
+    char event[TRACE_EVENT_MAX];
+    size_t size;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    now_ns = ((long long) now.tv_sec) * 1000000000 + now.tv_nsec;
+
+    if (getrusage(RUSAGE_SELF, &usage))
+        usage.ru_maxrss = 0;
+
+    size = snprintf(
+        event, sizeof(event),
+        "{\"name\":\"memory\",\"ph\":\"i\",\"s\":\"p\",\"pid\":%d,\"tid\":%d,\"ts\":%lld.%03lld,"
+        "\"args\":{\"allocs\":%llu,\"alloc_bytes\":%llu,\"peak_bytes\":%zu,\"largest_alloc\":%zu,\"max_rss_kb\":%ld}},\n",
+        ((int) trace_pid), ((int) trace_pid),
+        (now_ns / 1000), (now_ns % 1000),
+        atomic_load(&(allocs.count)), atomic_load(&(allocs.bytes)), atomic_load(&(allocs.peak)),
+        atomic_load(&(allocs.largest)), usage.ru_maxrss
+    );
+
+    assert(size < sizeof(event));
+    append_trace_event(event, size);
+}
+
+
+/**
+ * @brief add the allocation to the statistics.
+ *
+ * @param[in]  size  the number of bytes requested
+ * @param[in]  usable_size  the number of bytes actually allocated
+ *
+ * @note the counters are atomic, since the workers of 'inspect' allocate memory in parallel.
+ */
+static void count_alloc(size_t size, size_t usable_size){
+    size_t curr, live;
+
+    atomic_fetch_add(&(allocs.count), 1);
+    atomic_fetch_add(&(allocs.bytes), size);
+
+    curr = atomic_load(&(allocs.largest));
+    while ((curr < size) && (! atomic_compare_exchange_weak(&(allocs.largest), &curr, size)));
+
+    live = atomic_fetch_add(&(allocs.live), usable_size) + usable_size;
+
+    curr = atomic_load(&(allocs.peak));
+    while ((curr < live) && (! atomic_compare_exchange_weak(&(allocs.peak), &curr, live)));
+}
+
+
+/**
+ * @brief subtract the release from the statistics.
+ *
+ * @param[in]  usable_size  the number of bytes actually allocated
+ *
+ * @note the memory allocated by the C library such as 'strdup' and 'scandir' is not counted when allocated,
+ * so the number of bytes currently allocated never goes below 0.
+ */
+static void uncount_alloc(size_t usable_size){
+    size_t curr;
+
+    curr = atomic_load(&(allocs.live));
+    while (! atomic_compare_exchange_weak(&(allocs.live), &curr, ((curr > usable_size) ? (curr - usable_size) : 0)));
+}
+
+
+
+
+static void *trace_alc_malloc(void *ctx, size_t size){
+    return trace_malloc(size);
+}
+
+
+static void *trace_alc_realloc(void *ctx, void *ptr, size_t size){
+    return trace_realloc(ptr, size);
+}
+
+
+static void trace_alc_free(void *ctx, void *ptr){
+    trace_free(ptr);
+}
+
+
+
+
+#ifndef NDEBUG
+
+
+/******************************************************************************
+    * Unit Test Functions
+******************************************************************************/
+
+
+static void print_json_string_test(void);
+static void trace_scope_test(void);
+
+
+
+
+void trace_test(void){
+    do_test(print_json_string_test);
+    do_test(trace_scope_test);
+}
+
+
+
+
+static void print_json_string_test(void){
+    const struct {
+        const char *src;
+        const size_t limit;
+        const char *result;
+    }
+    // changeable part for updating test cases
+    table[] = {
+        { "",                        8, ""                              },
+        { "/dit/mnt/.dit_history",  64, "/dit/mnt/.dit_history"         },
+        { "\"quoted\" \\path",      64, "\\\"quoted\\\" \\\\path"      },
+        { "tab\tand\nnewline",      64, "tab\\u0009and\\u000anewline"   },
+        { "truncated",               5, "trunc"                         },
+        {  0,                        0,  0                              }
+    };
+
+    int i;
+    char buf[64 * 6 + 1];
+    size_t len;
+
+    for (i = 0; table[i].src; i++){
+        len = print_json_string(buf, table[i].src, table[i].limit);
+        buf[len] = '\0';
+
+        assert(len == strlen(table[i].result));
+        assert(! strcmp(buf, table[i].result));
+
+        print_progress_test_loop('\0', -1, i);
+        fprintf(stderr, "'%s'\n", buf);
+    }
+}
+
+
+
+
+static void trace_scope_test(void){
+    const int phases[] = {
+        TRACE_REFLECT_LINES,
+        TRACE_XFGETS_FOR_LOOP,
+        TRACE_CHECK_IF_IGNORED
+    };
+
+    // the order in which the phases end
+    const int ends[] = { 1, 0, 2 };
+
+    trace_scope scopes[numof(phases)];
+    int i, fd;
+    char *contents;
+    size_t size;
+    yyjson_doc *doc;
+    yyjson_val *events, *event, *args;
+    stats_ring *ring;
+    stats_sample *sample;
+
+    assert(! trace_enabled);
+    assert(! (truncate(TMP_FILE1, 0) && (errno != ENOENT)));
+    assert((fd = open(TMP_FILE2, (O_WRONLY | O_CREAT | O_TRUNC), 0666)) != -1);
+    assert(! close(fd));
+
+    assert(! setenv(TRACE_ENV_NAME, TMP_FILE1, true));
+    stats_file = TMP_FILE2;
+
+    trace_init(DIT_HELP);
+    assert(trace_enabled);
+
+    trace_begin(scopes, phases[0], "/dit/mnt/.dit_history");
+    trace_begin((scopes + 1), phases[1], NULL);
+
+    assert((fd = open("/dev/null", O_WRONLY)) != -1);
+    assert(write(fd, "0123456789", 10) == 10);
+    assert(! close(fd));
+
+    trace_end(scopes + 1);
+    trace_end(scopes);
+
+    trace_begin((scopes + 2), phases[2], "\"quoted\"");
+    assert((contents = (char *) malloc(sizeof(char) * 4096)));
+    free(contents);
+    trace_end(scopes + 2);
+
+    trace_finish();
+    assert(! trace_enabled);
+    assert(! unsetenv(TRACE_ENV_NAME));
+    stats_file = STATS_RING_FILE;
+
+    // turn the output into a complete JSON array
+    size = get_file_size(TMP_FILE1);
+    assert(size > 2);
+    assert((contents = (char *) malloc(sizeof(char) * (size + 1))));
+    assert((fd = open(TMP_FILE1, O_RDONLY)) != -1);
+    assert(read(fd, contents, size) == ((ssize_t) size));
+    assert(! close(fd));
+
+    assert(! memcmp((contents + size - 2), ",\n", 2));
+    contents[size - 2] = ']';
+    contents[size - 1] = '\0';
+
+    assert((doc = yyjson_read(contents, (size - 1), 0)));
+    assert((events = yyjson_doc_get_root(doc)));
+    assert(yyjson_arr_size(events) == (numof(phases) + 2));
+
+    event = yyjson_arr_get_first(events);
+    assert(! strcmp(yyjson_get_str(yyjson_obj_get(event, "ph")), "M"));
+
+    assert((ring = map_stats_ring(TMP_FILE2, false)));
+    assert(atomic_load(&(ring->head)) == numof(phases));
+
+    // events and samples are emitted in the order in which the phases end
+    for (i = 0; i < ((int) numof(phases)); i++){
+        event = yyjson_arr_get(events, (i + 1));
+        assert(! strcmp(yyjson_get_str(yyjson_obj_get(event, "ph")), "X"));
+        assert(! strcmp(yyjson_get_str(yyjson_obj_get(event, "name")), trace_phases[phases[ends[i]]]));
+        assert(yyjson_is_num(yyjson_obj_get(event, "dur")));
+        assert((args = yyjson_obj_get(event, "args")));
+
+        sample = ring->samples + i;
+        assert(atomic_load(&(sample->seq)) == (i + 1));
+        assert(sample->cmd_id == DIT_HELP);
+        assert(sample->phase_id == phases[ends[i]]);
+
+        if (i < 2){
+            assert(yyjson_get_uint(yyjson_obj_get(args, "write_bytes")) >= 10);
+            assert(yyjson_get_uint(yyjson_obj_get(args, "write_syscalls")) >= 1);
+            assert(sample->bytes >= 10);
+        }
+
+        print_progress_test_loop('\0', -1, i);
+        fprintf(stderr, "%s\n", trace_phases[phases[ends[i]]]);
+    }
+
+    assert(! strcmp(yyjson_get_str(yyjson_obj_get(args, "detail")), "\"quoted\""));
+
+    // the allocations are reported after all the phases
+    event = yyjson_arr_get_last(events);
+    assert(! strcmp(yyjson_get_str(yyjson_obj_get(event, "name")), "memory"));
+    assert((args = yyjson_obj_get(event, "args")));
+    assert(yyjson_get_uint(yyjson_obj_get(args, "allocs")) >= 1);
+    assert(yyjson_get_uint(yyjson_obj_get(args, "largest_alloc")) >= 4096);
+    assert(yyjson_get_uint(yyjson_obj_get(args, "peak_bytes")) >= 4096);
+
+    munmap(ring, sizeof(stats_ring));
+    yyjson_doc_free(doc);
+    free(contents);
+}
+
+
+#endif // NDEBUG
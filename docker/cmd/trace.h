@@ -0,0 +1,133 @@
+#ifndef DIT_TRACE_EVENTS
+#define DIT_TRACE_EVENTS
+
+
+/******************************************************************************
+    * commonly used Macros
+******************************************************************************/
+
+#define TRACE_ENV_NAME "DIT_TRACE"
+#define STATS_RING_FILE "/dit/srv/stats.ring"
+
+#define STATS_RING_SIZE 16384
+
+
+#define TRACE_PHASES_NUM 18
+
+#define TRACE_MAIN                     0
+#define TRACE_XFGETS_FOR_LOOP          1
+#define TRACE_EXECUTE                  2
+#define TRACE_CONSTRUCT_ERASE_DATA     3
+#define TRACE_MARKLINES_CONTAINING     4
+#define TRACE_DELETE_MARKED_LINES      5
+#define TRACE_MANAGE_ERASE_LOGS        6
+#define TRACE_LOAD_IGNORE_FILE         7
+#define TRACE_CHECK_IF_IGNORED         8
+#define TRACE_REFLECT_LINES            9
+#define TRACE_RECORD_REFLECTED_LINES  10
+#define TRACE_CONSTRUCT_DIR_TREE      11
+#define TRACE_DESTRUCT_DIR_TREE       12
+#define TRACE_WRITE_CHECKPOINT        13
+#define TRACE_EXTRACT_CHECKPOINT      14
+#define TRACE_ESTIMATE_DIR_TREE       15
+#define TRACE_BUILD_LINE_MAP          16
+#define TRACE_COMPARE_DIR_TREES       17
+
+
+#define trace_begin(scope, phase_id, detail) \
+    do { \
+        if (trace_enabled) \
+            trace_scope_begin(scope, phase_id, detail); \
+    } while (false)
+
+#define trace_end(scope) \
+    do { \
+        if (trace_enabled) \
+            trace_scope_end(scope); \
+    } while (false)
+
+
+
+
+/******************************************************************************
+    * commonly used Data Types
+******************************************************************************/
+
+/** Data type for storing the I/O counters of the calling process */
+typedef struct {
+    unsigned long long rchar;    /** the number of bytes read by the syscalls such as 'read' */
+    unsigned long long wchar;    /** the number of bytes written by the syscalls such as 'write' */
+    unsigned long long syscr;    /** the number of the syscalls such as 'read' */
+    unsigned long long syscw;    /** the number of the syscalls such as 'write' */
+} trace_counters;
+
+
+/** Data type for storing the state at the beginning of a traced phase */
+typedef struct {
+    int phase_id;                /** ID of the phase */
+    const char *detail;          /** additional information such as the target file or NULL */
+    struct timespec start;       /** the time when the phase began */
+    trace_counters counters;     /** the I/O counters when the phase began */
+} trace_scope;
+
+
+/** Data type for storing one sample of the elapsed time of a phase */
+typedef struct {
+    _Atomic uint64_t seq;        /** the sequence number plus 1 after the sample is completely written, or 0 */
+    uint64_t dur_ns;             /** the elapsed time in nanoseconds */
+    uint64_t bytes;              /** the total number of bytes read and written */
+    uint16_t cmd_id;             /** ID of the dit command */
+    uint16_t phase_id;           /** ID of the phase */
+} stats_sample;
+
+
+/** Data type for storing the statistics of the dynamic memory allocations */
+typedef struct {
+    unsigned long long count;    /** the number of allocations, including the ones by 'realloc' */
+    unsigned long long bytes;    /** the total number of bytes requested */
+    size_t live;                 /** the number of bytes currently allocated */
+    size_t peak;                 /** the maximum number of bytes allocated at the same time */
+    size_t largest;              /** the number of bytes requested by the largest single allocation */
+} trace_allocs;
+
+
+/** Data type for the contents of the file that is shared by all dit commands as a lock-free ring buffer */
+typedef struct {
+    _Atomic uint64_t head;                    /** the total number of samples appended so far */
+    stats_sample samples[STATS_RING_SIZE];    /** the samples, where the oldest one is overwritten */
+} stats_ring;
+
+
+
+
+/******************************************************************************
+    * Interface for the Instrumentation
+******************************************************************************/
+
+extern bool trace_enabled;
+extern const char * const trace_phases[TRACE_PHASES_NUM];
+
+void trace_init(int cmd_id);
+void trace_finish(void);
+
+void trace_scope_begin(trace_scope *scope, int phase_id, const char *detail);
+void trace_scope_end(trace_scope *scope);
+
+stats_ring *map_stats_ring(const char *file_name, bool writable);
+
+
+/******************************************************************************
+    * Interface for the Counting Allocator
+******************************************************************************/
+
+extern const struct yyjson_alc trace_alc;
+
+void *trace_malloc(size_t size);
+void *trace_calloc(size_t nmemb, size_t size);
+void *trace_realloc(void *ptr, size_t size);
+void trace_free(void *ptr);
+
+void get_trace_allocs(trace_allocs *allocs);
+
+
+#endif // DIT_TRACE_EVENTS
@@ -0,0 +1,761 @@
+/**
+ * @file workload.c
+ *
+ * Copyright (c) 2023 Tsukasa Inada
+ *
+ * @brief Described the generators of the synthetic inputs shared by the benchmarks and the tests.
+ * @author Tsukasa Inada
+ * @date 2023/10/14
+ *
+ * @note the same seed always produces the same inputs, because the C library's 'rand' is not used.
+ * @note this file is linked to both the dit command and the extra command 'benchgen'.
+ */
+
+
+#include "debug.h"
+
+#include <assert.h>
+#include <errno.h>
+#include <limits.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <sys/types.h>
+
+#include <dirent.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "test.h"
+#include "workload.h"
+
+
+#define WORKLOAD_BUFFER_SIZE 4096
+
+#define numof(array) (sizeof(array) / sizeof(*array))
+
+
+/** Data type for the templates of the lines, where the higher the weight, the more frequently it appears */
+typedef struct {
+    unsigned int weight;      /** relative frequency */
+    const char *format;       /** line format, where '%' followed by a letter is replaced with a random token */
+} workload_template;
+
+
+static int print_template(FILE *fp, workload_rng *rng, const char *format, size_t *p_bytes);
+static const char *pick_template(workload_rng *rng, const workload_template *templates, size_t size);
+
+static int gen_tree_level(char *path, size_t len, workload_rng *rng, const workload_tree *shape, unsigned int depth, size_t *p_bytes);
+static int gen_tree_file(const char *file_name, workload_rng *rng, const workload_tree *shape, size_t *p_bytes);
+static size_t get_file_size_sample(workload_rng *rng, const workload_tree *shape);
+
+
+/** array of the names of the kinds of inputs, in the order of the IDs */
+const char * const workload_kinds[WORKLOAD_KINDS_NUM] = {
+    "history",
+    "dockerfile",
+    "ignore",
+    "tree"
+};
+
+
+/** array of the lines of history-file, roughly following the frequencies observed in interactive shells */
+static const workload_template history_templates[] = {
+    { 20, "ls%o %p"                                                 },
+    { 15, "cd %d"                                                   },
+    {  6, "cat %p"                                                  },
+    {  5, "vi %p"                                                   },
+    {  5, "grep -rn %w %d"                                          },
+    {  4, "git status"                                              },
+    {  2, "git clone https://github.com/%w/%w.git"                  },
+    {  3, "make -j%n"                                               },
+    {  4, "apk add --no-cache %k %k"                                },
+    {  4, "apt-get install -y %k"                                   },
+    {  2, "pip install %k"                                          },
+    {  2, "curl -fsSL https://%w.example.com/%w.tar.gz -o %p"       },
+    {  2, "tar -xzf %p -C %d"                                       },
+    {  4, "echo \"%w %w\""                                          },
+    {  2, "export %W=%w"                                            },
+    {  3, "rm -fr %p"                                               },
+    {  3, "mkdir -p %d"                                             },
+    {  3, "cp -r %p %d"                                             },
+    {  2, "mv %p %p"                                                },
+    {  2, "chmod +x %p"                                             },
+    {  1, "./configure --prefix=/usr/local"                         },
+    {  1, "useradd -m %w"                                           },
+    {  1, "dit erase -dhy"                                          },
+    {  1, "dit ignore -h %w"                                        }
+};
+
+/** array of the lines of Dockerfile, where the continuation lines are counted separately */
+static const workload_template dockerfile_templates[] = {
+    { 30, "RUN %k%o %p"                                             },
+    { 12, "RUN apk add --no-cache %k %k"                            },
+    {  8, "RUN apt-get update && apt-get install -y %k \\\n    && rm -fr /var/lib/apt/lists/*" },
+    {  6, "RUN cd %d && make -j%n"                                  },
+    {  8, "COPY %p %d"                                              },
+    {  2, "ADD https://%w.example.com/%w.tar.gz %d"                 },
+    {  6, "ENV %W=%w"                                               },
+    {  4, "WORKDIR %d"                                              },
+    {  3, "ARG %W=%n"                                               },
+    {  2, "LABEL %w=\"%w\""                                         },
+    {  2, "EXPOSE %n%n"                                             },
+    {  2, "USER %w"                                                 },
+    {  1, "CMD [ \"%p\" ]"                                          },
+    {  1, "ONBUILD RUN make -j%n"                                   },
+    {  1, "HEALTHCHECK --interval=%nm CMD curl -f http://localhost/" },
+    {  1, "  run echo %w"                                           },
+    {  2, "# %w %w %w"                                              },
+    {  2, ""                                                        }
+};
+
+
+/** array of the tokens used as words */
+static const char * const words[] = {
+    "app", "build", "cache", "config", "data", "debug", "dist", "docs", "example", "include", "lib", "local",
+    "main", "module", "node", "opt", "output", "pkg", "release", "script", "server", "share", "src", "test",
+    "tmp", "tool", "user", "util", "var", "vendor", "web", "work"
+};
+
+/** array of the tokens used as package names */
+static const char * const packages[] = {
+    "bash", "binutils", "build-base", "ca-certificates", "cmake", "coreutils", "curl", "diffutils", "file",
+    "findutils", "gcc", "git", "gnupg", "grep", "gzip", "jq", "less", "libc-dev", "libffi-dev", "linux-headers",
+    "make", "musl-dev", "ncurses", "openssh", "openssl", "patch", "perl", "pkgconf", "procps", "python3",
+    "py3-pip", "readline", "sed", "tar", "tzdata", "unzip", "util-linux", "vim", "wget", "xz", "zlib-dev"
+};
+
+/** array of the tokens used as the prefixes of paths */
+static const char * const dirs[] = { "", "./", "../", "/tmp/", "/usr/local/src/", "src/", "/etc/", "/opt/" };
+
+/** array of the tokens used as the suffixes of paths */
+static const char * const exts[] = { "", ".c", ".h", ".txt", ".sh", ".py", ".json", ".tar.gz", ".conf" };
+
+/** array of the tokens used as short options */
+static const char * const opts[] = { "", " -l", " -a", " -la", " -lh", " -R" };
+
+
+
+
+/******************************************************************************
+    * Pseudo-Random Number Generator
+******************************************************************************/
+
+
+/**
+ * @brief initialize the pseudo-random number generator.
+ *
+ * @param[out] rng  the state of the generator
+ * @param[in]  seed  the seed
+ */
+void workload_seed(workload_rng *rng, uint64_t seed){
+    assert(rng);
+    rng->state = seed;
+}
+
+
+/**
+ * @brief generate the next pseudo-random number.
+ *
+ * @param[out] rng  the state of the generator
+ * @return uint64_t  the resulting number
+ *
+ * @note uses splitmix64, which is fast enough and whose outputs are well distributed even for small seeds.
+ */
+uint64_t workload_next(workload_rng *rng){
+    assert(rng);
+
+    uint64_t z;
+
+    z = (rng->state += 0x9e3779b97f4a7c15);
+    z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9;
+    z = (z ^ (z >> 27)) * 0x94d049bb133111eb;
+    return z ^ (z >> 31);
+}
+
+
+/**
+ * @brief generate the next pseudo-random number less than the specified integer.
+ *
+ * @param[out] rng  the state of the generator
+ * @param[in]  n  the upper limit (exclusive)
+ * @return size_t  the resulting number
+ */
+size_t workload_range(workload_rng *rng, size_t n){
+    assert(n);
+    return workload_next(rng) % n;
+}
+
+
+
+
+/******************************************************************************
+    * Generators of the Input Files
+******************************************************************************/
+
+
+/**
+ * @brief generate the contents of history-file.
+ *
+ * @param[out] fp  handler for the output file
+ * @param[out] rng  the state of the generator
+ * @param[in]  lines  the number of lines
+ * @param[out] p_bytes  variable to which the number of bytes written is added, or NULL
+ * @return int  0 (success) or -1 (unexpected error)
+ */
+int gen_workload_history(FILE *fp, workload_rng *rng, size_t lines, size_t *p_bytes){
+    assert(fp);
+    assert(rng);
+
+    const char *format;
+
+    for (; lines; lines--){
+        format = pick_template(rng, history_templates, numof(history_templates));
+
+        if (print_template(fp, rng, format, p_bytes))
+            return -1;
+    }
+    return 0;
+}
+
+
+/**
+ * @brief generate the contents of Dockerfile.
+ *
+ * @param[out] fp  handler for the output file
+ * @param[out] rng  the state of the generator
+ * @param[in]  lines  the number of lines including the first FROM instruction
+ * @param[out] p_bytes  variable to which the number of bytes written is added, or NULL
+ * @return int  0 (success) or -1 (unexpected error)
+ */
+int gen_workload_dockerfile(FILE *fp, workload_rng *rng, size_t lines, size_t *p_bytes){
+    assert(fp);
+    assert(rng);
+
+    const char *format = "FROM alpine:3.%n";
+
+    while (lines){
+        if (print_template(fp, rng, format, p_bytes))
+            return -1;
+
+        lines -= (strchr(format, '\n') ? 2 : 1);
+
+        do
+            format = pick_template(rng, dockerfile_templates, numof(dockerfile_templates));
+        while ((lines == 1) && strchr(format, '\n'));
+    }
+    return 0;
+}
+
+
+/**
+ * @brief generate the contents of ignore-file in JSON format.
+ *
+ * @param[out] fp  handler for the output file
+ * @param[out] rng  the state of the generator
+ * @param[in]  entries  the number of commands
+ * @param[out] p_bytes  variable to which the number of bytes written is added, or NULL
+ * @return int  0 (success) or -1 (unexpected error)
+ *
+ * @note about 20% of the commands are aliases, each of which refers to the latest non-alias command.
+ */
+int gen_workload_ignore(FILE *fp, workload_rng *rng, size_t entries, size_t *p_bytes){
+    assert(fp);
+    assert(rng);
+
+    const char *word, *target_word = NULL, *delimiter;
+    size_t i, target_idx = 0, count;
+    int len, total = 0;
+
+    if ((len = fprintf(fp, "{")) < 0)
+        return -1;
+    total += len;
+
+    for (i = 0; i < entries; i++){
+        word = words[workload_range(rng, numof(words))];
+
+        if ((len = fprintf(fp, "%s\n    \"%s-%zu\": ", (i ? "," : ""), word, i)) < 0)
+            return -1;
+        total += len;
+
+        count = workload_range(rng, 10);
+
+        if (target_word && (count < 2))
+            len = fprintf(fp, "\"%s-%zu\"", target_word, target_idx);
+        else {
+            target_word = word;
+            target_idx = i;
+
+            if (count < 3)
+                len = fprintf(fp, "null");
+            else {
+                len = fprintf(fp, "{\n        \"short_opts\": \"%c%c:\",\n"
+                    "        \"long_opts\": {\n            \"%s\": %zu\n        },\n",
+                    ('a' + (int) workload_range(rng, 26)), ('A' + (int) workload_range(rng, 26)),
+                    words[workload_range(rng, numof(words))], workload_range(rng, 3));
+                if (len < 0)
+                    return -1;
+                total += len;
+
+                if (count < 6){
+                    delimiter = "        \"first_args\": [ ";
+
+                    for (count = workload_range(rng, 4) + 1; count; count--, delimiter = ", "){
+                        if ((len = fprintf(fp, "%s\"%s\"", delimiter, words[workload_range(rng, numof(words))])) < 0)
+                            return -1;
+                        total += len;
+                    }
+                    if ((len = fprintf(fp, " ],\n")) < 0)
+                        return -1;
+                    total += len;
+                }
+
+                len = fprintf(fp, "        \"max_argc\": %zu,\n        \"detect_anymatch\": %s\n    }",
+                    workload_range(rng, 4), (workload_range(rng, 2) ? "true" : "false"));
+            }
+        }
+
+        if (len < 0)
+            return -1;
+        total += len;
+    }
+
+    if ((len = fprintf(fp, "\n}\n")) < 0)
+        return -1;
+    total += len;
+
+    if (p_bytes)
+        *p_bytes += total;
+    return 0;
+}
+
+
+/**
+ * @brief generate the directory tree under the specified directory.
+ *
+ * @param[in]  dir_name  the root directory, which is created if it does not exist
+ * @param[out] rng  the state of the generator
+ * @param[in]  shape  the shape of the directory tree
+ * @param[out] p_bytes  variable to which the total size of the generated files is added, or NULL
+ * @return int  0 (success) or -1 (unexpected error)
+ *
+ * @note the number of files is 'fanout * (1 + fanout + ... + fanout ^ depth)'.
+ */
+int gen_workload_tree(const char *dir_name, workload_rng *rng, const workload_tree *shape, size_t *p_bytes){
+    assert(dir_name);
+    assert(rng);
+    assert(shape);
+    assert(shape->min_size <= shape->max_size);
+    assert(shape->binary <= 100);
+
+    char path[PATH_MAX];
+    size_t len;
+
+    if ((len = strlen(dir_name)) >= (PATH_MAX - 32)){
+        errno = ENAMETOOLONG;
+        return -1;
+    }
+    memcpy(path, dir_name, (sizeof(char) * (len + 1)));
+
+    if (mkdir(path, (S_IRWXU | S_IRWXG | S_IRWXO)) && (errno != EEXIST))
+        return -1;
+
+    return gen_tree_level(path, len, rng, shape, shape->depth, p_bytes);
+}
+
+
+
+
+/******************************************************************************
+    * Utilities
+******************************************************************************/
+
+
+/**
+ * @brief print the line made from the format, followed by a newline.
+ *
+ * @param[out] fp  handler for the output file
+ * @param[out] rng  the state of the generator
+ * @param[in]  format  line format
+ * @param[out] p_bytes  variable to which the number of bytes written is added, or NULL
+ * @return int  0 (success) or -1 (unexpected error)
+ *
+ * @note '%d' is a directory, '%k' is a package, '%n' is a small number, '%o' is a short option,
+ * '%p' is a path, '%w' is a word and '%W' is a word in upper case.
+ */
+static int print_template(FILE *fp, workload_rng *rng, const char *format, size_t *p_bytes){
+    assert(fp);
+    assert(format);
+
+    const char *token;
+    int c, len, total = 0;
+
+    while ((c = (unsigned char) *(format++))){
+        len = 1;
+
+        if ((c != '%') || (! *format))
+            c = putc(c, fp);
+        else
+            switch ((c = (unsigned char) *(format++))){
+                case 'd':
+                    len = fprintf(fp, "%s%s", dirs[workload_range(rng, numof(dirs) - 1) + 1],
+                        words[workload_range(rng, numof(words))]);
+                    break;
+                case 'k':
+                    len = fprintf(fp, "%s", packages[workload_range(rng, numof(packages))]);
+                    break;
+                case 'n':
+                    len = fprintf(fp, "%zu", (workload_range(rng, 16) + 1));
+                    break;
+                case 'o':
+                    len = fprintf(fp, "%s", opts[workload_range(rng, numof(opts))]);
+                    break;
+                case 'p':
+                    len = fprintf(fp, "%s%s%s", dirs[workload_range(rng, numof(dirs))],
+                        words[workload_range(rng, numof(words))], exts[workload_range(rng, numof(exts))]);
+                    break;
+                case 'W':
+                    len = 0;
+                    for (token = words[workload_range(rng, numof(words))]; *token; token++, len++)
+                        if (putc(((*token - 'a') + 'A'), fp) == EOF)
+                            return -1;
+                    break;
+                case 'w':
+                    len = fprintf(fp, "%s", words[workload_range(rng, numof(words))]);
+                    break;
+                default:
+                    c = putc(c, fp);
+            }
+
+        if ((c == EOF) || (len < 0))
+            return -1;
+        total += len;
+    }
+
+    if (putc('\n', fp) == EOF)
+        return -1;
+
+    if (p_bytes)
+        *p_bytes += total + 1;
+    return 0;
+}
+
+
+/**
+ * @brief pick one of the templates in proportion to their weights.
+ *
+ * @param[out] rng  the state of the generator
+ * @param[in]  templates  array of the templates
+ * @param[in]  size  the number of the templates
+ * @return const char*  the format of the picked template
+ */
+static const char *pick_template(workload_rng *rng, const workload_template *templates, size_t size){
+    assert(templates);
+    assert(size);
+
+    size_t i, total = 0;
+
+    for (i = 0; i < size; i++)
+        total += templates[i].weight;
+
+    total = workload_range(rng, total);
+
+    for (i = 0; total >= templates[i].weight; i++)
+        total -= templates[i].weight;
+
+    assert(i < size);
+    return templates[i].format;
+}
+
+
+
+
+/**
+ * @brief generate the files and the subdirectories in the directory.
+ *
+ * @param[out] path  buffer that contains the directory path, which is restored before returning
+ * @param[in]  len  the length of the directory path
+ * @param[out] rng  the state of the generator
+ * @param[in]  shape  the shape of the directory tree
+ * @param[in]  depth  the remaining number of levels of subdirectories
+ * @param[out] p_bytes  variable to which the total size of the generated files is added, or NULL
+ * @return int  0 (success) or -1 (unexpected error)
+ */
+static int gen_tree_level(char *path, size_t len, workload_rng *rng, const workload_tree *shape, unsigned int depth, size_t *p_bytes){
+    assert(path);
+    assert(shape);
+
+    unsigned int i;
+    int exit_status = 0;
+
+    for (i = 0; i < shape->fanout; i++){
+        sprintf((path + len), "/file%u%s", i, exts[workload_range(rng, numof(exts))]);
+
+        if ((exit_status = gen_tree_file(path, rng, shape, p_bytes)))
+            break;
+    }
+
+    if (depth && (! exit_status)){
+        if ((len + 16) >= PATH_MAX){
+            errno = ENAMETOOLONG;
+            exit_status = -1;
+        }
+        else
+            for (i = 0; i < shape->fanout; i++){
+                sprintf((path + len), "/dir%u", i);
+
+                if (mkdir(path, (S_IRWXU | S_IRWXG | S_IRWXO)) && (errno != EEXIST)){
+                    exit_status = -1;
+                    break;
+                }
+                if ((exit_status = gen_tree_level(path, strlen(path), rng, shape, (depth - 1), p_bytes)))
+                    break;
+            }
+    }
+
+    path[len] = '\0';
+    return exit_status;
+}
+
+
+/**
+ * @brief generate a file whose contents are either text or incompressible bytes.
+ *
+ * @param[in]  file_name  the file to be generated
+ * @param[out] rng  the state of the generator
+ * @param[in]  shape  the shape of the directory tree
+ * @param[out] p_bytes  variable to which the size of the file is added, or NULL
+ * @return int  0 (success) or -1 (unexpected error)
+ */
+static int gen_tree_file(const char *file_name, workload_rng *rng, const workload_tree *shape, size_t *p_bytes){
+    assert(file_name);
+    assert(shape);
+
+    char buf[WORKLOAD_BUFFER_SIZE];
+    size_t size, remain, chunk, i;
+    bool binary;
+    const char *word;
+    uint64_t bits;
+    int fd, exit_status = 0;
+
+    if ((fd = open(file_name, (O_WRONLY | O_CREAT | O_TRUNC), (S_IRUSR | S_IWUSR | S_IRGRP | S_IROTH))) == -1)
+        return -1;
+
+    binary = (workload_range(rng, 100) < shape->binary);
+    size = get_file_size_sample(rng, shape);
+
+    for (remain = size; remain; remain -= chunk){
+        chunk = (remain < sizeof(buf)) ? remain : sizeof(buf);
+
+        if (binary)
+            for (i = 0; i < chunk; i += sizeof(bits)){
+                bits = workload_next(rng);
+                memcpy((buf + i), &bits, (((chunk - i) < sizeof(bits)) ? (chunk - i) : sizeof(bits)));
+            }
+        else
+            for (i = 0; i < chunk;){
+                word = words[workload_range(rng, numof(words))];
+
+                while (*word && (i < chunk))
+                    buf[i++] = *(word++);
+                if (i < chunk)
+                    buf[i++] = workload_range(rng, 8) ? ' ' : '\n';
+            }
+
+        if (write(fd, buf, chunk) != (ssize_t) chunk){
+            exit_status = -1;
+            break;
+        }
+    }
+
+    if (close(fd))
+        exit_status = -1;
+
+    if ((! exit_status) && p_bytes)
+        *p_bytes += size;
+    return exit_status;
+}
+
+
+/**
+ * @brief determine the size of a file according to the distribution.
+ *
+ * @param[out] rng  the state of the generator
+ * @param[in]  shape  the shape of the directory tree
+ * @return size_t  the resulting size
+ *
+ * @note the logarithmic scale picks a power of two uniformly, and then a size uniformly within it.
+ */
+static size_t get_file_size_sample(workload_rng *rng, const workload_tree *shape){
+    assert(shape);
+
+    size_t min_size, max_size;
+    unsigned int lo, hi, bit;
+
+    min_size = shape->min_size;
+    max_size = shape->max_size;
+
+    if (shape->log_scale && (max_size > 1)){
+        for (lo = 0; (((size_t) 1) << (lo + 1)) <= min_size; lo++);
+        for (hi = lo; (hi < (sizeof(size_t) * CHAR_BIT - 1)) && ((((size_t) 1) << (hi + 1)) <= max_size); hi++);
+
+        bit = lo + workload_range(rng, (hi - lo + 1));
+
+        if (min_size < (((size_t) 1) << bit))
+            min_size = ((size_t) 1) << bit;
+        if ((bit < (sizeof(size_t) * CHAR_BIT - 1)) && (max_size >= (((size_t) 1) << (bit + 1))))
+            max_size = (((size_t) 1) << (bit + 1)) - 1;
+    }
+
+    return min_size + ((max_size > min_size) ? workload_range(rng, (max_size - min_size + 1)) : 0);
+}
+
+
+
+
+#ifndef NDEBUG
+
+
+/******************************************************************************
+    * Unit Test Functions
+******************************************************************************/
+
+
+static void gen_workload_file_test(void);
+static void gen_workload_tree_test(void);
+
+static int remove_tree(char *path);
+
+
+
+
+void workload_test(void){
+    do_test(gen_workload_file_test);
+    do_test(gen_workload_tree_test);
+}
+
+
+
+
+static void gen_workload_file_test(void){
+    int (* const gen_funcs[3])(FILE *, workload_rng *, size_t, size_t *) = {
+        gen_workload_history,
+        gen_workload_dockerfile,
+        gen_workload_ignore
+    };
+
+    const size_t counts[] = { 0, 1, 2, 10, 1000 };
+
+    workload_rng rng;
+    char *buf[2];
+    size_t buf_size[2], bytes, i, j, k, lines;
+    FILE *fp;
+
+    for (i = 0; i < numof(gen_funcs); i++)
+        for (j = 0; j < numof(counts); j++){
+            for (k = 0; k < 2; k++){
+                bytes = 0;
+                workload_seed(&rng, WORKLOAD_SEED);
+
+                assert((fp = open_memstream(&(buf[k]), &(buf_size[k]))));
+                assert(! gen_funcs[i](fp, &rng, counts[j], &bytes));
+                assert(! fclose(fp));
+                assert(bytes == buf_size[k]);
+            }
+
+            // the same seed must produce the same input
+            assert(buf_size[0] == buf_size[1]);
+            assert(! memcmp(buf[0], buf[1], buf_size[0]));
+
+            if (i < 2){
+                for (lines = 0, k = 0; k < buf_size[0]; k++)
+                    if (buf[0][k] == '\n')
+                        lines++;
+                assert(lines == counts[j]);
+
+                if (i && counts[j])
+                    assert(! strncmp(buf[0], "FROM ", 5));
+            }
+            else
+                assert((*(buf[0]) == '{') && (! strcmp((buf[0] + buf_size[0] - 2), "}\n")));
+
+            free(buf[0]);
+            free(buf[1]);
+
+            fprintf(stderr, "  %3zu: %s with %zu lines or entries\n", (i * numof(counts) + j + 1), workload_kinds[i], counts[j]);
+        }
+}
+
+
+
+
+static void gen_workload_tree_test(void){
+    const char *dir_name = "/dit/tmp/workload.test";
+    const workload_tree shapes[] = {
+        { .fanout = 0, .depth = 3, .min_size =   0, .max_size =    0, .log_scale = false, .binary =   0 },
+        { .fanout = 1, .depth = 0, .min_size =  10, .max_size =   10, .log_scale = false, .binary = 100 },
+        { .fanout = 2, .depth = 2, .min_size =   0, .max_size = 1000, .log_scale = false, .binary =  50 },
+        { .fanout = 3, .depth = 1, .min_size = 100, .max_size = 9000, .log_scale =  true, .binary =  25 }
+    };
+
+    workload_rng rng;
+    size_t i, bytes, files, power;
+    struct stat file_stat;
+    char path[PATH_MAX];
+    unsigned int j;
+
+    for (i = 0; i < numof(shapes); i++){
+        bytes = 0;
+        workload_seed(&rng, WORKLOAD_SEED);
+
+        assert(! gen_workload_tree(dir_name, &rng, (shapes + i), &bytes));
+
+        for (files = 0, power = shapes[i].fanout, j = 0; j <= shapes[i].depth; j++, power *= shapes[i].fanout)
+            files += power;
+        assert((files * shapes[i].min_size) <= bytes);
+        assert(bytes <= (files * shapes[i].max_size));
+
+        if (shapes[i].fanout){
+            assert(! stat(dir_name, &file_stat));
+            assert(S_ISDIR(file_stat.st_mode));
+
+            snprintf(path, sizeof(path), "%s/dir0", dir_name);
+            assert((! stat(path, &file_stat)) == (shapes[i].depth > 0));
+        }
+
+        strcpy(path, dir_name);
+        assert(! remove_tree(path));
+
+        fprintf(stderr, "  %3zu: tree of %zu files and %zu bytes\n", (i + 1), files, bytes);
+    }
+}
+
+
+static int remove_tree(char *path){
+    DIR *dir;
+    struct dirent *entry;
+    size_t len;
+    int exit_status = 0;
+
+    if ((dir = opendir(path))){
+        len = strlen(path);
+
+        while ((! exit_status) && (entry = readdir(dir)))
+            if (strcmp(entry->d_name, ".") && strcmp(entry->d_name, "..")){
+                snprintf((path + len), (PATH_MAX - len), "/%s", entry->d_name);
+                exit_status = (entry->d_type == DT_DIR) ? remove_tree(path) : unlink(path);
+            }
+
+        closedir(dir);
+        path[len] = '\0';
+    }
+
+    return exit_status ? exit_status : rmdir(path);
+}
+
+
+#endif // NDEBUG
@@ -0,0 +1,61 @@
+#ifndef DIT_WORKLOAD
+#define DIT_WORKLOAD
+
+
+/******************************************************************************
+    * commonly used Macros
+******************************************************************************/
+
+#define WORKLOAD_SEED 20231014
+
+
+#define WORKLOAD_HISTORY     0
+#define WORKLOAD_DOCKERFILE  1
+#define WORKLOAD_IGNORE      2
+#define WORKLOAD_TREE        3
+
+#define WORKLOAD_KINDS_NUM 4
+
+
+
+
+/******************************************************************************
+    * commonly used Data Types
+******************************************************************************/
+
+/** Data type for the state of the pseudo-random number generator that is independent of the C library */
+typedef struct {
+    uint64_t state;    /** the internal state of splitmix64 */
+} workload_rng;
+
+
+/** Data type for storing the shape of the directory tree to be generated */
+typedef struct {
+    unsigned int fanout;    /** the number of files and the number of subdirectories in each directory */
+    unsigned int depth;     /** the number of levels of subdirectories */
+    size_t min_size;        /** the minimum size of each file */
+    size_t max_size;        /** the maximum size of each file */
+    bool log_scale;         /** whether the file sizes are distributed evenly on a logarithmic scale */
+    unsigned int binary;    /** the percentage of the files filled with incompressible bytes */
+} workload_tree;
+
+
+
+
+/******************************************************************************
+    * Interface for the Generators
+******************************************************************************/
+
+extern const char * const workload_kinds[WORKLOAD_KINDS_NUM];
+
+void workload_seed(workload_rng *rng, uint64_t seed);
+uint64_t workload_next(workload_rng *rng);
+size_t workload_range(workload_rng *rng, size_t n);
+
+int gen_workload_history(FILE *fp, workload_rng *rng, size_t lines, size_t *p_bytes);
+int gen_workload_dockerfile(FILE *fp, workload_rng *rng, size_t lines, size_t *p_bytes);
+int gen_workload_ignore(FILE *fp, workload_rng *rng, size_t entries, size_t *p_bytes);
+int gen_workload_tree(const char *dir_name, workload_rng *rng, const workload_tree *shape, size_t *p_bytes);
+
+
+#endif // DIT_WORKLOAD
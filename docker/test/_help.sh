@@ -28,7 +28,7 @@ trap 'end_processing' EXIT
 trap 'exit 1' HUP INT QUIT TERM
 
 
-CMDS_NUM=14
+CMDS_NUM=17
 
 TMP1=_help1.tmp
 TMP2=_help2.tmp
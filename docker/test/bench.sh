@@ -0,0 +1,215 @@
+#!/bin/bash -u
+
+
+#
+# Usages:
+#   bench.sh [-n PROMPTS] [-o CSV_FILE] [HISTORY_LINES]...
+# Measure how the latency of the prompt grows as the session ages, through the real 'PROMPT_REFLECT'.
+#
+# Variables:
+#   <PROMPTS>          the number of command lines fed for each history size (100 by default)
+#   <CSV_FILE>         the file to which the results are written ('/dit/tmp/bench.csv' by default)
+#   <HISTORY_LINES>    the number of lines in history-file before feeding (100, 10000 and 1000000 by default)
+#
+# Remarks:
+#   - The internal files are backed up before the measurement and restored when it finishes.
+#   - The command lines are not executed, only their history and exit status are simulated.
+#   - The history-file and Dockerfile are prefilled by the extra command 'benchgen'.
+#   - Each row of the CSV is 'history_lines,operation,iteration,latency_us', and the operation is
+#     one of 'reflected' (exit status 0), 'failed' (non-zero exit status) and 'erase' (dit erase -dhy).
+#
+
+
+
+#
+# Preprocessing
+#
+
+PROMPTS=100
+CSV_FILE=/dit/tmp/bench.csv
+
+while getopts 'n:o:' OPT
+do
+    case "${OPT}" in
+        n)
+            PROMPTS="${OPTARG}"
+            ;;
+        o)
+            CSV_FILE="${OPTARG}"
+            ;;
+        *)
+            exit 1
+            ;;
+    esac
+done
+
+shift "$(( OPTIND - 1 ))"
+
+if [ "$#" -eq 0 ]; then
+    set -- 100 10000 1000000
+fi
+
+
+ENTRYPOINT="${DIT_ENTRYPOINT:-/dit/etc/entrypoint.sh}"
+SEED=20231013
+
+BACKUP_DIR="$( mktemp -d /dit/tmp/bench.XXXXXX )" || exit 1
+
+
+end_processing(){
+    set +x
+
+    if [ -n "${BACKUP_DIR}" ]; then
+        mv -f "${BACKUP_DIR}"/mnt/.dit_history "${BACKUP_DIR}"/mnt/Dockerfile.draft /dit/mnt
+        mv -f "${BACKUP_DIR}"/srv/* /dit/srv
+        mv -f "${BACKUP_DIR}"/var/* /dit/var
+        rm -fr "${BACKUP_DIR}"
+    fi
+
+    echo
+}
+
+trap 'end_processing' EXIT
+trap 'exit 1' HUP INT QUIT TERM
+
+
+mkdir "${BACKUP_DIR}"/mnt "${BACKUP_DIR}"/srv "${BACKUP_DIR}"/var
+
+cp -fp /dit/mnt/.dit_history /dit/mnt/Dockerfile.draft "${BACKUP_DIR}"/mnt || exit 1
+cp -fp /dit/srv/* "${BACKUP_DIR}"/srv || exit 1
+cp -fp /dit/var/* "${BACKUP_DIR}"/var || exit 1
+
+
+# use the same function as the one set by the entrypoint
+eval "$( sed -n '/^PROMPT_REFLECT()$/,/^}$/p' "${ENTRYPOINT}" )"
+
+if ! declare -F PROMPT_REFLECT > /dev/null; then
+    echo "bench.sh: PROMPT_REFLECT is not defined in '${ENTRYPOINT}'" >&2
+    exit 1
+fi
+
+# only the lines given by 'history -s' are added to the history list
+set -o history
+set +o history
+HISTSIZE=16
+
+
+
+#
+# Benchmark Functions
+#
+
+#
+# Usages:
+#   prepare_session <history_lines>
+# Fill history-file and Dockerfile with the synthetic lines, and reset the internal files.
+#
+# Variables:
+#   <history_lines>    the number of lines in history-file
+#
+prepare_session(){
+    benchgen -s "${SEED}" -n "$1" history /dit/mnt/.dit_history || exit 1
+    {
+        cat /dit/etc/Dockerfile.base
+        benchgen -s "${SEED}" -n "$(( $1 / 10 ))" dockerfile | tail -n +2
+    } > /dit/mnt/Dockerfile.draft
+
+    dit config -r
+    dit erase -dhr
+    : > /dit/srv/reflect-report.real
+    dit reflect
+
+    history -c
+    echo 0 > /dit/srv/last-history-number
+}
+
+
+#
+# Usages:
+#   measure <history_lines> <operation> <iteration> <command>...
+# Run the command, and append its latency in microseconds to the CSV file.
+#
+measure(){
+    local START END
+
+    START="${EPOCHREALTIME/./}"
+    "${@:4}" > /dev/null 2>&1
+    END="${EPOCHREALTIME/./}"
+
+    echo "$1,$2,$3,$(( END - START ))" >> "${CSV_FILE}"
+}
+
+
+#
+# Usages:
+#   feed_command_line <line> <exit_status>
+# Simulate that the command line has just been executed, and display the next prompt.
+#
+feed_command_line(){
+    history -s "$1"
+    ( exit "$2" )
+    PROMPT_REFLECT
+}
+
+
+
+#
+# run the benchmark for each history size
+#
+
+COMMAND_LINES=(
+    'ls -l'
+    'cd /usr/local/src'
+    'apk add --no-cache curl'
+    'make install'
+    'echo "${PATH}"'
+    'grep -rn TODO .'
+    'useradd -m builder'
+    'vi Dockerfile'
+)
+
+echo 'history_lines,operation,iteration,latency_us' > "${CSV_FILE}"
+
+for LINES in "$@"
+do
+    echo "bench.sh: ${LINES} lines ..." >&2
+    prepare_session "${LINES}"
+
+    RANDOM="${SEED}"
+
+    for (( i = 1; i <= PROMPTS; i++ ))
+    do
+        LINE="${COMMAND_LINES[$(( RANDOM % ${#COMMAND_LINES[@]} ))]}"
+
+        if (( RANDOM % 4 )); then
+            measure "${LINES}" reflected "$i" feed_command_line "${LINE}" 0
+        else
+            measure "${LINES}" failed "$i" feed_command_line "${LINE}" 1
+        fi
+
+        if (( i % 10 == 0 )); then
+            measure "${LINES}" erase "$i" dit erase -dhy
+        fi
+    done
+done
+
+
+# summarize the median latency of each operation
+sort -t, -k1,1n -k2,2 -k4,4n <( tail -n +2 "${CSV_FILE}" ) | awk -F, '
+    function flush(){
+        if (n)
+            printf "%10d  %-10s %6d samples  median %8d us\n", key_lines, key_op, n, vals[int((n + 1) / 2)]
+        n = 0
+    }
+    ($1 != key_lines) || ($2 != key_op) {
+        flush()
+        key_lines = $1
+        key_op = $2
+    }
+    {
+        vals[++n] = $4
+    }
+    END {
+        flush()
+    }
+' >&2